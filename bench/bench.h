@@ -0,0 +1,46 @@
+/**
+ * @file bench.h
+ * @brief Minimal microbenchmark harness for the PiHub hot paths (dispatcher, list and BME280 compensation)
+ *
+ * @note Each benchmark case runs its body a fixed number of iterations (scaled with -n) on one thread or, in the
+ * contention mode (-t <threads>), on many threads at once sharing the state created by setup(). The harness reports
+ * the wall time per iteration of a single thread (ns/op), the aggregate throughput and the heap allocations per
+ * iteration (malloc/calloc/realloc calls are counted through the linker's --wrap option).
+ *
+ * @note The benchmarks are built with UT defined, so the STATIC functions (see utils/common.h) can be reached with an
+ * extern declaration, the same way the unit tests do it.
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h> // For: std types
+
+/**
+ * @struct BenchCase_t
+ * @brief Single benchmark case
+ */
+typedef struct {
+    const char* name;                                  // Name of the case (<group>/<operation>)
+    uint64_t iterations;                               // Iterations per thread (before scaling with -n)
+    int (*setup)(uint32_t threads);                    // Create the shared state (NULL: none, 0 on success)
+    void (*run)(uint32_t thread, uint64_t iterations); // Body of the case run by every thread
+    void (*teardown)(void);                            // Release the shared state (NULL: none)
+} BenchCase_t;
+
+/**
+ * @struct BenchGroup_t
+ * @brief Benchmark cases of a single module
+ */
+typedef struct {
+    const BenchCase_t* cases; // Array of the cases
+    uint32_t count;           // Number of the cases
+} BenchGroup_t;
+
+extern volatile uint64_t bench_sink; // Results of the benchmarked calls are stored here (not optimized out)
+
+BenchGroup_t bench_dispatcher_group(void);
+BenchGroup_t bench_list_group(void);
+BenchGroup_t bench_bme280_group(void);
+
+#endif // __BENCH_H__
@@ -0,0 +1,83 @@
+#include "bench.h"
+#include "sensors/bme280.h"
+
+extern void bme280_precompute(const Trim_t* trim, Bme280Comp_t* comp);
+extern Bme280_temp_t BME280_compensate_T_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_T);
+extern Bme280_u32_t
+BME280_compensate_P_int64(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+extern Bme280_u32_t
+BME280_compensate_P_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+extern Bme280_u32_t
+bme280_compensate_H_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_H, Bme280_s32_t t_fine);
+
+#define BENCH_BME280_ADC_T 519888 // Raw temperature of the datasheet example (25.08 *C)
+#define BENCH_BME280_ADC_P 415148 // Raw pressure of the datasheet example (100653 Pa)
+#define BENCH_BME280_ADC_H 30000  // Raw humidity (about 45 %RH with the trim below)
+#define BENCH_BME280_T_FINE 128422 // Fine temperature of the datasheet example
+
+// Trim parameters of the datasheet example (humidity ones taken from a real sensor)
+static const Trim_t BENCH_BME280_TRIM = { .dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000, .dig_P1 = 36477,
+    .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855, .dig_P5 = 140, .dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600,
+    .dig_P9 = 6000, .dig_H1 = 75, .dig_H2 = 362, .dig_H3 = 0, .dig_H4 = 313, .dig_H5 = 50, .dig_H6 = 30 };
+
+static Bme280Comp_t bench_comp;
+
+static int bench_bme280_setup(uint32_t threads) {
+    (void)threads;
+    bme280_precompute(&BENCH_BME280_TRIM, &bench_comp);
+    return 0;
+}
+
+// The raw values vary slightly between the iterations (as the real samples do) to keep the calls from being hoisted
+static void bench_compensate_T(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        bench_sink += BME280_compensate_T_int32(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_T + (i & 0xFF)).fine;
+    }
+}
+
+static void bench_compensate_P64(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        bench_sink += BME280_compensate_P_int64(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_P + (i & 0xFF),
+        BENCH_BME280_T_FINE);
+    }
+}
+
+static void bench_compensate_P32(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        bench_sink += BME280_compensate_P_int32(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_P + (i & 0xFF),
+        BENCH_BME280_T_FINE);
+    }
+}
+
+static void bench_compensate_H(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        bench_sink += bme280_compensate_H_int32(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_H + (i & 0xFF),
+        BENCH_BME280_T_FINE);
+    }
+}
+
+// Full compensation of a sample (as done for every readout)
+static void bench_compensate_all(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        Bme280_temp_t t = BME280_compensate_T_int32(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_T + (i & 0xFF));
+        bench_sink += BME280_compensate_P_int64(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_P, t.fine) +
+        bme280_compensate_H_int32(&BENCH_BME280_TRIM, &bench_comp, BENCH_BME280_ADC_H, t.fine);
+    }
+}
+
+static const BenchCase_t BENCH_BME280_CASES[] = {
+    { "bme280/compensate_T_int32", 20000000, bench_bme280_setup, bench_compensate_T, NULL },
+    { "bme280/compensate_P_int64", 20000000, bench_bme280_setup, bench_compensate_P64, NULL },
+    { "bme280/compensate_P_int32", 20000000, bench_bme280_setup, bench_compensate_P32, NULL },
+    { "bme280/compensate_H_int32", 20000000, bench_bme280_setup, bench_compensate_H, NULL },
+    { "bme280/compensate_all", 10000000, bench_bme280_setup, bench_compensate_all, NULL },
+};
+
+BenchGroup_t bench_bme280_group(void) {
+    return (BenchGroup_t){ BENCH_BME280_CASES, sizeof(BENCH_BME280_CASES) / sizeof(BENCH_BME280_CASES[0]) };
+}
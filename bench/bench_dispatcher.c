@@ -0,0 +1,96 @@
+#include <stdio.h>  // For: snprintf()
+#include <string.h> // For: memcpy(), strlen()
+
+#include "app/dispatcher.h"
+#include "bench.h"
+
+extern DispatcherError_t
+dispatcher_tokenize(char* buf, const size_t len, const char* delim, DispatcherToken_t* tokens, uint32_t* count);
+
+#define BENCH_DISPATCHER_CMD "server uptime"           // Command executed by the dispatcher cases
+#define BENCH_DISPATCHER_ARGS_CMD "sensor get 0 all"   // Command with arguments (tokenizer cases)
+
+static Dispatcher_t bench_dispatcher;
+
+// Handler of all registered commands (counts the calls only)
+static void bench_callback(char** argv, uint32_t argc, const void* cmd_ctx) {
+    (void)argv;
+    (void)cmd_ctx;
+    bench_sink += argc;
+}
+
+// Register the command set of the daemon (see app_init_dispatcher()), so the hash table is populated the same way
+static int bench_dispatcher_setup(uint32_t threads) {
+    (void)threads;
+    static const char* cmds[][2] = { { "gpio", "set" }, { "gpio", "get" }, { "gpio", "setmask" }, { "gpio", "getall" },
+        { "gpio", "watch" }, { "gpio", "unwatch" }, { "sensor", "list" }, { "sensor", "get" }, { "sensor", "subscribe" },
+        { "sensor", "unsubscribe" }, { "sensor", "profile" }, { "sensor", "history" }, { "server", "status" },
+        { "server", "uptime" }, { "server", "net" }, { "server", "stats" }, { "server", "rates" },
+        { "server", "disconnect" }, { "server", "proto" }, { "server", "log" }, { "server", "help" } };
+
+    const DispatcherConfig_t cfg = { .delim = " " };
+    if(dispatcher_init(&bench_dispatcher, cfg) != DISPATCHER_ERR_OK) {
+        return -1;
+    }
+    for(uint32_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++) {
+        DispatcherCommandDef_t cmd = { .callback_ptr = bench_callback };
+        snprintf(cmd.target, sizeof(cmd.target), "%s", cmds[i][0]);
+        snprintf(cmd.action, sizeof(cmd.action), "%s", cmds[i][1]);
+        if(dispatcher_register(&bench_dispatcher, i, cmd) != DISPATCHER_ERR_OK) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_dispatcher_teardown(void) {
+    dispatcher_deinit(&bench_dispatcher);
+}
+
+static void bench_tokenize(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    const size_t len = strlen(BENCH_DISPATCHER_ARGS_CMD);
+    char buf[DISPATCHER_MAX_BUF_SIZE];
+    DispatcherToken_t tokens[DISPATCHER_MAX_ARGS + 2];
+    uint32_t count;
+    for(uint64_t i = 0; i < iterations; i++) {
+        memcpy(buf, BENCH_DISPATCHER_ARGS_CMD, len + 1); // Tokenized in place, so restored every time
+        dispatcher_tokenize(buf, len, " ", tokens, &count);
+        bench_sink += count;
+    }
+}
+
+static void bench_execute(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        dispatcher_execute(&bench_dispatcher, BENCH_DISPATCHER_CMD, NULL);
+    }
+}
+
+static void bench_execute_inplace(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    const size_t len = strlen(BENCH_DISPATCHER_ARGS_CMD);
+    char buf[DISPATCHER_MAX_BUF_SIZE];
+    for(uint64_t i = 0; i < iterations; i++) {
+        memcpy(buf, BENCH_DISPATCHER_ARGS_CMD, len + 1); // As if the line was received into the client's buffer
+        dispatcher_execute_inplace(&bench_dispatcher, buf, len, NULL);
+    }
+}
+
+static void bench_execute_not_found(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        bench_sink += dispatcher_execute(&bench_dispatcher, "server reboot", NULL);
+    }
+}
+
+static const BenchCase_t BENCH_DISPATCHER_CASES[] = {
+    { "dispatcher/tokenize", 5000000, NULL, bench_tokenize, NULL },
+    { "dispatcher/execute", 5000000, bench_dispatcher_setup, bench_execute, bench_dispatcher_teardown },
+    { "dispatcher/execute_inplace", 5000000, bench_dispatcher_setup, bench_execute_inplace, bench_dispatcher_teardown },
+    { "dispatcher/execute_not_found", 5000000, bench_dispatcher_setup, bench_execute_not_found, bench_dispatcher_teardown },
+};
+
+BenchGroup_t bench_dispatcher_group(void) {
+    return (BenchGroup_t){ BENCH_DISPATCHER_CASES, sizeof(BENCH_DISPATCHER_CASES) / sizeof(BENCH_DISPATCHER_CASES[0]) };
+}
@@ -0,0 +1,85 @@
+#include "bench.h"
+#include "utils/list.h"
+
+#define BENCH_LIST_NODES 64 // Number of nodes in the list traversed by the traverse/foreach cases
+
+static List_t bench_list;
+
+static int bench_list_cmp(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static ListError_t bench_list_visit(void* data) {
+    bench_sink += *(int64_t*)data;
+    return LIST_ERR_OK;
+}
+
+static int bench_list_setup(uint32_t threads) {
+    (void)threads;
+    return (llist_init(&bench_list, bench_list_cmp) == LIST_ERR_OK) ? 0 : -1;
+}
+
+// Nodes come from the list's pool, large enough for a node per thread (no allocator calls in the loop)
+static int bench_list_pool_setup(uint32_t threads) {
+    if(bench_list_setup(threads) != 0) {
+        return -1;
+    }
+    return (llist_pool_init(&bench_list, sizeof(int64_t), threads) == LIST_ERR_OK) ? 0 : -1;
+}
+
+static int bench_list_filled_setup(uint32_t threads) {
+    if(bench_list_setup(threads) != 0) {
+        return -1;
+    }
+    for(int64_t i = 0; i < BENCH_LIST_NODES; i++) {
+        if(bench_list.push(&bench_list, &i, sizeof(i)) != LIST_ERR_OK) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_list_teardown(void) {
+    bench_list.deinit(&bench_list);
+}
+
+// Every thread pushes and removes its own values (other threads' nodes may be in the list meanwhile)
+static void bench_push_remove(uint32_t thread, uint64_t iterations) {
+    for(uint64_t i = 0; i < iterations; i++) {
+        int64_t value = ((int64_t)thread << 40) | (int64_t)i;
+        bench_list.push(&bench_list, &value, sizeof(value));
+        bench_list.remove(&bench_list, &value);
+    }
+}
+
+static void bench_traverse(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        bench_list.traverse(&bench_list, bench_list_visit);
+    }
+}
+
+static void bench_foreach(uint32_t thread, uint64_t iterations) {
+    (void)thread;
+    for(uint64_t i = 0; i < iterations; i++) {
+        ListIter_t it;
+        bench_list.foreach_begin(&bench_list, &it);
+        for(const int64_t* data = bench_list.foreach_next(&bench_list, &it); data;
+        data = bench_list.foreach_next(&bench_list, &it)) {
+            bench_sink += *data;
+        }
+        bench_list.foreach_end(&bench_list, &it);
+    }
+}
+
+static const BenchCase_t BENCH_LIST_CASES[] = {
+    { "list/push_remove", 2000000, bench_list_setup, bench_push_remove, bench_list_teardown },
+    { "list/push_remove_pool", 2000000, bench_list_pool_setup, bench_push_remove, bench_list_teardown },
+    { "list/traverse_64", 500000, bench_list_filled_setup, bench_traverse, bench_list_teardown },
+    { "list/foreach_64", 500000, bench_list_filled_setup, bench_foreach, bench_list_teardown },
+};
+
+BenchGroup_t bench_list_group(void) {
+    return (BenchGroup_t){ BENCH_LIST_CASES, sizeof(BENCH_LIST_CASES) / sizeof(BENCH_LIST_CASES[0]) };
+}
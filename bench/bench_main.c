@@ -0,0 +1,175 @@
+/**
+ * @file bench_main.c
+ * @brief Runner of the microbenchmarks (see bench.h)
+ *
+ * Usage: pihub_microbench [-t threads] [-n scale] [-f filter]
+ */
+
+#include <errno.h>   // For: errno
+#include <pthread.h> // For: pthread_create(), pthread_join(), pthread_barrier_t
+#include <stdio.h>   // For: printf(), fprintf()
+#include <stdlib.h>  // For: strtod(), strtoul(), EXIT_SUCCESS
+#include <string.h>  // For: strstr()
+#include <time.h>    // For: clock_gettime()
+#include <unistd.h>  // For: getopt()
+
+#include "bench.h"
+
+#define BENCH_MAX_THREADS 64 // Max number of threads in the contention mode
+
+volatile uint64_t bench_sink;
+
+static _Thread_local uint64_t bench_allocs; // Number of heap allocations made by the calling thread
+
+/**
+ * @struct BenchWorker_t
+ * @brief Thread running a benchmark case and its results
+ */
+typedef struct {
+    pthread_t thread;           // Thread ID
+    uint32_t index;             // Index of the thread (passed to the case)
+    const BenchCase_t* bcase;   // Case to be run
+    uint64_t iterations;        // Number of iterations
+    pthread_barrier_t* barrier; // Barrier releasing all threads at once
+    uint64_t elapsed_ns;        // Time spent in the case
+    uint64_t allocs;            // Heap allocations made in the case
+} BenchWorker_t;
+
+// Count the heap allocations of the benchmarked code (the objects are linked with --wrap=malloc etc.)
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    bench_allocs++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    bench_allocs++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    bench_allocs++;
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void* bench_worker(void* arg) {
+    BenchWorker_t* w = (BenchWorker_t*)arg;
+    w->bcase->run(w->index, w->iterations / 100 + 1); // Warm up the caches and the branch predictors
+
+    pthread_barrier_wait(w->barrier);
+    uint64_t allocs = bench_allocs;
+    uint64_t start = bench_now_ns();
+    w->bcase->run(w->index, w->iterations);
+    w->elapsed_ns = bench_now_ns() - start;
+    w->allocs = bench_allocs - allocs;
+    return NULL;
+}
+
+// Run a single case on the given number of threads and print its results
+static int bench_run_case(const BenchCase_t* bcase, const uint32_t threads, const double scale) {
+    if(bcase->setup && bcase->setup(threads) != 0) {
+        fprintf(stderr, "%s: setup failed\n", bcase->name);
+        return -1;
+    }
+
+    BenchWorker_t workers[BENCH_MAX_THREADS] = { 0 };
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads);
+    uint64_t iterations = (uint64_t)(bcase->iterations * scale);
+    iterations = (iterations == 0) ? 1 : iterations;
+    uint32_t started = 0;
+    for(uint32_t i = 0; i < threads; i++) {
+        workers[i] = (BenchWorker_t){ .index = i, .bcase = bcase, .iterations = iterations, .barrier = &barrier };
+        int ret = pthread_create(&workers[i].thread, NULL, bench_worker, &workers[i]);
+        if(ret != 0) {
+            fprintf(stderr, "pthread_create() returned %d\n", ret);
+            return -1; // The started threads stay blocked on the barrier (the process exits anyway)
+        }
+        started++;
+    }
+
+    uint64_t max_ns = 0, allocs = 0;
+    for(uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        max_ns = (workers[i].elapsed_ns > max_ns) ? workers[i].elapsed_ns : max_ns;
+        allocs += workers[i].allocs;
+    }
+    pthread_barrier_destroy(&barrier);
+    if(bcase->teardown) {
+        bcase->teardown();
+    }
+
+    // ns/op as seen by a single thread (the slowest one), throughput of all threads together
+    double ops = (double)iterations * threads;
+    printf("%-32s %12lu %10.1f %12.2f %10.3f\n", bcase->name, (unsigned long)iterations, (double)max_ns / iterations,
+    ops / (max_ns / 1e3), allocs / ops);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t threads = 1;
+    double scale = 1.0;
+    const char* filter = NULL;
+
+    int opt;
+    while((opt = getopt(argc, argv, "t:n:f:h")) != -1) {
+        char* end;
+        errno = 0;
+        switch(opt) {
+        case 't': {
+            unsigned long t = strtoul(optarg, &end, 10);
+            if(errno != 0 || *end != '\0' || t == 0 || t > BENCH_MAX_THREADS) {
+                fprintf(stderr, "invalid number of threads (1 - %d)\n", BENCH_MAX_THREADS);
+                return EXIT_FAILURE;
+            }
+            threads = (uint32_t)t;
+            break;
+        }
+        case 'n': {
+            scale = strtod(optarg, &end);
+            if(errno != 0 || *end != '\0' || scale <= 0) {
+                fprintf(stderr, "invalid iteration scale\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case 'f': {
+            filter = optarg;
+            break;
+        }
+        default: {
+            fprintf(stderr, "Usage: %s [-t threads] [-n scale] [-f filter]\n"
+                            "  -t  number of threads running each case at once (contention mode, default: 1)\n"
+                            "  -n  scale of the iteration counts (default: 1.0)\n"
+                            "  -f  run only the cases whose name contains the filter\n",
+            argv[0]);
+            return EXIT_FAILURE;
+        }
+        }
+    }
+
+    const BenchGroup_t groups[] = { bench_dispatcher_group(), bench_list_group(), bench_bme280_group() };
+
+    printf("pihub_microbench: %u thread(s), iteration scale %.2f\n\n", threads, scale);
+    printf("%-32s %12s %10s %12s %10s\n", "case", "iterations", "ns/op", "Mops/s", "allocs/op");
+    int result = 0;
+    for(size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+        for(uint32_t c = 0; c < groups[g].count; c++) {
+            const BenchCase_t* bcase = &groups[g].cases[c];
+            if(!filter || strstr(bcase->name, filter)) {
+                result |= bench_run_case(bcase, threads, scale);
+            }
+        }
+    }
+
+    return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
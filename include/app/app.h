@@ -7,7 +7,12 @@
  * managed by the main thread.
  *
  * @note Use app_init(), and app_deinit() to initialize and deinitialize new App controller instance.
- * Use: app_run() to run the server and the core controller logic.
+ * Use: app_run() to run the server and the core controller logic. Call app_poll() periodically from the main thread
+ * while the app is running - the failed network subsystem (server and dispatcher) is restarted from there with an
+ * exponential backoff, the hardware is kept initialized.
+ *
+ * @note The server socket is listening as soon as the server is initialized (first), the hardware (GPIO, buses and
+ * sensors) is initialized by a separate thread in parallel with the rest of the components.
  */
 
 #ifndef __APP_H__
@@ -28,6 +33,9 @@ typedef enum {
     APP_ERR_HW_INTERFACE_FAILURE, /**< Error: Hardware interface (I2C/SPI) failure */
     APP_ERR_SENSOR_FAILURE,       /**< Error: Sensor failure */
     APP_ERR_GPIO_FAILURE,         /**< Error: GPIO failure */
+    APP_ERR_SUBSCRIPTION_FAILURE, /**< Error: Sensor subscription table failure */
+    APP_ERR_SYSSTAT_FAILURE,      /**< Error: System stats (sysstat) failure */
+    APP_ERR_PTHREAD_FAILURE,      /**< Error: Pthread API call failure */
     APP_ERR_NOT_STARTED,          /**< Error: The app controller has not been started yet */
     APP_ERR_RUNNING,              /**< Error: The app controller is running */
     APP_ERR_GENERIC               /**< Error: Generic error */
@@ -38,4 +46,10 @@ AppError_t app_run(void);
 AppError_t app_stop(void);
 AppError_t app_deinit(void);
 
+/**
+ * @brief Perform the deferred controller work - restart the failed network subsystem once its backoff delay elapses
+ * @return APP_ERR_OK if the app is healthy, APP_ERR_SERVER_FAILURE while the network subsystem is being restarted
+ */
+AppError_t app_poll(void);
+
 #endif // __APP_H__
\ No newline at end of file
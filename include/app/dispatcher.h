@@ -10,26 +10,50 @@
  * instance. Use: dispatcher_register() and dispatcher_deregister() to add and remove new cmds definitions
  * (user is required to track CMD IDs). And finally use: dispatcher_execute() to parse the character string
  * buffer and execute the callback associated with the command (if no errors are encountered during parsing).
+ * Use dispatcher_execute_inplace() instead when the buffer is writable (e.g. a line in the client's receive
+ * buffer), so that the command is tokenized without copying.
+ *
+ * @note Commands are looked up in O(1) via a hash table keyed on (case-folded) target & action. The table is
+ * rebuilt on every dispatcher_register(), so registration is the slow path and execution the fast one.
+ * @note The command table is an immutable snapshot replaced atomically by dispatcher_register() and
+ * dispatcher_deregister() (serialized by the lock). dispatcher_execute() takes no lock, and the callback runs
+ * outside any dispatcher-wide critical section (it may even (de)register commands itself).
+ *
+ * @note Commands registered with the offload flag (blocking I/O, e.g. a sensor readout) are not executed by the
+ * caller of dispatcher_execute(): the arguments and a copy of the command execution context (cfg.cmd_ctx_size bytes)
+ * are queued as a job and the callback runs on one of the cfg.worker_count worker threads, so it has to post its
+ * response itself (e.g. into the client's output queue). The queue is bounded (cfg.queue_len jobs) and a command
+ * that does not fit is rejected with DISPATCHER_ERR_QUEUE_FULL. Other slow work can be queued with
+ * dispatcher_offload(). Without workers (cfg.worker_count == 0) all callbacks run inline.
  */
 
 #ifndef __CMD_DISPATCHER_H__
 #define __CMD_DISPATCHER_H__
 
-#include <pthread.h> // For: pthread_mutex_t and related function
-#include <stdbool.h> // For: bool
-#include <stdint.h>  // For: std types
+#include <pthread.h>   // For: pthread_mutex_t and related function
+#include <stdatomic.h> // For: _Atomic, atomic_uint
+#include <stdbool.h>   // For: bool
+#include <stddef.h>    // For: size_t, max_align_t
+#include <stdint.h>    // For: std types
 
-#define DISPATCHER_MAX_CMD_COUNT 16   // Max number of commands that the dispatcher can handle
-#define DISPATCHER_TARGET_MAX_SIZE 32 // Max size of the target character string token
-#define DISPATCHER_ACTION_MAX_SIZE 32 // Max size of the action character string token
-#define DISPATCHER_ARG_MAX_SIZE 32    // Max size of a single argument character string token
-#define DISPATCHER_MAX_DELIM_SIZE 8   // Max size of the delimiter string in DispatcherConfig_t
-#define DISPATCHER_MAX_ARGS 10        // Max number of arguments in the command
+#define DISPATCHER_INIT_CMD_COUNT 16    // Initial capacity of the command list (grows on demand)
+#define DISPATCHER_MAX_CMD_COUNT 1024   // Max number of commands that the dispatcher can handle (max ID + 1)
+#define DISPATCHER_TARGET_MAX_SIZE 32   // Max size of the target character string token
+#define DISPATCHER_ACTION_MAX_SIZE 32   // Max size of the action character string token
+#define DISPATCHER_ARG_MAX_SIZE 32      // Max size of a single argument character string token
+#define DISPATCHER_MAX_DELIM_SIZE 8     // Max size of the delimiter string in DispatcherConfig_t
+#define DISPATCHER_MAX_ARGS 10          // Max number of arguments in the command
+#define DISPATCHER_MAX_WORKERS 8        // Max number of worker threads running the offloaded callbacks
+#define DISPATCHER_DEFAULT_QUEUE_LEN 32 // Number of jobs waiting for a worker (if cfg.queue_len is 0)
+#define DISPATCHER_CMD_CTX_MAX_SIZE 64  // Max size of the command execution context copied into an offloaded job
 
 // Max size of the input buffer (one byte deliminer assumed)
 #define DISPATCHER_MAX_BUF_SIZE \
     (DISPATCHER_TARGET_MAX_SIZE + 1 + DISPATCHER_ACTION_MAX_SIZE + 1 + (DISPATCHER_ARG_MAX_SIZE + 1) * DISPATCHER_MAX_ARGS)
 
+// Max size of the argument of a job (fits an offloaded command: callback, metrics, context copy and the arguments)
+#define DISPATCHER_JOB_ARG_MAX_SIZE (DISPATCHER_MAX_BUF_SIZE + DISPATCHER_CMD_CTX_MAX_SIZE + 48)
+
 typedef enum {
     DISPATCHER_ERR_OK = 0x00,        /**< Operation finished successfully */
     DISPATCHER_ERR_NULL_ARG,         /**< Error: NULL pointer passed as argument */
@@ -43,35 +67,75 @@ typedef enum {
     DISPATCHER_ERR_CMD_INCOMPLETE,  /**< Error: The input buffer lacks action or other required token */
     DISPATCHER_ERR_TOO_MANY_ARGS,   /**< Error: To many arguments in the parsed cmd */
     DISPATCHER_ERR_PTHREAD_FAILURE, /**< Error: Pthread API call failure */
+    DISPATCHER_ERR_MALLOC_FAILURE,  /**< Error: Dynamic memory allocation failed */
+    DISPATCHER_ERR_QUEUE_FULL,      /**< Error: All workers busy and the job queue full (nothing was queued) */
     DISPATCHER_ERR_GENERIC          /**< Error: Generic error */
 } DispatcherError_t;
 
 typedef struct {
     char delim[DISPATCHER_MAX_DELIM_SIZE]; // Delimiter string that should separate tokens in the command
+    uint16_t worker_count;                 // Number of worker threads (0: offloaded callbacks run inline as well)
+    uint16_t queue_len;                    // Max number of jobs waiting for a worker (0: DISPATCHER_DEFAULT_QUEUE_LEN)
+    size_t cmd_ctx_size;                   // Size of the cmd_ctx copied into offloaded jobs (0: NULL passed instead)
 } DispatcherConfig_t;
 
 typedef struct {
     char target[DISPATCHER_TARGET_MAX_SIZE]; // Target token, e.g. "gpio", "sensor", "server"
     char action[DISPATCHER_ACTION_MAX_SIZE]; // Action token, e.g. "set", "get", "status"
     void (*callback_ptr)(char** argv, uint32_t argc, const void* cmd_ctx); // Pointer to the command handler
+    bool offload; // Run the callback on a worker thread (slow handlers), the caller's thread otherwise
 } DispatcherCommandDef_t;
 
+typedef struct {
+    char* ptr;  // Pointer to the first character of the token (NULL-terminated once tokenized in place)
+    size_t len; // Length of the token
+} DispatcherToken_t;
+
 typedef struct {
     bool valid;                 // To be always checked first
+    uint32_t hash;              // Case-folded hash of target & action (computed on register)
     DispatcherCommandDef_t cfg; // Command definition
 } DispatcherCommand_t;
 
+typedef struct {
+    uint32_t cmd_capacity;           // Number of entries in cmd_list
+    uint32_t index_size;             // Number of buckets in cmd_index (power of 2)
+    uint32_t* cmd_index;             // Hash table (open addressing) with IDs of the registered commands
+    DispatcherCommand_t cmd_list[];  // List of defined commands (indexed by cmd ID)
+} DispatcherTable_t;
+
+typedef struct {
+    void (*fn)(void* arg);                                          // Function run by a worker
+    void (*drop)(void* arg);                                        // Function releasing the argument if not run
+    _Alignas(max_align_t) uint8_t arg[DISPATCHER_JOB_ARG_MAX_SIZE]; // Copy of the argument passed to fn
+} DispatcherJob_t;
+
+typedef struct {
+    DispatcherJob_t* jobs;                      // Ring of jobs waiting for a worker (NULL if there are no workers)
+    uint32_t size;                              // Number of entries in the ring (cfg.queue_len)
+    uint32_t head;                              // Index of the oldest job
+    uint32_t count;                             // Number of queued jobs
+    bool stopping;                              // Set on deinit (the workers exit without running queued jobs)
+    pthread_mutex_t lock;                       // Lock for the ring
+    pthread_cond_t cond;                        // Signaled when a job is queued or the pool is stopping
+    pthread_t threads[DISPATCHER_MAX_WORKERS];  // Worker threads
+    uint16_t thread_count;                      // Number of running workers
+} DispatcherPool_t;
+
 typedef struct Dispatcher {
-    DispatcherConfig_t cfg;                                 // Dispatcher config
-    DispatcherCommand_t cmd_list[DISPATCHER_MAX_CMD_COUNT]; // List of defined commands
-    pthread_mutex_t lock;                                   // Lock for dispatcher-related critical sections
+    DispatcherConfig_t cfg;             // Dispatcher config
+    _Atomic(DispatcherTable_t*) table;  // Current snapshot of the command table (never modified once published)
+    atomic_uint readers;                // Number of lookups in progress (old snapshots are freed once it drops to 0)
+    pthread_mutex_t lock;               // Lock serializing the command table updates
+    DispatcherPool_t pool;              // Workers running the offloaded callbacks
 } Dispatcher_t;
 
 /**
- * @brief Initialize a new Dispatcher instance
+ * @brief Initialize a new Dispatcher instance (and start its worker threads)
  * @param[in, out]  ctx  Pointer to the Dispatcher instance
  * @param[in] cfg Configuration structure
- * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG or DISPATCHER_ERR_PTHREAD_FAILURE otherwise
+ * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG / DISPATCHER_ERR_INVALID_ARG (e.g. too many workers) /
+ * DISPATCHER_ERR_MALLOC_FAILURE / DISPATCHER_ERR_PTHREAD_FAILURE otherwise
  */
 DispatcherError_t dispatcher_init(Dispatcher_t* ctx, const DispatcherConfig_t cfg);
 
@@ -81,7 +145,7 @@ DispatcherError_t dispatcher_init(Dispatcher_t* ctx, const DispatcherConfig_t cf
  * @param[in]  id  ID of the new command
  * @param[in]  cmd  Command definition (incl. target, action and callback)
  * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG / DISPATCHER_ERR_INVALID_ARG /
- * DISPATCHER_ERR_PTHREAD_FAILURE / DISPATCHER_ERR_ID_ALREADY_TAKEN otherwise
+ * DISPATCHER_ERR_PTHREAD_FAILURE / DISPATCHER_ERR_ID_ALREADY_TAKEN / DISPATCHER_ERR_MALLOC_FAILURE otherwise
  */
 DispatcherError_t dispatcher_register(Dispatcher_t* ctx, const uint32_t id, const DispatcherCommandDef_t cmd);
 
@@ -101,13 +165,42 @@ DispatcherError_t dispatcher_deregister(Dispatcher_t* ctx, const uint32_t id);
  * @param[in]  buf  NULL terminated character string with the command to be parsed
  * @param[in] cmd_ctx Pointer to the command execution context (e.g. details of the server's client that invoked this command)
  * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG / DISPATCHER_ERR_BUF_TOO_LONG / DISPATCHER_ERR_BUF_EMPTY /
- * DISPATCHER_ERR_CMD_INCOMPLETE / DISPATCHER_ERR_TOKEN_TOO_LONG / DISPATCHER_ERR_PTHREAD_FAILURE otherwise
- * @note Dispatcher will associate the parsed buf with the first cmd from the list that matches target and action
+ * DISPATCHER_ERR_CMD_INCOMPLETE / DISPATCHER_ERR_TOKEN_TOO_LONG / DISPATCHER_ERR_PTHREAD_FAILURE /
+ * DISPATCHER_ERR_QUEUE_FULL otherwise
+ * @note Dispatcher will associate the parsed buf with the cmd with the lowest ID that matches target and action
+ * @note For offloaded commands DISPATCHER_ERR_OK means the job was queued (the callback may not have run yet)
  */
 DispatcherError_t dispatcher_execute(Dispatcher_t* ctx, const char* buf, const void* cmd_ctx);
 
 /**
- * @brief Deinit the dispatcher (destroy the mutex)
+ * @brief Tokenize (in place, without copying), validate and parse a command, then call the associated callback
+ * @param[in, out]  ctx  Pointer to the Dispatcher instance
+ * @param[in, out]  buf  Writable character string with the command [must be NULL-terminated at buf[len]]
+ * @param[in]  len  Length of the command
+ * @param[in] cmd_ctx Pointer to the command execution context (e.g. details of the server's client that invoked this command)
+ * @return The same as dispatcher_execute()
+ * @note Delimiters following the tokens are overwritten with NULL chars, so the buffer content is modified
+ */
+DispatcherError_t dispatcher_execute_inplace(Dispatcher_t* ctx, char* buf, const size_t len, const void* cmd_ctx);
+
+/**
+ * @brief Queue a function to be run on a worker thread
+ * @param[in, out]  ctx  Pointer to the Dispatcher instance
+ * @param[in]  fn  Function to be run
+ * @param[in]  drop  Function releasing the resources owned by the argument if the job is dropped on the dispatcher
+ * deinit (NULL if there are none)
+ * @param[in]  arg  Argument of the function (copied into the job, fn gets a pointer to the copy)
+ * @param[in]  arg_size  Size of the argument (at most DISPATCHER_JOB_ARG_MAX_SIZE)
+ * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG / DISPATCHER_ERR_INVALID_ARG /
+ * DISPATCHER_ERR_QUEUE_FULL / DISPATCHER_ERR_PTHREAD_FAILURE otherwise
+ * @note Without workers (cfg.worker_count == 0) fn is run before this function returns
+ */
+DispatcherError_t dispatcher_offload(Dispatcher_t* ctx, void (*fn)(void* arg), void (*drop)(void* arg), const void* arg,
+const size_t arg_size);
+
+/**
+ * @brief Deinit the dispatcher (stop the workers, destroy the mutex, free the command list)
+ * @note Jobs still waiting in the queue are dropped (the ones being run are finished first), see dispatcher_offload()
  * @param[in, out]  ctx  Pointer to the Dispatcher instance
  * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG or DISPATCHER_ERR_PTHREAD_FAILURE otherwise
  */
@@ -0,0 +1,142 @@
+/**
+ * @file proto.h
+ * @brief Codec of the PiHub binary protocol (used by machine clients instead of the text commands)
+ *
+ * @note A client switches to the binary protocol with the `server proto bin` text command and back with the
+ * PROTO_OP_TEXT request. From then on every message is a frame: the length prefix (SERVER_FRAME_PREFIX_SIZE bytes,
+ * length of the rest of the frame), the header - opcode (1 byte), status (1 byte, 0 in requests) and request ID
+ * (4 bytes) - and the payload. All multi-byte fields are big-endian (network byte order).
+ *
+ * @note Request payload is a list of uint32 arguments (their number is fixed per opcode, see ProtoOpcode_t), so the
+ * handlers get typed integers without any parsing. Response payload carries the packed values. Every response echoes
+ * the opcode and the request ID of its request, so a client may pipeline many requests and match the responses by
+ * the ID (no ordering is guaranteed). Asynchronous messages (e.g. subscription samples or GPIO edge events) are sent
+ * as PROTO_OP_NOTICE frames with request ID 0 and the text of the message as the payload.
+ *
+ * @note Use proto_decode_request() on a frame body returned by server_get_frame() and proto_encode_header() to build
+ * the header of a response (sent together with the payload, e.g. with server_writev()).
+ */
+
+#ifndef __PROTO_H__
+#define __PROTO_H__
+
+#include <stdint.h> // For: std types
+#include <stdlib.h> // For: size_t
+
+#include "comm/network.h"
+#include "sensors/sensor.h"
+
+#define PROTO_HEADER_SIZE 6 // Size of the header following the length prefix (opcode, status, request ID)
+#define PROTO_FRAME_HEADER_SIZE (SERVER_FRAME_PREFIX_SIZE + PROTO_HEADER_SIZE) // Length prefix + header
+#define PROTO_MAX_PAYLOAD (UINT16_MAX - PROTO_HEADER_SIZE) // Max size of the payload of a single frame
+#define PROTO_MAX_ARGS 8        // Max number of uint32 arguments in a request
+#define PROTO_OPCODE_COUNT 0x80 // Number of valid opcodes (0x00 - 0x7F)
+#define PROTO_READING_SIZE 13   // Size of a packed SensorReading_t (see proto_pack_reading())
+#define PROTO_NOTICE_REQ_ID 0   // Request ID of the asynchronous PROTO_OP_NOTICE frames
+
+/**
+ * @struct ProtoError_t
+ * @brief Error codes returned by binary protocol API functions
+ */
+typedef enum {
+    PROTO_ERR_OK = 0x00,        /**< Operation finished successfully */
+    PROTO_ERR_NULL_ARGUMENT,    /**< Error: NULL ptr passed as argument */
+    PROTO_ERR_INVALID_ARGUMENT, /**< Error: Invalid argument (e.g. payload too long for a single frame) */
+    PROTO_ERR_MALFORMED_FRAME,  /**< Error: Frame shorter than the header or payload not a list of arguments */
+    PROTO_ERR_GENERIC,          /**< Error: Generic error */
+} ProtoError_t;
+
+/**
+ * @struct ProtoOpcode_t
+ * @brief Opcodes of the binary protocol (arguments of the request -> payload of the response)
+ */
+typedef enum {
+    PROTO_OP_PING = 0x00,         /**< () -> () */
+    PROTO_OP_TEXT = 0x01,         /**< () -> (); switches the client back to the text commands after the response */
+    PROTO_OP_GPIO_SET = 0x10,     /**< (line, state) -> () */
+    PROTO_OP_GPIO_GET = 0x11,     /**< (line) -> (u8 state) */
+    PROTO_OP_GPIO_SETMASK = 0x12, /**< (lines_lo, lines_hi, values_lo, values_hi) -> (); bit N = line N */
+    PROTO_OP_GPIO_GETALL = 0x13,  /**< (lines_lo, lines_hi) -> (u32 values_lo, u32 values_hi); bit N = line N */
+    PROTO_OP_SENSOR_COUNT = 0x20, /**< () -> (u8 count) */
+    PROTO_OP_SENSOR_GET = 0x21,   /**< (sensor ID) -> (packed reading, see proto_pack_reading()) */
+    PROTO_OP_NOTICE = 0x7F,       /**< Asynchronous message sent by the server (text payload) */
+} ProtoOpcode_t;
+
+/**
+ * @struct ProtoStatus_t
+ * @brief Status of a response
+ */
+typedef enum {
+    PROTO_STATUS_OK = 0x00,        /**< Request executed successfully */
+    PROTO_STATUS_MALFORMED,        /**< Frame could not be decoded */
+    PROTO_STATUS_UNKNOWN_OPCODE,   /**< Opcode not supported */
+    PROTO_STATUS_INVALID_ARGUMENT, /**< Wrong number of arguments or argument out of range */
+    PROTO_STATUS_NOT_SUPPORTED,    /**< Request not supported by the target (e.g. measurement missing in a sensor) */
+    PROTO_STATUS_FAILURE,          /**< Request failed (e.g. sensor readout failure) */
+    PROTO_STATUS_BUSY,             /**< Request rejected, all workers busy (may be retried later) */
+} ProtoStatus_t;
+
+/**
+ * @struct ProtoRequest_t
+ * @brief Decoded request
+ */
+typedef struct {
+    uint8_t opcode;                // Opcode (see ProtoOpcode_t)
+    uint32_t req_id;               // Request ID (echoed in the response)
+    uint32_t argc;                 // Number of arguments
+    uint32_t argv[PROTO_MAX_ARGS]; // Arguments
+} ProtoRequest_t;
+
+/**
+ * @brief Decode a request
+ * @note The opcode and the request ID are decoded even if the arguments are malformed (so that the error response
+ * can be matched to the request), otherwise they are zeroed
+ *
+ * @param[in] body Frame body (without the length prefix, see server_get_frame())
+ * @param[in] len Length of the frame body
+ * @param[out] req Pointer to store the decoded request
+ * @return PROTO_ERR_OK on success, PROTO_ERR_NULL_ARGUMENT / PROTO_ERR_MALFORMED_FRAME otherwise
+ */
+ProtoError_t proto_decode_request(const uint8_t* body, const size_t len, ProtoRequest_t* req);
+
+/**
+ * @brief Encode the length prefix and the header of a frame
+ *
+ * @param[out] hdr Buffer for the header (PROTO_FRAME_HEADER_SIZE bytes)
+ * @param[in] opcode Opcode of the frame
+ * @param[in] status Status of the response (PROTO_STATUS_OK for notices)
+ * @param[in] req_id Request ID being answered (PROTO_NOTICE_REQ_ID for notices)
+ * @param[in] payload_len Length of the payload following the header (at most PROTO_MAX_PAYLOAD)
+ * @return PROTO_ERR_OK on success, PROTO_ERR_NULL_ARGUMENT / PROTO_ERR_INVALID_ARGUMENT otherwise
+ */
+ProtoError_t proto_encode_header(uint8_t* hdr,
+const uint8_t opcode,
+const ProtoStatus_t status,
+const uint32_t req_id,
+const size_t payload_len);
+
+/**
+ * @brief Pack a sensor readout: fields (u8), temp_cC (i32), hum_q10 (u32) and press_q8 (u32)
+ *
+ * @param[out] buf Buffer for the packed readout (PROTO_READING_SIZE bytes)
+ * @param[in] reading Readout to be packed
+ */
+void proto_pack_reading(uint8_t* buf, const SensorReading_t* reading);
+
+/**
+ * @brief Store a uint32 value in big-endian byte order
+ *
+ * @param[out] buf Buffer for the value (4 bytes)
+ * @param[in] value Value to be stored
+ */
+void proto_put_u32(uint8_t* buf, const uint32_t value);
+
+/**
+ * @brief Load a uint32 value stored in big-endian byte order
+ *
+ * @param[in] buf Buffer with the value (4 bytes)
+ * @return Loaded value
+ */
+uint32_t proto_get_u32(const uint8_t* buf);
+
+#endif // __PROTO_H__
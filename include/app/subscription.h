@@ -0,0 +1,127 @@
+/**
+ * @file subscription.h
+ * @brief Per-client sensor subscriptions with a single scheduler thread pushing periodic samples to the clients
+ *
+ * @note Designed to provide thread-safe functionality (MT-Safe)
+ *
+ * @note Use subscription_init(), and subscription_deinit() to initialize and deinitialize new subscription table.
+ * Use: subscription_add(), subscription_remove() and subscription_remove_client() to manage the subscriptions and
+ * subscription_start() / subscription_stop() to run the scheduler. On every tick the scheduler takes ONE sample
+ * per sensor (via the sample callback) and fans the rendered message out to all due subscribers of that sensor
+ * (via the deliver callback). Subscribers whose delivery fails are dropped.
+ */
+
+#ifndef __SUBSCRIPTION_H__
+#define __SUBSCRIPTION_H__
+
+#include <pthread.h> // For: pthread_t, pthread_mutex_t, pthread_cond_t
+#include <stdbool.h> // For: bool
+#include <stddef.h>  // For: size_t
+#include <stdint.h>  // For: std types
+
+#include "comm/network.h"
+
+#define SUBSCRIPTION_MSG_MAX_SIZE 256 // Max size of a single message rendered by the sample callback
+
+typedef enum {
+    SUBSCRIPTION_ERR_OK = 0x00,        /**< Operation finished successfully */
+    SUBSCRIPTION_ERR_NULL_ARG,         /**< Error: NULL pointer passed as argument */
+    SUBSCRIPTION_ERR_INVALID_ARG,      /**< Error: Incorrect parameter passed */
+    SUBSCRIPTION_ERR_TABLE_FULL,       /**< Error: No more space for new subscriptions */
+    SUBSCRIPTION_ERR_NOT_FOUND,        /**< Error: Subscription not found */
+    SUBSCRIPTION_ERR_MALLOC_FAILURE,   /**< Error: Dynamic memory allocation failed */
+    SUBSCRIPTION_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API call failure */
+    SUBSCRIPTION_ERR_GENERIC           /**< Error: Generic error */
+} SubscriptionError_t;
+
+typedef struct {
+    uint32_t max_count;     // Max number of subscriptions (all clients, all sensors)
+    uint32_t min_period_ms; // Min allowed sampling period
+    uint32_t max_period_ms; // Max allowed sampling period
+    // Take one sample from the sensor and render a message into buf (returns false if the readout failed)
+    bool (*sample)(const uint8_t sensor_id, char* buf, const size_t buf_len);
+    // Deliver the message to the subscriber (returns false if the client is gone and should be unsubscribed)
+    bool (*deliver)(const ServerClient_t* client, const char* msg, const bool sample_ok);
+} SubscriptionConfig_t;
+
+typedef struct {
+    bool active;           // To be always checked first
+    ServerClient_t client; // Subscribed client
+    uint8_t sensor_id;     // ID of the sensor
+    uint32_t period_ms;    // Sampling period
+    uint64_t next_due_ms;  // CLOCK_MONOTONIC time of the next delivery
+} Subscription_t;
+
+typedef struct {
+    SubscriptionConfig_t cfg; // Subscription table config
+    Subscription_t* list;     // Table of subscriptions (cfg.max_count entries)
+    Subscription_t* due;      // Scratch table with subscriptions due in the current tick (cfg.max_count entries)
+    pthread_mutex_t lock;     // Lock for subscription-related critical sections
+    pthread_cond_t cond;      // Wakes up the scheduler on changes in the table or on stop
+    pthread_t thread;         // Scheduler thread
+    bool running;             // Set while the scheduler thread is running
+} SubscriptionTable_t;
+
+/**
+ * @brief Initialize a new subscription table
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @param[in]  cfg  Configuration structure
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG / SUBSCRIPTION_ERR_INVALID_ARG /
+ * SUBSCRIPTION_ERR_MALLOC_FAILURE / SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ */
+SubscriptionError_t subscription_init(SubscriptionTable_t* ctx, const SubscriptionConfig_t cfg);
+
+/**
+ * @brief Start the scheduler thread
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG / SUBSCRIPTION_ERR_GENERIC /
+ * SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ */
+SubscriptionError_t subscription_start(SubscriptionTable_t* ctx);
+
+/**
+ * @brief Stop the scheduler thread (subscriptions are kept)
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG or SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ * @note Has no effect if the scheduler is not running
+ */
+SubscriptionError_t subscription_stop(SubscriptionTable_t* ctx);
+
+/**
+ * @brief Subscribe the client to periodic samples from the sensor (or update the period if already subscribed)
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @param[in]  client  Client to be subscribed
+ * @param[in]  sensor_id  ID of the sensor
+ * @param[in]  period_ms  Sampling period (between cfg.min_period_ms and cfg.max_period_ms)
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG / SUBSCRIPTION_ERR_INVALID_ARG /
+ * SUBSCRIPTION_ERR_TABLE_FULL / SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ */
+SubscriptionError_t
+subscription_add(SubscriptionTable_t* ctx, const ServerClient_t client, const uint8_t sensor_id, const uint32_t period_ms);
+
+/**
+ * @brief Unsubscribe the client from the sensor
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @param[in]  client  Subscribed client
+ * @param[in]  sensor_id  ID of the sensor
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG / SUBSCRIPTION_ERR_NOT_FOUND /
+ * SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ */
+SubscriptionError_t subscription_remove(SubscriptionTable_t* ctx, const ServerClient_t client, const uint8_t sensor_id);
+
+/**
+ * @brief Remove all subscriptions of the client (e.g. on disconnect)
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @param[in]  client  Client to be unsubscribed
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG or SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ */
+SubscriptionError_t subscription_remove_client(SubscriptionTable_t* ctx, const ServerClient_t client);
+
+/**
+ * @brief Deinit the subscription table (stop the scheduler, free the table, destroy the mutex)
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @return SUBSCRIPTION_ERR_OK on success, SUBSCRIPTION_ERR_NULL_ARG or SUBSCRIPTION_ERR_PTHREAD_FAILURE otherwise
+ */
+SubscriptionError_t subscription_deinit(SubscriptionTable_t* ctx);
+
+#endif // __SUBSCRIPTION_H__
@@ -2,12 +2,21 @@
  * @file sysstat.h
  * @brief A component for retrieving and parsing host operating system statistics.
  *
+ * @note Use sysstat_get_uptime_info(), sysstat_get_mem_info() and sysstat_get_net_info() for one-off readouts (the
+ * /proc file is opened and closed on every call). Use sysstat_init() and the *_cached() variants to poll the stats
+ * often (e.g. on every `server status`): the /proc files are kept open, refreshed with a single pread() into a
+ * reusable buffer not more often than once per TTL and parsed with a hand-written scanner [thread-safe].
  */
 
 #ifndef __SYSSTAT_H__
 #define __SYSSTAT_H__
 
-#include <stdint.h> // For: std integer types
+#include <pthread.h> // For: pthread_mutex_t
+#include <stdbool.h> // For: bool
+#include <stdint.h>  // For: std integer types
+#include <stdlib.h>  // For: size_t
+
+#define SYSSTAT_SOURCE_BUF_LEN 4096 // Size of the buffer holding the contents of a held-open /proc file
 
 /**
  * @enum SysstatError_t
@@ -19,6 +28,9 @@ typedef enum {
     SYSSTAT_ERR_FILESYSTEM_FAILURE, /**< Error: File open/read/write/close operation failure */
     SYSSTAT_ERR_FILE_EMPTY,         /**< Error: Linux Kernel file is empty */
     SYSSTAT_ERR_BUF_TOO_SHORT,      /**< Error: The input buffer is too short */
+    SYSSTAT_ERR_NOT_INITIALIZED,    /**< Error: The instance has not been initialized */
+    SYSSTAT_ERR_PTHREAD_FAILURE,    /**< Error: Pthread API call failure */
+    SYSSTAT_ERR_NO_DATA,            /**< Error: No samples collected yet */
     SYSSTAT_ERR_GENERIC,            /**< Error: Generic error */
 } SysstatError_t;
 
@@ -43,9 +55,18 @@ typedef struct {
     uint64_t tx_packets;
 } SysstatNetInfo_t;
 
+/**
+ * @struct SysstatCpuInfo_t
+ * @brief Stores cumulative CPU time of all cores, parsed from the first line of /proc/stat
+ */
 typedef struct {
-    uint32_t s;
-    uint16_t ms;
+    uint64_t total_jiffies; // Time spent in all states (user, nice, system, idle, iowait, irq, softirq, steal)
+    uint64_t idle_jiffies;  // Time spent idle (idle + iowait)
+} SysstatCpuInfo_t;
+
+typedef struct {
+    uint32_t s;  // Full seconds
+    uint16_t ms; // Milliseconds (0 - 999)
 } SysstatTime_t;
 
 typedef struct {
@@ -53,6 +74,42 @@ typedef struct {
     SysstatTime_t idle;
 } SysstatUptimeInfo_t;
 
+/**
+ * @enum SysstatSourceId_t
+ * @brief /proc files held open by the Sysstat instance
+ */
+typedef enum {
+    SYSSTAT_SOURCE_UPTIME = 0x00, /**< /proc/uptime */
+    SYSSTAT_SOURCE_MEMINFO,       /**< /proc/meminfo */
+    SYSSTAT_SOURCE_NET_DEV,       /**< /proc/net/dev */
+    SYSSTAT_SOURCE_STAT,          /**< /proc/stat */
+    SYSSTAT_SOURCE_THERMAL,       /**< SoC thermal zone (/sys/class/thermal/thermal_zone0/temp) */
+    SYSSTAT_SOURCE_COUNT,         /**< Number of the sources */
+} SysstatSourceId_t;
+
+/**
+ * @struct SysstatSource_t
+ * @brief Held-open /proc file with its last contents
+ */
+typedef struct {
+    int fd;                           // File descriptor of the /proc file (-1: not opened)
+    bool valid;                       // Set once the contents have been read
+    uint64_t timestamp_ms;            // CLOCK_MONOTONIC time of the last read
+    size_t len;                       // Length of the contents (without the terminating char)
+    char buf[SYSSTAT_SOURCE_BUF_LEN]; // Last contents of the file (NULL-terminated)
+} SysstatSource_t;
+
+/**
+ * @struct Sysstat_t
+ * @brief Sysstat instance caching the contents of the held-open /proc files
+ */
+typedef struct {
+    SysstatSource_t sources[SYSSTAT_SOURCE_COUNT]; // Held-open /proc files
+    uint32_t ttl_ms;                               // Max age of the cached contents (0: refreshed on every call)
+    pthread_mutex_t lock;                          // Protects the sources
+    bool is_initialized;                           // Initialization flag
+} Sysstat_t;
+
 /**
  * @brief Retrieves the system uptime in seconds from /proc/uptime
  *
@@ -78,4 +135,68 @@ SysstatError_t sysstat_get_mem_info(SysstatMemInfo_t* mem_info);
  */
 SysstatError_t sysstat_get_net_info(const char* interface_name, SysstatNetInfo_t* net_info);
 
+/**
+ * @brief Initialize the Sysstat instance and open the /proc files
+ *
+ * @param[out] ctx Pointer to the instance
+ * @param[in] ttl_ms Max age of the cached contents of a /proc file (0 disables the cache)
+ * @return SysstatError_t Error code indicating success or failure
+ * @note A file that cannot be opened now is retried on its first readout
+ */
+SysstatError_t sysstat_init(Sysstat_t* ctx, const uint32_t ttl_ms);
+
+/**
+ * @brief Close the /proc files and deinitialize the Sysstat instance
+ *
+ * @param[in, out] ctx Pointer to the instance
+ * @return SysstatError_t Error code indicating success or failure
+ */
+SysstatError_t sysstat_deinit(Sysstat_t* ctx);
+
+/**
+ * @brief Retrieves the system uptime via the held-open /proc/uptime (served from the cache within the TTL)
+ *
+ * @param[in] ctx Pointer to the initialized instance
+ * @param[out] uptime Pointer to store uptime value
+ * @return SysstatError_t Error code indicating success or failure
+ */
+SysstatError_t sysstat_get_uptime_info_cached(Sysstat_t* ctx, SysstatUptimeInfo_t* uptime);
+
+/**
+ * @brief Retrieves memory information via the held-open /proc/meminfo (served from the cache within the TTL)
+ *
+ * @param[in] ctx Pointer to the initialized instance
+ * @param[out] mem_info Pointer to SysstatMemInfo_t to store results
+ * @return SysstatError_t Error code indicating success or failure
+ */
+SysstatError_t sysstat_get_mem_info_cached(Sysstat_t* ctx, SysstatMemInfo_t* mem_info);
+
+/**
+ * @brief Retrieves network information via the held-open /proc/net/dev (served from the cache within the TTL)
+ *
+ * @param[in] ctx Pointer to the initialized instance
+ * @param[in] interface_name Name of the network interface (e.g., "eth0")
+ * @param[out] net_info Pointer to SysstatNetInfo_t to store results
+ * @return SysstatError_t Error code indicating success or failure
+ */
+SysstatError_t sysstat_get_net_info_cached(Sysstat_t* ctx, const char* interface_name, SysstatNetInfo_t* net_info);
+
+/**
+ * @brief Retrieves cumulative CPU time via the held-open /proc/stat (served from the cache within the TTL)
+ *
+ * @param[in] ctx Pointer to the initialized instance
+ * @param[out] cpu_info Pointer to SysstatCpuInfo_t to store results
+ * @return SysstatError_t Error code indicating success or failure
+ */
+SysstatError_t sysstat_get_cpu_info_cached(Sysstat_t* ctx, SysstatCpuInfo_t* cpu_info);
+
+/**
+ * @brief Retrieves the SoC temperature via the held-open thermal zone (served from the cache within the TTL)
+ *
+ * @param[in] ctx Pointer to the initialized instance
+ * @param[out] temp_mC Pointer to store the temperature (in milli-degrees Celsius)
+ * @return SysstatError_t Error code indicating success or failure
+ */
+SysstatError_t sysstat_get_temp_cached(Sysstat_t* ctx, int32_t* temp_mC);
+
 #endif // __SYSSTAT_H__
@@ -0,0 +1,120 @@
+/**
+ * @file sysstat_collector.h
+ * @brief Background sampler of the host statistics with precomputed rates and a short history.
+ *
+ * @note Use sysstat_collector_start() and sysstat_collector_stop(). A single collector thread samples /proc/net/dev,
+ * /proc/meminfo, /proc/stat and the SoC thermal zone every interval_ms into a ring of the last
+ * SYSSTAT_COLLECTOR_HISTORY_LEN samples, so any number of clients is served from memory instead of re-reading procfs.
+ * Use sysstat_collector_get_latest() for the last sample (incl. rates since the previous one) and
+ * sysstat_collector_get_rates() for rates over a longer window.
+ *
+ * @note Multithreading: The ring has a single writer (the collector thread) and is read without locks - each slot
+ * carries a sequence counter (odd while the slot is being written) and readers retry when it changed during the copy.
+ */
+
+#ifndef __SYSSTAT_COLLECTOR_H__
+#define __SYSSTAT_COLLECTOR_H__
+
+#include <pthread.h>   // For: pthread_t, pthread_mutex_t, pthread_cond_t
+#include <stdatomic.h> // For: atomic_uint
+#include <stdbool.h>   // For: bool
+#include <stdint.h>    // For: std integer types
+
+#include "app/sysstat.h"
+
+#define SYSSTAT_COLLECTOR_HISTORY_LEN 64  // Number of the most recent samples kept in the ring
+#define SYSSTAT_COLLECTOR_IF_NAME_SIZE 16 // Max size of the network interface name (incl. the terminating char)
+
+/**
+ * @struct SysstatSample_t
+ * @brief Single sample of the host statistics (cumulative counters + rates since the previous sample)
+ */
+typedef struct {
+    uint64_t timestamp_ms;      // CLOCK_MONOTONIC time of the sample
+    SysstatMemInfo_t mem;       // Memory usage
+    SysstatNetInfo_t net;       // Cumulative counters of the network interface (valid if has_net)
+    SysstatCpuInfo_t cpu;       // Cumulative CPU time
+    int32_t temp_mC;            // SoC temperature in milli-degrees Celsius (valid if has_temp)
+    bool has_net;               // The network interface was found
+    bool has_temp;              // The thermal zone is available
+    uint64_t tx_Bps;            // Transmitted bytes per second since the previous sample
+    uint64_t rx_Bps;            // Received bytes per second since the previous sample
+    uint16_t cpu_load_permille; // CPU load since the previous sample (0 - 1000)
+} SysstatSample_t;
+
+/**
+ * @struct SysstatRates_t
+ * @brief Rates computed over a window of the collected samples
+ */
+typedef struct {
+    uint32_t window_ms;         // Actual time span of the window (may be shorter than requested)
+    uint64_t tx_Bps;            // Transmitted bytes per second
+    uint64_t rx_Bps;            // Received bytes per second
+    uint16_t cpu_load_permille; // CPU load (0 - 1000)
+} SysstatRates_t;
+
+/**
+ * @struct SysstatSampleSlot_t
+ * @brief Ring slot with the sequence counter guarding its sample
+ */
+typedef struct {
+    atomic_uint seq;        // Odd while the sample is being written
+    SysstatSample_t sample; // Sample stored in the slot
+} SysstatSampleSlot_t;
+
+/**
+ * @struct SysstatCollector_t
+ * @brief Collector thread state and the ring of the collected samples
+ */
+typedef struct {
+    Sysstat_t sysstat;                                       // Held-open /proc files (read on every tick)
+    char interface_name[SYSSTAT_COLLECTOR_IF_NAME_SIZE];     // Sampled network interface
+    uint32_t interval_ms;                                    // Sampling interval
+    pthread_t thread;                                        // Collector thread
+    pthread_mutex_t lock;                                    // Protects running (and the sleep between ticks)
+    pthread_cond_t cond;                                     // Wakes up the collector thread on stop
+    bool running;                                            // Set while the collector thread is running
+    atomic_uint count;                                       // Number of samples collected so far
+    SysstatSampleSlot_t ring[SYSSTAT_COLLECTOR_HISTORY_LEN]; // The most recent samples
+} SysstatCollector_t;
+
+/**
+ * @brief Take the first sample and start the collector thread
+ *
+ * @param[out] ctx Pointer to the collector
+ * @param[in] interface_name Name of the sampled network interface (e.g., "wlan0")
+ * @param[in] interval_ms Sampling interval (must be > 0)
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_NULL_ARGUMENT / SYSSTAT_ERR_BUF_TOO_SHORT /
+ * SYSSTAT_ERR_PTHREAD_FAILURE / SYSSTAT_ERR_GENERIC otherwise
+ */
+SysstatError_t sysstat_collector_start(SysstatCollector_t* ctx, const char* interface_name, const uint32_t interval_ms);
+
+/**
+ * @brief Stop the collector thread and release its resources
+ *
+ * @param[in, out] ctx Pointer to the collector
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_NULL_ARGUMENT / SYSSTAT_ERR_NOT_INITIALIZED /
+ * SYSSTAT_ERR_PTHREAD_FAILURE otherwise
+ */
+SysstatError_t sysstat_collector_stop(SysstatCollector_t* ctx);
+
+/**
+ * @brief Get the most recent sample
+ *
+ * @param[in] ctx Pointer to the collector
+ * @param[out] sample Pointer to store the sample
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_NULL_ARGUMENT or SYSSTAT_ERR_NO_DATA otherwise
+ */
+SysstatError_t sysstat_collector_get_latest(SysstatCollector_t* ctx, SysstatSample_t* sample);
+
+/**
+ * @brief Get the rates between the most recent sample and the newest sample at least window_ms older
+ *
+ * @param[in] ctx Pointer to the collector
+ * @param[in] window_ms Requested window (the oldest sample kept in the ring is used if the history is shorter)
+ * @param[out] rates Pointer to store the rates
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_NULL_ARGUMENT or SYSSTAT_ERR_NO_DATA (less than 2 samples) otherwise
+ */
+SysstatError_t sysstat_collector_get_rates(SysstatCollector_t* ctx, const uint32_t window_ms, SysstatRates_t* rates);
+
+#endif // __SYSSTAT_COLLECTOR_H__
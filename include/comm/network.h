@@ -2,17 +2,33 @@
  * @file network.h
  * @brief Manage a simple TCP/UDP server.
  *
- * @note Use server_create(), server_run(), server_shutdown() and server_destroy(). Use server_read(),
- * server_write(), server_broadcast(), server_disconnect(), server_get_clients() and server_get_client_ip() to
- * mange active clients (incl. I/O) [this part of the API is thread-safe].
+ * @note Use server_create(), server_run(), server_shutdown() and server_destroy(). Use server_read(), server_write(),
+ * server_writev(), server_broadcast(), server_broadcastv(), server_disconnect(), server_get_clients(),
+ * server_get_client_ip() and server_client_equal() to mange active clients (incl. I/O) [this part of the API is
+ * thread-safe]. Use server_receive() and server_get_line() to read newline-framed data via client's receive buffer
+ * [only from the thread serving the client, i.e. inside the data_received callback]. Clients switched to
+ * length-prefixed framing with server_set_framing() are read with server_get_frame() instead. Use server_watch() and
+ * server_unwatch() to have other file descriptors (e.g. GPIO line events) monitored by the listening thread while the
+ * server is running.
+ *
+ * @note Output: server_broadcast() copies the message once into a shared reference-counted buffer and queues it on
+ * the output queue of each client. Queues are flushed without blocking; whatever the socket does not accept right
+ * away is sent (with writev) by the thread serving the client once the socket becomes writable (EPOLLOUT), so a
+ * slow client does not stall the caller or the other clients. server_write() never blocks either - the data that
+ * does not fit into the socket is queued. Each queue is bounded by the high-water mark (ServerConfig_t.tx_high_water)
+ * and a slow consumer exceeding it is handled according to ServerConfig_t.tx_policy.
  *
  * Additional control is provided via callbacks for events such as: client_connect (called by: server
- * listening thread), data_received & client_disconnect (called by: client worker thread) and server_failure
- * (called by: server listening thread OR client worker thread).
+ * listening thread or accept thread), data_received & client_disconnect (called by: client worker thread) and
+ * server_failure (called by: server listening thread, accept thread OR client worker thread).
  *
  * @note Multithreading: This component creates one thread for server control (e.g. shutdown requests) and for
- * listening to incomming data. A worker thread is also created for each new client. [no. of threads per
- * instance = 1 + clients_count]
+ * listening to incomming data. In SERVER_MODE_THREAD_PER_CLIENT a worker thread is also created for each new
+ * client [no. of threads per instance = 1 + clients_count]. In SERVER_MODE_REACTOR all clients are served by a
+ * fixed pool of epoll reactor threads and each client is assigned to one of them by its fd [no. of threads per
+ * instance = 1 + reactor_count]. In both modes data_received & client_disconnect are called by the thread that
+ * serves the client (client worker thread or reactor thread). With ServerConfig_t.acceptor_count > 1 an accept
+ * thread is created for each additional SO_REUSEPORT listening socket [+ acceptor_count - 1 threads].
  */
 
 #ifndef __NETWORK_H__
@@ -20,14 +36,22 @@
 
 #include <arpa/inet.h> // For: inet_ntop
 #include <pthread.h>   // For: pthread_mutex_t
+#include <stdatomic.h> // For: atomic_uint
 #include <stdbool.h>   // For: bool
 #include <stdint.h>    // For: std types
 #include <stdlib.h>    // For: size_t
+#include <sys/uio.h>   // For: struct iovec
 
-#include "utils/list.h" // For: List_t
-
-#define IPV4_ADDRSTR_LENGTH INET_ADDRSTRLEN
+#define IP_ADDRSTR_LENGTH INET6_ADDRSTRLEN // Long enough for both IPv4 and IPv6 addresses
 #define MAX_PORTSTR_LENGTH 12
+#define SERVER_MAX_REACTORS 8 // Max number of reactor threads in SERVER_MODE_REACTOR
+#define SERVER_MAX_ACCEPTORS 8 // Max number of listening sockets of a server (see ServerConfig_t.acceptor_count)
+#define SERVER_DEFAULT_RX_BUF_SIZE 1024 // Size of the client receive buffer if not set in ServerConfig_t
+#define SERVER_CLIENT_TABLE_SIZE 1024   // Number of slots in the fd-indexed client table (max client fd + 1)
+#define SERVER_TX_QUEUE_LEN 64          // Max number of messages waiting in a client's output queue
+#define SERVER_TX_IOV_MAX 16            // Max number of queued messages sent with a single writev
+#define SERVER_DEFAULT_TX_HIGH_WATER 65536 // Max number of bytes queued for a client if not set in ServerConfig_t
+#define SERVER_FRAME_PREFIX_SIZE 2         // Size of the length prefix of a frame (big-endian length of the frame body)
 
 /**
  * @struct ServerError_t
@@ -37,15 +61,61 @@ typedef enum {
     SERVER_ERR_OK = 0x00,           /**< Operation finished successfully */
     SERVER_ERR_NET_FAILURE,         /**< Error: System network API failure */
     SERVER_ERR_NULL_ARGUMENT,       /**< Error: NULL ptr passed as argument */
+    SERVER_ERR_INVALID_ARGUMENT,    /**< Error: Incorrect parameter passed */
     SERVER_ERR_MALLOC_FAILURE,      /**< Error: Dynamic memory allocation failed */
     SERVER_ERR_PTHREAD_FAILURE,     /**< Error: Pthread API call failure */
     SERVER_ERR_EVENTFD_FAILURE,     /**< Error: Eventfd API call failure */
     SERVER_ERR_LLIST_FAILURE,       /**< Error: Linked List API call failure */
     SERVER_ERR_EPOLL_FAILURE,       /**< Error: Epoll API call failure */
-    SERVER_ERR_CLIENT_DISCONNECTED, /**< Error: Client abruptly disconnected */
+    SERVER_ERR_CLIENT_DISCONNECTED, /**< Error: Client abruptly disconnected (or the client handle is stale) */
+    SERVER_ERR_TABLE_FULL,          /**< Error: No room for the client in the client table */
+    SERVER_ERR_QUEUE_FULL,          /**< Error: No room for the message in the client's output queue */
+    SERVER_ERR_FRAME_TOO_LONG,      /**< Error: Incoming frame does not fit into the receive buffer (framing lost) */
     SERVER_ERR_GENERIC,             /**< Error: Generic error */
 } ServerError_t;
 
+/**
+ * @struct ServerMode_t
+ * @brief Threading model used to serve connected clients
+ */
+typedef enum {
+    SERVER_MODE_THREAD_PER_CLIENT = 0x00, /**< Dedicated worker thread (with its own epoll instance) per client */
+    SERVER_MODE_REACTOR,                  /**< All clients served by a fixed pool of epoll reactor threads */
+} ServerMode_t;
+
+/**
+ * @struct ServerTxPolicy_t
+ * @brief Handling of a slow consumer whose output queue would exceed the high-water mark
+ */
+typedef enum {
+    SERVER_TX_POLICY_DROP = 0x00, /**< Drop the new message (SERVER_ERR_QUEUE_FULL is returned) */
+    SERVER_TX_POLICY_COALESCE,    /**< Drop the oldest queued messages (not being sent yet) to make room for the new one */
+    SERVER_TX_POLICY_DISCONNECT,  /**< Drop the queue and disconnect the client */
+} ServerTxPolicy_t;
+
+/**
+ * @struct ServerFraming_t
+ * @brief Framing of the data received from a client
+ */
+typedef enum {
+    SERVER_FRAMING_LINE = 0x00,     /**< Newline-delimited lines (read with server_get_line()) */
+    SERVER_FRAMING_LENGTH_PREFIXED, /**< Frames with a SERVER_FRAME_PREFIX_SIZE length prefix (server_get_frame()) */
+} ServerFraming_t;
+
+/**
+ * @struct ServerRxBuffer_t
+ * @brief Client receive ring buffer used for framing incoming data into lines (allocated on accept)
+ */
+typedef struct {
+    size_t size;       // Capacity of the ring buffer (in bytes)
+    size_t head;       // Index of the first buffered byte
+    size_t len;        // Number of buffered bytes
+    size_t scanned;    // Number of buffered bytes already checked for the line delimiter
+    bool discard_line; // Drop incoming bytes until the next delimiter (tail of an overlong line)
+    char* data;        // Ring buffer storage (size bytes)
+    char* line;        // Scratch buffer for lines that wrap around the end of the ring (size + 1 bytes)
+} ServerRxBuffer_t;
+
 /**
  * @struct ServerClient_t
  * @brief Client context structure with socket file descriptor, eventfd fds, and thread handle
@@ -53,10 +123,75 @@ typedef enum {
 typedef struct {
     int fd;                 // Client's socket file descriptor
     int disconnect_eventfd; // Client's disconnect event file descriptor
-    pthread_t thread;       // Client's worker thread ID
-    pthread_mutex_t lock; // Client's lock for critical sections with ops on client's shared resources and I/O
+    pthread_t thread;       // Client's worker thread ID (or ID of the reactor thread serving the client)
+    uint32_t generation;    // Generation of the client table slot (tells apart clients reusing the same fd)
+    ServerRxBuffer_t* rx_buf; // Client's receive buffer (shared by all copies of the handle)
+    char ip_addr[IP_ADDRSTR_LENGTH]; // Client's IP addr (formatted on accept, empty if it could not be retrieved)
 } ServerClient_t;
 
+/**
+ * @struct ServerTxBuffer_t
+ * @brief Reference-counted message shared by the output queues of many clients (allocated with the data at once)
+ */
+typedef struct {
+    atomic_uint refs; // Number of references (queue entries and the sender), freed when it drops to zero
+    size_t len;       // Length of the message (in bytes)
+    uint8_t data[];   // Message data
+} ServerTxBuffer_t;
+
+/**
+ * @struct ServerTxEntry_t
+ * @brief Message waiting in a client's output queue
+ */
+typedef struct {
+    ServerTxBuffer_t* buf; // Shared message buffer
+    size_t offset;         // Number of bytes of the message already sent
+} ServerTxEntry_t;
+
+/**
+ * @struct ServerTxQueue_t
+ * @brief Client's output queue - ring of messages not yet accepted by the socket (protected by the client lock)
+ */
+typedef struct {
+    ServerTxEntry_t* entries; // Ring of SERVER_TX_QUEUE_LEN entries (allocated on first use, freed on disconnect)
+    uint32_t head;            // Index of the oldest entry
+    uint32_t count;           // Number of queued messages
+    size_t bytes;             // Number of queued bytes not sent yet
+    uint32_t dropped;         // Number of messages dropped by the backpressure policy
+    bool closed;              // Client is being disconnected by the backpressure policy (nothing is queued anymore)
+} ServerTxQueue_t;
+
+/**
+ * @struct ServerClientSlot_t
+ * @brief Entry of the client table (slot index == client fd)
+ */
+typedef struct {
+    ServerClient_t client;   // Handle of the client occupying the slot (valid only if in_use)
+    pthread_mutex_t lock;    // Client's lock for I/O (shared by all copies of the handle, lives as long as the table)
+    uint32_t dense_idx;      // Index of the slot in the table's dense array of used slots
+    bool in_use;             // Slot occupied by a connected client
+    ServerTxQueue_t tx;      // Client's output queue
+    int epoll_fd;            // Epoll instance of the thread serving the client (-1 until the client is registered)
+    uint64_t epoll_data;     // Data of the client socket registered in that epoll instance (epoll_data_t.u64)
+    bool epollout;           // EPOLLOUT enabled for the client socket (only while the output queue is not empty)
+    ServerFraming_t framing; // Framing used by the client (SERVER_FRAMING_LINE on accept)
+} ServerClientSlot_t;
+
+/**
+ * @struct ServerClientTable_t
+ * @brief Fixed-capacity client table indexed by client fd (O(1) insert, remove and count)
+ * @note Slot fields are modified with both the slot and the table lock taken (in this order), so they can be read
+ * with either of them
+ */
+typedef struct {
+    ServerClientSlot_t* slots;     // SERVER_CLIENT_TABLE_SIZE slots indexed by fd
+    int* dense;                    // Fds of the used slots (count entries, used for iteration)
+    uint32_t count;                // Number of connected clients
+    pthread_mutex_t lock;          // Lock protecting the table
+    ServerClient_t* snapshot;      // Copy of the clients taken by a broadcast (SERVER_CLIENT_TABLE_SIZE entries)
+    pthread_mutex_t snapshot_lock; // Lock protecting the snapshot (broadcasts are serialized)
+} ServerClientTable_t;
+
 /**
  * @struct ServerCallbackList_t
  * @brief List of callback pointers for key server events
@@ -65,9 +200,21 @@ typedef struct {
     void (*on_client_connect)(void* ctx, const ServerClient_t client);
     void (*on_data_received)(void* ctx, const ServerClient_t client);
     void (*on_client_disconnect)(void* ctx, const ServerClient_t client);
-    void (*on_server_failure)(void* ctx, const ServerError_t err);
+    void (*on_server_failure)(void* ctx, const ServerError_t err); // The calling thread exits right after (the
+                                                                   // listening thread closes its fds beforehand)
 } ServerCallbackList_t;
 
+/**
+ * @struct ServerWatch_t
+ * @brief Extra file descriptor monitored by the server listening thread (see server_watch())
+ * @note The structure is referenced by the server, so it has to stay valid (not freed or moved) while watched
+ */
+typedef struct {
+    int fd;                                               // File descriptor to be monitored for incoming data
+    void (*on_event)(void* ctx, const int fd, void* arg); // Called by the listening thread when the fd is readable
+    void* arg;                                            // User argument passed to the callback
+} ServerWatch_t;
+
 /**
  * @struct ServerConfig_t
  * @brief Include port number, list of callbacks, and max clients/requests number
@@ -78,33 +225,82 @@ typedef struct {
     ServerCallbackList_t cb_list;  // List of callbacks for network-related events
     uint16_t max_clients;          // Maximum number of connected clients
     uint16_t max_conn_requests;    // Maximum number of waiting connection requests
+    ServerMode_t mode;             // Threading model (thread-per-client by default)
+    uint16_t reactor_count; // Number of reactor threads in SERVER_MODE_REACTOR (0: one per online CPU core)
+    size_t rx_buf_size;     // Size of the per-client receive buffer (0: SERVER_DEFAULT_RX_BUF_SIZE)
+    size_t tx_high_water;   // Max number of bytes queued for a client (0: SERVER_DEFAULT_TX_HIGH_WATER)
+    ServerTxPolicy_t tx_policy; // Handling of clients exceeding tx_high_water (SERVER_TX_POLICY_DROP by default)
+    uint16_t acceptor_count; // Number of listening sockets bound to the port with SO_REUSEPORT, each one served by its
+                             // own accept thread (0 or 1: a single socket served by the listening thread)
+    bool socket_activation;  // Use the listening socket passed by systemd (LISTEN_FDS) if there is one
 } ServerConfig_t;
 
+/**
+ * @struct ServerReactor_t
+ * @brief Single epoll event loop serving a subset of clients (used only in SERVER_MODE_REACTOR)
+ */
+typedef struct {
+    struct Server* server; // Server instance this reactor belongs to
+    int epoll_fd;          // Reactor's epoll instance with client sockets and disconnect eventfds
+    int wakeup_eventfd;    // Reactor's shutdown event file descriptor
+    pthread_t thread;      // Reactor's thread ID
+} ServerReactor_t;
+
+/**
+ * @struct ServerAcceptor_t
+ * @brief Additional listening socket (bound with SO_REUSEPORT) with its own accept thread
+ */
+typedef struct {
+    struct Server* server; // Server instance this acceptor belongs to
+    int fd;                // Listening socket (-1 once closed after a failure)
+    int epoll_fd;          // Acceptor's epoll instance with the listening socket and the wakeup eventfd
+    int wakeup_eventfd;    // Acceptor's shutdown event file descriptor
+    pthread_t thread;      // Acceptor's thread ID
+} ServerAcceptor_t;
+
 /**
  * @struct Server_t
- * @brief Include configuration data, socket fd and ll with client fds.
+ * @brief Include configuration data, socket fd and the table with client handles.
  */
 typedef struct Server {
-    int32_t fd;                 // Listening socket file descriptor
+    int32_t fd;                 // Listening socket file descriptor (-1 once closed by the listening thread)
+    bool fd_inherited;          // The listening socket was passed by systemd (never closed by the server)
     ServerConfig_t cfg;         // Server config including port & callbacks
-    List_t clients_list;        // Linked list with handles for active clients
+    ServerClientTable_t clients; // Table with handles for active clients
     pthread_mutex_t lock;       // Lock for server-related critical sections
-    int shutdown_eventfd;       // Server's shutdown event file descriptor
+    int shutdown_eventfd;       // Server's shutdown event file descriptor (-1 if the listening thread is not running)
+    int listen_epoll_fd;        // Listening thread's epoll instance (-1 if the server is not running)
     pthread_t listening_thread; // Server's listening thread ID
+    bool listening;             // The listening thread has been started (and not joined yet)
+    ServerReactor_t reactors[SERVER_MAX_REACTORS]; // Reactor event loops (SERVER_MODE_REACTOR only)
+    uint16_t reactor_count;                        // Number of running reactors
+    ServerAcceptor_t acceptors[SERVER_MAX_ACCEPTORS - 1]; // Accept threads besides the listening thread
+    uint16_t acceptor_count;                              // Number of running accept threads
 } Server_t;
 
 /**
  * @brief Initialize a new Server instance
  * @param[in, out]  ctx  Pointer to the Server instance
  * @param[in]  cfg  Configuration structure
- * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARG or SERVER_ERR_PTHREAD_FAILURE otherwise
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARG, SERVER_ERR_NET_FAILURE or SERVER_ERR_PTHREAD_FAILURE otherwise
+ * @note The socket is listening as soon as this returns - connection requests wait in the backlog (up to
+ * max_conn_requests) until server_run() starts accepting them, so the clients are not refused while the rest of the
+ * application is being initialized.
+ * @note With cfg.socket_activation the listening socket passed by systemd (the first of LISTEN_FDS, see
+ * sd_listen_fds(3)) is used if there is one. It stays open across server restarts (and the restarts of the daemon
+ * when owned by a .socket unit), so the clients are queued instead of refused. Otherwise a dual-stack (IPv6 with
+ * IPv4-mapped addresses, IPv4 only if IPv6 is not available) socket is bound to cfg.port.
  */
 ServerError_t server_init(Server_t* ctx, const ServerConfig_t cfg);
 
 /**
- * @brief Start accepting new clients and create a listening thread
+ * @brief Start accepting new clients and create a listening thread (and reactor threads in SERVER_MODE_REACTOR)
+ * @note With cfg.acceptor_count > 1 additional sockets are bound to the port with SO_REUSEPORT (the kernel spreads
+ * the connections among them), each one accepted by its own thread. A socket that cannot be bound (e.g. an inherited
+ * socket without SO_REUSEPORT) is skipped. Every wakeup accepts all pending connections (up to a batch limit).
  * @param[in]  ctx  Pointer to the Server instance
  * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT / SERVER_ERR_NET_FAILURE / SERVER_ERR_PTHREAD_FAILURE otherwise
+ * @note On failure the threads started so far are stopped, so the server only needs to be deinitialized.
  */
 ServerError_t server_run(Server_t* ctx);
 
@@ -116,44 +312,150 @@ ServerError_t server_run(Server_t* ctx);
  * @param[in]  size  Size of the buffer for the data
  * @param[out]  len  Pointer to a variable where length (in bytes) will be stored
  * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_CLIENT_DISCONNECTED otherwise
- * @note This function terminates the calling thread if the client disconnected
+ * @note The calling thread keeps running when the client disconnected (in SERVER_MODE_REACTOR it serves other clients
+ * as well) - the caller only stops reading, the client is released by the thread serving it (see on_client_disconnect)
  */
 ServerError_t server_read(Server_t* ctx, ServerClient_t client, uint8_t* buf, const size_t buf_len, ssize_t* len);
 
 /**
- * @brief Send data to the client
+ * @brief Receive all pending data (that fits) from a client into its receive buffer with a single syscall
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Handle of the client from which data should be received
+ * @param[out]  len  Pointer to a variable where the number of received bytes will be stored
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_CLIENT_DISCONNECTED otherwise
+ * @note Call it only from the thread serving the client (e.g. in the data_received callback)
+ */
+ServerError_t server_receive(Server_t* ctx, ServerClient_t client, ssize_t* len);
+
+/**
+ * @brief Get the next complete line from client's receive buffer
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Handle of the client
+ * @param[out]  line  Pointer set to the NULL-terminated line (without '\n' and '\r') or NULL if no line is complete
+ * @param[out]  len  Pointer to a variable where the length of the line will be stored
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT otherwise
+ * @note The line stays valid until the next call to server_receive() or server_get_line() for the same client. A
+ * line longer than the receive buffer is returned truncated (as one line) and the rest of it is discarded.
+ */
+ServerError_t server_get_line(Server_t* ctx, ServerClient_t client, char** line, size_t* len);
+
+/**
+ * @brief Get the next complete length-prefixed frame from client's receive buffer
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Handle of the client
+ * @param[out]  frame  Pointer set to the frame body (without the length prefix) or NULL if no frame is complete
+ * @param[out]  len  Pointer to a variable where the length of the frame body will be stored
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_FRAME_TOO_LONG (the frame can never fit
+ * into the receive buffer, nothing is consumed - the client should be disconnected) otherwise
+ * @note The frame stays valid until the next call to server_receive(), server_get_line() or server_get_frame() for
+ * the same client. Call it only from the thread serving the client.
+ */
+ServerError_t server_get_frame(Server_t* ctx, ServerClient_t client, uint8_t** frame, size_t* len);
+
+/**
+ * @brief Switch the framing of the data received from the client
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Handle of the client
+ * @param[in]  framing  New framing (applies to the data that has not been consumed yet)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_CLIENT_DISCONNECTED otherwise
+ * @note Call it only from the thread serving the client (e.g. from a command handler run in data_received)
+ */
+ServerError_t server_set_framing(Server_t* ctx, ServerClient_t client, const ServerFraming_t framing);
+
+/**
+ * @brief Get the framing of the data received from the client
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Handle of the client
+ * @param[out]  framing  Pointer to a variable where the framing will be stored
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_CLIENT_DISCONNECTED otherwise
+ */
+ServerError_t server_get_framing(const Server_t* ctx, ServerClient_t client, ServerFraming_t* framing);
+
+/**
+ * @brief Send data to the client (never blocks)
  * @param[in]  ctx  Pointer to the Server instance
  * @param[in]  client  Handle of the client to which data should be sent
  * @param[in]  data  Pointer to the data to be sent
  * @param[in]  len  Length (in bytes) of the data
- * @return SERVER_ERR_OK on success, SERVER_ERR_NET_FAILURE otherwise
+ * @return SERVER_ERR_OK on success, SERVER_ERR_CLIENT_DISCONNECTED (stale handle or client disconnected by the
+ * backpressure policy), SERVER_ERR_NET_FAILURE, SERVER_ERR_MALLOC_FAILURE or SERVER_ERR_QUEUE_FULL otherwise
+ * @note The data is sent right away if nothing is queued for the client and the socket accepts it, otherwise (the
+ * rest of) it is copied into the client's output queue and sent once the socket becomes writable
  */
 ServerError_t server_write(const Server_t* ctx, ServerClient_t client, const uint8_t* data, const size_t len);
 
 /**
- * @brief Send data to all connected clients
+ * @brief Send data gathered from several parts (e.g. prefix + payload + newline) to the client (never blocks)
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Handle of the client to which data should be sent
+ * @param[in]  iov  Array of the data parts (sent one after another as a single message)
+ * @param[in]  iov_count  Number of the data parts (1 - SERVER_TX_IOV_MAX)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_INVALID_ARGUMENT or the same errors as server_write() otherwise
+ * @note The parts are sent with a single sendmsg() call - the data is copied only if (the rest of) it has to be queued
+ */
+ServerError_t server_writev(const Server_t* ctx, ServerClient_t client, const struct iovec* iov, const int iov_count);
+
+/**
+ * @brief Send data to all connected clients (never blocks on a slow client)
  * @param[in]  ctx  Pointer to the Server instance
  * @param[in]  data  Pointer to the data to be sent
  * @param[in]  len  Length (in bytes) of the data
- * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT otherwise
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT, SERVER_ERR_MALLOC_FAILURE or SERVER_ERR_QUEUE_FULL
+ * (message dropped for at least one client by the backpressure policy) otherwise
+ * @note The data is copied once and queued for all clients; the part not accepted by a socket right away is sent by
+ * the thread serving the client once the socket becomes writable
+ * @note Clients switched to SERVER_FRAMING_LENGTH_PREFIXED are skipped (the message is not a frame)
+ * @note Concurrent broadcasts are serialized, so all clients receive them in the same order
  */
 ServerError_t server_broadcast(Server_t* ctx, const uint8_t* data, size_t len);
 
 /**
- * @brief Get the char string with client's IPv4 address
+ * @brief Send data gathered from several parts to all connected clients (never blocks on a slow client)
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  iov  Array of the data parts (gathered into a single message)
+ * @param[in]  iov_count  Number of the data parts (1 - SERVER_TX_IOV_MAX)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_INVALID_ARGUMENT or the same errors as server_broadcast() otherwise
+ */
+ServerError_t server_broadcastv(Server_t* ctx, const struct iovec* iov, const int iov_count);
+
+/**
+ * @brief Get the char string with client's IP address (IPv4 clients of the dual-stack socket in the dotted form)
  * @param[in]  client  Handle of the client for which the address should be retrieved
  * @param[out]  inet_addrstr_buf  Pointer to the memory where data will be stored
  * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_NET_FAILURE otherwise
- * @note The inet_addrstr_buf buffer should be at least IPV4_ADDRSTR_LENGTH long
+ * @note The inet_addrstr_buf buffer should be at least IP_ADDRSTR_LENGTH long
+ * @note The address is captured when the client is accepted and cached in the handle (no syscalls are made)
  */
 ServerError_t server_get_client_ip(const ServerClient_t client, char* inet_addrstr_buf);
 
 /**
- * @brief Get the head of the linked list with all connected clients
+ * @brief Check if both handles refer to the same client
+ * @param[in]  a  Client handle
+ * @param[in]  b  Client handle
+ * @return true if the handles have the same fd and generation, false otherwise (e.g. a stale handle of a client which
+ * disconnected and a new client reusing its fd)
+ */
+bool server_client_equal(const ServerClient_t a, const ServerClient_t b);
+
+/**
+ * @brief Get the number of connected clients
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[out]  count  Number of connected clients
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+ServerError_t server_get_client_count(Server_t* ctx, uint32_t* count);
+
+/**
+ * @brief Get a snapshot of the handles of all connected clients
  * @param[in]  ctx  Pointer to the Server instance
- * @return Head of LL with ServerClient_t structs on success, NULL if empty or on error
+ * @param[out]  clients  Array for the client handles
+ * @param[in]  max_count  Size of the clients array
+ * @param[out]  count  Number of handles copied (at most max_count)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_PTHREAD_FAILURE otherwise
+ * @note Clients might disconnect right after the call - I/O on their (stale) handles fails safely with
+ * SERVER_ERR_CLIENT_DISCONNECTED
  */
-ListNode_t* server_get_clients(Server_t* ctx);
+ServerError_t server_get_clients(Server_t* ctx, ServerClient_t* clients, const uint32_t max_count, uint32_t* count);
 
 /**
  * @brief Disconnect a client
@@ -164,9 +466,42 @@ ListNode_t* server_get_clients(Server_t* ctx);
 ServerError_t server_disconnect(Server_t* ctx, const ServerClient_t client);
 
 /**
- * @brief Disconnect all clients and request the listening thread to exit via eventfd
+ * @brief Create a non-blocking dual-stack TCP socket listening on the port (e.g. an auxiliary endpoint served via
+ * server_watch())
+ * @param[in]  port  Port number as a string (e.g. "65003")
+ * @param[in]  backlog  Max number of pending connection requests
+ * @param[out]  fd  File descriptor of the listening socket (to be closed by the caller)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_NET_FAILURE otherwise
+ */
+ServerError_t server_open_listener(const char* port, const int backlog, int* fd);
+
+/**
+ * @brief Monitor an extra file descriptor in the server listening thread
+ * @param[in, out]  ctx  Pointer to the Server instance
+ * @param[in]  watch  Watched fd and the callback to be called (by the listening thread) whenever it is readable
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT, SERVER_ERR_GENERIC (server not running) or
+ * SERVER_ERR_EPOLL_FAILURE otherwise
+ * @note The fd is level-triggered, so the callback has to consume the data (or unwatch the fd). All watches are
+ * dropped when the server shuts down.
+ */
+ServerError_t server_watch(Server_t* ctx, ServerWatch_t* watch);
+
+/**
+ * @brief Stop monitoring a file descriptor registered with server_watch()
+ * @param[in, out]  ctx  Pointer to the Server instance
+ * @param[in]  watch  Watch passed to server_watch()
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT, SERVER_ERR_GENERIC (server not running) or
+ * SERVER_ERR_EPOLL_FAILURE otherwise
+ * @note An event fetched by the listening thread just before the call might still be delivered to the callback
+ */
+ServerError_t server_unwatch(Server_t* ctx, ServerWatch_t* watch);
+
+/**
+ * @brief Disconnect all clients, request the listening thread (and reactors) to exit via eventfd and wait for them
  * @param[in]  ctx  Address of the pointer to the Server instance
  * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_GENERIC otherwise
+ * @note MUST NOT be called from the server threads (i.e. from the server callbacks). A listening thread that has
+ * already exited after a failure (see on_server_failure) is only joined.
  */
 ServerError_t server_shutdown(Server_t* ctx);
 
@@ -11,7 +11,10 @@
 
 #include <gpiod.h>   // For: GPIO-related API
 #include <pthread.h> // For: mutex-relate API
+#include <stdbool.h> // For: bool
+#include <stddef.h>  // For: size_t
 #include <stdint.h>  // For: standard int types
+#include <time.h>    // For: struct timespec
 
 /**
  * @struct GpioError_t
@@ -24,15 +27,67 @@ typedef enum {
     GPIO_ERR_LIBGPIOD_FAILURE, /**< Error: libgpiod API operation failure */
     GPIO_ERR_INIT_FAILURE,     /**< Error: Failed to open the GPIO chip */
     GPIO_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API failure (e.g. mutex lock/unlock) */
+    GPIO_ERR_INVALID_LINE,     /**< Error: Line number outside the supported range */
+    GPIO_ERR_INVALID_ARGUMENT, /**< Error: Incorrect parameter passed (e.g. duplicated lines in a bulk operation) */
+    GPIO_ERR_LINE_BUSY,        /**< Error: Line is watched for edge events (see gpio_watch) */
+    GPIO_ERR_NOT_WATCHED,      /**< Error: Line is not watched for edge events */
+    GPIO_ERR_NO_EVENT,         /**< Error: No pending edge event on the line */
     GPIO_ERR_GENERIC,          /**< Error: Generic error */
 } GpioError_t;
 
+#define GPIO_LINE_COUNT 64      // Number of lines handled by the driver (line numbers 0 - 63)
+#define GPIO_BULK_GROUP_COUNT 4 // Number of line groups kept requested by the bulk operations at the same time
+#define GPIO_GROUP_NONE 0       // Group index of lines requested on their own (groups are numbered from 1)
+
+/**
+ * @struct GpioDirection_t
+ * @brief Direction a GPIO line is currently requested with
+ */
+typedef enum {
+    GPIO_DIR_NONE = 0x00, /**< Line not requested */
+    GPIO_DIR_INPUT,       /**< Line requested as input */
+    GPIO_DIR_OUTPUT,      /**< Line requested as output */
+    GPIO_DIR_EVENT,       /**< Line requested as input with edge events (can be read with gpio_get) */
+} GpioDirection_t;
+
+/**
+ * @struct GpioEvent_t
+ * @brief Edge event read from a watched GPIO line
+ */
+typedef struct {
+    uint8_t line;       // GPIO line number
+    bool rising;        // Rising edge if true, falling edge otherwise
+    struct timespec ts; // Kernel timestamp of the event
+} GpioEvent_t;
+
+/**
+ * @struct GpioLine_t
+ * @brief Cached handle to a requested GPIO line (kept open between gpio_set/gpio_get calls)
+ */
+typedef struct {
+    struct gpiod_line* handle; // Requested line (NULL if not requested)
+    GpioDirection_t dir;       // Direction the line is requested with
+    uint8_t group;             // Bulk group the line is requested in (GPIO_GROUP_NONE if requested on its own)
+} GpioLine_t;
+
+/**
+ * @struct GpioBulkGroup_t
+ * @brief Lines requested together with a single handle (so that they can be set or read with a single ioctl)
+ */
+typedef struct {
+    struct gpiod_line_bulk bulk; // Requested lines (in the order given by the caller)
+    GpioDirection_t dir;         // Direction the lines are requested with (GPIO_DIR_NONE if the group is free)
+} GpioBulkGroup_t;
+
 /**
  * @struct Gpio_t
- * @brief Include a ptr to the GPIO chip and mutex for protecting critical sections.
+ * @brief Include a ptr to the GPIO chip, cached line handles and mutex for protecting critical sections.
  */
 typedef struct {
     struct gpiod_chip* chip;
+    GpioLine_t lines[GPIO_LINE_COUNT];
+    GpioBulkGroup_t groups[GPIO_BULK_GROUP_COUNT];
+    uint8_t next_group; // Group to be reused when all the groups are taken (round-robin)
     pthread_mutex_t lock;
 } Gpio_t;
 
@@ -50,31 +105,95 @@ GpioError_t gpio_init(Gpio_t* ctx);
 /**
  * @brief Set the value of a specified GPIO line.
  *
- * Requests control of the line, sets it as output, and writes the desired value.
+ * Requests control of the line as output on the first use (or after the direction changed) and writes the desired
+ * value. The line stays requested afterwards, so subsequent calls only write the value.
  *
  * @param[in, out] ctx Pointer to the initialized Gpio_t context.
  * @param[in] line GPIO line number to set.
  * @param[in] state Desired output value (0 = low, 1 = high).
- * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_LIBGPIOD_FAILURE).
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_LIBGPIOD_FAILURE).
  */
 GpioError_t gpio_set(Gpio_t* ctx, const uint8_t line, const uint8_t state);
 
 /**
  * @brief Get the current value of a specified GPIO line.
  *
- * Requests control of the line, sets it as input, and reads its current value.
+ * Requests control of the line as input on the first use (or after the direction changed) and reads its current
+ * value. The line stays requested afterwards, so subsequent calls only read the value.
  *
  * @param[in, out] ctx Pointer to the initialized Gpio_t context.
  * @param[in] line GPIO line number to read.
  * @param[out] state Pointer to store the read value (0 or 1).
- * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_LIBGPIOD_FAILURE).
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_LIBGPIOD_FAILURE).
  */
 GpioError_t gpio_get(Gpio_t* ctx, const uint8_t line, uint8_t* state);
 
+/**
+ * @brief Set the values of many GPIO lines at once.
+ *
+ * Requests all the lines together as outputs on the first use (the request is kept for subsequent calls with the
+ * same list of lines) and writes all the values with a single libgpiod call.
+ *
+ * @param[in, out] ctx Pointer to the initialized Gpio_t context.
+ * @param[in] lines GPIO line numbers to set (no duplicates allowed).
+ * @param[in] values Desired output values (0 = low, 1 = high), one per line.
+ * @param[in] count Number of lines (1 - GPIO_LINE_COUNT).
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_INVALID_ARGUMENT, GPIO_ERR_LIBGPIOD_FAILURE).
+ */
+GpioError_t gpio_set_bulk(Gpio_t* ctx, const uint8_t* lines, const uint8_t* values, const size_t count);
+
+/**
+ * @brief Get the current values of many GPIO lines at once.
+ *
+ * Requests all the lines together as inputs on the first use (the request is kept for subsequent calls with the
+ * same list of lines) and reads all the values with a single libgpiod call.
+ *
+ * @param[in, out] ctx Pointer to the initialized Gpio_t context.
+ * @param[in] lines GPIO line numbers to read (no duplicates allowed).
+ * @param[out] values Read values (0 or 1), one per line.
+ * @param[in] count Number of lines (1 - GPIO_LINE_COUNT).
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_INVALID_ARGUMENT, GPIO_ERR_LIBGPIOD_FAILURE).
+ */
+GpioError_t gpio_get_bulk(Gpio_t* ctx, const uint8_t* lines, uint8_t* values, const size_t count);
+
+/**
+ * @brief Start watching a GPIO line for edge events.
+ *
+ * Requests the line as input with both rising and falling edge events. The returned fd becomes readable whenever
+ * there are pending events (use gpio_read_event() to fetch them). Watching an already watched line returns the
+ * same fd. While watched, the line can be read with gpio_get() but gpio_set() and bulk operations return
+ * GPIO_ERR_LINE_BUSY.
+ *
+ * @param[in, out] ctx Pointer to the initialized Gpio_t context.
+ * @param[in] line GPIO line number to watch.
+ * @param[out] fd Pointer to store the event file descriptor (owned by the driver).
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_LIBGPIOD_FAILURE).
+ */
+GpioError_t gpio_watch(Gpio_t* ctx, const uint8_t line, int* fd);
+
+/**
+ * @brief Stop watching a GPIO line for edge events (the line and its event fd are released).
+ *
+ * @param[in, out] ctx Pointer to the initialized Gpio_t context.
+ * @param[in] line GPIO line number.
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_NOT_WATCHED).
+ */
+GpioError_t gpio_unwatch(Gpio_t* ctx, const uint8_t line);
+
+/**
+ * @brief Read a single pending edge event from a watched GPIO line (does not block).
+ *
+ * @param[in, out] ctx Pointer to the initialized Gpio_t context.
+ * @param[in] line GPIO line number.
+ * @param[out] event Pointer to store the event.
+ * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_INVALID_LINE, GPIO_ERR_NOT_WATCHED, GPIO_ERR_NO_EVENT, GPIO_ERR_LIBGPIOD_FAILURE).
+ */
+GpioError_t gpio_read_event(Gpio_t* ctx, const uint8_t line, GpioEvent_t* event);
+
 /**
  * @brief Deinitialize the GPIO context and release resources.
  *
- * Closes the GPIO chip and destroys the associated mutex.
+ * Releases all requested lines, closes the GPIO chip and destroys the associated mutex.
  *
  * @param[in, out] ctx Pointer to the Gpio_t structure to deinitialize.
  * @return GPIO_ERR_OK on success, appropriate error code otherwise (e.g. GPIO_ERR_NULL_ARGUMENT, GPIO_ERR_NOT_INITIALIZED, GPIO_ERR_PTHREAD_FAILURE).
@@ -6,7 +6,8 @@
  *
  * @note Use hw_interface_init(), and hw_interface_deinit() to initialize and deinitialize new I2C/SPI bus
  * instance. Use: hw_interface_read() and hw_interface_write() to read and write single or multiple bytes
- * to/from specific registers in the slave device.
+ * to/from specific registers in the slave device. Use hw_interface_transfer() to perform a list of register
+ * reads/writes on the same slave device in a single bus transaction.
  */
 
 #ifndef __HW_INTERFACE_H__
@@ -25,6 +26,7 @@
 typedef enum {
     HW_INTERFACE_ERR_OK = 0x00,            /**< Operation finished successfully */
     HW_INTERFACE_ERR_NULL_ARGUMENT,        /**< Error: NULL ptr passed as argument */
+    HW_INTERFACE_ERR_INVALID_ARGUMENT,     /**< Error: Invalid argument (e.g. too many operations in a transfer) */
     HW_INTERFACE_ERR_INIT_FAILURE,         /**< Error: Interface init failure */
     HW_INTERFACE_ERR_DEINIT_FAILURE,       /**< Error: Interface deinit failure */
     HW_INTERFACE_ERR_TRANSMISSION_FAILURE, /**< Error: Linux's spidev/i2cdev interface failure */
@@ -52,6 +54,16 @@ typedef struct {
     } handle; // Handle for a specific i2c/spi instance
 } HwInterface_t;
 
+/**
+ * @struct HwInterfaceOp_t
+ * @brief Single register operation in a transfer (see I2CBusOp_t)
+ */
+typedef I2CBusOp_t HwInterfaceOp_t;
+
+#define HW_INTERFACE_OP_READ I2C_BUS_OP_READ                   // Burst read from the register
+#define HW_INTERFACE_OP_WRITE I2C_BUS_OP_WRITE                 // Write to the register
+#define HW_INTERFACE_TRANSFER_MAX_OPS I2C_BUS_TRANSFER_MAX_OPS // Max number of operations in a single transfer
+
 /**
  * @brief Initialize a new Hardware Interface instance.
  *
@@ -63,11 +75,23 @@ typedef struct {
  */
 HwInterfaceError_t hw_interface_init(HwInterface_t* ctx, const HwInterfaceType_t type);
 
+/**
+ * @brief Initialize a new SPI Hardware Interface instance with a custom configuration.
+ * @note hw_interface_init(ctx, HW_INTERFACE_SPI) uses '/dev/spidev0.0' in mode 0 at 10 MHz with native chip-select.
+ * Pass a GPIO context in the configuration to drive the chip-select lines with GPIO (the slave address of the
+ * sensors is then the CS line).
+ *
+ * @param[in, out] ctx Pointer to the HwInterface_t instance.
+ * @param[in] cfg SPI bus configuration (device, clock, mode and chip-select).
+ * @return HW_INTERFACE_ERR_OK on success, HW_INTERFACE_ERR_NULL_ARGUMENT or HW_INTERFACE_ERR_INIT_FAILURE otherwise.
+ */
+HwInterfaceError_t hw_interface_init_spi(HwInterface_t* ctx, const SPIBusConfig_t cfg);
+
 /**
  * @brief Perform a burst read from a selected register.
  *
  * @param[in, out] ctx Pointer to the HwInterface_t instance.
- * @param[in] slave_addr Address of the slave device (7 lower bits)
+ * @param[in] slave_addr Address of the slave device (7 lower bits for I2C / CS GPIO pin for SPI).
  * @param[in] reg_addr Register address to read from.
  * @param[out] buf Buffer to store the read data.
  * @param[in] len Number of bytes to read.
@@ -89,6 +113,18 @@ hw_interface_read(HwInterface_t* ctx, const uint8_t slave_addr, const uint8_t re
 HwInterfaceError_t
 hw_interface_write(HwInterface_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, const uint8_t* data, const size_t len);
 
+/**
+ * @brief Perform a list of register operations on a selected slave device in a single transaction.
+ *
+ * @param[in] ctx Pointer to the HwInterface_t instance.
+ * @param[in] slave_addr Address of the slave device (7 lower bits for I2C / CS GPIO pin for SPI).
+ * @param[in, out] ops Operations to be performed in order (the buffers of the reads are filled in).
+ * @param[in] count Number of operations (at most HW_INTERFACE_TRANSFER_MAX_OPS).
+ * @return HW_INTERFACE_ERR_OK on success, error code otherwise.
+ */
+HwInterfaceError_t
+hw_interface_transfer(HwInterface_t* ctx, const uint8_t slave_addr, const HwInterfaceOp_t* ops, const size_t count);
+
 /**
  * @brief Deinitialize the hardware interface instance and release resources.
  *
@@ -6,25 +6,36 @@
  *
  * @note Use i2c_bus_init(), and i2c_bus_deinit() to initialize and deinitialize new I2C bus instance.
  * Use: i2c_bus_read() and i2c_bus_write() to read and write single or multiple bytes to/from
- * specific registers in the slave device.
+ * specific registers in the slave device. Use i2c_bus_transfer() to send a list of register reads/writes to the same
+ * slave device as a single I2C_RDWR transaction (one syscall, one repeated-start sequence on the bus).
+ *
+ * @note The slave address set with I2C_SLAVE (only needed by the plain write() path) is cached, so the ioctl is skipped
+ * when consecutive writes target the same device. The bus instance must therefore be shared (passed by pointer) by all
+ * the devices connected to it.
  */
 
 #ifndef __I2C_BUS_H__
 #define __I2C_BUS_H__
 
-#include <stdint.h> // For: std types
-#include <stdlib.h> // For: size_t
+#include <pthread.h> // For: pthread_mutex_t
+#include <stdint.h>  // For: std types
+#include <stdlib.h>  // For: size_t
+
+#define I2C_BUS_TRANSFER_MAX_OPS 16       // Max number of register operations in a single i2c_bus_transfer() call
+#define I2C_BUS_TRANSFER_MAX_WRITE_LEN 64 // Max total number of data bytes written in a single i2c_bus_transfer() call
+#define I2C_BUS_NO_SLAVE_ADDR (-1)        // No slave address has been set on the file descriptor yet
 
 /**
  * @struct SensorError_t
  * @brief Error codes returned by sensor API functions
  */
 typedef enum {
-    I2C_BUS_ERR_OK = 0x00,       /**< Operation finished successfully */
-    I2C_BUS_ERR_NULL_ARGUMENT,   /**< Error: NULL ptr passed as argument */
-    I2C_BUS_ERR_I2CDEV_FAILURE,  /**< Error: Linux's spidev interface failure */
-    I2C_BUS_ERR_PTHREAD_FAILURE, /**< Error: Pthread API call failure */
-    I2C_BUS_ERR_GENERIC,         /**< Error: Generic error */
+    I2C_BUS_ERR_OK = 0x00,        /**< Operation finished successfully */
+    I2C_BUS_ERR_NULL_ARGUMENT,    /**< Error: NULL ptr passed as argument */
+    I2C_BUS_ERR_INVALID_ARGUMENT, /**< Error: Invalid argument (e.g. too many operations in a transfer) */
+    I2C_BUS_ERR_I2CDEV_FAILURE,   /**< Error: Linux's spidev interface failure */
+    I2C_BUS_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API call failure */
+    I2C_BUS_ERR_GENERIC,          /**< Error: Generic error */
 } I2CBusError_t;
 
 typedef struct {
@@ -35,8 +46,29 @@ typedef struct I2CBus_t {
     I2CBusConfig_t cfg;   // I2C Bus configuration
     pthread_mutex_t lock; // Lock for all read/write operations
     int fd;               // I2C interface file descriptor
+    int slave_addr;       // Slave address last set with I2C_SLAVE (I2C_BUS_NO_SLAVE_ADDR if none)
 } I2CBus_t;
 
+/**
+ * @struct I2CBusOpType_t
+ * @brief Type of a single register operation in a transfer
+ */
+typedef enum {
+    I2C_BUS_OP_READ = 0x00, /**< Burst read from the register (register address write + repeated start read) */
+    I2C_BUS_OP_WRITE,       /**< Write to the register (register address followed by the data) */
+} I2CBusOpType_t;
+
+/**
+ * @struct I2CBusOp_t
+ * @brief Single register operation in a transfer
+ */
+typedef struct {
+    I2CBusOpType_t type; // Read or write
+    uint8_t reg_addr;    // Register address to read from / write to
+    uint8_t* buf;        // Buffer to store the read data / data to write
+    size_t len;          // Number of bytes to read / write
+} I2CBusOp_t;
+
 /**
  * @brief Initialize a new I2C Bus instance.
  *
@@ -77,6 +109,21 @@ I2CBusError_t i2c_bus_read(I2CBus_t* ctx, const uint8_t slave_addr, const uint8_
 I2CBusError_t
 i2c_bus_write(I2CBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, const uint8_t* data, const size_t len);
 
+/**
+ * @brief Perform a list of register operations on a single slave device in one transaction.
+ *
+ * All operations are packed into one I2C_RDWR ioctl (a read takes two i2c_msg entries, a write one), performed in
+ * order with repeated starts in between. Nothing is sent if the list exceeds I2C_BUS_TRANSFER_MAX_OPS operations or
+ * I2C_BUS_TRANSFER_MAX_WRITE_LEN bytes written in total.
+ *
+ * @param[in] ctx Pointer to the I2CBus_t instance.
+ * @param[in] slave_addr Address of the slave device (7 lower bits)
+ * @param[in, out] ops Operations to be performed (the buffers of the reads are filled in).
+ * @param[in] count Number of operations.
+ * @return I2C_BUS_ERR_OK on success, error code otherwise.
+ */
+I2CBusError_t i2c_bus_transfer(I2CBus_t* ctx, const uint8_t slave_addr, const I2CBusOp_t* ops, const size_t count);
+
 /**
  * @brief Deinitialize the I2C Bus instance and release resources.
  *
@@ -1,8 +1,137 @@
+/**
+ * @file spi_bus.h
+ * @brief Wrapper API for master SPI communication over spidev interface
+ *
+ * @note Designed to provide thread-safe functionality (MT-Safe)
+ *
+ * @note Use spi_bus_init(), and spi_bus_deinit() to initialize and deinitialize new SPI bus instance.
+ * Use: spi_bus_read() and spi_bus_write() to read and write single or multiple bytes to/from
+ * specific registers in the slave device. Use spi_bus_transfer() to send a list of register reads/writes to the same
+ * slave device as a single SPI_IOC_MESSAGE burst (one syscall, full-duplex transfers clocked back to back).
+ *
+ * @note Register access follows the common sensor convention (e.g. BME280): the first byte sent is the register
+ * address with the MSB set for reads and cleared for writes, followed by the data clocked in/out.
+ *
+ * @note Chip-select: if a GPIO context is given in the configuration, the slave address passed to the API is the GPIO
+ * line driving the CS of the device (active low, the spidev is switched to SPI_NO_CS). Otherwise the native CS of
+ * the spidev device is used and the slave address is ignored. The CS lines should be pulled up on the board, as they
+ * are not driven until the first transfer to the device.
+ */
+
 #ifndef __SPI_BUS_H__
 #define __SPI_BUS_H__
 
+#include <pthread.h> // For: pthread_mutex_t
+#include <stdint.h>  // For: std types
+#include <stdlib.h>  // For: size_t
+
+#include "hw/gpio.h"
+#include "hw/i2c_bus.h"
+
+#define SPI_BUS_TRANSFER_MAX_OPS I2C_BUS_TRANSFER_MAX_OPS // Max number of register operations in a single transfer
+#define SPI_BUS_TRANSFER_MAX_WRITE_LEN 64 // Max total number of data bytes written in a single spi_bus_transfer() call
+#define SPI_BUS_READ_FLAG 0x80            // Register address MSB set: read access
+#define SPI_BUS_WRITE_MASK 0x7F           // Register address MSB cleared: write access
+
+/**
+ * @struct SPIBusError_t
+ * @brief Error codes returned by SPI bus API functions
+ */
+typedef enum {
+    SPI_BUS_ERR_OK = 0x00,        /**< Operation finished successfully */
+    SPI_BUS_ERR_NULL_ARGUMENT,    /**< Error: NULL ptr passed as argument */
+    SPI_BUS_ERR_INVALID_ARGUMENT, /**< Error: Invalid argument (e.g. too many operations in a transfer) */
+    SPI_BUS_ERR_SPIDEV_FAILURE,   /**< Error: Linux's spidev interface failure */
+    SPI_BUS_ERR_GPIO_FAILURE,     /**< Error: Failed to drive the chip-select line */
+    SPI_BUS_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API call failure */
+    SPI_BUS_ERR_GENERIC,          /**< Error: Generic error */
+} SPIBusError_t;
+
+typedef struct {
+    int spi_bus;       // SPI bus number (e.g. 0 for '/dev/spidev0.x')
+    int spi_cs;        // Native chip-select of the spidev device (e.g. 0 for '/dev/spidevX.0')
+    uint32_t speed_hz; // Clock frequency
+    uint8_t mode;      // SPI mode (SPI_MODE_0 - SPI_MODE_3: clock polarity and phase)
+    Gpio_t* cs_gpio;   // GPIO driving the chip-select lines (NULL: native chip-select; must outlive the bus)
+} SPIBusConfig_t;
+
 typedef struct {
-    int type;
+    SPIBusConfig_t cfg;   // SPI Bus configuration
+    pthread_mutex_t lock; // Lock for all read/write operations
+    int fd;               // SPI device file descriptor
 } SPIBus_t;
 
-#endif // __SPI_BUS_H__
\ No newline at end of file
+/**
+ * @struct SPIBusOp_t
+ * @brief Single register operation in a transfer (same layout as I2CBusOp_t, so that the operations can be passed to
+ * either bus as-is)
+ */
+typedef I2CBusOp_t SPIBusOp_t;
+
+#define SPI_BUS_OP_READ I2C_BUS_OP_READ   // Burst read from the register (register address + data clocked in)
+#define SPI_BUS_OP_WRITE I2C_BUS_OP_WRITE // Write to the register (register address followed by the data)
+
+/**
+ * @brief Initialize a new SPI Bus instance.
+ *
+ * Opens the spidev device and sets up the mode, word size and clock frequency.
+ *
+ * @param[in, out] ctx Pointer to the SPIBus_t instance.
+ * @param[in] cfg Configuration structure.
+ * @return SPI_BUS_ERR_OK on success, SPI_BUS_ERR_NULL_ARGUMENT, SPI_BUS_ERR_SPIDEV_FAILURE or
+ * SPI_BUS_ERR_PTHREAD_FAILURE otherwise.
+ */
+SPIBusError_t spi_bus_init(SPIBus_t* ctx, const SPIBusConfig_t cfg);
+
+/**
+ * @brief Perform a burst read from a specific register over SPI.
+ *
+ * @param[in] ctx Pointer to the SPIBus_t instance.
+ * @param[in] slave_addr CS GPIO line of the slave device (ignored with native chip-select)
+ * @param[in] reg_addr Register address to read from.
+ * @param[out] buf Buffer to store the read data.
+ * @param[in] len Number of bytes to read.
+ * @return SPI_BUS_ERR_OK on success, error code otherwise.
+ */
+SPIBusError_t spi_bus_read(SPIBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, uint8_t* buf, const size_t len);
+
+/**
+ * @brief Write data to a specific register over SPI.
+ *
+ * @param[in] ctx Pointer to the SPIBus_t instance.
+ * @param[in] slave_addr CS GPIO line of the slave device (ignored with native chip-select)
+ * @param[in] reg_addr Register address to write to.
+ * @param[in] data Pointer to the data to write.
+ * @param[in] len Number of bytes to write.
+ * @return SPI_BUS_ERR_OK on success, error code otherwise.
+ */
+SPIBusError_t
+spi_bus_write(SPIBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, const uint8_t* data, const size_t len);
+
+/**
+ * @brief Perform a list of register operations on a single slave device in one burst.
+ *
+ * All operations are packed into one SPI_IOC_MESSAGE (a read takes two spi_ioc_transfer entries, a write one) and
+ * the chip-select is toggled between the operations. With GPIO chip-select every operation is sent as its own
+ * SPI_IOC_MESSAGE framed by the CS line. Nothing is sent if the list exceeds SPI_BUS_TRANSFER_MAX_OPS operations or
+ * SPI_BUS_TRANSFER_MAX_WRITE_LEN written bytes.
+ *
+ * @param[in] ctx Pointer to the SPIBus_t instance.
+ * @param[in] slave_addr CS GPIO line of the slave device (ignored with native chip-select)
+ * @param[in, out] ops Operations to be performed in order (the buffers of the reads are filled in).
+ * @param[in] count Number of operations (at most SPI_BUS_TRANSFER_MAX_OPS).
+ * @return SPI_BUS_ERR_OK on success, SPI_BUS_ERR_INVALID_ARGUMENT if the operations do not fit into one burst,
+ * error code otherwise.
+ */
+SPIBusError_t spi_bus_transfer(SPIBus_t* ctx, const uint8_t slave_addr, const SPIBusOp_t* ops, const size_t count);
+
+/**
+ * @brief Deinitialize the SPI Bus instance and release resources.
+ *
+ * @param[in, out] ctx Pointer to the SPIBus_t instance.
+ * @return SPI_BUS_ERR_OK on success, SPI_BUS_ERR_NULL_ARGUMENT, SPI_BUS_ERR_SPIDEV_FAILURE or
+ * SPI_BUS_ERR_PTHREAD_FAILURE otherwise.
+ */
+SPIBusError_t spi_bus_deinit(SPIBus_t* ctx);
+
+#endif // __SPI_BUS_H__
@@ -3,16 +3,41 @@
  * @brief A simple driver for Bosh BME280 digital humidity, pressure and temperature sensor with I2C and SPI support
  * @TODO: Add mutex for sensors (two users using the same sensor at the same time)
  *
+ * @note Use bme280_sampler_start() to read the sensor once per measurement period in a background thread. The getters
+ * are then served from the cached sample as long as it is not older than the configured max age (falling back to a
+ * direct readout otherwise). Without the sampler every getter performs a full readout.
+ *
+ * @note bme280_init() resets the sensor and waits BME280_RESET_DELAY_MS for the reset to complete. To initialize
+ * several sensors with a single wait use bme280_init_start() on all of them, wait once and call bme280_init_complete()
+ * (see sensor_registry.h and BME280_DRIVER).
+ *
+ * @note bme280_get_fixed() returns the compensated values as scaled integers (no floating point math involved). The
+ * trim-dependent constants of the compensation formulas are computed once, when the trim parameters are read. Define
+ * BME280_PRESS_COMP_INT32 (utils/config.h) to use the 32-bit pressure compensation (1 Pa resolution) instead of the
+ * 64-bit one, which is expensive on 32-bit CPUs.
+ *
+ * @note Measurement profiles (SensorProfile_t) are applied with bme280_set_profile() (high-precision after init):
+ *  - high-precision: x16 oversampling on all measurements, normal mode with 20 ms standby (sampled every 20 ms)
+ *  - low-latency: x1 oversampling, normal mode with 0.5 ms standby (sampled every 10 ms)
+ *  - weather-station: x1 oversampling, forced mode - the sensor sleeps between readouts and each readout triggers
+ *    a single measurement and waits until the status register reports it as completed (no background sampling)
  */
 
 #ifndef __BME280_H__
 #define __BME280_H__
 
-#include <stdbool.h> // For: boolean type
+#include <pthread.h>   // For: pthread_t, pthread_mutex_t
+#include <stdatomic.h> // For: atomic_bool, atomic_int
+#include <stdbool.h>   // For: boolean type
+#include <stdint.h>    // For: std types
 
 #include "hw/hw_interface.h"
 #include "sensors/sensor.h"
 
+#define BME280_RESET_DELAY_MS 20 // Delay between the soft reset and the first access to the trim parameters
+
+extern const SensorDriver_t BME280_DRIVER; // Generic sensor driver of the BME280 (probes 0x76 and 0x77)
+
 /**
  * @struct Trim_t
  * @brief Trimming parameters (programmed into the devices' non-volatile memory during production)
@@ -41,25 +66,107 @@ typedef struct {
     int8_t dig_H6;
 } Trim_t;
 
+typedef int32_t Bme280_s32_t;
+typedef uint32_t Bme280_u32_t;
+typedef int64_t Bme280_s64_t;
+
+/**
+ * @struct Bme280Comp_t
+ * @brief Constant terms of the compensation formulas (derived from the trim parameters once, on init)
+ */
+typedef struct {
+    Bme280_s32_t t1;         // dig_T1
+    Bme280_s32_t t1_x2;      // dig_T1 << 1
+    Bme280_s64_t p4_sh35;    // dig_P4 << 35 (64-bit pressure compensation)
+    Bme280_s64_t p7_sh4;     // dig_P7 << 4 (64-bit pressure compensation)
+    Bme280_s32_t p4_sh16;    // dig_P4 << 16 (32-bit pressure compensation)
+    Bme280_s32_t h4_sh20_rd; // 16384 - (dig_H4 << 20) (incl. the rounding term)
+} Bme280Comp_t;
+
+/**
+ * @struct Bme280_temp_t
+ * @brief Temperature output which includes temperature in degrees Celsius (x100) as well as fine temp value (for pressure and hum calculations)
+ */
+typedef struct {
+    Bme280_s32_t deg_C; // Temperature in x100 *C [resolution: 0.01 DegC, output value of “5123” equals 51.23 *C]
+    Bme280_s32_t fine; // Fine temperature value for press and hum compensation calc
+} Bme280_temp_t;
+
+/**
+ * @struct Bme280_output_t
+ * @brief Include compensated and converted temperature, pressure and humidity
+ */
+typedef struct {
+    Bme280_s32_t t; // Temperature in deg. C with 0.01 DegC resolution (e.g. 5123/100 = 51.23 DegC.)
+    Bme280_u32_t p; // Pressure in Q24.8 format (e.g. 24674867/256 = 96386.2 Pa = 963.862 hPa)
+    Bme280_u32_t h; // Humidity in Q22.10 format (e.g. 47445/1024 = 46.333 %RH)
+} Bme280_output_t;
+
+/**
+ * @struct Bme280Sampler_t
+ * @brief Background sampler state with the last compensated sample and its timestamp
+ */
+typedef struct {
+    pthread_t thread;           // Sampling thread
+    pthread_mutex_t lock;       // Lock protecting the cached sample
+    atomic_bool running;        // Set while the sampling thread is running
+    uint32_t max_age_ms;        // Max age of a sample served from the cache (0: cache disabled)
+    bool valid;                 // Set once the first sample has been stored
+    Bme280_output_t sample;     // Last compensated measurement
+    uint64_t timestamp_us;      // CLOCK_MONOTONIC time of the last sample (in microseconds)
+    SensorSampleCb_t on_sample; // Receives every new sample (may be NULL)
+    void* on_sample_arg;        // Argument passed to on_sample
+} Bme280Sampler_t;
+
 /**
  * @struct Bme280_t
- * @brief Include sensor address, hardware interface handle, calibration data and init flag.
+ * @brief Include sensor address, hardware interface handle, calibration data, sampler and init flag.
  */
 typedef struct {
-    uint8_t addr;         // Address of the sensor (7 lower bits for I2C / CS GPIO pin for SPI)
-    HwInterface_t hw_ctx; // Hardware interface context
-    bool is_initialized;  // Initialization flag
-    Trim_t calib;         // Calibration digits
+    uint8_t addr;            // Address of the sensor (7 lower bits for I2C / CS GPIO pin for SPI)
+    HwInterface_t* hw_ctx;   // Hardware interface context (shared by all the devices on the bus)
+    bool is_initialized;     // Initialization flag
+    Trim_t calib;            // Calibration digits
+    Bme280Comp_t comp;       // Constant terms of the compensation formulas (derived from calib)
+    atomic_int profile;      // Active measurement profile (SensorProfile_t)
+    Bme280Sampler_t sampler; // Background sampler with the cached sample
 } Bme280_t;
 
 /**
  * @brief Initialize a new BME280 instance
  * @param[in, out]  ctx  Pointer to the Bme280_t instance
  * @param[in]  addr  Address of the sensor (7 lower bits for I2C / CS GPIO pin for SPI)
- * @param[in] hw_ctx Handle of the hardware interface to be used by the sensor (I2C/SPI)
+ * @param[in] hw_ctx Handle of the hardware interface to be used by the sensor (I2C/SPI); must outlive the sensor
  * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARG or SENSOR_ERR_PTHREAD_FAILURE otherwise
  */
-SensorError_t bme280_init(Bme280_t* ctx, const uint8_t addr, HwInterface_t hw_ctx);
+SensorError_t bme280_init(Bme280_t* ctx, const uint8_t addr, HwInterface_t* hw_ctx);
+
+/**
+ * @brief Check whether a BME280 sensor responds under the given address (reads the chip ID only)
+ * @param[in] hw_ctx Handle of the hardware interface to be probed
+ * @param[in] addr Address of the sensor (7 lower bits for I2C / CS GPIO pin for SPI)
+ * @return SENSOR_ERR_OK if the sensor is present, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_HW_INTERFACE_FAILURE /
+ * SENSOR_ERR_INVALID_ID otherwise
+ */
+SensorError_t bme280_probe(HwInterface_t* hw_ctx, const uint8_t addr);
+
+/**
+ * @brief First phase of the init: check the ID and trigger the soft reset (does not wait for the reset to complete)
+ * @param[in, out]  ctx  Pointer to the Bme280_t instance
+ * @param[in]  addr  Address of the sensor (7 lower bits for I2C / CS GPIO pin for SPI)
+ * @param[in] hw_ctx Handle of the hardware interface to be used by the sensor (I2C/SPI); must outlive the sensor
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARG / SENSOR_ERR_INVALID_ID / SENSOR_ERR_HW_INTERFACE_FAILURE /
+ * SENSOR_ERR_PTHREAD_FAILURE otherwise
+ */
+SensorError_t bme280_init_start(Bme280_t* ctx, const uint8_t addr, HwInterface_t* hw_ctx);
+
+/**
+ * @brief Second phase of the init: read the trim parameters and configure the measurements
+ * @note Call at least BME280_RESET_DELAY_MS after a successful bme280_init_start()
+ * @param[in, out]  ctx  Pointer to the Bme280_t instance
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARG or SENSOR_ERR_HW_INTERFACE_FAILURE otherwise
+ */
+SensorError_t bme280_init_complete(Bme280_t* ctx);
 
 /**
  * @brief Read the current temperature in degrees Celsius.
@@ -88,6 +195,60 @@ SensorError_t bme280_get_hum(Bme280_t* ctx, float* hum);
  */
 SensorError_t bme280_get_press(Bme280_t* ctx, float* press);
 
+/**
+ * @brief Read the current temperature, relative humidity and pressure at once (from a single readout).
+ *
+ * @param[in] ctx Pointer to an initialized Bme280_t instance.
+ * @param[out] temp Pointer to a float where the Celsius temperature will be saved (resolution: 0.01 *C).
+ * @param[out] hum Pointer to a float where the relative humidity will be saved.
+ * @param[out] press Pointer to a float where the pressure in Pascals will be saved.
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARG / SENSOR_ERR_NOT_INITIALIZED / SENSOR_ERR_HW_INTERFACE_FAILURE otherwise.
+ */
+SensorError_t bme280_get_all(Bme280_t* ctx, float* temp, float* hum, float* press);
+
+/**
+ * @brief Read the current temperature, relative humidity and pressure at once as scaled integers (no float math).
+ *
+ * @param[in] ctx Pointer to an initialized Bme280_t instance.
+ * @param[out] out Pointer to store the measurements (centi-*C, %RH in Q22.10 and Pa in Q24.8, see Bme280_output_t).
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARG / SENSOR_ERR_NOT_INITIALIZED / SENSOR_ERR_HW_INTERFACE_FAILURE otherwise.
+ */
+SensorError_t bme280_get_fixed(Bme280_t* ctx, Bme280_output_t* out);
+
+/**
+ * @brief Switch the measurement profile (reconfigures the oversampling, mode and standby of the sensor)
+ * @note The cached sample is dropped, so the next readout reflects the new settings
+ *
+ * @param[in, out] ctx Pointer to an initialized Bme280_t instance.
+ * @param[in] profile Measurement profile to apply
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_NOT_INITIALIZED / SENSOR_ERR_INVALID_ARGUMENT /
+ * SENSOR_ERR_HW_INTERFACE_FAILURE / SENSOR_ERR_PTHREAD_FAILURE otherwise.
+ */
+SensorError_t bme280_set_profile(Bme280_t* ctx, const SensorProfile_t profile);
+
+/**
+ * @brief Start sampling the sensor in the background (once per measurement period of the active profile)
+ *
+ * @param[in] ctx Pointer to an initialized Bme280_t instance.
+ * @param[in] max_age_ms Max age of a cached sample to be returned by the getters (must be > 0).
+ * @param[in] on_sample Callback receiving every new sample from the sampler thread (may be NULL).
+ * @param[in] arg Argument passed to on_sample.
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_NOT_INITIALIZED / SENSOR_ERR_GENERIC /
+ * SENSOR_ERR_PTHREAD_FAILURE otherwise.
+ */
+SensorError_t
+bme280_sampler_start(Bme280_t* ctx, const uint32_t max_age_ms, SensorSampleCb_t on_sample, void* arg);
+
+/**
+ * @brief Stop the background sampler (the getters read the sensor directly afterwards)
+ *
+ * @param[in] ctx Pointer to an initialized Bme280_t instance.
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_NOT_INITIALIZED /
+ * SENSOR_ERR_PTHREAD_FAILURE otherwise.
+ * @note Has no effect if the sampler is not running
+ */
+SensorError_t bme280_sampler_stop(Bme280_t* ctx);
+
 /**
  * @brief Check BME280 sensor ID
  *
@@ -98,7 +259,7 @@ SensorError_t bme280_get_press(Bme280_t* ctx, float* press);
 SensorError_t bme280_check_id(Bme280_t* ctx);
 
 /**
- * @brief Deinit Bme280_t sensor instance (zero out the structure, including the init flag)
+ * @brief Deinit Bme280_t sensor instance (stop the sampler, zero out the structure, including the init flag)
  *
  * @param[in] ctx Pointer to an initialized Bme280_t instance.
  * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT or SENSOR_ERR_NOT_INITIALIZED otherwise.
@@ -1,17 +1,38 @@
 /**
  * @file sensor.h
- * @brief Typedefs common for all sensors
+ * @brief Typedefs common for all sensors and the generic sensor driver interface
  *
+ * @note A sensor type is supported by the sensor registry (see sensor_registry.h) once it provides a SensorDriver_t.
+ * The init is split in two phases (init_start triggers the reset, init_complete reads the calibration etc.), so that
+ * the registry resets all sensors first and waits for them only once.
+ *
+ * @note Drivers may support measurement profiles (SensorProfile_t) trading the sampling latency against power draw
+ * and bus load. The profile is selected on init (SensorInfo_t.profile) and can be switched at runtime.
  */
 
 #ifndef __SENSOR_H__
 #define __SENSOR_H__
 
+#include <stdint.h> // For: std types
+#include <stdlib.h> // For: size_t
+
 #include "hw/hw_interface.h"
 
+/**
+ * @enum SensorProfile_t
+ * @brief Measurement profiles (the register settings behind each one are up to the driver)
+ */
+typedef enum {
+    SENSOR_PROFILE_HIGH_PRECISION = 0x00, /**< Max oversampling, continuous sampling (default) */
+    SENSOR_PROFILE_LOW_LATENCY,           /**< No oversampling, continuous sampling with a short standby */
+    SENSOR_PROFILE_WEATHER_STATION,       /**< No oversampling, a single measurement per readout (on demand) */
+    SENSOR_PROFILE_COUNT,                 /**< Number of profiles (not a valid profile) */
+} SensorProfile_t;
+
 typedef struct {
     uint8_t addr;              // Address of the sensor (7 lower bits for I2C / CS GPIO pin for SPI)
     HwInterfaceType_t if_type; // Hardware interface type (e.g. HW_INTERFACE_I2C or HW_INTERFACE_SPI)
+    SensorProfile_t profile;   // Measurement profile applied on init (ignored by drivers without profiles)
 } SensorInfo_t;
 
 /**
@@ -24,7 +45,99 @@ typedef enum {
     SENSOR_ERR_HW_INTERFACE_FAILURE, /**< Error: Hardware interface operation failure / sensor is not responding */
     SENSOR_ERR_INVALID_ID,           /** < Error: Sensor invalid ID */
     SENSOR_ERR_NOT_INITIALIZED,      /**< Error: Sensor not initialized yet */
+    SENSOR_ERR_PTHREAD_FAILURE,      /**< Error: Pthread API call failure */
+    SENSOR_ERR_NOT_FOUND,            /**< Error: No sensor with the given ID in the registry */
+    SENSOR_ERR_ALREADY_REGISTERED,   /**< Error: Sensor with the same address is already in the registry */
+    SENSOR_ERR_REGISTRY_FULL,        /**< Error: No free entries in the registry */
+    SENSOR_ERR_INVALID_ARGUMENT,     /**< Error: Argument outside the supported range (e.g. unknown profile) */
+    SENSOR_ERR_NOT_SUPPORTED,        /**< Error: Operation not supported by the sensor type */
+    SENSOR_ERR_TIMEOUT,              /**< Error: Sensor did not complete the measurement in time */
     SENSOR_ERR_GENERIC,              /**< Error: Generic error */
 } SensorError_t;
 
+#define SENSOR_FIELD_TEMP 0x01  // SensorReading_t.temp_cC is set
+#define SENSOR_FIELD_HUM 0x02   // SensorReading_t.hum_q10 is set
+#define SENSOR_FIELD_PRESS 0x04 // SensorReading_t.press_q8 is set
+
+#define SENSOR_HUM_FRAC_BITS 10  // Fractional bits of SensorReading_t.hum_q10
+#define SENSOR_PRESS_FRAC_BITS 8 // Fractional bits of SensorReading_t.press_q8
+#define SENSOR_CENTI_STR_SIZE 13 // Buffer size fitting any value formatted by sensor_format_centi() (incl. '\0')
+
+/**
+ * @struct SensorReading_t
+ * @brief Measurements taken from a single readout (only the fields flagged in 'fields' are valid)
+ * @note The values are scaled integers, so the readouts never go through floating point math
+ */
+typedef struct {
+    uint8_t fields;    // Bitmask of the valid fields (SENSOR_FIELD_*)
+    int32_t temp_cC;   // Temperature in hundredths of a degree Celsius (e.g. 2154 = 21.54 *C)
+    uint32_t hum_q10;  // Relative humidity in percents, Q22.10 format (e.g. 47445 / 1024 = 46.333 %RH)
+    uint32_t press_q8; // Pressure in Pascals, Q24.8 format (e.g. 24674867 / 256 = 96386.2 Pa)
+} SensorReading_t;
+
+// Callback receiving every new sample taken by a background sampler (called from the sampler thread)
+typedef void (*SensorSampleCb_t)(void* arg, const SensorReading_t* reading);
+
+/**
+ * @struct SensorDriver_t
+ * @brief Generic interface of a sensor type (all functions take the driver-specific context as the first argument)
+ */
+typedef struct {
+    const char* name;         // Name of the sensor type (e.g. "bme280")
+    const uint8_t* i2c_addrs; // I2C addresses probed on bus discovery
+    size_t i2c_addr_count;    // Number of the probed I2C addresses
+    uint32_t reset_delay_ms;  // Min delay between init_start() and init_complete()
+    // Check whether the sensor responds under the given address
+    SensorError_t (*probe)(HwInterface_t* hw_ctx, const uint8_t addr);
+    // Set up the context and trigger the reset (does not wait for the reset to complete)
+    SensorError_t (*init_start)(void* ctx, const uint8_t addr, HwInterface_t* hw_ctx);
+    // Finish the init after the reset delay
+    SensorError_t (*init_complete)(void* ctx);
+    // Take all measurements supported by the sensor from a single readout
+    SensorError_t (*read)(void* ctx, SensorReading_t* reading);
+    // Start sampling in the background, passing every sample to on_sample (optional, may be NULL; on_sample may be NULL)
+    SensorError_t (*sampler_start)(void* ctx, const uint32_t max_age_ms, SensorSampleCb_t on_sample, void* arg);
+    // Switch the measurement profile of an initialized sensor (optional, may be NULL)
+    SensorError_t (*set_profile)(void* ctx, const SensorProfile_t profile);
+    // Release the resources of an initialized sensor
+    SensorError_t (*deinit)(void* ctx);
+} SensorDriver_t;
+
+/**
+ * @brief Convert an unsigned fixed-point value to hundredths (rounded to the nearest one, 32-bit math only)
+ *
+ * @param[in] value Fixed-point value (e.g. SensorReading_t.hum_q10)
+ * @param[in] frac_bits Number of fractional bits of the value (up to 16)
+ * @return The value multiplied by 100
+ */
+uint32_t sensor_q_to_centi(const uint32_t value, const unsigned frac_bits);
+
+/**
+ * @brief Format a value given in hundredths as a decimal string with two decimal places (e.g. -512 as "-5.12")
+ * @note The digits are produced directly, without any floating point math nor snprintf()
+ *
+ * @param[out] buf Buffer to store the NULL-terminated string
+ * @param[in] size Size of the buffer (SENSOR_CENTI_STR_SIZE fits any value)
+ * @param[in] value_x100 Value multiplied by 100
+ * @return Length of the string, 0 if the buffer is too small (or NULL)
+ */
+size_t sensor_format_centi(char* buf, const size_t size, const int32_t value_x100);
+
+/**
+ * @brief Get the name of a measurement profile (as used in the sensor commands, e.g. "weather-station")
+ *
+ * @param[in] profile Measurement profile
+ * @return Name of the profile, "unknown" for values outside SensorProfile_t
+ */
+const char* sensor_profile_name(const SensorProfile_t profile);
+
+/**
+ * @brief Look up a measurement profile by its name (case insensitive)
+ *
+ * @param[in] name Name of the profile (see sensor_profile_name())
+ * @param[out] profile Pointer to store the profile
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_INVALID_ARGUMENT otherwise
+ */
+SensorError_t sensor_profile_from_name(const char* name, SensorProfile_t* profile);
+
 #endif // __SENSOR_H__
\ No newline at end of file
@@ -0,0 +1,152 @@
+/**
+ * @file sensor_history.h
+ * @brief Fixed-size in-memory time series of the measurements of a single sensor (with optional on-disk backing)
+ *
+ * @note Designed to provide thread-safe functionality (MT-Safe)
+ *
+ * @note Use sensor_history_init(), and sensor_history_deinit() to initialize and deinitialize new history instance.
+ * Use: sensor_history_append() to store a sample (typically from the background sampler, see SensorSampleCb_t) and
+ * sensor_history_query() to downsample a time window into buckets (min/avg/max per bucket).
+ *
+ * @note The samples are stored in a ring of cfg.capacity entries (the oldest are overwritten) in columns: one array
+ * with the timestamps and one array of int32 values per quantity (temp_cC, hum_q10 and press_q8 as in
+ * SensorReading_t). Queries scan only the value column of the requested quantity. Samples arriving sooner than
+ * cfg.interval_ms after the last stored one, or with an older timestamp, are dropped (the timestamps are
+ * non-decreasing, so the start of a window is found with a binary search).
+ *
+ * @note Backing file (cfg.path): every stored sample is appended to the file as a fixed-size binary record. On init
+ * the existing file is memory-mapped and its last cfg.capacity records are loaded back into the ring, so the history
+ * survives restarts. The file is compacted (rewritten with the ring content) once it holds 2 * cfg.capacity records.
+ */
+
+#ifndef __SENSOR_HISTORY_H__
+#define __SENSOR_HISTORY_H__
+
+#include <pthread.h> // For: pthread_mutex_t
+#include <stdint.h>  // For: std types
+#include <stdlib.h>  // For: size_t
+
+#include "sensors/sensor.h"
+
+#define SENSOR_HISTORY_NO_VALUE INT32_MIN // Stored in a value column if the quantity was missing in the sample
+#define SENSOR_HISTORY_PATH_MAX 256       // Max length of the backing file path (incl. the terminating char)
+
+/**
+ * @struct SensorHistoryError_t
+ * @brief Error codes returned by sensor history API functions
+ */
+typedef enum {
+    SENSOR_HISTORY_ERR_OK = 0x00,        /**< Operation finished successfully */
+    SENSOR_HISTORY_ERR_NULL_ARGUMENT,    /**< Error: NULL ptr passed as argument */
+    SENSOR_HISTORY_ERR_INVALID_ARGUMENT, /**< Error: Invalid argument (e.g. too many buckets in a query) */
+    SENSOR_HISTORY_ERR_DROPPED,          /**< Error: Sample dropped (too soon after the last one or out of order) */
+    SENSOR_HISTORY_ERR_MALLOC_FAILURE,   /**< Error: Dynamic memory allocation failed */
+    SENSOR_HISTORY_ERR_FILE_FAILURE,     /**< Error: Backing file operation failure */
+    SENSOR_HISTORY_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API call failure */
+    SENSOR_HISTORY_ERR_GENERIC,          /**< Error: Generic error */
+} SensorHistoryError_t;
+
+/**
+ * @struct SensorHistoryQty_t
+ * @brief Quantities stored in the history (one value column each)
+ */
+typedef enum {
+    SENSOR_HISTORY_TEMP = 0x00, /**< SensorReading_t.temp_cC */
+    SENSOR_HISTORY_HUM,         /**< SensorReading_t.hum_q10 */
+    SENSOR_HISTORY_PRESS,       /**< SensorReading_t.press_q8 */
+    SENSOR_HISTORY_QTY_COUNT,   /**< Number of the quantities */
+} SensorHistoryQty_t;
+
+typedef struct {
+    uint32_t capacity;    // Number of samples kept in memory (the oldest are overwritten)
+    uint32_t interval_ms; // Min time between two stored samples (0: store all samples)
+    const char* path;     // Backing file (NULL: in-memory only; copied on init)
+} SensorHistoryConfig_t;
+
+typedef struct {
+    SensorHistoryConfig_t cfg;                 // History configuration (cfg.path points to path below)
+    int64_t* ts_ms;                            // Timestamp column (CLOCK_REALTIME in ms, cfg.capacity entries)
+    int32_t* values[SENSOR_HISTORY_QTY_COUNT]; // Value columns (same indexes as ts_ms)
+    uint32_t head;                             // Index of the oldest sample
+    uint32_t count;                            // Number of stored samples
+    int fd;                                    // Backing file descriptor (-1 if in-memory only)
+    uint32_t file_records;                     // Number of records in the backing file
+    char path[SENSOR_HISTORY_PATH_MAX];        // Path of the backing file
+    pthread_mutex_t lock;                      // Lock for the ring and the backing file
+} SensorHistory_t;
+
+/**
+ * @struct SensorHistoryBucket_t
+ * @brief Aggregate of the samples within a single bucket of a query
+ */
+typedef struct {
+    int64_t start_ms; // Start of the bucket (CLOCK_REALTIME in ms)
+    uint32_t count;   // Number of samples in the bucket (min/avg/max are not valid if 0)
+    int32_t min;      // Min value
+    int32_t avg;      // Average value (truncated towards zero)
+    int32_t max;      // Max value
+    int64_t sum;      // Sum of the values (used to compute the average)
+} SensorHistoryBucket_t;
+
+/**
+ * @brief Initialize a new history (and load the samples stored in the backing file, if any)
+ *
+ * @param[in, out] ctx Pointer to the SensorHistory_t instance
+ * @param[in] cfg Configuration structure
+ * @return SENSOR_HISTORY_ERR_OK on success, SENSOR_HISTORY_ERR_NULL_ARGUMENT / SENSOR_HISTORY_ERR_INVALID_ARGUMENT /
+ * SENSOR_HISTORY_ERR_MALLOC_FAILURE / SENSOR_HISTORY_ERR_FILE_FAILURE / SENSOR_HISTORY_ERR_PTHREAD_FAILURE otherwise
+ */
+SensorHistoryError_t sensor_history_init(SensorHistory_t* ctx, const SensorHistoryConfig_t cfg);
+
+/**
+ * @brief Store a sample (and append it to the backing file)
+ *
+ * @param[in, out] ctx Pointer to the SensorHistory_t instance
+ * @param[in] ts_ms Timestamp of the sample (CLOCK_REALTIME in ms)
+ * @param[in] reading Measurements (quantities missing in reading->fields are stored as SENSOR_HISTORY_NO_VALUE)
+ * @return SENSOR_HISTORY_ERR_OK on success, SENSOR_HISTORY_ERR_NULL_ARGUMENT / SENSOR_HISTORY_ERR_DROPPED /
+ * SENSOR_HISTORY_ERR_FILE_FAILURE (the sample is kept in memory) / SENSOR_HISTORY_ERR_PTHREAD_FAILURE otherwise
+ */
+SensorHistoryError_t sensor_history_append(SensorHistory_t* ctx, const int64_t ts_ms, const SensorReading_t* reading);
+
+/**
+ * @brief Downsample the samples of a quantity within [from_ms, to_ms) into buckets of bucket_ms
+ * @note Bucket i covers [from_ms + i * bucket_ms, from_ms + (i + 1) * bucket_ms); empty buckets have count 0
+ *
+ * @param[in] ctx Pointer to the SensorHistory_t instance
+ * @param[in] qty Quantity to be aggregated
+ * @param[in] from_ms Start of the window (CLOCK_REALTIME in ms, inclusive)
+ * @param[in] to_ms End of the window (CLOCK_REALTIME in ms, exclusive)
+ * @param[in] bucket_ms Length of a bucket (> 0)
+ * @param[out] buckets Array to store the buckets
+ * @param[in] max_buckets Size of the buckets array
+ * @param[out] count Pointer to store the number of buckets (incl. the empty ones)
+ * @return SENSOR_HISTORY_ERR_OK on success, SENSOR_HISTORY_ERR_NULL_ARGUMENT / SENSOR_HISTORY_ERR_INVALID_ARGUMENT
+ * (e.g. empty window or more than max_buckets buckets) / SENSOR_HISTORY_ERR_PTHREAD_FAILURE otherwise
+ */
+SensorHistoryError_t sensor_history_query(SensorHistory_t* ctx,
+const SensorHistoryQty_t qty,
+const int64_t from_ms,
+const int64_t to_ms,
+const uint32_t bucket_ms,
+SensorHistoryBucket_t* buckets,
+const size_t max_buckets,
+size_t* count);
+
+/**
+ * @brief Get the number of stored samples
+ *
+ * @param[in] ctx Pointer to the SensorHistory_t instance
+ * @return Number of samples in the ring (0 if ctx is NULL)
+ */
+uint32_t sensor_history_count(SensorHistory_t* ctx);
+
+/**
+ * @brief Deinitialize the history (close the backing file and free the ring)
+ *
+ * @param[in, out] ctx Pointer to the SensorHistory_t instance
+ * @return SENSOR_HISTORY_ERR_OK on success, SENSOR_HISTORY_ERR_NULL_ARGUMENT / SENSOR_HISTORY_ERR_FILE_FAILURE otherwise
+ */
+SensorHistoryError_t sensor_history_deinit(SensorHistory_t* ctx);
+
+#endif // __SENSOR_HISTORY_H__
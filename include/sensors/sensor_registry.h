@@ -0,0 +1,176 @@
+/**
+ * @file sensor_registry.h
+ * @brief Runtime registry of the sensors connected to the board (configured and discovered on the buses)
+ *
+ * @note Use sensor_registry_init() to set up an empty registry, then sensor_registry_add() for the sensors listed in
+ * sensors_config.h and sensor_registry_discover() to probe the well-known addresses of a sensor type on a bus.
+ * sensor_registry_init_all() initializes all registered sensors with a single reset delay: the resets of all
+ * sensors are triggered first, the registry waits once (the longest reset delay of the drivers) and only then
+ * completes the init of each sensor. Sensors are identified by their index in the registry (the order of adding).
+ *
+ * @note Multithreading: The registry is built and initialized by a single thread. Afterwards it is read only (except
+ * for the atomic profile of the sensors), so sensor_registry_get(), sensor_registry_read() and
+ * sensor_registry_set_profile() may be called from any thread (the drivers are MT-Safe).
+ */
+
+#ifndef __SENSOR_REGISTRY_H__
+#define __SENSOR_REGISTRY_H__
+
+#include <stdatomic.h> // For: atomic_int
+#include <stdbool.h>   // For: bool
+#include <stdint.h>    // For: std types
+#include <stdlib.h>    // For: size_t
+
+#include "hw/hw_interface.h"
+#include "sensors/bme280.h"
+#include "sensors/sensor.h"
+
+#define SENSOR_REGISTRY_MAX_SENSORS 16 // Max number of sensors in the registry (all types, all buses)
+
+/**
+ * @struct SensorDevice_t
+ * @brief Storage for the driver-specific context of any supported sensor type
+ */
+typedef union {
+    Bme280_t bme280;
+} SensorDevice_t;
+
+/**
+ * @struct Sensor_t
+ * @brief Registry entry: sensor type, location on the bus and the driver-specific context
+ */
+typedef struct {
+    const SensorDriver_t* driver; // Driver of the sensor type
+    SensorInfo_t info;            // Address of the sensor and the type of its hardware interface
+    HwInterface_t* hw_ctx;        // Bus the sensor is connected to (shared with the other sensors on the bus)
+    bool discovered;              // Added by bus discovery (not listed in the configuration)
+    bool is_initialized;          // Set once both init phases have succeeded
+    atomic_int profile;           // Active measurement profile (SensorProfile_t; switched at runtime)
+    SensorSampleCb_t on_sample;   // Receives the samples of the background sampler (may be NULL)
+    void* on_sample_arg;          // Argument passed to on_sample
+    SensorDevice_t dev;           // Driver-specific context
+} Sensor_t;
+
+/**
+ * @struct SensorRegistry_t
+ * @brief Fixed-capacity table of the registered sensors
+ */
+typedef struct {
+    Sensor_t sensors[SENSOR_REGISTRY_MAX_SENSORS]; // Registered sensors (the index is the sensor ID)
+    size_t count;                                  // Number of registered sensors
+} SensorRegistry_t;
+
+/**
+ * @brief Initialize an empty sensor registry
+ * @param[out] ctx Pointer to the SensorRegistry_t instance
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT otherwise
+ */
+SensorError_t sensor_registry_init(SensorRegistry_t* ctx);
+
+/**
+ * @brief Add a sensor to the registry (the sensor is initialized later by sensor_registry_init_all())
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] driver Driver of the sensor type
+ * @param[in] info Address of the sensor and the type of its hardware interface
+ * @param[in] hw_ctx Bus the sensor is connected to (must outlive the registry)
+ * @param[out] id Pointer to store the ID of the new sensor (may be NULL)
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_ALREADY_REGISTERED /
+ * SENSOR_ERR_REGISTRY_FULL otherwise
+ */
+SensorError_t sensor_registry_add(SensorRegistry_t* ctx,
+const SensorDriver_t* driver,
+const SensorInfo_t info,
+HwInterface_t* hw_ctx,
+size_t* id);
+
+/**
+ * @brief Probe the well-known I2C addresses of a sensor type on a bus and add the responding sensors
+ * @note Addresses already registered on the same bus are not probed
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] driver Driver of the sensor type (provides the addresses and the probe function)
+ * @param[in] hw_ctx An initialized I2C bus (must outlive the registry)
+ * @param[out] found Pointer to store the number of added sensors (may be NULL)
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_REGISTRY_FULL otherwise
+ */
+SensorError_t
+sensor_registry_discover(SensorRegistry_t* ctx, const SensorDriver_t* driver, HwInterface_t* hw_ctx, size_t* found);
+
+/**
+ * @brief Initialize all registered sensors with a single reset delay
+ * @note Sensors failing to initialize stay in the registry (keeping the IDs stable) and report
+ * SENSOR_ERR_NOT_INITIALIZED on reads
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @note The profiles listed in SensorInfo_t are applied right after the init (a failure leaves the sensor initialized
+ * with the driver's default profile)
+ *
+ * @param[out] initialized Pointer to store the number of initialized sensors (may be NULL)
+ * @return SENSOR_ERR_OK if all sensors have been initialized, SENSOR_ERR_NULL_ARGUMENT or the error of the (first)
+ * failing sensor otherwise
+ */
+SensorError_t sensor_registry_init_all(SensorRegistry_t* ctx, size_t* initialized);
+
+/**
+ * @brief Set the callback receiving every sample taken by the background sampler of a sensor
+ * @note Takes effect on sensor_registry_start_samplers() (must not be called while the samplers are running)
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] id ID of the sensor
+ * @param[in] on_sample Callback called from the sampler thread (NULL to disable)
+ * @param[in] arg Argument passed to on_sample
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_NOT_FOUND otherwise
+ */
+SensorError_t
+sensor_registry_set_sample_cb(SensorRegistry_t* ctx, const size_t id, SensorSampleCb_t on_sample, void* arg);
+
+/**
+ * @brief Start the background samplers of all initialized sensors (for drivers that support one)
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] max_age_ms Max age of a cached sample served by the drivers
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT or the error of the (first) failing sampler otherwise
+ */
+SensorError_t sensor_registry_start_samplers(SensorRegistry_t* ctx, const uint32_t max_age_ms);
+
+/**
+ * @brief Get a registered sensor
+ *
+ * @param[in] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] id ID of the sensor
+ * @return Pointer to the registry entry, NULL if there is no such sensor
+ */
+const Sensor_t* sensor_registry_get(const SensorRegistry_t* ctx, const size_t id);
+
+/**
+ * @brief Take all measurements supported by a sensor from a single readout
+ *
+ * @param[in] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] id ID of the sensor
+ * @param[out] reading Pointer to store the measurements
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_NOT_FOUND / SENSOR_ERR_NOT_INITIALIZED or the
+ * driver's error otherwise
+ */
+SensorError_t sensor_registry_read(SensorRegistry_t* ctx, const size_t id, SensorReading_t* reading);
+
+/**
+ * @brief Switch the measurement profile of a sensor
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] id ID of the sensor
+ * @param[in] profile Measurement profile to apply
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT / SENSOR_ERR_INVALID_ARGUMENT / SENSOR_ERR_NOT_FOUND /
+ * SENSOR_ERR_NOT_INITIALIZED / SENSOR_ERR_NOT_SUPPORTED or the driver's error otherwise
+ */
+SensorError_t sensor_registry_set_profile(SensorRegistry_t* ctx, const size_t id, const SensorProfile_t profile);
+
+/**
+ * @brief Deinitialize all sensors and clear the registry
+ *
+ * @param[in, out] ctx Pointer to the SensorRegistry_t instance
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_NULL_ARGUMENT or the error of the (first) failing driver otherwise
+ */
+SensorError_t sensor_registry_deinit(SensorRegistry_t* ctx);
+
+#endif // __SENSOR_REGISTRY_H__
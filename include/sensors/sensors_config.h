@@ -12,7 +12,7 @@
 #define BME280_COUNT 1
 
 static const SensorInfo_t SENSORS_CONFIG_BME280[BME280_COUNT] = {
-    { .addr = 0x76, .if_type = HW_INTERFACE_I2C }
+    { .addr = 0x76, .if_type = HW_INTERFACE_I2C, .profile = SENSOR_PROFILE_HIGH_PRECISION }
     // Add more bme280 sensors here
 };
 
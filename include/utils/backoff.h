@@ -0,0 +1,59 @@
+/**
+ * @file backoff.h
+ * @brief Exponential backoff of the retries of a failing operation (e.g. the restart of a subsystem)
+ *
+ * @note Each failure doubles the delay before the next attempt (from min_ms up to max_ms). A failure reported once
+ * the operation has been running for at least stable_ms since the previous failure starts from min_ms again, so a
+ * single crash after a long uptime is retried right away while a crash loop is slowed down.
+ *
+ * @note Not thread-safe - a backoff state is meant to be used by a single thread (the one retrying the operation)
+ */
+
+#ifndef __BACKOFF_H__
+#define __BACKOFF_H__
+
+#include <stdbool.h> // For: bool
+#include <stdint.h>  // For: std types
+
+/**
+ * @struct BackoffError_t
+ * @brief Error codes returned by backoff functions
+ */
+typedef enum {
+    BACKOFF_ERR_OK = 0x00,     /**< Operation finished successfully */
+    BACKOFF_ERR_NULL_ARGUMENT, /**< Error: NULL pointer passed as argument */
+    BACKOFF_ERR_INVALID_ARG,   /**< Error: Incorrect parameter passed */
+} BackoffError_t;
+
+/**
+ * @struct Backoff_t
+ * @brief Backoff configuration and state
+ */
+typedef struct {
+    uint32_t min_ms;         // Delay after the first failure
+    uint32_t max_ms;         // Upper bound of the delay
+    uint32_t stable_ms;      // Time without failures after which the delay is reset to min_ms
+    uint32_t next_ms;        // Delay to be returned for the next failure
+    bool failed;             // At least one failure was reported
+    int64_t last_failure_ms; // Time of the last failure (CLOCK_MONOTONIC)
+} Backoff_t;
+
+/**
+ * @brief Initialize the backoff state
+ * @param[out]  ctx  Pointer to the backoff state
+ * @param[in]  min_ms  Delay after the first failure (at least 1)
+ * @param[in]  max_ms  Upper bound of the delay (at least min_ms)
+ * @param[in]  stable_ms  Time without failures after which the delay is reset to min_ms
+ * @return BACKOFF_ERR_OK on success, BACKOFF_ERR_NULL_ARGUMENT or BACKOFF_ERR_INVALID_ARG otherwise
+ */
+BackoffError_t backoff_init(Backoff_t* ctx, const uint32_t min_ms, const uint32_t max_ms, const uint32_t stable_ms);
+
+/**
+ * @brief Report a failure and get the delay before the next attempt
+ * @param[in, out]  ctx  Pointer to the backoff state
+ * @param[in]  now_ms  Current time (CLOCK_MONOTONIC)
+ * @return Delay before the next attempt in ms (0 if ctx is NULL)
+ */
+uint32_t backoff_next(Backoff_t* ctx, const int64_t now_ms);
+
+#endif // __BACKOFF_H__
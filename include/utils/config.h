@@ -16,21 +16,70 @@
 // Board config
 #define PIHUB_I2C_ADAPTER 1        // On RPI the I2C adapter is mounted as '/dev/i2c-1'
 #define NET_INTERFACE_NAME "wlan0" // Name of the network interface
-#define BME280_COUNT 1             // Number of connected BME280 sensors
+#define APP_SENSOR_DISCOVERY       // Probe the well-known sensor addresses on the i2c bus (besides sensors_config.h)
+#define PIHUB_SPI_BUS 0             // SPI bus of the sensors configured with HW_INTERFACE_SPI ('/dev/spidev0.x')
+#define PIHUB_SPI_CS 0              // Native chip-select of the spidev device ('/dev/spidevX.0')
+#define PIHUB_SPI_SPEED_HZ 10000000 // SPI clock (BME280 supports up to 10 MHz)
+#define PIHUB_SPI_MODE 0            // SPI mode (clock polarity and phase; BME280 supports modes 0 and 3)
+// #define PIHUB_SPI_GPIO_CS        // Drive the chip-select lines with GPIO (the addr of SPI sensors is the CS line)
 
 // Board-independent PiHub config
+#define APP_LOG_MODE LOG_MODE_ASYNC // Logging mode (LOG_MODE_SYNC or LOG_MODE_ASYNC: lines written by a writer thread)
+#define APP_LOG_FILTER_ENV "PIHUB_LOG" // Env variable with the runtime log filter (e.g. PIHUB_LOG=info,network=debug)
+
 #define APP_SERVER_PORT "65002" // Port number (as a string) under which the PiHub server should be accessible
 #define APP_SERVER_MAX_CLIENTS 25         // Maximum number of clients connected at the same time
 #define APP_SERVER_MAX_CONN_REQUESTS 10   // Maximum number of pending connection reuqests
-#define APP_SERVER_RECV_DATA_BUF_SIZE 128 // Size of the buffer for new data from the clients
+#define APP_SERVER_RECV_DATA_BUF_SIZE 1024 // Size of the per-client receive buffer (max length of a command line)
+#define APP_SERVER_MODE SERVER_MODE_REACTOR // Threading model (SERVER_MODE_REACTOR or SERVER_MODE_THREAD_PER_CLIENT)
+#define APP_SERVER_REACTOR_COUNT 0          // Number of reactor threads (0: one per online CPU core)
+#define APP_SERVER_TX_HIGH_WATER 65536       // Max number of bytes queued for a slow client
+#define APP_SERVER_TX_POLICY SERVER_TX_POLICY_COALESCE // Slow client handling (DROP, COALESCE or DISCONNECT)
+#define APP_SERVER_ACCEPTORS 2            // Number of SO_REUSEPORT listening sockets with own accept threads (1: single)
+#define APP_SERVER_SOCKET_ACTIVATION true // Use the listening socket passed by systemd (pihub.socket) if there is one
+#define APP_RESTART_BACKOFF_MIN_MS 100   // Delay before the restart of the failed network subsystem (first failure)
+#define APP_RESTART_BACKOFF_MAX_MS 30000 // Max delay before the restart (doubled with every failure in a row)
+#define APP_RESTART_STABLE_MS 60000      // Time without failures after which the delay starts from the min again
+#define APP_MAIN_LOOP_TICK_MS 100        // Period of the main loop (signals, restarts and systemd watchdog pings)
+
+#define APP_DISPATCHER_DELIM " "     // Delimiter in commands handled by the dispatcher
+#define APP_DISPATCHER_WORKERS 2     // Number of workers running the slow (offloaded) command handlers
+#define APP_DISPATCHER_QUEUE_LEN 32  // Max number of offloaded commands waiting for a worker
+
+#define APP_METRICS_PORT "65003" // Port of the Prometheus metrics endpoint (undefined: no endpoint, `server metrics` only)
+#define APP_METRICS_MAX_CONN_REQUESTS 4 // Maximum number of pending metrics endpoint connections
+#define APP_METRICS_MAX_SCRAPES 1 // Max scrapes queued or served by the dispatcher workers (< APP_DISPATCHER_WORKERS)
+#define APP_METRICS_HTTP_TIMEOUT_MS 1000 // Max time a metrics endpoint connection may take to send its request or read the reply
+#define APP_METRICS_HTTP_BUF_SIZE 131072 // Size of the Prometheus exposition buffer (allocated per scrape)
+#define APP_METRICS_MSG_BUF_SIZE 8192    // Size of the `server metrics` response buffer
+
+#define APP_GPIO_WATCH_MAX_CLIENTS 8 // Max number of clients watching a single GPIO line for edge events
+
+#define APP_BME280_MAX_AGE_MS 50 // Max age of a cached BME280 sample (older ones trigger a direct readout)
+// #define BME280_PRESS_COMP_INT32 // Compensate the pressure with 32-bit math (1 Pa resolution, faster on 32-bit CPUs)
+
+#define APP_SYSSTAT_TTL_MS 250                // Max age of cached /proc stats served to `server` commands (0: no cache)
+#define APP_SYSSTAT_COLLECT_INTERVAL_MS 1000  // Sampling interval of the background stats collector
+#define APP_SYSSTAT_RATE_SHORT_WINDOW_MS 10000 // Short window of the rates returned by `server rates`
+#define APP_SYSSTAT_RATE_LONG_WINDOW_MS 60000  // Long window of the rates returned by `server rates`
+
+#define APP_SUBSCRIBE_MIN_PERIOD_MS 20       // Min sampling period of a sensor subscription
+#define APP_SUBSCRIBE_MAX_PERIOD_MS 86400000 // Max sampling period of a sensor subscription (24 h)
+#define APP_SUBSCRIBE_MAX_COUNT (APP_SERVER_MAX_CLIENTS * SENSOR_REGISTRY_MAX_SENSORS) // Max number of subscriptions
 
-#define APP_DISPATCHER_DELIM " " // Delimiter in commands handled by the dispatcher
+#define APP_HISTORY_CAPACITY 86400       // Number of samples kept in the history of each sensor (24 h at 1 Hz)
+#define APP_HISTORY_INTERVAL_MS 1000     // Min time between two samples stored in the history
+#define APP_HISTORY_MAX_BUCKETS 720      // Max number of buckets returned by `sensor history`
+#define APP_HISTORY_MAX_WINDOW_S 2592000 // Max window (and bucket) length of `sensor history` (30 days)
+#define APP_HISTORY_MSG_BUF_SIZE (APP_HISTORY_MAX_BUCKETS * 48) // Size of the `sensor history` response buffer
+// #define APP_HISTORY_DIR "/var/lib/pihub" // Directory of the history files (undefined: in-memory history only)
 
 #define APP_PIHUB_INFO_MSG "> "
 #define APP_PIHUB_ERROR_MSG "> err: "
 #define APP_PIHUB_PROMPT_CHAR "$ "
 
 #define APP_TEMP_MSG_BUF_SIZE 2048 // Size of the generic temp buffer for building message strings
+#define APP_HELP_MSG_BUF_SIZE 8192 // Size of the buffer for the help/man message (rendered once on init)
 #define APP_DISCONNECT_MSG "one of the clients disconnected from the server" // Msg broadcasted on disconnect
 #define APP_CONNECT_MSG " connected to the server" // Msg broadcasted on new connection
 #define APP_WELCOME_MSG \
@@ -39,9 +88,13 @@
 #define APP_GENERIC_FAILURE_MSG "generic system failure, please try again"
 #define APP_CMD_INCOMPLETE_MSG "command incomplete (hint: type `server help` for syntax manual)"
 #define APP_CMD_ERR_MSG "command not found (hint: type `server help` for available commands)"
+#define APP_SERVER_BUSY_MSG "server busy, please try again"
 
 #define APP_HUM_STRING "hum"     // String argument for reading the humidity
 #define APP_PRESS_STRING "press" // String argument for reading the pressure
 #define APP_TEMP_STRING "temp"   // String argument for reading the temperature
+#define APP_ALL_STRING "all"     // String argument for reading all measurements at once
+#define APP_PROTO_BIN_STRING "bin"   // String argument for switching to the binary protocol
+#define APP_PROTO_TEXT_STRING "text" // String argument for staying with the text protocol
 
 #endif // __CONFIG_H__
\ No newline at end of file
@@ -2,14 +2,20 @@
  * @file list.h
  * @brief A simple generic singly-linked list
  *
- * @note Designed to provide thread-safe functionality (MT-Safe)
+ * @note Designed to provide thread-safe functionality (MT-Safe). The list is protected by a reader-writer lock:
+ * get_head, get_tail, get_length and the foreach iterator take it for reading (and can run in parallel), while
+ * push, remove, traverse (func may modify data) and deinit take it for writing.
  *
+ * @note Each node is stored together with its data in a single allocation. By default nodes are allocated on the
+ * heap; use llist_init_with_allocator() to plug in a custom allocator, or llist_pool_init() to give the list a
+ * fixed-size node pool that takes all allocations off the allocator once the pool is created.
  */
 
 #ifndef __LIST_H__
 #define __LIST_H__
 
-#include <pthread.h> // For: pthread_mutex_t
+#include <pthread.h> // For: pthread_rwlock_t
+#include <stdbool.h> // For: bool
 #include <stdint.h>  // For: std types
 #include <stdlib.h>  // For: size_t
 
@@ -29,14 +35,50 @@ typedef struct ListNode {
     struct ListNode* next;
 } ListNode_t;
 
+/**
+ * @struct ListAllocator_t
+ * @brief Allocator hook used for nodes (each allocation holds a ListNode_t followed by the node data)
+ */
+typedef struct {
+    void* (*alloc)(void* arg, size_t size); // Allocate size bytes (NULL on failure)
+    void (*free)(void* arg, void* ptr);     // Release memory returned by alloc
+    void* arg;                              // User argument passed to alloc and free
+} ListAllocator_t;
+
+/**
+ * @struct ListPool_t
+ * @brief Fixed-size node pool of a single list (a slab with a free list, protected by the list's write lock)
+ * @note Requests which do not fit in a pool entry or which come when the pool is exhausted are served by the list
+ * allocator
+ */
+typedef struct {
+    uint8_t* slab;     // Memory for all entries (capacity * entry_size bytes, NULL if the list has no pool)
+    size_t entry_size; // Size of a single entry (node + max data size, aligned)
+    size_t capacity;   // Number of entries
+    size_t free_count; // Number of free entries
+    void* free_list;   // First free entry (free entries are linked through their first bytes)
+    size_t heap_count; // Number of allocations served by the allocator so far (pool exhausted or data too large)
+} ListPool_t;
+
+/**
+ * @struct ListIter_t
+ * @brief Read-only iterator over a list (see foreach_begin)
+ */
+typedef struct {
+    ListNode_t* next; // Next node to visit
+    bool locked;      // True while the read lock is held by this iterator
+} ListIter_t;
+
 /**
  * @brief Linked List structure
- * Include the ptr to ll head, ptr to compare function, mutex for protecting read/write operations, and pointers to member functions.
+ * Include the ptr to ll head, ptr to compare function, rwlock for protecting read/write operations, and pointers to member functions.
  */
 typedef struct List {
     ListNode_t* head;     // First node in the ll
-    pthread_mutex_t lock; // Mutex for protecting critical sections that read/write to the ll
+    pthread_rwlock_t lock; // Reader-writer lock for protecting critical sections that read/write to the ll
     int (*compare_data)(const void*, const void*); // Function for comparing data in nodes
+    ListAllocator_t allocator;                     // Allocator used for nodes (heap by default)
+    ListPool_t pool;                               // Node pool (empty unless created with llist_pool_init())
 
     /**
      * @brief Add a new node with containing 'data' at the end of the list
@@ -85,6 +127,32 @@ typedef struct List {
      */
     ListError_t (*traverse)(struct List* ctx, ListError_t (*func)(void* data));
 
+    /**
+     * @brief Start iterating over the nodes, the list is read-locked until foreach_end is called
+     * @param[in]  ctx  Pointer to the Linked List instance
+     * @param[out]  it  Pointer to the iterator
+     * @return LIST_ERR_OK on success, LIST_ERR_NULL_ARGUMENT or LIST_ERR_PTHREAD_FAILURE otherwise
+     * @note Many readers can iterate at the same time. The iterating thread must not modify the list (push/remove
+     * would deadlock) and has to call foreach_end on every path, including early exits from the loop
+     */
+    ListError_t (*foreach_begin)(struct List* ctx, ListIter_t* it);
+
+    /**
+     * @brief Get the data of the next node
+     * @param[in]  ctx  Pointer to the Linked List instance
+     * @param[in, out]  it  Pointer to the iterator initialized by foreach_begin
+     * @return Pointer to the data of the next node, NULL at the end of the list
+     */
+    const void* (*foreach_next)(struct List* ctx, ListIter_t* it);
+
+    /**
+     * @brief Finish iterating and release the read lock (safe to call more than once)
+     * @param[in]  ctx  Pointer to the Linked List instance
+     * @param[in, out]  it  Pointer to the iterator initialized by foreach_begin
+     * @return LIST_ERR_OK on success, LIST_ERR_NULL_ARGUMENT or LIST_ERR_PTHREAD_FAILURE otherwise
+     */
+    ListError_t (*foreach_end)(struct List* ctx, ListIter_t* it);
+
     /**
      * @brief Deinitialize this instance of List_t and free used resources
      * @param[in]  ctx  Pointer to the Linked List instance
@@ -101,4 +169,23 @@ typedef struct List {
  */
 ListError_t llist_init(List_t* ctx, int (*cmp)(const void* a, const void* b));
 
+/**
+ * @brief Initialize a new Linked list instance with a custom node allocator
+ * @param[in, out]  ctx  Pointer to the List instance
+ * @param[in] compare Function pointer for comparing node data.
+ * @param[in] allocator Allocator for nodes (copied; NULL for the default heap allocator)
+ * @return LIST_ERR_OK on success, LIST_ERR_NULL_ARGUMENT or LIST_ERR_PTHREAD_FAILURE otherwise
+ */
+ListError_t llist_init_with_allocator(List_t* ctx, int (*cmp)(const void* a, const void* b), const ListAllocator_t* allocator);
+
+/**
+ * @brief Create a node pool of the list with a single slab allocation (freed by deinit)
+ * @param[in, out]  ctx  Pointer to the initialized List instance
+ * @param[in]  data_size  Max size of the data stored in a single node
+ * @param[in]  capacity  Number of nodes in the pool
+ * @return LIST_ERR_OK on success, LIST_ERR_NULL_ARGUMENT, LIST_ERR_INCORRECT_ARGUMENT (also if the list already has
+ * a pool), LIST_ERR_MALLOC_FAILURE or LIST_ERR_PTHREAD_FAILURE otherwise
+ */
+ListError_t llist_pool_init(List_t* ctx, const size_t data_size, const size_t capacity);
+
 #endif // __LIST_H__
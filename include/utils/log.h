@@ -4,34 +4,180 @@
  *
  * @note Designed to provide thread-safe functionality (MT-Safe)
  *
+ * @note By default every line is formatted and written by the calling thread (LOG_MODE_SYNC). Use log_init() with
+ * LOG_MODE_ASYNC to only format lines in the calling thread and hand them over to a dedicated writer thread via a
+ * bounded lock-free ring (lines are dropped, not blocked on, when the ring is full). Use log_deinit() to flush the
+ * ring and stop the writer thread.
+ *
+ * @note Levels below LOG_COMPILE_LEVEL (set with the PIHUB_LOG_LEVEL CMake option) are compiled out completely. The
+ * remaining ones are filtered at runtime per module (see log_set_level() and log_configure()) before any of the
+ * macro arguments are evaluated. Define LOG_MODULE before including this header to assign a source file to a module
+ * (LOG_MODULE_GENERIC by default).
  */
 
 #ifndef __LOG_H__
 #define __LOG_H__
 
+#include <stdatomic.h> // For: atomic_int, atomic_load_explicit()
+#include <stdbool.h>   // For: bool
+
 // Define logging levels
 #define LOG_LEVEL_DEBUG 0
 #define LOG_LEVEL_INFO 1
 #define LOG_LEVEL_ERROR 2
+#define LOG_LEVEL_NONE 3 // Only for filters: nothing is logged
+
+// Lowest level compiled in (everything is compiled in if not defined)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Module the including source file belongs to (used by the runtime filters)
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MODULE_GENERIC
+#endif
 
 // Configure where the logs should be printed
 #define LOG_OUTPUT stdout
 
-#ifdef LOGS_ENABLED
+#define LOG_MSG_MAX_SIZE 256 // Max length of a single log line (longer lines are truncated)
+#define LOG_RING_SIZE 1024   // Number of lines buffered for the writer thread in LOG_MODE_ASYNC (power of 2)
+
+/**
+ * @struct LogError_t
+ * @brief Error codes returned by log API functions
+ */
+typedef enum {
+    LOG_ERR_OK = 0x00,        /**< Operation finished successfully */
+    LOG_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API call failure */
+    LOG_ERR_INVALID_ARGUMENT, /**< Error: Unknown module or level */
+    LOG_ERR_GENERIC,          /**< Error: Generic error (e.g. already initialized) */
+} LogError_t;
+
+/**
+ * @struct LogMode_t
+ * @brief Where the log lines are written from
+ */
+typedef enum {
+    LOG_MODE_SYNC = 0x00, /**< Lines written by the calling thread */
+    LOG_MODE_ASYNC,       /**< Lines written in batches by a dedicated writer thread */
+} LogMode_t;
+
+/**
+ * @struct LogModule_t
+ * @brief Modules with separate runtime log levels
+ */
+typedef enum {
+    LOG_MODULE_GENERIC = 0x00, /**< Everything not assigned to a module (e.g. main) */
+    LOG_MODULE_APP,            /**< App controller */
+    LOG_MODULE_DISPATCHER,     /**< Command dispatcher */
+    LOG_MODULE_SUBSCRIPTION,   /**< Sensor subscriptions */
+    LOG_MODULE_SYSSTAT,        /**< System stats */
+    LOG_MODULE_NETWORK,        /**< TCP server */
+    LOG_MODULE_GPIO,           /**< GPIO driver */
+    LOG_MODULE_HW,             /**< Hardware interfaces (I2C etc.) */
+    LOG_MODULE_SENSORS,        /**< Sensor drivers */
+    LOG_MODULE_LIST,           /**< Linked list */
+    LOG_MODULE_COUNT,          /**< Number of modules (not a valid module) */
+} LogModule_t;
+
+// Current runtime level of every module (use log_set_level() to change it)
+extern atomic_int log_module_levels[LOG_MODULE_COUNT];
+
+/**
+ * @brief Check whether a message of the given level should be logged by the module
+ * @param[in]  module  Module
+ * @param[in]  level  Message level
+ * @return true if the message passes the module filter
+ */
+static inline bool log_enabled(const LogModule_t module, const int level) {
+    return level >= atomic_load_explicit(&log_module_levels[module], memory_order_relaxed);
+}
+
+#define LOG_PRINT(level, level_num, msg, ...)                         \
+    do {                                                              \
+        if(log_enabled(LOG_MODULE, level_num)) {                      \
+            log_print(level, __FILE__, __LINE__, msg, ##__VA_ARGS__); \
+        }                                                             \
+    } while(0)
+
+// Dead code removed by the compiler (keeps the arguments type-checked and "used")
+#define LOG_DISCARD(msg, ...)                              \
+    do {                                                   \
+        if(0) {                                            \
+            log_print("", __FILE__, 0, msg, ##__VA_ARGS__); \
+        }                                                  \
+    } while(0)
+
+// Levels disabled at compile time (or all of them if logs are disabled) expand to nothing
+#if defined(LOGS_ENABLED) && LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define log_debug(msg, ...) LOG_PRINT("DEBUG", LOG_LEVEL_DEBUG, msg, ##__VA_ARGS__)
+#else
+#define log_debug(msg, ...) LOG_DISCARD(msg, ##__VA_ARGS__)
+#endif
 
-#define log_debug(msg, ...) log_print("DEBUG", LOG_LEVEL_DEBUG, __FILE__, __LINE__, msg, ##__VA_ARGS__)
-#define log_info(msg, ...) log_print("INFO", LOG_LEVEL_INFO, __FILE__, __LINE__, msg, ##__VA_ARGS__)
-#define log_error(msg, ...) log_print("ERROR", LOG_LEVEL_ERROR, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#if defined(LOGS_ENABLED) && LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define log_info(msg, ...) LOG_PRINT("INFO", LOG_LEVEL_INFO, msg, ##__VA_ARGS__)
+#else
+#define log_info(msg, ...) LOG_DISCARD(msg, ##__VA_ARGS__)
+#endif
 
+#if defined(LOGS_ENABLED) && LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define log_error(msg, ...) LOG_PRINT("ERROR", LOG_LEVEL_ERROR, msg, ##__VA_ARGS__)
 #else
+#define log_error(msg, ...) LOG_DISCARD(msg, ##__VA_ARGS__)
+#endif
+
+/**
+ * @brief Select the logging mode (and start the writer thread in LOG_MODE_ASYNC)
+ * @param[in]  mode  Logging mode
+ * @return LOG_ERR_OK on success, LOG_ERR_GENERIC (already initialized) or LOG_ERR_PTHREAD_FAILURE otherwise
+ */
+LogError_t log_init(const LogMode_t mode);
+
+/**
+ * @brief Flush all buffered lines, stop the writer thread (if any) and go back to LOG_MODE_SYNC
+ * @return LOG_ERR_OK on success, LOG_ERR_PTHREAD_FAILURE otherwise
+ */
+LogError_t log_deinit(void);
+
+/**
+ * @brief Set the runtime level of a single module
+ * @param[in]  module  Module
+ * @param[in]  level  Lowest level logged by the module (LOG_LEVEL_DEBUG - LOG_LEVEL_NONE)
+ * @return LOG_ERR_OK on success, LOG_ERR_INVALID_ARGUMENT otherwise
+ */
+LogError_t log_set_level(const LogModule_t module, const int level);
+
+/**
+ * @brief Set the runtime levels from a filter string (e.g. "info,network=debug")
+ *
+ * The string is a comma-separated list of entries, applied in order. An entry is either a bare level (applied to all
+ * the modules) or <module>=<level>. Module and level names are the ones accepted by log_module_from_name() and
+ * log_level_from_name(). Nothing is changed if any of the entries is invalid.
+ *
+ * @param[in]  filter  Filter string
+ * @return LOG_ERR_OK on success, LOG_ERR_INVALID_ARGUMENT otherwise
+ */
+LogError_t log_configure(const char* filter);
 
-// Ignore all logs if disabled
-#define log_debug(msg, ...)
-#define log_info(msg, ...)
-#define log_error(msg, ...)
+/**
+ * @brief Find a module by name ("generic", "app", "dispatcher", "subscription", "sysstat", "network", "gpio", "hw",
+ * "sensors", "list")
+ * @param[in]  name  Module name
+ * @param[out]  module  Found module
+ * @return true if found, false otherwise
+ */
+bool log_module_from_name(const char* name, LogModule_t* module);
 
-#endif // LOGS_ENABLED
+/**
+ * @brief Find a level by name ("debug", "info", "error", "none")
+ * @param[in]  name  Level name
+ * @param[out]  level  Found level
+ * @return true if found, false otherwise
+ */
+bool log_level_from_name(const char* name, int* level);
 
-void log_print(const char* level, const int level_num, const char* file, const int line, const char* msg, ...);
+void log_print(const char* level, const char* file, const int line, const char* msg, ...);
 
-#endif // __LOG_H__
\ No newline at end of file
+#endif // __LOG_H__
@@ -0,0 +1,206 @@
+/**
+ * @file metrics.h
+ * @brief Process-wide registry of counters and latency histograms recorded on the hot paths (command dispatching,
+ * socket I/O, I2C transactions and lock waits)
+ *
+ * @note Designed to provide thread-safe functionality (MT-Safe). Every thread records into its own shard (allocated
+ * on its first update), so the hot paths never share a cache line. The shards are merged only when read with
+ * metrics_snapshot(); the shard of an exited thread is folded into the totals and reused by the next new thread.
+ * Threads beyond METRICS_MAX_SHARDS share a single overflow shard.
+ *
+ * @note Use metrics_init() and metrics_deinit() once per process (e.g. in main). Nothing is recorded before
+ * metrics_init() - every update is a single relaxed load then - so the modules can be used without the registry
+ * (e.g. in the unit tests). metrics_deinit() has to be called after all the recording threads are stopped.
+ *
+ * @note Histograms have power-of-2 buckets: bucket b counts the values up to 2^(b + 10) ns (~1 us for bucket 0),
+ * the last one everything above. Percentiles are therefore reported as the upper bound of the bucket.
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <pthread.h>   // For: pthread_mutex_t
+#include <stdatomic.h> // For: atomic_bool
+#include <stdbool.h>   // For: bool
+#include <stdint.h>    // For: std types
+
+#include "utils/strbuf.h"
+
+#define METRICS_MAX_SHARDS 64       // Max number of threads with their own shard (the others share one)
+#define METRICS_MAX_CMDS 32         // Number of command IDs with their own counters (IDs above are not recorded)
+#define METRICS_CMD_NAME_SIZE 32    // Max size of a command name used in the renders (incl. the terminating char)
+#define METRICS_HIST_BUCKETS 24     // Number of histogram buckets (the last one is unbounded)
+#define METRICS_HIST_FIRST_SHIFT 10 // Upper bound of the first bucket (1 << METRICS_HIST_FIRST_SHIFT ns)
+
+/**
+ * @struct MetricsError_t
+ * @brief Error codes returned by metrics API functions
+ */
+typedef enum {
+    METRICS_ERR_OK = 0x00,        /**< Operation finished successfully */
+    METRICS_ERR_NULL_ARGUMENT,    /**< Error: NULL pointer passed as argument */
+    METRICS_ERR_INVALID_ARGUMENT, /**< Error: Unknown metric or command ID */
+    METRICS_ERR_PTHREAD_FAILURE,  /**< Error: Pthread API call failure */
+    METRICS_ERR_NOT_INITIALIZED,  /**< Error: metrics_init() not called */
+    METRICS_ERR_GENERIC,          /**< Error: Generic error (e.g. already initialized) */
+} MetricsError_t;
+
+/**
+ * @struct MetricsCounter_t
+ * @brief Counters of the registry
+ */
+typedef enum {
+    METRICS_SERVER_RX_BYTES = 0x00, /**< Bytes received from the clients */
+    METRICS_SERVER_RX_SYSCALLS,     /**< recv()/readv() calls on the client sockets */
+    METRICS_SERVER_RX_EAGAIN,       /**< Receive calls that found no data (EAGAIN) */
+    METRICS_SERVER_TX_BYTES,        /**< Bytes sent to the clients */
+    METRICS_SERVER_TX_SYSCALLS,     /**< sendmsg() calls on the client sockets */
+    METRICS_SERVER_TX_EAGAIN,       /**< Send calls that found the socket full (EAGAIN) */
+    METRICS_I2C_TRANSACTIONS,       /**< I2C transactions (reads, writes and combined transfers) */
+    METRICS_I2C_FAILURES,           /**< Failed I2C transactions */
+    METRICS_DISPATCHER_REJECTED,    /**< Lines rejected by the dispatcher (parsing errors, unknown commands) */
+    METRICS_COUNTER_COUNT,          /**< Number of counters (not a valid counter) */
+} MetricsCounter_t;
+
+/**
+ * @struct MetricsHist_t
+ * @brief Latency histograms of the registry (besides the per-command ones)
+ */
+typedef enum {
+    METRICS_HIST_I2C_LATENCY = 0x00, /**< Duration of the I2C transactions (the lock wait excluded) */
+    METRICS_HIST_LOCK_CLIENT,        /**< Wait time of the contended client slot locks (server) */
+    METRICS_HIST_LOCK_I2C,           /**< Wait time of the contended I2C bus locks */
+    METRICS_HIST_LOCK_SPI,           /**< Wait time of the contended SPI bus locks */
+    METRICS_HIST_LOCK_DISPATCHER,    /**< Wait time of the contended dispatcher job queue locks */
+    METRICS_HIST_COUNT,              /**< Number of histograms (not a valid histogram) */
+} MetricsHist_t;
+
+/**
+ * @struct MetricsHistogram_t
+ * @brief Merged histogram (see metrics_snapshot())
+ */
+typedef struct {
+    uint64_t buckets[METRICS_HIST_BUCKETS]; // Number of values per bucket (not cumulative)
+    uint64_t count;                         // Number of values
+    uint64_t sum_ns;                        // Sum of the values
+} MetricsHistogram_t;
+
+/**
+ * @struct MetricsCmd_t
+ * @brief Merged metrics of a single command (see metrics_snapshot())
+ */
+typedef struct {
+    uint64_t count;             // Number of executions (incl. the failed ones)
+    uint64_t errors;            // Executions that failed (error response sent or the command was rejected)
+    MetricsHistogram_t latency; // Time from dispatching the command to the return of its handler
+} MetricsCmd_t;
+
+/**
+ * @struct MetricsSnapshot_t
+ * @brief All metrics merged from the shards at a single point in time
+ */
+typedef struct {
+    uint64_t counters[METRICS_COUNTER_COUNT];     // Counters indexed by MetricsCounter_t
+    MetricsHistogram_t hists[METRICS_HIST_COUNT]; // Histograms indexed by MetricsHist_t
+    MetricsCmd_t cmds[METRICS_MAX_CMDS];          // Command metrics indexed by the command ID
+} MetricsSnapshot_t;
+
+/**
+ * @brief Start recording (the shards are allocated on the first update of every thread)
+ * @return METRICS_ERR_OK on success, METRICS_ERR_GENERIC (already initialized) or METRICS_ERR_PTHREAD_FAILURE otherwise
+ */
+MetricsError_t metrics_init(void);
+
+/**
+ * @brief Stop recording and release all shards [no thread may record at this point]
+ * @return METRICS_ERR_OK on success, METRICS_ERR_NOT_INITIALIZED otherwise
+ */
+MetricsError_t metrics_deinit(void);
+
+/**
+ * @brief Set the name of a command shown in the renders (commands without a name are not rendered)
+ * @param[in]  id  Command ID (the one passed to dispatcher_register())
+ * @param[in]  name  NULL terminated name (e.g. "gpio set"; truncated to METRICS_CMD_NAME_SIZE - 1 chars)
+ * @return METRICS_ERR_OK on success, METRICS_ERR_NULL_ARGUMENT, METRICS_ERR_INVALID_ARGUMENT,
+ * METRICS_ERR_NOT_INITIALIZED or METRICS_ERR_PTHREAD_FAILURE otherwise
+ */
+MetricsError_t metrics_set_cmd_name(const uint32_t id, const char* name);
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time for a latency measurement
+ * @return Time in ns or 0 if not recording (the clock is not read then and the measurement is dropped)
+ */
+uint64_t metrics_now_ns(void);
+
+/**
+ * @brief Add a value to a counter
+ * @param[in]  counter  Counter
+ * @param[in]  value  Value to be added
+ */
+void metrics_add(const MetricsCounter_t counter, const uint64_t value);
+
+/**
+ * @brief Record the time elapsed since start_ns in a histogram
+ * @param[in]  hist  Histogram
+ * @param[in]  start_ns  Start of the measurement returned by metrics_now_ns() (0: nothing is recorded)
+ */
+void metrics_observe(const MetricsHist_t hist, const uint64_t start_ns);
+
+/**
+ * @brief Lock the mutex and record the wait time if it was contended (the uncontended path reads no clock)
+ * @param[in, out]  lock  Mutex to be locked
+ * @param[in]  hist  Histogram of the wait time
+ * @return Return value of pthread_mutex_lock() (or pthread_mutex_trylock() if it did not fail with EBUSY)
+ */
+int metrics_mutex_lock(pthread_mutex_t* lock, const MetricsHist_t hist);
+
+/**
+ * @brief Mark the start of a command handler on the calling thread (clears the failure flag, see metrics_cmd_fail())
+ */
+void metrics_cmd_begin(void);
+
+/**
+ * @brief Mark the command handler run by the calling thread as failed (e.g. when an error response is sent)
+ */
+void metrics_cmd_fail(void);
+
+/**
+ * @brief Record a command execution
+ * @param[in]  id  Command ID
+ * @param[in]  start_ns  Time the command was dispatched at (returned by metrics_now_ns())
+ * @param[in]  failed  The command failed (it also counts as failed if metrics_cmd_fail() was called since
+ * metrics_cmd_begin())
+ */
+void metrics_cmd_end(const uint32_t id, const uint64_t start_ns, const bool failed);
+
+/**
+ * @brief Merge all the shards
+ * @param[out]  snap  Pointer to store the merged metrics
+ * @return METRICS_ERR_OK on success, METRICS_ERR_NULL_ARGUMENT, METRICS_ERR_NOT_INITIALIZED or
+ * METRICS_ERR_PTHREAD_FAILURE otherwise
+ */
+MetricsError_t metrics_snapshot(MetricsSnapshot_t* snap);
+
+/**
+ * @brief Estimate a percentile of the histogram
+ * @param[in]  hist  Pointer to the histogram
+ * @param[in]  permille  Percentile in permille (e.g. 990 for p99)
+ * @return Upper bound of the bucket holding the percentile in ns (UINT64_MAX for the last bucket, 0 if empty)
+ */
+uint64_t metrics_hist_percentile(const MetricsHistogram_t* hist, const uint32_t permille);
+
+/**
+ * @brief Render the snapshot as human-readable lines (commands that were never executed are skipped)
+ * @param[in]  snap  Pointer to the snapshot
+ * @param[in, out]  sb  String builder the lines are appended to (no NL at the end)
+ */
+void metrics_render_text(const MetricsSnapshot_t* snap, StrBuf_t* sb);
+
+/**
+ * @brief Render the snapshot in the Prometheus text exposition format (version 0.0.4)
+ * @param[in]  snap  Pointer to the snapshot
+ * @param[in, out]  sb  String builder the metric families are appended to
+ */
+void metrics_render_prometheus(const MetricsSnapshot_t* snap, StrBuf_t* sb);
+
+#endif // __METRICS_H__
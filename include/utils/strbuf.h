@@ -0,0 +1,73 @@
+/**
+ * @file strbuf.h
+ * @brief Length-tracking string builder over a caller-provided buffer
+ *
+ * @note Each append costs O(appended length) - the current length is tracked, so the buffer is never rescanned (as
+ * with strncat). The content is always NULL-terminated. Data that does not fit is cut off and the builder is marked
+ * as truncated (all following appends are ignored, so a message is never continued after a gap).
+ *
+ * @note Not thread-safe - a builder is meant to be used by a single thread (e.g. on the stack of a handler)
+ */
+
+#ifndef __STRBUF_H__
+#define __STRBUF_H__
+
+#include <stdbool.h> // For: bool
+#include <stdlib.h>  // For: size_t
+
+/**
+ * @struct StrBufError_t
+ * @brief Error codes returned by string builder functions
+ */
+typedef enum {
+    STRBUF_ERR_OK = 0x00,     /**< Operation finished successfully */
+    STRBUF_ERR_NULL_ARGUMENT, /**< Error: NULL pointer passed as argument */
+    STRBUF_ERR_TRUNCATED,     /**< Error: The data did not fit and the content was truncated */
+} StrBufError_t;
+
+/**
+ * @struct StrBuf_t
+ * @brief String builder state
+ */
+typedef struct {
+    char* data;     // Caller-provided buffer (NULL-terminated content)
+    size_t size;    // Size of the buffer (incl. the terminating char)
+    size_t len;     // Length of the content (without the terminating char)
+    bool truncated; // Some data did not fit into the buffer
+} StrBuf_t;
+
+/**
+ * @brief Initialize an empty builder over the buffer
+ * @param[out]  sb  Pointer to the builder
+ * @param[in]  buf  Buffer for the content (only the first byte is written)
+ * @param[in]  size  Size of the buffer (at least 1)
+ * @return STRBUF_ERR_OK on success, STRBUF_ERR_NULL_ARGUMENT otherwise
+ */
+StrBufError_t strbuf_init(StrBuf_t* sb, char* buf, const size_t size);
+
+/**
+ * @brief Append len bytes of data
+ * @param[in, out]  sb  Pointer to the builder
+ * @param[in]  data  Pointer to the data
+ * @param[in]  len  Number of bytes to append
+ * @return STRBUF_ERR_OK on success, STRBUF_ERR_NULL_ARGUMENT or STRBUF_ERR_TRUNCATED otherwise
+ */
+StrBufError_t strbuf_append(StrBuf_t* sb, const char* data, const size_t len);
+
+/**
+ * @brief Append a NULL-terminated string
+ * @param[in, out]  sb  Pointer to the builder
+ * @param[in]  str  String to append
+ * @return STRBUF_ERR_OK on success, STRBUF_ERR_NULL_ARGUMENT or STRBUF_ERR_TRUNCATED otherwise
+ */
+StrBufError_t strbuf_append_str(StrBuf_t* sb, const char* str);
+
+/**
+ * @brief Append a formatted string (printf-like, rendered straight into the buffer)
+ * @param[in, out]  sb  Pointer to the builder
+ * @param[in]  fmt  Format string
+ * @return STRBUF_ERR_OK on success, STRBUF_ERR_NULL_ARGUMENT or STRBUF_ERR_TRUNCATED otherwise
+ */
+StrBufError_t strbuf_appendf(StrBuf_t* sb, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif // __STRBUF_H__
@@ -1,23 +1,60 @@
-#include "app/app.h"
+#define LOG_MODULE LOG_MODULE_APP
 
-#include <errno.h>  // For: errno and related macros
-#include <limits.h> // For: ULONG_MAX etc.
-#include <stdio.h>  // For: printf etc.
-#include <stdlib.h> // For: strtoul()
-#include <string.h> // For: memset()
-#include <unistd.h> // For: sleep()
+#include "app/app.h"
 
+#include <errno.h>   // For: errno and related macros
+#include <limits.h>  // For: ULONG_MAX etc.
+#include <stdatomic.h> // For: atomic_bool, atomic_uint
+#include <stdint.h>  // For: uintptr_t
+#include <stdio.h>   // For: printf etc.
+#include <stdlib.h>  // For: strtoul()
+#include <string.h>  // For: memset()
+#include <sys/socket.h> // For: accept(), send(), setsockopt()
+#include <sys/time.h>   // For: struct timeval
+#include <sys/uio.h> // For: struct iovec
+#include <time.h>    // For: clock_gettime()
+#include <unistd.h>  // For: close()
+
+#include "app/proto.h"
+#include "app/subscription.h"
 #include "app/sysstat.h"
+#include "app/sysstat_collector.h"
+#include "sensors/sensor_history.h"
+#include "sensors/sensor_registry.h"
 #include "sensors/sensors_config.h"
 #include "utils/common.h"
 #include "utils/config.h"
 #include "utils/log.h"
+#include "utils/backoff.h"
+#include "utils/metrics.h"
+#include "utils/strbuf.h"
 
 // @TODO: Add note on sensors (Sensor_t abstraction) - static vs discovery mode
 
 #define APP_GPIO_SET_ARG_COUNT 2   // Number of arguments in gpio set command
 #define APP_GPIO_GET_ARG_COUNT 1   // Number of arguments in gpio get command
-#define APP_SENSOR_GET_ARG_COUNT 2 // Number of arguments in sensor get command
+#define APP_GPIO_SETMASK_ARG_COUNT 2 // Number of arguments in gpio setmask command
+#define APP_GPIO_GETALL_ARG_COUNT 1  // Number of arguments in gpio getall command
+#define APP_GPIO_LINES_DELIM ','     // Delimiter of line numbers in gpio setmask/getall commands
+#define APP_GPIO_WATCH_ARG_COUNT 1   // Number of arguments in gpio watch/unwatch commands
+#define APP_GPIO_EVENTS_PER_WAKEUP 16 // Max number of edge events pushed per single wakeup of the listening thread
+#define APP_SENSOR_GET_ARG_COUNT 2         // Number of arguments in sensor get command
+#define APP_SENSOR_SUBSCRIBE_ARG_COUNT 2   // Number of arguments in sensor subscribe command
+#define APP_SENSOR_UNSUBSCRIBE_ARG_COUNT 1 // Number of arguments in sensor unsubscribe command
+#define APP_SENSOR_PROFILE_ARG_COUNT 2     // Number of arguments in sensor profile command
+#define APP_SENSOR_HISTORY_ARG_COUNT 4     // Number of arguments in sensor history command
+#define APP_SERVER_LOG_ARG_COUNT 2         // Number of arguments in server log command
+#define APP_SERVER_PROTO_ARG_COUNT 1       // Number of arguments in server proto command
+#define APP_LOG_ALL_MODULES "all"          // Module name in server log command applying the level to all modules
+#define APP_METRICS_REQ_BUF_SIZE 1024      // Max size of the HTTP request head read from a metrics endpoint connection
+#define APP_METRICS_HEAD_BUF_SIZE 160      // Size of the buffer for the HTTP response head of the metrics endpoint
+#define APP_METRICS_BUSY_RESPONSE "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+
+#ifdef APP_METRICS_PORT
+// A worker has to be left for the offloaded commands (the scrapes may block a worker up to the HTTP timeout)
+_Static_assert(APP_DISPATCHER_WORKERS == 0 || APP_METRICS_MAX_SCRAPES < APP_DISPATCHER_WORKERS,
+"APP_METRICS_MAX_SCRAPES has to be lower than APP_DISPATCHER_WORKERS");
+#endif
 
 // Array with the help/man message (divided into lines)
 const char* APP_HELP_MSG[] = {
@@ -37,27 +74,84 @@ const char* APP_HELP_MSG[] = {
     "  GPIO Commands:",
     "    gpio set <PIN> <state>        Set GPIO pin state [0/1]",
     "    gpio get <PIN>                Get GPIO pin state",
+    "    gpio setmask <PINS> <BITS>    Set many pins at once (e.g. 5,6,7,8 1010)",
+    "    gpio getall <PINS>            Get many pin states at once (e.g. 21,22,23,24)",
+    "    gpio watch <PIN>              Receive rising/falling edge events from the pin",
+    "    gpio unwatch <PIN>            Stop receiving edge events from the pin",
     "",
     "  Sensor Commands:",
     "    sensor list                   List available sensors",
     "    sensor get <ID> temp          Get temperature in °C",
     "    sensor get <ID> hum           Get relative humidity %",
     "    sensor get <ID> press         Get pressure in Pa",
+    "    sensor get <ID> all           Get temperature, humidity and pressure at once",
+    "    sensor subscribe <ID> <ms>    Receive all measurements every <ms> milliseconds",
+    "    sensor unsubscribe <ID>       Stop receiving measurements from the sensor",
+    "    sensor profile <ID> <NAME>    Set the measurement profile [high-precision/low-latency/weather-station]",
+    "    sensor history <ID> <QTY> <WINDOW> <BUCKET>",
+    "                                  Get min/avg/max of temp/hum/press per bucket (e.g. 1h 1m; units: s/m/h/d)",
     "",
     "  Server Commands:",
     "    server help                   Display this man page",
     "    server status                 Get system health info",
     "    server uptime                 Get server's uptime",
     "    server net                    Get network stats",
+    "    server stats                  Get CPU load, memory, SoC temperature and net rates",
+    "    server rates                  Get net rates and CPU load over the last 1 s, 10 s and 60 s",
+    "    server metrics                Get per-command latencies, socket I/O, I2C and lock wait metrics",
     "    server disconnect             Disconnect this client",
+    "    server log <MODULE> <LEVEL>   Set log level [debug/info/error/none] (or all)",
+    "    server proto bin              Switch this client to the binary framed protocol (see app/proto.h)",
     "",
     "EXAMPLES",
     "    gpio set 10 1               Set HIGH level on GPIO 10",
     "    sensor get 1 temp           Get temperature from sensor #1",
+    "    sensor subscribe 0 1000     Receive measurements from sensor #0 every second",
+    "    sensor history 0 temp 1d 1h Get hourly temperature of sensor #0 over the last day",
+    "    server log network debug    Enable debug logs of the TCP server only",
 };
 
+typedef enum { APP_MSG_TYPE_INFO = 0x00, APP_MSG_TYPE_ERROR } AppMsgType_t;
+
 // Function prototypes (declarations)
-STATIC void app_remove_nl(char* buf);
+STATIC void app_execute_cmd(const ServerClient_t* client, char* cmd, const size_t len);
+STATIC void app_execute_frame(const ServerClient_t* client, const uint8_t* frame, const size_t len);
+STATIC void app_run_proto_job(void* arg);
+STATIC ServerError_t app_proto_reply(const ServerClient_t* client,
+const ProtoRequest_t* req,
+const ProtoStatus_t status,
+const uint8_t* payload,
+const size_t len);
+STATIC bool app_parse_gpio_lines(const char* str, uint8_t* lines, size_t* count);
+STATIC bool app_parse_gpio_line(const char* str, uint8_t* line);
+STATIC bool app_parse_duration_s(const char* str, uint32_t* seconds);
+STATIC bool app_gpio_watch_remove(const uint8_t line, const ServerClient_t client);
+STATIC void app_gpio_watch_remove_client(const ServerClient_t client);
+STATIC void app_gpio_watch_release(const uint8_t line);
+STATIC void app_gpio_watch_reset(void);
+STATIC ServerError_t app_send_to_client_len(const ServerClient_t* client, const char* buf, const size_t len, AppMsgType_t type);
+STATIC void app_init_help_msg(void);
+STATIC AppError_t app_init_services(void);
+STATIC AppError_t app_init_hardware(void);
+STATIC void* app_init_hardware_thread(void* arg);
+STATIC AppError_t app_restart_network(void);
+STATIC ServerError_t app_drop_client(const ServerClient_t client);
+STATIC void app_serve_metrics(void* arg);
+STATIC void app_drop_metrics_conn(void* arg);
+STATIC bool app_send_all(const int fd, const char* buf, size_t len);
+void handle_gpio_event(void* ctx, const int fd, void* arg);
+void handle_metrics_conn(void* ctx, const int fd, void* arg);
+
+/**
+ * @struct AppGpioWatch_t
+ * @brief Clients watching a single GPIO line for edge events (and the line's event fd watched by the server)
+ */
+typedef struct {
+    bool active;                                        // Line requested for events and its fd watched
+    ServerWatch_t watch;                                // Line event fd registered in the server listening thread
+    uint8_t client_count;                               // Number of watching clients
+    ServerClient_t clients[APP_GPIO_WATCH_MAX_CLIENTS]; // Watching clients
+} AppGpioWatch_t;
 
 /**
  * @struct App_t
@@ -66,62 +160,164 @@ STATIC void app_remove_nl(char* buf);
 typedef struct {
     // Handlers (contexts) to instances of various classes used by the controller
     Server_t server;
+    bool server_initialized; // The server (and its listening socket) is initialized
     Dispatcher_t dispatcher;
+    bool dispatcher_initialized; // The dispatcher (and its workers) is initialized
     HwInterface_t i2c;
     HwInterface_t spi;
-    Bme280_t sens_bme280[BME280_COUNT];
+    bool spi_initialized;     // The spi is opened only if any of the configured sensors is connected to it
+    SensorRegistry_t sensors; // Configured and discovered sensors (the index is the sensor ID)
+    SensorHistory_t history[SENSOR_REGISTRY_MAX_SENSORS]; // Sample history of each sensor (fed by its sampler)
     Gpio_t gpio;
+    SubscriptionTable_t subscriptions;
+    Sysstat_t sysstat;
+    SysstatCollector_t collector;
+    AppGpioWatch_t gpio_watches[GPIO_LINE_COUNT];
+    pthread_mutex_t gpio_watch_lock; // Protects gpio_watches (used by dispatcher and listening threads)
+    char help_msg[APP_HELP_MSG_BUF_SIZE]; // Help/man message rendered once on init (APP_HELP_MSG lines)
+    size_t help_msg_len;                  // Length of the rendered help/man message
+#ifdef APP_METRICS_PORT
+    int metrics_fd;              // Listening socket of the Prometheus metrics endpoint (-1: not opened)
+    ServerWatch_t metrics_watch; // Metrics endpoint socket registered in the server listening thread
+#endif
+    atomic_uint metrics_scrapes; // Metrics endpoint scrapes queued or being served by the dispatcher workers
     // Internal controller state
     bool running;
+    atomic_bool server_failed;     // Set by the server threads on failure (the restart is done by app_poll())
+    bool server_restart_pending;   // A restart of the network subsystem is scheduled
+    int64_t server_restart_at_ms;  // Time of the scheduled restart (CLOCK_MONOTONIC)
+    Backoff_t server_backoff;      // Delays between the restarts of the network subsystem
 } App_t;
 
 /* Shared app context! */
 static App_t app_ctx;
 
-typedef enum { APP_MSG_TYPE_INFO = 0x00, APP_MSG_TYPE_ERROR } AppMsgType_t;
+/**
+ * @struct AppProtoCommand_t
+ * @brief Binary protocol request handler with the number of its (uint32) arguments
+ */
+typedef struct {
+    uint32_t argc;                                                          // Number of arguments of the request
+    void (*handler)(const ServerClient_t* client, const ProtoRequest_t* req); // Handler (NULL: opcode not supported)
+    bool offload; // Run the handler on a dispatcher worker (blocking I/O, see dispatcher_offload())
+} AppProtoCommand_t;
+
+/**
+ * @struct AppProtoJob_t
+ * @brief Offloaded binary protocol request (copied into the dispatcher job)
+ */
+typedef struct {
+    ServerClient_t client; // Client that sent the request
+    ProtoRequest_t req;    // Decoded request
+} AppProtoJob_t;
+
+void handle_proto_ping(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_text(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_gpio_set(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_gpio_get(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_gpio_setmask(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_gpio_getall(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_sensor_count(const ServerClient_t* client, const ProtoRequest_t* req);
+void handle_proto_sensor_get(const ServerClient_t* client, const ProtoRequest_t* req);
+
+// Binary protocol requests indexed by opcode (O(1) lookup, no tokenizing)
+static const AppProtoCommand_t APP_PROTO_CMDS[PROTO_OPCODE_COUNT] = {
+    [PROTO_OP_PING] = { .argc = 0, .handler = handle_proto_ping },
+    [PROTO_OP_TEXT] = { .argc = 0, .handler = handle_proto_text },
+    [PROTO_OP_GPIO_SET] = { .argc = 2, .handler = handle_proto_gpio_set },
+    [PROTO_OP_GPIO_GET] = { .argc = 1, .handler = handle_proto_gpio_get },
+    [PROTO_OP_GPIO_SETMASK] = { .argc = 4, .handler = handle_proto_gpio_setmask },
+    [PROTO_OP_GPIO_GETALL] = { .argc = 2, .handler = handle_proto_gpio_getall },
+    [PROTO_OP_SENSOR_COUNT] = { .argc = 0, .handler = handle_proto_sensor_count },
+    [PROTO_OP_SENSOR_GET] = { .argc = 1, .handler = handle_proto_sensor_get, .offload = true },
+};
+
+// Build the scatter list of a PiHub message: msg type prefix + payload + new line character (nothing is copied)
+static void app_msg_iov(struct iovec iov[3], const char* buf, const size_t len, AppMsgType_t type) {
+    const char* prefix = (type == APP_MSG_TYPE_ERROR ? APP_PIHUB_ERROR_MSG : APP_PIHUB_INFO_MSG);
+    iov[0] = (struct iovec){ .iov_base = (void*)prefix, .iov_len = strlen(prefix) };
+    iov[1] = (struct iovec){ .iov_base = (void*)buf, .iov_len = len };
+    iov[2] = (struct iovec){ .iov_base = "\n", .iov_len = 1 };
+}
 
 // Generic function for sending PiHub messages to the client (buf has to be a NULL terminated string no longer than APP_TEMP_MSG_BUF_SIZE!)
-void app_send_to_client(const ServerClient_t* client, const char* buf, AppMsgType_t type) {
-    char tmp_buf[APP_TEMP_MSG_BUF_SIZE] = "";
+ServerError_t app_send_to_client(const ServerClient_t* client, const char* buf, AppMsgType_t type) {
+    return app_send_to_client_len(client, buf, strnlen(buf, APP_TEMP_MSG_BUF_SIZE), type);
+}
 
-    // Start the message with PiHub msg type
+STATIC ServerError_t app_send_to_client_len(const ServerClient_t* client, const char* buf, const size_t len, AppMsgType_t type) {
     if(type == APP_MSG_TYPE_ERROR) {
-        strncat(tmp_buf, APP_PIHUB_ERROR_MSG, APP_TEMP_MSG_BUF_SIZE - 1);
-    } else {
-        strncat(tmp_buf, APP_PIHUB_INFO_MSG, APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
+        metrics_cmd_fail(); // Counted as a failed execution of the command run by this thread (if any)
+    }
+
+    // Clients using the binary protocol get the messages as notices (the text would break the framing)
+    ServerFraming_t framing = SERVER_FRAMING_LINE;
+    server_get_framing(&app_ctx.server, *client, &framing);
+    if(framing == SERVER_FRAMING_LENGTH_PREFIXED) {
+        const ProtoRequest_t notice = { .opcode = PROTO_OP_NOTICE, .req_id = PROTO_NOTICE_REQ_ID };
+        return app_proto_reply(client, &notice, (type == APP_MSG_TYPE_ERROR ? PROTO_STATUS_FAILURE : PROTO_STATUS_OK),
+        (const uint8_t*)buf, len);
     }
 
-    // Concatenate the actual message and add a new line character
-    strncat(tmp_buf, buf, APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-    strncat(tmp_buf, "\n", APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-    // strncat(tmp_buf, APP_PIHUB_PROMPT_CHAR, APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
+    struct iovec iov[3];
+    app_msg_iov(iov, buf, len, type);
 
-    ServerError_t err_s = server_write(&app_ctx.server, *client, tmp_buf, strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE));
+    ServerError_t err_s = server_writev(&app_ctx.server, *client, iov, 3);
     if(err_s != SERVER_ERR_OK) {
-        log_error("server_write failed (ret: %d)", err_s);
+        log_error("server_writev failed (ret: %d)", err_s);
     }
+    return err_s;
 }
 
 // Generic function for broadcasting PiHub messages to all clients (buf has to be a NULL terminated string no longer than APP_TEMP_MSG_BUF_SIZE!)
 void app_broadcast(const char* buf, AppMsgType_t type) {
-    char tmp_buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    struct iovec iov[3];
+    app_msg_iov(iov, buf, strnlen(buf, APP_TEMP_MSG_BUF_SIZE), type);
 
-    // Start the message with PiHub msg type
-    if(type == APP_MSG_TYPE_ERROR) {
-        strncat(tmp_buf, APP_PIHUB_ERROR_MSG, APP_TEMP_MSG_BUF_SIZE - 1);
-    } else {
-        strncat(tmp_buf, APP_PIHUB_INFO_MSG, APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
+    ServerError_t err_s = server_broadcastv(&app_ctx.server, iov, 3);
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_broadcastv failed (ret: %d)", err_s);
     }
+}
 
-    // Concatenate the actual message and add a new line character
-    strncat(tmp_buf, buf, APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-    strncat(tmp_buf, "\n", APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-    // strncat(tmp_buf, APP_PIHUB_PROMPT_CHAR, APP_TEMP_MSG_BUF_SIZE - strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE) - 1);
+// Render the measurements of a readout as decimal strings with two decimal places (without any float math)
+static void app_format_reading(const SensorReading_t* r, char* temp, char* hum, char* press) {
+    sensor_format_centi(temp, SENSOR_CENTI_STR_SIZE, r->temp_cC);
+    sensor_format_centi(hum, SENSOR_CENTI_STR_SIZE, (int32_t)sensor_q_to_centi(r->hum_q10, SENSOR_HUM_FRAC_BITS));
+    sensor_format_centi(press, SENSOR_CENTI_STR_SIZE, (int32_t)sensor_q_to_centi(r->press_q8, SENSOR_PRESS_FRAC_BITS));
+}
 
-    ServerError_t err_s = server_broadcast(&app_ctx.server, tmp_buf, strnlen(tmp_buf, APP_TEMP_MSG_BUF_SIZE));
-    if(err_s != SERVER_ERR_OK) {
-        log_error("server_write failed (ret: %d)", err_s);
+// Get the current CLOCK_MONOTONIC time in ms
+static int64_t app_monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Wall-clock time in ms (the history timestamps must survive restarts, so CLOCK_MONOTONIC is not an option)
+static int64_t app_realtime_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Store every background sample in the history of the sensor (called from the sampler thread, see SensorSampleCb_t)
+static void app_history_on_sample(void* arg, const SensorReading_t* reading) {
+    SensorHistoryError_t err_h = sensor_history_append((SensorHistory_t*)arg, app_realtime_ms(), reading);
+    if(err_h != SENSOR_HISTORY_ERR_OK && err_h != SENSOR_HISTORY_ERR_DROPPED) {
+        log_error("sensor_history_append failed (err: %d)", err_h);
+    }
+}
+
+// Render a history value as a decimal string with two decimal places (same units as in `sensor get`)
+static void app_format_history_value(char* buf, const SensorHistoryQty_t qty, const int32_t value) {
+    int32_t value_x100 = value;
+    if(qty == SENSOR_HISTORY_HUM) {
+        value_x100 = (int32_t)sensor_q_to_centi((uint32_t)value, SENSOR_HUM_FRAC_BITS);
+    } else if(qty == SENSOR_HISTORY_PRESS) {
+        value_x100 = (int32_t)sensor_q_to_centi((uint32_t)value, SENSOR_PRESS_FRAC_BITS);
     }
+    sensor_format_centi(buf, SENSOR_CENTI_STR_SIZE, value_x100);
 }
 
 /************* Event handlers for Dispatcher *************/
@@ -135,9 +331,9 @@ void handle_gpio_set(char** argv, uint32_t argc, const void* cmd_ctx) {
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'gpio set' cmd received (client IP: %.16s)", ip_str);
+        log_info("'gpio set' cmd received (client IP: %s)", ip_str);
     } else {
         log_info("'gpio set' cmd received (client IP: failed to retrieve)");
     }
@@ -203,9 +399,9 @@ void handle_gpio_get(char** argv, uint32_t argc, const void* cmd_ctx) {
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'gpio get' cmd received (client IP: %.16s)", ip_str);
+        log_info("'gpio get' cmd received (client IP: %s)", ip_str);
     } else {
         log_info("'gpio get' cmd received (client IP: failed to retrieve)");
     }
@@ -247,316 +443,1326 @@ void handle_gpio_get(char** argv, uint32_t argc, const void* cmd_ctx) {
     }
 }
 
-void handle_sensor_list(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_gpio_setmask(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to handle_sensor_list");
+        log_error("NULL context provided to handle_gpio_setmask");
         return;
     }
 
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'sensor list' cmd received (client IP: %.16s)", ip_str);
+        log_info("'gpio setmask' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'sensor list' cmd received (client IP: failed to retrieve)");
+        log_info("'gpio setmask' cmd received (client IP: failed to retrieve)");
     }
 
-    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
-    char buf_aux[APP_TEMP_MSG_BUF_SIZE] = "";
+    uint8_t lines[GPIO_LINE_COUNT], states[GPIO_LINE_COUNT];
+    size_t count;
 
-    if(BME280_COUNT <= 0) {
-        app_send_to_client(client, "No sensors configured", APP_MSG_TYPE_ERROR);
+    if(argc != APP_GPIO_SETMASK_ARG_COUNT) {
+        log_error("incorrect number of args in the 'gpio setmask' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
     }
 
-    // List all bme280 sensors defined in the sensors_config.h configuration file
-    for(int i = 0; i < BME280_COUNT; ++i) {
-        snprintf(buf_aux, APP_TEMP_MSG_BUF_SIZE, "sensor id: #%d; addr: 0x%02hhX; hw if: %s", i,
-        SENSORS_CONFIG_BME280[i].addr, (SENSORS_CONFIG_BME280[i].if_type == HW_INTERFACE_I2C ? "I2C" : "SPI"));
-        strncat(buf, buf_aux, APP_TEMP_MSG_BUF_SIZE - strnlen(buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-        if(i != BME280_COUNT - 1) { // no NL at the end of t buffer (app_send_to_client() is responsible for adding it)
-            strncat(buf, buf_aux, APP_TEMP_MSG_BUF_SIZE - strnlen(buf, APP_TEMP_MSG_BUF_SIZE) - 1);
+    // Convert the first parameter into the list of lines
+    if(!app_parse_gpio_lines(*argv, lines, &count)) {
+        log_error("failed to convert the list of lines ('%.20s')", *argv);
+        app_send_to_client(client, "failed to convert the list of line numbers", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Convert the second parameter into the states (one '0' or '1' character per line)
+    const char* bits = *(argv + 1);
+    if(strnlen(bits, GPIO_LINE_COUNT + 1) != count) {
+        log_error("number of states does not match the number of lines (lines: %zu)", count);
+        app_send_to_client(client, "number of states does not match the number of lines", APP_MSG_TYPE_ERROR);
+        return;
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(bits[i] != '0' && bits[i] != '1') {
+            log_error("incorrect state value (val: %c)", bits[i]);
+            app_send_to_client(client, "incorrect state value (only 0 or 1 is allowed)", APP_MSG_TYPE_ERROR);
+            return;
         }
+        states[i] = (uint8_t)(bits[i] - '0');
+    }
+
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    GpioError_t err_g = gpio_set_bulk(&app_ctx.gpio, lines, states, count);
+    if(err_g != GPIO_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to set the GPIO outputs (lines: %s, gpio_set_bulk ret: %d)", *argv, err_g);
+        log_error("gpio_set_bulk failed (lines: %s, ret: %d)", *argv, err_g);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    } else {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "GPIO lines %s set to %s", *argv, bits);
+        log_info("GPIO lines %s set to %s", *argv, bits);
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
     }
-    app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
 }
 
-void handle_sensor_get(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_gpio_getall(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to handle_sensor_get");
+        log_error("NULL context provided to handle_gpio_getall");
         return;
     }
 
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'sensor get' cmd received (client IP: %.16s)", ip_str);
+        log_info("'gpio getall' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'sensor get' cmd received (client IP: failed to retrieve)");
+        log_info("'gpio getall' cmd received (client IP: failed to retrieve)");
     }
 
+    uint8_t lines[GPIO_LINE_COUNT], states[GPIO_LINE_COUNT];
+    size_t count;
 
-    uint8_t id;
-    char* conversion_end_ptr;
-
-    if(argc != APP_SENSOR_GET_ARG_COUNT) {
-        log_error("incorrect number of arguments in the 'sensor get' cmd");
+    if(argc != APP_GPIO_GETALL_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'gpio getall' cmd");
         app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
         return;
     }
 
-    // Try converting the first parameter into the sensor ID
-    errno = 0;
-    unsigned long sensor_id_ul = strtoul(*argv, &conversion_end_ptr, 10);
-    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *argv) {
-        log_error("failed to convert sensor ID str into a number (errno: %s)", strerror(errno));
-        app_send_to_client(client, "failed to convert the sensor ID", APP_MSG_TYPE_ERROR);
-        return;
-    } else if(sensor_id_ul >= UINT8_MAX || sensor_id_ul > BME280_COUNT) {
-        log_error("sensor ID invalid (val: %lu)", sensor_id_ul);
-        app_send_to_client(client, "invalid sensor ID", APP_MSG_TYPE_ERROR);
+    // Convert the first parameter into the list of lines
+    if(!app_parse_gpio_lines(*argv, lines, &count)) {
+        log_error("failed to convert the list of lines ('%.20s')", *argv);
+        app_send_to_client(client, "failed to convert the list of line numbers", APP_MSG_TYPE_ERROR);
         return;
     }
-    id = (uint8_t)sensor_id_ul; // sensor_id_ul is between 0 and UINT8_MAX so it's safe to cast
 
-    AppMsgType_t resp_type = APP_MSG_TYPE_INFO;
     char buf[APP_TEMP_MSG_BUF_SIZE] = "";
-    if(strncasecmp(*(argv + 1), APP_HUM_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
-        float hum;
-        SensorError_t err_s = bme280_get_hum(&app_ctx.sens_bme280[id], &hum);
-        if(err_s == SENSOR_ERR_OK) {
-            log_debug("sensor #%hu returned humidity: %.2f %%", id, hum);
-            snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned humidity: %.2f %%", id, hum);
-        } else {
-            log_error("bme280_get_hum failed (sensor id: %hu, ret: %d)", id, err_s);
-            snprintf(buf, APP_TEMP_MSG_BUF_SIZE,
-            "failed to read humidity from sensor #%hu (bme280_get_hum ret: %d)", id, err_s);
-            resp_type = APP_MSG_TYPE_ERROR;
-        }
-    } else if(strncasecmp(*(argv + 1), APP_TEMP_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
-        float temp;
-        SensorError_t err_s = bme280_get_temp(&app_ctx.sens_bme280[id], &temp);
-        if(err_s == SENSOR_ERR_OK) {
-            log_debug("sensor #%hu returned temp: %.2f *C", id, temp);
-            snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned temp: %.2f *C", id, temp);
-        } else {
-            log_error("bme280_get_temp failed (sensor id: %hu, ret: %d)", id, err_s);
-            snprintf(buf, APP_TEMP_MSG_BUF_SIZE,
-            "failed to read temp from sensor #%hu (bme280_get_temp ret: %d)", id, err_s);
-            resp_type = APP_MSG_TYPE_ERROR;
-        }
-    } else if(strncasecmp(*(argv + 1), APP_PRESS_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
-        float press;
-        SensorError_t err_s = bme280_get_press(&app_ctx.sens_bme280[id], &press);
-        if(err_s == SENSOR_ERR_OK) {
-            snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned press: %.2f Pa", id, press);
-            log_debug("sensor #%hu returned press: %.2f Pa", id, press);
-        } else {
-            log_error("bme280_get_press failed (sensor id: %hu, ret: %d)", id, err_s);
-            snprintf(buf, APP_TEMP_MSG_BUF_SIZE,
-            "failed to read press from sensor #%hu (bme280_get_press ret: %d)", id, err_s);
-            resp_type = APP_MSG_TYPE_ERROR;
-        }
+    GpioError_t err_g = gpio_get_bulk(&app_ctx.gpio, lines, states, count);
+    if(err_g != GPIO_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to get the GPIO inputs (lines: %s, gpio_get_bulk ret: %d)", *argv, err_g);
+        log_error("gpio_get_bulk failed (lines: %s, ret: %d)", *argv, err_g);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
     } else {
-        log_error("unsupported measurement type ('%.20s')", *(argv + 1));
-        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "unsupported measurement type");
-        resp_type = APP_MSG_TYPE_ERROR;
+        // Report the states in the same format as accepted by 'gpio setmask'
+        char bits[GPIO_LINE_COUNT + 1];
+        for(size_t i = 0; i < count; i++) {
+            bits[i] = states[i] ? '1' : '0';
+        }
+        bits[count] = '\0';
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "GPIO lines %s are %s", *argv, bits);
+        log_debug("GPIO lines %s are %s", *argv, bits);
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
     }
-    app_send_to_client(client, buf, resp_type);
 }
 
-void handle_server_status(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_gpio_watch(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to handle_server_status");
+        log_error("NULL context provided to handle_gpio_watch");
         return;
     }
 
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'server status' cmd received (client IP: %.16s)", ip_str);
+        log_info("'gpio watch' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'server status' cmd received (client IP: failed to retrieve)");
+        log_info("'gpio watch' cmd received (client IP: failed to retrieve)");
     }
 
-    SysstatMemInfo_t mem_stats;
-    SysstatNetInfo_t net_stats;
-    SysstatUptimeInfo_t time_stats;
-    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
-    char buf_aux[APP_TEMP_MSG_BUF_SIZE] = "";
+    uint8_t line;
 
-    SysstatError_t err_stat = sysstat_get_mem_info(&mem_stats);
-    if(err_stat != SYSSTAT_ERR_OK) {
-        log_error("sysstat_get_mem_info failed (ret: %d)", err_stat);
-        sprintf(buf, "failed to retrieve memory stats (sysstat_get_mem_info ret: %d)", err_stat);
-        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    if(argc != APP_GPIO_WATCH_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'gpio watch' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
         return;
     }
 
-    err_stat = sysstat_get_net_info(NET_INTERFACE_NAME, &net_stats);
-    if(err_stat != SYSSTAT_ERR_OK) {
-        log_error("sysstat_get_net_info failed (ret: %d)", err_stat);
-        sprintf(buf, "failed to retrieve network stats (sysstat_get_net_info ret: %d)", err_stat);
-        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    // Try converting the first parameter into the line number
+    if(!app_parse_gpio_line(*argv, &line)) {
+        log_error("failed to convert line num str into a number ('%.20s')", *argv);
+        app_send_to_client(client, "failed to convert line number", APP_MSG_TYPE_ERROR);
         return;
     }
 
-    err_stat = sysstat_get_uptime_info(&time_stats);
-    if(err_stat != SYSSTAT_ERR_OK) {
-        log_error("sysstat_get_uptime_info failed (ret: %d)", err_stat);
-        sprintf(buf, "failed to retrieve uptime stats (sysstat_get_uptime_info ret: %d)", err_stat);
-        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    // Add the client to the line's watchers (critical section)
+    int ret = pthread_mutex_lock(&app_ctx.gpio_watch_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        app_send_to_client(client, APP_GENERIC_FAILURE_MSG, APP_MSG_TYPE_ERROR);
         return;
     }
+    log_debug("gpio watch lock taken");
 
-    // Check the number of connected clients
-    uint32_t clients_count = 0;
-    for(ListNode_t* node = server_get_clients(&app_ctx.server); node != NULL; node = node->next) {
-        clients_count++;
-    }
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    AppMsgType_t resp_type = APP_MSG_TYPE_INFO;
+    AppGpioWatch_t* entry = &app_ctx.gpio_watches[line];
+    do {
+        bool watching = false;
+        for(uint8_t i = 0; i < entry->client_count; i++) {
+            watching = watching || server_client_equal(entry->clients[i], *client);
+        }
+        if(watching) {
+            snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "already watching GPIO line %hu", line);
+            break;
+        } else if(entry->client_count >= APP_GPIO_WATCH_MAX_CLIENTS) {
+            log_error("too many clients watching GPIO line %hu", line);
+            snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "too many clients watching GPIO line %hu", line);
+            resp_type = APP_MSG_TYPE_ERROR;
+            break;
+        }
 
-    snprintf(buf, APP_TEMP_MSG_BUF_SIZE,
-    "Mem %lu kB/%lu kB (available/total) | Net tx: %lu kB, rx: %lu kB | Uptime %u.%hu s\n", mem_stats.available_kB,
-    mem_stats.total_kB, net_stats.tx_bytes / 1000, net_stats.rx_bytes / 1000, time_stats.up.s, time_stats.up.ms);
+        // The first watcher requests the line events and registers the event fd in the server
+        if(!entry->active) {
+            int fd;
+            GpioError_t err_g = gpio_watch(&app_ctx.gpio, line, &fd);
+            if(err_g != GPIO_ERR_OK) {
+                log_error("gpio_watch failed (line: %hu, ret: %d)", line, err_g);
+                snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to watch GPIO line %hu (gpio_watch ret: %d)", line, err_g);
+                resp_type = APP_MSG_TYPE_ERROR;
+                break;
+            }
+            entry->watch = (ServerWatch_t){ .fd = fd, .on_event = handle_gpio_event, .arg = (void*)(uintptr_t)line };
+            ServerError_t err_s = server_watch(&app_ctx.server, &entry->watch);
+            if(err_s != SERVER_ERR_OK) {
+                log_error("server_watch failed (line: %hu, ret: %d)", line, err_s);
+                snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to watch GPIO line %hu (server_watch ret: %d)", line, err_s);
+                resp_type = APP_MSG_TYPE_ERROR;
+                gpio_unwatch(&app_ctx.gpio, line);
+                break;
+            }
+            entry->active = true;
+        }
 
-    snprintf(buf_aux, APP_TEMP_MSG_BUF_SIZE, "connected clients: %u", clients_count);
-    strncat(buf, buf_aux, APP_TEMP_MSG_BUF_SIZE - strnlen(buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-    app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+        entry->clients[entry->client_count++] = *client;
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "watching GPIO line %hu", line);
+        log_info("client (fd: %d) watching GPIO line %hu", client->fd, line);
+    } while(0); // Run only once (do not loop)
+
+    ret = pthread_mutex_unlock(&app_ctx.gpio_watch_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+    }
+    log_debug("gpio watch lock released");
+
+    app_send_to_client(client, buf, resp_type);
 }
 
-void handle_server_uptime(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_gpio_unwatch(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to the handle_server_uptime");
+        log_error("NULL context provided to handle_gpio_unwatch");
         return;
     }
 
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'server uptime' cmd received (client IP: %.16s)", ip_str);
+        log_info("'gpio unwatch' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'server uptime' cmd received (client IP: failed to retrieve)");
+        log_info("'gpio unwatch' cmd received (client IP: failed to retrieve)");
     }
 
-    SysstatUptimeInfo_t time_stats;
-    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    uint8_t line;
 
-    SysstatError_t err_stat = sysstat_get_uptime_info(&time_stats);
-    if(err_stat != SYSSTAT_ERR_OK) {
-        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to retrieve uptime info (sysstat_get_uptime_info ret: %d)", err_stat);
-        log_error("sysstat_get_uptime_info failed (ret: %d)", err_stat);
-        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
-    } else {
-        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "uptime %u.%hu s", time_stats.up.s, time_stats.up.ms);
+    if(argc != APP_GPIO_WATCH_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'gpio unwatch' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Try converting the first parameter into the line number
+    if(!app_parse_gpio_line(*argv, &line)) {
+        log_error("failed to convert line num str into a number ('%.20s')", *argv);
+        app_send_to_client(client, "failed to convert line number", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    if(app_gpio_watch_remove(line, *client)) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "stopped watching GPIO line %hu", line);
+        log_info("client (fd: %d) stopped watching GPIO line %hu", client->fd, line);
         app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    } else {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "not watching GPIO line %hu", line);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
     }
 }
 
-void handle_server_net(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_sensor_list(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to the handle_server_net");
+        log_error("NULL context provided to handle_sensor_list");
         return;
     }
 
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'server net' cmd received (client IP: %.16s)", ip_str);
+        log_info("'sensor list' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'server net' cmd received (client IP: failed to retrieve)");
+        log_info("'sensor list' cmd received (client IP: failed to retrieve)");
     }
 
-    SysstatNetInfo_t net_stats;
-    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    char buf[APP_TEMP_MSG_BUF_SIZE];
+    StrBuf_t sb;
+    strbuf_init(&sb, buf, sizeof(buf));
 
-    SysstatError_t err_stat = sysstat_get_net_info(NET_INTERFACE_NAME, &net_stats);
-    if(err_stat != SYSSTAT_ERR_OK) {
-        sprintf(buf, "failed to retrieve network stats (sysstat_get_net_info ret: %d)", err_stat);
-        log_error("sysstat_get_net_info failed (ret: %d)", err_stat);
-        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
-    } else {
-        sprintf(buf, "net tx: %lu kB (%lu packets), rx: %lu kB (%lu packets)", net_stats.tx_bytes / 1000,
-        net_stats.rx_packets, net_stats.rx_bytes / 1000, net_stats.tx_packets);
-        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    if(app_ctx.sensors.count == 0) {
+        app_send_to_client(client, "No sensors configured", APP_MSG_TYPE_ERROR);
+        return;
     }
+
+    // List all sensors in the registry (configured in sensors_config.h and discovered on the buses)
+    for(size_t i = 0; i < app_ctx.sensors.count; ++i) {
+        const Sensor_t* sensor = sensor_registry_get(&app_ctx.sensors, i);
+        if(i != 0) { // no NL at the end of the buffer (app_send_to_client() is responsible for adding it)
+            strbuf_append(&sb, "\n", 1);
+        }
+        strbuf_appendf(&sb, "sensor id: #%zu; type: %s; addr: 0x%02hhX; hw if: %s%s%s", i, sensor->driver->name,
+        sensor->info.addr, (sensor->info.if_type == HW_INTERFACE_I2C ? "I2C" : "SPI"),
+        (sensor->discovered ? "; discovered" : ""), (sensor->is_initialized ? "" : "; not responding"));
+        if(sensor->is_initialized && sensor->driver->set_profile) {
+            strbuf_appendf(&sb, "; profile: %s", sensor_profile_name((SensorProfile_t)atomic_load(&sensor->profile)));
+        }
+    }
+    app_send_to_client_len(client, sb.data, sb.len, APP_MSG_TYPE_INFO);
 }
 
-void handle_server_disconnect(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_sensor_get(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to the handle_server_disconnect");
+        log_error("NULL context provided to handle_sensor_get");
         return;
     }
 
     // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'server disconnect' cmd received (client IP: %.16s)", ip_str);
+        log_info("'sensor get' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'server disconnect' cmd received (client IP: failed to retrieve)");
+        log_info("'sensor get' cmd received (client IP: failed to retrieve)");
     }
 
-    app_send_to_client(client, "disconnecting from the server...", APP_MSG_TYPE_INFO);
 
-    ServerError_t err_s = server_disconnect(&app_ctx.server, *client);
-    if(err_s != SERVER_ERR_OK) {
-        char buf[APP_TEMP_MSG_BUF_SIZE] = "";
-        sprintf(buf, "failed to disconnect from the server (server_disconnect ret: %d)", err_s);
-        log_error("server_disconnect failed (ret: %d)", err_s);
-        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    uint8_t id;
+    char* conversion_end_ptr;
+
+    if(argc != APP_SENSOR_GET_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'sensor get' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Try converting the first parameter into the sensor ID
+    errno = 0;
+    unsigned long sensor_id_ul = strtoul(*argv, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *argv) {
+        log_error("failed to convert sensor ID str into a number (errno: %s)", strerror(errno));
+        app_send_to_client(client, "failed to convert the sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(sensor_id_ul >= UINT8_MAX || sensor_id_ul >= app_ctx.sensors.count) {
+        log_error("sensor ID invalid (val: %lu)", sensor_id_ul);
+        app_send_to_client(client, "invalid sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    }
+    id = (uint8_t)sensor_id_ul; // sensor_id_ul is between 0 and UINT8_MAX so it's safe to cast
+
+    // Select the requested measurement (a single readout provides all measurements supported by the sensor)
+    const char* arg = *(argv + 1);
+    uint8_t field = 0;
+    if(strncasecmp(arg, APP_HUM_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        field = SENSOR_FIELD_HUM;
+    } else if(strncasecmp(arg, APP_TEMP_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        field = SENSOR_FIELD_TEMP;
+    } else if(strncasecmp(arg, APP_PRESS_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        field = SENSOR_FIELD_PRESS;
+    } else if(strncasecmp(arg, APP_ALL_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        field = SENSOR_FIELD_TEMP | SENSOR_FIELD_HUM | SENSOR_FIELD_PRESS;
+    }
+
+    AppMsgType_t resp_type = APP_MSG_TYPE_INFO;
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    char temp[SENSOR_CENTI_STR_SIZE], hum[SENSOR_CENTI_STR_SIZE], press[SENSOR_CENTI_STR_SIZE];
+    SensorReading_t r;
+    SensorError_t err_s = (field != 0) ? sensor_registry_read(&app_ctx.sensors, id, &r) : SENSOR_ERR_OK;
+    if(field != 0 && err_s == SENSOR_ERR_OK) {
+        app_format_reading(&r, temp, hum, press);
+    }
+    if(field == 0) {
+        log_error("unsupported measurement type ('%.20s')", arg);
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "unsupported measurement type");
+        resp_type = APP_MSG_TYPE_ERROR;
+    } else if(err_s != SENSOR_ERR_OK) {
+        log_error("sensor_registry_read failed (sensor id: %hu, ret: %d)", id, err_s);
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to read measurements from sensor #%hu (sensor_registry_read ret: %d)",
+        id, err_s);
+        resp_type = APP_MSG_TYPE_ERROR;
+    } else if((r.fields & field) != field) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "measurement not supported by sensor #%hu", id);
+        resp_type = APP_MSG_TYPE_ERROR;
+    } else if(field == SENSOR_FIELD_HUM) {
+        log_debug("sensor #%hu returned humidity: %s %%", id, hum);
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned humidity: %s %%", id, hum);
+    } else if(field == SENSOR_FIELD_TEMP) {
+        log_debug("sensor #%hu returned temp: %s *C", id, temp);
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned temp: %s *C", id, temp);
+    } else if(field == SENSOR_FIELD_PRESS) {
+        log_debug("sensor #%hu returned press: %s Pa", id, press);
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned press: %s Pa", id, press);
+    } else {
+        log_debug("sensor #%hu returned temp: %s *C, hum: %s %%, press: %s Pa", id, temp, hum, press);
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu returned temp: %s *C, hum: %s %%, press: %s Pa", id, temp,
+        hum, press);
     }
+    app_send_to_client(client, buf, resp_type);
 }
 
-void handle_server_help(char** argv, uint32_t argc, const void* cmd_ctx) {
+void handle_sensor_subscribe(char** argv, uint32_t argc, const void* cmd_ctx) {
     if(!cmd_ctx) {
-        log_error("NULL context provided to handle_server_help");
+        log_error("NULL context provided to handle_sensor_subscribe");
         return;
     }
 
+    // The cmd context carries details about the client that invoked the command
     ServerClient_t* client = (ServerClient_t*)cmd_ctx;
 
-    char ip_str[IPV4_ADDRSTR_LENGTH];
+    char ip_str[IP_ADDRSTR_LENGTH];
     if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
-        log_info("'server help' cmd received (client IP: %.16s)", ip_str);
+        log_info("'sensor subscribe' cmd received (client IP: %s)", ip_str);
     } else {
-        log_info("'server help' cmd received (client IP: failed to retrieve)");
+        log_info("'sensor subscribe' cmd received (client IP: failed to retrieve)");
     }
 
-    const size_t line_count = sizeof(APP_HELP_MSG) / sizeof(APP_HELP_MSG[0]);
+    uint8_t id;
+    uint32_t period_ms;
+    char* conversion_end_ptr;
 
-    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
-    for(size_t i = 0; i < line_count; ++i) {
-        strncat(buf, APP_HELP_MSG[i], APP_TEMP_MSG_BUF_SIZE - strnlen(buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-        if(i != line_count - 1) { // no NL at the end of t buffer (app_send_to_client() is responsible for adding it)
-            strncat(buf, "\n", APP_TEMP_MSG_BUF_SIZE - strnlen(buf, APP_TEMP_MSG_BUF_SIZE) - 1);
-        }
+    if(argc != APP_SENSOR_SUBSCRIBE_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'sensor subscribe' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
     }
-    app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
-}
-
-/************* Event handlers for Server *************/
 
-/* Welcome the user and notify other users about the new client (broadcast a message) */
-void handle_client_connect(void* ctx, const ServerClient_t client) {
-    Server_t* _ctx = (Server_t*)ctx;
+    // Try converting the first parameter into the sensor ID
+    errno = 0;
+    unsigned long sensor_id_ul = strtoul(*argv, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *argv) {
+        log_error("failed to convert sensor ID str into a number (errno: %s)", strerror(errno));
+        app_send_to_client(client, "failed to convert the sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(sensor_id_ul >= app_ctx.sensors.count) {
+        log_error("sensor ID invalid (val: %lu)", sensor_id_ul);
+        app_send_to_client(client, "invalid sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    }
+    id = (uint8_t)sensor_id_ul; // sensor_id_ul is below SENSOR_REGISTRY_MAX_SENSORS so it's safe to cast
 
-    log_debug("handle_client_connect called");
+    // Try converting the second parameter into the sampling period
+    errno = 0;
+    unsigned long period_ul = strtoul(*(argv + 1), &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *(argv + 1)) {
+        log_error("failed to convert period str into a number (errno: %s)", strerror(errno));
+        app_send_to_client(client, "failed to convert the period", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(period_ul < APP_SUBSCRIBE_MIN_PERIOD_MS || period_ul > APP_SUBSCRIBE_MAX_PERIOD_MS) {
+        char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "period outside the supported range (%u - %u ms)",
+        APP_SUBSCRIBE_MIN_PERIOD_MS, APP_SUBSCRIBE_MAX_PERIOD_MS);
+        log_error("period outside the supported range (val: %lu)", period_ul);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+    period_ms = (uint32_t)period_ul; // period_ul is below APP_SUBSCRIBE_MAX_PERIOD_MS so it's safe to cast
 
-    // Get the IP address of the new client
-    char ip_str[IPV4_ADDRSTR_LENGTH];
-    ServerError_t err_s = server_get_client_ip(client, ip_str);
-    if(err_s != SERVER_ERR_OK) {
-        log_error("server_get_client_ip failed (ret: %d)", err_s);
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    SubscriptionError_t err_sub = subscription_add(&app_ctx.subscriptions, *client, id, period_ms);
+    if(err_sub == SUBSCRIPTION_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "subscribed to sensor #%hu (period: %u ms)", id, period_ms);
+        log_info("client (fd: %d) subscribed to sensor #%hu (period: %u ms)", client->fd, id, period_ms);
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    } else if(err_sub == SUBSCRIPTION_ERR_TABLE_FULL) {
+        log_error("subscription table full (sensor id: %hu)", id);
+        app_send_to_client(client, "too many subscriptions, please try again later", APP_MSG_TYPE_ERROR);
+    } else {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE,
+        "failed to subscribe to sensor #%hu (subscription_add ret: %d)", id, err_sub);
+        log_error("subscription_add failed (sensor id: %hu, ret: %d)", id, err_sub);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    }
+}
+
+void handle_sensor_unsubscribe(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to handle_sensor_unsubscribe");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'sensor unsubscribe' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'sensor unsubscribe' cmd received (client IP: failed to retrieve)");
+    }
+
+    uint8_t id;
+    char* conversion_end_ptr;
+
+    if(argc != APP_SENSOR_UNSUBSCRIBE_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'sensor unsubscribe' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Try converting the first parameter into the sensor ID
+    errno = 0;
+    unsigned long sensor_id_ul = strtoul(*argv, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *argv) {
+        log_error("failed to convert sensor ID str into a number (errno: %s)", strerror(errno));
+        app_send_to_client(client, "failed to convert the sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(sensor_id_ul >= app_ctx.sensors.count) {
+        log_error("sensor ID invalid (val: %lu)", sensor_id_ul);
+        app_send_to_client(client, "invalid sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    }
+    id = (uint8_t)sensor_id_ul; // sensor_id_ul is below SENSOR_REGISTRY_MAX_SENSORS so it's safe to cast
+
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    SubscriptionError_t err_sub = subscription_remove(&app_ctx.subscriptions, *client, id);
+    if(err_sub == SUBSCRIPTION_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "unsubscribed from sensor #%hu", id);
+        log_info("client (fd: %d) unsubscribed from sensor #%hu", client->fd, id);
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    } else if(err_sub == SUBSCRIPTION_ERR_NOT_FOUND) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "not subscribed to sensor #%hu", id);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    } else {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE,
+        "failed to unsubscribe from sensor #%hu (subscription_remove ret: %d)", id, err_sub);
+        log_error("subscription_remove failed (sensor id: %hu, ret: %d)", id, err_sub);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    }
+}
+
+void handle_sensor_profile(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to handle_sensor_profile");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'sensor profile' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'sensor profile' cmd received (client IP: failed to retrieve)");
+    }
+
+    uint8_t id;
+    char* conversion_end_ptr;
+
+    if(argc != APP_SENSOR_PROFILE_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'sensor profile' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Try converting the first parameter into the sensor ID
+    errno = 0;
+    unsigned long sensor_id_ul = strtoul(*argv, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *argv) {
+        log_error("failed to convert sensor ID str into a number (errno: %s)", strerror(errno));
+        app_send_to_client(client, "failed to convert the sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(sensor_id_ul >= app_ctx.sensors.count) {
+        log_error("sensor ID invalid (val: %lu)", sensor_id_ul);
+        app_send_to_client(client, "invalid sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    }
+    id = (uint8_t)sensor_id_ul; // sensor_id_ul is below SENSOR_REGISTRY_MAX_SENSORS so it's safe to cast
+
+    // Try converting the second parameter into the profile
+    SensorProfile_t profile;
+    if(sensor_profile_from_name(*(argv + 1), &profile) != SENSOR_ERR_OK) {
+        log_error("unsupported measurement profile ('%.20s')", *(argv + 1));
+        app_send_to_client(client, "unsupported profile [high-precision/low-latency/weather-station]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    SensorError_t err_s = sensor_registry_set_profile(&app_ctx.sensors, id, profile);
+    if(err_s == SENSOR_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "sensor #%hu profile set to %s", id, sensor_profile_name(profile));
+        log_info("sensor #%hu profile set to %s", id, sensor_profile_name(profile));
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    } else if(err_s == SENSOR_ERR_NOT_SUPPORTED) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "profiles not supported by sensor #%hu", id);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    } else {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to set the profile of sensor #%hu (sensor_registry_set_profile ret: %d)",
+        id, err_s);
+        log_error("sensor_registry_set_profile failed (sensor id: %hu, ret: %d)", id, err_s);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    }
+}
+
+void handle_sensor_history(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to handle_sensor_history");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'sensor history' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'sensor history' cmd received (client IP: failed to retrieve)");
+    }
+
+    uint8_t id;
+    char* conversion_end_ptr;
+
+    if(argc != APP_SENSOR_HISTORY_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'sensor history' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Try converting the first parameter into the sensor ID
+    errno = 0;
+    unsigned long sensor_id_ul = strtoul(*argv, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == *argv) {
+        log_error("failed to convert sensor ID str into a number (errno: %s)", strerror(errno));
+        app_send_to_client(client, "failed to convert the sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(sensor_id_ul >= app_ctx.sensors.count) {
+        log_error("sensor ID invalid (val: %lu)", sensor_id_ul);
+        app_send_to_client(client, "invalid sensor ID", APP_MSG_TYPE_ERROR);
+        return;
+    }
+    id = (uint8_t)sensor_id_ul; // sensor_id_ul is below SENSOR_REGISTRY_MAX_SENSORS so it's safe to cast
+
+    // Select the requested quantity (a single value column is scanned per query)
+    const char* arg = *(argv + 1);
+    SensorHistoryQty_t qty;
+    const char* unit;
+    if(strncasecmp(arg, APP_TEMP_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        qty = SENSOR_HISTORY_TEMP;
+        unit = "*C";
+    } else if(strncasecmp(arg, APP_HUM_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        qty = SENSOR_HISTORY_HUM;
+        unit = "%";
+    } else if(strncasecmp(arg, APP_PRESS_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        qty = SENSOR_HISTORY_PRESS;
+        unit = "Pa";
+    } else {
+        log_error("unsupported measurement type ('%.20s')", arg);
+        app_send_to_client(client, "unsupported measurement type [temp/hum/press]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Try converting the window and the bucket lengths (e.g. 1d and 1h)
+    uint32_t window_s, bucket_s;
+    if(!app_parse_duration_s(*(argv + 2), &window_s) || !app_parse_duration_s(*(argv + 3), &bucket_s)) {
+        log_error("failed to convert the window/bucket length ('%.20s', '%.20s')", *(argv + 2), *(argv + 3));
+        app_send_to_client(client, "invalid window or bucket length [e.g. 3600, 90m, 1d]", APP_MSG_TYPE_ERROR);
+        return;
+    } else if(bucket_s > window_s || (window_s + bucket_s - 1) / bucket_s > APP_HISTORY_MAX_BUCKETS) {
+        log_error("invalid window/bucket length (window: %u s, bucket: %u s)", window_s, bucket_s);
+        char buf[APP_TEMP_MSG_BUF_SIZE];
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "too many buckets (max: %d) or bucket longer than the window",
+        APP_HISTORY_MAX_BUCKETS);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // The buckets and the response are too big for the dispatcher's stack
+    SensorHistoryBucket_t* buckets = malloc(APP_HISTORY_MAX_BUCKETS * sizeof(SensorHistoryBucket_t));
+    char* buf = malloc(APP_HISTORY_MSG_BUF_SIZE);
+    if(!buckets || !buf) {
+        log_error("failed to allocate the 'sensor history' buffers");
+        app_send_to_client(client, APP_GENERIC_FAILURE_MSG, APP_MSG_TYPE_ERROR);
+        free(buckets);
+        free(buf);
+        return;
+    }
+
+    const int64_t to_ms = app_realtime_ms();
+    size_t count = 0;
+    SensorHistoryError_t err_h = sensor_history_query(&app_ctx.history[id], qty, to_ms - (int64_t)window_s * 1000,
+    to_ms, bucket_s * 1000, buckets, APP_HISTORY_MAX_BUCKETS, &count);
+    if(err_h != SENSOR_HISTORY_ERR_OK) {
+        log_error("sensor_history_query failed (sensor id: %hu, ret: %d)", id, err_h);
+        snprintf(buf, APP_HISTORY_MSG_BUF_SIZE, "failed to query the history of sensor #%hu (sensor_history_query ret: %d)",
+        id, err_h);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        free(buckets);
+        free(buf);
+        return;
+    }
+
+    // One line per non-empty bucket: <bucket start (unix time in s)> <min> <avg> <max>
+    StrBuf_t sb;
+    strbuf_init(&sb, buf, APP_HISTORY_MSG_BUF_SIZE);
+    strbuf_appendf(&sb, "sensor #%hu %s [%s] over the last %u s (bucket: %u s; start min avg max):", id, arg, unit,
+    window_s, bucket_s);
+    size_t non_empty = 0;
+    char min[SENSOR_CENTI_STR_SIZE], avg[SENSOR_CENTI_STR_SIZE], max[SENSOR_CENTI_STR_SIZE];
+    for(size_t i = 0; i < count; ++i) {
+        if(buckets[i].count == 0) {
+            continue;
+        }
+        app_format_history_value(min, qty, buckets[i].min);
+        app_format_history_value(avg, qty, buckets[i].avg);
+        app_format_history_value(max, qty, buckets[i].max);
+        strbuf_appendf(&sb, "\n%lld %s %s %s", (long long)(buckets[i].start_ms / 1000), min, avg, max);
+        ++non_empty;
+    }
+
+    if(non_empty == 0) {
+        snprintf(buf, APP_HISTORY_MSG_BUF_SIZE, "no %s history of sensor #%hu over the last %u s", arg, id, window_s);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    } else {
+        log_debug("sensor #%hu history returned %zu of %zu buckets", id, non_empty, count);
+        app_send_to_client_len(client, sb.data, sb.len, APP_MSG_TYPE_INFO);
+    }
+    free(buckets);
+    free(buf);
+}
+
+void handle_server_status(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to handle_server_status");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server status' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server status' cmd received (client IP: failed to retrieve)");
+    }
+
+    SysstatMemInfo_t mem_stats;
+    SysstatNetInfo_t net_stats;
+    SysstatUptimeInfo_t time_stats;
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+
+    SysstatError_t err_stat = sysstat_get_mem_info_cached(&app_ctx.sysstat, &mem_stats);
+    if(err_stat != SYSSTAT_ERR_OK) {
+        log_error("sysstat_get_mem_info_cached failed (ret: %d)", err_stat);
+        sprintf(buf, "failed to retrieve memory stats (sysstat_get_mem_info_cached ret: %d)", err_stat);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    err_stat = sysstat_get_net_info_cached(&app_ctx.sysstat, NET_INTERFACE_NAME, &net_stats);
+    if(err_stat != SYSSTAT_ERR_OK) {
+        log_error("sysstat_get_net_info_cached failed (ret: %d)", err_stat);
+        sprintf(buf, "failed to retrieve network stats (sysstat_get_net_info_cached ret: %d)", err_stat);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    err_stat = sysstat_get_uptime_info_cached(&app_ctx.sysstat, &time_stats);
+    if(err_stat != SYSSTAT_ERR_OK) {
+        log_error("sysstat_get_uptime_info_cached failed (ret: %d)", err_stat);
+        sprintf(buf, "failed to retrieve uptime stats (sysstat_get_uptime_info_cached ret: %d)", err_stat);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Check the number of connected clients
+    uint32_t clients_count = 0;
+    ServerError_t err_s = server_get_client_count(&app_ctx.server, &clients_count);
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_get_client_count failed (ret: %d)", err_s);
+        sprintf(buf, "failed to retrieve the number of clients (server_get_client_count ret: %d)", err_s);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    StrBuf_t sb;
+    strbuf_init(&sb, buf, sizeof(buf));
+    strbuf_appendf(&sb, "Mem %lu kB/%lu kB (available/total) | Net tx: %lu kB, rx: %lu kB | Uptime %u.%03hu s\n",
+    mem_stats.available_kB, mem_stats.total_kB, net_stats.tx_bytes / 1000, net_stats.rx_bytes / 1000, time_stats.up.s,
+    time_stats.up.ms);
+    strbuf_appendf(&sb, "connected clients: %u", clients_count);
+    app_send_to_client_len(client, sb.data, sb.len, APP_MSG_TYPE_INFO);
+}
+
+void handle_server_uptime(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_uptime");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server uptime' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server uptime' cmd received (client IP: failed to retrieve)");
+    }
+
+    SysstatUptimeInfo_t time_stats;
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+
+    SysstatError_t err_stat = sysstat_get_uptime_info_cached(&app_ctx.sysstat, &time_stats);
+    if(err_stat != SYSSTAT_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to retrieve uptime info (sysstat_get_uptime_info_cached ret: %d)", err_stat);
+        log_error("sysstat_get_uptime_info_cached failed (ret: %d)", err_stat);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    } else {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "uptime %u.%03hu s", time_stats.up.s, time_stats.up.ms);
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    }
+}
+
+void handle_server_net(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_net");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server net' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server net' cmd received (client IP: failed to retrieve)");
+    }
+
+    SysstatNetInfo_t net_stats;
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+
+    SysstatError_t err_stat = sysstat_get_net_info_cached(&app_ctx.sysstat, NET_INTERFACE_NAME, &net_stats);
+    if(err_stat != SYSSTAT_ERR_OK) {
+        sprintf(buf, "failed to retrieve network stats (sysstat_get_net_info_cached ret: %d)", err_stat);
+        log_error("sysstat_get_net_info_cached failed (ret: %d)", err_stat);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    } else {
+        sprintf(buf, "net tx: %lu kB (%lu packets), rx: %lu kB (%lu packets)", net_stats.tx_bytes / 1000,
+        net_stats.rx_packets, net_stats.rx_bytes / 1000, net_stats.tx_packets);
+        app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+    }
+}
+
+void handle_server_stats(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_stats");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server stats' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server stats' cmd received (client IP: failed to retrieve)");
+    }
+
+    // The stats are served from the last sample of the background collector (procfs is not read here)
+    SysstatSample_t sample;
+    char buf[APP_TEMP_MSG_BUF_SIZE];
+    SysstatError_t err_stat = sysstat_collector_get_latest(&app_ctx.collector, &sample);
+    if(err_stat != SYSSTAT_ERR_OK) {
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to retrieve system stats (sysstat_collector_get_latest ret: %d)", err_stat);
+        log_error("sysstat_collector_get_latest failed (ret: %d)", err_stat);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    StrBuf_t sb;
+    strbuf_init(&sb, buf, sizeof(buf));
+    strbuf_appendf(&sb, "cpu: %hu.%hu %% | mem: %lu kB/%lu kB (available/total)", sample.cpu_load_permille / 10,
+    sample.cpu_load_permille % 10, sample.mem.available_kB, sample.mem.total_kB);
+    if(sample.has_temp) {
+        strbuf_appendf(&sb, " | temp: %.1f *C", sample.temp_mC / 1000.0);
+    } else {
+        strbuf_append_str(&sb, " | temp: n/a");
+    }
+    if(sample.has_net) {
+        strbuf_appendf(&sb, " | net tx: %lu B/s, rx: %lu B/s", sample.tx_Bps, sample.rx_Bps);
+    } else {
+        strbuf_append_str(&sb, " | net: n/a (interface " NET_INTERFACE_NAME " not found)");
+    }
+    app_send_to_client_len(client, sb.data, sb.len, APP_MSG_TYPE_INFO);
+}
+
+void handle_server_rates(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_rates");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server rates' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server rates' cmd received (client IP: failed to retrieve)");
+    }
+
+    // Rates over the short history windows (computed from the samples kept by the background collector)
+    const uint32_t windows_ms[] = { APP_SYSSTAT_COLLECT_INTERVAL_MS, APP_SYSSTAT_RATE_SHORT_WINDOW_MS,
+        APP_SYSSTAT_RATE_LONG_WINDOW_MS };
+    char buf[APP_TEMP_MSG_BUF_SIZE];
+    StrBuf_t sb;
+    strbuf_init(&sb, buf, sizeof(buf));
+    strbuf_append_str(&sb, "window: net tx, rx, cpu");
+    for(size_t i = 0; i < sizeof(windows_ms) / sizeof(windows_ms[0]); i++) {
+        SysstatRates_t rates;
+        SysstatError_t err_stat = sysstat_collector_get_rates(&app_ctx.collector, windows_ms[i], &rates);
+        if(err_stat != SYSSTAT_ERR_OK) {
+            snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to retrieve rates (sysstat_collector_get_rates ret: %d)", err_stat);
+            log_error("sysstat_collector_get_rates failed (ret: %d)", err_stat);
+            app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+            return;
+        }
+        strbuf_appendf(&sb, " | %u.%u s: %lu B/s, %lu B/s, %hu.%hu %%", rates.window_ms / 1000, (rates.window_ms % 1000) / 100,
+        rates.tx_Bps, rates.rx_Bps, rates.cpu_load_permille / 10, rates.cpu_load_permille % 10);
+    }
+    app_send_to_client_len(client, sb.data, sb.len, APP_MSG_TYPE_INFO);
+}
+
+void handle_server_disconnect(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_disconnect");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server disconnect' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server disconnect' cmd received (client IP: failed to retrieve)");
+    }
+
+    app_send_to_client(client, "disconnecting from the server...", APP_MSG_TYPE_INFO);
+
+    ServerError_t err_s = app_drop_client(*client);
+    if(err_s != SERVER_ERR_OK) {
+        char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+        sprintf(buf, "failed to disconnect from the server (server_disconnect ret: %d)", err_s);
+        log_error("server_disconnect failed (ret: %d)", err_s);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+    }
+}
+
+void handle_server_log(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_log");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server log' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server log' cmd received (client IP: failed to retrieve)");
+    }
+
+    if(argc != APP_SERVER_LOG_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'server log' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    int level;
+    if(!log_level_from_name(argv[1], &level)) {
+        log_error("invalid log level in the 'server log' cmd");
+        app_send_to_client(client, "invalid log level [debug/info/error/none]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+    if(strcmp(argv[0], APP_LOG_ALL_MODULES) == 0) {
+        for(int i = 0; i < LOG_MODULE_COUNT; i++) {
+            log_set_level((LogModule_t)i, level);
+        }
+    } else {
+        LogModule_t module;
+        if(!log_module_from_name(argv[0], &module)) {
+            log_error("invalid log module in the 'server log' cmd");
+            app_send_to_client(client, "invalid log module", APP_MSG_TYPE_ERROR);
+            return;
+        }
+        log_set_level(module, level);
+    }
+
+    snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "log level of '%.32s' set to '%.8s'", argv[0], argv[1]);
+    app_send_to_client(client, buf, APP_MSG_TYPE_INFO);
+}
+
+void handle_server_proto(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_proto");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server proto' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server proto' cmd received (client IP: failed to retrieve)");
+    }
+
+    if(argc != APP_SERVER_PROTO_ARG_COUNT) {
+        log_error("incorrect number of arguments in the 'server proto' cmd");
+        app_send_to_client(client, "incorrect number of arguments [use server help for manual]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    if(strncasecmp(*argv, APP_PROTO_TEXT_STRING, DISPATCHER_ARG_MAX_SIZE) == 0) {
+        app_send_to_client(client, "already using the text protocol", APP_MSG_TYPE_INFO);
+        return;
+    } else if(strncasecmp(*argv, APP_PROTO_BIN_STRING, DISPATCHER_ARG_MAX_SIZE) != 0) {
+        log_error("unsupported protocol ('%.20s')", *argv);
+        app_send_to_client(client, "unsupported protocol [bin/text]", APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    // Confirm in text first - everything after this command (even if already received) is read as frames
+    app_send_to_client(client, "switched to the binary protocol", APP_MSG_TYPE_INFO);
+    ServerError_t err_s = server_set_framing(&app_ctx.server, *client, SERVER_FRAMING_LENGTH_PREFIXED);
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_set_framing failed (ret: %d)", err_s);
+        return;
+    }
+    log_info("client (fd: %d) switched to the binary protocol", client->fd);
+}
+
+void handle_server_metrics(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to the handle_server_metrics");
+        return;
+    }
+
+    // The cmd context carries details about the client that invoked the command
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server metrics' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server metrics' cmd received (client IP: failed to retrieve)");
+    }
+
+    // Merge the per-thread shards (the recording threads are never blocked by this)
+    MetricsSnapshot_t snap;
+    MetricsError_t err_m = metrics_snapshot(&snap);
+    if(err_m != METRICS_ERR_OK) {
+        char buf[APP_TEMP_MSG_BUF_SIZE];
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "failed to retrieve metrics (metrics_snapshot ret: %d)", err_m);
+        log_error("metrics_snapshot failed (ret: %d)", err_m);
+        app_send_to_client(client, buf, APP_MSG_TYPE_ERROR);
+        return;
+    }
+
+    char buf[APP_METRICS_MSG_BUF_SIZE];
+    StrBuf_t sb;
+    strbuf_init(&sb, buf, sizeof(buf));
+    metrics_render_text(&snap, &sb);
+    app_send_to_client_len(client, sb.data, sb.len, APP_MSG_TYPE_INFO);
+}
+
+void handle_server_help(char** argv, uint32_t argc, const void* cmd_ctx) {
+    if(!cmd_ctx) {
+        log_error("NULL context provided to handle_server_help");
+        return;
+    }
+
+    ServerClient_t* client = (ServerClient_t*)cmd_ctx;
+
+    char ip_str[IP_ADDRSTR_LENGTH];
+    if(server_get_client_ip(*client, ip_str) == SERVER_ERR_OK) {
+        log_info("'server help' cmd received (client IP: %s)", ip_str);
+    } else {
+        log_info("'server help' cmd received (client IP: failed to retrieve)");
+    }
+
+    // The man page is rendered once on init, so it is only handed over to the server here
+    app_send_to_client_len(client, app_ctx.help_msg, app_ctx.help_msg_len, APP_MSG_TYPE_INFO);
+}
+
+/************* Callbacks for the subscription scheduler *************/
+
+/* Take one sample from the sensor and render it into a message shared by all the subscribers */
+bool handle_subscription_sample(const uint8_t sensor_id, char* buf, const size_t buf_len) {
+    SensorReading_t r;
+    SensorError_t err_s = sensor_registry_read(&app_ctx.sensors, sensor_id, &r);
+    if(err_s != SENSOR_ERR_OK) {
+        log_error("sensor_registry_read failed (sensor id: %hu, ret: %d)", sensor_id, err_s);
+        snprintf(buf, buf_len, "failed to read measurements from sensor #%hu (sensor_registry_read ret: %d)", sensor_id,
+        err_s);
+        return false;
+    }
+
+    char temp[SENSOR_CENTI_STR_SIZE], hum[SENSOR_CENTI_STR_SIZE], press[SENSOR_CENTI_STR_SIZE];
+    app_format_reading(&r, temp, hum, press);
+    snprintf(buf, buf_len, "sensor #%hu sample: temp: %s *C, hum: %s %%, press: %s Pa", sensor_id, temp, hum, press);
+    return true;
+}
+
+/* Push the rendered sample to the subscriber */
+bool handle_subscription_deliver(const ServerClient_t* client, const char* msg, const bool sample_ok) {
+    ServerError_t err_s = app_send_to_client(client, msg, (sample_ok ? APP_MSG_TYPE_INFO : APP_MSG_TYPE_ERROR));
+    return err_s == SERVER_ERR_OK;
+}
+
+/* Push all pending edge events of the watched line to its watchers (called by the server listening thread) */
+void handle_gpio_event(void* ctx, const int fd, void* arg) {
+    (void)ctx;
+    (void)fd;
+    uint8_t line = (uint8_t)(uintptr_t)arg;
+
+    for(int n = 0; n < APP_GPIO_EVENTS_PER_WAKEUP; n++) {
+        GpioEvent_t event;
+        GpioError_t err_g = gpio_read_event(&app_ctx.gpio, line, &event);
+        if(err_g == GPIO_ERR_NO_EVENT || err_g == GPIO_ERR_NOT_WATCHED) {
+            return; // All events consumed (or the line was unwatched in the meantime)
+        } else if(err_g != GPIO_ERR_OK) {
+            log_error("gpio_read_event failed (line: %hu, ret: %d)", line, err_g);
+            return;
+        }
+
+        char buf[APP_TEMP_MSG_BUF_SIZE] = "";
+        snprintf(buf, APP_TEMP_MSG_BUF_SIZE, "GPIO line %hu event: %s edge (ts: %ld.%09ld)", line,
+        (event.rising ? "rising" : "falling"), (long)event.ts.tv_sec, event.ts.tv_nsec);
+        log_debug("GPIO line %hu event: %s edge", line, (event.rising ? "rising" : "falling"));
+
+        // Take a snapshot of the watchers, so that the lock is not held while sending
+        ServerClient_t clients[APP_GPIO_WATCH_MAX_CLIENTS];
+        uint8_t client_count = 0;
+        if(pthread_mutex_lock(&app_ctx.gpio_watch_lock) != 0) {
+            return;
+        }
+        log_debug("gpio watch lock taken");
+        client_count = app_ctx.gpio_watches[line].client_count;
+        memcpy(clients, app_ctx.gpio_watches[line].clients, client_count * sizeof(ServerClient_t));
+        pthread_mutex_unlock(&app_ctx.gpio_watch_lock);
+        log_debug("gpio watch lock released");
+
+        for(uint8_t i = 0; i < client_count; i++) {
+            if(app_send_to_client(&clients[i], buf, APP_MSG_TYPE_INFO) != SERVER_ERR_OK) {
+                log_error("failed to push a GPIO event to the client (fd: %d); unwatching", clients[i].fd);
+                app_gpio_watch_remove(line, clients[i]);
+            }
+        }
+    }
+}
+
+/* Accept the pending metrics endpoint connections and hand them over to the dispatcher workers (called by the server
+ * listening thread, so the scrapes themselves never block it). At most APP_METRICS_MAX_SCRAPES workers are taken by
+ * the scrapes, the connections above the limit get a 503 right away. */
+void handle_metrics_conn(void* ctx, const int fd, void* arg) {
+    (void)ctx;
+    (void)arg;
+    for(int n = 0; n < APP_METRICS_MAX_CONN_REQUESTS; n++) {
+        int conn_fd = accept(fd, NULL, NULL); // Blocking (O_NONBLOCK of the listener is not inherited)
+        if(conn_fd < 0) {
+            if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error("accept failed on the metrics endpoint (errno: %d)", errno);
+            }
+            return; // All pending connections accepted
+        }
+
+        if(atomic_fetch_add(&app_ctx.metrics_scrapes, 1) >= APP_METRICS_MAX_SCRAPES) {
+            atomic_fetch_sub(&app_ctx.metrics_scrapes, 1);
+            log_error("too many metrics scrapes in progress; connection (fd: %d) refused", conn_fd);
+            send(conn_fd, APP_METRICS_BUSY_RESPONSE, strlen(APP_METRICS_BUSY_RESPONSE), MSG_DONTWAIT | MSG_NOSIGNAL);
+            close(conn_fd);
+            continue;
+        }
+
+        DispatcherError_t err_d = dispatcher_offload(&app_ctx.dispatcher, app_serve_metrics, app_drop_metrics_conn,
+        &conn_fd, sizeof(conn_fd));
+        if(err_d != DISPATCHER_ERR_OK) {
+            log_error("dispatcher_offload failed for a metrics scrape (ret: %d)", err_d);
+            atomic_fetch_sub(&app_ctx.metrics_scrapes, 1);
+            close(conn_fd);
+        }
+    }
+}
+
+/************* Handlers for binary protocol requests *************/
+
+void handle_proto_ping(const ServerClient_t* client, const ProtoRequest_t* req) {
+    app_proto_reply(client, req, PROTO_STATUS_OK, NULL, 0);
+}
+
+void handle_proto_text(const ServerClient_t* client, const ProtoRequest_t* req) {
+    // The response is the last frame, everything after the request (even if already received) is read as lines
+    app_proto_reply(client, req, PROTO_STATUS_OK, NULL, 0);
+    ServerError_t err_s = server_set_framing(&app_ctx.server, *client, SERVER_FRAMING_LINE);
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_set_framing failed (ret: %d)", err_s);
+        return;
+    }
+    log_info("client (fd: %d) switched to the text protocol", client->fd);
+}
+
+void handle_proto_gpio_set(const ServerClient_t* client, const ProtoRequest_t* req) {
+    const uint32_t line = req->argv[0], state = req->argv[1];
+    if(line >= GPIO_LINE_COUNT || state > 1) {
+        app_proto_reply(client, req, PROTO_STATUS_INVALID_ARGUMENT, NULL, 0);
+        return;
+    }
+
+    GpioError_t err_g = gpio_set(&app_ctx.gpio, (uint8_t)line, (uint8_t)state);
+    if(err_g != GPIO_ERR_OK) {
+        log_error("gpio_set failed (line: %u, state: %u, ret: %d)", line, state, err_g);
+        app_proto_reply(client, req, PROTO_STATUS_FAILURE, NULL, 0);
+        return;
+    }
+    app_proto_reply(client, req, PROTO_STATUS_OK, NULL, 0);
+}
+
+void handle_proto_gpio_get(const ServerClient_t* client, const ProtoRequest_t* req) {
+    const uint32_t line = req->argv[0];
+    if(line >= GPIO_LINE_COUNT) {
+        app_proto_reply(client, req, PROTO_STATUS_INVALID_ARGUMENT, NULL, 0);
+        return;
+    }
+
+    uint8_t state;
+    GpioError_t err_g = gpio_get(&app_ctx.gpio, (uint8_t)line, &state);
+    if(err_g != GPIO_ERR_OK) {
+        log_error("gpio_get failed (line: %u, ret: %d)", line, err_g);
+        app_proto_reply(client, req, PROTO_STATUS_FAILURE, NULL, 0);
+        return;
+    }
+    app_proto_reply(client, req, PROTO_STATUS_OK, &state, sizeof(state));
+}
+
+void handle_proto_gpio_setmask(const ServerClient_t* client, const ProtoRequest_t* req) {
+    const uint64_t mask = ((uint64_t)req->argv[1] << 32) | req->argv[0];
+    const uint64_t values = ((uint64_t)req->argv[3] << 32) | req->argv[2];
+    uint8_t lines[GPIO_LINE_COUNT], states[GPIO_LINE_COUNT];
+    size_t count = 0;
+    for(uint8_t line = 0; line < GPIO_LINE_COUNT; line++) {
+        if(mask & (1ULL << line)) {
+            lines[count] = line;
+            states[count++] = (uint8_t)((values >> line) & 1);
+        }
+    }
+    if(count == 0) {
+        app_proto_reply(client, req, PROTO_STATUS_INVALID_ARGUMENT, NULL, 0);
+        return;
+    }
+
+    GpioError_t err_g = gpio_set_bulk(&app_ctx.gpio, lines, states, count);
+    if(err_g != GPIO_ERR_OK) {
+        log_error("gpio_set_bulk failed (mask: 0x%016llX, ret: %d)", (unsigned long long)mask, err_g);
+        app_proto_reply(client, req, PROTO_STATUS_FAILURE, NULL, 0);
+        return;
+    }
+    app_proto_reply(client, req, PROTO_STATUS_OK, NULL, 0);
+}
+
+void handle_proto_gpio_getall(const ServerClient_t* client, const ProtoRequest_t* req) {
+    const uint64_t mask = ((uint64_t)req->argv[1] << 32) | req->argv[0];
+    uint8_t lines[GPIO_LINE_COUNT], states[GPIO_LINE_COUNT];
+    size_t count = 0;
+    for(uint8_t line = 0; line < GPIO_LINE_COUNT; line++) {
+        if(mask & (1ULL << line)) {
+            lines[count++] = line;
+        }
+    }
+    if(count == 0) {
+        app_proto_reply(client, req, PROTO_STATUS_INVALID_ARGUMENT, NULL, 0);
+        return;
+    }
+
+    GpioError_t err_g = gpio_get_bulk(&app_ctx.gpio, lines, states, count);
+    if(err_g != GPIO_ERR_OK) {
+        log_error("gpio_get_bulk failed (mask: 0x%016llX, ret: %d)", (unsigned long long)mask, err_g);
+        app_proto_reply(client, req, PROTO_STATUS_FAILURE, NULL, 0);
+        return;
+    }
+
+    // Return the states as a bitmask of the same layout as the requested lines
+    uint64_t values = 0;
+    for(size_t i = 0; i < count; i++) {
+        values |= (uint64_t)(states[i] ? 1 : 0) << lines[i];
+    }
+    uint8_t payload[2 * sizeof(uint32_t)];
+    proto_put_u32(payload, (uint32_t)values);
+    proto_put_u32(payload + sizeof(uint32_t), (uint32_t)(values >> 32));
+    app_proto_reply(client, req, PROTO_STATUS_OK, payload, sizeof(payload));
+}
+
+void handle_proto_sensor_count(const ServerClient_t* client, const ProtoRequest_t* req) {
+    const uint8_t count = (uint8_t)app_ctx.sensors.count; // At most SENSOR_REGISTRY_MAX_SENSORS
+    app_proto_reply(client, req, PROTO_STATUS_OK, &count, sizeof(count));
+}
+
+void handle_proto_sensor_get(const ServerClient_t* client, const ProtoRequest_t* req) {
+    const uint32_t id = req->argv[0];
+    if(id >= app_ctx.sensors.count) {
+        app_proto_reply(client, req, PROTO_STATUS_INVALID_ARGUMENT, NULL, 0);
+        return;
+    }
+
+    SensorReading_t r;
+    SensorError_t err_s = sensor_registry_read(&app_ctx.sensors, id, &r);
+    if(err_s != SENSOR_ERR_OK) {
+        log_error("sensor_registry_read failed (sensor id: %u, ret: %d)", id, err_s);
+        app_proto_reply(client, req, PROTO_STATUS_FAILURE, NULL, 0);
+        return;
+    }
+    uint8_t payload[PROTO_READING_SIZE];
+    proto_pack_reading(payload, &r);
+    app_proto_reply(client, req, PROTO_STATUS_OK, payload, sizeof(payload));
+}
+
+/************* Event handlers for Server *************/
+
+/* Welcome the user and notify other users about the new client (broadcast a message) */
+void handle_client_connect(void* ctx, const ServerClient_t client) {
+    Server_t* _ctx = (Server_t*)ctx;
+
+    log_debug("handle_client_connect called");
+
+    // Get the IP address of the new client
+    char ip_str[IP_ADDRSTR_LENGTH];
+    ServerError_t err_s = server_get_client_ip(client, ip_str);
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_get_client_ip failed (ret: %d)", err_s);
     }
 
     // Send a welcome message to the user
@@ -569,45 +1775,43 @@ void handle_client_connect(void* ctx, const ServerClient_t client) {
     app_broadcast(msg_connect, APP_MSG_TYPE_INFO);
 }
 
-/* Read received data and pass it to the dispatcher for parsing and executing associated command */
+/* Receive new data and pass every complete line to the dispatcher for parsing and executing associated command */
 void handle_data_received(void* ctx, const ServerClient_t client) {
     Server_t* _ctx = (Server_t*)ctx;
-    char buf[APP_SERVER_RECV_DATA_BUF_SIZE];
     ssize_t len;
 
     log_debug("handle_data_received called");
 
-    // Try reading out the received data
-    ServerError_t err_s = server_read(ctx, client, buf, APP_SERVER_RECV_DATA_BUF_SIZE, &len);
+    // Try receiving the new data into client's buffer
+    ServerError_t err_s = server_receive(_ctx, client, &len);
     if(err_s != SERVER_ERR_OK) {
         log_error("failed to read the incomming data (err: %d)", err_s);
     }
 
-    app_remove_nl(buf); // Remove new line character from the buffer (if present)
-
-    // Try executing the command
-    DispatcherError_t err_d = dispatcher_execute(&app_ctx.dispatcher, buf, &client);
-    switch(err_d) {
-    case DISPATCHER_ERR_OK: {
-        break;
-    }
-    case DISPATCHER_ERR_CMD_INCOMPLETE: {
-        app_send_to_client(&client, APP_CMD_INCOMPLETE_MSG, APP_MSG_TYPE_ERROR);
-        break;
-    }
-    case DISPATCHER_ERR_BUF_TOO_LONG:   // fallthrough
-    case DISPATCHER_ERR_BUF_EMPTY:      // fallthrough
-    case DISPATCHER_ERR_TOKEN_TOO_LONG: // fallthrough
-    case DISPATCHER_ERR_CMD_NOT_FOUND: {
-        app_send_to_client(&client, APP_CMD_ERR_MSG, APP_MSG_TYPE_ERROR);
-        break;
-    }
-    case DISPATCHER_ERR_NULL_ARG:        // fallthrough
-    case DISPATCHER_ERR_PTHREAD_FAILURE: // fallthrough
-    default: {
-        app_send_to_client(&client, APP_GENERIC_FAILURE_MSG, APP_MSG_TYPE_ERROR);
-        break;
-    }
+    // Execute all the commands received so far (many of them may come in a single packet). A command may switch
+    // the protocol, so the framing is checked before every message.
+    ServerFraming_t framing;
+    while(server_get_framing(_ctx, client, &framing) == SERVER_ERR_OK) {
+        if(framing == SERVER_FRAMING_LINE) {
+            char* line;
+            size_t line_len;
+            if(server_get_line(_ctx, client, &line, &line_len) != SERVER_ERR_OK || !line) {
+                break;
+            }
+            app_execute_cmd(&client, line, line_len); // Tokenized in place, straight in the receive buffer
+        } else {
+            uint8_t* frame;
+            size_t frame_len;
+            err_s = server_get_frame(_ctx, client, &frame, &frame_len);
+            if(err_s == SERVER_ERR_FRAME_TOO_LONG) {
+                log_error("framing of the client (fd: %d) lost; disconnecting", client.fd);
+                app_drop_client(client);
+                break;
+            } else if(err_s != SERVER_ERR_OK || !frame) {
+                break;
+            }
+            app_execute_frame(&client, frame, frame_len); // Decoded straight from the receive buffer
+        }
     }
 }
 
@@ -617,40 +1821,21 @@ void handle_client_disconnect(void* ctx, const ServerClient_t client) {
 
     log_debug("handle_client_disconnect called");
 
+    SubscriptionError_t err_sub = subscription_remove_client(&app_ctx.subscriptions, client);
+    if(err_sub != SUBSCRIPTION_ERR_OK) {
+        log_error("subscription_remove_client failed (ret: %d)", err_sub);
+    }
+    app_gpio_watch_remove_client(client);
+
     app_broadcast(APP_DISCONNECT_MSG, APP_MSG_TYPE_INFO);
 }
 
-/* Reinit and restart the whole application controller */
+/* Schedule a restart of the network subsystem (done by the main thread in app_poll(), as the calling server thread
+ * exits right after and cannot wait for the server to shut down) */
 void handle_server_failure(void* ctx, const ServerError_t err) {
-    Server_t* _ctx = (Server_t*)ctx;
-
-    log_info("handle_server_failure called with error: %d", err);
-    log_info("attempting to restart the server");
-
-    // Stop the app controller...
-    AppError_t ret_a = app_stop();
-    if(ret_a != APP_ERR_OK) {
-        log_error("app_stop failed (ret: %d)", ret_a);
-    }
-
-    // Give the app some time margin before reinit is done
-    sleep(10);
-
-    // ...reinit...
-    ret_a = app_deinit();
-    if(ret_a != APP_ERR_OK) {
-        log_error("app_deinit failed (ret: %d)", ret_a);
-    }
-    ret_a = app_init();
-    if(ret_a != APP_ERR_OK) {
-        log_error("app_init failed (ret: %d)", ret_a);
-    }
-
-    // ...and restart it from scratch
-    ret_a = app_run();
-    if(ret_a != APP_ERR_OK) {
-        log_error("app_stop failed (ret: %d)", ret_a);
-    }
+    (void)ctx;
+    log_error("server failure (err: %d); the network subsystem will be restarted", err);
+    atomic_store(&app_ctx.server_failed, true);
 }
 
 
@@ -666,12 +1851,20 @@ AppError_t app_init_server(void) {
     ServerConfig_t server_cfg = { .port = APP_SERVER_PORT,
         .cb_list = server_cb_list,
         .max_clients = APP_SERVER_MAX_CLIENTS,
-        .max_conn_requests = APP_SERVER_MAX_CONN_REQUESTS };
+        .max_conn_requests = APP_SERVER_MAX_CONN_REQUESTS,
+        .mode = APP_SERVER_MODE,
+        .reactor_count = APP_SERVER_REACTOR_COUNT,
+        .rx_buf_size = APP_SERVER_RECV_DATA_BUF_SIZE,
+        .tx_high_water = APP_SERVER_TX_HIGH_WATER,
+        .tx_policy = APP_SERVER_TX_POLICY,
+        .acceptor_count = APP_SERVER_ACCEPTORS,
+        .socket_activation = APP_SERVER_SOCKET_ACTIVATION };
 
     ServerError_t err_s = server_init(&app_ctx.server, server_cfg);
     if(err_s == SERVER_ERR_OK) {
         log_debug("server initialized successfully (port: %s, max clients: %d, max conn requests: %d)",
         APP_SERVER_PORT, APP_SERVER_MAX_CLIENTS, APP_SERVER_MAX_CONN_REQUESTS);
+        app_ctx.server_initialized = true;
     } else {
         log_error("failed to initialize the server (err: %d)", err_s);
         return APP_ERR_SERVER_FAILURE;
@@ -683,24 +1876,41 @@ AppError_t app_init_server(void) {
 // Initialize the command dispatcher
 AppError_t app_init_dispatcher(void) {
     // Configure dispatcher parameters and supported commands
-    const DispatcherConfig_t cfg = { .delim = APP_DISPATCHER_DELIM };
+    const DispatcherConfig_t cfg = { .delim = APP_DISPATCHER_DELIM,
+        .worker_count = APP_DISPATCHER_WORKERS,
+        .queue_len = APP_DISPATCHER_QUEUE_LEN,
+        .cmd_ctx_size = sizeof(ServerClient_t) }; // Offloaded handlers get a copy of the client handle
 
-    const DispatcherCommandDef_t cmd_list[] = { // List of all commands to be supported
+    const DispatcherCommandDef_t cmd_list[] = { // List of all commands to be supported (slow ones are offloaded)
         { .target = "gpio", .action = "set", .callback_ptr = handle_gpio_set },
         { .target = "gpio", .action = "get", .callback_ptr = handle_gpio_get },
+        { .target = "gpio", .action = "setmask", .callback_ptr = handle_gpio_setmask },
+        { .target = "gpio", .action = "getall", .callback_ptr = handle_gpio_getall },
+        { .target = "gpio", .action = "watch", .callback_ptr = handle_gpio_watch },
+        { .target = "gpio", .action = "unwatch", .callback_ptr = handle_gpio_unwatch },
         { .target = "sensor", .action = "list", .callback_ptr = handle_sensor_list },
-        { .target = "sensor", .action = "get", .callback_ptr = handle_sensor_get },
+        { .target = "sensor", .action = "get", .callback_ptr = handle_sensor_get, .offload = true },
+        { .target = "sensor", .action = "subscribe", .callback_ptr = handle_sensor_subscribe },
+        { .target = "sensor", .action = "unsubscribe", .callback_ptr = handle_sensor_unsubscribe },
+        { .target = "sensor", .action = "profile", .callback_ptr = handle_sensor_profile, .offload = true },
+        { .target = "sensor", .action = "history", .callback_ptr = handle_sensor_history, .offload = true },
         { .target = "server", .action = "status", .callback_ptr = handle_server_status },
         { .target = "server", .action = "uptime", .callback_ptr = handle_server_uptime },
         { .target = "server", .action = "net", .callback_ptr = handle_server_net },
+        { .target = "server", .action = "stats", .callback_ptr = handle_server_stats },
+        { .target = "server", .action = "rates", .callback_ptr = handle_server_rates },
         { .target = "server", .action = "disconnect", .callback_ptr = handle_server_disconnect },
+        { .target = "server", .action = "proto", .callback_ptr = handle_server_proto },
+        { .target = "server", .action = "log", .callback_ptr = handle_server_log },
+        { .target = "server", .action = "metrics", .callback_ptr = handle_server_metrics },
         { .target = "server", .action = "help", .callback_ptr = handle_server_help }
     };
 
     // Initialize the dispatcher
     DispatcherError_t err_d = dispatcher_init(&app_ctx.dispatcher, cfg);
     if(err_d == DISPATCHER_ERR_OK) {
-        log_debug("dispatcher initialized successfully (delim: %s)", APP_DISPATCHER_DELIM);
+        log_debug("dispatcher initialized successfully (delim: %s, workers: %d)", APP_DISPATCHER_DELIM, APP_DISPATCHER_WORKERS);
+        app_ctx.dispatcher_initialized = true;
     } else {
         log_error("failed to initialize the dispatcher (err: %d)", err_d);
         return APP_ERR_DISPATCHER_FAILURE;
@@ -711,6 +1921,10 @@ AppError_t app_init_dispatcher(void) {
         err_d = dispatcher_register(&app_ctx.dispatcher, i, cmd_list[i]);
         if(err_d == DISPATCHER_ERR_OK) {
             log_debug("cmd %.30s|%.30s registered successfully", cmd_list[i].target, cmd_list[i].action);
+            // Name used by the metrics renders (not kept if the registry is not initialized, e.g. in unit tests)
+            char name[METRICS_CMD_NAME_SIZE];
+            snprintf(name, sizeof(name), "%.15s %.15s", cmd_list[i].target, cmd_list[i].action);
+            metrics_set_cmd_name(i, name);
         } else {
             log_error("failed to initialize the %.30s|%.30s cmd (err: %d)", cmd_list[i].target, cmd_list[i].action, err_d);
             return APP_ERR_DISPATCHER_FAILURE;
@@ -720,23 +1934,78 @@ AppError_t app_init_dispatcher(void) {
     return APP_ERR_OK;
 }
 
-// Zero out ctx, Init the server
-AppError_t app_init() {
-    // Zero out context on init
-    memset(&app_ctx, 0, sizeof(App_t));
+// Initialize the sensor subscription table
+AppError_t app_init_subscriptions(void) {
+    const SubscriptionConfig_t cfg = { .max_count = APP_SUBSCRIBE_MAX_COUNT,
+        .min_period_ms = APP_SUBSCRIBE_MIN_PERIOD_MS,
+        .max_period_ms = APP_SUBSCRIBE_MAX_PERIOD_MS,
+        .sample = handle_subscription_sample,
+        .deliver = handle_subscription_deliver };
+
+    SubscriptionError_t err_sub = subscription_init(&app_ctx.subscriptions, cfg);
+    if(err_sub == SUBSCRIPTION_ERR_OK) {
+        log_debug("subscription table initialized successfully (max subscriptions: %d)", APP_SUBSCRIBE_MAX_COUNT);
+    } else {
+        log_error("failed to initialize the subscription table (err: %d)", err_sub);
+        return APP_ERR_SUBSCRIPTION_FAILURE;
+    }
 
-    // Initialize the server
-    AppError_t err_app = app_init_server();
+    return APP_ERR_OK;
+}
+
+// Render the help/man message (its lines never change) into the app context
+STATIC void app_init_help_msg(void) {
+    const size_t line_count = sizeof(APP_HELP_MSG) / sizeof(APP_HELP_MSG[0]);
+
+    StrBuf_t sb;
+    strbuf_init(&sb, app_ctx.help_msg, sizeof(app_ctx.help_msg));
+    for(size_t i = 0; i < line_count; ++i) {
+        if(i != 0) { // no NL at the end of the buffer (app_send_to_client() is responsible for adding it)
+            strbuf_append(&sb, "\n", 1);
+        }
+        strbuf_append_str(&sb, APP_HELP_MSG[i]);
+    }
+    if(sb.truncated) {
+        log_error("help message truncated to %zu bytes (APP_HELP_MSG_BUF_SIZE too small)", sb.len);
+    }
+    app_ctx.help_msg_len = sb.len;
+}
+
+// Initialize the dispatcher, the subscription table and the system stats (everything except the server and the hw)
+STATIC AppError_t app_init_services(void) {
+    // Initialize the dispatcher
+    AppError_t err_app = app_init_dispatcher();
     if(err_app != APP_ERR_OK) {
         return err_app;
     }
 
-    // Initialize the dispatcher
-    err_app = app_init_dispatcher();
+    // Initialize the sensor subscription table
+    err_app = app_init_subscriptions();
     if(err_app != APP_ERR_OK) {
         return err_app;
     }
 
+    // Initialize the system stats readers (the /proc files are kept open)
+    SysstatError_t err_stat = sysstat_init(&app_ctx.sysstat, APP_SYSSTAT_TTL_MS);
+    if(err_stat == SYSSTAT_ERR_OK) {
+        log_debug("sysstat initialized successfully (ttl: %d ms)", APP_SYSSTAT_TTL_MS);
+    } else {
+        log_error("failed to initialize sysstat (err: %d)", err_stat);
+        return APP_ERR_SYSSTAT_FAILURE;
+    }
+    err_stat = sysstat_collector_start(&app_ctx.collector, NET_INTERFACE_NAME, APP_SYSSTAT_COLLECT_INTERVAL_MS);
+    if(err_stat == SYSSTAT_ERR_OK) {
+        log_debug("sysstat collector started successfully (interval: %d ms)", APP_SYSSTAT_COLLECT_INTERVAL_MS);
+    } else {
+        log_error("failed to start the sysstat collector (err: %d)", err_stat);
+        return APP_ERR_SYSSTAT_FAILURE;
+    }
+
+    return APP_ERR_OK;
+}
+
+// Initialize the GPIO driver, the buses and the sensors (incl. their histories and samplers)
+STATIC AppError_t app_init_hardware(void) {
     // Initialize the GPIO driver
     GpioError_t err_g = gpio_init(&app_ctx.gpio);
     if(err_g != GPIO_ERR_OK) {
@@ -755,26 +2024,141 @@ AppError_t app_init() {
 #endif
     }
 
-    // Initialize all bme280 sensors defined in the sensors_config.h configuration file
-    HwInterface_t hw_if;
+    // Initialize the spi (only if any of the configured sensors is connected to it)
+    bool spi_used = false;
     for(int i = 0; i < BME280_COUNT; ++i) {
+        spi_used |= (SENSORS_CONFIG_BME280[i].if_type == HW_INTERFACE_SPI);
+    }
+    if(spi_used) {
+        SPIBusConfig_t spi_cfg = { .spi_bus = PIHUB_SPI_BUS,
+            .spi_cs = PIHUB_SPI_CS,
+            .speed_hz = PIHUB_SPI_SPEED_HZ,
+            .mode = PIHUB_SPI_MODE,
+#ifdef PIHUB_SPI_GPIO_CS
+            .cs_gpio = &app_ctx.gpio
+#endif
+        };
+        HwInterfaceError_t err_spi = hw_interface_init_spi(&app_ctx.spi, spi_cfg);
+        if(err_spi != HW_INTERFACE_ERR_OK) {
+            log_error("hw_interface_init_spi failed (err: %d)", err_spi);
+#ifdef APP_INIT_RET_ON_HW_FAILURE
+            return APP_ERR_HW_INTERFACE_FAILURE;
+#endif
+        }
+        app_ctx.spi_initialized = (err_spi == HW_INTERFACE_ERR_OK);
+    }
+
+    // Register all bme280 sensors defined in the sensors_config.h configuration file
+    // The bus instances are shared by all the sensors connected to them (single lock and cached slave address per bus)
+    sensor_registry_init(&app_ctx.sensors);
+    for(int i = 0; i < BME280_COUNT; ++i) {
+        HwInterface_t* hw_if = NULL;
         if(SENSORS_CONFIG_BME280[i].if_type == HW_INTERFACE_I2C) {
-            hw_if = app_ctx.i2c;
+            hw_if = &app_ctx.i2c;
         } else if(SENSORS_CONFIG_BME280[i].if_type == HW_INTERFACE_SPI) {
-            hw_if = app_ctx.spi;
+            hw_if = &app_ctx.spi;
         }
-        SensorError_t err_s = bme280_init(&app_ctx.sens_bme280[i], SENSORS_CONFIG_BME280[i].addr, hw_if);
+        SensorError_t err_s = sensor_registry_add(&app_ctx.sensors, &BME280_DRIVER, SENSORS_CONFIG_BME280[i], hw_if, NULL);
         if(err_s != SENSOR_ERR_OK) {
-            log_error("bme280_init failed (err: %d)", err_hw);
+            log_error("sensor_registry_add failed (sensor #%d, err: %d)", i, err_s);
+        }
+    }
+
+#ifdef APP_SENSOR_DISCOVERY
+    // Probe the remaining well-known addresses on the i2c bus (only if the bus is up)
+    if(err_hw == HW_INTERFACE_ERR_OK) {
+        size_t found = 0;
+        sensor_registry_discover(&app_ctx.sensors, &BME280_DRIVER, &app_ctx.i2c, &found);
+        log_debug("sensor discovery finished (found: %zu)", found);
+    }
+#endif
+
+    // Initialize all sensors at once (all resets are triggered first, followed by a single reset delay)
+    size_t initialized = 0;
+    SensorError_t err_s = sensor_registry_init_all(&app_ctx.sensors, &initialized);
+    if(err_s != SENSOR_ERR_OK) {
+        log_error("sensor_registry_init_all failed (err: %d, initialized: %zu of %zu)", err_s, initialized,
+        app_ctx.sensors.count);
 #ifdef APP_INIT_RET_ON_HW_FAILURE
-            return APP_ERR_SENSOR_FAILURE;
+        return APP_ERR_SENSOR_FAILURE;
+#endif
+    }
+
+    // Keep the history of every sensor (fed by the samplers, so it has to be ready before they are started)
+    for(size_t i = 0; i < app_ctx.sensors.count; ++i) {
+        SensorHistoryConfig_t history_cfg = { .capacity = APP_HISTORY_CAPACITY, .interval_ms = APP_HISTORY_INTERVAL_MS };
+#ifdef APP_HISTORY_DIR
+        char path[SENSOR_HISTORY_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/sensor%zu.hist", APP_HISTORY_DIR, i);
+        history_cfg.path = path;
 #endif
+        SensorHistoryError_t err_h = sensor_history_init(&app_ctx.history[i], history_cfg);
+        if(err_h == SENSOR_HISTORY_ERR_FILE_FAILURE) {
+            log_error("failed to open the history file of sensor #%zu (in-memory history only)", i);
+            history_cfg.path = NULL;
+            err_h = sensor_history_init(&app_ctx.history[i], history_cfg);
         }
+        if(err_h != SENSOR_HISTORY_ERR_OK) {
+            log_error("sensor_history_init failed (sensor id: %zu, err: %d)", i, err_h);
+            continue;
+        }
+        sensor_registry_set_sample_cb(&app_ctx.sensors, i, app_history_on_sample, &app_ctx.history[i]);
     }
 
+    // Sample the sensors in the background, so that clients' requests are served from the cache
+    sensor_registry_start_samplers(&app_ctx.sensors, APP_BME280_MAX_AGE_MS);
+
     return APP_ERR_OK;
 }
 
+// Run app_init_hardware() [Thread]
+STATIC void* app_init_hardware_thread(void* arg) {
+    *(AppError_t*)arg = app_init_hardware();
+    return NULL;
+}
+
+// Zero out ctx, Init the server first, then the hardware (in the background) and the rest of the components
+AppError_t app_init() {
+    // Zero out context on init
+    memset(&app_ctx, 0, sizeof(App_t));
+    app_init_help_msg();
+    backoff_init(&app_ctx.server_backoff, APP_RESTART_BACKOFF_MIN_MS, APP_RESTART_BACKOFF_MAX_MS, APP_RESTART_STABLE_MS);
+
+    // Initialize the server first (the socket is listening from now on, clients wait in the backlog until app_run())
+    AppError_t err_app = app_init_server();
+    if(err_app != APP_ERR_OK) {
+        return err_app;
+    }
+
+    // Initialize the lock for watched GPIO lines
+    int ret = pthread_mutex_init(&app_ctx.gpio_watch_lock, NULL);
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        return APP_ERR_PTHREAD_FAILURE;
+    }
+
+    // Bring up the hardware in the background (the sensor resets, the bus probing and loading the histories take the
+    // most of the startup time), while the remaining components are initialized by this thread
+    AppError_t err_hw = APP_ERR_OK;
+    pthread_t hw_thread;
+    ret = pthread_create(&hw_thread, NULL, app_init_hardware_thread, &err_hw);
+    if(ret != 0) {
+        log_error("pthread_create() returned %d; initializing the hardware synchronously", ret);
+        err_hw = app_init_hardware();
+    }
+
+    err_app = app_init_services();
+
+    if(ret == 0) {
+        pthread_join(hw_thread, NULL);
+    }
+    if(err_app != APP_ERR_OK) {
+        return err_app;
+    }
+
+    return err_hw;
+}
+
 // Start the server
 AppError_t app_run(void) {
     if(app_ctx.running) {
@@ -789,6 +2173,35 @@ AppError_t app_run(void) {
         return APP_ERR_SERVER_FAILURE;
     }
 
+    SubscriptionError_t err_sub = subscription_start(&app_ctx.subscriptions);
+    if(err_sub == SUBSCRIPTION_ERR_OK) {
+        log_debug("subscription scheduler started successfully");
+    } else {
+        log_error("failed to start the subscription scheduler (err: %d)", err_sub);
+        server_shutdown(&app_ctx.server);
+        return APP_ERR_SUBSCRIPTION_FAILURE;
+    }
+
+#ifdef APP_METRICS_PORT
+    // The scrapes are accepted by the server listening thread and served by the dispatcher workers
+    app_ctx.metrics_fd = -1;
+    err_s = server_open_listener(APP_METRICS_PORT, APP_METRICS_MAX_CONN_REQUESTS, &app_ctx.metrics_fd);
+    if(err_s == SERVER_ERR_OK) {
+        app_ctx.metrics_watch = (ServerWatch_t){ .fd = app_ctx.metrics_fd, .on_event = handle_metrics_conn };
+        err_s = server_watch(&app_ctx.server, &app_ctx.metrics_watch);
+    }
+    if(err_s == SERVER_ERR_OK) {
+        log_info("metrics endpoint listening on port %s", APP_METRICS_PORT);
+    } else {
+        // The endpoint is optional, the metrics are still available via `server metrics`
+        log_error("failed to start the metrics endpoint (err: %d)", err_s);
+        if(app_ctx.metrics_fd >= 0) {
+            close(app_ctx.metrics_fd);
+            app_ctx.metrics_fd = -1;
+        }
+    }
+#endif
+
     app_ctx.running = true;
 
     return APP_ERR_OK;
@@ -800,6 +2213,24 @@ AppError_t app_stop(void) {
         return APP_ERR_NOT_STARTED;
     }
 
+    // Stop pushing samples before the clients are gone
+    SubscriptionError_t err_sub = subscription_stop(&app_ctx.subscriptions);
+    if(err_sub == SUBSCRIPTION_ERR_OK) {
+        log_debug("subscription scheduler stopped successfully");
+    } else {
+        log_error("failed to stop the subscription scheduler (err: %d)", err_sub);
+        return APP_ERR_SUBSCRIPTION_FAILURE;
+    }
+
+#ifdef APP_METRICS_PORT
+    // Close the metrics endpoint while the listening thread still runs (the watch is valid only then)
+    if(app_ctx.metrics_fd >= 0) {
+        server_unwatch(&app_ctx.server, &app_ctx.metrics_watch);
+        close(app_ctx.metrics_fd);
+        app_ctx.metrics_fd = -1;
+    }
+#endif
+
     ServerError_t err_s = server_shutdown(&app_ctx.server);
     if(err_s == SERVER_ERR_OK) {
         log_debug("server stopped successfully");
@@ -821,31 +2252,68 @@ AppError_t app_deinit(void) {
         return APP_ERR_RUNNING;
     }
 
-    // Deinit the server
-    ServerError_t err_s = server_deinit(&app_ctx.server);
-    if(err_s == SERVER_ERR_OK) {
-        log_debug("server deinitialized successfully");
-    } else {
-        log_error("failed to deinitialize the server (err: %d)", err_s);
-        return APP_ERR_SERVER_FAILURE;
+    // Deinit the dispatcher first (its workers may still be sending responses to the clients)
+    if(app_ctx.dispatcher_initialized) {
+        DispatcherError_t err_d = dispatcher_deinit(&app_ctx.dispatcher);
+        if(err_d == DISPATCHER_ERR_OK) {
+            log_debug("dispatcher deinitialized successfully");
+        } else {
+            log_error("failed to deinitialize the dispatcher (err: %d)", err_d);
+            return APP_ERR_SERVER_FAILURE;
+        }
+        app_ctx.dispatcher_initialized = false;
     }
 
-    // Deinit the dispatcher
-    DispatcherError_t err_d = dispatcher_deinit(&app_ctx.dispatcher);
-    if(err_d == DISPATCHER_ERR_OK) {
-        log_debug("dispatcher deinitialized successfully");
+    // Deinit the server (not initialized if its restart has failed)
+    if(app_ctx.server_initialized) {
+        ServerError_t err_s = server_deinit(&app_ctx.server);
+        if(err_s == SERVER_ERR_OK) {
+            log_debug("server deinitialized successfully");
+        } else {
+            log_error("failed to deinitialize the server (err: %d)", err_s);
+            return APP_ERR_SERVER_FAILURE;
+        }
+        app_ctx.server_initialized = false;
+    }
+
+    // Deinit the subscription table
+    SubscriptionError_t err_sub = subscription_deinit(&app_ctx.subscriptions);
+    if(err_sub == SUBSCRIPTION_ERR_OK) {
+        log_debug("subscription table deinitialized successfully");
     } else {
-        log_error("failed to deinitialize the dispatcher (err: %d)", err_d);
-        return APP_ERR_SERVER_FAILURE;
+        log_error("failed to deinitialize the subscription table (err: %d)", err_sub);
+        return APP_ERR_SUBSCRIPTION_FAILURE;
     }
 
-    // Deinit the GPIO driver
-    GpioError_t err_g = gpio_deinit(&app_ctx.gpio);
-    if(err_g == GPIO_ERR_OK) {
-        log_debug("gpio deinitialized successfully");
+    // Stop the stats collector and deinit the system stats readers
+    SysstatError_t err_stat = sysstat_collector_stop(&app_ctx.collector);
+    if(err_stat == SYSSTAT_ERR_OK) {
+        log_debug("sysstat collector stopped successfully");
     } else {
-        log_error("failed to deinitialize the gpio driver (err: %d)", err_g);
-        return APP_ERR_GPIO_FAILURE;
+        log_error("failed to stop the sysstat collector (err: %d)", err_stat);
+        return APP_ERR_SYSSTAT_FAILURE;
+    }
+    err_stat = sysstat_deinit(&app_ctx.sysstat);
+    if(err_stat == SYSSTAT_ERR_OK) {
+        log_debug("sysstat deinitialized successfully");
+    } else {
+        log_error("failed to deinitialize sysstat (err: %d)", err_stat);
+        return APP_ERR_SYSSTAT_FAILURE;
+    }
+
+    // Deinitialize all sensors (stops their samplers before the buses are closed)
+    SensorError_t err_sens = sensor_registry_deinit(&app_ctx.sensors);
+    if(err_sens != SENSOR_ERR_OK) {
+        log_error("sensor_registry_deinit failed (err: %d)", err_sens);
+        return APP_ERR_SENSOR_FAILURE;
+    }
+
+    // Close the histories once the samplers are stopped (the never initialized ones are zeroed)
+    for(size_t i = 0; i < SENSOR_REGISTRY_MAX_SENSORS; ++i) {
+        SensorHistoryError_t err_h = sensor_history_deinit(&app_ctx.history[i]);
+        if(err_h != SENSOR_HISTORY_ERR_OK) {
+            log_error("sensor_history_deinit failed (sensor id: %zu, err: %d)", i, err_h);
+        }
     }
 
     // Deinit the i2c
@@ -855,15 +2323,25 @@ AppError_t app_deinit(void) {
         return APP_ERR_HW_INTERFACE_FAILURE;
     }
 
-    // Deinitialize all bme280 sensors defined in the sensors_config.h configuration file
-    for(int i = 0; i < BME280_COUNT; ++i) {
-        SensorError_t err_s = bme280_deinit(&app_ctx.sens_bme280[i]);
-        if(err_s != SENSOR_ERR_OK) {
-            log_error("bme280_deinit failed (err: %d)", err_hw);
-            return APP_ERR_SENSOR_FAILURE;
+    // Deinit the spi
+    if(app_ctx.spi_initialized) {
+        err_hw = hw_interface_deinit(&app_ctx.spi);
+        if(err_hw != HW_INTERFACE_ERR_OK) {
+            log_error("hw_interface_deinit failed (err: %d)", err_hw);
+            return APP_ERR_HW_INTERFACE_FAILURE;
         }
     }
 
+    // Deinit the GPIO driver after the buses (drives the SPI chip-select lines; watched lines are released as well)
+    pthread_mutex_destroy(&app_ctx.gpio_watch_lock);
+    GpioError_t err_g = gpio_deinit(&app_ctx.gpio);
+    if(err_g == GPIO_ERR_OK) {
+        log_debug("gpio deinitialized successfully");
+    } else {
+        log_error("failed to deinitialize the gpio driver (err: %d)", err_g);
+        return APP_ERR_GPIO_FAILURE;
+    }
+
     // Zero-out context on deinit
     memset(&app_ctx, 0, sizeof(App_t));
 
@@ -872,14 +2350,439 @@ AppError_t app_deinit(void) {
     return APP_ERR_OK;
 }
 
-// Replace new line with terminating character
-STATIC void app_remove_nl(char* buf) {
-    // Scan the input buffer as long as its valid (non null) and terminating char has not been reached
-    while(buf && *buf != '\0') {
-        if(*buf == '\n') {
-            *buf = '\0'; // Replace the first new line with terminating character ...
-            return;      // ... and return
+// Restart the failed network subsystem (with backoff), the hardware is left untouched
+AppError_t app_poll(void) {
+    int64_t now = app_monotonic_ms();
+
+    // Schedule a restart on a new failure (the delay grows with every failure in a row)
+    if(atomic_exchange(&app_ctx.server_failed, false) && !app_ctx.server_restart_pending) {
+        uint32_t delay = backoff_next(&app_ctx.server_backoff, now);
+        log_info("restarting the network subsystem in %u ms", delay);
+        app_ctx.server_restart_at_ms = now + delay;
+        app_ctx.server_restart_pending = true;
+    }
+    if(!app_ctx.server_restart_pending) {
+        return APP_ERR_OK;
+    } else if(now < app_ctx.server_restart_at_ms) {
+        return APP_ERR_SERVER_FAILURE;
+    }
+
+    AppError_t err_app = app_restart_network();
+    if(err_app != APP_ERR_OK) {
+        uint32_t delay = backoff_next(&app_ctx.server_backoff, app_monotonic_ms());
+        log_error("failed to restart the network subsystem (err: %d); next attempt in %u ms", err_app, delay);
+        app_ctx.server_restart_at_ms = app_monotonic_ms() + delay;
+        return APP_ERR_SERVER_FAILURE;
+    }
+    app_ctx.server_restart_pending = false;
+    log_info("network subsystem restarted successfully");
+
+    return APP_ERR_OK;
+}
+
+// Tear down the server along with the dispatcher (its workers write to the server's clients) and start them again
+STATIC AppError_t app_restart_network(void) {
+    // Stop the subscriptions, the metrics endpoint and the server threads (all clients are disconnected)
+    if(app_ctx.running) {
+        AppError_t err_app = app_stop();
+        if(err_app != APP_ERR_OK) {
+            return err_app;
+        }
+    }
+
+    if(app_ctx.dispatcher_initialized) {
+        DispatcherError_t err_d = dispatcher_deinit(&app_ctx.dispatcher);
+        if(err_d != DISPATCHER_ERR_OK) {
+            log_error("failed to deinitialize the dispatcher (err: %d)", err_d);
+            return APP_ERR_DISPATCHER_FAILURE;
+        }
+        app_ctx.dispatcher_initialized = false;
+    }
+    if(app_ctx.server_initialized) {
+        ServerError_t err_s = server_deinit(&app_ctx.server);
+        if(err_s != SERVER_ERR_OK) {
+            log_error("failed to deinitialize the server (err: %d)", err_s);
+            return APP_ERR_SERVER_FAILURE;
+        }
+        app_ctx.server_initialized = false;
+    }
+
+    // The clients are gone without on_client_disconnect, so drop their watches and subscriptions (a new client could
+    // get the same handle) and release the watched lines (their fds were registered in the closed epoll)
+    app_gpio_watch_reset();
+    SubscriptionError_t err_sub = subscription_deinit(&app_ctx.subscriptions);
+    if(err_sub != SUBSCRIPTION_ERR_OK) {
+        log_error("failed to deinitialize the subscription table (err: %d)", err_sub);
+        return APP_ERR_SUBSCRIPTION_FAILURE;
+    }
+    AppError_t err_app = app_init_subscriptions();
+    if(err_app != APP_ERR_OK) {
+        return err_app;
+    }
+
+    err_app = app_init_server();
+    if(err_app != APP_ERR_OK) {
+        return err_app;
+    }
+    err_app = app_init_dispatcher();
+    if(err_app != APP_ERR_OK) {
+        return err_app;
+    }
+
+    return app_run();
+}
+
+// Execute a single command and report the failure (if any) back to the client
+STATIC void app_execute_cmd(const ServerClient_t* client, char* cmd, const size_t len) {
+    DispatcherError_t err_d = dispatcher_execute_inplace(&app_ctx.dispatcher, cmd, len, client);
+    switch(err_d) {
+    case DISPATCHER_ERR_OK: {
+        break;
+    }
+    case DISPATCHER_ERR_CMD_INCOMPLETE: {
+        app_send_to_client(client, APP_CMD_INCOMPLETE_MSG, APP_MSG_TYPE_ERROR);
+        break;
+    }
+    case DISPATCHER_ERR_BUF_TOO_LONG:   // fallthrough
+    case DISPATCHER_ERR_BUF_EMPTY:      // fallthrough
+    case DISPATCHER_ERR_TOKEN_TOO_LONG: // fallthrough
+    case DISPATCHER_ERR_CMD_NOT_FOUND: {
+        app_send_to_client(client, APP_CMD_ERR_MSG, APP_MSG_TYPE_ERROR);
+        break;
+    }
+    case DISPATCHER_ERR_QUEUE_FULL: {
+        app_send_to_client(client, APP_SERVER_BUSY_MSG, APP_MSG_TYPE_ERROR);
+        break;
+    }
+    case DISPATCHER_ERR_NULL_ARG:        // fallthrough
+    case DISPATCHER_ERR_PTHREAD_FAILURE: // fallthrough
+    default: {
+        app_send_to_client(client, APP_GENERIC_FAILURE_MSG, APP_MSG_TYPE_ERROR);
+        break;
+    }
+    }
+}
+
+// Decode a single binary protocol request and execute its handler
+STATIC void app_execute_frame(const ServerClient_t* client, const uint8_t* frame, const size_t len) {
+    ProtoRequest_t req;
+    if(proto_decode_request(frame, len, &req) != PROTO_ERR_OK) {
+        app_proto_reply(client, &req, PROTO_STATUS_MALFORMED, NULL, 0);
+        return;
+    }
+
+    if(req.opcode >= PROTO_OPCODE_COUNT || !APP_PROTO_CMDS[req.opcode].handler) {
+        log_error("unknown opcode of the request (opcode: 0x%02hhX)", req.opcode);
+        app_proto_reply(client, &req, PROTO_STATUS_UNKNOWN_OPCODE, NULL, 0);
+        return;
+    }
+    const AppProtoCommand_t* cmd = &APP_PROTO_CMDS[req.opcode];
+    if(req.argc != cmd->argc) {
+        log_error("incorrect number of arguments (opcode: 0x%02hhX, argc: %u)", req.opcode, req.argc);
+        app_proto_reply(client, &req, PROTO_STATUS_INVALID_ARGUMENT, NULL, 0);
+        return;
+    } else if(!cmd->offload) {
+        cmd->handler(client, &req);
+        return;
+    }
+
+    // Slow requests run on a dispatcher worker (the response is queued by the handler)
+    const AppProtoJob_t job = { .client = *client, .req = req };
+    DispatcherError_t err_d = dispatcher_offload(&app_ctx.dispatcher, app_run_proto_job, NULL, &job, sizeof(job));
+    if(err_d != DISPATCHER_ERR_OK) {
+        log_error("dispatcher_offload failed (opcode: 0x%02hhX, ret: %d)", req.opcode, err_d);
+        app_proto_reply(client, &req, (err_d == DISPATCHER_ERR_QUEUE_FULL ? PROTO_STATUS_BUSY : PROTO_STATUS_FAILURE),
+        NULL, 0);
+    }
+}
+
+// Run an offloaded binary protocol request (on a dispatcher worker)
+STATIC void app_run_proto_job(void* arg) {
+    const AppProtoJob_t* job = (const AppProtoJob_t*)arg;
+    APP_PROTO_CMDS[job->req.opcode].handler(&job->client, &job->req);
+}
+
+// Send a binary protocol frame answering the request (header + payload, nothing is copied)
+STATIC ServerError_t app_proto_reply(const ServerClient_t* client,
+const ProtoRequest_t* req,
+const ProtoStatus_t status,
+const uint8_t* payload,
+const size_t len) {
+    uint8_t hdr[PROTO_FRAME_HEADER_SIZE];
+    if(proto_encode_header(hdr, req->opcode, status, req->req_id, len) != PROTO_ERR_OK) {
+        log_error("payload too long for a single frame (opcode: 0x%02hhX, len: %zu)", req->opcode, len);
+        return SERVER_ERR_INVALID_ARGUMENT;
+    }
+    const struct iovec iov[2] = { { .iov_base = hdr, .iov_len = sizeof(hdr) },
+        { .iov_base = (void*)payload, .iov_len = len } };
+
+    ServerError_t err_s = server_writev(&app_ctx.server, *client, iov, (len > 0 ? 2 : 1));
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_writev failed (ret: %d)", err_s);
+    }
+    return err_s;
+}
+
+// Disconnect the client (forced disconnects don't trigger on_client_disconnect, so drop its subscriptions and GPIO
+// watches here)
+STATIC ServerError_t app_drop_client(const ServerClient_t client) {
+    SubscriptionError_t err_sub = subscription_remove_client(&app_ctx.subscriptions, client);
+    if(err_sub != SUBSCRIPTION_ERR_OK) {
+        log_error("subscription_remove_client failed (ret: %d)", err_sub);
+    }
+    app_gpio_watch_remove_client(client);
+
+    return server_disconnect(&app_ctx.server, client);
+}
+
+// Close the connection of a metrics scrape dropped on the dispatcher deinit (before a worker served it)
+STATIC void app_drop_metrics_conn(void* arg) {
+    close(*(int*)arg);
+    atomic_fetch_sub(&app_ctx.metrics_scrapes, 1);
+}
+
+// Serve a single scrape of the metrics endpoint (runs on a dispatcher worker; any path returns the metrics)
+STATIC void app_serve_metrics(void* arg) {
+    int fd = *(int*)arg;
+
+    // The accepted socket is blocking, so a stalled scraper can hold the worker for the timeout at most
+    const struct timeval timeout = { .tv_sec = APP_METRICS_HTTP_TIMEOUT_MS / 1000,
+        .tv_usec = (APP_METRICS_HTTP_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Read the request head (up to the empty line)
+    char req[APP_METRICS_REQ_BUF_SIZE];
+    size_t req_len = 0;
+    req[0] = '\0';
+    while(req_len < sizeof(req) - 1 && !strstr(req, "\r\n\r\n") && !strstr(req, "\n\n")) {
+        ssize_t ret = recv(fd, req + req_len, sizeof(req) - 1 - req_len, 0);
+        if(ret <= 0) {
+            break;
+        }
+        req_len += (size_t)ret;
+        req[req_len] = '\0';
+    }
+
+    char* body = malloc(APP_METRICS_HTTP_BUF_SIZE);
+    if(!body) {
+        log_error("failed to allocate the metrics endpoint buffer (size: %d)", APP_METRICS_HTTP_BUF_SIZE);
+        close(fd);
+        atomic_fetch_sub(&app_ctx.metrics_scrapes, 1);
+        return;
+    }
+    StrBuf_t sb;
+    strbuf_init(&sb, body, APP_METRICS_HTTP_BUF_SIZE);
+
+    const char* status = "200 OK";
+    MetricsSnapshot_t snap;
+    MetricsError_t err_m = METRICS_ERR_OK;
+    if(strncmp(req, "GET ", 4) != 0) {
+        status = "405 Method Not Allowed";
+        strbuf_append_str(&sb, "only GET is supported\n");
+    } else if((err_m = metrics_snapshot(&snap)) != METRICS_ERR_OK) {
+        log_error("metrics_snapshot failed (ret: %d)", err_m);
+        status = "503 Service Unavailable";
+        strbuf_appendf(&sb, "failed to retrieve metrics (metrics_snapshot ret: %d)\n", err_m);
+    } else {
+        metrics_render_prometheus(&snap, &sb);
+        if(sb.truncated) {
+            log_error("metrics exposition truncated (buffer size: %d)", APP_METRICS_HTTP_BUF_SIZE);
+        }
+    }
+
+    char head[APP_METRICS_HEAD_BUF_SIZE];
+    int head_len = snprintf(head, sizeof(head),
+    "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+    status, sb.len);
+    if(!app_send_all(fd, head, (size_t)head_len) || !app_send_all(fd, sb.data, sb.len)) {
+        log_error("failed to send the metrics endpoint response (errno: %d)", errno);
+    }
+
+    free(body);
+    close(fd);
+    atomic_fetch_sub(&app_ctx.metrics_scrapes, 1);
+}
+
+// Send the whole buffer over the blocking socket (partial sends are continued)
+STATIC bool app_send_all(const int fd, const char* buf, size_t len) {
+    while(len > 0) {
+        ssize_t ret = send(fd, buf, len, MSG_NOSIGNAL);
+        if(ret < 0 && errno == EINTR) {
+            continue;
+        } else if(ret <= 0) {
+            return false;
+        }
+        buf += ret;
+        len -= (size_t)ret;
+    }
+    return true;
+}
+
+// Convert a comma-separated list of line numbers (e.g. "21,22,23") into an array
+STATIC bool app_parse_gpio_lines(const char* str, uint8_t* lines, size_t* count) {
+    const char* ptr = str;
+    char* conversion_end_ptr;
+
+    *count = 0;
+    while(*count < GPIO_LINE_COUNT) {
+        errno = 0;
+        unsigned long line_ul = strtoul(ptr, &conversion_end_ptr, 10);
+        if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == ptr || line_ul >= GPIO_LINE_COUNT) {
+            return false;
+        }
+        lines[(*count)++] = (uint8_t)line_ul; // line_ul is below GPIO_LINE_COUNT so it's safe to cast
+
+        if(*conversion_end_ptr == '\0') {
+            return true;
+        } else if(*conversion_end_ptr != APP_GPIO_LINES_DELIM) {
+            return false;
+        }
+        ptr = conversion_end_ptr + 1;
+    }
+
+    return false; // Too many lines
+}
+
+// Convert a single line number
+STATIC bool app_parse_gpio_line(const char* str, uint8_t* line) {
+    char* conversion_end_ptr;
+
+    errno = 0;
+    unsigned long line_ul = strtoul(str, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == str || *conversion_end_ptr != '\0' ||
+       line_ul >= GPIO_LINE_COUNT) {
+        return false;
+    }
+    *line = (uint8_t)line_ul; // line_ul is below GPIO_LINE_COUNT so it's safe to cast
+
+    return true;
+}
+
+// Convert a duration in seconds with an optional unit suffix (e.g. "90", "90s", "15m", "12h", "7d")
+STATIC bool app_parse_duration_s(const char* str, uint32_t* seconds) {
+    char* conversion_end_ptr;
+
+    errno = 0;
+    unsigned long value_ul = strtoul(str, &conversion_end_ptr, 10);
+    if(errno == EINVAL || errno == ERANGE || conversion_end_ptr == str || *str == '-') {
+        return false;
+    }
+
+    unsigned long unit_s;
+    switch(*conversion_end_ptr) {
+    case '\0': // fallthrough
+    case 's': {
+        unit_s = 1;
+        break;
+    }
+    case 'm': {
+        unit_s = 60;
+        break;
+    }
+    case 'h': {
+        unit_s = 3600;
+        break;
+    }
+    case 'd': {
+        unit_s = 86400;
+        break;
+    }
+    default: {
+        return false;
+    }
+    }
+    if(*conversion_end_ptr != '\0' && *(conversion_end_ptr + 1) != '\0') {
+        return false; // Only a single unit char is allowed
+    }
+    if(value_ul == 0 || value_ul > APP_HISTORY_MAX_WINDOW_S / unit_s) {
+        return false;
+    }
+    *seconds = (uint32_t)(value_ul * unit_s); // value_ul * unit_s is within APP_HISTORY_MAX_WINDOW_S so it's safe to cast
+
+    return true;
+}
+
+// Remove the client from the line's watchers (the line is released once nobody watches it)
+STATIC bool app_gpio_watch_remove(const uint8_t line, const ServerClient_t client) {
+    int ret = pthread_mutex_lock(&app_ctx.gpio_watch_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return false;
+    }
+    log_debug("gpio watch lock taken");
+
+    bool removed = false;
+    AppGpioWatch_t* entry = &app_ctx.gpio_watches[line];
+    for(uint8_t i = 0; i < entry->client_count; i++) {
+        if(server_client_equal(entry->clients[i], client)) {
+            entry->clients[i] = entry->clients[--entry->client_count]; // Order of the watchers does not matter
+            removed = true;
+            break;
+        }
+    }
+    if(removed && entry->client_count == 0) {
+        app_gpio_watch_release(line);
+    }
+
+    ret = pthread_mutex_unlock(&app_ctx.gpio_watch_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+    }
+    log_debug("gpio watch lock released");
+
+    return removed;
+}
+
+// Remove the client from the watchers of all lines
+STATIC void app_gpio_watch_remove_client(const ServerClient_t client) {
+    for(uint8_t line = 0; line < GPIO_LINE_COUNT; line++) {
+        app_gpio_watch_remove(line, client);
+    }
+}
+
+// Unregister the line event fd from the server and release the line [call with gpio_watch_lock taken]
+STATIC void app_gpio_watch_release(const uint8_t line) {
+    AppGpioWatch_t* entry = &app_ctx.gpio_watches[line];
+    if(!entry->active) {
+        return;
+    }
+
+    ServerError_t err_s = server_unwatch(&app_ctx.server, &entry->watch);
+    if(err_s != SERVER_ERR_OK) {
+        log_error("server_unwatch failed (line: %hu, ret: %d)", line, err_s);
+    }
+    GpioError_t err_g = gpio_unwatch(&app_ctx.gpio, line);
+    if(err_g != GPIO_ERR_OK) {
+        log_error("gpio_unwatch failed (line: %hu, ret: %d)", line, err_g);
+    }
+    entry->active = false;
+}
+
+// Drop all watchers and release the watched lines once the server is shut down (the line fds are not watched anymore)
+STATIC void app_gpio_watch_reset(void) {
+    int ret = pthread_mutex_lock(&app_ctx.gpio_watch_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return;
+    }
+    log_debug("gpio watch lock taken");
+
+    for(uint8_t line = 0; line < GPIO_LINE_COUNT; line++) {
+        AppGpioWatch_t* entry = &app_ctx.gpio_watches[line];
+        if(entry->active) {
+            GpioError_t err_g = gpio_unwatch(&app_ctx.gpio, line);
+            if(err_g != GPIO_ERR_OK) {
+                log_error("gpio_unwatch failed (line: %hu, ret: %d)", line, err_g);
+            }
         }
-        buf++;
+        entry->active = false;
+        entry->client_count = 0;
+    }
+
+    ret = pthread_mutex_unlock(&app_ctx.gpio_watch_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
     }
-}
\ No newline at end of file
+    log_debug("gpio watch lock released");
+}
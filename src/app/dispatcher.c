@@ -1,91 +1,321 @@
+#define LOG_MODULE LOG_MODULE_DISPATCHER
+
 #include "app/dispatcher.h"
 
-#include <string.h> // For: strtok_r(), strnlen()
+#include <ctype.h>  // For: tolower()
+#include <sched.h>  // For: sched_yield()
+#include <stddef.h> // For: offsetof()
+#include <stdlib.h> // For: calloc(), free()
+#include <string.h> // For: strspn(), strcspn(), strnlen(), memcpy()
 
 #include "utils/common.h"
 #include "utils/log.h"
+#include "utils/metrics.h"
+
+#define DISPATCHER_INDEX_EMPTY UINT32_MAX // Marks an unused bucket in the cmd_index hash table
+
+#define DISPATCHER_MAX_TOKENS (DISPATCHER_MAX_ARGS + 2) // Target, action and the arguments
 
+/**
+ * @struct DispatcherCmdJob_t
+ * @brief Argument of the job running an offloaded command (everything the callback needs is copied)
+ */
 typedef struct {
-    char target[DISPATCHER_TARGET_MAX_SIZE];                 // E.g. "gpio", "sensor", "server"
-    char action[DISPATCHER_ACTION_MAX_SIZE];                 // E.g. "set", "get", "status"
-    char argv[DISPATCHER_MAX_ARGS][DISPATCHER_ARG_MAX_SIZE]; // Additional parameters (e.g. GPIO Pin number, sensor ID)
-    uint32_t argc;                                           // Number of arguments
-} TokenizedCommand_t;
+    void (*callback_ptr)(char** argv, uint32_t argc, const void* cmd_ctx); // Command handler
+    uint64_t start_ns;                                                      // Time the cmd was dispatched at
+    uint32_t argc;                                                          // Number of arguments
+    uint32_t id;                                                            // Command ID (for the metrics)
+    bool has_ctx;                                                           // cmd_ctx copied (NULL passed otherwise)
+    _Alignas(max_align_t) uint8_t cmd_ctx[DISPATCHER_CMD_CTX_MAX_SIZE];     // Copy of the cmd execution context
+    char args[DISPATCHER_MAX_BUF_SIZE]; // Arguments one after another (each NULL-terminated)
+} DispatcherCmdJob_t;
+
+_Static_assert(sizeof(DispatcherCmdJob_t) <= DISPATCHER_JOB_ARG_MAX_SIZE, "offloaded command does not fit into a job");
 
 /**
- * @brief Tokenize the buffer with the command
- * @param[in]  buf  Pointer to the character string to be parsed [must be NULL-terminated]
+ * @brief Tokenize the buffer with the command in place (delimiters following the tokens are replaced with NULL chars)
+ * @param[in, out]  buf  Pointer to the character string to be parsed [must be NULL-terminated at buf[len]]
+ * @param[in]  len  Length of the character string
  * @param[in]  delim  Delimiter string
- * @param[in, out]  output  Pointer to the TokenizedCommand_t struct where results will be saved
+ * @param[out]  tokens  Array of (at least DISPATCHER_MAX_TOKENS) slices where target, action and arguments are saved
+ * @param[out]  count  Number of tokens found
  * @return DISPATCHER_ERR_OK on success, DISPATCHER_ERR_NULL_ARG / DISPATCHER_ERR_BUF_TOO_LONG /
- * DISPATCHER_ERR_BUF_EMPTY / DISPATCHER_ERR_CMD_INCOMPLETE / DISPATCHER_ERR_TOKEN_TOO_LONG otherwise
+ * DISPATCHER_ERR_BUF_EMPTY / DISPATCHER_ERR_CMD_INCOMPLETE / DISPATCHER_ERR_TOKEN_TOO_LONG /
+ * DISPATCHER_ERR_TOO_MANY_ARGS otherwise
  */
-STATIC DispatcherError_t dispatcher_tokenize(const char* buf, const char* delim, TokenizedCommand_t* output);
+STATIC DispatcherError_t
+dispatcher_tokenize(char* buf, const size_t len, const char* delim, DispatcherToken_t* tokens, uint32_t* count);
 
-STATIC DispatcherError_t dispatcher_tokenize(const char* buf, const char* delim, TokenizedCommand_t* output) {
-    if(!buf || !output) {
-        return DISPATCHER_ERR_NULL_ARG;
-    }
+/**
+ * @brief Compute a case-insensitive hash (FNV-1a) of the target & action pair
+ * @param[in]  target  NULL terminated target string
+ * @param[in]  action  NULL terminated action string
+ * @return Hash value of the pair
+ */
+STATIC uint32_t dispatcher_hash(const char* target, const char* action);
 
-    size_t buf_len = strnlen(buf, DISPATCHER_MAX_BUF_SIZE - 1);
-    if(buf_len >= DISPATCHER_MAX_BUF_SIZE) {
+/**
+ * @brief Build a new command table snapshot: a copy of the old one with a single command entry replaced
+ * @param[in]  old  Pointer to the current snapshot (NULL if none)
+ * @param[in]  id  ID of the command entry to be replaced (the table grows if needed)
+ * @param[in]  cmd  New command entry (may be invalid to remove the cmd)
+ * @return Pointer to the new snapshot or NULL on allocation failure
+ * @note Commands are inserted in the order of IDs, so the lowest ID is found first for duplicated target & action
+ */
+STATIC DispatcherTable_t* dispatcher_table_build(const DispatcherTable_t* old, const uint32_t id, const DispatcherCommand_t* cmd);
+
+/**
+ * @brief Publish a new command table snapshot and free the old one once no lookup uses it [call with the lock taken]
+ * @param[in, out]  ctx  Pointer to the Dispatcher instance
+ * @param[in]  table  Pointer to the new snapshot
+ */
+STATIC void dispatcher_table_publish(Dispatcher_t* ctx, DispatcherTable_t* table);
+
+/**
+ * @brief Find a valid command matching target & action
+ * @param[in]  table  Pointer to the command table snapshot (may be NULL)
+ * @param[in]  target  NULL terminated target string
+ * @param[in]  action  NULL terminated action string
+ * @return Pointer to the matching command or NULL if not found
+ */
+STATIC const DispatcherCommand_t* dispatcher_lookup(const DispatcherTable_t* table, const char* target, const char* action);
+
+/**
+ * @brief Worker thread: run the queued jobs until the pool is stopped
+ * @param[in]  arg  Pointer to the Dispatcher instance
+ * @return NULL
+ */
+STATIC void* dispatcher_worker(void* arg);
+
+/**
+ * @brief Job running an offloaded command (rebuilds argv from the copied arguments and calls the callback)
+ * @param[in]  arg  Pointer to the DispatcherCmdJob_t
+ */
+STATIC void dispatcher_run_cmd(void* arg);
+
+/**
+ * @brief Stop the workers (the running jobs are finished) and release the job queue
+ * @param[in, out]  pool  Pointer to the worker pool
+ */
+STATIC void dispatcher_pool_stop(DispatcherPool_t* pool);
+
+STATIC DispatcherError_t
+dispatcher_tokenize(char* buf, const size_t len, const char* delim, DispatcherToken_t* tokens, uint32_t* count) {
+    if(!buf || !delim || !tokens || !count) {
+        return DISPATCHER_ERR_NULL_ARG;
+    } else if(len >= DISPATCHER_MAX_BUF_SIZE) {
         return DISPATCHER_ERR_BUF_TOO_LONG;
     }
 
-    DispatcherError_t err = DISPATCHER_ERR_OK;
-    char *token, *next;
-    char _buf[DISPATCHER_MAX_BUF_SIZE];
-    memcpy(_buf, buf, buf_len + 1);
-    size_t token_len;
-    memset(output, 0, sizeof(TokenizedCommand_t)); // Zero-out the struct for safety
+    // Max token sizes (incl. NULL char): target, action, and then the arguments
+    static const size_t max_size[2] = { DISPATCHER_TARGET_MAX_SIZE, DISPATCHER_ACTION_MAX_SIZE };
+    char* const end = buf + len;
+    char* pos = buf;
+    *count = 0;
+
+    while(pos < end) {
+        pos += strspn(pos, delim); // Skip the delimiters preceding the token
+        if(pos >= end || *pos == '\0') {
+            break;
+        } else if(*count == DISPATCHER_MAX_TOKENS) {
+            return DISPATCHER_ERR_TOO_MANY_ARGS;
+        }
 
-    // The first token must represent the target of the command
-    token = strtok_r(_buf, delim, &next); // Use strtok_r for thread-safe behaviour
-    if(!token) {
+        size_t token_len = strcspn(pos, delim);
+        size_t token_max = (*count < 2) ? max_size[*count] : DISPATCHER_ARG_MAX_SIZE;
+        if(token_len >= token_max) {
+            log_error("token #%u too long (len: %zu)", *count, token_len);
+            return DISPATCHER_ERR_TOKEN_TOO_LONG;
+        }
+
+        tokens[*count] = (DispatcherToken_t){ .ptr = pos, .len = token_len };
+        (*count)++;
+        pos += token_len;
+        if(pos < end) {
+            *pos++ = '\0'; // Terminate the token in place (overwrites the delimiter)
+        }
+    }
+
+    if(*count == 0) {
         return DISPATCHER_ERR_BUF_EMPTY;
+    } else if(*count == 1) {
+        return DISPATCHER_ERR_CMD_INCOMPLETE;
+    }
+
+    return DISPATCHER_ERR_OK;
+}
+
+STATIC uint32_t dispatcher_hash(const char* target, const char* action) {
+    uint32_t hash = 2166136261u; // FNV-1a offset basis
+    for(const char* c = target; *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)tolower((unsigned char)*c)) * 16777619u;
     }
-    token_len = strnlen(token, DISPATCHER_TARGET_MAX_SIZE - 1);
-    if(token_len >= DISPATCHER_TARGET_MAX_SIZE) {
-        log_error("'target' token too long (len: %lu)", token_len);
-        return DISPATCHER_ERR_TOKEN_TOO_LONG;
+    hash *= 16777619u; // Separate target from action (so that e.g. "ab|c" and "a|bc" differ)
+    for(const char* c = action; *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)tolower((unsigned char)*c)) * 16777619u;
     }
-    memcpy(output->target, token, token_len + 1);
-    output->target[DISPATCHER_TARGET_MAX_SIZE - 1] = '\0'; // Cap 'target' with NULL char
+    return hash;
+}
 
-    // The second token must represent the action to be performed
-    token = strtok_r(next, delim, &next);
-    if(!token) {
-        return DISPATCHER_ERR_CMD_INCOMPLETE;
+STATIC DispatcherTable_t* dispatcher_table_build(const DispatcherTable_t* old, const uint32_t id, const DispatcherCommand_t* cmd) {
+    // Double the capacity until the ID fits (capped at the max number of commands)
+    uint32_t capacity = old ? old->cmd_capacity : DISPATCHER_INIT_CMD_COUNT;
+    while(capacity <= id) {
+        capacity *= 2;
     }
-    token_len = strnlen(token, DISPATCHER_ACTION_MAX_SIZE - 1);
-    if(token_len >= DISPATCHER_ACTION_MAX_SIZE) {
-        log_error("'action' token too long (len: %lu)", token_len);
-        return DISPATCHER_ERR_TOKEN_TOO_LONG;
+    if(capacity > DISPATCHER_MAX_CMD_COUNT) {
+        capacity = DISPATCHER_MAX_CMD_COUNT;
     }
-    memcpy(output->action, token, token_len + 1);
-    output->action[DISPATCHER_ACTION_MAX_SIZE - 1] = '\0'; // Cap 'action' with NULL char
 
-    // Target and Action should be followed by parameters
-    for(uint32_t arg_no = 0; arg_no < DISPATCHER_MAX_ARGS; arg_no++) {
-        token = strtok_r(next, delim, &next);
-        if(!token) {
-            break; // No other arguments (parameters) can be found
+    // Keep the load factor below 50% to make the probe sequences short
+    uint32_t count = cmd->valid;
+    for(uint32_t i = 0; old && i < old->cmd_capacity; i++) {
+        count += (i != id && old->cmd_list[i].valid);
+    }
+    uint32_t size = 2 * DISPATCHER_INIT_CMD_COUNT;
+    while(size < 2 * count) {
+        size *= 2;
+    }
+
+    // Allocate the table header, the command list and the index at once
+    DispatcherTable_t* table =
+    calloc(1, sizeof(DispatcherTable_t) + capacity * sizeof(DispatcherCommand_t) + size * sizeof(uint32_t));
+    if(!table) {
+        log_error("calloc() returned NULL when building the command table (capacity: %u)", capacity);
+        return NULL;
+    }
+    table->cmd_capacity = capacity;
+    table->index_size = size;
+    table->cmd_index = (uint32_t*)&table->cmd_list[capacity];
+    if(old) {
+        memcpy(table->cmd_list, old->cmd_list, old->cmd_capacity * sizeof(DispatcherCommand_t));
+    }
+    table->cmd_list[id] = *cmd;
+
+    // Insert commands with linear probing
+    for(uint32_t bucket = 0; bucket < size; bucket++) {
+        table->cmd_index[bucket] = DISPATCHER_INDEX_EMPTY;
+    }
+    for(uint32_t i = 0; i < capacity; i++) {
+        if(table->cmd_list[i].valid) {
+            uint32_t bucket = table->cmd_list[i].hash & (size - 1);
+            while(table->cmd_index[bucket] != DISPATCHER_INDEX_EMPTY) {
+                bucket = (bucket + 1) & (size - 1);
+            }
+            table->cmd_index[bucket] = i;
         }
-        token_len = strnlen(token, DISPATCHER_ARG_MAX_SIZE - 1);
-        if(token_len >= DISPATCHER_ARG_MAX_SIZE) {
-            log_error("one of 'argument' tokens is too long (len: %lu)", token_len);
-            return DISPATCHER_ERR_TOKEN_TOO_LONG;
+    }
+
+    return table;
+}
+
+STATIC void dispatcher_table_publish(Dispatcher_t* ctx, DispatcherTable_t* table) {
+    DispatcherTable_t* old = atomic_exchange(&ctx->table, table);
+
+    // Lookups started after the exchange see the new table, so wait only for the ones in progress (grace period)
+    while(atomic_load(&ctx->readers) != 0) {
+        sched_yield();
+    }
+    free(old);
+}
+
+STATIC const DispatcherCommand_t* dispatcher_lookup(const DispatcherTable_t* table, const char* target, const char* action) {
+    if(!table) {
+        return NULL; // No commands registered yet
+    }
+
+    uint32_t hash = dispatcher_hash(target, action);
+    uint32_t bucket = hash & (table->index_size - 1);
+    while(table->cmd_index[bucket] != DISPATCHER_INDEX_EMPTY) {
+        const DispatcherCommand_t* cmd = &table->cmd_list[table->cmd_index[bucket]];
+        if(cmd->hash == hash && !strncasecmp(target, cmd->cfg.target, DISPATCHER_TARGET_MAX_SIZE) &&
+        !strncasecmp(action, cmd->cfg.action, DISPATCHER_ACTION_MAX_SIZE)) {
+            return cmd;
+        }
+        bucket = (bucket + 1) & (table->index_size - 1);
+    }
+
+    return NULL;
+}
+
+STATIC void* dispatcher_worker(void* arg) {
+    DispatcherPool_t* pool = &((Dispatcher_t*)arg)->pool;
+    DispatcherJob_t job;
+
+    while(true) {
+        // Take the oldest job off the ring (critical section)
+        int ret = metrics_mutex_lock(&pool->lock, METRICS_HIST_LOCK_DISPATCHER);
+        if(ret != 0) {
+            log_error("pthread_mutex_lock() returned %d", ret);
+            break;
+        }
+        log_debug("dispatcher pool lock taken");
+        while(pool->count == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+        bool stopping = pool->stopping;
+        if(!stopping) {
+            memcpy(&job, &pool->jobs[pool->head], sizeof(DispatcherJob_t));
+            pool->head = (pool->head + 1) % pool->size;
+            pool->count--;
         }
-        memcpy(output->argv[arg_no], token, token_len + 1);
-        output->argv[arg_no][DISPATCHER_ARG_MAX_SIZE - 1] = '\0'; // Cap 'arg' with NULL char
-        output->argc++;
+        pthread_mutex_unlock(&pool->lock);
+        log_debug("dispatcher pool lock released");
+
+        if(stopping) {
+            break;
+        }
+        job.fn(job.arg); // Run outside the critical section (other workers take the next jobs meanwhile)
     }
 
-    if(*next != '\0') {
-        err = DISPATCHER_ERR_TOO_MANY_ARGS;
+    return NULL;
+}
+
+STATIC void dispatcher_run_cmd(void* arg) {
+    DispatcherCmdJob_t* job = (DispatcherCmdJob_t*)arg;
+
+    char* argv_ptrs[DISPATCHER_MAX_ARGS];
+    char* pos = job->args;
+    for(uint32_t i = 0; i < job->argc; ++i) {
+        argv_ptrs[i] = pos;
+        pos += strlen(pos) + 1;
     }
+    metrics_cmd_begin();
+    job->callback_ptr(argv_ptrs, job->argc, job->has_ctx ? job->cmd_ctx : NULL);
+    metrics_cmd_end(job->id, job->start_ns, false); // Incl. the time spent in the queue
+}
 
-    return err;
+STATIC void dispatcher_pool_stop(DispatcherPool_t* pool) {
+    if(pool->thread_count > 0) {
+        pthread_mutex_lock(&pool->lock);
+        log_debug("dispatcher pool lock taken");
+        pool->stopping = true;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+        log_debug("dispatcher pool lock released");
+
+        for(uint16_t i = 0; i < pool->thread_count; i++) {
+            pthread_join(pool->threads[i], NULL);
+        }
+        if(pool->count > 0) {
+            log_info("%u offloaded jobs dropped on the dispatcher deinit", pool->count);
+        }
+        for(; pool->count > 0; pool->count--) {
+            DispatcherJob_t* job = &pool->jobs[pool->head];
+            if(job->drop) {
+                job->drop(job->arg);
+            }
+            pool->head = (pool->head + 1) % pool->size;
+        }
+    }
+    pool->thread_count = 0;
+
+    if(pool->jobs) {
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->jobs);
+        pool->jobs = NULL;
+    }
 }
 
 DispatcherError_t dispatcher_init(Dispatcher_t* ctx, const DispatcherConfig_t cfg) {
@@ -93,6 +323,8 @@ DispatcherError_t dispatcher_init(Dispatcher_t* ctx, const DispatcherConfig_t cf
         return DISPATCHER_ERR_NULL_ARG;
     } else if(strnlen(cfg.delim, DISPATCHER_MAX_DELIM_SIZE - 1) >= DISPATCHER_MAX_DELIM_SIZE - 1) {
         return DISPATCHER_ERR_DELIM_TOO_LONG;
+    } else if(cfg.worker_count > DISPATCHER_MAX_WORKERS || cfg.cmd_ctx_size > DISPATCHER_CMD_CTX_MAX_SIZE) {
+        return DISPATCHER_ERR_INVALID_ARG;
     }
 
     // Zero-out the Dispatcher_t struct and its members on init
@@ -107,6 +339,49 @@ DispatcherError_t dispatcher_init(Dispatcher_t* ctx, const DispatcherConfig_t cf
 
     // Populate data in the struct (cfg) and assign function pointers
     ctx->cfg = cfg;
+    if(ctx->cfg.queue_len == 0) {
+        ctx->cfg.queue_len = DISPATCHER_DEFAULT_QUEUE_LEN;
+    }
+    if(cfg.worker_count == 0) {
+        return DISPATCHER_ERR_OK; // All callbacks run inline
+    }
+
+    // Allocate the job queue and start the workers
+    DispatcherPool_t* pool = &ctx->pool;
+    pool->jobs = calloc(ctx->cfg.queue_len, sizeof(DispatcherJob_t));
+    if(!pool->jobs) {
+        log_error("calloc() returned NULL when allocating the job queue (len: %hu)", ctx->cfg.queue_len);
+        pthread_mutex_destroy(&ctx->lock);
+        return DISPATCHER_ERR_MALLOC_FAILURE;
+    }
+    pool->size = ctx->cfg.queue_len;
+    ret = pthread_mutex_init(&pool->lock, NULL);
+    if(ret == 0) {
+        ret = pthread_cond_init(&pool->cond, NULL);
+        if(ret != 0) {
+            pthread_mutex_destroy(&pool->lock);
+        }
+    }
+    if(ret != 0) {
+        log_error("pthread_mutex_init() / pthread_cond_init() returned %d", ret);
+        free(pool->jobs);
+        pthread_mutex_destroy(&ctx->lock);
+        memset(ctx, 0, sizeof(Dispatcher_t));
+        return DISPATCHER_ERR_PTHREAD_FAILURE;
+    }
+
+    for(uint16_t i = 0; i < cfg.worker_count; i++) {
+        ret = pthread_create(&pool->threads[i], NULL, dispatcher_worker, ctx);
+        if(ret != 0) {
+            log_error("pthread_create() returned %d", ret);
+            dispatcher_pool_stop(pool);
+            pthread_mutex_destroy(&ctx->lock);
+            memset(ctx, 0, sizeof(Dispatcher_t));
+            return DISPATCHER_ERR_PTHREAD_FAILURE;
+        }
+        pool->thread_count++;
+    }
+    log_debug("dispatcher workers started (count: %hu, queue len: %hu)", cfg.worker_count, ctx->cfg.queue_len);
 
     return DISPATCHER_ERR_OK;
 }
@@ -129,11 +404,18 @@ DispatcherError_t dispatcher_register(Dispatcher_t* ctx, const uint32_t id, cons
     }
     log_debug("dispatcher lock taken");
 
-    if(ctx->cmd_list[id].valid) {
+    // Publish a new snapshot with the cmd added (lookups in progress keep using the old one)
+    DispatcherTable_t* old = atomic_load(&ctx->table);
+    if(old && id < old->cmd_capacity && old->cmd_list[id].valid) {
         err = DISPATCHER_ERR_ID_ALREADY_TAKEN;
     } else {
-        ctx->cmd_list[id].cfg = cmd;
-        ctx->cmd_list[id].valid = true;
+        DispatcherCommand_t entry = { .valid = true, .hash = dispatcher_hash(cmd.target, cmd.action), .cfg = cmd };
+        DispatcherTable_t* table = dispatcher_table_build(old, id, &entry);
+        if(table) {
+            dispatcher_table_publish(ctx, table);
+        } else {
+            err = DISPATCHER_ERR_MALLOC_FAILURE;
+        }
     }
 
     ret = pthread_mutex_unlock(&ctx->lock);
@@ -161,7 +443,18 @@ DispatcherError_t dispatcher_deregister(Dispatcher_t* ctx, const uint32_t id) {
     }
     log_debug("dispatcher lock taken");
 
-    ctx->cmd_list[id].valid = false;
+    // Publish a new snapshot without the cmd (only if it is actually registered)
+    DispatcherError_t err = DISPATCHER_ERR_OK;
+    DispatcherTable_t* old = atomic_load(&ctx->table);
+    if(old && id < old->cmd_capacity && old->cmd_list[id].valid) {
+        DispatcherCommand_t entry = { .valid = false };
+        DispatcherTable_t* table = dispatcher_table_build(old, id, &entry);
+        if(table) {
+            dispatcher_table_publish(ctx, table);
+        } else {
+            err = DISPATCHER_ERR_MALLOC_FAILURE;
+        }
+    }
 
     ret = pthread_mutex_unlock(&ctx->lock);
     if(ret != 0) {
@@ -170,63 +463,141 @@ DispatcherError_t dispatcher_deregister(Dispatcher_t* ctx, const uint32_t id) {
     }
     log_debug("dispatcher lock released");
 
-    return DISPATCHER_ERR_OK;
+    return err;
 }
 
 DispatcherError_t dispatcher_execute(Dispatcher_t* ctx, const char* buf, const void* cmd_ctx) {
     if(!ctx || !buf) {
         return DISPATCHER_ERR_NULL_ARG;
-    } else if(strnlen(buf, DISPATCHER_MAX_BUF_SIZE) >= DISPATCHER_MAX_BUF_SIZE) {
+    }
+    size_t buf_len = strnlen(buf, DISPATCHER_MAX_BUF_SIZE);
+    if(buf_len >= DISPATCHER_MAX_BUF_SIZE) {
         return DISPATCHER_ERR_BUF_TOO_LONG;
     }
 
-    TokenizedCommand_t tokens;
-    DispatcherError_t err = dispatcher_tokenize(buf, ctx->cfg.delim, &tokens);
+    // Tokenize a private copy, since the input buffer is read-only
+    char _buf[DISPATCHER_MAX_BUF_SIZE];
+    memcpy(_buf, buf, buf_len + 1);
+
+    return dispatcher_execute_inplace(ctx, _buf, buf_len, cmd_ctx);
+}
+
+DispatcherError_t dispatcher_execute_inplace(Dispatcher_t* ctx, char* buf, const size_t len, const void* cmd_ctx) {
+    if(!ctx || !buf) {
+        return DISPATCHER_ERR_NULL_ARG;
+    }
+
+    uint64_t start_ns = metrics_now_ns();
+    DispatcherToken_t tokens[DISPATCHER_MAX_TOKENS];
+    uint32_t count;
+    DispatcherError_t err = dispatcher_tokenize(buf, len, ctx->cfg.delim, tokens, &count);
     if(err != DISPATCHER_ERR_OK) {
+        metrics_add(METRICS_DISPATCHER_REJECTED, 1);
         return err;
     }
 
-    // Itterate through the cmd list and look for the first cmd that will match target & action (critical section)
-    int ret = pthread_mutex_lock(&ctx->lock);
+    // Look up the cmd that matches target & action in the current snapshot (lock-free read-side section)
+    atomic_fetch_add(&ctx->readers, 1);
+    const DispatcherTable_t* table = atomic_load(&ctx->table);
+    const DispatcherCommand_t* cmd = dispatcher_lookup(table, tokens[0].ptr, tokens[1].ptr);
+    void (*callback_ptr)(char** argv, uint32_t argc, const void* cmd_ctx) = cmd ? cmd->cfg.callback_ptr : NULL;
+    bool offload = cmd ? cmd->cfg.offload : false;
+    uint32_t id = cmd ? (uint32_t)(cmd - table->cmd_list) : 0;
+    atomic_fetch_sub(&ctx->readers, 1);
+
+    if(!cmd) {
+        metrics_add(METRICS_DISPATCHER_REJECTED, 1);
+        return DISPATCHER_ERR_CMD_NOT_FOUND;
+    } else if(!callback_ptr) {
+        return DISPATCHER_ERR_NULL_ARG;
+    }
+
+    // Queue the offloaded command with a copy of its arguments (the buffer is reused once this function returns)
+    uint32_t argc = count - 2;
+    if(offload && ctx->pool.thread_count > 0) {
+        DispatcherCmdJob_t job = {
+            .callback_ptr = callback_ptr, .argc = argc, .has_ctx = false, .id = id, .start_ns = start_ns
+        };
+        if(cmd_ctx && ctx->cfg.cmd_ctx_size > 0) {
+            memcpy(job.cmd_ctx, cmd_ctx, ctx->cfg.cmd_ctx_size);
+            job.has_ctx = true;
+        }
+        size_t args_len = 0;
+        for(uint32_t i = 0; i < argc; ++i) {
+            memcpy(job.args + args_len, tokens[i + 2].ptr, tokens[i + 2].len + 1);
+            args_len += tokens[i + 2].len + 1;
+        }
+        err = dispatcher_offload(ctx, dispatcher_run_cmd, NULL, &job,
+        offsetof(DispatcherCmdJob_t, args) + args_len);
+        if(err != DISPATCHER_ERR_OK) {
+            metrics_cmd_end(id, start_ns, true); // Rejected (e.g. queue full)
+        }
+        return err;
+    }
+
+    // Invoke the callback associated with the parsed command (outside of the read-side section)
+    char* argv_ptrs[DISPATCHER_MAX_ARGS];
+    for(uint32_t i = 0; i < argc; ++i) {
+        argv_ptrs[i] = tokens[i + 2].ptr; // Arguments are NULL-terminated in place
+    }
+    metrics_cmd_begin();
+    callback_ptr(argv_ptrs, argc, cmd_ctx);
+    metrics_cmd_end(id, start_ns, false);
+
+    return DISPATCHER_ERR_OK;
+}
+
+DispatcherError_t dispatcher_offload(Dispatcher_t* ctx, void (*fn)(void* arg), void (*drop)(void* arg), const void* arg,
+const size_t arg_size) {
+    if(!ctx || !fn || (!arg && arg_size > 0)) {
+        return DISPATCHER_ERR_NULL_ARG;
+    } else if(arg_size > DISPATCHER_JOB_ARG_MAX_SIZE) {
+        return DISPATCHER_ERR_INVALID_ARG;
+    }
+
+    DispatcherPool_t* pool = &ctx->pool;
+    if(pool->thread_count == 0) {
+        // No workers, run the job inline (on a private copy, as the workers do)
+        DispatcherJob_t job;
+        if(arg_size > 0) { // memcpy() from NULL is undefined even for 0 bytes
+            memcpy(job.arg, arg, arg_size);
+        }
+        fn(job.arg);
+        return DISPATCHER_ERR_OK;
+    }
+
+    // Append the job to the ring (critical section)
+    int ret = metrics_mutex_lock(&pool->lock, METRICS_HIST_LOCK_DISPATCHER);
     if(ret != 0) {
         log_error("pthread_mutex_lock() returned %d", ret);
         return DISPATCHER_ERR_PTHREAD_FAILURE;
     }
-    log_debug("dispatcher lock taken");
+    log_debug("dispatcher pool lock taken");
 
-    bool match = false;
-    for(uint32_t cmd_no = 0; cmd_no < DISPATCHER_MAX_CMD_COUNT; cmd_no++) {
-        if(ctx->cmd_list[cmd_no].valid) {
-            // Compare target and action (string-insensitive)
-            match = !strncasecmp(tokens.target, ctx->cmd_list[cmd_no].cfg.target, DISPATCHER_TARGET_MAX_SIZE);
-            match &= !strncasecmp(tokens.action, ctx->cmd_list[cmd_no].cfg.action, DISPATCHER_ACTION_MAX_SIZE);
-            if(match) {
-                // Invoke the callback associated with the parsed command
-                if(ctx->cmd_list[cmd_no].cfg.callback_ptr == NULL) {
-                    err = DISPATCHER_ERR_NULL_ARG;
-                    break;
-                }
-                char* argv_ptrs[DISPATCHER_MAX_ARGS];
-                for(uint32_t i = 0; i < tokens.argc; ++i) {
-                    argv_ptrs[i] = tokens.argv[i];
-                }
-                ctx->cmd_list[cmd_no].cfg.callback_ptr(argv_ptrs, tokens.argc, cmd_ctx);
-                break; // Finish the search on the first cmd that matched
-            }
+    DispatcherError_t err = DISPATCHER_ERR_OK;
+    if(pool->count == pool->size) {
+        err = DISPATCHER_ERR_QUEUE_FULL;
+    } else {
+        DispatcherJob_t* job = &pool->jobs[(pool->head + pool->count) % pool->size];
+        job->fn = fn;
+        job->drop = drop;
+        if(arg_size > 0) {
+            memcpy(job->arg, arg, arg_size);
         }
+        pool->count++;
+        pthread_cond_signal(&pool->cond);
     }
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_mutex_unlock(&pool->lock);
     if(ret != 0) {
         log_error("pthread_mutex_unlock() returned %d", ret);
         return DISPATCHER_ERR_PTHREAD_FAILURE;
     }
-    log_debug("dispatcher lock released");
+    log_debug("dispatcher pool lock released");
 
-    if(!match && err != DISPATCHER_ERR_NULL_ARG) {
-        err = DISPATCHER_ERR_CMD_NOT_FOUND;
+    if(err == DISPATCHER_ERR_QUEUE_FULL) {
+        log_error("job queue full, job rejected (len: %u)", pool->size);
     }
-
     return err;
 }
 
@@ -234,6 +605,9 @@ DispatcherError_t dispatcher_deinit(Dispatcher_t* ctx) {
     if(!ctx) {
         return DISPATCHER_ERR_NULL_ARG;
     }
+    // Stop the workers first (waits for the callbacks being run)
+    dispatcher_pool_stop(&ctx->pool);
+
     // Destroy the lock (@TODO: Improve mutex destroy mechanism, e.g. add a global protection variable)
     int ret = pthread_mutex_destroy(&ctx->lock);
     if(ret != 0) {
@@ -241,6 +615,9 @@ DispatcherError_t dispatcher_deinit(Dispatcher_t* ctx) {
         return DISPATCHER_ERR_PTHREAD_FAILURE;
     }
 
+    // Release the command table (no lookups are expected at this point)
+    free(atomic_load(&ctx->table));
+
     // Zero-out the Dispatcher_t struct along with its members on deinit
     memset(ctx, 0, sizeof(Dispatcher_t));
 
@@ -0,0 +1,74 @@
+#define LOG_MODULE LOG_MODULE_APP
+
+#include "app/proto.h"
+
+#include <string.h> // For: memset()
+
+#include "utils/log.h"
+
+ProtoError_t proto_decode_request(const uint8_t* body, const size_t len, ProtoRequest_t* req) {
+    if(!body || !req) {
+        return PROTO_ERR_NULL_ARGUMENT;
+    }
+
+    memset(req, 0, sizeof(ProtoRequest_t));
+    if(len < PROTO_HEADER_SIZE) {
+        log_error("frame shorter than the header (len: %zu)", len);
+        return PROTO_ERR_MALFORMED_FRAME;
+    }
+    req->opcode = body[0];
+    req->req_id = proto_get_u32(body + 2); // body[1] is the status (ignored in requests)
+
+    // The payload is a list of uint32 arguments
+    size_t payload_len = len - PROTO_HEADER_SIZE;
+    if(payload_len % sizeof(uint32_t) != 0 || payload_len / sizeof(uint32_t) > PROTO_MAX_ARGS) {
+        log_error("malformed payload of the request (opcode: 0x%02hhX, len: %zu)", req->opcode, payload_len);
+        return PROTO_ERR_MALFORMED_FRAME;
+    }
+    req->argc = (uint32_t)(payload_len / sizeof(uint32_t));
+    for(uint32_t i = 0; i < req->argc; i++) {
+        req->argv[i] = proto_get_u32(body + PROTO_HEADER_SIZE + i * sizeof(uint32_t));
+    }
+
+    return PROTO_ERR_OK;
+}
+
+ProtoError_t proto_encode_header(uint8_t* hdr,
+const uint8_t opcode,
+const ProtoStatus_t status,
+const uint32_t req_id,
+const size_t payload_len) {
+    if(!hdr) {
+        return PROTO_ERR_NULL_ARGUMENT;
+    } else if(payload_len > PROTO_MAX_PAYLOAD) {
+        return PROTO_ERR_INVALID_ARGUMENT;
+    }
+
+    // The length prefix covers the header (except for the prefix itself) and the payload
+    size_t frame_len = PROTO_HEADER_SIZE + payload_len;
+    hdr[0] = (uint8_t)(frame_len >> 8);
+    hdr[1] = (uint8_t)frame_len;
+    hdr[2] = opcode;
+    hdr[3] = (uint8_t)status;
+    proto_put_u32(hdr + 4, req_id);
+
+    return PROTO_ERR_OK;
+}
+
+void proto_pack_reading(uint8_t* buf, const SensorReading_t* reading) {
+    buf[0] = reading->fields;
+    proto_put_u32(buf + 1, (uint32_t)reading->temp_cC);
+    proto_put_u32(buf + 5, reading->hum_q10);
+    proto_put_u32(buf + 9, reading->press_q8);
+}
+
+void proto_put_u32(uint8_t* buf, const uint32_t value) {
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)value;
+}
+
+uint32_t proto_get_u32(const uint8_t* buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+}
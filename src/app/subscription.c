@@ -0,0 +1,366 @@
+#define LOG_MODULE LOG_MODULE_SUBSCRIPTION
+
+#include "app/subscription.h"
+
+#include <stdlib.h> // For: calloc(), free()
+#include <string.h> // For: memset()
+#include <time.h>   // For: clock_gettime(), struct timespec
+
+#include "utils/common.h"
+#include "utils/log.h"
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time
+ * @return Time in milliseconds
+ */
+STATIC uint64_t subscription_time_ms(void);
+
+/**
+ * @brief Scheduler thread routine (delivers due samples and sleeps until the next subscription is due)
+ * @param[in]  arg  Pointer to the SubscriptionTable_t instance
+ * @return NULL
+ */
+STATIC void* subscription_scheduler(void* arg);
+
+/**
+ * @brief Collect subscriptions due at the given time into ctx->due and reschedule them [call with the lock taken]
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @param[in]  now_ms  Current time
+ * @param[out]  next_due_ms  Time when the next subscription becomes due (UINT64_MAX if there are no subscriptions)
+ * @return Number of due subscriptions
+ */
+STATIC uint32_t subscription_collect_due(SubscriptionTable_t* ctx, const uint64_t now_ms, uint64_t* next_due_ms);
+
+/**
+ * @brief Take one sample per sensor and deliver it to all due subscribers (called without the lock)
+ * @param[in, out]  ctx  Pointer to the SubscriptionTable_t instance
+ * @param[in]  count  Number of due subscriptions in ctx->due
+ */
+STATIC void subscription_fan_out(SubscriptionTable_t* ctx, const uint32_t count);
+
+SubscriptionError_t subscription_init(SubscriptionTable_t* ctx, const SubscriptionConfig_t cfg) {
+    if(!ctx || !cfg.sample || !cfg.deliver) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    } else if(cfg.max_count == 0 || cfg.min_period_ms == 0 || cfg.min_period_ms > cfg.max_period_ms) {
+        return SUBSCRIPTION_ERR_INVALID_ARG;
+    }
+
+    // Zero-out the SubscriptionTable_t struct on init
+    memset(ctx, 0, sizeof(SubscriptionTable_t));
+    ctx->cfg = cfg;
+
+    // Allocate the table and the scratch table for due subscriptions at once
+    ctx->list = (Subscription_t*)calloc(2 * cfg.max_count, sizeof(Subscription_t));
+    if(!ctx->list) {
+        log_error("calloc() returned NULL when allocating the subscription table");
+        return SUBSCRIPTION_ERR_MALLOC_FAILURE;
+    }
+    ctx->due = ctx->list + cfg.max_count;
+
+    // Initialize mutex and condition variable (measuring timeouts on the monotonic clock)
+    int ret = pthread_mutex_init(&ctx->lock, NULL);
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        free(ctx->list);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    ret = pthread_cond_init(&ctx->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if(ret != 0) {
+        log_error("pthread_cond_init() returned %d", ret);
+        pthread_mutex_destroy(&ctx->lock);
+        free(ctx->list);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+
+    return SUBSCRIPTION_ERR_OK;
+}
+
+SubscriptionError_t subscription_start(SubscriptionTable_t* ctx) {
+    if(!ctx) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    } else if(ctx->running) {
+        return SUBSCRIPTION_ERR_GENERIC;
+    }
+
+    ctx->running = true;
+    int ret = pthread_create(&ctx->thread, NULL, subscription_scheduler, (void*)ctx);
+    if(ret != 0) {
+        log_error("pthread_create() returned %d", ret);
+        ctx->running = false;
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+
+    return SUBSCRIPTION_ERR_OK;
+}
+
+SubscriptionError_t subscription_stop(SubscriptionTable_t* ctx) {
+    if(!ctx) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    }
+
+    // Clear the running flag and wake up the scheduler (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock taken");
+
+    bool was_running = ctx->running;
+    ctx->running = false;
+    pthread_cond_signal(&ctx->cond);
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock released");
+
+    if(was_running) {
+        ret = pthread_join(ctx->thread, NULL);
+        if(ret != 0) {
+            log_error("pthread_join() returned %d", ret);
+            return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+        }
+    }
+
+    return SUBSCRIPTION_ERR_OK;
+}
+
+SubscriptionError_t
+subscription_add(SubscriptionTable_t* ctx, const ServerClient_t client, const uint8_t sensor_id, const uint32_t period_ms) {
+    if(!ctx) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    } else if(period_ms < ctx->cfg.min_period_ms || period_ms > ctx->cfg.max_period_ms) {
+        return SUBSCRIPTION_ERR_INVALID_ARG;
+    }
+
+    // Update an existing subscription or take a free slot (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock taken");
+
+    Subscription_t* slot = NULL;
+    for(uint32_t i = 0; i < ctx->cfg.max_count; i++) {
+        Subscription_t* sub = &ctx->list[i];
+        if(sub->active && server_client_equal(sub->client, client) && sub->sensor_id == sensor_id) {
+            slot = sub; // Already subscribed - just update the period
+            break;
+        } else if(!sub->active && !slot) {
+            slot = sub;
+        }
+    }
+
+    SubscriptionError_t err = SUBSCRIPTION_ERR_OK;
+    if(slot) {
+        *slot = (Subscription_t){ .active = true,
+            .client = client,
+            .sensor_id = sensor_id,
+            .period_ms = period_ms,
+            .next_due_ms = subscription_time_ms() }; // The first sample is delivered right away
+        pthread_cond_signal(&ctx->cond);
+    } else {
+        err = SUBSCRIPTION_ERR_TABLE_FULL;
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock released");
+
+    return err;
+}
+
+SubscriptionError_t subscription_remove(SubscriptionTable_t* ctx, const ServerClient_t client, const uint8_t sensor_id) {
+    if(!ctx) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    }
+
+    // Look for the subscription and release its slot (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock taken");
+
+    SubscriptionError_t err = SUBSCRIPTION_ERR_NOT_FOUND;
+    for(uint32_t i = 0; i < ctx->cfg.max_count; i++) {
+        Subscription_t* sub = &ctx->list[i];
+        if(sub->active && server_client_equal(sub->client, client) && sub->sensor_id == sensor_id) {
+            sub->active = false;
+            err = SUBSCRIPTION_ERR_OK;
+            break;
+        }
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock released");
+
+    return err;
+}
+
+SubscriptionError_t subscription_remove_client(SubscriptionTable_t* ctx, const ServerClient_t client) {
+    if(!ctx) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    }
+
+    // Release all slots taken by the client (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock taken");
+
+    for(uint32_t i = 0; i < ctx->cfg.max_count; i++) {
+        if(ctx->list[i].active && server_client_equal(ctx->list[i].client, client)) {
+            ctx->list[i].active = false;
+        }
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("subscription lock released");
+
+    return SUBSCRIPTION_ERR_OK;
+}
+
+SubscriptionError_t subscription_deinit(SubscriptionTable_t* ctx) {
+    if(!ctx) {
+        return SUBSCRIPTION_ERR_NULL_ARG;
+    }
+
+    SubscriptionError_t err = subscription_stop(ctx);
+    if(err != SUBSCRIPTION_ERR_OK) {
+        return err;
+    }
+
+    pthread_cond_destroy(&ctx->cond);
+    int ret = pthread_mutex_destroy(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_destroy() returned %d", ret);
+        return SUBSCRIPTION_ERR_PTHREAD_FAILURE;
+    }
+    free(ctx->list);
+
+    // Zero-out the SubscriptionTable_t struct on deinit
+    memset(ctx, 0, sizeof(SubscriptionTable_t));
+
+    return SUBSCRIPTION_ERR_OK;
+}
+
+STATIC uint64_t subscription_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+STATIC void* subscription_scheduler(void* arg) {
+    SubscriptionTable_t* ctx = (SubscriptionTable_t*)arg;
+
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d; exiting the scheduler", ret);
+        return NULL;
+    }
+    log_debug("subscription lock taken");
+
+    while(ctx->running) {
+        // Take a snapshot of due subscriptions, then sample and send without holding the lock
+        uint64_t next_due_ms;
+        uint32_t count = subscription_collect_due(ctx, subscription_time_ms(), &next_due_ms);
+        if(count > 0) {
+            pthread_mutex_unlock(&ctx->lock);
+            log_debug("subscription lock released");
+
+            subscription_fan_out(ctx, count);
+
+            pthread_mutex_lock(&ctx->lock);
+            log_debug("subscription lock taken");
+            continue; // The table may have changed in the meantime
+        }
+
+        // Sleep until the next subscription is due (or until the table changes)
+        if(next_due_ms == UINT64_MAX) {
+            pthread_cond_wait(&ctx->cond, &ctx->lock);
+        } else {
+            struct timespec deadline = { .tv_sec = (time_t)(next_due_ms / 1000ULL),
+                .tv_nsec = (long)((next_due_ms % 1000ULL) * 1000000ULL) };
+            pthread_cond_timedwait(&ctx->cond, &ctx->lock, &deadline);
+        }
+    }
+
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("subscription lock released");
+
+    return NULL;
+}
+
+STATIC uint32_t subscription_collect_due(SubscriptionTable_t* ctx, const uint64_t now_ms, uint64_t* next_due_ms) {
+    uint32_t count = 0;
+    *next_due_ms = UINT64_MAX;
+
+    for(uint32_t i = 0; i < ctx->cfg.max_count; i++) {
+        Subscription_t* sub = &ctx->list[i];
+        if(!sub->active) {
+            continue;
+        }
+        if(sub->next_due_ms <= now_ms) {
+            ctx->due[count++] = *sub;
+            // Keep the period steady, but skip the missed ticks instead of bursting after a stall
+            sub->next_due_ms += sub->period_ms;
+            if(sub->next_due_ms <= now_ms) {
+                sub->next_due_ms = now_ms + sub->period_ms;
+            }
+        }
+        if(sub->next_due_ms < *next_due_ms) {
+            *next_due_ms = sub->next_due_ms;
+        }
+    }
+
+    return count;
+}
+
+STATIC void subscription_fan_out(SubscriptionTable_t* ctx, const uint32_t count) {
+    char msg[SUBSCRIPTION_MSG_MAX_SIZE];
+
+    for(uint32_t i = 0; i < count; i++) {
+        if(!ctx->due[i].active) {
+            continue; // Already served together with an earlier subscriber of the same sensor
+        }
+
+        // Sample the sensor once and send the same message to all of its due subscribers
+        uint8_t sensor_id = ctx->due[i].sensor_id;
+        msg[0] = '\0';
+        bool sample_ok = ctx->cfg.sample(sensor_id, msg, sizeof(msg));
+        for(uint32_t j = i; j < count; j++) {
+            Subscription_t* sub = &ctx->due[j];
+            if(!sub->active || sub->sensor_id != sensor_id) {
+                continue;
+            }
+            sub->active = false;
+            if(!ctx->cfg.deliver(&sub->client, msg, sample_ok)) {
+                log_error("failed to deliver a sample to the client (fd: %d); unsubscribing", sub->client.fd);
+                subscription_remove_client(ctx, sub->client);
+            }
+        }
+    }
+}
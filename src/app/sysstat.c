@@ -1,8 +1,13 @@
+#define LOG_MODULE LOG_MODULE_SYSSTAT
+
 #include "app/sysstat.h"
 
 #include <errno.h>  // for: errno
-#include <stdio.h>  // for: fopen, strerror
-#include <string.h> // For: strtok_r(), strnlen()
+#include <fcntl.h>  // For: open
+#include <stdio.h>  // for: strerror
+#include <string.h> // For: strncmp(), strnlen()
+#include <time.h>   // For: clock_gettime
+#include <unistd.h> // For: pread, close
 
 #include "utils/common.h"
 #include "utils/log.h"
@@ -10,11 +15,118 @@
 #define SYSSTAT_UPTIME_PATH "/proc/uptime"
 #define SYSSTAT_MEMINFO_PATH "/proc/meminfo"
 #define SYSSTAT_NET_DEV_PATH "/proc/net/dev"
+#define SYSSTAT_STAT_PATH "/proc/stat"
+#define SYSSTAT_THERMAL_PATH "/sys/class/thermal/thermal_zone0/temp"
 
 #define SYSSTAT_UPTIME_BUF_LEN 40
 #define SYSSTAT_MEMINFO_BUF_LEN 2048
 #define SYSSTAT_NET_DEV_BUF_LEN 1024
 
+#define SYSSTAT_NET_DEV_SKIPPED_RX_FIELDS 6 // Fields between rx packets and tx bytes (errs, drop, fifo, frame, ...)
+#define SYSSTAT_STAT_CPU_FIELDS 8           // CPU time fields summed up (user, nice, ..., steal; guest is in user)
+#define SYSSTAT_STAT_IDLE_FIELD 3           // Index of the idle field (followed by iowait)
+
+// Paths of the files held open by the Sysstat instance (indexed by SysstatSourceId_t)
+static const char* SYSSTAT_SOURCE_PATHS[SYSSTAT_SOURCE_COUNT] = {
+    SYSSTAT_UPTIME_PATH,
+    SYSSTAT_MEMINFO_PATH,
+    SYSSTAT_NET_DEV_PATH,
+    SYSSTAT_STAT_PATH,
+    SYSSTAT_THERMAL_PATH,
+};
+
+/**
+ * @brief Read the whole file from its beginning into the buffer (with pread, so the fd can be reused)
+ *
+ * @param[in] fd File descriptor of the file
+ * @param[in, out] buf Pointer to the buffer where file contents will be stored
+ * @param[in] buf_len Length of the buffer, including space for null terminator
+ * @param[out] len Length of the contents (without the null terminator)
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_BUF_TOO_SHORT / SYSSTAT_ERR_FILESYSTEM_FAILURE otherwise
+ */
+STATIC SysstatError_t sysstat_read_fd(const int fd, char* buf, const size_t buf_len, size_t* len);
+
+/**
+ * @brief Get a fresh (not older than the TTL) contents of the held-open file, read it again if needed
+ *
+ * @param[in, out] ctx Pointer to the instance (locked by the caller)
+ * @param[in] id Source to be refreshed
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_BUF_TOO_SHORT / SYSSTAT_ERR_FILESYSTEM_FAILURE otherwise
+ */
+STATIC SysstatError_t sysstat_source_refresh(Sysstat_t* ctx, const SysstatSourceId_t id);
+
+/**
+ * @brief Parse the contents of /proc/uptime (e.g. "350735.47 234388.90")
+ *
+ * @param[in] buf NULL-terminated contents of the file
+ * @param[out] uptime Pointer to store uptime value
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_GENERIC otherwise
+ */
+STATIC SysstatError_t sysstat_parse_uptime_info(const char* buf, SysstatUptimeInfo_t* uptime);
+
+/**
+ * @brief Parse the contents of /proc/meminfo (MemTotal, MemFree and MemAvailable lines)
+ *
+ * @param[in] buf NULL-terminated contents of the file
+ * @param[out] mem_info Pointer to SysstatMemInfo_t to store results
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_GENERIC otherwise
+ */
+STATIC SysstatError_t sysstat_parse_mem_info(const char* buf, SysstatMemInfo_t* mem_info);
+
+/**
+ * @brief Parse the line of the interface from the contents of /proc/net/dev
+ *
+ * @param[in] buf NULL-terminated contents of the file
+ * @param[in] interface_name Name of the network interface (e.g., "eth0")
+ * @param[out] net_info Pointer to SysstatNetInfo_t to store results
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_GENERIC otherwise
+ */
+STATIC SysstatError_t sysstat_parse_net_info(const char* buf, const char* interface_name, SysstatNetInfo_t* net_info);
+
+/**
+ * @brief Parse the aggregated "cpu" line of /proc/stat
+ *
+ * @param[in] buf NULL-terminated contents of the file
+ * @param[out] cpu_info Pointer to SysstatCpuInfo_t to store results
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_GENERIC otherwise
+ */
+STATIC SysstatError_t sysstat_parse_cpu_info(const char* buf, SysstatCpuInfo_t* cpu_info);
+
+/**
+ * @brief Parse the contents of a thermal zone temp file (e.g. "48312", may be negative)
+ *
+ * @param[in] buf NULL-terminated contents of the file
+ * @param[out] temp_mC Pointer to store the temperature (in milli-degrees Celsius)
+ * @return SYSSTAT_ERR_OK on success, SYSSTAT_ERR_GENERIC otherwise
+ */
+STATIC SysstatError_t sysstat_parse_temp(const char* buf, int32_t* temp_mC);
+
+/**
+ * @brief Scan an unsigned decimal number (leading spaces are skipped) and move the position behind it
+ *
+ * @param[in, out] pos Pointer to the scanning position
+ * @param[out] value Pointer to store the number
+ * @return true on success, false if there is no number at the position or the number overflows
+ */
+STATIC bool sysstat_scan_u64(const char** pos, uint64_t* value);
+
+/**
+ * @brief Find the line starting with the key (leading spaces are skipped)
+ *
+ * @param[in] buf NULL-terminated text
+ * @param[in] key Key to be found (e.g. "MemTotal:")
+ * @return Pointer to the first char behind the key, NULL if no line starts with the key
+ */
+STATIC const char* sysstat_find_line(const char* buf, const char* key);
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time
+ *
+ * @return Time in milliseconds
+ */
+STATIC uint64_t sysstat_time_ms(void);
+
+
 /**
  * @brief Read all characters from the file into the buffer
  *
@@ -31,35 +143,24 @@ STATIC SysstatError_t file_to_buf(char* buf, const size_t buf_len, const char* p
     }
 
     // Open the file for reading
-    FILE* f_ptr = fopen(path, "r");
-    if(!f_ptr) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
         log_error("failed to open %.25s (errno: %s)", path, strerror(errno));
         return SYSSTAT_ERR_FILESYSTEM_FAILURE;
     }
 
-    char* end = buf + buf_len - 1; // Reserve one byte for the null terminator
-    int c;
-
-    // Read all characters one by one
-    while((c = getc(f_ptr)) != EOF && buf < end) {
-        *buf = (char)c;
-        buf++;
-    }
-    *buf = '\0';
+    // Read the whole file at once (instead of char by char)
+    size_t len;
+    SysstatError_t err = sysstat_read_fd(fd, buf, buf_len, &len);
 
     // Close the file once the data has been saved in the buffer
-    int ret = fclose(f_ptr);
+    int ret = close(fd);
     if(ret != 0) {
-        log_error("failed to open %.25s (errno: %s)", path, strerror(errno));
+        log_error("failed to close %.25s (errno: %s)", path, strerror(errno));
         return SYSSTAT_ERR_FILESYSTEM_FAILURE;
     }
 
-    // Return error if the file still has characters but the buffer is already full
-    if(c != EOF && buf == end) {
-        return SYSSTAT_ERR_BUF_TOO_SHORT;
-    }
-
-    return SYSSTAT_ERR_OK;
+    return err;
 }
 
 SysstatError_t sysstat_get_uptime_info(SysstatUptimeInfo_t* uptime) {
@@ -74,12 +175,7 @@ SysstatError_t sysstat_get_uptime_info(SysstatUptimeInfo_t* uptime) {
         return err;
     }
 
-    // @TODO: sscanf should be replaced with saver tokenizer & strto...() to prevent conversion overflow
-    if(sscanf(buf, "%u.%hu %u.%hu", &uptime->up.s, &uptime->up.ms, &uptime->idle.s, &uptime->idle.ms) != 4) {
-        return SYSSTAT_ERR_GENERIC;
-    }
-
-    return SYSSTAT_ERR_OK;
+    return sysstat_parse_uptime_info(buf, uptime);
 }
 
 SysstatError_t sysstat_get_mem_info(SysstatMemInfo_t* mem_info) {
@@ -94,13 +190,7 @@ SysstatError_t sysstat_get_mem_info(SysstatMemInfo_t* mem_info) {
         return err;
     }
 
-    // @TODO: sscanf should be replaced with saver tokenizer & strto...() to prevent conversion errors (e.g. overflow or generic failure)
-    if(sscanf(buf, "MemTotal: %lu kB MemFree: %lu kB MemAvailable: %lu", &mem_info->total_kB,
-       &mem_info->free_kB, &mem_info->available_kB) == EOF) {
-        return SYSSTAT_ERR_GENERIC;
-    }
-
-    return SYSSTAT_ERR_OK;
+    return sysstat_parse_mem_info(buf, mem_info);
 }
 
 SysstatError_t sysstat_get_net_info(const char* interface_name, SysstatNetInfo_t* net_info) {
@@ -115,17 +205,366 @@ SysstatError_t sysstat_get_net_info(const char* interface_name, SysstatNetInfo_t
         return err;
     }
 
-    // Move to the line with the interface-of-interest statistics
-    char* if_stats = strstr(buf, interface_name);
-    if(!if_stats) {
+    return sysstat_parse_net_info(buf, interface_name, net_info);
+}
+
+SysstatError_t sysstat_init(Sysstat_t* ctx, const uint32_t ttl_ms) {
+    if(!ctx) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    }
+
+    memset(ctx, 0, sizeof(Sysstat_t));
+    ctx->ttl_ms = ttl_ms;
+    int ret = pthread_mutex_init(&ctx->lock, NULL);
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+
+    // Open the files once, they are read from the beginning on every refresh
+    for(int i = 0; i < SYSSTAT_SOURCE_COUNT; i++) {
+        ctx->sources[i].fd = open(SYSSTAT_SOURCE_PATHS[i], O_RDONLY | O_CLOEXEC);
+        if(ctx->sources[i].fd == -1) {
+            log_error("failed to open %.25s (errno: %s)", SYSSTAT_SOURCE_PATHS[i], strerror(errno));
+        }
+    }
+    ctx->is_initialized = true;
+
+    log_debug("sysstat initialized (ttl: %u ms)", ttl_ms);
+    return SYSSTAT_ERR_OK;
+}
+
+SysstatError_t sysstat_deinit(Sysstat_t* ctx) {
+    if(!ctx) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+
+    SysstatError_t err = SYSSTAT_ERR_OK;
+    for(int i = 0; i < SYSSTAT_SOURCE_COUNT; i++) {
+        if(ctx->sources[i].fd != -1 && close(ctx->sources[i].fd) != 0) {
+            log_error("failed to close %.25s (errno: %s)", SYSSTAT_SOURCE_PATHS[i], strerror(errno));
+            err = SYSSTAT_ERR_FILESYSTEM_FAILURE;
+        }
+        ctx->sources[i].fd = -1;
+    }
+    int ret = pthread_mutex_destroy(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_destroy() returned %d", ret);
+        err = SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+    ctx->is_initialized = false;
+
+    return err;
+}
+
+SysstatError_t sysstat_get_uptime_info_cached(Sysstat_t* ctx, SysstatUptimeInfo_t* uptime) {
+    if(!ctx || !uptime) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    log_debug("sysstat lock taken");
+    SysstatError_t err = sysstat_source_refresh(ctx, SYSSTAT_SOURCE_UPTIME);
+    if(err == SYSSTAT_ERR_OK) {
+        err = sysstat_parse_uptime_info(ctx->sources[SYSSTAT_SOURCE_UPTIME].buf, uptime);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("sysstat lock released");
+
+    return err;
+}
+
+SysstatError_t sysstat_get_mem_info_cached(Sysstat_t* ctx, SysstatMemInfo_t* mem_info) {
+    if(!ctx || !mem_info) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    log_debug("sysstat lock taken");
+    SysstatError_t err = sysstat_source_refresh(ctx, SYSSTAT_SOURCE_MEMINFO);
+    if(err == SYSSTAT_ERR_OK) {
+        err = sysstat_parse_mem_info(ctx->sources[SYSSTAT_SOURCE_MEMINFO].buf, mem_info);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("sysstat lock released");
+
+    return err;
+}
+
+SysstatError_t sysstat_get_net_info_cached(Sysstat_t* ctx, const char* interface_name, SysstatNetInfo_t* net_info) {
+    if(!ctx || !interface_name || !net_info) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    log_debug("sysstat lock taken");
+    SysstatError_t err = sysstat_source_refresh(ctx, SYSSTAT_SOURCE_NET_DEV);
+    if(err == SYSSTAT_ERR_OK) {
+        err = sysstat_parse_net_info(ctx->sources[SYSSTAT_SOURCE_NET_DEV].buf, interface_name, net_info);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("sysstat lock released");
+
+    return err;
+}
+
+SysstatError_t sysstat_get_cpu_info_cached(Sysstat_t* ctx, SysstatCpuInfo_t* cpu_info) {
+    if(!ctx || !cpu_info) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    log_debug("sysstat lock taken");
+    SysstatError_t err = sysstat_source_refresh(ctx, SYSSTAT_SOURCE_STAT);
+    if(err == SYSSTAT_ERR_OK) {
+        err = sysstat_parse_cpu_info(ctx->sources[SYSSTAT_SOURCE_STAT].buf, cpu_info);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("sysstat lock released");
+
+    return err;
+}
+
+SysstatError_t sysstat_get_temp_cached(Sysstat_t* ctx, int32_t* temp_mC) {
+    if(!ctx || !temp_mC) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    log_debug("sysstat lock taken");
+    SysstatError_t err = sysstat_source_refresh(ctx, SYSSTAT_SOURCE_THERMAL);
+    if(err == SYSSTAT_ERR_OK) {
+        err = sysstat_parse_temp(ctx->sources[SYSSTAT_SOURCE_THERMAL].buf, temp_mC);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("sysstat lock released");
+
+    return err;
+}
+
+STATIC SysstatError_t sysstat_read_fd(const int fd, char* buf, const size_t buf_len, size_t* len) {
+    // Read from the beginning until EOF (a /proc file is generated on the fly, so it may come in chunks)
+    size_t total = 0;
+    while(total < buf_len - 1) {
+        ssize_t bytes = pread(fd, buf + total, buf_len - 1 - total, (off_t)total);
+        if(bytes < 0 && errno == EINTR) {
+            continue;
+        } else if(bytes < 0) {
+            log_error("pread() failed (errno: %s)", strerror(errno));
+            buf[total] = '\0';
+            return SYSSTAT_ERR_FILESYSTEM_FAILURE;
+        } else if(bytes == 0) {
+            break;
+        }
+        total += (size_t)bytes;
+    }
+    buf[total] = '\0';
+    *len = total;
+
+    // Return error if the buffer is already full (the file may still have characters)
+    if(total == buf_len - 1) {
+        return SYSSTAT_ERR_BUF_TOO_SHORT;
+    }
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC SysstatError_t sysstat_source_refresh(Sysstat_t* ctx, const SysstatSourceId_t id) {
+    SysstatSource_t* src = &ctx->sources[id];
+
+    // Serve the cached contents while they are fresh enough
+    uint64_t now_ms = sysstat_time_ms();
+    if(src->valid && ctx->ttl_ms > 0 && now_ms - src->timestamp_ms < ctx->ttl_ms) {
+        return SYSSTAT_ERR_OK;
+    }
+
+    // Retry opening the file if it was not available so far
+    if(src->fd == -1) {
+        src->fd = open(SYSSTAT_SOURCE_PATHS[id], O_RDONLY | O_CLOEXEC);
+        if(src->fd == -1) {
+            log_error("failed to open %.25s (errno: %s)", SYSSTAT_SOURCE_PATHS[id], strerror(errno));
+            return SYSSTAT_ERR_FILESYSTEM_FAILURE;
+        }
+    }
+
+    src->valid = false;
+    SysstatError_t err = sysstat_read_fd(src->fd, src->buf, sizeof(src->buf), &src->len);
+    if(err == SYSSTAT_ERR_BUF_TOO_SHORT && id == SYSSTAT_SOURCE_STAT) {
+        err = SYSSTAT_ERR_OK; // Only the leading cpu line is used (the per-IRQ counters that follow can be huge)
+    }
+    if(err != SYSSTAT_ERR_OK) {
+        return err;
+    }
+    src->valid = true;
+    src->timestamp_ms = now_ms;
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC SysstatError_t sysstat_parse_uptime_info(const char* buf, SysstatUptimeInfo_t* uptime) {
+    SysstatTime_t* times[] = { &uptime->up, &uptime->idle };
+    const char* pos = buf;
+
+    // Both values are seconds with a fractional part (usually in hundredths of a second)
+    for(size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        uint64_t s;
+        if(!sysstat_scan_u64(&pos, &s) || s > UINT32_MAX) {
+            return SYSSTAT_ERR_GENERIC;
+        }
+        uint16_t ms = 0;
+        if(*pos == '.') {
+            pos++;
+            uint16_t scale = 100;
+            for(; *pos >= '0' && *pos <= '9'; pos++) {
+                ms += (uint16_t)(*pos - '0') * scale;
+                scale /= 10;
+            }
+        }
+        times[i]->s = (uint32_t)s;
+        times[i]->ms = ms;
+    }
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC SysstatError_t sysstat_parse_mem_info(const char* buf, SysstatMemInfo_t* mem_info) {
+    const char* keys[] = { "MemTotal:", "MemFree:", "MemAvailable:" };
+    uint64_t* values[] = { &mem_info->total_kB, &mem_info->free_kB, &mem_info->available_kB };
+
+    for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        const char* pos = sysstat_find_line(buf, keys[i]);
+        if(!pos || !sysstat_scan_u64(&pos, values[i])) {
+            return SYSSTAT_ERR_GENERIC;
+        }
+    }
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC SysstatError_t sysstat_parse_net_info(const char* buf, const char* interface_name, SysstatNetInfo_t* net_info) {
+    // Move to the line with the interface-of-interest statistics (e.g. "  wlan0: 1234 56 0 0 0 0 0 0 7890 12 ...")
+    char key[32];
+    int key_len = snprintf(key, sizeof(key), "%s:", interface_name);
+    if(key_len < 0 || (size_t)key_len >= sizeof(key)) {
+        return SYSSTAT_ERR_GENERIC;
+    }
+    const char* pos = sysstat_find_line(buf, key);
+    if(!pos) {
+        return SYSSTAT_ERR_GENERIC;
+    }
+
+    // Receive bytes & packets, then the remaining receive fields, then transmit bytes & packets
+    uint64_t skipped;
+    if(!sysstat_scan_u64(&pos, &net_info->rx_bytes) || !sysstat_scan_u64(&pos, &net_info->rx_packets)) {
+        return SYSSTAT_ERR_GENERIC;
+    }
+    for(int i = 0; i < SYSSTAT_NET_DEV_SKIPPED_RX_FIELDS; i++) {
+        if(!sysstat_scan_u64(&pos, &skipped)) {
+            return SYSSTAT_ERR_GENERIC;
+        }
+    }
+    if(!sysstat_scan_u64(&pos, &net_info->tx_bytes) || !sysstat_scan_u64(&pos, &net_info->tx_packets)) {
+        return SYSSTAT_ERR_GENERIC;
+    }
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC SysstatError_t sysstat_parse_cpu_info(const char* buf, SysstatCpuInfo_t* cpu_info) {
+    // e.g. "cpu  10132153 290696 3084719 46828483 16683 0 25195 0 0 0"
+    const char* pos = sysstat_find_line(buf, "cpu ");
+    if(!pos) {
         return SYSSTAT_ERR_GENERIC;
     }
 
-    // @TODO: sscanf should be replaced with saver tokenizer & strto...() to prevent conversion errors (e.g. overflow or generic failure)
-    if(sscanf(if_stats, "%*32s %lu %lu %*u %*u %*u %*u %*u %*u %lu %lu", &net_info->rx_bytes,
-       &net_info->rx_packets, &net_info->tx_bytes, &net_info->tx_packets) != 4) {
+    uint64_t fields[SYSSTAT_STAT_CPU_FIELDS];
+    cpu_info->total_jiffies = 0;
+    for(int i = 0; i < SYSSTAT_STAT_CPU_FIELDS; i++) {
+        if(!sysstat_scan_u64(&pos, &fields[i])) {
+            return SYSSTAT_ERR_GENERIC;
+        }
+        cpu_info->total_jiffies += fields[i];
+    }
+    cpu_info->idle_jiffies = fields[SYSSTAT_STAT_IDLE_FIELD] + fields[SYSSTAT_STAT_IDLE_FIELD + 1];
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC SysstatError_t sysstat_parse_temp(const char* buf, int32_t* temp_mC) {
+    const char* pos = buf;
+    bool negative = (*pos == '-');
+    if(negative) {
+        pos++;
+    }
+
+    uint64_t value;
+    if(!sysstat_scan_u64(&pos, &value) || value > INT32_MAX) {
         return SYSSTAT_ERR_GENERIC;
     }
+    *temp_mC = negative ? -(int32_t)value : (int32_t)value;
 
     return SYSSTAT_ERR_OK;
-}
\ No newline at end of file
+}
+
+STATIC bool sysstat_scan_u64(const char** pos, uint64_t* value) {
+    const char* p = *pos;
+    while(*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if(*p < '0' || *p > '9') {
+        return false;
+    }
+
+    uint64_t v = 0;
+    for(; *p >= '0' && *p <= '9'; p++) {
+        uint64_t digit = (uint64_t)(*p - '0');
+        if(v > (UINT64_MAX - digit) / 10) {
+            return false; // Overflow
+        }
+        v = v * 10 + digit;
+    }
+    *value = v;
+    *pos = p;
+
+    return true;
+}
+
+STATIC const char* sysstat_find_line(const char* buf, const char* key) {
+    size_t key_len = strlen(key);
+    for(const char* line = buf; *line != '\0';) {
+        const char* p = line;
+        while(*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if(strncmp(p, key, key_len) == 0) {
+            return p + key_len;
+        }
+
+        // Move to the next line
+        const char* nl = strchr(p, '\n');
+        if(!nl) {
+            break;
+        }
+        line = nl + 1;
+    }
+
+    return NULL;
+}
+
+STATIC uint64_t sysstat_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
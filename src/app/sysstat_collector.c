@@ -0,0 +1,298 @@
+#define LOG_MODULE LOG_MODULE_SYSSTAT
+
+#include "app/sysstat_collector.h"
+
+#include <string.h> // For: memset(), memcpy(), strnlen()
+#include <time.h>   // For: clock_gettime(), struct timespec
+
+#include "utils/common.h"
+#include "utils/log.h"
+
+/**
+ * @brief Collector thread routine (takes a sample every interval_ms until stopped)
+ * @param[in]  arg  Pointer to the SysstatCollector_t instance
+ * @return NULL
+ */
+STATIC void* sysstat_collector_loop(void* arg);
+
+/**
+ * @brief Read all the statistics, compute the rates since the previous sample and store the sample in the ring
+ * @param[in, out]  ctx  Pointer to the SysstatCollector_t instance [called only by the single writer]
+ */
+STATIC void sysstat_collector_sample(SysstatCollector_t* ctx);
+
+/**
+ * @brief Copy the sample of the given sequence number out of the ring (retried while the slot is being written)
+ * @param[in]  ctx  Pointer to the SysstatCollector_t instance
+ * @param[in]  n  Sequence number of the sample (0 for the first collected sample)
+ * @param[out]  sample  Pointer to store the sample
+ */
+STATIC void sysstat_collector_read(SysstatCollector_t* ctx, const uint32_t n, SysstatSample_t* sample);
+
+/**
+ * @brief Compute the rates between two samples
+ * @param[in]  from  Older sample
+ * @param[in]  to  Newer sample
+ * @param[out]  rates  Pointer to store the rates (zeros if the samples were taken at the same time)
+ */
+STATIC void sysstat_collector_compute_rates(const SysstatSample_t* from, const SysstatSample_t* to, SysstatRates_t* rates);
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time
+ * @return Time in milliseconds
+ */
+STATIC uint64_t sysstat_collector_time_ms(void);
+
+SysstatError_t sysstat_collector_start(SysstatCollector_t* ctx, const char* interface_name, const uint32_t interval_ms) {
+    if(!ctx || !interface_name) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    } else if(interval_ms == 0) {
+        return SYSSTAT_ERR_GENERIC;
+    } else if(strnlen(interface_name, SYSSTAT_COLLECTOR_IF_NAME_SIZE) >= SYSSTAT_COLLECTOR_IF_NAME_SIZE) {
+        return SYSSTAT_ERR_BUF_TOO_SHORT;
+    }
+
+    // Zero-out the collector on start (the /proc files are read on every tick, so no TTL is used)
+    memset(ctx, 0, sizeof(SysstatCollector_t));
+    memcpy(ctx->interface_name, interface_name, strnlen(interface_name, SYSSTAT_COLLECTOR_IF_NAME_SIZE));
+    ctx->interval_ms = interval_ms;
+    SysstatError_t err = sysstat_init(&ctx->sysstat, 0);
+    if(err != SYSSTAT_ERR_OK) {
+        return err;
+    }
+
+    // Initialize mutex and condition variable (measuring timeouts on the monotonic clock)
+    int ret = pthread_mutex_init(&ctx->lock, NULL);
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        sysstat_deinit(&ctx->sysstat);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    ret = pthread_cond_init(&ctx->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if(ret != 0) {
+        log_error("pthread_cond_init() returned %d", ret);
+        pthread_mutex_destroy(&ctx->lock);
+        sysstat_deinit(&ctx->sysstat);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+
+    // The first sample is taken right away, so the stats are available as soon as the collector is started
+    sysstat_collector_sample(ctx);
+
+    ctx->running = true;
+    ret = pthread_create(&ctx->thread, NULL, sysstat_collector_loop, (void*)ctx);
+    if(ret != 0) {
+        log_error("pthread_create() returned %d", ret);
+        ctx->running = false;
+        pthread_cond_destroy(&ctx->cond);
+        pthread_mutex_destroy(&ctx->lock);
+        sysstat_deinit(&ctx->sysstat);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+
+    log_debug("sysstat collector started (interface: %s, interval: %u ms)", ctx->interface_name, interval_ms);
+    return SYSSTAT_ERR_OK;
+}
+
+SysstatError_t sysstat_collector_stop(SysstatCollector_t* ctx) {
+    if(!ctx) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    }
+    if(!ctx->sysstat.is_initialized) {
+        return SYSSTAT_ERR_NOT_INITIALIZED; // Never started or already stopped (the lock is destroyed)
+    }
+
+    // Clear the running flag and wake up the collector (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("sysstat collector lock taken");
+
+    bool was_running = ctx->running;
+    ctx->running = false;
+    pthread_cond_signal(&ctx->cond);
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("sysstat collector lock released");
+
+    if(!was_running) {
+        return SYSSTAT_ERR_NOT_INITIALIZED;
+    }
+    ret = pthread_join(ctx->thread, NULL);
+    if(ret != 0) {
+        log_error("pthread_join() returned %d", ret);
+        return SYSSTAT_ERR_PTHREAD_FAILURE;
+    }
+
+    pthread_cond_destroy(&ctx->cond);
+    pthread_mutex_destroy(&ctx->lock);
+    return sysstat_deinit(&ctx->sysstat);
+}
+
+SysstatError_t sysstat_collector_get_latest(SysstatCollector_t* ctx, SysstatSample_t* sample) {
+    if(!ctx || !sample) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    }
+
+    uint32_t count = atomic_load_explicit(&ctx->count, memory_order_acquire);
+    if(count == 0) {
+        return SYSSTAT_ERR_NO_DATA;
+    }
+    sysstat_collector_read(ctx, count - 1, sample);
+
+    return SYSSTAT_ERR_OK;
+}
+
+SysstatError_t sysstat_collector_get_rates(SysstatCollector_t* ctx, const uint32_t window_ms, SysstatRates_t* rates) {
+    if(!ctx || !rates) {
+        return SYSSTAT_ERR_NULL_ARGUMENT;
+    }
+
+    uint32_t count = atomic_load_explicit(&ctx->count, memory_order_acquire);
+    if(count < 2) {
+        return SYSSTAT_ERR_NO_DATA;
+    }
+
+    // The samples are taken at a fixed interval, so the base of the window is found without scanning the ring (the
+    // oldest slot is skipped, as it is the one overwritten by the next sample)
+    uint32_t kept = (count < SYSSTAT_COLLECTOR_HISTORY_LEN ? count : SYSSTAT_COLLECTOR_HISTORY_LEN - 1);
+    uint32_t span = (window_ms + ctx->interval_ms - 1) / ctx->interval_ms;
+    span = (span == 0 ? 1 : (span > kept - 1 ? kept - 1 : span));
+
+    SysstatSample_t from, to;
+    sysstat_collector_read(ctx, count - 1, &to);
+    sysstat_collector_read(ctx, count - 1 - span, &from);
+    sysstat_collector_compute_rates(&from, &to, rates);
+
+    return SYSSTAT_ERR_OK;
+}
+
+STATIC void* sysstat_collector_loop(void* arg) {
+    SysstatCollector_t* ctx = (SysstatCollector_t*)arg;
+    uint64_t next_ms = sysstat_collector_time_ms() + ctx->interval_ms;
+
+    pthread_mutex_lock(&ctx->lock);
+    log_debug("sysstat collector lock taken");
+    while(ctx->running) {
+        // Sleep until the next tick (or until stopped)
+        struct timespec deadline = { .tv_sec = (time_t)(next_ms / 1000), .tv_nsec = (long)(next_ms % 1000) * 1000000L };
+        pthread_cond_timedwait(&ctx->cond, &ctx->lock, &deadline);
+        if(!ctx->running) {
+            break;
+        }
+        uint64_t now_ms = sysstat_collector_time_ms();
+        if(now_ms < next_ms) {
+            continue; // Spurious wakeup
+        }
+
+        // Sample without the lock (readers never take it anyway)
+        pthread_mutex_unlock(&ctx->lock);
+        log_debug("sysstat collector lock released");
+        sysstat_collector_sample(ctx);
+        pthread_mutex_lock(&ctx->lock);
+        log_debug("sysstat collector lock taken");
+
+        // Keep a fixed rate, but do not try to catch up on the missed ticks
+        next_ms += ctx->interval_ms;
+        if(next_ms <= now_ms) {
+            next_ms = now_ms + ctx->interval_ms;
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    log_debug("sysstat collector lock released");
+
+    return NULL;
+}
+
+STATIC void sysstat_collector_sample(SysstatCollector_t* ctx) {
+    SysstatSample_t sample = { .timestamp_ms = sysstat_collector_time_ms() };
+
+    SysstatError_t err = sysstat_get_mem_info_cached(&ctx->sysstat, &sample.mem);
+    if(err != SYSSTAT_ERR_OK) {
+        log_error("sysstat_get_mem_info_cached failed (ret: %d)", err);
+    }
+    err = sysstat_get_cpu_info_cached(&ctx->sysstat, &sample.cpu);
+    if(err != SYSSTAT_ERR_OK) {
+        log_error("sysstat_get_cpu_info_cached failed (ret: %d)", err);
+    }
+    sample.has_net = (sysstat_get_net_info_cached(&ctx->sysstat, ctx->interface_name, &sample.net) == SYSSTAT_ERR_OK);
+
+    // The thermal zone is optional (not retried if it could not be opened on start)
+    if(ctx->sysstat.sources[SYSSTAT_SOURCE_THERMAL].fd != -1) {
+        sample.has_temp = (sysstat_get_temp_cached(&ctx->sysstat, &sample.temp_mC) == SYSSTAT_ERR_OK);
+    }
+
+    // Precompute the rates since the previous sample (the writer reads its own slots directly)
+    uint32_t count = atomic_load_explicit(&ctx->count, memory_order_relaxed);
+    if(count > 0) {
+        SysstatRates_t rates;
+        sysstat_collector_compute_rates(&ctx->ring[(count - 1) % SYSSTAT_COLLECTOR_HISTORY_LEN].sample, &sample, &rates);
+        sample.tx_Bps = rates.tx_Bps;
+        sample.rx_Bps = rates.rx_Bps;
+        sample.cpu_load_permille = rates.cpu_load_permille;
+    }
+
+    // Publish the sample (the slot's sequence counter is odd while it is written)
+    SysstatSampleSlot_t* slot = &ctx->ring[count % SYSSTAT_COLLECTOR_HISTORY_LEN];
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->sample = sample;
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&ctx->count, count + 1, memory_order_release);
+}
+
+STATIC void sysstat_collector_read(SysstatCollector_t* ctx, const uint32_t n, SysstatSample_t* sample) {
+    SysstatSampleSlot_t* slot = &ctx->ring[n % SYSSTAT_COLLECTOR_HISTORY_LEN];
+    for(;;) {
+        unsigned before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if(before & 1) {
+            continue; // Being written right now
+        }
+        memcpy(sample, &slot->sample, sizeof(SysstatSample_t));
+        atomic_thread_fence(memory_order_acquire);
+        if(atomic_load_explicit(&slot->seq, memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
+
+STATIC void sysstat_collector_compute_rates(const SysstatSample_t* from, const SysstatSample_t* to, SysstatRates_t* rates) {
+    memset(rates, 0, sizeof(SysstatRates_t));
+    uint64_t dt_ms = to->timestamp_ms - from->timestamp_ms;
+    rates->window_ms = (uint32_t)dt_ms;
+    if(dt_ms == 0) {
+        return;
+    }
+
+    // Counters that went backwards (e.g. interface re-created) give no rate
+    if(from->has_net && to->has_net) {
+        if(to->net.tx_bytes >= from->net.tx_bytes) {
+            rates->tx_Bps = (to->net.tx_bytes - from->net.tx_bytes) * 1000 / dt_ms;
+        }
+        if(to->net.rx_bytes >= from->net.rx_bytes) {
+            rates->rx_Bps = (to->net.rx_bytes - from->net.rx_bytes) * 1000 / dt_ms;
+        }
+    }
+    if(to->cpu.total_jiffies > from->cpu.total_jiffies && to->cpu.idle_jiffies >= from->cpu.idle_jiffies) {
+        uint64_t total = to->cpu.total_jiffies - from->cpu.total_jiffies;
+        uint64_t idle = to->cpu.idle_jiffies - from->cpu.idle_jiffies;
+        rates->cpu_load_permille = (uint16_t)(idle >= total ? 0 : (total - idle) * 1000 / total);
+    }
+}
+
+STATIC uint64_t sysstat_collector_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
@@ -1,33 +1,97 @@
+#define LOG_MODULE LOG_MODULE_NETWORK
+#define _GNU_SOURCE                   // For: accept4()
+
 #include "comm/network.h"
 
 #include <errno.h>       // For: errno
+#include <fcntl.h>       // For: fcntl()
+#include <stdlib.h>      // For: calloc(), free()
 #include <netdb.h>       // For: struct addrinfo, getaddrinfo(), socket()
+#include <netinet/in.h>  // For: struct sockaddr_in6, IN6_IS_ADDR_V4MAPPED
 #include <stdbool.h>     // For: bool
 #include <string.h>      // For: memset, strerror
 #include <sys/epoll.h>   // For: epoll*
 #include <sys/eventfd.h> // Required for eventfd
-#include <unistd.h>      // For: close
+#include <sys/socket.h>  // For: sendmsg, struct msghdr
+#include <sys/uio.h>     // For: readv, struct iovec
+#include <unistd.h>      // For: close, usleep
 
 #include "utils/common.h"
 #include "utils/log.h"
+#include "utils/metrics.h"
 
-#define SERVER_IP_VER AF_INET        // IP version: IPv4
+#define SERVER_IP_VER AF_INET6          // IP version: IPv6 (dual-stack, IPv4 clients come as IPv4-mapped addresses)
+#define SERVER_IP_VER_FALLBACK AF_INET  // IP version used if IPv6 is not available on the host
 #define SERVER_SOCKTYPE SOCK_STREAM  // UDP/TCP: TCP
-#define EPOLL_SERVER_LISTEN_EVENTS 2 // Two possible events: incoming client and shutdown request
+#define SERVER_ACCEPT_BATCH 64       // Max number of connections accepted per single wakeup (backlog drained up to it)
+#define SERVER_ACCEPT_RETRY_DELAY_US 10000 // Accepts paused when out of fds or memory (EMFILE, ENFILE, ENOBUFS, ENOMEM)
+#define SERVER_LISTEN_FDS_START 3    // First fd passed by systemd socket activation (SD_LISTEN_FDS_START)
+#define EPOLL_SERVER_LISTEN_EVENTS 16 // Incoming client, shutdown request and events on watched fds
+#define EPOLL_ACCEPTOR_EVENTS 2      // Two possible events: incoming clients or shutdown request
 #define EPOLL_CLIENT_THREAD_EVENTS 2 // Two possible events: incoming data or disconnect request
+#define EPOLL_REACTOR_EVENTS 32      // Max events handled by a reactor per single epoll_wait() call
 
 typedef struct {
     Server_t* server;
     ServerClient_t client;
 } ClientHandlerArgs_t;
 
+typedef struct ReactorClient ReactorClient_t;
+
+/**
+ * @struct ReactorSource_t
+ * @brief Source of an event in the reactor epoll instance (set as epoll data ptr for each registered client fd)
+ */
+typedef struct {
+    ReactorClient_t* owner; // Client to which the registered fd belongs
+    bool is_disconnect_fd;  // True for the disconnect eventfd, false for the client socket
+} ReactorSource_t;
+
+/**
+ * @struct ReactorClient
+ * @brief Client handle owned by a reactor (allocated on accept, released once the client is disconnected)
+ */
+struct ReactorClient {
+    ServerClient_t client;          // Client handle passed to the callbacks
+    ReactorSource_t sock_src;       // Epoll source of the client socket
+    ReactorSource_t disconnect_src; // Epoll source of the client disconnect eventfd
+    bool closed;                    // Client resources already released (handle freed after the event batch)
+};
+
+/**
+ * @brief Create and bind a network socket (dual-stack IPv6, IPv4 if IPv6 is not available)
+ * @param[in]  port  Port for which a socket should be created (e.g. "65001")
+ * @param[in]  reuse_port  Set SO_REUSEPORT (many sockets bound to the same port, the connections are spread among them)
+ * @param[out] fd Pointer to the int variable where the socket file descriptor will be saved (-1 if not created)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_NET_FAILURE otherwise
+ */
+STATIC ServerError_t server_create_socket(const char* port, const bool reuse_port, int* fd);
+
 /**
- * @brief Create and bind a network socket
+ * @brief Create a bound, non-blocking socket and start listening on it
  * @param[in]  port  Port for which a socket should be created (e.g. "65001")
- * @param[out] fd Pointer to the int variable where the socket file descriptor will be saved
+ * @param[in]  backlog  Max number of pending connection requests
+ * @param[in]  reuse_port  Set SO_REUSEPORT (see server_create_socket())
+ * @param[out] fd Pointer to the int variable where the socket file descriptor will be saved (-1 on failure)
  * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT or SERVER_ERR_NET_FAILURE otherwise
  */
-STATIC ServerError_t server_create_socket(const char* port, int* fd);
+STATIC ServerError_t server_open_socket(const char* port, const int backlog, const bool reuse_port, int* fd);
+
+/**
+ * @brief Get the listening socket passed by systemd socket activation (LISTEN_PID and LISTEN_FDS, see sd_listen_fds(3))
+ * @return File descriptor of the (first) passed socket if it is a listening TCP socket, -1 otherwise
+ * @note The variables are parsed here, so that the server does not depend on libsystemd. They are not unset, so the
+ * socket is found again when the server is restarted.
+ */
+STATIC int server_activated_socket(void);
+
+/**
+ * @brief Format the address of a client (IPv4-mapped IPv6 addresses in the dotted IPv4 form)
+ * @param[in]  addr  Address returned by accept()
+ * @param[out]  buf  Buffer for the address string (at least IP_ADDRSTR_LENGTH long, empty on failure)
+ * @return true on success, false otherwise
+ */
+STATIC bool server_format_addr(const struct sockaddr_storage* addr, char* buf);
 
 /**
  * @brief Run an infinite loop that will monitor server's incoming connections [Thread]
@@ -36,29 +100,249 @@ STATIC ServerError_t server_create_socket(const char* port, int* fd);
  */
 STATIC void* server_listen(void* arg);
 
+/**
+ * @brief Close the listening socket, the shutdown eventfd and the epoll instance of the listening thread
+ * @param[in, out]  server  Pointer to the Server instance (the closed fds are set to -1)
+ * @return 0 on success, non-zero if any of the fds could not be closed
+ * @note Called by the listening thread right before it exits (on shutdown request or on failure)
+ */
+STATIC int server_listen_cleanup(Server_t* server);
+
 /**
  * @brief Run an infinite loop that waits for user input and calls appropriate callbacks [Thread]
- * @param[in]  arg  Pointer to the ClientHandlerArgs_t structure with ptrs to server and client objects
+ * @param[in]  arg  Pointer to the ClientHandlerArgs_t structure with ptrs to server and client objects (allocated by
+ * the caller, freed by the thread)
  * @return This function should not return
  */
 STATIC void* server_client_handler(void* arg);
 
 /**
- * @brief Handle a new client connection request
+ * @brief Bind the additional SO_REUSEPORT listening sockets and create their accept threads (cfg.acceptor_count > 1)
+ * @param[in, out]  ctx  Pointer to the Server instance
+ * @return SERVER_ERR_OK on success (also if some sockets could not be bound), SERVER_ERR_EPOLL_FAILURE /
+ * SERVER_ERR_EVENTFD_FAILURE / SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC ServerError_t server_start_acceptors(Server_t* ctx);
+
+/**
+ * @brief Run an infinite loop that accepts the clients connecting to the acceptor's socket [Thread]
+ * @param[in]  arg  Pointer to the ServerAcceptor_t structure
+ * @return This function should not return
+ */
+STATIC void* server_accept_loop(void* arg);
+
+/**
+ * @brief Create the epoll instances and threads for all reactors (SERVER_MODE_REACTOR only)
+ * @param[in, out]  ctx  Pointer to the Server instance
+ * @return SERVER_ERR_OK on success, SERVER_ERR_EPOLL_FAILURE / SERVER_ERR_EVENTFD_FAILURE / SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC ServerError_t server_start_reactors(Server_t* ctx);
+
+/**
+ * @brief Stop the threads started by server_run() and close its fds after a failure (the listening socket is left
+ * open for server_deinit())
+ * @param[in, out]  ctx  Pointer to the Server instance
+ */
+STATIC void server_run_rollback(Server_t* ctx);
+
+/**
+ * @brief Run an event loop that serves all clients assigned to the reactor and calls appropriate callbacks [Thread]
+ * @param[in]  arg  Pointer to the ServerReactor_t structure
+ * @return This function should not return
+ */
+STATIC void* server_reactor_loop(void* arg);
+
+/**
+ * @brief Assign a newly accepted client to one of the reactors (by fd) and register its fds in reactor's epoll
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client  Pointer to the client handle (copied into a reactor-owned handle)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_NULL_ARGUMENT / SERVER_ERR_MALLOC_FAILURE / SERVER_ERR_EPOLL_FAILURE otherwise
+ */
+STATIC ServerError_t server_reactor_add_client(Server_t* ctx, const ServerClient_t* client);
+
+/**
+ * @brief Check if the peer closed the connection (or the socket failed) without consuming any data
+ * @param[in]  fd  Client socket file descriptor
+ * @return True if the client should be treated as disconnected, false if there is data to be read
+ */
+STATIC bool server_client_peer_closed(const int fd);
+
+/**
+ * @brief Remove the client from the client table, close its fds and notify the app on self disconnect
+ * @param[in]  server  Pointer to the Server instance
+ * @param[in]  client  Handle of the client to be released
+ * @param[in]  self_disconnect  True if the client disconnected by itself (on_client_disconnect will be called)
+ */
+STATIC void server_release_client(Server_t* server, ServerClient_t client, const bool self_disconnect);
+
+/**
+ * @brief Allocate a client receive ring buffer (with a scratch buffer for wrapped lines) in a single allocation
+ * @param[in]  size  Capacity of the ring buffer in bytes
+ * @return Pointer to the new buffer on success, NULL on failure
+ */
+STATIC ServerRxBuffer_t* server_rx_buffer_create(const size_t size);
+
+/**
+ * @brief Find the first line delimiter in the part of the receive buffer that has not been scanned yet
+ * @param[in]  rx  Pointer to the receive buffer
+ * @param[out]  offset  Offset (relative to rx->head) of the delimiter
+ * @return True if the delimiter was found, false otherwise
+ */
+STATIC bool server_rx_find_delim(const ServerRxBuffer_t* rx, size_t* offset);
+
+/**
+ * @brief Accept all pending connection requests (up to SERVER_ACCEPT_BATCH) from the non-blocking listening socket
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  listen_fd  Listening socket with pending connection requests
+ * @return SERVER_ERR_OK on success (also if some of the clients were dropped or the accepts were postponed for lack
+ * of fds or memory), SERVER_ERR_NET_FAILURE if the listening socket failed
+ */
+STATIC ServerError_t server_handle_conn_request(Server_t* ctx, const int listen_fd);
+
+/**
+ * @brief Create a handle for a newly accepted client and hand it over to a reactor (or a new worker thread)
+ * @param[in]  ctx  Pointer to the Server instance
+ * @param[in]  client_fd  Socket of the accepted client
+ * @param[in]  addr  Address of the client
+ * @return SERVER_ERR_OK on success (also if the client was rejected), SERVER_ERR_EVENTFD_FAILURE /
+ * SERVER_ERR_MALLOC_FAILURE / SERVER_ERR_PTHREAD_FAILURE / SERVER_ERR_TABLE_FULL otherwise (the client fd and
+ * all resources created for it are released)
+ */
+STATIC ServerError_t server_add_client(Server_t* ctx, const int client_fd, const struct sockaddr_storage* addr);
+
+/**
+ * @brief Allocate the client table and initialize its locks (incl. the per-slot client locks)
+ * @param[out]  table  Pointer to the client table
+ * @return SERVER_ERR_OK on success, SERVER_ERR_MALLOC_FAILURE or SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC ServerError_t server_client_table_init(ServerClientTable_t* table);
+
+/**
+ * @brief Destroy the client table locks and free the table
+ * @param[in, out]  table  Pointer to the client table
+ * @return SERVER_ERR_OK on success, SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC ServerError_t server_client_table_deinit(ServerClientTable_t* table);
+
+/**
+ * @brief Put the client into the slot indexed by its fd and assign a new generation to the handle
+ * @param[in, out]  table  Pointer to the client table
+ * @param[in, out]  client  Client handle (generation is set on success)
+ * @return SERVER_ERR_OK on success, SERVER_ERR_TABLE_FULL (fd out of range or slot taken) or
+ * SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC ServerError_t server_client_table_insert(ServerClientTable_t* table, ServerClient_t* client);
+
+/**
+ * @brief Free the slot of the client (waits for I/O in progress on the client)
+ * @param[in, out]  table  Pointer to the client table
+ * @param[in]  client  Client handle
+ * @return SERVER_ERR_OK on success, SERVER_ERR_CLIENT_DISCONNECTED (stale handle) or SERVER_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC ServerError_t server_client_table_remove(ServerClientTable_t* table, const ServerClient_t* client);
+
+/**
+ * @brief Take the I/O lock of the client if its handle is still valid (same fd and generation as in the table)
+ * @param[in]  table  Pointer to the client table
+ * @param[in]  client  Client handle
+ * @return Slot of the client with its lock taken, NULL if the handle is stale (or on pthread failure)
+ */
+STATIC ServerClientSlot_t* server_client_lock(const ServerClientTable_t* table, const ServerClient_t* client);
+
+/**
+ * @brief Release the I/O lock taken with server_client_lock()
+ * @param[in]  slot  Slot of the client
+ */
+STATIC void server_client_unlock(ServerClientSlot_t* slot);
+
+/**
+ * @brief Get the total length of a scatter list
+ * @param[in]  iov  Array of the data parts
+ * @param[in]  iov_count  Number of the data parts
+ * @return Total length (in bytes) of the data
+ */
+STATIC size_t server_iov_length(const struct iovec* iov, const int iov_count);
+
+/**
+ * @brief Allocate a shared message buffer (with a single reference held by the caller) and gather the data into it
+ * @param[in]  iov  Array of the data parts
+ * @param[in]  iov_count  Number of the data parts
+ * @param[in]  skip  Number of leading bytes of the data that are not copied (e.g. already sent)
+ * @return Pointer to the new buffer on success, NULL on failure
+ */
+STATIC ServerTxBuffer_t* server_tx_buffer_create(const struct iovec* iov, const int iov_count, size_t skip);
+
+/**
+ * @brief Drop a reference to a shared message buffer (the buffer is freed with the last reference)
+ * @param[in]  buf  Pointer to the buffer
+ */
+STATIC void server_tx_buffer_release(ServerTxBuffer_t* buf);
+
+/**
+ * @brief Append a message to the client's output queue (takes a new reference to the buffer)
+ * @param[in]  ctx  Pointer to the Server instance (high-water mark and backpressure policy)
+ * @param[in, out]  slot  Slot of the client (client lock taken)
+ * @param[in]  buf  Shared message buffer
+ * @return SERVER_ERR_OK on success, SERVER_ERR_MALLOC_FAILURE, SERVER_ERR_QUEUE_FULL (message dropped) or
+ * SERVER_ERR_CLIENT_DISCONNECTED (client being disconnected by the backpressure policy) otherwise
+ * @note An empty queue accepts a single message of any size, so that (the rest of) a message is never split
+ */
+STATIC ServerError_t server_tx_enqueue(const Server_t* ctx, ServerClientSlot_t* slot, ServerTxBuffer_t* buf);
+
+/**
+ * @brief Drop the oldest queued messages which are not being sent yet until the new message fits (COALESCE policy)
+ * @param[in, out]  slot  Slot of the client (client lock taken)
+ * @param[in]  len  Length of the new message
+ * @param[in]  high_water  Max number of bytes queued for the client
+ */
+STATIC void server_tx_evict(ServerClientSlot_t* slot, const size_t len, const size_t high_water);
+
+/**
+ * @brief Send as much of the client's output queue as the socket accepts without blocking (vectored write)
+ * @param[in, out]  slot  Slot of the client (client lock taken)
+ * @return SERVER_ERR_OK on success (also if some data is still queued), SERVER_ERR_NET_FAILURE otherwise (the queue
+ * is dropped)
+ * @note EPOLLOUT is enabled for the client socket while the queue is not empty and disabled once it is drained
+ */
+STATIC ServerError_t server_tx_flush(ServerClientSlot_t* slot);
+
+/**
+ * @brief Drop all messages from the client's output queue
+ * @param[in, out]  slot  Slot of the client (client lock taken)
+ */
+STATIC void server_tx_clear(ServerClientSlot_t* slot);
+
+/**
+ * @brief Enable EPOLLOUT for the client socket if its output queue is not empty (disable it otherwise)
+ * @param[in, out]  slot  Slot of the client (client lock taken)
+ */
+STATIC void server_tx_update_epoll(ServerClientSlot_t* slot);
+
+/**
+ * @brief Flush the client's output queue, called by the thread serving the client when its socket is writable
  * @param[in]  ctx  Pointer to the Server instance
- * @return SERVER_ERR_OK on success, SERVER_ERR_NET_FAILURE / SERVER_ERR_EVENTFD_FAILURE /
- * SERVER_ERR_PTHREAD_FAILURE / SERVER_ERR_LIST_FAILURE otherwise
- * @note This function blocks until a new connection request is present
+ * @param[in]  client  Client handle
+ * @return SERVER_ERR_OK on success, SERVER_ERR_CLIENT_DISCONNECTED (stale handle) or SERVER_ERR_NET_FAILURE otherwise
+ */
+STATIC ServerError_t server_client_flush(Server_t* ctx, const ServerClient_t client);
+
+/**
+ * @brief Store the epoll instance in which the client socket is registered (used to toggle EPOLLOUT)
+ * @param[in]  table  Pointer to the client table
+ * @param[in]  client  Client handle
+ * @param[in]  epoll_fd  Epoll instance of the thread serving the client
+ * @param[in]  epoll_data  Data registered with the client socket (epoll_data_t.u64)
  */
-STATIC ServerError_t server_handle_conn_request(Server_t* ctx);
+STATIC void server_client_attach_epoll(ServerClientTable_t* table, const ServerClient_t* client, const int epoll_fd,
+const uint64_t epoll_data);
 
 /**
- * @brief Callback for comparing two client file descriptors (required for Linked List)
- * @param[in]  a Pointer to the first ll data item
- * @param[in]  b Pointer to the second ll data item
- * @return Difference between a and b or 0 if they are equal
+ * @brief Store the ID of the thread serving the client in its slot (known only once the thread is created)
+ * @param[in]  table  Pointer to the client table
+ * @param[in]  client  Client handle
+ * @param[in]  thread  Thread serving the client
  */
-STATIC int compare_client_fd(const void* a, const void* b);
+STATIC void server_client_set_thread(ServerClientTable_t* table, const ServerClient_t* client, const pthread_t thread);
 
 
 ServerError_t server_init(Server_t* ctx, const ServerConfig_t cfg) {
@@ -70,28 +354,52 @@ ServerError_t server_init(Server_t* ctx, const ServerConfig_t cfg) {
     // Zero-out the Server_t struct and its members on init
     memset(ctx, 0, sizeof(Server_t));
 
-    // Create a new listening socket for the server
-    int fd;
-    ServerError_t err = server_create_socket(cfg.port, &fd);
-    if(err != SERVER_ERR_OK) {
-        log_error("server_create_socket() returned %d", err);
-        return SERVER_ERR_NET_FAILURE;
+    // Take over the listening socket passed by systemd (if any) or create a new one and start listening right away -
+    // connection requests are queued in the backlog until server_run() starts accepting them (so the clients are not
+    // refused during the startup)
+    ServerError_t err;
+    int fd = cfg.socket_activation ? server_activated_socket() : -1;
+    if(fd != -1) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            log_error("failed to set up the inherited listening socket (fd: %d, err: %s)", fd, strerror(errno));
+            return SERVER_ERR_NET_FAILURE;
+        }
+        ctx->fd_inherited = true;
+        log_info("server listening on the socket passed by systemd (fd: %d)", fd);
+    } else {
+        err = server_open_socket(cfg.port, cfg.max_conn_requests, cfg.acceptor_count > 1, &fd);
+        if(err != SERVER_ERR_OK) {
+            log_error("server_open_socket() returned %d", err);
+            return SERVER_ERR_NET_FAILURE;
+        }
+        log_info("server listening on port %s", cfg.port);
     }
 
     // Initialize mutex for protecting server-related critical sections
     int p_err = pthread_mutex_init(&ctx->lock, NULL);
     if(p_err != 0) {
         log_error("pthread_mutex_init() returned %d", p_err);
+        if(!ctx->fd_inherited) {
+            close(fd);
+        }
         return SERVER_ERR_PTHREAD_FAILURE;
     }
 
-    // Populate data in the struct (cfg, fd) and create a llist for clients
+    // Populate data in the struct (cfg, fd) and create a table for clients
     ctx->cfg = cfg;
     ctx->fd = fd;
-    ListError_t ret = llist_init(&ctx->clients_list, compare_client_fd);
-    if(ret != LIST_ERR_OK) {
-        log_error("llist_init() returned %d when initializing new clients list", ret);
-        return ret;
+    ctx->shutdown_eventfd = -1;
+    ctx->listen_epoll_fd = -1;
+    err = server_client_table_init(&ctx->clients);
+    if(err != SERVER_ERR_OK) {
+        log_error("server_client_table_init() returned %d", err);
+        pthread_mutex_destroy(&ctx->lock);
+        if(!ctx->fd_inherited) {
+            close(fd);
+        }
+        ctx->fd = -1;
+        return err;
     }
 
     return SERVER_ERR_OK;
@@ -102,14 +410,6 @@ ServerError_t server_run(Server_t* ctx) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    // Start accepting connection on the socket
-    int ret = listen(ctx->fd, ctx->cfg.max_conn_requests);
-    if(ret == -1) {
-        log_error("listen() returned: -1 (err: %s)", strerror(errno));
-        return SERVER_ERR_NET_FAILURE;
-    }
-    log_info("server listening on port %s", ctx->cfg.port);
-
     // Create an eventfd for synchronization (shutdown request)
     ctx->shutdown_eventfd = eventfd(0, EFD_NONBLOCK);
     if(ctx->shutdown_eventfd == -1) {
@@ -117,18 +417,55 @@ ServerError_t server_run(Server_t* ctx) {
         return SERVER_ERR_EVENTFD_FAILURE;
     }
 
-    // Create a listening thread
-    pthread_t server_listening_thread;
-    ret = pthread_create(&server_listening_thread, NULL, server_listen, (void*)ctx);
-    if(ret != 0) {
-        log_error("pthread_create() returned: %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    // Create the listening thread's epoll instance here, so that fds can be watched as soon as server_run returns
+    ctx->listen_epoll_fd = epoll_create1(0);
+    if(ctx->listen_epoll_fd == -1) {
+        log_error("epoll_create1 returned -1 (err: %s)", strerror(errno));
+        server_run_rollback(ctx);
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+
+    // Add the server listening socket and the shutdown event file descriptors to the epoll event loop
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &ctx->fd };
+    if(epoll_ctl(ctx->listen_epoll_fd, EPOLL_CTL_ADD, ctx->fd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        server_run_rollback(ctx);
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+    ev.data.ptr = &ctx->shutdown_eventfd;
+    if(epoll_ctl(ctx->listen_epoll_fd, EPOLL_CTL_ADD, ctx->shutdown_eventfd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        server_run_rollback(ctx);
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+
+    // Start the reactors before any client can be accepted
+    if(ctx->cfg.mode == SERVER_MODE_REACTOR) {
+        ServerError_t err = server_start_reactors(ctx);
+        if(err != SERVER_ERR_OK) {
+            log_error("server_start_reactors() returned %d", err);
+            server_run_rollback(ctx);
+            return err;
+        }
+    }
+
+    // Start the accept threads of the additional listening sockets (if any)
+    ServerError_t err = server_start_acceptors(ctx);
+    if(err != SERVER_ERR_OK) {
+        log_error("server_start_acceptors() returned %d", err);
+        server_run_rollback(ctx);
+        return err;
     }
-    ret = pthread_detach(server_listening_thread);
+
+    // Create a listening thread (joined by server_shutdown())
+    int ret = pthread_create(&ctx->listening_thread, NULL, server_listen, (void*)ctx);
     if(ret != 0) {
-        log_error("pthread_detach() returned: %d", ret);
+        log_error("pthread_create() returned: %d", ret);
+        server_run_rollback(ctx);
         return SERVER_ERR_PTHREAD_FAILURE;
     }
+    ctx->listening = true;
+    log_info("server accepting clients on port %s", ctx->cfg.port);
 
     return SERVER_ERR_OK;
 }
@@ -139,537 +476,1921 @@ ServerError_t server_read(Server_t* ctx, ServerClient_t client, uint8_t* buf, co
     }
 
     // Read data from the client (critical section)
-    int ret = pthread_mutex_lock(&client.lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    ServerClientSlot_t* slot = server_client_lock(&ctx->clients, &client);
+    if(!slot) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
     }
-    log_debug("client lock taken");
-
 
     (*len) = recv(client.fd, (void*)buf, buf_len, 0);
-    if(*len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-        log_error("no data available to be read yet");
+    int recv_errno = errno;
+
+    server_client_unlock(slot);
+
+    metrics_add(METRICS_SERVER_RX_SYSCALLS, 1);
+    if(*len < 0 && (recv_errno == EAGAIN || recv_errno == EWOULDBLOCK)) {
+        metrics_add(METRICS_SERVER_RX_EAGAIN, 1);
         return SERVER_ERR_OK; // No error, just wait for more data
     }
 
     if(*len <= 0) {
         return SERVER_ERR_CLIENT_DISCONNECTED;
     }
+    metrics_add(METRICS_SERVER_RX_BYTES, (uint64_t)*len);
 
-    ret = pthread_mutex_unlock(&client.lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
-    }
-    log_debug("client lock released");
-
-
-    log_debug("received %lu bytes from the client (fd: %d)", *len, client.fd);
+    log_debug("received %zd bytes from the client (fd: %d)", *len, client.fd);
     return SERVER_ERR_OK;
 }
 
-ServerError_t server_write(const Server_t* ctx, ServerClient_t client, const uint8_t* data, const size_t len) {
-    if(!ctx || !data) {
+ServerError_t server_receive(Server_t* ctx, ServerClient_t client, ssize_t* len) {
+    if(!ctx || !client.rx_buf || !len) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    // Write data to the client (critical section)
-    int ret = pthread_mutex_lock(&client.lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    // The receive buffer is accessed only by the thread serving the client (no lock required)
+    ServerRxBuffer_t* rx = client.rx_buf;
+    *len = 0;
+    if(rx->len == rx->size) {
+        return SERVER_ERR_OK; // Buffer full - lines have to be consumed first
     }
-    log_debug("client lock taken");
-
 
-    ssize_t bytes_sent = 0;
-    while(bytes_sent < len) {
-        ssize_t bytes = send(client.fd, data + bytes_sent, len - bytes_sent, 0);
-        if(bytes <= 0) {
-            return SERVER_ERR_NET_FAILURE;
-        }
-        bytes_sent += bytes;
+    // Receive straight into the free space of the ring (ending at most in two segments)
+    size_t tail = (rx->head + rx->len) % rx->size;
+    size_t free_space = rx->size - rx->len;
+    struct iovec iov[2];
+    int iov_count = 1;
+    iov[0].iov_base = rx->data + tail;
+    iov[0].iov_len = (tail + free_space <= rx->size) ? free_space : rx->size - tail;
+    if(iov[0].iov_len < free_space) {
+        iov[1].iov_base = rx->data;
+        iov[1].iov_len = free_space - iov[0].iov_len;
+        iov_count = 2;
     }
 
-    ret = pthread_mutex_unlock(&client.lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    (*len) = readv(client.fd, iov, iov_count);
+    metrics_add(METRICS_SERVER_RX_SYSCALLS, 1);
+    if(*len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        *len = 0;
+        metrics_add(METRICS_SERVER_RX_EAGAIN, 1);
+        return SERVER_ERR_OK; // No error, just wait for more data
+    } else if(*len <= 0) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
     }
-    log_debug("client lock released");
-
+    rx->len += (size_t)*len;
+    metrics_add(METRICS_SERVER_RX_BYTES, (uint64_t)*len);
 
-    log_debug("%lu bytes sent to the client (fd: %d)", bytes_sent, client.fd);
+    log_debug("received %zd bytes from the client (fd: %d)", *len, client.fd);
     return SERVER_ERR_OK;
 }
 
-ServerError_t server_broadcast(Server_t* ctx, const uint8_t* data, const size_t len) {
-    if(!ctx || !data) {
+ServerError_t server_get_line(Server_t* ctx, ServerClient_t client, char** line, size_t* len) {
+    if(!ctx || !client.rx_buf || !line || !len) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    ListNode_t* client = ctx->clients_list.get_head(&ctx->clients_list);
-    ServerClient_t client_fd;
-
-    // Write data to all clients (if any)
-    while(client) {
-        client_fd = *(ServerClient_t*)(client->data);
-        ServerError_t err = server_write(ctx, client_fd, data, len);
-        if(err != SERVER_ERR_OK) {
-            return err;
+    ServerRxBuffer_t* rx = client.rx_buf;
+    *line = NULL;
+    *len = 0;
+
+    while(rx->len > 0) {
+        size_t line_len, consumed;
+        if(server_rx_find_delim(rx, &line_len)) {
+            consumed = line_len + 1; // Consume the delimiter as well
+        } else if(rx->len == rx->size) {
+            line_len = rx->len; // Buffer full and still no delimiter - hand over what's there as one line
+            consumed = rx->len;
+        } else {
+            rx->scanned = rx->len; // Incomplete line - wait for more data
+            return SERVER_ERR_OK;
         }
-        client = client->next; // @TODO: There should be a dedicated ll function for this protected with mutexes (risk of accessing deleted node)
-    }
 
-    return SERVER_ERR_OK;
-}
+        bool discard = rx->discard_line;
+        rx->discard_line = (consumed == line_len); // Drop the rest of the overlong line once it arrives
+
+        if(!discard) {
+            // Return the line in place if it is contiguous, otherwise copy it into the scratch buffer
+            size_t first_len = rx->size - rx->head;
+            if(line_len < first_len) {
+                *line = rx->data + rx->head;
+            } else {
+                memcpy(rx->line, rx->data + rx->head, first_len);
+                memcpy(rx->line + first_len, rx->data, line_len - first_len);
+                *line = rx->line;
+            }
+            (*line)[line_len] = '\0'; // Overwrites the delimiter (or uses the spare byte of the scratch buffer)
+            if(line_len > 0 && (*line)[line_len - 1] == '\r') {
+                (*line)[--line_len] = '\0';
+            }
+            *len = line_len;
+        }
 
-ServerError_t server_disconnect(Server_t* ctx, const ServerClient_t client) {
-    if(!ctx) {
-        return SERVER_ERR_NULL_ARGUMENT;
-    }
-    // @TODO: Add a lock to protect the disconnect procedure from race conditions
+        rx->head = (rx->head + consumed) % rx->size;
+        rx->len -= consumed;
+        rx->scanned = 0;
+        if(rx->len == 0) {
+            rx->head = 0; // Rewind the empty buffer to keep the next lines contiguous
+        }
 
-    uint64_t signal_value = 1;
-    ssize_t ret = write(client.disconnect_eventfd, &signal_value, sizeof(signal_value));
-    if(ret != sizeof(signal_value)) {
-        log_error("failed to write to disconnect_eventfd (err: %s)", strerror(errno));
-        return SERVER_ERR_EVENTFD_FAILURE;
+        if(!discard) {
+            return SERVER_ERR_OK;
+        }
     }
 
     return SERVER_ERR_OK;
 }
 
-ServerError_t server_shutdown(Server_t* ctx) {
-    if(!ctx) {
+ServerError_t server_get_frame(Server_t* ctx, ServerClient_t client, uint8_t** frame, size_t* len) {
+    if(!ctx || !client.rx_buf || !frame || !len) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    // Shutdown the server (critical section)
-    int ret = pthread_mutex_lock(&ctx->lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    ServerRxBuffer_t* rx = client.rx_buf;
+    *frame = NULL;
+    *len = 0;
+    if(rx->len < SERVER_FRAME_PREFIX_SIZE) {
+        return SERVER_ERR_OK; // Incomplete prefix - wait for more data
     }
-    log_debug("server lock taken");
-
-    ListNode_t* node = ctx->clients_list.get_head(&ctx->clients_list);
-    ServerError_t err = SERVER_ERR_OK;
-    ServerClient_t* client;
 
-    // Disconnect all clients first
-    while(node) {
-        client = (ServerClient_t*)node->data;
-        node = node->next;
-        err = server_disconnect(ctx, *client);
-        if(err != SERVER_ERR_OK) {
-            return err;
-        }
+    // The length prefix (big-endian) may wrap around the end of the ring as well
+    size_t body_len = ((size_t)(uint8_t)rx->data[rx->head] << 8) | (uint8_t)rx->data[(rx->head + 1) % rx->size];
+    if(SERVER_FRAME_PREFIX_SIZE + body_len > rx->size) {
+        log_error("frame too long for the receive buffer (fd: %d, len: %zu)", client.fd, body_len);
+        return SERVER_ERR_FRAME_TOO_LONG;
+    } else if(rx->len < SERVER_FRAME_PREFIX_SIZE + body_len) {
+        return SERVER_ERR_OK; // Incomplete frame - wait for more data
     }
 
-    // Write to shutdown eventfd to stop server's listening thread
-    uint64_t signal_value = 1;
-    ssize_t bytes = write(ctx->shutdown_eventfd, &signal_value, sizeof(signal_value));
-    if(bytes != sizeof(signal_value)) {
-        log_error("failed to write to shutdown_eventfd (err: %s)", strerror(errno));
-        return SERVER_ERR_EVENTFD_FAILURE;
+    // Return the frame in place if it is contiguous, otherwise copy it into the scratch buffer
+    size_t start = (rx->head + SERVER_FRAME_PREFIX_SIZE) % rx->size;
+    size_t first_len = rx->size - start;
+    if(body_len <= first_len) {
+        *frame = (uint8_t*)rx->data + start;
+    } else {
+        memcpy(rx->line, rx->data + start, first_len);
+        memcpy(rx->line + first_len, rx->data, body_len - first_len);
+        *frame = (uint8_t*)rx->line;
     }
+    *len = body_len;
 
-    ret = pthread_mutex_unlock(&ctx->lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    rx->head = (rx->head + SERVER_FRAME_PREFIX_SIZE + body_len) % rx->size;
+    rx->len -= SERVER_FRAME_PREFIX_SIZE + body_len;
+    rx->scanned = 0;
+    if(rx->len == 0) {
+        rx->head = 0; // Rewind the empty buffer to keep the next frames contiguous
     }
-    log_debug("server lock released");
 
     return SERVER_ERR_OK;
 }
 
-ServerError_t server_deinit(Server_t* ctx) {
-    if(!ctx) {
+ServerError_t server_set_framing(Server_t* ctx, ServerClient_t client, const ServerFraming_t framing) {
+    if(!ctx || !client.rx_buf) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    // @TODO: Add a check if server is not running
-
-    // Destroy the server (critical section)
-    int ret = pthread_mutex_lock(&ctx->lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+    ServerClientSlot_t* slot = server_client_lock(&ctx->clients, &client);
+    if(!slot) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
     }
-    log_debug("server lock taken");
+    slot->framing = framing;
+    server_client_unlock(slot);
 
-    ListError_t err = ctx->clients_list.deinit(&(ctx->clients_list));
-    if(err != LIST_ERR_OK) {
-        log_error("failed to destroy linked list with client FDs (llist_destroy() returned: %d)", err);
-        return SERVER_ERR_LLIST_FAILURE;
-    }
+    // The state of the line framing does not apply to the data that follows (accessed only by the serving thread)
+    client.rx_buf->scanned = 0;
+    client.rx_buf->discard_line = false;
 
-    ret = pthread_mutex_unlock(&ctx->lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
-    }
-    log_debug("server lock released");
+    log_debug("client (fd: %d) switched to %s framing", client.fd,
+    (framing == SERVER_FRAMING_LINE ? "line" : "length-prefixed"));
+    return SERVER_ERR_OK;
+}
 
-    // Destroy the lock (@TODO: Improve mutex destroy mechanism, e.g. add a global protection variable)
-    ret = pthread_mutex_destroy(&ctx->lock);
-    if(ret != 0) {
-        log_error("pthread_mutex_destroy() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
+ServerError_t server_get_framing(const Server_t* ctx, ServerClient_t client, ServerFraming_t* framing) {
+    if(!ctx || !framing) {
+        return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    // Zero-out the Server_t struct along with its members on deinit
-    memset(ctx, 0, sizeof(Server_t));
+    ServerClientSlot_t* slot = server_client_lock(&ctx->clients, &client);
+    if(!slot) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
+    }
+    *framing = slot->framing;
+    server_client_unlock(slot);
 
     return SERVER_ERR_OK;
 }
 
-ServerError_t server_get_client_ip(const ServerClient_t client, char* inet_addrstr_) {
-    if(!inet_addrstr_) {
+ServerError_t server_write(const Server_t* ctx, ServerClient_t client, const uint8_t* data, const size_t len) {
+    if(!data) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
+    const struct iovec iov = { .iov_base = (void*)data, .iov_len = len };
+    return server_writev(ctx, client, &iov, 1);
+}
 
-    // Retrieve the address associated with the client's socket file descriptor
-    struct sockaddr addr;
-    int addr_len = sizeof(struct sockaddr_in);
-    int ret = getpeername(client.fd, &addr, &addr_len);
-    if(ret == -1) {
-        log_error("getpeername failed and returned -1 (err: %s)", strerror(errno));
-        return SERVER_ERR_NET_FAILURE;
+ServerError_t server_writev(const Server_t* ctx, ServerClient_t client, const struct iovec* iov, const int iov_count) {
+    if(!ctx || !iov) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    } else if(iov_count <= 0 || iov_count > SERVER_TX_IOV_MAX) {
+        return SERVER_ERR_INVALID_ARGUMENT;
     }
+    size_t len = server_iov_length(iov, iov_count);
 
-    struct sockaddr_in* addr_in = (struct sockaddr_in*)&addr;
-    struct in_addr ip_addr = addr_in->sin_addr;
-
-    // Convert the address structure into a character string with dotted notation IPv4 addr
-    char ip_addr_str[INET_ADDRSTRLEN];
-    const char* inet_ret = inet_ntop(SERVER_IP_VER, &ip_addr, ip_addr_str, INET_ADDRSTRLEN);
-    if(inet_ret == NULL) {
-        log_error("failed to convert the ip addr struct to a char string (err: %s)", strerror(errno));
-        return SERVER_ERR_NET_FAILURE;
+    // Write data to the client (critical section - the handle is checked against the table to not write to a new
+    // client that reused the fd of a disconnected one)
+    ServerClientSlot_t* slot = server_client_lock(&ctx->clients, &client);
+    if(!slot) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
+    } else if(slot->tx.closed) {
+        server_client_unlock(slot);
+        return SERVER_ERR_CLIENT_DISCONNECTED; // Disconnected by the backpressure policy
     }
 
-    // If the addr was retrieved and converted properly copy it to the output buffer
-    memmove(inet_addrstr_, ip_addr_str, sizeof(ip_addr_str));
+    // Send right away if nothing is queued (no copy needed), but never wait for the socket to become writable
+    struct iovec pending[SERVER_TX_IOV_MAX];
+    memcpy(pending, iov, (size_t)iov_count * sizeof(struct iovec));
+    int first = 0;
+    size_t bytes_sent = 0;
+    while(slot->tx.count == 0 && bytes_sent < len) {
+        struct msghdr msg = { .msg_iov = pending + first, .msg_iovlen = (size_t)(iov_count - first) };
+        ssize_t bytes = sendmsg(client.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        metrics_add(METRICS_SERVER_TX_SYSCALLS, 1);
+        if(bytes < 0 && errno == EINTR) {
+            continue;
+        } else if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            metrics_add(METRICS_SERVER_TX_EAGAIN, 1);
+            break;
+        } else if(bytes <= 0) {
+            server_client_unlock(slot);
+            return SERVER_ERR_NET_FAILURE;
+        }
+        bytes_sent += (size_t)bytes;
+        metrics_add(METRICS_SERVER_TX_BYTES, (uint64_t)bytes);
+
+        // Skip the parts that were sent completely
+        size_t left = (size_t)bytes;
+        for(; first < iov_count && left >= pending[first].iov_len; first++) {
+            left -= pending[first].iov_len;
+        }
+        if(first < iov_count) {
+            pending[first].iov_base = (uint8_t*)pending[first].iov_base + left;
+            pending[first].iov_len -= left;
+        }
+    }
+    if(bytes_sent == len) {
+        server_client_unlock(slot);
+        log_debug("%zu bytes sent to the client (fd: %d)", bytes_sent, client.fd);
+        return SERVER_ERR_OK;
+    }
+
+    // Queue the rest of the data (behind the messages still waiting in the output queue, to keep the order)
+    ServerTxBuffer_t* buf = server_tx_buffer_create(iov, iov_count, bytes_sent);
+    if(!buf) {
+        server_client_unlock(slot);
+        return SERVER_ERR_MALLOC_FAILURE;
+    }
+    ServerError_t err = server_tx_enqueue(ctx, slot, buf);
+    server_tx_buffer_release(buf);
+    if(err == SERVER_ERR_OK) {
+        err = server_tx_flush(slot);
+    }
+
+    server_client_unlock(slot);
+    return err;
+}
+
+ServerError_t server_broadcast(Server_t* ctx, const uint8_t* data, const size_t len) {
+    if(!data) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+    const struct iovec iov = { .iov_base = (void*)data, .iov_len = len };
+    return server_broadcastv(ctx, &iov, 1);
+}
+
+ServerError_t server_broadcastv(Server_t* ctx, const struct iovec* iov, const int iov_count) {
+    if(!ctx || !iov) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    } else if(iov_count <= 0 || iov_count > SERVER_TX_IOV_MAX) {
+        return SERVER_ERR_INVALID_ARGUMENT;
+    }
+    size_t len = server_iov_length(iov, iov_count);
+    if(len == 0) {
+        return SERVER_ERR_OK;
+    }
+
+    // Serialize the message once, all clients reference the same buffer
+    ServerTxBuffer_t* buf = server_tx_buffer_create(iov, iov_count, 0);
+    if(!buf) {
+        return SERVER_ERR_MALLOC_FAILURE;
+    }
+
+    // Take a snapshot of the clients into the preallocated array (so that the table is not locked while writing and
+    // nothing is allocated per broadcast) - the broadcasts are serialized by the snapshot lock
+    int ret = pthread_mutex_lock(&ctx->clients.snapshot_lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        server_tx_buffer_release(buf);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    ServerClient_t* clients = ctx->clients.snapshot;
+    uint32_t count;
+    ServerError_t err = server_get_clients(ctx, clients, SERVER_CLIENT_TABLE_SIZE, &count);
+    if(err != SERVER_ERR_OK) {
+        pthread_mutex_unlock(&ctx->clients.snapshot_lock);
+        server_tx_buffer_release(buf);
+        return err;
+    }
+
+    // Queue the message for all clients (if any) and send what their sockets accept without blocking, clients that
+    // disconnected in the meantime are skipped
+    uint32_t queued = 0;
+    for(uint32_t i = 0; i < count; i++) {
+        ServerClientSlot_t* slot = server_client_lock(&ctx->clients, &clients[i]);
+        if(!slot) {
+            continue;
+        } else if(slot->framing != SERVER_FRAMING_LINE) {
+            server_client_unlock(slot); // Text messages would break the framing of the client's stream
+            continue;
+        }
+        ServerError_t err_q = server_tx_enqueue(ctx, slot, buf);
+        if(err_q == SERVER_ERR_OK) {
+            server_tx_flush(slot); // A failing client is dropped from the broadcast, the rest is not affected
+            queued++;
+        } else if(err_q != SERVER_ERR_CLIENT_DISCONNECTED) {
+            log_error("broadcast message dropped for the client (fd: %d, err: %d)", clients[i].fd, err_q);
+            err = err_q;
+        }
+        server_client_unlock(slot);
+    }
+    pthread_mutex_unlock(&ctx->clients.snapshot_lock);
+    server_tx_buffer_release(buf);
+
+    log_debug("%zu bytes broadcast to %u client(s)", len, queued);
+    return err;
+}
+
+ServerError_t server_disconnect(Server_t* ctx, const ServerClient_t client) {
+    if(!ctx) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    uint64_t signal_value = 1;
+    ssize_t ret = write(client.disconnect_eventfd, &signal_value, sizeof(signal_value));
+    if(ret != sizeof(signal_value)) {
+        log_error("failed to write to disconnect_eventfd (err: %s)", strerror(errno));
+        return SERVER_ERR_EVENTFD_FAILURE;
+    }
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_open_listener(const char* port, const int backlog, int* fd) {
+    if(!port || !fd) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // Accepted from the callback of a watch, so the listening thread must never block on it
+    ServerError_t err = server_open_socket(port, backlog, false, fd);
+    if(err != SERVER_ERR_OK) {
+        return err;
+    }
+    log_info("listening on port %s (fd: %d)", port, *fd);
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_watch(Server_t* ctx, ServerWatch_t* watch) {
+    if(!ctx || !watch || !watch->on_event) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    } else if(ctx->listen_epoll_fd == -1) {
+        return SERVER_ERR_GENERIC;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = watch };
+    if(epoll_ctl(ctx->listen_epoll_fd, EPOLL_CTL_ADD, watch->fd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+    log_debug("fd %d watched by the listening thread", watch->fd);
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_unwatch(Server_t* ctx, ServerWatch_t* watch) {
+    if(!ctx || !watch) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    } else if(ctx->listen_epoll_fd == -1) {
+        return SERVER_ERR_GENERIC;
+    }
+
+    if(epoll_ctl(ctx->listen_epoll_fd, EPOLL_CTL_DEL, watch->fd, NULL) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+    log_debug("fd %d no longer watched by the listening thread", watch->fd);
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_shutdown(Server_t* ctx) {
+    if(!ctx) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // Shutdown the server (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("server lock taken");
+
+    // Disconnect all clients first (the table lock is held only while walking the used slots)
+    ret = pthread_mutex_lock(&ctx->clients.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        pthread_mutex_unlock(&ctx->lock);
+        log_debug("server lock released");
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock taken");
+
+    ServerError_t err = SERVER_ERR_OK;
+    for(uint32_t i = 0; i < ctx->clients.count && err == SERVER_ERR_OK; i++) {
+        err = server_disconnect(ctx, ctx->clients.slots[ctx->clients.dense[i]].client);
+    }
+
+    ret = pthread_mutex_unlock(&ctx->clients.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        err = SERVER_ERR_PTHREAD_FAILURE;
+    } else {
+        log_debug("client table lock released");
+    }
+
+    if(err != SERVER_ERR_OK) {
+        pthread_mutex_unlock(&ctx->lock);
+        log_debug("server lock released");
+        return err;
+    }
+
+    // Write to shutdown eventfd to stop server's listening thread (unless it has already exited after a failure)
+    uint64_t signal_value = 1;
+    ssize_t bytes;
+    if(ctx->shutdown_eventfd != -1) {
+        bytes = write(ctx->shutdown_eventfd, &signal_value, sizeof(signal_value));
+        if(bytes != sizeof(signal_value)) {
+            log_error("failed to write to shutdown_eventfd (err: %s)", strerror(errno));
+            pthread_mutex_unlock(&ctx->lock);
+            return SERVER_ERR_EVENTFD_FAILURE;
+        }
+    }
+
+    // Ask all accept threads to exit
+    for(uint16_t i = 0; i < ctx->acceptor_count; i++) {
+        bytes = write(ctx->acceptors[i].wakeup_eventfd, &signal_value, sizeof(signal_value));
+        if(bytes != sizeof(signal_value)) {
+            log_error("failed to write to acceptor's wakeup_eventfd (err: %s)", strerror(errno));
+            pthread_mutex_unlock(&ctx->lock);
+            return SERVER_ERR_EVENTFD_FAILURE;
+        }
+    }
+
+    // Ask all reactors to exit (each one handles pending disconnect requests first)
+    for(uint16_t i = 0; i < ctx->reactor_count; i++) {
+        bytes = write(ctx->reactors[i].wakeup_eventfd, &signal_value, sizeof(signal_value));
+        if(bytes != sizeof(signal_value)) {
+            log_error("failed to write to reactor's wakeup_eventfd (err: %s)", strerror(errno));
+            pthread_mutex_unlock(&ctx->lock);
+            return SERVER_ERR_EVENTFD_FAILURE;
+        }
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("server lock released");
+
+    // Wait for the threads to exit (the reactors handle the pending client disconnects first), so that the server
+    // can be deinitialized right away
+    if(ctx->listening) {
+        pthread_join(ctx->listening_thread, NULL);
+        ctx->listening = false;
+    }
+    for(uint16_t i = 0; i < ctx->acceptor_count; i++) {
+        ServerAcceptor_t* acceptor = &ctx->acceptors[i];
+        pthread_join(acceptor->thread, NULL);
+        if(acceptor->fd != -1) {
+            close(acceptor->fd);
+        }
+        close(acceptor->wakeup_eventfd);
+        close(acceptor->epoll_fd);
+    }
+    ctx->acceptor_count = 0;
+    for(uint16_t i = 0; i < ctx->reactor_count; i++) {
+        pthread_join(ctx->reactors[i].thread, NULL);
+    }
+    ctx->reactor_count = 0;
+    log_debug("server threads exited");
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_deinit(Server_t* ctx) {
+    if(!ctx) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // @TODO: Add a check if server is not running
+
+    // Destroy the server (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("server lock taken");
+
+    ServerError_t err = server_client_table_deinit(&ctx->clients);
+    if(err != SERVER_ERR_OK) {
+        log_error("failed to destroy the client table (server_client_table_deinit() returned: %d)", err);
+        return err;
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("server lock released");
+
+    // Close the listening socket if the server has never been run (otherwise closed by the listening thread)
+    if(ctx->fd != -1 && !ctx->fd_inherited) {
+        close(ctx->fd);
+    }
+
+    // Destroy the lock (@TODO: Improve mutex destroy mechanism, e.g. add a global protection variable)
+    ret = pthread_mutex_destroy(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_destroy() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+
+    // Zero-out the Server_t struct along with its members on deinit
+    memset(ctx, 0, sizeof(Server_t));
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_get_client_ip(const ServerClient_t client, char* inet_addrstr_) {
+    if(!inet_addrstr_) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    } else if(client.ip_addr[0] == '\0') {
+        return SERVER_ERR_NET_FAILURE; // The address could not be retrieved when the client was accepted
+    }
+
+    // The address is formatted once on accept, so no syscalls are needed here
+    memcpy(inet_addrstr_, client.ip_addr, IP_ADDRSTR_LENGTH);
+
+    return SERVER_ERR_OK;
+}
+
+bool server_client_equal(const ServerClient_t a, const ServerClient_t b) {
+    return a.fd == b.fd && a.generation == b.generation;
+}
+
+ServerError_t server_get_client_count(Server_t* ctx, uint32_t* count) {
+    if(!ctx || !count) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    int ret = pthread_mutex_lock(&ctx->clients.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock taken");
+
+    *count = ctx->clients.count;
+
+    ret = pthread_mutex_unlock(&ctx->clients.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock released");
+
+    return SERVER_ERR_OK;
+}
+
+ServerError_t server_get_clients(Server_t* ctx, ServerClient_t* clients, const uint32_t max_count, uint32_t* count) {
+    if(!ctx || !clients || !count) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    int ret = pthread_mutex_lock(&ctx->clients.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock taken");
+
+    // Only the used slots are visited (dense array)
+    *count = ctx->clients.count < max_count ? ctx->clients.count : max_count;
+    for(uint32_t i = 0; i < *count; i++) {
+        clients[i] = ctx->clients.slots[ctx->clients.dense[i]].client;
+    }
+
+    ret = pthread_mutex_unlock(&ctx->clients.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock released");
+
+    return SERVER_ERR_OK;
+}
+
+STATIC ServerError_t server_create_socket(const char* port, const bool reuse_port, int* fd) {
+    if(!port || !fd) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    /* Get the host address information (IP addr, port, etc.) - dual-stack IPv6 first, IPv4 if it is not available */
+    struct addrinfo hints;
+    struct addrinfo* server_addr = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = SERVER_IP_VER;
+    hints.ai_socktype = SERVER_SOCKTYPE;
+    hints.ai_flags = AI_PASSIVE; // Socket addr is intended for bind()
+
+    /* Create an endpoint for communication and get the file descriptor that refers to that endpoint */
+    *fd = -1;
+    int ret = getaddrinfo(0, port, &hints, &server_addr);
+    if(ret == 0) {
+        *fd = socket(server_addr->ai_family, server_addr->ai_socktype, 0);
+        if(*fd == -1) {
+            freeaddrinfo(server_addr);
+        }
+    }
+    if(ret != 0 || *fd == -1) {
+        log_info("IPv6 not available (port: %s), falling back to IPv4", port);
+        hints.ai_family = SERVER_IP_VER_FALLBACK;
+        ret = getaddrinfo(0, port, &hints, &server_addr);
+        if(ret != 0) {
+            log_error("getaddrinfo() returned: %d (err: %s)", ret, gai_strerror(ret));
+            return SERVER_ERR_NET_FAILURE;
+        }
+        *fd = socket(server_addr->ai_family, server_addr->ai_socktype, 0);
+        if(*fd == -1) {
+            log_error("socket() returned: -1 (err: %s)", strerror(errno));
+            freeaddrinfo(server_addr);
+            return SERVER_ERR_NET_FAILURE;
+        }
+    }
+
+    int option = 1; // Make the socket reuse recently orphaned addresses (fix for: address already in use)
+    ret = setsockopt(*fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+    if(ret == 0 && reuse_port) { // Let many sockets (threads or processes) bind the same port
+        ret = setsockopt(*fd, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option));
+    }
+    if(ret == 0 && server_addr->ai_family == AF_INET6) { // Accept IPv4 clients as well (IPv4-mapped addresses)
+        option = 0;
+        ret = setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, &option, sizeof(option));
+    }
+    if(ret == -1) {
+        log_error("setsockopt() returned: -1 (err: %s)", strerror(errno));
+        freeaddrinfo(server_addr);
+        close(*fd);
+        *fd = -1;
+        return SERVER_ERR_NET_FAILURE;
+    }
+
+    log_info("server socket created (port: %s, fd: %d, %s)", port, *fd, server_addr->ai_family == AF_INET6 ? "IPv6" : "IPv4");
+
+    /* Assign the address specified by ai_addr to the socket refered to by fd */
+    ret = bind(*fd, server_addr->ai_addr, server_addr->ai_addrlen);
+    freeaddrinfo(server_addr);
+    if(ret == -1) {
+        log_error("bind() returned: -1 (err: %s)", strerror(errno));
+        close(*fd);
+        *fd = -1;
+        return SERVER_ERR_NET_FAILURE;
+    }
+    log_info("assigned the IP addr to the server socket");
+
+    return SERVER_ERR_OK;
+}
+
+STATIC ServerError_t server_open_socket(const char* port, const int backlog, const bool reuse_port, int* fd) {
+    if(!port || !fd) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    ServerError_t err = server_create_socket(port, reuse_port, fd);
+    if(err != SERVER_ERR_OK) {
+        return err;
+    }
+
+    // Non-blocking, so that all pending connections can be accepted at once (until EAGAIN)
+    int flags = fcntl(*fd, F_GETFL, 0);
+    if(flags == -1 || fcntl(*fd, F_SETFL, flags | O_NONBLOCK) == -1 || listen(*fd, backlog) == -1) {
+        log_error("failed to set up the listening socket (port: %s, err: %s)", port, strerror(errno));
+        close(*fd);
+        *fd = -1;
+        return SERVER_ERR_NET_FAILURE;
+    }
+
+    return SERVER_ERR_OK;
+}
+
+STATIC int server_activated_socket(void) {
+    const char* pid_str = getenv("LISTEN_PID");
+    const char* fds_str = getenv("LISTEN_FDS");
+    if(!pid_str || !fds_str) {
+        return -1;
+    }
+
+    // The sockets are passed to this process only (the variables might have been inherited from the parent)
+    char* end;
+    errno = 0;
+    unsigned long pid = strtoul(pid_str, &end, 10);
+    if(errno != 0 || *end != '\0' || pid != (unsigned long)getpid()) {
+        return -1;
+    }
+    unsigned long fds = strtoul(fds_str, &end, 10);
+    if(errno != 0 || *end != '\0' || fds == 0) {
+        return -1;
+    }
+    if(fds > 1) {
+        log_info("%lu sockets passed by systemd, only the first one is used", fds);
+    }
+
+    // Make sure it is a listening TCP socket
+    int fd = SERVER_LISTEN_FDS_START;
+    int type = 0;
+    int accepting = 0;
+    socklen_t len = sizeof(type);
+    if(getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == -1 || type != SERVER_SOCKTYPE) {
+        log_error("the fd passed by systemd (fd: %d) is not a stream socket", fd);
+        return -1;
+    }
+    len = sizeof(accepting);
+    if(getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) == -1 || !accepting) {
+        log_error("the socket passed by systemd (fd: %d) is not listening", fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    return fd;
+}
+
+STATIC bool server_format_addr(const struct sockaddr_storage* addr, char* buf) {
+    const char* ret = NULL;
+    if(addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6* addr6 = (const struct sockaddr_in6*)addr;
+        if(IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr)) { // IPv4 client of the dual-stack socket
+            ret = inet_ntop(AF_INET, &addr6->sin6_addr.s6_addr[12], buf, IP_ADDRSTR_LENGTH);
+        } else {
+            ret = inet_ntop(AF_INET6, &addr6->sin6_addr, buf, IP_ADDRSTR_LENGTH);
+        }
+    } else if(addr->ss_family == AF_INET) {
+        ret = inet_ntop(AF_INET, &((const struct sockaddr_in*)addr)->sin_addr, buf, IP_ADDRSTR_LENGTH);
+    }
+    if(!ret) {
+        buf[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
+STATIC void* server_listen(void* arg) {
+    if(!arg) {
+        log_error("NULL ptr provided to server_listen; exiting server listening thread");
+        pthread_exit(NULL);
+    }
+
+    Server_t* server = (Server_t*)arg;
+
+    // The epoll instance (with the listening socket and the shutdown eventfd) is created by server_run()
+    struct epoll_event events[EPOLL_SERVER_LISTEN_EVENTS];
+    int epoll_fd = server->listen_epoll_fd;
+
+    // Run an infinite loop for monitoring server listening socket
+    while(1) {
+        int num_events = epoll_wait(epoll_fd, events, EPOLL_SERVER_LISTEN_EVENTS, -1);
+        if(num_events == -1 && errno == EINTR) {
+            continue; // Interrupted by a signal handler
+        } else if(num_events == -1) {
+            log_error("epoll_wait() failed (err: %s); exiting server listening thread", strerror(errno));
+            server_listen_cleanup(server);
+            server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
+            pthread_exit(NULL);
+        }
+
+        // Handle all queued events
+        for(int i = 0; i < num_events; i++) {
+            if(events[i].data.ptr == &server->fd) {
+                // Handle an incoming connection request
+                ServerError_t err = server_handle_conn_request(server, server->fd);
+                if(err != SERVER_ERR_OK) {
+                    log_error("server_handle_conn_request() returned %d; exiting server listening thread", err);
+                    server_listen_cleanup(server);
+                    server->cfg.cb_list.on_server_failure(server, err);
+                    pthread_exit(NULL);
+                }
+            } else if(events[i].data.ptr == &server->shutdown_eventfd) {
+                // Handle shutdown request
+                // @TODO: Handle (reject) all queued incoming connection requests and improve error hanling
+                log_info("exiting server listening thread (fd: %d)", server->fd);
+                if(server_listen_cleanup(server) != 0) {
+                    server->cfg.cb_list.on_server_failure(server, SERVER_ERR_GENERIC); // Failure when cleaning server's resources
+                }
+                pthread_exit(NULL);
+            } else {
+                // Data available on one of the fds registered with server_watch()
+                ServerWatch_t* watch = (ServerWatch_t*)events[i].data.ptr;
+                watch->on_event(server, watch->fd, watch->arg);
+            }
+        }
+    }
+    return NULL; // This function (thread) should never return
+}
+
+STATIC int server_listen_cleanup(Server_t* server) {
+    int epoll_fd = server->listen_epoll_fd;
+    server->listen_epoll_fd = -1; // No more fds can be watched
+
+    int err = server->fd_inherited ? 0 : close(server->fd); // Close server socket (the inherited one is kept open)
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+    }
+    server->fd = -1;
+    err += close(server->shutdown_eventfd); // Close eventfd
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+    }
+    server->shutdown_eventfd = -1;
+    err += close(epoll_fd); // Close epoll file descriptor
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+    }
+
+    return err;
+}
+
+STATIC void* server_client_handler(void* arg) {
+    if(!arg) {
+        log_error("NULL ptr provided to server_listen; exiting client thread!");
+        pthread_exit(NULL);
+    }
+
+    ServerClient_t client = ((ClientHandlerArgs_t*)arg)->client;
+    Server_t* server = ((ClientHandlerArgs_t*)arg)->server;
+    free(arg);
+    client.thread = pthread_self();
+    bool self_disconnect = false;
+
+    // Initialise epoll that will monitor the client file descriptor (required, since read is handled in separate function)
+    struct epoll_event ev = { 0 }, events[2]; // Max two events are expected at a time (socket fd and disconnect event fd)
+    int epoll_fd = epoll_create1(0); // Create a new epoll instance and return a file descriptor referring to that instance
+    if(epoll_fd == -1) {
+        log_error("epoll_create1 returned -1 (err: %s)", strerror(errno));
+        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
+        pthread_exit(NULL);
+    }
+
+    // Add the client socket file descriptor to the epoll event loop
+    ev.events = EPOLLIN;
+    ev.data.fd = client.fd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
+        pthread_exit(NULL);
+    }
+    server_client_attach_epoll(&server->clients, &client, epoll_fd, ev.data.u64);
+
+    // Add the disconnect event file descriptor to the epoll event loop
+    ev.events = EPOLLIN;
+    ev.data.fd = client.disconnect_eventfd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.disconnect_eventfd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
+        pthread_exit(NULL);
+    }
+
+    // Run an infinite loop for monitoring client socket
+    while(1) {
+        int num_events = epoll_wait(epoll_fd, events, EPOLL_CLIENT_THREAD_EVENTS, -1);
+        if(num_events == -1 && errno == EINTR) {
+            continue; // Interrupted by a signal handler
+        } else if(num_events == -1) {
+            log_error("epoll_wait() failed (err: %s)", strerror(errno));
+            server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
+            pthread_exit(NULL);
+        }
+
+        for(int i = 0; i < num_events; i++) {
+            if(events[i].data.fd == client.fd && (events[i].events & EPOLLOUT)) {
+                server_client_flush(server, client); // Socket writable again - send the queued messages
+            }
+            if(events[i].data.fd == client.fd && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                // Check if the client has sent new data or disconnected
+                if(server_client_peer_closed(client.fd)) {
+                    self_disconnect = true;
+                } else {
+                    // Only call on_data_received if there is data
+                    server->cfg.cb_list.on_data_received(server, client);
+                }
+            }
+
+            if(events[i].data.fd == client.disconnect_eventfd || self_disconnect == true) {
+                // Disconnect signal received
+                log_info("client (fd: %d) to be disconnected from the server", client.fd);
+
+                // Release the client first, so that nobody toggles EPOLLOUT in the epoll instance once it is closed
+                server_release_client(server, client, self_disconnect);
+                int err = close(epoll_fd); // Close epoll file descriptor
+                if(err != 0) {
+                    log_error("close() returned: -1 (err: %s)", strerror(errno));
+                }
+
+                log_info("exiting client thread (id: %lu, fd: %d)", client.thread, client.fd);
+                pthread_exit(NULL);
+            }
+        }
+    }
+    return NULL; // This function (thread) should never return
+}
+
+STATIC bool server_client_peer_closed(const int fd) {
+    char tmp;
+    ssize_t peek_ret = recv(fd, &tmp, 1, MSG_PEEK | MSG_DONTWAIT);
+    if(peek_ret == 0) {
+        return true; // Client has disconnected, trigger disconnect procedure
+    } else if(peek_ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        return true; // Error, treat as disconnect
+    }
+    return false;
+}
+
+STATIC void server_release_client(Server_t* server, ServerClient_t client, const bool self_disconnect) {
+    // Remove client from the server's client table first (waits for writes in progress and makes all copies of the
+    // handle stale, so nobody writes to the fd once it is closed and possibly reused by a new client)
+    ServerError_t err_t = server_client_table_remove(&server->clients, &client);
+    if(err_t != SERVER_ERR_OK) {
+        log_error("failed to remove the client from the client table (err: %d)", err_t);
+    }
+
+    int err = close(client.fd); // Close client socket
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+    }
+    err = close(client.disconnect_eventfd); // Close eventfd
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+    }
+    // A failure when cleaning a single client's resources is only logged (the other clients are served as usual)
+
+    if(self_disconnect) {
+        // Call "client disconnect" handler only on self disconnect (not on forced disconnect or during shutdown)
+        server->cfg.cb_list.on_client_disconnect(server, client);
+    }
+
+    free(client.rx_buf); // Nobody else uses the receive buffer once the serving thread released the client
+}
+
+STATIC ServerRxBuffer_t* server_rx_buffer_create(const size_t size) {
+    if(size == 0) {
+        return NULL;
+    }
+
+    // Allocate the context, the ring and the scratch buffer (incl. terminating char) at once
+    ServerRxBuffer_t* rx = (ServerRxBuffer_t*)calloc(1, sizeof(ServerRxBuffer_t) + size + size + 1);
+    if(!rx) {
+        log_error("calloc() returned NULL when allocating a client receive buffer");
+        return NULL;
+    }
+    rx->size = size;
+    rx->data = (char*)(rx + 1);
+    rx->line = rx->data + size;
+
+    return rx;
+}
+
+STATIC bool server_rx_find_delim(const ServerRxBuffer_t* rx, size_t* offset) {
+    size_t start = rx->scanned;
+
+    // Search the buffered data in (at most two) contiguous segments
+    while(start < rx->len) {
+        size_t pos = (rx->head + start) % rx->size;
+        size_t chunk = rx->len - start;
+        if(chunk > rx->size - pos) {
+            chunk = rx->size - pos;
+        }
+        const char* delim = memchr(rx->data + pos, '\n', chunk);
+        if(delim) {
+            *offset = start + (size_t)(delim - (rx->data + pos));
+            return true;
+        }
+        start += chunk;
+    }
+
+    return false;
+}
+
+STATIC ServerError_t server_start_acceptors(Server_t* ctx) {
+    if(!ctx) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // The listening thread accepts on the main socket, so one socket less is needed
+    uint16_t count = ctx->cfg.acceptor_count > SERVER_MAX_ACCEPTORS ? SERVER_MAX_ACCEPTORS : ctx->cfg.acceptor_count;
+    for(uint16_t i = 1; i < count; i++) {
+        ServerAcceptor_t* acceptor = &ctx->acceptors[ctx->acceptor_count];
+        acceptor->server = ctx;
+
+        // Bind another socket to the port (fails e.g. if the inherited socket does not have SO_REUSEPORT set)
+        ServerError_t err = server_open_socket(ctx->cfg.port, ctx->cfg.max_conn_requests, true, &acceptor->fd);
+        if(err != SERVER_ERR_OK) {
+            log_error("failed to open an additional listening socket (err: %d); running %u acceptor(s)", err,
+            ctx->acceptor_count + 1);
+            break;
+        }
+
+        // Create an epoll instance with the socket and an eventfd for synchronization (shutdown request, NULL data ptr)
+        acceptor->epoll_fd = epoll_create1(0);
+        if(acceptor->epoll_fd == -1) {
+            log_error("epoll_create1 returned -1 (err: %s)", strerror(errno));
+            close(acceptor->fd);
+            return SERVER_ERR_EPOLL_FAILURE;
+        }
+        acceptor->wakeup_eventfd = eventfd(0, EFD_NONBLOCK);
+        if(acceptor->wakeup_eventfd == -1) {
+            log_error("eventfd() failed (err: %s)", strerror(errno));
+            close(acceptor->epoll_fd);
+            close(acceptor->fd);
+            return SERVER_ERR_EVENTFD_FAILURE;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = acceptor };
+        int ret = epoll_ctl(acceptor->epoll_fd, EPOLL_CTL_ADD, acceptor->fd, &ev);
+        if(ret == 0) {
+            ev.data.ptr = NULL;
+            ret = epoll_ctl(acceptor->epoll_fd, EPOLL_CTL_ADD, acceptor->wakeup_eventfd, &ev);
+        }
+        if(ret == -1) {
+            log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+            close(acceptor->wakeup_eventfd);
+            close(acceptor->epoll_fd);
+            close(acceptor->fd);
+            return SERVER_ERR_EPOLL_FAILURE;
+        }
+
+        // Create an accept thread (joined by server_shutdown())
+        ret = pthread_create(&acceptor->thread, NULL, server_accept_loop, (void*)acceptor);
+        if(ret != 0) {
+            log_error("pthread_create() returned: %d", ret);
+            close(acceptor->wakeup_eventfd);
+            close(acceptor->epoll_fd);
+            close(acceptor->fd);
+            return SERVER_ERR_PTHREAD_FAILURE;
+        }
+        ctx->acceptor_count++;
+    }
+
+    if(ctx->acceptor_count > 0) {
+        log_info("%u additional acceptor(s) started (SO_REUSEPORT)", ctx->acceptor_count);
+    }
+    return SERVER_ERR_OK;
+}
+
+STATIC void* server_accept_loop(void* arg) {
+    if(!arg) {
+        log_error("NULL ptr provided to server_accept_loop; exiting accept thread!");
+        pthread_exit(NULL);
+    }
+
+    ServerAcceptor_t* acceptor = (ServerAcceptor_t*)arg;
+    Server_t* server = acceptor->server;
+    struct epoll_event events[EPOLL_ACCEPTOR_EVENTS];
+
+    // Run an infinite loop for monitoring acceptor's listening socket (the fds are closed by server_shutdown())
+    while(1) {
+        int num_events = epoll_wait(acceptor->epoll_fd, events, EPOLL_ACCEPTOR_EVENTS, -1);
+        ServerError_t err = SERVER_ERR_OK;
+        if(num_events == -1 && errno == EINTR) {
+            continue; // Interrupted by a signal handler
+        } else if(num_events == -1) {
+            log_error("epoll_wait() failed (err: %s); exiting accept thread", strerror(errno));
+            err = SERVER_ERR_EPOLL_FAILURE;
+        }
+
+        for(int i = 0; i < num_events && err == SERVER_ERR_OK; i++) {
+            if(!events[i].data.ptr) {
+                log_info("exiting accept thread (fd: %d)", acceptor->fd);
+                pthread_exit(NULL);
+            }
+            err = server_handle_conn_request(server, acceptor->fd);
+            if(err != SERVER_ERR_OK) {
+                log_error("server_handle_conn_request() returned %d; exiting accept thread", err);
+            }
+        }
+
+        if(err != SERVER_ERR_OK) {
+            // Leave the SO_REUSEPORT group right away, so that no more connections are routed to this socket
+            close(acceptor->fd);
+            acceptor->fd = -1;
+            server->cfg.cb_list.on_server_failure(server, err);
+            pthread_exit(NULL);
+        }
+    }
+    return NULL; // This function (thread) should never return
+}
+
+STATIC ServerError_t server_start_reactors(Server_t* ctx) {
+    if(!ctx) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // Use the configured number of reactors or one reactor per online CPU core
+    long count = ctx->cfg.reactor_count;
+    if(count == 0) {
+        count = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if(count < 1) {
+        count = 1;
+    } else if(count > SERVER_MAX_REACTORS) {
+        count = SERVER_MAX_REACTORS;
+    }
+
+    for(uint16_t i = 0; i < (uint16_t)count; i++) {
+        ServerReactor_t* reactor = &ctx->reactors[i];
+        reactor->server = ctx;
+
+        // Create a new epoll instance for the clients assigned to this reactor
+        reactor->epoll_fd = epoll_create1(0);
+        if(reactor->epoll_fd == -1) {
+            log_error("epoll_create1 returned -1 (err: %s)", strerror(errno));
+            return SERVER_ERR_EPOLL_FAILURE;
+        }
+
+        // Create an eventfd for synchronization (shutdown request) and add it to the epoll with a NULL data ptr
+        reactor->wakeup_eventfd = eventfd(0, EFD_NONBLOCK);
+        if(reactor->wakeup_eventfd == -1) {
+            log_error("eventfd() failed (err: %s)", strerror(errno));
+            close(reactor->epoll_fd);
+            return SERVER_ERR_EVENTFD_FAILURE;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        if(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wakeup_eventfd, &ev) == -1) {
+            log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+            close(reactor->wakeup_eventfd);
+            close(reactor->epoll_fd);
+            return SERVER_ERR_EPOLL_FAILURE;
+        }
+
+        // Create a reactor thread
+        int ret = pthread_create(&reactor->thread, NULL, server_reactor_loop, (void*)reactor);
+        if(ret != 0) {
+            log_error("pthread_create() returned: %d", ret);
+            close(reactor->wakeup_eventfd);
+            close(reactor->epoll_fd);
+            return SERVER_ERR_PTHREAD_FAILURE;
+        }
+        ctx->reactor_count++; // Joined by server_shutdown()
+    }
+
+    log_info("%u reactor(s) started", ctx->reactor_count);
+    return SERVER_ERR_OK;
+}
+
+STATIC void server_run_rollback(Server_t* ctx) {
+    uint64_t signal_value = 1;
+    ssize_t bytes;
+
+    // Stop the accept threads first, so that no more clients are assigned to the reactors (a thread that cannot be
+    // woken up is left running rather than joined forever)
+    for(uint16_t i = 0; i < ctx->acceptor_count; i++) {
+        ServerAcceptor_t* acceptor = &ctx->acceptors[i];
+        bytes = write(acceptor->wakeup_eventfd, &signal_value, sizeof(signal_value));
+        if(bytes != sizeof(signal_value)) {
+            log_error("failed to write to acceptor's wakeup_eventfd (err: %s)", strerror(errno));
+            continue;
+        }
+        pthread_join(acceptor->thread, NULL);
+        if(acceptor->fd != -1) {
+            close(acceptor->fd);
+        }
+        close(acceptor->wakeup_eventfd);
+        close(acceptor->epoll_fd);
+    }
+    ctx->acceptor_count = 0;
+
+    // Stop the reactors (each one closes its own fds on exit)
+    for(uint16_t i = 0; i < ctx->reactor_count; i++) {
+        bytes = write(ctx->reactors[i].wakeup_eventfd, &signal_value, sizeof(signal_value));
+        if(bytes != sizeof(signal_value)) {
+            log_error("failed to write to reactor's wakeup_eventfd (err: %s)", strerror(errno));
+            continue;
+        }
+        pthread_join(ctx->reactors[i].thread, NULL);
+    }
+    ctx->reactor_count = 0;
+
+    if(ctx->listen_epoll_fd != -1) {
+        close(ctx->listen_epoll_fd);
+        ctx->listen_epoll_fd = -1;
+    }
+    if(ctx->shutdown_eventfd != -1) {
+        close(ctx->shutdown_eventfd);
+        ctx->shutdown_eventfd = -1;
+    }
+}
+
+STATIC void* server_reactor_loop(void* arg) {
+    if(!arg) {
+        log_error("NULL ptr provided to server_reactor_loop; exiting reactor thread!");
+        pthread_exit(NULL);
+    }
+
+    ServerReactor_t* reactor = (ServerReactor_t*)arg;
+    Server_t* server = reactor->server;
+    struct epoll_event events[EPOLL_REACTOR_EVENTS];
+    ReactorClient_t* released[EPOLL_REACTOR_EVENTS];
+    bool stopping = false;
+
+    // Run an infinite loop for monitoring all client sockets assigned to this reactor
+    while(1) {
+        // Once shutdown was requested do not block - exit as soon as all pending disconnect requests are handled
+        int num_events = epoll_wait(reactor->epoll_fd, events, EPOLL_REACTOR_EVENTS, stopping ? 0 : -1);
+        if(num_events == -1 && errno == EINTR) {
+            continue; // Interrupted by a signal handler
+        } else if(num_events == -1) {
+            log_error("epoll_wait() failed (err: %s); exiting reactor thread", strerror(errno));
+            server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
+            pthread_exit(NULL);
+        } else if(num_events == 0 && stopping) {
+            break;
+        }
+
+        uint32_t released_count = 0;
+        for(int i = 0; i < num_events; i++) {
+            ReactorSource_t* src = (ReactorSource_t*)events[i].data.ptr;
+            if(!src) {
+                // Shutdown request (clear the eventfd so that it does not wake the reactor again)
+                uint64_t signal_value;
+                if(read(reactor->wakeup_eventfd, &signal_value, sizeof(signal_value)) != sizeof(signal_value)) {
+                    log_error("failed to read from reactor's wakeup_eventfd (err: %s)", strerror(errno));
+                }
+                stopping = true;
+                continue;
+            }
+
+            ReactorClient_t* rc = src->owner;
+            if(rc->closed) {
+                continue; // Client already released while handling an earlier event from the same batch
+            }
+
+            bool self_disconnect = false;
+            if(!src->is_disconnect_fd) {
+                if(events[i].events & EPOLLOUT) {
+                    server_client_flush(server, rc->client); // Socket writable again - send the queued messages
+                }
+                if(!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                    continue;
+                }
+
+                // Check if the client has sent new data or disconnected
+                if(server_client_peer_closed(rc->client.fd)) {
+                    self_disconnect = true;
+                } else {
+                    server->cfg.cb_list.on_data_received(server, rc->client);
+                    continue;
+                }
+            }
+
+            // Disconnect signal received (or the client disconnected by itself)
+            log_info("client (fd: %d) to be disconnected from the server", rc->client.fd);
+            server_release_client(server, rc->client, self_disconnect);
+            rc->closed = true;
+            released[released_count++] = rc;
+        }
+
+        // Free the handles only after the whole batch was handled (other events might still point to them)
+        for(uint32_t i = 0; i < released_count; i++) {
+            free(released[i]);
+        }
+    }
+
+    int err = close(reactor->wakeup_eventfd); // Close eventfd
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+    }
+    err += close(reactor->epoll_fd); // Close epoll file descriptor
+    if(err != 0) {
+        log_error("close() returned: -1 (err: %s)", strerror(errno));
+        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_GENERIC); // Failure when cleaning reactor's resources
+    }
+
+    log_info("exiting reactor thread (id: %lu)", reactor->thread);
+    pthread_exit(NULL);
+    return NULL;
+}
+
+STATIC ServerError_t server_reactor_add_client(Server_t* ctx, const ServerClient_t* client) {
+    if(!ctx || !client) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // Assign the client to a reactor based on its fd
+    ServerReactor_t* reactor = &ctx->reactors[client->fd % ctx->reactor_count];
+
+    ReactorClient_t* rc = (ReactorClient_t*)calloc(1, sizeof(ReactorClient_t));
+    if(!rc) {
+        log_error("calloc() returned NULL when allocating a reactor client handle");
+        return SERVER_ERR_MALLOC_FAILURE;
+    }
+    rc->client = *client;
+    rc->sock_src = (ReactorSource_t){ .owner = rc, .is_disconnect_fd = false };
+    rc->disconnect_src = (ReactorSource_t){ .owner = rc, .is_disconnect_fd = true };
+
+    // Add the client socket file descriptor to the reactor's epoll
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &rc->sock_src };
+    if(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client->fd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        free(rc);
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+
+    // Add the disconnect event file descriptor to the reactor's epoll
+    ev.data.ptr = &rc->disconnect_src;
+    if(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client->disconnect_eventfd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+        free(rc);
+        return SERVER_ERR_EPOLL_FAILURE;
+    }
+    ev.data.ptr = &rc->sock_src; // Socket registration data (used when EPOLLOUT is toggled)
+    server_client_attach_epoll(&ctx->clients, client, reactor->epoll_fd, ev.data.u64);
+
+    return SERVER_ERR_OK;
+}
+
+STATIC ServerError_t server_handle_conn_request(Server_t* ctx, const int listen_fd) {
+    if(!ctx) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // Drain the backlog (the socket is non-blocking), so that a connection storm does not overflow it
+    for(uint32_t i = 0; i < SERVER_ACCEPT_BATCH; i++) {
+        struct sockaddr_storage client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+        int client_fd = accept4(listen_fd, (struct sockaddr*)&client_addr, &client_addr_len, SOCK_CLOEXEC);
+        if(client_fd == -1) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                break; // No more pending connections
+            } else if(errno == EINTR || errno == ECONNABORTED) {
+                continue; // Connection reset by the peer before it was accepted
+            } else if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Out of fds or memory - the pending connections are retried on the next wakeup (served clients stay)
+                // (paused for a while, as the level-triggered epoll reports the pending connections right away)
+                log_error("accept4() returned: -1 (err: %s); new connections postponed", strerror(errno));
+                usleep(SERVER_ACCEPT_RETRY_DELAY_US);
+                break;
+            }
+            log_error("accept4() returned: -1 (err: %s)", strerror(errno));
+            return SERVER_ERR_NET_FAILURE;
+        }
+
+        // A failure to set up a single client drops only that client (its resources are released by server_add_client)
+        ServerError_t err = server_add_client(ctx, client_fd, &client_addr);
+        if(err != SERVER_ERR_OK) {
+            log_error("server_add_client() returned %d; new connection (fd: %d) dropped", err, client_fd);
+        }
+    }
+
+    return SERVER_ERR_OK;
+}
+
+STATIC ServerError_t server_add_client(Server_t* ctx, const int client_fd, const struct sockaddr_storage* addr) {
+    // Check if the new client request can be accepted and reject (close) if there is no more space for new clients
+    // (with many acceptors the limit may be exceeded by the clients accepted at the same time by the other threads)
+    uint32_t clients_count;
+    ServerError_t err_c = server_get_client_count(ctx, &clients_count);
+    if(err_c != SERVER_ERR_OK) {
+        close(client_fd);
+        return err_c;
+    }
+    if(clients_count >= ctx->cfg.max_clients || client_fd >= SERVER_CLIENT_TABLE_SIZE) {
+        if(close(client_fd) == -1) {
+            log_error("close() returned: -1 (err: %s)", strerror(errno));
+        }
+        log_error("new connection request dropped (max no of clients [%d] reached or fd [%d] out of the client table)",
+        ctx->cfg.max_clients, client_fd);
+        return SERVER_ERR_OK;
+    }
+
+    // Create a new client handle (with client's IP addr formatted once for all later lookups)
+    ServerClient_t client = { .fd = client_fd };
+    int ret;
+    if(!server_format_addr(addr, client.ip_addr)) {
+        log_error("failed to convert the ip addr struct to a char string (err: %s)", strerror(errno));
+    }
+
+    // Create an eventfd for synchronization
+    client.disconnect_eventfd = eventfd(0, EFD_NONBLOCK);
+    if(client.disconnect_eventfd == -1) {
+        log_error("eventfd() failed (err: %s)", strerror(errno));
+        close(client.fd);
+        return SERVER_ERR_EVENTFD_FAILURE;
+    }
+
+    // Create a receive buffer for framing client's data into lines
+    client.rx_buf = server_rx_buffer_create(ctx->cfg.rx_buf_size ? ctx->cfg.rx_buf_size : SERVER_DEFAULT_RX_BUF_SIZE);
+    if(!client.rx_buf) {
+        close(client.disconnect_eventfd);
+        close(client.fd);
+        return SERVER_ERR_MALLOC_FAILURE;
+    }
+
+    if(ctx->cfg.mode == SERVER_MODE_REACTOR) {
+        // Add a new client to the client table first (the reactor may remove it as soon as it is registered)
+        client.thread = ctx->reactors[client.fd % ctx->reactor_count].thread;
+        ServerError_t err = server_client_table_insert(&ctx->clients, &client);
+        if(err != SERVER_ERR_OK) {
+            log_error("failed to add a new client to the client table, server_client_table_insert returned %d", err);
+            free(client.rx_buf);
+            close(client.disconnect_eventfd);
+            close(client.fd);
+            return err;
+        }
+
+        // Hand the client over to one of the reactors (not registered in its epoll on failure, so nobody else uses it)
+        ServerError_t err_r = server_reactor_add_client(ctx, &client);
+        if(err_r != SERVER_ERR_OK) {
+            log_error("server_reactor_add_client() returned %d", err_r);
+            server_client_table_remove(&ctx->clients, &client);
+            free(client.rx_buf);
+            close(client.disconnect_eventfd);
+            close(client.fd);
+            return err_r;
+        }
+    } else {
+        // Add a new client to the client table first (the worker thread removes it on disconnect)
+        ServerError_t err = server_client_table_insert(&ctx->clients, &client);
+        if(err != SERVER_ERR_OK) {
+            log_error("failed to add a new client to the client table, server_client_table_insert returned %d", err);
+            free(client.rx_buf);
+            close(client.disconnect_eventfd);
+            close(client.fd);
+            return err;
+        }
+
+        // Create a new working thread for the client (the args are owned by the thread, as the next client accepted
+        // in the same batch may be added before the thread starts)
+        ClientHandlerArgs_t* args = (ClientHandlerArgs_t*)malloc(sizeof(ClientHandlerArgs_t));
+        if(!args) {
+            log_error("malloc() returned NULL when allocating the client thread args");
+            server_client_table_remove(&ctx->clients, &client);
+            free(client.rx_buf);
+            close(client.disconnect_eventfd);
+            close(client.fd);
+            return SERVER_ERR_MALLOC_FAILURE;
+        }
+        *args = (ClientHandlerArgs_t){ .client = client, .server = ctx };
+        ret = pthread_create(&client.thread, NULL, server_client_handler, (void*)args);
+        if(ret != 0) {
+            log_error("pthread_create() returned: %d", ret);
+            free(args);
+            server_client_table_remove(&ctx->clients, &client);
+            free(client.rx_buf);
+            close(client.disconnect_eventfd);
+            close(client.fd);
+            return SERVER_ERR_PTHREAD_FAILURE;
+        }
+        server_client_set_thread(&ctx->clients, &client, client.thread);
+        ret = pthread_detach(client.thread);
+        if(ret != 0) {
+            log_error("pthread_detach() returned: %d", ret); // The thread already serves the client (and releases it)
+        }
+    }
 
+    log_info("new client accepted (ip: %s, fd: %d, thread: %lu)", client.ip_addr, client.fd, client.thread);
+
+    // Call a "client connect" handler
+    ctx->cfg.cb_list.on_client_connect(ctx, client);
     return SERVER_ERR_OK;
 }
 
-ListNode_t* server_get_clients(Server_t* ctx) {
-    if(!ctx) {
-        return NULL;
+STATIC ServerError_t server_client_table_init(ServerClientTable_t* table) {
+    if(!table) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    }
+
+    // Allocate the slots and the dense array of used slots
+    table->slots = (ServerClientSlot_t*)calloc(SERVER_CLIENT_TABLE_SIZE, sizeof(ServerClientSlot_t));
+    table->dense = (int*)calloc(SERVER_CLIENT_TABLE_SIZE, sizeof(int));
+    table->snapshot = (ServerClient_t*)calloc(SERVER_CLIENT_TABLE_SIZE, sizeof(ServerClient_t));
+    if(!table->slots || !table->dense || !table->snapshot) {
+        log_error("calloc() returned NULL when allocating the client table");
+        free(table->slots);
+        free(table->dense);
+        free(table->snapshot);
+        return SERVER_ERR_MALLOC_FAILURE;
     }
+    table->count = 0;
 
-    return ctx->clients_list.get_head(&ctx->clients_list);
+    // Slot locks live as long as the table, so a thread holding a stale handle can always take them safely
+    int ret = pthread_mutex_init(&table->lock, NULL);
+    if(ret == 0) {
+        ret = pthread_mutex_init(&table->snapshot_lock, NULL);
+    }
+    for(uint32_t i = 0; i < SERVER_CLIENT_TABLE_SIZE && ret == 0; i++) {
+        table->slots[i].epoll_fd = -1;
+        ret = pthread_mutex_init(&table->slots[i].lock, NULL);
+    }
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        free(table->slots);
+        free(table->dense);
+        free(table->snapshot);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+
+    return SERVER_ERR_OK;
 }
 
-STATIC ServerError_t server_create_socket(const char* port, int* fd) {
-    if(!port) {
+STATIC ServerError_t server_client_table_deinit(ServerClientTable_t* table) {
+    if(!table) {
         return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    /* Get the host address information (IP addr, port, etc.) */
-    struct addrinfo hints;
-    struct addrinfo* server_addr;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = SERVER_IP_VER;
-    hints.ai_socktype = SERVER_SOCKTYPE;
-    hints.ai_flags = AI_PASSIVE; // Socket addr is intended for bind()
-    int ret = getaddrinfo(0, port, &hints, &server_addr);
-    if(ret != 0) {
-        log_error("getaddrinfo() returned: 0 (err: %s)", gai_strerror(ret));
-        return SERVER_ERR_NET_FAILURE;
+    int ret = pthread_mutex_destroy(&table->lock);
+    ret |= pthread_mutex_destroy(&table->snapshot_lock);
+    for(uint32_t i = 0; i < SERVER_CLIENT_TABLE_SIZE; i++) {
+        ret |= pthread_mutex_destroy(&table->slots[i].lock);
     }
 
-    /* Create an endpoint for communication and get the file descriptor that refers to that endpoint */
-    *fd = socket(server_addr->ai_family, server_addr->ai_socktype, 0);
-    if(*fd == -1) {
-        log_error("socket() returned: -1 (err: %s)", strerror(errno));
-        freeaddrinfo(server_addr);
-        return SERVER_ERR_NET_FAILURE;
+    free(table->slots);
+    free(table->dense);
+    free(table->snapshot);
+    table->slots = NULL;
+    table->dense = NULL;
+    table->snapshot = NULL;
+    table->count = 0;
+
+    if(ret != 0) {
+        log_error("pthread_mutex_destroy() failed");
+        return SERVER_ERR_PTHREAD_FAILURE;
     }
-    int option = 1; // Make the socket reuse recently orphaned addresses (fix for: address already in use)
-    setsockopt(*fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
-    if(*fd == -1) {
-        log_error("setsockopt() returned: -1 (err: %s)", strerror(errno));
-        freeaddrinfo(server_addr);
-        return SERVER_ERR_NET_FAILURE;
+    return SERVER_ERR_OK;
+}
+
+STATIC ServerError_t server_client_table_insert(ServerClientTable_t* table, ServerClient_t* client) {
+    if(!table || !client) {
+        return SERVER_ERR_NULL_ARGUMENT;
+    } else if(client->fd < 0 || client->fd >= SERVER_CLIENT_TABLE_SIZE) {
+        return SERVER_ERR_TABLE_FULL;
     }
 
-    log_info("server socket created (port: %s, fd: %d)", port, *fd);
+    // Lock order: slot lock, then table lock
+    ServerClientSlot_t* slot = &table->slots[client->fd];
+    int ret = pthread_mutex_lock(&slot->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client lock taken");
+    ret = pthread_mutex_lock(&table->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        pthread_mutex_unlock(&slot->lock);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock taken");
 
-    /* Assign the address specified by ai_addr to the socket refered to by fd */
-    ret = bind(*fd, server_addr->ai_addr, server_addr->ai_addrlen);
-    freeaddrinfo(server_addr);
-    if(ret == -1) {
-        log_error("bind() returned: -1 (err: %s)", strerror(errno));
-        return SERVER_ERR_NET_FAILURE;
+    ServerError_t err = SERVER_ERR_OK;
+    if(slot->in_use) {
+        err = SERVER_ERR_TABLE_FULL; // Should never happen (fd still used by a client that has not been released)
+    } else {
+        // Next generation of the slot (the previous one is kept in the slot after remove)
+        client->generation = slot->client.generation + 1;
+        slot->client = *client;
+        slot->in_use = true;
+        slot->epoll_fd = -1; // Set once the serving thread registers the socket (server_client_attach_epoll)
+        slot->epollout = false;
+        slot->framing = SERVER_FRAMING_LINE;
+        slot->tx.dropped = 0;
+        slot->tx.closed = false;
+        slot->dense_idx = table->count;
+        table->dense[table->count++] = client->fd;
     }
-    log_info("assigned the IP addr to the server socket");
 
-    return SERVER_ERR_OK;
+    pthread_mutex_unlock(&table->lock);
+    log_debug("client table lock released");
+    pthread_mutex_unlock(&slot->lock);
+    log_debug("client lock released");
+
+    return err;
 }
 
-STATIC void* server_listen(void* arg) {
-    if(!arg) {
-        log_error("NULL ptr provided to server_listen; exiting server listening thread");
-        pthread_exit(NULL);
+STATIC ServerError_t server_client_table_remove(ServerClientTable_t* table, const ServerClient_t* client) {
+    if(!table || !client) {
+        return SERVER_ERR_NULL_ARGUMENT;
     }
 
-    Server_t* server = (Server_t*)arg;
+    // Waits for I/O in progress (the slot lock is taken by server_client_lock)
+    ServerClientSlot_t* slot = server_client_lock(table, client);
+    if(!slot) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
+    }
+    int ret = pthread_mutex_lock(&table->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        server_client_unlock(slot);
+        return SERVER_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("client table lock taken");
 
-    // Initialise epoll that will monitor the client file descriptor (required, since read is handled in separate function)
-    struct epoll_event ev, events[2]; // Max two events are expected at a time (socket fd and shutdown event fd)
-    int epoll_fd = epoll_create1(0); // Create a new epoll instance and return a file descriptor referring to that instance
-    if(epoll_fd == -1) {
-        log_error("epoll_create1 returned -1 (err: %s); exiting server listening thread", strerror(errno));
-        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-        pthread_exit(NULL);
+    // Move the last used slot into the freed place of the dense array
+    int last_fd = table->dense[--table->count];
+    table->dense[slot->dense_idx] = last_fd;
+    table->slots[last_fd].dense_idx = slot->dense_idx;
+    slot->in_use = false; // The generation stays in the slot, so all copies of the handle are stale from now on
+
+    // Drop the messages nobody is going to send anymore
+    server_tx_clear(slot);
+    free(slot->tx.entries);
+    slot->tx.entries = NULL;
+    slot->epoll_fd = -1;
+    slot->epollout = false;
+
+    pthread_mutex_unlock(&table->lock);
+    log_debug("client table lock released");
+    server_client_unlock(slot);
+
+    return SERVER_ERR_OK;
+}
+
+STATIC ServerClientSlot_t* server_client_lock(const ServerClientTable_t* table, const ServerClient_t* client) {
+    if(!table || !client || client->fd < 0 || client->fd >= SERVER_CLIENT_TABLE_SIZE) {
+        return NULL;
     }
 
-    // Add the server listening socket file descriptor to the epoll event loop
-    ev.events = EPOLLIN;
-    ev.data.fd = server->fd;
-    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server->fd, &ev) == -1) {
-        log_error("epoll_ctl returned -1 (err: %s); exiting server listening thread", strerror(errno));
-        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-        pthread_exit(NULL);
+    ServerClientSlot_t* slot = &table->slots[client->fd];
+    int ret = metrics_mutex_lock(&slot->lock, METRICS_HIST_LOCK_CLIENT);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return NULL;
     }
+    log_debug("client lock taken");
 
-    // Add the disconnect event file descriptor to the epoll event loop
-    ev.events = EPOLLIN;
-    ev.data.fd = server->shutdown_eventfd;
-    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server->shutdown_eventfd, &ev) == -1) {
-        log_error("epoll_ctl returned -1 (err: %s); exiting server listening thread", strerror(errno));
-        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-        pthread_exit(NULL);
+    // The slot fields cannot change while its lock is taken
+    if(!slot->in_use || slot->client.generation != client->generation) {
+        server_client_unlock(slot);
+        return NULL;
     }
 
-    // Run an infinite loop for monitoring server listening socket
-    while(1) {
-        int num_events = epoll_wait(epoll_fd, events, EPOLL_SERVER_LISTEN_EVENTS, -1);
-        if(num_events == -1) {
-            log_error("epoll_wait() failed (err: %s); exiting server listening thread", strerror(errno));
-            server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-            pthread_exit(NULL);
-        }
+    return slot;
+}
 
-        // Handle all queued events
-        for(int i = 0; i < num_events; i++) {
-            if(events[i].data.fd == server->fd) {
-                // Handle an incoming connection request
-                ServerError_t err = server_handle_conn_request(server);
-                if(err != SERVER_ERR_OK) {
-                    log_error("server_handle_conn_request() returned %d; exiting server listening thread", err);
-                    server->cfg.cb_list.on_server_failure(server, err);
-                    pthread_exit(NULL);
-                }
-            } else if(events[i].data.fd == server->shutdown_eventfd) {
-                // Handle shutdown request
-                // @TODO: Handle (reject) all queued incoming connection requests and improve error hanling
-                int err = close(server->fd); // Close server socket
-                if(err != 0) {
-                    log_error("close() returned: -1 (err: %s)", strerror(errno));
-                }
-                err += close(server->shutdown_eventfd); // Close eventfd
-                if(err != 0) {
-                    log_error("close() returned: -1 (err: %s)", strerror(errno));
-                }
-                err += close(epoll_fd); // Close epoll file descriptor
-                if(err != 0) {
-                    log_error("close() returned: -1 (err: %s)", strerror(errno));
-                }
-                if(err != 0) {
-                    server->cfg.cb_list.on_server_failure(server, SERVER_ERR_GENERIC); // Failure when cleaning server's resources
-                }
-                log_info("exiting server listening thread (fd: %d)", server->fd);
-                pthread_exit(NULL);
-            }
-        }
+STATIC void server_client_unlock(ServerClientSlot_t* slot) {
+    int ret = pthread_mutex_unlock(&slot->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return;
     }
-    return NULL; // This function (thread) should never return
+    log_debug("client lock released");
 }
 
-STATIC void* server_client_handler(void* arg) {
-    if(!arg) {
-        log_error("NULL ptr provided to server_listen; exiting client thread!");
-        pthread_exit(NULL);
+STATIC size_t server_iov_length(const struct iovec* iov, const int iov_count) {
+    size_t len = 0;
+    for(int i = 0; i < iov_count; i++) {
+        len += iov[i].iov_len;
     }
+    return len;
+}
 
-    ServerClient_t client = ((ClientHandlerArgs_t*)arg)->client;
-    Server_t* server = ((ClientHandlerArgs_t*)arg)->server;
-    bool self_disconnect = false;
-
-    // Initialise epoll that will monitor the client file descriptor (required, since read is handled in separate function)
-    struct epoll_event ev, events[2]; // Max two events are expected at a time (socket fd and disconnect event fd)
-    int epoll_fd = epoll_create1(0); // Create a new epoll instance and return a file descriptor referring to that instance
-    if(epoll_fd == -1) {
-        log_error("epoll_create1 returned -1 (err: %s)", strerror(errno));
-        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-        pthread_exit(NULL);
+STATIC ServerTxBuffer_t* server_tx_buffer_create(const struct iovec* iov, const int iov_count, size_t skip) {
+    size_t len = server_iov_length(iov, iov_count) - skip;
+    ServerTxBuffer_t* buf = (ServerTxBuffer_t*)malloc(sizeof(ServerTxBuffer_t) + len);
+    if(!buf) {
+        log_error("malloc() returned NULL when allocating a message buffer");
+        return NULL;
+    }
+    atomic_init(&buf->refs, 1);
+    buf->len = len;
+
+    // Gather the parts (without the skipped bytes) one after another
+    size_t offset = 0;
+    for(int i = 0; i < iov_count; i++) {
+        if(skip >= iov[i].iov_len) {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+        memcpy(buf->data + offset, (const uint8_t*)iov[i].iov_base + skip, iov[i].iov_len - skip);
+        offset += iov[i].iov_len - skip;
+        skip = 0;
     }
 
-    // Add the client socket file descriptor to the epoll event loop
-    ev.events = EPOLLIN;
-    ev.data.fd = client.fd;
-    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &ev) == -1) {
-        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
-        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-        pthread_exit(NULL);
+    return buf;
+}
+
+STATIC void server_tx_buffer_release(ServerTxBuffer_t* buf) {
+    if(buf && atomic_fetch_sub(&buf->refs, 1) == 1) {
+        free(buf);
     }
+}
 
-    // Add the disconnect event file descriptor to the epoll event loop
-    ev.events = EPOLLIN;
-    ev.data.fd = client.disconnect_eventfd;
-    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.disconnect_eventfd, &ev) == -1) {
-        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
-        server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-        pthread_exit(NULL);
+STATIC ServerError_t server_tx_enqueue(const Server_t* ctx, ServerClientSlot_t* slot, ServerTxBuffer_t* buf) {
+    ServerTxQueue_t* tx = &slot->tx;
+    if(tx->closed) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
+    } else if(!tx->entries) {
+        tx->entries = (ServerTxEntry_t*)calloc(SERVER_TX_QUEUE_LEN, sizeof(ServerTxEntry_t));
+        if(!tx->entries) {
+            log_error("calloc() returned NULL when allocating a client output queue");
+            return SERVER_ERR_MALLOC_FAILURE;
+        }
     }
 
-    // Run an infinite loop for monitoring client socket
-    while(1) {
-        int num_events = epoll_wait(epoll_fd, events, EPOLL_CLIENT_THREAD_EVENTS, -1);
-        if(num_events == -1) {
-            log_error("epoll_wait() failed (err: %s)", strerror(errno));
-            server->cfg.cb_list.on_server_failure(server, SERVER_ERR_EPOLL_FAILURE);
-            pthread_exit(NULL);
+    // Handle a slow consumer according to the backpressure policy if the message does not fit below the high-water mark
+    size_t high_water = ctx->cfg.tx_high_water ? ctx->cfg.tx_high_water : SERVER_DEFAULT_TX_HIGH_WATER;
+    if(tx->count == SERVER_TX_QUEUE_LEN || (tx->count > 0 && tx->bytes + buf->len > high_water)) {
+        if(ctx->cfg.tx_policy == SERVER_TX_POLICY_COALESCE) {
+            server_tx_evict(slot, buf->len, high_water); // Newer messages supersede the older ones
+        } else if(ctx->cfg.tx_policy == SERVER_TX_POLICY_DISCONNECT) {
+            log_error("client (fd: %d) too slow (%zu bytes queued); disconnecting", slot->client.fd, tx->bytes);
+            server_tx_clear(slot);
+            server_tx_update_epoll(slot);
+            tx->dropped++;
+            tx->closed = true;
+            uint64_t signal_value = 1;
+            if(write(slot->client.disconnect_eventfd, &signal_value, sizeof(signal_value)) != sizeof(signal_value)) {
+                log_error("failed to write to disconnect_eventfd (err: %s)", strerror(errno));
+            }
+            return SERVER_ERR_CLIENT_DISCONNECTED;
+        } else {
+            tx->dropped++;
+            return SERVER_ERR_QUEUE_FULL;
         }
+    }
 
-        for(int i = 0; i < num_events; i++) {
-            if(events[i].data.fd == client.fd) {
-                // Check if the client has sent new data or disconnected
-                char tmp;
-                ssize_t peek_ret = recv(client.fd, &tmp, 1, MSG_PEEK | MSG_DONTWAIT);
-                if(peek_ret == 0) {
-                    // Client has disconnected, trigger disconnect procedure
-                    self_disconnect = true;
-                } else if(peek_ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                    // Error, treat as disconnect
-                    self_disconnect = true;
-                } else {
-                    // Only call on_data_received if there is data
-                    server->cfg.cb_list.on_data_received(server, client);
-                }
+    atomic_fetch_add(&buf->refs, 1);
+    tx->entries[(tx->head + tx->count) % SERVER_TX_QUEUE_LEN] = (ServerTxEntry_t){ .buf = buf, .offset = 0 };
+    tx->count++;
+    tx->bytes += buf->len;
+
+    return SERVER_ERR_OK;
+}
+
+STATIC void server_tx_evict(ServerClientSlot_t* slot, const size_t len, const size_t high_water) {
+    ServerTxQueue_t* tx = &slot->tx;
+    while(tx->count > 0 && (tx->count == SERVER_TX_QUEUE_LEN || tx->bytes + len > high_water)) {
+        // The oldest message might be partially sent already - it has to stay (the stream would be corrupted)
+        ServerTxEntry_t* head = &tx->entries[tx->head];
+        uint32_t victim_idx = tx->head;
+        if(head->offset > 0) {
+            if(tx->count == 1) {
+                break;
             }
+            victim_idx = (tx->head + 1) % SERVER_TX_QUEUE_LEN;
+        }
 
-            if(events[i].data.fd == client.disconnect_eventfd || self_disconnect == true) {
-                // Disconnect signal received
-                log_info("client (fd: %d) to be disconnected from the server", client.fd);
+        ServerTxEntry_t* victim = &tx->entries[victim_idx];
+        tx->bytes -= victim->buf->len;
+        server_tx_buffer_release(victim->buf);
+        victim->buf = NULL;
+        if(victim != head) {
+            *victim = *head; // Move the partially sent message into the freed entry
+            head->buf = NULL;
+        }
+        tx->head = (tx->head + 1) % SERVER_TX_QUEUE_LEN;
+        tx->count--;
+        tx->dropped++;
+    }
+}
 
-                int err = close(client.fd); // Close client socket
-                if(err != 0) {
-                    log_error("close() returned: -1 (err: %s)", strerror(errno));
-                }
-                err += close(client.disconnect_eventfd); // Close eventfd
-                if(err != 0) {
-                    log_error("close() returned: -1 (err: %s)", strerror(errno));
-                }
-                err += close(epoll_fd); // Close epoll file descriptor
-                if(err != 0) {
-                    log_error("close() returned: -1 (err: %s)", strerror(errno));
-                }
-                err += (int)server->clients_list.remove(&server->clients_list, &client); // Remove client from the server's clients list
-                if(err != LIST_ERR_OK) {
-                    log_error("failed to remove the client from the clients_list (err: %d)", err);
-                }
-                if(err != 0) {
-                    server->cfg.cb_list.on_server_failure(server, SERVER_ERR_GENERIC); // Failure when cleaning client's resources
-                }
-                err += pthread_mutex_destroy(&client.lock); // Destroy the lock (@TODO: improve mutex destroy algorithm)
-                if(err != 0) {
-                    log_error("pthread_mutex_destroy() returned %d", err);
-                }
+STATIC ServerError_t server_tx_flush(ServerClientSlot_t* slot) {
+    ServerTxQueue_t* tx = &slot->tx;
+    ServerError_t err = SERVER_ERR_OK;
 
-                if(self_disconnect) {
-                    // Call "client disconnect" handler only on self disconnect (not on forced disconnect or during shutdown)
-                    server->cfg.cb_list.on_client_disconnect(server, client);
-                }
+    while(tx->count > 0) {
+        // Gather the queued messages (starting with the unsent part of the oldest one)
+        struct iovec iov[SERVER_TX_IOV_MAX];
+        size_t iov_bytes = 0;
+        int iov_count = 0;
+        for(uint32_t i = 0; i < tx->count && iov_count < SERVER_TX_IOV_MAX; i++, iov_count++) {
+            ServerTxEntry_t* entry = &tx->entries[(tx->head + i) % SERVER_TX_QUEUE_LEN];
+            iov[iov_count].iov_base = entry->buf->data + entry->offset;
+            iov[iov_count].iov_len = entry->buf->len - entry->offset;
+            iov_bytes += iov[iov_count].iov_len;
+        }
 
-                log_info("exiting client thread (id: %lu, fd: %d)", client.thread, client.fd);
-                pthread_exit(NULL);
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iov_count };
+        ssize_t sent = sendmsg(slot->client.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        metrics_add(METRICS_SERVER_TX_SYSCALLS, 1);
+        if(sent < 0 && errno == EINTR) {
+            continue;
+        } else if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            metrics_add(METRICS_SERVER_TX_EAGAIN, 1);
+            break; // Socket full - the rest is sent once it becomes writable
+        } else if(sent <= 0) {
+            log_error("sendmsg() failed for the client (fd: %d, err: %s)", slot->client.fd, strerror(errno));
+            server_tx_clear(slot);
+            err = SERVER_ERR_NET_FAILURE;
+            break;
+        }
+        log_debug("%zd bytes sent to the client (fd: %d)", sent, slot->client.fd);
+        metrics_add(METRICS_SERVER_TX_BYTES, (uint64_t)sent);
+
+        // Drop the messages that were sent completely
+        tx->bytes -= (size_t)sent;
+        for(size_t left = (size_t)sent; left > 0;) {
+            ServerTxEntry_t* entry = &tx->entries[tx->head];
+            size_t unsent = entry->buf->len - entry->offset;
+            if(left < unsent) {
+                entry->offset += left;
+                break;
             }
+            left -= unsent;
+            server_tx_buffer_release(entry->buf);
+            entry->buf = NULL;
+            tx->head = (tx->head + 1) % SERVER_TX_QUEUE_LEN;
+            tx->count--;
+        }
+        if((size_t)sent < iov_bytes) {
+            break; // Partial write - the socket is full
         }
     }
-    return NULL; // This function (thread) should never return
+    if(tx->count == 0) {
+        tx->head = 0;
+    }
+
+    server_tx_update_epoll(slot);
+    return err;
 }
 
-STATIC int compare_client_fd(const void* a, const void* b) {
-    return (*(int*)a - *(int*)b);
+STATIC void server_tx_clear(ServerClientSlot_t* slot) {
+    ServerTxQueue_t* tx = &slot->tx;
+    for(; tx->count > 0; tx->count--) {
+        ServerTxEntry_t* entry = &tx->entries[tx->head];
+        server_tx_buffer_release(entry->buf);
+        entry->buf = NULL;
+        tx->head = (tx->head + 1) % SERVER_TX_QUEUE_LEN;
+    }
+    tx->head = 0;
+    tx->bytes = 0;
 }
 
-STATIC ServerError_t server_handle_conn_request(Server_t* ctx) {
-    if(!ctx) {
-        return SERVER_ERR_NULL_ARGUMENT;
+STATIC void server_tx_update_epoll(ServerClientSlot_t* slot) {
+    bool want_epollout = slot->tx.count > 0;
+    if(slot->epoll_fd == -1 || slot->epollout == want_epollout) {
+        return;
     }
-    struct sockaddr client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
 
-    // Block until a new client is present
-    int client_fd = accept(ctx->fd, &client_addr, &client_addr_len);
-    if(client_fd == -1) {
-        log_error("accept() returned: -1 (err: %s)", strerror(errno));
-        return SERVER_ERR_NET_FAILURE;
+    // The registration is modified with the same data, so the serving thread still recognizes the client socket
+    struct epoll_event ev = { .events = EPOLLIN | (want_epollout ? EPOLLOUT : 0), .data.u64 = slot->epoll_data };
+    if(epoll_ctl(slot->epoll_fd, EPOLL_CTL_MOD, slot->client.fd, &ev) == -1) {
+        log_error("epoll_ctl returned -1 (err: %s)", strerror(errno));
+        return;
     }
+    slot->epollout = want_epollout;
+}
 
-    // Check if the new client request can be accepted and reject (close) if there is no more space for new clients
-    if(ctx->clients_list.get_length(&ctx->clients_list) >= ctx->cfg.max_clients) {
-        int err = close(client_fd);
-        if(err == -1) {
-            log_error("close() returned: -1 (err: %s)", strerror(errno));
-            return SERVER_ERR_NET_FAILURE;
-        }
-        log_error("new connection request dropped (max no of clients [%d] reached)", ctx->cfg.max_clients);
-        return SERVER_ERR_OK;
+STATIC ServerError_t server_client_flush(Server_t* ctx, const ServerClient_t client) {
+    ServerClientSlot_t* slot = server_client_lock(&ctx->clients, &client);
+    if(!slot) {
+        return SERVER_ERR_CLIENT_DISCONNECTED;
     }
 
-    // Create a new client handle
-    ServerClient_t client = { .fd = client_fd };
+    ServerError_t err = server_tx_flush(slot);
 
-    // Initialize mutex for protecting client-related critical sections
-    int ret = pthread_mutex_init(&client.lock, NULL);
-    if(ret != 0) {
-        log_error("pthread_mutex_init() returned %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
-    }
+    server_client_unlock(slot);
+    return err;
+}
 
-    // Create an eventfd for synchronization
-    client.disconnect_eventfd = eventfd(0, EFD_NONBLOCK);
-    if(client.disconnect_eventfd == -1) {
-        log_error("eventfd() failed (err: %s)", strerror(errno));
-        return SERVER_ERR_EVENTFD_FAILURE;
+STATIC void server_client_attach_epoll(ServerClientTable_t* table, const ServerClient_t* client, const int epoll_fd,
+const uint64_t epoll_data) {
+    ServerClientSlot_t* slot = server_client_lock(table, client);
+    if(!slot) {
+        return; // Client already released
     }
 
-    // Create a new working thread for the client
-    ClientHandlerArgs_t args = { .client = client, .server = ctx };
-    ret = pthread_create(&client.thread, NULL, server_client_handler, (void*)&args);
-    if(ret != 0) {
-        log_error("pthread_create() returned: %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
-    }
-    ret = pthread_detach(client.thread);
-    if(ret != 0) {
-        log_error("pthread_detach() returned: %d", ret);
-        return SERVER_ERR_PTHREAD_FAILURE;
-    }
+    slot->epoll_fd = epoll_fd;
+    slot->epoll_data = epoll_data;
+    slot->epollout = false;
+    server_tx_update_epoll(slot); // Messages might have been queued before the socket was registered
 
-    // Add a new client to clients_list
-    ListError_t err = ctx->clients_list.push(&ctx->clients_list, &client, sizeof(ServerClient_t));
-    if(err != LIST_ERR_OK) {
-        log_error("failed to add a new client fd to the clients_fd_list, llist_push returned %d", err);
-        return SERVER_ERR_LLIST_FAILURE;
-    }
+    server_client_unlock(slot);
+}
 
-    // Get client IPv4 addr as a string
-    char ip_addr[IPV4_ADDRSTR_LENGTH];
-    if(server_get_client_ip(client, ip_addr) == SERVER_ERR_OK) {
-        log_info("new client accepted (ip: %s, fd: %d, thread: %lu)", ip_addr, client.fd, client.thread);
+STATIC void server_client_set_thread(ServerClientTable_t* table, const ServerClient_t* client, const pthread_t thread) {
+    ServerClientSlot_t* slot = server_client_lock(table, client);
+    if(!slot) {
+        return; // Client already released
     }
 
-    // Call a "client connect" handler
-    ctx->cfg.cb_list.on_client_connect(ctx, client);
-    return SERVER_ERR_OK;
+    slot->client.thread = thread;
+
+    server_client_unlock(slot);
 }
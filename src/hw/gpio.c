@@ -1,13 +1,80 @@
+#define LOG_MODULE LOG_MODULE_GPIO
+
 #include "hw/gpio.h"
 
 #include <errno.h>  // For: errno
 #include <string.h> // For: memset
 
+#include "utils/common.h"
 #include "utils/log.h"
 
 #define GPIO_CHIP_PATH "/dev/gpiochip0"
 #define GPIO_CONSUMER "PiHub"
 
+/**
+ * @brief Request the line with the given direction (releasing it first if requested with the other one) [call with the lock taken]
+ * @param[in, out]  ctx  Pointer to the Gpio_t instance
+ * @param[in]  line_num  GPIO line number
+ * @param[in]  dir  Direction to request the line with (GPIO_DIR_INPUT, GPIO_DIR_OUTPUT or GPIO_DIR_EVENT)
+ * @param[in]  value  Initial output value (ignored for inputs)
+ * @return GPIO_ERR_OK on success, GPIO_ERR_LIBGPIOD_FAILURE otherwise
+ */
+STATIC GpioError_t gpio_line_request(Gpio_t* ctx, const uint8_t line_num, const GpioDirection_t dir, const uint8_t value);
+
+/**
+ * @brief Release the line (if requested) and drop its cached handle [call with the lock taken]
+ * @param[in, out]  ctx  Pointer to the Gpio_t instance
+ * @param[in]  line_num  GPIO line number
+ */
+STATIC void gpio_line_release(Gpio_t* ctx, const uint8_t line_num);
+
+/**
+ * @brief Validate the list of lines passed to a bulk operation (range and no duplicates)
+ * @param[in]  lines  GPIO line numbers
+ * @param[in]  count  Number of lines
+ * @return GPIO_ERR_OK if valid, GPIO_ERR_INVALID_LINE / GPIO_ERR_INVALID_ARGUMENT otherwise
+ */
+STATIC GpioError_t gpio_bulk_validate(const uint8_t* lines, const size_t count);
+
+/**
+ * @brief Check if any of the lines is watched for edge events [call with the lock taken]
+ * @param[in]  ctx  Pointer to the Gpio_t instance
+ * @param[in]  lines  GPIO line numbers
+ * @param[in]  count  Number of lines
+ * @return true if at least one of the lines is watched, false otherwise
+ */
+STATIC bool gpio_bulk_busy(const Gpio_t* ctx, const uint8_t* lines, const size_t count);
+
+/**
+ * @brief Find a bulk group requested with exactly the given lines (in the same order) and direction [call with the lock taken]
+ * @param[in]  ctx  Pointer to the Gpio_t instance
+ * @param[in]  lines  GPIO line numbers
+ * @param[in]  count  Number of lines
+ * @param[in]  dir  Direction of the group
+ * @return Group index (numbered from 1) if found, GPIO_GROUP_NONE otherwise
+ */
+STATIC uint8_t gpio_group_find(const Gpio_t* ctx, const uint8_t* lines, const size_t count, const GpioDirection_t dir);
+
+/**
+ * @brief Request the lines together as a new bulk group (releasing previous requests of these lines) [call with the lock taken]
+ * @param[in, out]  ctx  Pointer to the Gpio_t instance
+ * @param[in]  lines  GPIO line numbers
+ * @param[in]  count  Number of lines
+ * @param[in]  dir  Direction to request the lines with (GPIO_DIR_INPUT or GPIO_DIR_OUTPUT)
+ * @param[in]  values  Initial output values (ignored for inputs)
+ * @param[out]  group  Index of the requested group
+ * @return GPIO_ERR_OK on success, GPIO_ERR_LIBGPIOD_FAILURE otherwise
+ */
+STATIC GpioError_t gpio_group_request(
+Gpio_t* ctx, const uint8_t* lines, const size_t count, const GpioDirection_t dir, const int* values, uint8_t* group);
+
+/**
+ * @brief Release all the lines of the bulk group and free the group [call with the lock taken]
+ * @param[in, out]  ctx  Pointer to the Gpio_t instance
+ * @param[in]  group  Group index (numbered from 1)
+ */
+STATIC void gpio_group_release(Gpio_t* ctx, const uint8_t group);
+
 GpioError_t gpio_init(Gpio_t* ctx) {
     if(!ctx) {
         return GPIO_ERR_NULL_ARGUMENT;
@@ -37,6 +104,47 @@ GpioError_t gpio_set(Gpio_t* ctx, const uint8_t line_num, const uint8_t value) {
         return GPIO_ERR_NULL_ARGUMENT;
     } else if(!ctx->chip) {
         return GPIO_ERR_NOT_INITIALIZED;
+    } else if(line_num >= GPIO_LINE_COUNT) {
+        return GPIO_ERR_INVALID_LINE;
+    }
+
+    // Critical section; Mutex required
+    int ret_p = pthread_mutex_lock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock taken");
+
+    GpioError_t err = GPIO_ERR_OK;
+    GpioLine_t* line = &ctx->lines[line_num];
+    if(line->dir == GPIO_DIR_EVENT) {
+        err = GPIO_ERR_LINE_BUSY; // Do not drop the watch silently
+    } else if(line->dir != GPIO_DIR_OUTPUT || line->group != GPIO_GROUP_NONE) {
+        err = gpio_line_request(ctx, line_num, GPIO_DIR_OUTPUT, value); // Requesting sets the value as well
+    } else if(gpiod_line_set_value(line->handle, value) < 0) {
+        log_error("Set line output failed (errno: %d)", errno);
+        gpio_line_release(ctx, line_num); // Request the line from scratch next time
+        err = GPIO_ERR_LIBGPIOD_FAILURE;
+    }
+
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        err = GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock released");
+
+    return err;
+}
+
+GpioError_t gpio_get(Gpio_t* ctx, const uint8_t line_num, uint8_t* state) {
+    if(!ctx || !state) {
+        return GPIO_ERR_NULL_ARGUMENT;
+    } else if(!ctx->chip) {
+        return GPIO_ERR_NOT_INITIALIZED;
+    } else if(line_num >= GPIO_LINE_COUNT) {
+        return GPIO_ERR_INVALID_LINE;
     }
 
     // Critical section; Mutex required
@@ -48,47 +156,226 @@ GpioError_t gpio_set(Gpio_t* ctx, const uint8_t line_num, const uint8_t value) {
     log_debug("gpio lock taken");
 
     GpioError_t err = GPIO_ERR_OK;
-    struct gpiod_line* line;
+    GpioLine_t* line = &ctx->lines[line_num];
     do {
-        line = gpiod_chip_get_line(ctx->chip, line_num);
-        if(!line) {
-            log_error("Get line failed (errno: %d)", errno);
+        bool readable = (line->dir == GPIO_DIR_INPUT || line->dir == GPIO_DIR_EVENT);
+        if(!readable || line->group != GPIO_GROUP_NONE) {
+            err = gpio_line_request(ctx, line_num, GPIO_DIR_INPUT, 0);
+            if(err != GPIO_ERR_OK) {
+                break;
+            }
+        }
+
+        int ret = gpiod_line_get_value(line->handle);
+        if(ret < 0) {
+            log_error("Get line input failed (errno: %d)", errno);
+            gpio_line_release(ctx, line_num); // Request the line from scratch next time
             err = GPIO_ERR_LIBGPIOD_FAILURE;
             break;
         }
+        *state = ret; // gpiod_line_get_value returns -1 on error; GPIO line value (0 or 1) otherwise
+    } while(0); // Run only once (do not loop)
 
-        int ret = gpiod_line_request_output(line, GPIO_CONSUMER, value);
-        if(ret < 0) {
-            log_error("Request line as output failed (errno: %d)", errno);
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock released");
+
+    return err;
+}
+
+GpioError_t gpio_set_bulk(Gpio_t* ctx, const uint8_t* lines, const uint8_t* values, const size_t count) {
+    if(!ctx || !lines || !values) {
+        return GPIO_ERR_NULL_ARGUMENT;
+    } else if(!ctx->chip) {
+        return GPIO_ERR_NOT_INITIALIZED;
+    }
+
+    GpioError_t err = gpio_bulk_validate(lines, count);
+    if(err != GPIO_ERR_OK) {
+        return err;
+    }
+
+    // libgpiod takes the values as an int array
+    int bulk_values[GPIO_LINE_COUNT];
+    for(size_t i = 0; i < count; i++) {
+        bulk_values[i] = values[i] ? 1 : 0;
+    }
+
+    // Critical section; Mutex required
+    int ret_p = pthread_mutex_lock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock taken");
+
+    uint8_t group = gpio_group_find(ctx, lines, count, GPIO_DIR_OUTPUT);
+    if(gpio_bulk_busy(ctx, lines, count)) {
+        err = GPIO_ERR_LINE_BUSY;
+    } else if(group == GPIO_GROUP_NONE) {
+        err = gpio_group_request(ctx, lines, count, GPIO_DIR_OUTPUT, bulk_values, &group); // Sets the values as well
+    } else if(gpiod_line_set_value_bulk(&ctx->groups[group - 1].bulk, bulk_values) < 0) {
+        log_error("Set bulk output failed (errno: %d)", errno);
+        gpio_group_release(ctx, group); // Request the lines from scratch next time
+        err = GPIO_ERR_LIBGPIOD_FAILURE;
+    }
+
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        err = GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock released");
+
+    return err;
+}
+
+GpioError_t gpio_get_bulk(Gpio_t* ctx, const uint8_t* lines, uint8_t* values, const size_t count) {
+    if(!ctx || !lines || !values) {
+        return GPIO_ERR_NULL_ARGUMENT;
+    } else if(!ctx->chip) {
+        return GPIO_ERR_NOT_INITIALIZED;
+    }
+
+    GpioError_t err = gpio_bulk_validate(lines, count);
+    if(err != GPIO_ERR_OK) {
+        return err;
+    }
+
+    // Critical section; Mutex required
+    int ret_p = pthread_mutex_lock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock taken");
+
+    int bulk_values[GPIO_LINE_COUNT];
+    do {
+        if(gpio_bulk_busy(ctx, lines, count)) {
+            err = GPIO_ERR_LINE_BUSY;
+            break;
+        }
+
+        uint8_t group = gpio_group_find(ctx, lines, count, GPIO_DIR_INPUT);
+        if(group == GPIO_GROUP_NONE) {
+            err = gpio_group_request(ctx, lines, count, GPIO_DIR_INPUT, NULL, &group);
+            if(err != GPIO_ERR_OK) {
+                break;
+            }
+        }
+
+        if(gpiod_line_get_value_bulk(&ctx->groups[group - 1].bulk, bulk_values) < 0) {
+            log_error("Get bulk input failed (errno: %d)", errno);
+            gpio_group_release(ctx, group); // Request the lines from scratch next time
             err = GPIO_ERR_LIBGPIOD_FAILURE;
             break;
         }
+        for(size_t i = 0; i < count; i++) {
+            values[i] = (uint8_t)bulk_values[i];
+        }
+    } while(0); // Run only once (do not loop)
 
-        ret = gpiod_line_set_value(line, value);
-        if(ret < 0) {
-            log_error("Set line output failed (errno: %d)", errno);
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock released");
+
+    return err;
+}
+
+GpioError_t gpio_watch(Gpio_t* ctx, const uint8_t line_num, int* fd) {
+    if(!ctx || !fd) {
+        return GPIO_ERR_NULL_ARGUMENT;
+    } else if(!ctx->chip) {
+        return GPIO_ERR_NOT_INITIALIZED;
+    } else if(line_num >= GPIO_LINE_COUNT) {
+        return GPIO_ERR_INVALID_LINE;
+    }
+
+    // Critical section; Mutex required
+    int ret_p = pthread_mutex_lock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock taken");
+
+    GpioError_t err = GPIO_ERR_OK;
+    GpioLine_t* line = &ctx->lines[line_num];
+    do {
+        if(line->dir != GPIO_DIR_EVENT) {
+            err = gpio_line_request(ctx, line_num, GPIO_DIR_EVENT, 0);
+            if(err != GPIO_ERR_OK) {
+                break;
+            }
+        }
+
+        *fd = gpiod_line_event_get_fd(line->handle);
+        if(*fd < 0) {
+            log_error("Get line event fd failed (errno: %d)", errno);
+            gpio_line_release(ctx, line_num);
             err = GPIO_ERR_LIBGPIOD_FAILURE;
             break;
         }
     } while(0); // Run only once (do not loop)
 
-    gpiod_line_release(line);
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock released");
+
+    return err;
+}
+
+GpioError_t gpio_unwatch(Gpio_t* ctx, const uint8_t line_num) {
+    if(!ctx) {
+        return GPIO_ERR_NULL_ARGUMENT;
+    } else if(!ctx->chip) {
+        return GPIO_ERR_NOT_INITIALIZED;
+    } else if(line_num >= GPIO_LINE_COUNT) {
+        return GPIO_ERR_INVALID_LINE;
+    }
+
+    // Critical section; Mutex required
+    int ret_p = pthread_mutex_lock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return GPIO_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("gpio lock taken");
+
+    GpioError_t err = GPIO_ERR_OK;
+    if(ctx->lines[line_num].dir == GPIO_DIR_EVENT) {
+        gpio_line_release(ctx, line_num);
+    } else {
+        err = GPIO_ERR_NOT_WATCHED;
+    }
 
     ret_p = pthread_mutex_unlock(&ctx->lock);
     if(ret_p != 0) {
         log_error("pthread_mutex_unlock() returned %d", ret_p);
-        err = GPIO_ERR_PTHREAD_FAILURE;
+        return GPIO_ERR_PTHREAD_FAILURE;
     }
     log_debug("gpio lock released");
 
     return err;
 }
 
-GpioError_t gpio_get(Gpio_t* ctx, const uint8_t line_num, uint8_t* state) {
-    if(!ctx || !state) {
+GpioError_t gpio_read_event(Gpio_t* ctx, const uint8_t line_num, GpioEvent_t* event) {
+    if(!ctx || !event) {
         return GPIO_ERR_NULL_ARGUMENT;
     } else if(!ctx->chip) {
         return GPIO_ERR_NOT_INITIALIZED;
+    } else if(line_num >= GPIO_LINE_COUNT) {
+        return GPIO_ERR_INVALID_LINE;
     }
 
     // Critical section; Mutex required
@@ -100,33 +387,37 @@ GpioError_t gpio_get(Gpio_t* ctx, const uint8_t line_num, uint8_t* state) {
     log_debug("gpio lock taken");
 
     GpioError_t err = GPIO_ERR_OK;
-    struct gpiod_line* line;
+    GpioLine_t* line = &ctx->lines[line_num];
     do {
-        line = gpiod_chip_get_line(ctx->chip, line_num);
-        if(!line) {
-            log_error("Get line failed (errno: %d)", errno);
-            err = GPIO_ERR_LIBGPIOD_FAILURE;
+        if(line->dir != GPIO_DIR_EVENT) {
+            err = GPIO_ERR_NOT_WATCHED;
             break;
         }
 
-        int ret = gpiod_line_request_input(line, GPIO_CONSUMER);
+        // Poll without blocking (the mutex is held)
+        const struct timespec no_wait = { .tv_sec = 0, .tv_nsec = 0 };
+        int ret = gpiod_line_event_wait(line->handle, &no_wait);
         if(ret < 0) {
-            log_error("Request line as input failed (errno: %d)", errno);
+            log_error("Wait for line event failed (errno: %d)", errno);
             err = GPIO_ERR_LIBGPIOD_FAILURE;
             break;
+        } else if(ret == 0) {
+            err = GPIO_ERR_NO_EVENT;
+            break;
         }
 
-        ret = gpiod_line_get_value(line);
+        struct gpiod_line_event line_event;
+        ret = gpiod_line_event_read(line->handle, &line_event);
         if(ret < 0) {
-            log_error("Get line input failed (errno: %d)", errno);
+            log_error("Read line event failed (errno: %d)", errno);
             err = GPIO_ERR_LIBGPIOD_FAILURE;
             break;
         }
-        *state = ret; // gpiod_line_get_value returns -1 on error; GPIO line value (0 or 1) otherwise
+        *event = (GpioEvent_t){ .line = line_num,
+            .rising = (line_event.event_type == GPIOD_LINE_EVENT_RISING_EDGE),
+            .ts = line_event.ts };
     } while(0); // Run only once (do not loop)
 
-    gpiod_line_release(line);
-
     ret_p = pthread_mutex_unlock(&ctx->lock);
     if(ret_p != 0) {
         log_error("pthread_mutex_unlock() returned %d", ret_p);
@@ -144,6 +435,11 @@ GpioError_t gpio_deinit(Gpio_t* ctx) {
         return GPIO_ERR_NOT_INITIALIZED;
     }
 
+    // Release all the lines kept requested by gpio_set/gpio_get and the bulk operations
+    for(int i = 0; i < GPIO_LINE_COUNT; i++) {
+        gpio_line_release(ctx, i);
+    }
+
     gpiod_chip_close(ctx->chip);
 
     int ret_p = pthread_mutex_destroy(&ctx->lock);
@@ -156,4 +452,169 @@ GpioError_t gpio_deinit(Gpio_t* ctx) {
     ctx->chip = NULL;
 
     return GPIO_ERR_OK;
-}
\ No newline at end of file
+}
+
+STATIC GpioError_t gpio_line_request(Gpio_t* ctx, const uint8_t line_num, const GpioDirection_t dir, const uint8_t value) {
+    GpioLine_t* line = &ctx->lines[line_num];
+
+    // A line can be requested only once, so the previous request has to be released on direction change
+    gpio_line_release(ctx, line_num);
+
+    struct gpiod_line* handle = gpiod_chip_get_line(ctx->chip, line_num);
+    if(!handle) {
+        log_error("Get line failed (errno: %d)", errno);
+        return GPIO_ERR_LIBGPIOD_FAILURE;
+    }
+
+    int ret;
+    const char* dir_str;
+    if(dir == GPIO_DIR_OUTPUT) {
+        ret = gpiod_line_request_output(handle, GPIO_CONSUMER, value);
+        dir_str = "output";
+    } else if(dir == GPIO_DIR_EVENT) {
+        ret = gpiod_line_request_both_edges_events(handle, GPIO_CONSUMER);
+        dir_str = "edge events";
+    } else {
+        ret = gpiod_line_request_input(handle, GPIO_CONSUMER);
+        dir_str = "input";
+    }
+    if(ret < 0) {
+        log_error("Request line as %s failed (errno: %d)", dir_str, errno);
+        return GPIO_ERR_LIBGPIOD_FAILURE;
+    }
+
+    line->handle = handle;
+    line->dir = dir;
+    log_debug("GPIO line %hu requested as %s", line_num, dir_str);
+
+    return GPIO_ERR_OK;
+}
+
+STATIC void gpio_line_release(Gpio_t* ctx, const uint8_t line_num) {
+    GpioLine_t* line = &ctx->lines[line_num];
+    if(line->group != GPIO_GROUP_NONE) {
+        gpio_group_release(ctx, line->group); // Lines of a group share the handle, so all of them go away
+        return;
+    }
+    if(line->handle) {
+        gpiod_line_release(line->handle);
+    }
+    line->handle = NULL;
+    line->dir = GPIO_DIR_NONE;
+}
+
+STATIC GpioError_t gpio_bulk_validate(const uint8_t* lines, const size_t count) {
+    if(count == 0 || count > GPIO_LINE_COUNT) {
+        return GPIO_ERR_INVALID_ARGUMENT;
+    }
+
+    uint64_t seen = 0; // GPIO_LINE_COUNT fits in a 64-bit mask
+    for(size_t i = 0; i < count; i++) {
+        if(lines[i] >= GPIO_LINE_COUNT) {
+            return GPIO_ERR_INVALID_LINE;
+        } else if(seen & (1ULL << lines[i])) {
+            return GPIO_ERR_INVALID_ARGUMENT; // The kernel refuses to request the same line twice
+        }
+        seen |= 1ULL << lines[i];
+    }
+
+    return GPIO_ERR_OK;
+}
+
+STATIC bool gpio_bulk_busy(const Gpio_t* ctx, const uint8_t* lines, const size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if(ctx->lines[lines[i]].dir == GPIO_DIR_EVENT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+STATIC uint8_t gpio_group_find(const Gpio_t* ctx, const uint8_t* lines, const size_t count, const GpioDirection_t dir) {
+    // All the lines have to be in the same group, so it's enough to check the first one
+    uint8_t group = ctx->lines[lines[0]].group;
+    if(group == GPIO_GROUP_NONE) {
+        return GPIO_GROUP_NONE;
+    }
+
+    const GpioBulkGroup_t* bulk_group = &ctx->groups[group - 1];
+    if(bulk_group->dir != dir || bulk_group->bulk.num_lines != count) {
+        return GPIO_GROUP_NONE;
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(bulk_group->bulk.lines[i] != ctx->lines[lines[i]].handle || ctx->lines[lines[i]].group != group) {
+            return GPIO_GROUP_NONE;
+        }
+    }
+
+    return group;
+}
+
+STATIC GpioError_t gpio_group_request(
+Gpio_t* ctx, const uint8_t* lines, const size_t count, const GpioDirection_t dir, const int* values, uint8_t* group) {
+    // Take a free group or reuse the oldest one
+    uint8_t idx = GPIO_GROUP_NONE;
+    for(uint8_t i = 0; i < GPIO_BULK_GROUP_COUNT; i++) {
+        if(ctx->groups[i].dir == GPIO_DIR_NONE) {
+            idx = i + 1;
+            break;
+        }
+    }
+    if(idx == GPIO_GROUP_NONE) {
+        idx = ctx->next_group + 1;
+        ctx->next_group = (ctx->next_group + 1) % GPIO_BULK_GROUP_COUNT;
+        gpio_group_release(ctx, idx);
+    }
+
+    // A line can be requested only once, so all the previous requests of these lines have to be released
+    unsigned int offsets[GPIO_LINE_COUNT];
+    for(size_t i = 0; i < count; i++) {
+        gpio_line_release(ctx, lines[i]);
+        offsets[i] = lines[i];
+    }
+
+    GpioBulkGroup_t* bulk_group = &ctx->groups[idx - 1];
+    gpiod_line_bulk_init(&bulk_group->bulk);
+    int ret = gpiod_chip_get_lines(ctx->chip, offsets, count, &bulk_group->bulk);
+    if(ret < 0) {
+        log_error("Get lines failed (errno: %d)", errno);
+        gpiod_line_bulk_init(&bulk_group->bulk);
+        return GPIO_ERR_LIBGPIOD_FAILURE;
+    }
+
+    if(dir == GPIO_DIR_OUTPUT) {
+        ret = gpiod_line_request_bulk_output(&bulk_group->bulk, GPIO_CONSUMER, values);
+    } else {
+        ret = gpiod_line_request_bulk_input(&bulk_group->bulk, GPIO_CONSUMER);
+    }
+    if(ret < 0) {
+        log_error("Request bulk as %s failed (errno: %d)", (dir == GPIO_DIR_OUTPUT ? "output" : "input"), errno);
+        gpiod_line_bulk_init(&bulk_group->bulk);
+        return GPIO_ERR_LIBGPIOD_FAILURE;
+    }
+
+    bulk_group->dir = dir;
+    for(size_t i = 0; i < count; i++) {
+        ctx->lines[lines[i]] = (GpioLine_t){ .handle = gpiod_line_bulk_get_line(&bulk_group->bulk, i), .dir = dir, .group = idx };
+    }
+    log_debug("%zu GPIO lines requested as %s (group: %hu)", count, (dir == GPIO_DIR_OUTPUT ? "output" : "input"), idx);
+
+    *group = idx;
+    return GPIO_ERR_OK;
+}
+
+STATIC void gpio_group_release(Gpio_t* ctx, const uint8_t group) {
+    GpioBulkGroup_t* bulk_group = &ctx->groups[group - 1];
+    if(bulk_group->dir == GPIO_DIR_NONE) {
+        return;
+    }
+
+    gpiod_line_release_bulk(&bulk_group->bulk);
+    for(int i = 0; i < GPIO_LINE_COUNT; i++) {
+        if(ctx->lines[i].group == group) {
+            ctx->lines[i] = (GpioLine_t){ .handle = NULL, .dir = GPIO_DIR_NONE, .group = GPIO_GROUP_NONE };
+        }
+    }
+    gpiod_line_bulk_init(&bulk_group->bulk);
+    bulk_group->dir = GPIO_DIR_NONE;
+}
@@ -1,8 +1,16 @@
+#define LOG_MODULE LOG_MODULE_HW
+
 #include "hw/hw_interface.h"
 
+#include <linux/spi/spidev.h> // For: SPI_MODE_x
+
 #include "utils/log.h"
 
-#define I2C_ADAPTER 1 // On RPI the I2C adapter is mounted as '/dev/i2c-1'
+#define I2C_ADAPTER 1         // On RPI the I2C adapter is mounted as '/dev/i2c-1'
+#define SPI_BUS 0             // On RPI the SPI0 devices are mounted as '/dev/spidev0.x'
+#define SPI_CS 0              // Native chip-select used by default ('/dev/spidev0.0')
+#define SPI_SPEED_HZ 10000000 // Default SPI clock (max supported by BME280)
+#define SPI_MODE SPI_MODE_0   // Default SPI mode (clock idle low, data sampled on the rising edge)
 
 HwInterfaceError_t hw_interface_init(HwInterface_t* ctx, const HwInterfaceType_t type) {
     if(!ctx) {
@@ -21,13 +29,29 @@ HwInterfaceError_t hw_interface_init(HwInterface_t* ctx, const HwInterfaceType_t
         break;
     }
     case HW_INTERFACE_SPI: {
-        break;
+        SPIBusConfig_t cfg = { .spi_bus = SPI_BUS, .spi_cs = SPI_CS, .speed_hz = SPI_SPEED_HZ, .mode = SPI_MODE };
+        return hw_interface_init_spi(ctx, cfg);
     }
     }
 
     return HW_INTERFACE_ERR_OK;
 }
 
+HwInterfaceError_t hw_interface_init_spi(HwInterface_t* ctx, const SPIBusConfig_t cfg) {
+    if(!ctx) {
+        return HW_INTERFACE_ERR_NULL_ARGUMENT;
+    }
+    ctx->type = HW_INTERFACE_SPI;
+
+    SPIBusError_t err = spi_bus_init(&ctx->handle.spi, cfg);
+    if(err != SPI_BUS_ERR_OK) {
+        log_error("failed to initialize the spi device (err: %d)", err);
+        return HW_INTERFACE_ERR_INIT_FAILURE;
+    }
+
+    return HW_INTERFACE_ERR_OK;
+}
+
 HwInterfaceError_t
 hw_interface_read(HwInterface_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, uint8_t* buf, const size_t len) {
     if(!ctx || !buf) {
@@ -44,6 +68,11 @@ hw_interface_read(HwInterface_t* ctx, const uint8_t slave_addr, const uint8_t re
         break;
     }
     case HW_INTERFACE_SPI: {
+        SPIBusError_t err = spi_bus_read(&ctx->handle.spi, slave_addr, reg_addr, buf, len);
+        if(err != SPI_BUS_ERR_OK) {
+            log_error("failed to receive data over the spi device (err: %d)", err);
+            return HW_INTERFACE_ERR_TRANSMISSION_FAILURE;
+        }
         break;
     }
     }
@@ -67,6 +96,43 @@ hw_interface_write(HwInterface_t* ctx, const uint8_t slave_addr, const uint8_t r
         break;
     }
     case HW_INTERFACE_SPI: {
+        SPIBusError_t err = spi_bus_write(&ctx->handle.spi, slave_addr, reg_addr, data, len);
+        if(err != SPI_BUS_ERR_OK) {
+            log_error("failed to send data over the spi device (err: %d)", err);
+            return HW_INTERFACE_ERR_TRANSMISSION_FAILURE;
+        }
+        break;
+    }
+    }
+
+    return HW_INTERFACE_ERR_OK;
+}
+
+HwInterfaceError_t
+hw_interface_transfer(HwInterface_t* ctx, const uint8_t slave_addr, const HwInterfaceOp_t* ops, const size_t count) {
+    if(!ctx || !ops) {
+        return HW_INTERFACE_ERR_NULL_ARGUMENT;
+    }
+
+    switch(ctx->type) {
+    case HW_INTERFACE_I2C: {
+        I2CBusError_t err = i2c_bus_transfer(&ctx->handle.i2c, slave_addr, ops, count);
+        if(err == I2C_BUS_ERR_INVALID_ARGUMENT) {
+            return HW_INTERFACE_ERR_INVALID_ARGUMENT;
+        } else if(err != I2C_BUS_ERR_OK) {
+            log_error("failed to perform a transfer over the i2c adapter (err: %d)", err);
+            return HW_INTERFACE_ERR_TRANSMISSION_FAILURE;
+        }
+        break;
+    }
+    case HW_INTERFACE_SPI: {
+        SPIBusError_t err = spi_bus_transfer(&ctx->handle.spi, slave_addr, ops, count);
+        if(err == SPI_BUS_ERR_INVALID_ARGUMENT) {
+            return HW_INTERFACE_ERR_INVALID_ARGUMENT;
+        } else if(err != SPI_BUS_ERR_OK) {
+            log_error("failed to perform a transfer over the spi device (err: %d)", err);
+            return HW_INTERFACE_ERR_TRANSMISSION_FAILURE;
+        }
         break;
     }
     }
@@ -89,6 +155,11 @@ HwInterfaceError_t hw_interface_deinit(HwInterface_t* ctx) {
         break;
     }
     case HW_INTERFACE_SPI: {
+        SPIBusError_t err = spi_bus_deinit(&ctx->handle.spi);
+        if(err != SPI_BUS_ERR_OK) {
+            log_error("failed to deinitialize the spi device (err: %d)", err);
+            return HW_INTERFACE_ERR_DEINIT_FAILURE;
+        }
         break;
     }
     }
@@ -1,3 +1,5 @@
+#define LOG_MODULE LOG_MODULE_HW
+
 #include "hw/i2c_bus.h"
 
 #include <errno.h>         // For: errno
@@ -10,9 +12,48 @@
 #include <sys/ioctl.h>     // For: ioctl() and related macros
 #include <unistd.h>        // For: read(), write(), close()
 
+#include "utils/common.h"
 #include "utils/log.h"
+#include "utils/metrics.h"
 
 #define I2C_DEV_MAX_PATH_LENGTH 20 // Maximum length of the I2C device file path (e.g. "/dev/i2c-1")
+#define I2C_BUS_TRANSFER_MAX_MSGS (2 * I2C_BUS_TRANSFER_MAX_OPS) // Every read takes two messages (reg addr + data)
+
+/**
+ * @brief Set the address of the slave device used by the plain write() path (skipped if already set).
+ * @note Must be called with the bus lock held.
+ *
+ * @param[in, out] ctx Pointer to the I2CBus_t instance.
+ * @param[in] slave_addr Address of the slave device (7 lower bits)
+ * @return I2C_BUS_ERR_OK on success, I2C_BUS_ERR_I2CDEV_FAILURE otherwise.
+ */
+STATIC I2CBusError_t i2c_bus_set_slave(I2CBus_t* ctx, const uint8_t slave_addr);
+
+/**
+ * @brief Pack a list of register operations into i2c_msg entries for a single I2C_RDWR transaction.
+ *
+ * @param[in] slave_addr Address of the slave device (7 lower bits)
+ * @param[in] ops Operations to be packed.
+ * @param[in] count Number of operations (at most I2C_BUS_TRANSFER_MAX_OPS).
+ * @param[out] msgs Array of at least I2C_BUS_TRANSFER_MAX_MSGS messages to be filled in.
+ * @param[out] scratch Buffer of I2C_BUS_TRANSFER_MAX_OPS + I2C_BUS_TRANSFER_MAX_WRITE_LEN bytes holding the register
+ * addresses and the written data (must outlive the transaction).
+ * @return Number of packed messages on success, 0 if the operations do not fit into a single transaction.
+ */
+STATIC size_t i2c_bus_pack_transfer(const uint8_t slave_addr,
+const I2CBusOp_t* ops,
+const size_t count,
+struct i2c_msg* msgs,
+uint8_t* scratch);
+
+// Record a finished transaction in the metrics (count, failures and the duration since start_ns)
+static void i2c_bus_record(const uint64_t start_ns, const I2CBusError_t err) {
+    metrics_add(METRICS_I2C_TRANSACTIONS, 1);
+    if(err != I2C_BUS_ERR_OK) {
+        metrics_add(METRICS_I2C_FAILURES, 1);
+    }
+    metrics_observe(METRICS_HIST_I2C_LATENCY, start_ns);
+}
 
 I2CBusError_t i2c_bus_init(I2CBus_t* ctx, const I2CBusConfig_t cfg) {
     if(!ctx) {
@@ -41,6 +82,7 @@ I2CBusError_t i2c_bus_init(I2CBus_t* ctx, const I2CBusConfig_t cfg) {
     // Populate data in the context struct (cfg, fd)
     ctx->fd = fd;
     ctx->cfg = cfg;
+    ctx->slave_addr = I2C_BUS_NO_SLAVE_ADDR;
 
     return I2C_BUS_ERR_OK;
 }
@@ -53,42 +95,38 @@ I2CBusError_t i2c_bus_read(I2CBus_t* ctx, const uint8_t slave_addr, const uint8_
     I2CBusError_t err = I2C_BUS_ERR_OK;
 
     // Accessing shared peripheral (critical section)
-    int ret_p = pthread_mutex_lock(&ctx->lock);
+    int ret_p = metrics_mutex_lock(&ctx->lock, METRICS_HIST_LOCK_I2C);
     if(ret_p != 0) {
         log_error("pthread_mutex_lock() returned %d", ret_p);
         return I2C_BUS_ERR_PTHREAD_FAILURE;
     }
     log_debug("I2C lock taken");
 
-    // Set the address of the I2C slave device
-    int ret_i = ioctl(ctx->fd, I2C_SLAVE, slave_addr);
-    if(ret_i < 0) {
-        log_error("ioctl() returned: %d (err: %s)", ret_i, strerror(errno));
-        err = I2C_BUS_ERR_I2CDEV_FAILURE;
-    } else {
-        // Prepare data to be sent (ioctl used instead of write() to support burst read requests)
-        struct i2c_msg msg[2]; // Do not change to dynamic allocation
+    // Prepare data to be sent (ioctl used instead of write() to support burst read requests)
+    // The slave address is carried by every message, so no I2C_SLAVE ioctl is needed
+    struct i2c_msg msg[2]; // Do not change to dynamic allocation
 
-        // First message: Address of the register from which data will be read
-        uint8_t addr = reg_addr;
-        struct i2c_msg specify_reg = { .addr = slave_addr, .buf = &addr, .flags = 0, .len = sizeof(reg_addr) };
-        msg[0] = specify_reg;
+    // First message: Address of the register from which data will be read
+    uint8_t addr = reg_addr;
+    struct i2c_msg specify_reg = { .addr = slave_addr, .buf = &addr, .flags = 0, .len = sizeof(reg_addr) };
+    msg[0] = specify_reg;
 
-        // Second message: Read 'len' bytes from the selected register
-        struct i2c_msg read = { .addr = slave_addr, .buf = buf, .flags = I2C_M_RD, .len = len };
-        msg[1] = read;
+    // Second message: Read 'len' bytes from the selected register
+    struct i2c_msg read = { .addr = slave_addr, .buf = buf, .flags = I2C_M_RD, .len = len };
+    msg[1] = read;
 
-        // Pack messages
-        struct i2c_rdwr_ioctl_data packet = { .msgs = msg, .nmsgs = (sizeof(msg) / sizeof(msg[0])) };
+    // Pack messages
+    struct i2c_rdwr_ioctl_data packet = { .msgs = msg, .nmsgs = (sizeof(msg) / sizeof(msg[0])) };
 
-        // Perform combined write/read transaction
-        if(ioctl(ctx->fd, I2C_RDWR, &packet) < 0) {
-            log_error("failed to read data (dev:0x%02X, reg:0x%02X, err: %s)", slave_addr, reg_addr, strerror(errno));
-            err = I2C_BUS_ERR_I2CDEV_FAILURE;
-        } else {
-            log_debug("read %zu bytes (dev:0x%02X, reg:0x%02X)", len, slave_addr, reg_addr);
-        }
+    // Perform combined write/read transaction
+    uint64_t start_ns = metrics_now_ns();
+    if(ioctl(ctx->fd, I2C_RDWR, &packet) < 0) {
+        log_error("failed to read data (dev:0x%02X, reg:0x%02X, err: %s)", slave_addr, reg_addr, strerror(errno));
+        err = I2C_BUS_ERR_I2CDEV_FAILURE;
+    } else {
+        log_debug("read %zu bytes (dev:0x%02X, reg:0x%02X)", len, slave_addr, reg_addr);
     }
+    i2c_bus_record(start_ns, err);
 
     ret_p = pthread_mutex_unlock(&ctx->lock);
     if(ret_p != 0) {
@@ -109,19 +147,17 @@ i2c_bus_write(I2CBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, c
     I2CBusError_t err = I2C_BUS_ERR_OK;
 
     // Accessing shared peripheral (critical section)
-    int ret_p = pthread_mutex_lock(&ctx->lock);
+    int ret_p = metrics_mutex_lock(&ctx->lock, METRICS_HIST_LOCK_I2C);
     if(ret_p != 0) {
         log_error("pthread_mutex_lock() returned %d", ret_p);
         return I2C_BUS_ERR_PTHREAD_FAILURE;
     }
     log_debug("I2C lock taken");
 
-    // Set the address of the I2C slave device
-    int ret_i = ioctl(ctx->fd, I2C_SLAVE, slave_addr);
-    if(ret_i < 0) {
-        log_error("ioctl() returned: %d (err: %s)", ret_i, strerror(errno));
-        err = I2C_BUS_ERR_I2CDEV_FAILURE;
-    } else {
+    // Set the address of the I2C slave device (skipped if unchanged since the last write)
+    uint64_t start_ns = metrics_now_ns();
+    err = i2c_bus_set_slave(ctx, slave_addr);
+    if(err == I2C_BUS_ERR_OK) {
         // Perform an atomic write of register address and actual data
         uint8_t buf[data_len + 1]; // @TODO: replace VLA (gcc feature only; dynamic mem alloc!) with a normal array
         buf[0] = reg_addr;         // Specify register address (first byte sent over I2C)
@@ -134,6 +170,52 @@ i2c_bus_write(I2CBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, c
             log_debug("wrote %zu bytes (dev:0x%02X, reg:0x%02X)", data_len, slave_addr, reg_addr);
         }
     }
+    i2c_bus_record(start_ns, err);
+
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        return I2C_BUS_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("I2C lock released");
+
+    return err;
+}
+
+I2CBusError_t i2c_bus_transfer(I2CBus_t* ctx, const uint8_t slave_addr, const I2CBusOp_t* ops, const size_t count) {
+    if(!ctx || !ops) {
+        return I2C_BUS_ERR_NULL_ARGUMENT;
+    }
+
+    // Pack all operations before taking the lock (nothing is sent if they do not fit into one transaction)
+    struct i2c_msg msgs[I2C_BUS_TRANSFER_MAX_MSGS];                          // Do not change to dynamic allocation
+    uint8_t scratch[I2C_BUS_TRANSFER_MAX_OPS + I2C_BUS_TRANSFER_MAX_WRITE_LEN]; // Register addresses + written data
+    size_t nmsgs = i2c_bus_pack_transfer(slave_addr, ops, count, msgs, scratch);
+    if(nmsgs == 0) {
+        log_error("invalid transfer (dev:0x%02X, ops: %zu)", slave_addr, count);
+        return I2C_BUS_ERR_INVALID_ARGUMENT;
+    }
+    struct i2c_rdwr_ioctl_data packet = { .msgs = msgs, .nmsgs = nmsgs };
+
+    I2CBusError_t err = I2C_BUS_ERR_OK;
+
+    // Accessing shared peripheral (critical section)
+    int ret_p = metrics_mutex_lock(&ctx->lock, METRICS_HIST_LOCK_I2C);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return I2C_BUS_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("I2C lock taken");
+
+    // Perform all operations in a single combined transaction
+    uint64_t start_ns = metrics_now_ns();
+    if(ioctl(ctx->fd, I2C_RDWR, &packet) < 0) {
+        log_error("failed to perform transfer (dev:0x%02X, ops: %zu, err: %s)", slave_addr, count, strerror(errno));
+        err = I2C_BUS_ERR_I2CDEV_FAILURE;
+    } else {
+        log_debug("performed %zu operations in %zu messages (dev:0x%02X)", count, nmsgs, slave_addr);
+    }
+    i2c_bus_record(start_ns, err);
 
     ret_p = pthread_mutex_unlock(&ctx->lock);
     if(ret_p != 0) {
@@ -178,4 +260,60 @@ I2CBusError_t i2c_bus_deinit(I2CBus_t* ctx) {
     memset(ctx, 0, sizeof(I2CBus_t));
 
     return err;
-}
\ No newline at end of file
+}
+
+STATIC I2CBusError_t i2c_bus_set_slave(I2CBus_t* ctx, const uint8_t slave_addr) {
+    if(ctx->slave_addr == slave_addr) {
+        return I2C_BUS_ERR_OK;
+    }
+
+    int ret = ioctl(ctx->fd, I2C_SLAVE, slave_addr);
+    if(ret < 0) {
+        log_error("ioctl() returned: %d (err: %s)", ret, strerror(errno));
+        ctx->slave_addr = I2C_BUS_NO_SLAVE_ADDR; // The address set on the fd is unknown now
+        return I2C_BUS_ERR_I2CDEV_FAILURE;
+    }
+    ctx->slave_addr = slave_addr;
+
+    return I2C_BUS_ERR_OK;
+}
+
+STATIC size_t i2c_bus_pack_transfer(const uint8_t slave_addr,
+const I2CBusOp_t* ops,
+const size_t count,
+struct i2c_msg* msgs,
+uint8_t* scratch) {
+    if(count == 0 || count > I2C_BUS_TRANSFER_MAX_OPS) {
+        return 0;
+    }
+
+    size_t nmsgs = 0;
+    size_t written = 0; // Data bytes copied to the scratch buffer so far
+    for(size_t i = 0; i < count; ++i) {
+        if(!ops[i].buf || ops[i].len == 0) {
+            return 0;
+        }
+
+        if(ops[i].type == I2C_BUS_OP_READ) {
+            // Register address message followed by the read (repeated start)
+            *scratch = ops[i].reg_addr;
+            msgs[nmsgs++] = (struct i2c_msg){ .addr = slave_addr, .buf = scratch, .flags = 0, .len = 1 };
+            msgs[nmsgs++] = (struct i2c_msg){ .addr = slave_addr, .buf = ops[i].buf, .flags = I2C_M_RD, .len = ops[i].len };
+            scratch += 1;
+        } else if(ops[i].type == I2C_BUS_OP_WRITE) {
+            // Register address and the data have to be sent in one message (consecutive bytes)
+            if(ops[i].len > I2C_BUS_TRANSFER_MAX_WRITE_LEN - written) {
+                return 0;
+            }
+            scratch[0] = ops[i].reg_addr;
+            memcpy(&scratch[1], ops[i].buf, ops[i].len);
+            msgs[nmsgs++] = (struct i2c_msg){ .addr = slave_addr, .buf = scratch, .flags = 0, .len = ops[i].len + 1 };
+            scratch += ops[i].len + 1;
+            written += ops[i].len;
+        } else {
+            return 0;
+        }
+    }
+
+    return nmsgs;
+}
@@ -0,0 +1,289 @@
+#define LOG_MODULE LOG_MODULE_HW
+
+#include "hw/spi_bus.h"
+
+#include <errno.h>            // For: errno
+#include <fcntl.h>            // For: open() and related macros
+#include <linux/spi/spidev.h> // For: SPI related structs and macros
+#include <pthread.h>          // For: pthread_mutex_t
+#include <stdint.h>           // For: uintptr_t
+#include <stdio.h>            // For: snprintf()
+#include <string.h>           // For: memset(), memcpy()
+#include <sys/ioctl.h>        // For: ioctl() and related macros
+#include <unistd.h>           // For: close()
+
+#include "utils/common.h"
+#include "utils/log.h"
+#include "utils/metrics.h"
+
+#define SPI_DEV_MAX_PATH_LENGTH 24 // Maximum length of the SPI device file path (e.g. "/dev/spidev0.0")
+#define SPI_BUS_TRANSFER_MAX_XFERS (2 * SPI_BUS_TRANSFER_MAX_OPS) // Every read takes two transfers (reg addr + data)
+#define SPI_BUS_BITS_PER_WORD 8                                   // Word size used for all transfers
+#define SPI_BUS_CS_ACTIVE 0                                       // Level of the GPIO chip-select selecting the device
+#define SPI_BUS_CS_INACTIVE 1                                     // Level of the GPIO chip-select releasing the device
+
+/**
+ * @brief Pack a list of register operations into spi_ioc_transfer entries for a single SPI_IOC_MESSAGE.
+ * @note The native chip-select is released between the operations (cs_change set on the last entry of every
+ * operation but the final one).
+ *
+ * @param[in] speed_hz Clock frequency of the transfers.
+ * @param[in] ops Operations to be packed.
+ * @param[in] count Number of operations (at most SPI_BUS_TRANSFER_MAX_OPS).
+ * @param[out] xfers Array of at least SPI_BUS_TRANSFER_MAX_XFERS entries to be filled in.
+ * @param[out] scratch Buffer of SPI_BUS_TRANSFER_MAX_OPS + SPI_BUS_TRANSFER_MAX_WRITE_LEN bytes holding the register
+ * addresses and the written data (must outlive the transaction).
+ * @return Number of packed entries on success, 0 if the operations do not fit into a single message.
+ */
+STATIC size_t spi_bus_pack_transfer(const uint32_t speed_hz,
+const SPIBusOp_t* ops,
+const size_t count,
+struct spi_ioc_transfer* xfers,
+uint8_t* scratch);
+
+/**
+ * @brief Send packed operations one by one, each framed by the GPIO chip-select line of the device.
+ * @note Must be called with the bus lock held.
+ *
+ * @param[in] ctx Pointer to the SPIBus_t instance.
+ * @param[in] cs_line GPIO line driving the chip-select of the device.
+ * @param[in] ops Operations the entries have been packed from.
+ * @param[in] count Number of operations.
+ * @param[in] xfers Entries packed by spi_bus_pack_transfer().
+ * @return SPI_BUS_ERR_OK on success, SPI_BUS_ERR_SPIDEV_FAILURE or SPI_BUS_ERR_GPIO_FAILURE otherwise.
+ */
+STATIC SPIBusError_t spi_bus_transfer_gpio_cs(SPIBus_t* ctx,
+const uint8_t cs_line,
+const SPIBusOp_t* ops,
+const size_t count,
+struct spi_ioc_transfer* xfers);
+
+SPIBusError_t spi_bus_init(SPIBus_t* ctx, const SPIBusConfig_t cfg) {
+    if(!ctx) {
+        return SPI_BUS_ERR_NULL_ARGUMENT;
+    } else if((cfg.mode & ~(SPI_CPOL | SPI_CPHA)) != 0 || cfg.speed_hz == 0) {
+        return SPI_BUS_ERR_INVALID_ARGUMENT;
+    }
+
+    // Zero-out the SPIBus_t struct on init
+    memset(ctx, 0, sizeof(SPIBus_t));
+
+    // Open the spidev device file
+    char filename[SPI_DEV_MAX_PATH_LENGTH + 1];
+    snprintf(filename, SPI_DEV_MAX_PATH_LENGTH, "/dev/spidev%d.%d", cfg.spi_bus, cfg.spi_cs);
+    int fd = open(filename, O_RDWR);
+    if(fd < 0) {
+        log_error("open() returned: %d (err: %s)", fd, strerror(errno));
+        return SPI_BUS_ERR_SPIDEV_FAILURE;
+    }
+
+    // Set up the mode (the native chip-select stays idle if the CS lines are driven with GPIO), word size and clock
+    uint8_t mode = cfg.mode | (cfg.cs_gpio ? SPI_NO_CS : 0);
+    uint8_t bits = SPI_BUS_BITS_PER_WORD;
+    uint32_t speed = cfg.speed_hz;
+    if(ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 || ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+    ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+        log_error("failed to configure %s (mode: %u, speed: %u Hz, err: %s)", filename, mode, speed, strerror(errno));
+        close(fd);
+        return SPI_BUS_ERR_SPIDEV_FAILURE;
+    }
+
+    // Initialize mutex for protecting access to the spi
+    int err = pthread_mutex_init(&ctx->lock, NULL);
+    if(err != 0) {
+        log_error("pthread_mutex_init() returned %d", err);
+        close(fd);
+        return SPI_BUS_ERR_PTHREAD_FAILURE;
+    }
+
+    // Populate data in the context struct (cfg, fd)
+    ctx->fd = fd;
+    ctx->cfg = cfg;
+
+    log_debug("%s initialized (mode: %u, speed: %u Hz, cs: %s)", filename, cfg.mode, cfg.speed_hz,
+    cfg.cs_gpio ? "gpio" : "native");
+    return SPI_BUS_ERR_OK;
+}
+
+SPIBusError_t spi_bus_read(SPIBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, uint8_t* buf, const size_t len) {
+    if(!ctx || !buf) {
+        return SPI_BUS_ERR_NULL_ARGUMENT;
+    }
+
+    // Register address and the data clocked in within a single chip-select frame
+    SPIBusOp_t op = { .type = SPI_BUS_OP_READ, .reg_addr = reg_addr, .buf = buf, .len = len };
+    return spi_bus_transfer(ctx, slave_addr, &op, 1);
+}
+
+SPIBusError_t
+spi_bus_write(SPIBus_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, const uint8_t* data, const size_t len) {
+    if(!ctx || !data) {
+        return SPI_BUS_ERR_NULL_ARGUMENT;
+    }
+
+    // The data is copied by the packing, so it is never written to
+    SPIBusOp_t op = { .type = SPI_BUS_OP_WRITE, .reg_addr = reg_addr, .buf = (uint8_t*)data, .len = len };
+    return spi_bus_transfer(ctx, slave_addr, &op, 1);
+}
+
+SPIBusError_t spi_bus_transfer(SPIBus_t* ctx, const uint8_t slave_addr, const SPIBusOp_t* ops, const size_t count) {
+    if(!ctx || !ops) {
+        return SPI_BUS_ERR_NULL_ARGUMENT;
+    }
+
+    // Pack all operations before taking the lock (nothing is sent if they do not fit into one message)
+    struct spi_ioc_transfer xfers[SPI_BUS_TRANSFER_MAX_XFERS];                // Do not change to dynamic allocation
+    uint8_t scratch[SPI_BUS_TRANSFER_MAX_OPS + SPI_BUS_TRANSFER_MAX_WRITE_LEN]; // Register addresses + written data
+    size_t nxfers = spi_bus_pack_transfer(ctx->cfg.speed_hz, ops, count, xfers, scratch);
+    if(nxfers == 0) {
+        log_error("invalid transfer (dev:0x%02X, ops: %zu)", slave_addr, count);
+        return SPI_BUS_ERR_INVALID_ARGUMENT;
+    }
+
+    SPIBusError_t err = SPI_BUS_ERR_OK;
+
+    // Accessing shared peripheral (critical section)
+    int ret_p = metrics_mutex_lock(&ctx->lock, METRICS_HIST_LOCK_SPI);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret_p);
+        return SPI_BUS_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("SPI lock taken");
+
+    // Native chip-select: all operations in a single burst (CS toggled by the controller between the operations)
+    // GPIO chip-select: one message per operation, framed by the CS line
+    if(ctx->cfg.cs_gpio) {
+        err = spi_bus_transfer_gpio_cs(ctx, slave_addr, ops, count, xfers);
+    } else if(ioctl(ctx->fd, SPI_IOC_MESSAGE(nxfers), xfers) < 0) {
+        log_error("failed to perform transfer (ops: %zu, err: %s)", count, strerror(errno));
+        err = SPI_BUS_ERR_SPIDEV_FAILURE;
+    }
+    if(err == SPI_BUS_ERR_OK) {
+        log_debug("performed %zu operations in %zu transfers (dev:0x%02X)", count, nxfers, slave_addr);
+    }
+
+    ret_p = pthread_mutex_unlock(&ctx->lock);
+    if(ret_p != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret_p);
+        return SPI_BUS_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("SPI lock released");
+
+    return err;
+}
+
+SPIBusError_t spi_bus_deinit(SPIBus_t* ctx) {
+    if(!ctx) {
+        return SPI_BUS_ERR_NULL_ARGUMENT;
+    }
+
+    SPIBusError_t err = SPI_BUS_ERR_OK;
+
+    // Deinit the SPI Bus (critical section)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SPI_BUS_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("SPI lock taken");
+
+    // Close the spidev device file
+    ret = close(ctx->fd);
+    if(ret < 0) {
+        log_error("close() returned: %d (err: %s)", ret, strerror(errno));
+        err = SPI_BUS_ERR_SPIDEV_FAILURE;
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SPI_BUS_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("SPI lock released");
+
+    // Zero-out the SPIBus_t struct on deinit
+    memset(ctx, 0, sizeof(SPIBus_t));
+
+    return err;
+}
+
+STATIC size_t spi_bus_pack_transfer(const uint32_t speed_hz,
+const SPIBusOp_t* ops,
+const size_t count,
+struct spi_ioc_transfer* xfers,
+uint8_t* scratch) {
+    if(count == 0 || count > SPI_BUS_TRANSFER_MAX_OPS) {
+        return 0;
+    }
+
+    size_t nxfers = 0;
+    size_t written = 0; // Data bytes copied to the scratch buffer so far
+    for(size_t i = 0; i < count; ++i) {
+        if(!ops[i].buf || ops[i].len == 0) {
+            return 0;
+        }
+
+        if(ops[i].type == SPI_BUS_OP_READ) {
+            // Register address sent first, followed by the data clocked into the caller's buffer (zeros sent)
+            *scratch = ops[i].reg_addr | SPI_BUS_READ_FLAG;
+            xfers[nxfers++] = (struct spi_ioc_transfer){ .tx_buf = (uintptr_t)scratch, .len = 1 };
+            xfers[nxfers++] = (struct spi_ioc_transfer){ .rx_buf = (uintptr_t)ops[i].buf, .len = ops[i].len };
+            scratch += 1;
+        } else if(ops[i].type == SPI_BUS_OP_WRITE) {
+            // Register address and the data sent in one transfer (consecutive bytes)
+            if(ops[i].len > SPI_BUS_TRANSFER_MAX_WRITE_LEN - written) {
+                return 0;
+            }
+            scratch[0] = ops[i].reg_addr & SPI_BUS_WRITE_MASK;
+            memcpy(&scratch[1], ops[i].buf, ops[i].len);
+            xfers[nxfers++] = (struct spi_ioc_transfer){ .tx_buf = (uintptr_t)scratch, .len = ops[i].len + 1 };
+            scratch += ops[i].len + 1;
+            written += ops[i].len;
+        } else {
+            return 0;
+        }
+
+        // Release the chip-select after every operation but the last one (each access is a separate frame)
+        xfers[nxfers - 1].cs_change = (i + 1 < count) ? 1 : 0;
+    }
+
+    for(size_t i = 0; i < nxfers; ++i) {
+        xfers[i].speed_hz = speed_hz;
+        xfers[i].bits_per_word = SPI_BUS_BITS_PER_WORD;
+    }
+
+    return nxfers;
+}
+
+STATIC SPIBusError_t spi_bus_transfer_gpio_cs(SPIBus_t* ctx,
+const uint8_t cs_line,
+const SPIBusOp_t* ops,
+const size_t count,
+struct spi_ioc_transfer* xfers) {
+    size_t first = 0; // First entry of the current operation
+    for(size_t i = 0; i < count; ++i) {
+        size_t nxfers = (ops[i].type == SPI_BUS_OP_READ) ? 2 : 1;
+
+        GpioError_t err_g = gpio_set(ctx->cfg.cs_gpio, cs_line, SPI_BUS_CS_ACTIVE);
+        if(err_g != GPIO_ERR_OK) {
+            log_error("failed to select the device (cs: %u, err: %d)", cs_line, err_g);
+            return SPI_BUS_ERR_GPIO_FAILURE;
+        }
+
+        int ret = ioctl(ctx->fd, SPI_IOC_MESSAGE(nxfers), &xfers[first]);
+        int ioctl_errno = errno;
+
+        // Always release the device (also on failure, so that the next frame starts with a falling edge)
+        err_g = gpio_set(ctx->cfg.cs_gpio, cs_line, SPI_BUS_CS_INACTIVE);
+        if(ret < 0) {
+            log_error("failed to perform transfer (cs: %u, op: %zu, err: %s)", cs_line, i, strerror(ioctl_errno));
+            return SPI_BUS_ERR_SPIDEV_FAILURE;
+        } else if(err_g != GPIO_ERR_OK) {
+            log_error("failed to release the device (cs: %u, err: %d)", cs_line, err_g);
+            return SPI_BUS_ERR_GPIO_FAILURE;
+        }
+        first += nxfers;
+    }
+
+    return SPI_BUS_ERR_OK;
+}
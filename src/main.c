@@ -1,11 +1,15 @@
 #include <signal.h>            // for: sig_atomic_t
+#include <stdbool.h>           // for: bool
+#include <stdint.h>            // for: uint64_t
 #include <stdio.h>             // for: setvbuf
+#include <stdlib.h>            // for: getenv()
 #include <systemd/sd-daemon.h> // for: systemd notifications
-#include <unistd.h>            // for: sleep()
+#include <unistd.h>            // for: usleep()
 
 #include "app/app.h"
 #include "utils/config.h"
 #include "utils/log.h"
+#include "utils/metrics.h"
 
 volatile sig_atomic_t sig_status = 0;
 
@@ -16,9 +20,26 @@ static void catch_function(int signo) {
 int main() {
     setvbuf(stdout, NULL, _IONBF, 0); // Disable stdout buffering completely
 
-    // Set the signal handler for SIGINT
-    if(signal(SIGINT, catch_function) == SIG_ERR) {
-        log_error("failed to set the SIGINT signal handler");
+    // Start the logging backend (lines logged before are written synchronously)
+    if(log_init(APP_LOG_MODE) != LOG_ERR_OK) {
+        log_error("failed to initialize the asynchronous logging, logging synchronously");
+    }
+
+    // Apply the runtime log filter (if provided)
+    const char* log_filter = getenv(APP_LOG_FILTER_ENV);
+    if(log_filter && log_configure(log_filter) != LOG_ERR_OK) {
+        log_error("invalid log filter in %s: '%s' (ignored)", APP_LOG_FILTER_ENV, log_filter);
+    }
+
+    // Start recording the metrics (before any recording thread is started)
+    if(metrics_init() != METRICS_ERR_OK) {
+        log_error("failed to initialize the metrics registry, running without metrics");
+    }
+
+    // Set the signal handler for SIGINT and SIGTERM (sent by systemd on stop/restart)
+    if(signal(SIGINT, catch_function) == SIG_ERR || signal(SIGTERM, catch_function) == SIG_ERR) {
+        log_error("failed to set the SIGINT/SIGTERM signal handlers");
+        log_deinit();
         return EXIT_FAILURE;
     }
 
@@ -28,6 +49,7 @@ int main() {
     AppError_t err = app_init();
     if(err != APP_ERR_OK) {
         log_error("app_init failed (ret: %d)", err);
+        log_deinit();
         return EXIT_FAILURE;
     }
     log_info("App controller initialized");
@@ -36,33 +58,61 @@ int main() {
     err = app_run();
     if(err != APP_ERR_OK) {
         log_error("app_run failed (ret: %d)", err);
+        log_deinit();
         return EXIT_FAILURE;
     }
     log_info("App controller running...");
 
     // Notify systemd that the service is ready
-    sd_notify(0, "READY=1");
+    sd_notify(0, "READY=1\nSTATUS=Serving clients");
+
+    // Ping the systemd watchdog (if enabled with WatchdogSec=) twice per its timeout
+    uint64_t watchdog_usec = 0;
+    if(sd_watchdog_enabled(0, &watchdog_usec) <= 0) {
+        watchdog_usec = 0;
+    }
+    uint32_t watchdog_ticks = watchdog_usec / 2 / (APP_MAIN_LOOP_TICK_MS * 1000);
+    if(watchdog_usec != 0) {
+        log_info("systemd watchdog enabled (timeout: %lu ms)", (unsigned long)(watchdog_usec / 1000));
+    }
+    uint32_t tick = 0;
+    bool healthy = true;
 
     while(1) {
-        // Enter an infinite empty loop once the app controller and the server is started
-        sleep(1);
+        // Run the main loop once the app controller and the server is started
+        usleep(APP_MAIN_LOOP_TICK_MS * 1000);
+
+        // Restart the failed subsystems (if any) and report the state to systemd
+        bool poll_ok = (app_poll() == APP_ERR_OK);
+        if(poll_ok != healthy) {
+            healthy = poll_ok;
+            sd_notify(0, healthy ? "STATUS=Serving clients" : "STATUS=Restarting the network subsystem");
+        }
+        if(watchdog_usec != 0 && ++tick >= watchdog_ticks) {
+            sd_notify(0, "WATCHDOG=1");
+            tick = 0;
+        }
 
         // Regularly check for SIGINT and SIGTERM signals to shut down the daemon and exit cleanly
         if(sig_status == SIGINT || sig_status == SIGTERM) {
             sd_notify(0, "STOPPING=1"); // Notify systemd that the service will be stopped
 
-            err = app_stop(); // Stop the app controller
-            if(err != APP_ERR_OK) {
+            err = app_stop(); // Stop the app controller (not running only if the server restart has failed)
+            if(err != APP_ERR_OK && err != APP_ERR_NOT_STARTED) {
                 log_error("app_stop failed (err: %d)", err);
+                log_deinit();
                 return EXIT_FAILURE;
             }
 
             err = app_deinit(); // Deinit the controller
             if(err != APP_ERR_OK) {
                 log_error("app_deinit failed (err: %d)", err);
+                log_deinit();
                 return EXIT_FAILURE;
             }
 
+            metrics_deinit(); // All recording threads are stopped at this point
+            log_deinit();     // Flush the buffered logs
             return EXIT_SUCCESS; // Exit
         }
     }
@@ -1,6 +1,9 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
+
 #include "sensors/bme280.h"
 
 #include <string.h> // For: memset
+#include <time.h>   // For: clock_gettime
 #include <unistd.h> // For: usleep
 
 #include "sensors/bme280_regs.h"
@@ -12,31 +15,46 @@
 #define BME280_TEMP_SCALE 100.0f            // Temperature scale from x100 *C to *C
 #define BME280_PRESS_SCALE 256.0f           // Pressure scale from Q24.8 to float
 #define BME280_HUM_SCALE 1024.0f            // Humidity scale from Q22.10 format to percents
-#define BME280_STANDBY BME280_STANDBY_20_MS // Standby (inactivity) period hex value
-#define BME280_RESET_DELAY_MS 20            // Delay after each reset
-
-typedef int32_t Bme280_s32_t;
-typedef uint32_t Bme280_u32_t;
-typedef int64_t Bme280_s64_t;
+#define BME280_SOFT_RESET 0xB6              // Value written to the reset reg to trigger the power-on-reset procedure
+#define BME280_SAMPLER_IDLE_MS 100          // Wake-up period of the sampler while the profile samples on demand
+#define BME280_STATUS_POLL_US 500           // Status reg polling period while waiting for a forced measurement
 
-/**
- * @struct Bme280_temp_t
- * @brief Temperature output which includes temperature in degrees Celsius (x100) as well as fine temp value (for pressure and hum calculations)
- */
-typedef struct {
-    Bme280_s32_t deg_C; // Temperature in x100 *C [resolution: 0.01 DegC, output value of “5123” equals 51.23 *C]
-    Bme280_s32_t fine; // Fine temperature value for press and hum compensation calc
-} Bme280_temp_t;
+static const uint8_t BME280_I2C_ADDRS[] = { 0x76, 0x77 }; // Both addresses selectable via the SDO pin
 
 /**
- * @struct Bme280_output_t
- * @brief Include compensated and converted temperature, pressure and humidity
+ * @struct Bme280ProfileCfg_t
+ * @brief Register settings and timings of a measurement profile
  */
 typedef struct {
-    Bme280_s32_t t; // Temperature in deg. C with 0.01 DegC resolution (e.g. 5123/100 = 51.23 DegC.)
-    Bme280_u32_t p; // Pressure in Q24.8 format (e.g. 24674867/256 = 96386.2 Pa = 963.862 hPa)
-    Bme280_u32_t h; // Humidity in Q22.10 format (e.g. 47445/1024 = 46.333 %RH)
-} Bme280_output_t;
+    uint8_t osrs;               // Oversampling of all measurements (temp, press and hum)
+    uint8_t mode;               // Normal mode (continuous measurements) or forced mode (one measurement per readout)
+    uint8_t t_sb;               // Standby period between the measurements in normal mode
+    uint32_t sampler_period_ms; // Background sampling period (0: sampled on demand only)
+    uint32_t meas_typ_us;       // Typical measurement time (datasheet, section 9.1)
+    uint32_t meas_max_us;       // Max measurement time (datasheet, section 9.1)
+} Bme280ProfileCfg_t;
+
+// Settings of the measurement profiles (indexed by SensorProfile_t)
+static const Bme280ProfileCfg_t BME280_PROFILES[SENSOR_PROFILE_COUNT] = {
+    [SENSOR_PROFILE_HIGH_PRECISION] = { .osrs = BME280_OSRS_MAX_OVERSAMPLING,
+        .mode = BME280_NORMAL_MODE,
+        .t_sb = BME280_STANDBY_20_MS,
+        .sampler_period_ms = 20,
+        .meas_typ_us = 98000,
+        .meas_max_us = 112800 },
+    [SENSOR_PROFILE_LOW_LATENCY] = { .osrs = BME280_OSRS_NO_OVERSAMPLING,
+        .mode = BME280_NORMAL_MODE,
+        .t_sb = BME280_STANDBY_0_5_MS,
+        .sampler_period_ms = 10,
+        .meas_typ_us = 8000,
+        .meas_max_us = 9300 },
+    [SENSOR_PROFILE_WEATHER_STATION] = { .osrs = BME280_OSRS_NO_OVERSAMPLING,
+        .mode = BME280_FORCED_MODE,
+        .t_sb = BME280_STANDBY_0_5_MS,
+        .sampler_period_ms = 0,
+        .meas_typ_us = 8000,
+        .meas_max_us = 9300 },
+};
 
 /**
  * @brief Read and compensate measurement data from the BME280 sensor.
@@ -47,6 +65,68 @@ typedef struct {
  */
 STATIC SensorError_t bme280_data_readout(Bme280_t* ctx, Bme280_output_t* out);
 
+/**
+ * @brief Get compensated measurement data (from the sampler's cache if fresh enough, from the sensor otherwise).
+ *
+ * @param[in] ctx Pointer to initialized BME280 sensor instance.
+ * @param[out] out Pointer to structure to hold compensated output data.
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_HW_INTERFACE_FAILURE / SENSOR_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC SensorError_t bme280_get_output(Bme280_t* ctx, Bme280_output_t* out);
+
+/**
+ * @brief Get compensated measurement data in forced mode (from the cache if fresh enough, from a new measurement otherwise)
+ * @note The measurement is taken under the sampler's lock, so concurrent readouts share a single measurement
+ *
+ * @param[in] ctx Pointer to initialized BME280 sensor instance.
+ * @param[in] cfg Settings of the active profile
+ * @param[out] out Pointer to structure to hold compensated output data.
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_PTHREAD_FAILURE / SENSOR_ERR_HW_INTERFACE_FAILURE / SENSOR_ERR_TIMEOUT otherwise
+ */
+STATIC SensorError_t bme280_get_output_forced(Bme280_t* ctx, const Bme280ProfileCfg_t* cfg, Bme280_output_t* out);
+
+/**
+ * @brief Trigger a single measurement (forced mode) and wait until the status register reports it as completed
+ *
+ * @param[in] ctx Pointer to initialized BME280 sensor instance.
+ * @param[in] cfg Settings of the active profile
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_HW_INTERFACE_FAILURE / SENSOR_ERR_TIMEOUT otherwise
+ */
+STATIC SensorError_t bme280_forced_measure(Bme280_t* ctx, const Bme280ProfileCfg_t* cfg);
+
+/**
+ * @brief Write the settings of a measurement profile to the config registers (in a single transaction)
+ *
+ * @param[in] ctx Pointer to BME280 sensor instance (trim parameters not required).
+ * @param[in] cfg Settings of the profile to apply
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_HW_INTERFACE_FAILURE otherwise
+ */
+STATIC SensorError_t bme280_write_config(Bme280_t* ctx, const Bme280ProfileCfg_t* cfg);
+
+/**
+ * @brief Store a new sample in the sampler's cache.
+ *
+ * @param[in] ctx Pointer to initialized BME280 sensor instance.
+ * @param[in] out Pointer to compensated output data.
+ * @return SENSOR_ERR_OK on success, SENSOR_ERR_PTHREAD_FAILURE otherwise
+ */
+STATIC SensorError_t bme280_sampler_store(Bme280_t* ctx, const Bme280_output_t* out);
+
+/**
+ * @brief Sampling thread routine (reads the sensor once per sampling period until stopped).
+ *
+ * @param[in] arg Pointer to initialized BME280 sensor instance.
+ * @return NULL
+ */
+STATIC void* bme280_sampler_loop(void* arg);
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time.
+ *
+ * @return Time in microseconds.
+ */
+STATIC uint64_t bme280_time_us(void);
+
 /**
  * @brief Read and compensate measurement data from the BME280 sensor.
  *
@@ -55,37 +135,153 @@ STATIC SensorError_t bme280_data_readout(Bme280_t* ctx, Bme280_output_t* out);
  */
 STATIC SensorError_t bme280_read_trim_params(Bme280_t* ctx);
 
+/**
+ * @brief Compute the constant (trim-dependent only) terms of the compensation formulas
+ *
+ * @param[in] trim Pointer to calibration digits
+ * @param[out] comp Pointer to store the constant terms
+ */
+STATIC void bme280_precompute(const Trim_t* trim, Bme280Comp_t* comp);
+
 /**
  * @brief Compensate temperature measurement from the BME280 sensor.
  *
  * @param[in] trim Pointer to calibration digits
+ * @param[in] comp Pointer to the constant terms of the compensation formulas
  * @param[in] adc_T Raw temperature data retrieved from sensor's registers
  * @return Bme280_temp_t struct with temperature in DegC, resolution is 0.01 DegC an fine temp for hum calculation. Output value of “5123” equals 51.23 DegC.
  */
-STATIC Bme280_temp_t BME280_compensate_T_int32(Trim_t trim, Bme280_s32_t adc_T);
+STATIC Bme280_temp_t BME280_compensate_T_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_T);
 
 /**
  * @brief Compensate pressure measurement from the BME280 sensor.
  *
  * @param[in] trim Pointer to calibration digits
+ * @param[in] comp Pointer to the constant terms of the compensation formulas
  * @param[in] adc_P Raw pressure data retrieved from sensor's registers
  * @param[in] t_fine Current fine temperature (required to calculate the pressure)
  * @return Pressure in Pa as unsigned 32 bit integer in Q24.8 format (24 integer bits and 8 fractional bits).
  */
-STATIC Bme280_u32_t BME280_compensate_P_int64(Trim_t trim, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+STATIC Bme280_u32_t
+BME280_compensate_P_int64(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+
+#if defined(BME280_PRESS_COMP_INT32) || defined(UT) // Also built for the tests and benchmarks comparing both variants
+/**
+ * @brief Compensate pressure measurement from the BME280 sensor using 32-bit math only (1 Pa resolution).
+ *
+ * @param[in] trim Pointer to calibration digits
+ * @param[in] comp Pointer to the constant terms of the compensation formulas
+ * @param[in] adc_P Raw pressure data retrieved from sensor's registers
+ * @param[in] t_fine Current fine temperature (required to calculate the pressure)
+ * @return Pressure in Pa in Q24.8 format (the fractional bits are always zero; a few Pa off the 64-bit variant), 0 on
+ * invalid trim parameters.
+ */
+STATIC Bme280_u32_t
+BME280_compensate_P_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+#endif // BME280_PRESS_COMP_INT32 || UT
 
 /**
  * @brief Compensate humidity measurement from the BME280 sensor.
  *
  * @param[in] trim Pointer to calibration digits
+ * @param[in] comp Pointer to the constant terms of the compensation formulas
  * @param[in] adc_H Raw humidity data retrieved from sensor's registers
  * @param[in] t_fine Current fine temperature (required to calculate the humidity)
  * @return Humidity in %RH as unsigned 32-bit integer in Q22.10 format (22 integer and 10 fractional bits; e.g. “47445” represents 47445 / 1024 = 46.333 %RH).
  */
-STATIC Bme280_u32_t bme280_compensate_H_int32(Trim_t trim, Bme280_s32_t adc_H, Bme280_s32_t t_fine);
+STATIC Bme280_u32_t
+bme280_compensate_H_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_H, Bme280_s32_t t_fine);
+
+/* Sensor driver adapters (the generic SensorDriver_t interface passes the Bme280_t context as void*) */
+// Convert a compensated sample to the generic sensor reading (all fields are supported)
+static void bme280_to_reading(const Bme280_output_t* out, SensorReading_t* reading) {
+    reading->fields = SENSOR_FIELD_TEMP | SENSOR_FIELD_HUM | SENSOR_FIELD_PRESS;
+    reading->temp_cC = out->t;
+    reading->hum_q10 = out->h;
+    reading->press_q8 = out->p;
+}
 
-SensorError_t bme280_init(Bme280_t* ctx, const uint8_t addr, HwInterface_t hw_ctx) {
-    if(!ctx) {
+static SensorError_t bme280_driver_init_start(void* ctx, const uint8_t addr, HwInterface_t* hw_ctx) {
+    return bme280_init_start((Bme280_t*)ctx, addr, hw_ctx);
+}
+
+static SensorError_t bme280_driver_init_complete(void* ctx) {
+    return bme280_init_complete((Bme280_t*)ctx);
+}
+
+static SensorError_t bme280_driver_read(void* ctx, SensorReading_t* reading) {
+    if(!reading) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    Bme280_output_t out;
+    SensorError_t err = bme280_get_fixed((Bme280_t*)ctx, &out);
+    if(err != SENSOR_ERR_OK) {
+        reading->fields = 0;
+        return err;
+    }
+
+    bme280_to_reading(&out, reading);
+    return SENSOR_ERR_OK;
+}
+
+static SensorError_t
+bme280_driver_sampler_start(void* ctx, const uint32_t max_age_ms, SensorSampleCb_t on_sample, void* arg) {
+    return bme280_sampler_start((Bme280_t*)ctx, max_age_ms, on_sample, arg);
+}
+
+static SensorError_t bme280_driver_set_profile(void* ctx, const SensorProfile_t profile) {
+    return bme280_set_profile((Bme280_t*)ctx, profile);
+}
+
+static SensorError_t bme280_driver_deinit(void* ctx) {
+    return bme280_deinit((Bme280_t*)ctx);
+}
+
+const SensorDriver_t BME280_DRIVER = {
+    .name = "bme280",
+    .i2c_addrs = BME280_I2C_ADDRS,
+    .i2c_addr_count = sizeof(BME280_I2C_ADDRS) / sizeof(BME280_I2C_ADDRS[0]),
+    .reset_delay_ms = BME280_RESET_DELAY_MS,
+    .probe = bme280_probe,
+    .init_start = bme280_driver_init_start,
+    .init_complete = bme280_driver_init_complete,
+    .read = bme280_driver_read,
+    .sampler_start = bme280_driver_sampler_start,
+    .set_profile = bme280_driver_set_profile,
+    .deinit = bme280_driver_deinit,
+};
+
+SensorError_t bme280_init(Bme280_t* ctx, const uint8_t addr, HwInterface_t* hw_ctx) {
+    SensorError_t err = bme280_init_start(ctx, addr, hw_ctx);
+    if(err != SENSOR_ERR_OK) {
+        return err;
+    }
+
+    // Wait for the reset to complete (the trim parameters are copied from the NVM on start-up)
+    usleep((useconds_t)BME280_RESET_DELAY_MS * 1000);
+
+    return bme280_init_complete(ctx);
+}
+
+SensorError_t bme280_probe(HwInterface_t* hw_ctx, const uint8_t addr) {
+    if(!hw_ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    uint8_t id_buf;
+    HwInterfaceError_t err = hw_interface_read(hw_ctx, addr, BME280_REG_ID, &id_buf, sizeof(id_buf));
+    if(err != HW_INTERFACE_ERR_OK) {
+        return SENSOR_ERR_HW_INTERFACE_FAILURE;
+    } else if(id_buf != BME280_ID) {
+        return SENSOR_ERR_INVALID_ID;
+    }
+
+    return SENSOR_ERR_OK;
+}
+
+SensorError_t bme280_init_start(Bme280_t* ctx, const uint8_t addr, HwInterface_t* hw_ctx) {
+    if(!ctx || !hw_ctx) {
         return SENSOR_ERR_NULL_ARGUMENT;
     }
 
@@ -94,47 +290,47 @@ SensorError_t bme280_init(Bme280_t* ctx, const uint8_t addr, HwInterface_t hw_ct
     ctx->addr = addr;
     ctx->hw_ctx = hw_ctx;
 
+    // Initialize mutex for protecting the sampler's cache
+    int ret = pthread_mutex_init(&ctx->sampler.lock, NULL);
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+
     SensorError_t s_ret = bme280_check_id(ctx);
     if(s_ret != SENSOR_ERR_OK) {
+        pthread_mutex_destroy(&ctx->sampler.lock);
         return s_ret;
     }
 
-    // Configure standby, filter and interface
-    // Set: 20ms standby; filter off; 3-wire SPI off
-    ConfigReg_t config_reg = { .b.filter = BME280_FILTER_OFF, .b.t_sb = BME280_STANDBY, .b.spi3w_en = BME280_SPI3W_DISABLED };
-    HwInterfaceError_t h_ret =
-    hw_interface_write(&hw_ctx, addr, BME280_REG_CONFIG, &config_reg.w, sizeof(config_reg.w));
+    // Trigger the soft reset (the caller waits BME280_RESET_DELAY_MS before completing the init)
+    uint8_t reset = BME280_SOFT_RESET;
+    HwInterfaceError_t h_ret = hw_interface_write(hw_ctx, addr, BME280_REG_RESET, &reset, sizeof(reset));
     if(h_ret != HW_INTERFACE_ERR_OK) {
-        log_error("failed to write to the Config reg (err: %d)", h_ret);
+        log_error("failed to write to the Reset reg (err: %d)", h_ret);
+        pthread_mutex_destroy(&ctx->sampler.lock);
         return SENSOR_ERR_HW_INTERFACE_FAILURE;
     }
 
-    // Enable and configure humidity measurements
-    // Set: max oversampling (x16) on humidity; Changes to this reg only become effective after a write operation to “ctrl_meas”!
-    CtrlHumReg_t ctrl_hum_reg = { .b.osrs_h = BME280_OSRS_MAX_OVERSAMPLING };
-    h_ret = hw_interface_write(&hw_ctx, addr, BME280_REG_CTRL_HUM, &ctrl_hum_reg.w, sizeof(ctrl_hum_reg.w));
-    if(h_ret != HW_INTERFACE_ERR_OK) {
-        log_error("failed to write to the CtrlHum reg (err: %d)", h_ret);
-        return SENSOR_ERR_HW_INTERFACE_FAILURE;
-    }
+    return SENSOR_ERR_OK;
+}
 
-    // Enable and configure pressure and temperature measurements
-    // Set: max oversampling (x16) on temp and press measurements; Normal mode
-    CtrlMeasReg_t ctrl_meas_reg = { .b.osrs_p = BME280_OSRS_MAX_OVERSAMPLING,
-        .b.osrs_t = BME280_OSRS_MAX_OVERSAMPLING,
-        .b.mode = BME280_NORMAL_MODE };
-    h_ret = hw_interface_write(&hw_ctx, addr, BME280_REG_CTRL_MEAS, &ctrl_meas_reg.w, sizeof(ctrl_meas_reg.w));
-    if(h_ret != HW_INTERFACE_ERR_OK) {
-        log_error("failed to write to the CtrlMeas reg (err: %d)", h_ret);
-        return SENSOR_ERR_HW_INTERFACE_FAILURE;
+SensorError_t bme280_init_complete(Bme280_t* ctx) {
+    if(!ctx || !ctx->hw_ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
     }
 
-    // Apply a configured delay after a reset (at least one standby period)
-    usleep((useconds_t)BME280_RESET_DELAY_MS * 1000);
-
     // Read trim (calibration) parameters
-    s_ret = bme280_read_trim_params(ctx);
+    SensorError_t s_ret = bme280_read_trim_params(ctx);
+    if(s_ret != SENSOR_ERR_OK) {
+        pthread_mutex_destroy(&ctx->sampler.lock);
+        return s_ret;
+    }
+
+    // Apply the default profile (high-precision: the profile is zeroed-out by bme280_init_start())
+    s_ret = bme280_write_config(ctx, &BME280_PROFILES[atomic_load(&ctx->profile)]);
     if(s_ret != SENSOR_ERR_OK) {
+        pthread_mutex_destroy(&ctx->sampler.lock);
         return s_ret;
     }
 
@@ -151,7 +347,7 @@ SensorError_t bme280_get_temp(Bme280_t* ctx, float* temp) {
     }
 
     Bme280_output_t out;
-    SensorError_t err = bme280_data_readout(ctx, &out);
+    SensorError_t err = bme280_get_output(ctx, &out);
     if(err != SENSOR_ERR_OK) {
         return err;
     }
@@ -170,7 +366,7 @@ SensorError_t bme280_get_hum(Bme280_t* ctx, float* hum) {
     }
 
     Bme280_output_t out;
-    SensorError_t err = bme280_data_readout(ctx, &out);
+    SensorError_t err = bme280_get_output(ctx, &out);
     if(err != SENSOR_ERR_OK) {
         return err;
     }
@@ -189,7 +385,7 @@ SensorError_t bme280_get_press(Bme280_t* ctx, float* press) {
     }
 
     Bme280_output_t out;
-    SensorError_t err = bme280_data_readout(ctx, &out);
+    SensorError_t err = bme280_get_output(ctx, &out);
     if(err != SENSOR_ERR_OK) {
         return err;
     }
@@ -200,6 +396,156 @@ SensorError_t bme280_get_press(Bme280_t* ctx, float* press) {
     return SENSOR_ERR_OK;
 }
 
+SensorError_t bme280_get_all(Bme280_t* ctx, float* temp, float* hum, float* press) {
+    if(!ctx || !temp || !hum || !press) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    }
+
+    Bme280_output_t out;
+    SensorError_t err = bme280_get_output(ctx, &out);
+    if(err != SENSOR_ERR_OK) {
+        return err;
+    }
+
+    // Convert all values from the same sample
+    *temp = (float)out.t / BME280_TEMP_SCALE;
+    *hum = (float)out.h / BME280_HUM_SCALE;
+    *press = (float)out.p / BME280_PRESS_SCALE;
+
+    return SENSOR_ERR_OK;
+}
+
+SensorError_t bme280_get_fixed(Bme280_t* ctx, Bme280_output_t* out) {
+    if(!ctx || !out) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    }
+
+    // The compensated values are already scaled integers, no conversion required
+    return bme280_get_output(ctx, out);
+}
+
+SensorError_t bme280_set_profile(Bme280_t* ctx, const SensorProfile_t profile) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    } else if((unsigned)profile >= SENSOR_PROFILE_COUNT) {
+        return SENSOR_ERR_INVALID_ARGUMENT;
+    }
+
+    // Reconfigure the sensor and drop the cached sample (critical section, serialized with forced readouts)
+    int ret = pthread_mutex_lock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock taken");
+
+    SensorError_t err = bme280_write_config(ctx, &BME280_PROFILES[profile]);
+    if(err == SENSOR_ERR_OK) {
+        atomic_store(&ctx->profile, (int)profile);
+        ctx->sampler.valid = false;
+    }
+
+    ret = pthread_mutex_unlock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock released");
+
+    if(err == SENSOR_ERR_OK) {
+        log_info("BME280 profile set to %s (addr: 0x%02X)", sensor_profile_name(profile), ctx->addr);
+    }
+    return err;
+}
+
+SensorError_t
+bme280_sampler_start(Bme280_t* ctx, const uint32_t max_age_ms, SensorSampleCb_t on_sample, void* arg) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    } else if(max_age_ms == 0 || atomic_load(&ctx->sampler.running)) {
+        return SENSOR_ERR_GENERIC;
+    }
+
+    // Enable the cache (critical section)
+    int ret = pthread_mutex_lock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock taken");
+
+    ctx->sampler.max_age_ms = max_age_ms;
+    ctx->sampler.valid = false;
+    ctx->sampler.on_sample = on_sample;
+    ctx->sampler.on_sample_arg = arg;
+
+    ret = pthread_mutex_unlock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock released");
+
+    // Start the sampling thread
+    atomic_store(&ctx->sampler.running, true);
+    ret = pthread_create(&ctx->sampler.thread, NULL, bme280_sampler_loop, (void*)ctx);
+    if(ret != 0) {
+        log_error("pthread_create() returned %d", ret);
+        atomic_store(&ctx->sampler.running, false);
+        ctx->sampler.max_age_ms = 0;
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+
+    log_debug("BME280 sampler started (addr: 0x%02X, max age: %u ms)", ctx->addr, max_age_ms);
+    return SENSOR_ERR_OK;
+}
+
+SensorError_t bme280_sampler_stop(Bme280_t* ctx) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(!ctx->is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    } else if(!atomic_load(&ctx->sampler.running)) {
+        return SENSOR_ERR_OK;
+    }
+
+    // Stop the sampling thread (wakes up at most one sampling period later)
+    atomic_store(&ctx->sampler.running, false);
+    int ret = pthread_join(ctx->sampler.thread, NULL);
+    if(ret != 0) {
+        log_error("pthread_join() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+
+    // Disable the cache (critical section)
+    ret = pthread_mutex_lock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock taken");
+
+    ctx->sampler.max_age_ms = 0;
+    ctx->sampler.valid = false;
+
+    ret = pthread_mutex_unlock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock released");
+
+    return SENSOR_ERR_OK;
+}
+
 SensorError_t bme280_check_id(Bme280_t* ctx) {
     if(!ctx) {
         return SENSOR_ERR_NULL_ARGUMENT;
@@ -208,7 +554,7 @@ SensorError_t bme280_check_id(Bme280_t* ctx) {
     // Check sensor ID to confirm the communication link is working and the sensor is on (should be 0x60 for BM280)
     uint8_t id_buf;
 
-    HwInterfaceError_t err = hw_interface_read(&ctx->hw_ctx, ctx->addr, BME280_REG_ID, &id_buf, sizeof(id_buf));
+    HwInterfaceError_t err = hw_interface_read(ctx->hw_ctx, ctx->addr, BME280_REG_ID, &id_buf, sizeof(id_buf));
     if(err != HW_INTERFACE_ERR_OK) {
         log_error("hw_interface_read returned %d", err);
         return SENSOR_ERR_HW_INTERFACE_FAILURE;
@@ -227,32 +573,247 @@ SensorError_t bme280_deinit(Bme280_t* ctx) {
         return SENSOR_ERR_NOT_INITIALIZED;
     }
 
+    SensorError_t err = bme280_sampler_stop(ctx);
+    if(err != SENSOR_ERR_OK) {
+        return err;
+    }
+    int ret = pthread_mutex_destroy(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_destroy() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+
     // Zero-out the Bme280_t struct on deinit
     memset(ctx, 0, sizeof(Bme280_t));
 
     return SENSOR_ERR_OK;
 }
 
-STATIC SensorError_t bme280_read_trim_params(Bme280_t* ctx) {
-    if(!ctx) {
-        return SENSOR_ERR_NULL_ARGUMENT;
+STATIC SensorError_t bme280_get_output(Bme280_t* ctx, Bme280_output_t* out) {
+    Bme280Sampler_t* sampler = &ctx->sampler;
+
+    // In forced mode the sensor sleeps until a readout triggers a measurement
+    const Bme280ProfileCfg_t* cfg = &BME280_PROFILES[atomic_load(&ctx->profile)];
+    if(cfg->mode == BME280_FORCED_MODE) {
+        return bme280_get_output_forced(ctx, cfg, out);
     }
 
-    uint8_t calib_buf[BME280_REG_CALIB_A_LENGTH + BME280_REG_CALIB_B_LENGTH];
-    uint8_t* buf_ptr = calib_buf;
-    HwInterfaceError_t err;
+    // Try serving the sample from the cache (critical section)
+    int ret = pthread_mutex_lock(&sampler->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock taken");
+
+    bool enabled = (sampler->max_age_ms > 0);
+    bool hit = enabled && sampler->valid && (bme280_time_us() - sampler->timestamp_us <= sampler->max_age_ms * 1000ULL);
+    if(hit) {
+        *out = sampler->sample;
+    }
 
-    // Read both parts of the calibration data from the sensor's registers
-    err = hw_interface_read(&ctx->hw_ctx, ctx->addr, BME280_REG_CALIB_A_BASE, buf_ptr, BME280_REG_CALIB_A_LENGTH);
+    ret = pthread_mutex_unlock(&sampler->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock released");
+
+    if(hit) {
+        return SENSOR_ERR_OK;
+    }
+
+    // Cache disabled or too stale (e.g. the sampler is lagging) - read the sensor directly
+    SensorError_t err = bme280_data_readout(ctx, out);
+    if(err == SENSOR_ERR_OK && enabled) {
+        err = bme280_sampler_store(ctx, out);
+    }
+
+    return err;
+}
+
+STATIC SensorError_t bme280_get_output_forced(Bme280_t* ctx, const Bme280ProfileCfg_t* cfg, Bme280_output_t* out) {
+    Bme280Sampler_t* sampler = &ctx->sampler;
+
+    // Serve the sample from the cache or take a new measurement (critical section)
+    int ret = pthread_mutex_lock(&sampler->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock taken");
+
+    SensorError_t err = SENSOR_ERR_OK;
+    bool enabled = (sampler->max_age_ms > 0);
+    bool hit = enabled && sampler->valid && (bme280_time_us() - sampler->timestamp_us <= sampler->max_age_ms * 1000ULL);
+    if(hit) {
+        *out = sampler->sample;
+    } else {
+        err = bme280_forced_measure(ctx, cfg);
+        if(err == SENSOR_ERR_OK) {
+            err = bme280_data_readout(ctx, out);
+        }
+        if(err == SENSOR_ERR_OK && enabled) {
+            sampler->sample = *out;
+            sampler->timestamp_us = bme280_time_us();
+            sampler->valid = true;
+        }
+    }
+
+    ret = pthread_mutex_unlock(&sampler->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock released");
+
+    return err;
+}
+
+STATIC SensorError_t bme280_forced_measure(Bme280_t* ctx, const Bme280ProfileCfg_t* cfg) {
+    // Trigger a single measurement (the sensor returns to sleep mode once it's done)
+    CtrlMeasReg_t ctrl_meas_reg = { .b.osrs_p = cfg->osrs, .b.osrs_t = cfg->osrs, .b.mode = BME280_FORCED_MODE };
+    HwInterfaceError_t err = hw_interface_write(ctx->hw_ctx, ctx->addr, BME280_REG_CTRL_MEAS, &ctrl_meas_reg.w, 1);
     if(err != HW_INTERFACE_ERR_OK) {
-        log_error("failed to read Calibration Data (part A), hw_interface_read returned: %d", err);
+        log_error("failed to trigger the forced measurement, hw_interface_write() returned: %d", err);
         return SENSOR_ERR_HW_INTERFACE_FAILURE;
     }
 
-    buf_ptr = calib_buf + BME280_REG_CALIB_A_LENGTH;
-    err = hw_interface_read(&ctx->hw_ctx, ctx->addr, BME280_REG_CALIB_B_BASE, buf_ptr, BME280_REG_CALIB_B_LENGTH);
+    // Sleep through the typical measurement time, then poll the status reg until the measurement is completed
+    usleep((useconds_t)cfg->meas_typ_us);
+    uint32_t waited_us = cfg->meas_typ_us;
+    while(true) {
+        StatusReg_t status_reg;
+        err = hw_interface_read(ctx->hw_ctx, ctx->addr, BME280_REG_STATUS, &status_reg.w, sizeof(status_reg.w));
+        if(err != HW_INTERFACE_ERR_OK) {
+            log_error("failed to read the Status reg, hw_interface_read() returned: %d", err);
+            return SENSOR_ERR_HW_INTERFACE_FAILURE;
+        } else if(!status_reg.b.measuring) {
+            return SENSOR_ERR_OK;
+        } else if(waited_us >= 2 * cfg->meas_max_us) { // Twice the max time leaves a margin for the scheduling delays
+            log_error("forced measurement not completed in %u us (addr: 0x%02X)", waited_us, ctx->addr);
+            return SENSOR_ERR_TIMEOUT;
+        }
+
+        usleep(BME280_STATUS_POLL_US);
+        waited_us += BME280_STATUS_POLL_US;
+    }
+}
+
+STATIC SensorError_t bme280_write_config(Bme280_t* ctx, const Bme280ProfileCfg_t* cfg) {
+    // Writes to the config reg may be ignored in normal mode, so the sensor is put to sleep first
+    CtrlMeasReg_t sleep_reg = { .b.mode = BME280_SLEEP_MODE };
+
+    // Configure standby, filter and interface
+    // Set: profile's standby; filter off; 3-wire SPI off
+    ConfigReg_t config_reg = { .b.filter = BME280_FILTER_OFF, .b.t_sb = cfg->t_sb, .b.spi3w_en = BME280_SPI3W_DISABLED };
+
+    // Enable and configure humidity measurements
+    // Set: profile's oversampling on humidity; Changes to this reg only become effective after a write operation to “ctrl_meas”!
+    CtrlHumReg_t ctrl_hum_reg = { .b.osrs_h = cfg->osrs };
+
+    // Enable and configure pressure and temperature measurements
+    // Set: profile's oversampling on temp and press measurements; Normal mode (forced mode stays asleep until a readout)
+    CtrlMeasReg_t ctrl_meas_reg = { .b.osrs_p = cfg->osrs,
+        .b.osrs_t = cfg->osrs,
+        .b.mode = (cfg->mode == BME280_FORCED_MODE ? BME280_SLEEP_MODE : cfg->mode) };
+
+    // Write all config registers in a single transaction (ctrl_meas has to be the last one)
+    HwInterfaceOp_t config_ops[] = {
+        { .type = HW_INTERFACE_OP_WRITE, .reg_addr = BME280_REG_CTRL_MEAS, .buf = &sleep_reg.w, .len = sizeof(sleep_reg.w) },
+        { .type = HW_INTERFACE_OP_WRITE, .reg_addr = BME280_REG_CONFIG, .buf = &config_reg.w, .len = sizeof(config_reg.w) },
+        { .type = HW_INTERFACE_OP_WRITE, .reg_addr = BME280_REG_CTRL_HUM, .buf = &ctrl_hum_reg.w, .len = sizeof(ctrl_hum_reg.w) },
+        { .type = HW_INTERFACE_OP_WRITE, .reg_addr = BME280_REG_CTRL_MEAS, .buf = &ctrl_meas_reg.w, .len = sizeof(ctrl_meas_reg.w) },
+    };
+    HwInterfaceError_t h_ret =
+    hw_interface_transfer(ctx->hw_ctx, ctx->addr, config_ops, sizeof(config_ops) / sizeof(config_ops[0]));
+    if(h_ret != HW_INTERFACE_ERR_OK) {
+        log_error("failed to write to the Config/CtrlHum/CtrlMeas regs (err: %d)", h_ret);
+        return SENSOR_ERR_HW_INTERFACE_FAILURE;
+    }
+
+    return SENSOR_ERR_OK;
+}
+
+STATIC SensorError_t bme280_sampler_store(Bme280_t* ctx, const Bme280_output_t* out) {
+    // Update the cached sample (critical section)
+    int ret = pthread_mutex_lock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock taken");
+
+    ctx->sampler.sample = *out;
+    ctx->sampler.timestamp_us = bme280_time_us();
+    ctx->sampler.valid = true;
+
+    ret = pthread_mutex_unlock(&ctx->sampler.lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("BME280 lock released");
+
+    return SENSOR_ERR_OK;
+}
+
+STATIC void* bme280_sampler_loop(void* arg) {
+    Bme280_t* ctx = (Bme280_t*)arg;
+    bool failing = false;
+
+    while(atomic_load(&ctx->sampler.running)) {
+        // Profiles without continuous measurements are sampled on demand only (the profile may change at runtime)
+        const Bme280ProfileCfg_t* cfg = &BME280_PROFILES[atomic_load(&ctx->profile)];
+        if(cfg->sampler_period_ms == 0) {
+            usleep((useconds_t)BME280_SAMPLER_IDLE_MS * 1000);
+            continue;
+        }
+
+        // The sensor updates its output once per measurement period, so sampling more often makes no sense
+        Bme280_output_t out;
+        SensorError_t err = bme280_data_readout(ctx, &out);
+        if(err == SENSOR_ERR_OK) {
+            bme280_sampler_store(ctx, &out);
+            if(ctx->sampler.on_sample) {
+                SensorReading_t reading;
+                bme280_to_reading(&out, &reading);
+                ctx->sampler.on_sample(ctx->sampler.on_sample_arg, &reading);
+            }
+        } else if(!failing) {
+            log_error("background readout failed (addr: 0x%02X, err: %d)", ctx->addr, err); // Logged once per outage
+        }
+        failing = (err != SENSOR_ERR_OK);
+        usleep((useconds_t)cfg->sampler_period_ms * 1000);
+    }
+
+    return NULL;
+}
+
+STATIC uint64_t bme280_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+STATIC SensorError_t bme280_read_trim_params(Bme280_t* ctx) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    uint8_t calib_buf[BME280_REG_CALIB_A_LENGTH + BME280_REG_CALIB_B_LENGTH];
+
+    // Read both parts of the calibration data from the sensor's registers (in a single transaction)
+    HwInterfaceOp_t calib_ops[] = {
+        { .type = HW_INTERFACE_OP_READ, .reg_addr = BME280_REG_CALIB_A_BASE, .buf = calib_buf, .len = BME280_REG_CALIB_A_LENGTH },
+        { .type = HW_INTERFACE_OP_READ,
+            .reg_addr = BME280_REG_CALIB_B_BASE,
+            .buf = calib_buf + BME280_REG_CALIB_A_LENGTH,
+            .len = BME280_REG_CALIB_B_LENGTH },
+    };
+    HwInterfaceError_t err = hw_interface_transfer(ctx->hw_ctx, ctx->addr, calib_ops, sizeof(calib_ops) / sizeof(calib_ops[0]));
     if(err != HW_INTERFACE_ERR_OK) {
-        log_error("failed to read Calibration Data (part B), hw_interface_read returned: %d", err);
+        log_error("failed to read Calibration Data, hw_interface_transfer returned: %d", err);
         return SENSOR_ERR_HW_INTERFACE_FAILURE;
     }
 
@@ -287,9 +848,21 @@ STATIC SensorError_t bme280_read_trim_params(Bme280_t* ctx) {
     calib->dig_H5 = (int16_t)((d[31] << 4) | (d[30] >> 4)); // 0xE6 << 4 | (0xE5 >> 4)
     calib->dig_H6 = (int8_t)d[32];                          // 0xE7
 
+    // The trim parameters never change, so the terms depending on them only are computed once
+    bme280_precompute(calib, &ctx->comp);
+
     return SENSOR_ERR_OK;
 }
 
+STATIC void bme280_precompute(const Trim_t* trim, Bme280Comp_t* comp) {
+    comp->t1 = (Bme280_s32_t)trim->dig_T1;
+    comp->t1_x2 = (Bme280_s32_t)trim->dig_T1 << 1;
+    comp->p4_sh35 = (Bme280_s64_t)trim->dig_P4 * ((Bme280_s64_t)1 << 35);
+    comp->p7_sh4 = (Bme280_s64_t)trim->dig_P7 * 16;
+    comp->p4_sh16 = (Bme280_s32_t)trim->dig_P4 * 65536;
+    comp->h4_sh20_rd = (Bme280_s32_t)16384 - (Bme280_s32_t)trim->dig_H4 * 1048576;
+}
+
 STATIC SensorError_t bme280_data_readout(Bme280_t* ctx, Bme280_output_t* out) {
     if(!ctx || !out) {
         return SENSOR_ERR_NULL_ARGUMENT;
@@ -301,7 +874,7 @@ STATIC SensorError_t bme280_data_readout(Bme280_t* ctx, Bme280_output_t* out) {
 
     uint8_t buf[BME280_REG_DATA_LENGTH];
 
-    HwInterfaceError_t err_hw = hw_interface_read(&ctx->hw_ctx, ctx->addr, BME280_REG_PRESS_MSB, buf, sizeof(buf));
+    HwInterfaceError_t err_hw = hw_interface_read(ctx->hw_ctx, ctx->addr, BME280_REG_PRESS_MSB, buf, sizeof(buf));
     if(err_hw != HW_INTERFACE_ERR_OK) {
         log_error("Failed to perform measurement data redout, hw_interface_read() returned: %d", err_hw);
         return SENSOR_ERR_HW_INTERFACE_FAILURE;
@@ -314,24 +887,26 @@ STATIC SensorError_t bme280_data_readout(Bme280_t* ctx, Bme280_output_t* out) {
     // Humidity: 16-bit unsigned (optional, if enabled)
     uint32_t adc_H = ((uint32_t)buf[6] << 8) | buf[7];
 
-    Bme280_temp_t t = BME280_compensate_T_int32(ctx->calib, (Bme280_s32_t)adc_T);
+    Bme280_temp_t t = BME280_compensate_T_int32(&ctx->calib, &ctx->comp, (Bme280_s32_t)adc_T);
     out->t = t.deg_C;
-    out->p = BME280_compensate_P_int64(ctx->calib, (Bme280_s32_t)adc_P, t.fine);
-    out->h = bme280_compensate_H_int32(ctx->calib, (Bme280_s32_t)adc_H, t.fine);
+#ifdef BME280_PRESS_COMP_INT32
+    out->p = BME280_compensate_P_int32(&ctx->calib, &ctx->comp, (Bme280_s32_t)adc_P, t.fine);
+#else
+    out->p = BME280_compensate_P_int64(&ctx->calib, &ctx->comp, (Bme280_s32_t)adc_P, t.fine);
+#endif // BME280_PRESS_COMP_INT32
+    out->h = bme280_compensate_H_int32(&ctx->calib, &ctx->comp, (Bme280_s32_t)adc_H, t.fine);
 
     return SENSOR_ERR_OK;
 }
 
-STATIC Bme280_temp_t BME280_compensate_T_int32(Trim_t trim, Bme280_s32_t adc_T) {
+STATIC Bme280_temp_t BME280_compensate_T_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_T) {
     // The following code has been taken from BME280 datasheet
-    // @TODO: Refactor the code and make it more readable
     Bme280_temp_t out;
-    Bme280_s32_t var1, var2;
+    Bme280_s32_t var1, var2, dT;
 
-    var1 = ((((adc_T >> 3) - ((Bme280_s32_t)trim.dig_T1 << 1))) * ((Bme280_s32_t)trim.dig_T2)) >> 11;
-    var2 = (((((adc_T >> 4) - ((Bme280_s32_t)trim.dig_T1)) * ((adc_T >> 4) - ((Bme280_s32_t)trim.dig_T1))) >> 12) *
-            ((Bme280_s32_t)trim.dig_T3));
-    var2 = var2 >> 14;
+    var1 = (((adc_T >> 3) - comp->t1_x2) * ((Bme280_s32_t)trim->dig_T2)) >> 11;
+    dT = (adc_T >> 4) - comp->t1;
+    var2 = (((dT * dT) >> 12) * ((Bme280_s32_t)trim->dig_T3)) >> 14;
 
     out.fine = var1 + var2;
     out.deg_C = (out.fine * 5 + 128) >> 8;
@@ -339,42 +914,75 @@ STATIC Bme280_temp_t BME280_compensate_T_int32(Trim_t trim, Bme280_s32_t adc_T)
     return out;
 }
 
-STATIC Bme280_u32_t BME280_compensate_P_int64(Trim_t trim, Bme280_s32_t adc_P, Bme280_s32_t t_fine) {
+STATIC Bme280_u32_t
+BME280_compensate_P_int64(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine) {
     Bme280_s64_t var1, var2, p;
 
     var1 = ((Bme280_s64_t)t_fine) - 128000;
-    var2 = var1 * var1 * (Bme280_s64_t)trim.dig_P6;
-    var2 = var2 + ((var1 * (Bme280_s64_t)trim.dig_P5) << 17);
-    var2 = var2 + (((Bme280_s64_t)trim.dig_P4) << 35);
-    var1 = ((var1 * var1 * (Bme280_s64_t)trim.dig_P3) >> 8) + ((var1 * (Bme280_s64_t)trim.dig_P2) << 12);
-    var1 = (((((Bme280_s64_t)1) << 47) + var1)) * ((Bme280_s64_t)trim.dig_P1) >> 33;
+    var2 = var1 * var1 * (Bme280_s64_t)trim->dig_P6;
+    // var1 is negative below 25 *C, so the datasheet's left shifts are done as multiplications (<< 17 and << 12)
+    var2 = var2 + ((var1 * (Bme280_s64_t)trim->dig_P5) * 131072);
+    var2 = var2 + comp->p4_sh35;
+    var1 = ((var1 * var1 * (Bme280_s64_t)trim->dig_P3) >> 8) + ((var1 * (Bme280_s64_t)trim->dig_P2) * 4096);
+    var1 = (((((Bme280_s64_t)1) << 47) + var1)) * ((Bme280_s64_t)trim->dig_P1) >> 33;
     if(var1 == 0) {
         return 0; // avoid exception caused by division by zero
     }
     p = 1048576 - adc_P;
     p = (((p << 31) - var2) * 3125) / var1;
-    var1 = (((Bme280_s64_t)trim.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-    var2 = (((Bme280_s64_t)trim.dig_P8) * p) >> 19;
-    p = ((p + var1 + var2) >> 8) + (((Bme280_s64_t)trim.dig_P7) << 4);
+    var1 = (((Bme280_s64_t)trim->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((Bme280_s64_t)trim->dig_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + comp->p7_sh4;
 
     return (Bme280_u32_t)p;
 }
 
-STATIC Bme280_u32_t bme280_compensate_H_int32(Trim_t trim, Bme280_s32_t adc_H, Bme280_s32_t t_fine) {
+#if defined(BME280_PRESS_COMP_INT32) || defined(UT)
+STATIC Bme280_u32_t
+BME280_compensate_P_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine) {
+    // The following code has been taken from BME280 datasheet (the 32-bit variant, returns the pressure in Pa)
+    Bme280_s32_t var1, var2;
+    Bme280_u32_t p;
+
+    var1 = (t_fine >> 1) - (Bme280_s32_t)64000;
+    var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((Bme280_s32_t)trim->dig_P6);
+    var2 = var2 + ((var1 * ((Bme280_s32_t)trim->dig_P5)) * 2);
+    var2 = (var2 >> 2) + comp->p4_sh16;
+    var1 = (((trim->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((((Bme280_s32_t)trim->dig_P2) * var1) >> 1)) >>
+           18;
+    var1 = ((((Bme280_s32_t)32768 + var1)) * ((Bme280_s32_t)trim->dig_P1)) >> 15;
+    if(var1 == 0) {
+        return 0; // avoid exception caused by division by zero
+    }
+    p = (((Bme280_u32_t)(((Bme280_s32_t)1048576) - adc_P) - (Bme280_u32_t)(var2 >> 12))) * 3125;
+    if(p < 0x80000000) {
+        p = (p << 1) / ((Bme280_u32_t)var1);
+    } else {
+        p = (p / (Bme280_u32_t)var1) * 2;
+    }
+    var1 = (((Bme280_s32_t)trim->dig_P9) * ((Bme280_s32_t)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
+    var2 = (((Bme280_s32_t)(p >> 2)) * ((Bme280_s32_t)trim->dig_P8)) >> 13;
+    p = (Bme280_u32_t)((Bme280_s32_t)p + ((var1 + var2 + trim->dig_P7) >> 4));
+
+    // Same Q24.8 format as the 64-bit variant
+    return p << 8;
+}
+#endif // BME280_PRESS_COMP_INT32 || UT
+
+STATIC Bme280_u32_t
+bme280_compensate_H_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_H, Bme280_s32_t t_fine) {
     Bme280_s32_t v_x1_u32r;
 
     v_x1_u32r = (t_fine - ((Bme280_s32_t)76800));
-    v_x1_u32r = (((((adc_H << 14) - (((Bme280_s32_t)trim.dig_H4) << 20) - (((Bme280_s32_t)trim.dig_H5) * v_x1_u32r)) +
-                   ((Bme280_s32_t)16384)) >>
-                  15) *
-                 (((((((v_x1_u32r * ((Bme280_s32_t)trim.dig_H6)) >> 10) *
-                      (((v_x1_u32r * ((Bme280_s32_t)trim.dig_H3)) >> 11) + ((Bme280_s32_t)32768))) >>
+    v_x1_u32r = ((((adc_H << 14) + comp->h4_sh20_rd - (((Bme280_s32_t)trim->dig_H5) * v_x1_u32r)) >> 15) *
+                 (((((((v_x1_u32r * ((Bme280_s32_t)trim->dig_H6)) >> 10) *
+                      (((v_x1_u32r * ((Bme280_s32_t)trim->dig_H3)) >> 11) + ((Bme280_s32_t)32768))) >>
                      10) +
                     ((Bme280_s32_t)2097152)) *
-                   ((Bme280_s32_t)trim.dig_H2) +
+                   ((Bme280_s32_t)trim->dig_H2) +
                    8192) >>
                   14));
-    v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((Bme280_s32_t)trim.dig_H1)) >> 4));
+    v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((Bme280_s32_t)trim->dig_H1)) >> 4));
     v_x1_u32r = (v_x1_u32r < 0 ? 0 : v_x1_u32r);
     v_x1_u32r = (v_x1_u32r > 419430400 ? 419430400 : v_x1_u32r);
     return (Bme280_u32_t)(v_x1_u32r >> 12);
@@ -0,0 +1,81 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
+
+#include "sensors/sensor.h"
+
+#include <stdbool.h> // For: bool
+#include <strings.h> // For: strcasecmp
+
+// Names of the measurement profiles (indexed by SensorProfile_t)
+static const char* SENSOR_PROFILE_NAMES[SENSOR_PROFILE_COUNT] = {
+    [SENSOR_PROFILE_HIGH_PRECISION] = "high-precision",
+    [SENSOR_PROFILE_LOW_LATENCY] = "low-latency",
+    [SENSOR_PROFILE_WEATHER_STATION] = "weather-station",
+};
+
+uint32_t sensor_q_to_centi(const uint32_t value, const unsigned frac_bits) {
+    const uint32_t mask = ((uint32_t)1 << frac_bits) - 1;
+    const uint32_t half = ((uint32_t)1 << frac_bits) >> 1;
+
+    // Integer and fractional parts are scaled separately, so the multiplication cannot overflow
+    return (value >> frac_bits) * 100 + (((value & mask) * 100 + half) >> frac_bits);
+}
+
+size_t sensor_format_centi(char* buf, const size_t size, const int32_t value_x100) {
+    if(!buf) {
+        return 0;
+    }
+
+    // Work on the magnitude (in 32 bits unsigned, so INT32_MIN is handled as well)
+    const bool negative = value_x100 < 0;
+    uint32_t mag = negative ? (uint32_t)0 - (uint32_t)value_x100 : (uint32_t)value_x100;
+
+    // Produce the digits from the least significant one (the two decimal places and at least one integer digit)
+    char digits[SENSOR_CENTI_STR_SIZE];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + (mag % 10));
+        mag /= 10;
+    } while(mag > 0 || n < 3);
+
+    const size_t len = (negative ? 1 : 0) + n + 1; // Sign, digits and the decimal point
+    if(len + 1 > size) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    if(negative) {
+        buf[pos++] = '-';
+    }
+    while(n > 0) {
+        buf[pos++] = digits[--n];
+        if(n == 2) {
+            buf[pos++] = '.';
+        }
+    }
+    buf[pos] = '\0';
+
+    return pos;
+}
+
+const char* sensor_profile_name(const SensorProfile_t profile) {
+    if((unsigned)profile >= SENSOR_PROFILE_COUNT) {
+        return "unknown";
+    }
+
+    return SENSOR_PROFILE_NAMES[profile];
+}
+
+SensorError_t sensor_profile_from_name(const char* name, SensorProfile_t* profile) {
+    if(!name || !profile) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    for(unsigned i = 0; i < SENSOR_PROFILE_COUNT; ++i) {
+        if(strcasecmp(name, SENSOR_PROFILE_NAMES[i]) == 0) {
+            *profile = (SensorProfile_t)i;
+            return SENSOR_ERR_OK;
+        }
+    }
+
+    return SENSOR_ERR_INVALID_ARGUMENT;
+}
@@ -0,0 +1,433 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
+
+#include "sensors/sensor_history.h"
+
+#include <errno.h>    // For: errno
+#include <fcntl.h>    // For: open() and related macros
+#include <stdbool.h>  // For: bool
+#include <stdio.h>    // For: snprintf(), rename()
+#include <string.h>   // For: memset(), strlen(), strerror()
+#include <sys/mman.h> // For: mmap(), munmap()
+#include <sys/stat.h> // For: fstat()
+#include <unistd.h>   // For: write(), close(), ftruncate(), fdatasync(), unlink()
+
+#include "utils/common.h"
+#include "utils/log.h"
+
+#define SENSOR_HISTORY_FILE_MAGIC 0x54534850 // Magic number of the backing file ("PHST" in little endian)
+#define SENSOR_HISTORY_FILE_VERSION 1        // Version of the backing file format
+#define SENSOR_HISTORY_TMP_SUFFIX ".tmp"     // Suffix of the file written on compaction (renamed over the old one)
+#define SENSOR_HISTORY_COMPACT_CHUNK 128     // Number of records written at once on compaction
+
+/**
+ * @struct SensorHistoryFileHeader_t
+ * @brief Header of the backing file (the records follow; host byte order and layout)
+ */
+typedef struct {
+    uint32_t magic;       // SENSOR_HISTORY_FILE_MAGIC
+    uint16_t version;     // SENSOR_HISTORY_FILE_VERSION
+    uint16_t record_size; // sizeof(SensorHistoryRecord_t)
+} SensorHistoryFileHeader_t;
+
+/**
+ * @struct SensorHistoryRecord_t
+ * @brief Single sample in the backing file (8-byte aligned in the mapping, as the header takes 8 bytes)
+ */
+typedef struct {
+    int64_t ts_ms;                            // Timestamp of the sample (CLOCK_REALTIME in ms)
+    int32_t values[SENSOR_HISTORY_QTY_COUNT]; // Values of the quantities (SENSOR_HISTORY_NO_VALUE if missing)
+    int32_t reserved;                         // Padding (keeps the records 8-byte aligned)
+} SensorHistoryRecord_t;
+
+/**
+ * @brief Store a sample in the ring (overwrites the oldest one if the ring is full)
+ * @note Must be called with the history lock held (or before the history is shared)
+ *
+ * @param[in, out] ctx Pointer to the SensorHistory_t instance
+ * @param[in] ts_ms Timestamp of the sample
+ * @param[in] values Values of all quantities
+ * @return true if stored, false if dropped (sooner than cfg.interval_ms after the last sample or out of order)
+ */
+STATIC bool sensor_history_push(SensorHistory_t* ctx, const int64_t ts_ms, const int32_t* values);
+
+/**
+ * @brief Find the first sample not older than the timestamp (binary search over the ring)
+ * @note Must be called with the history lock held
+ *
+ * @param[in] ctx Pointer to the SensorHistory_t instance
+ * @param[in] ts_ms Timestamp to search for
+ * @return Position of the sample counted from the oldest one (ctx->count if there is no such sample)
+ */
+STATIC uint32_t sensor_history_lower_bound(const SensorHistory_t* ctx, const int64_t ts_ms);
+
+/**
+ * @brief Open the backing file and load its last cfg.capacity records into the ring (through a read-only mapping)
+ * @note A file with an unsupported header is recreated, a torn record at the end is cut off
+ *
+ * @param[in, out] ctx Pointer to the SensorHistory_t instance (with an empty ring)
+ * @return SENSOR_HISTORY_ERR_OK on success, SENSOR_HISTORY_ERR_FILE_FAILURE otherwise
+ */
+STATIC SensorHistoryError_t sensor_history_load(SensorHistory_t* ctx);
+
+/**
+ * @brief Replace the backing file with a new one holding the ring content only
+ * @note Must be called with the history lock held
+ *
+ * @param[in, out] ctx Pointer to the SensorHistory_t instance
+ * @return SENSOR_HISTORY_ERR_OK on success, SENSOR_HISTORY_ERR_FILE_FAILURE otherwise (the old file is kept)
+ */
+STATIC SensorHistoryError_t sensor_history_compact(SensorHistory_t* ctx);
+
+SensorHistoryError_t sensor_history_init(SensorHistory_t* ctx, const SensorHistoryConfig_t cfg) {
+    if(!ctx) {
+        return SENSOR_HISTORY_ERR_NULL_ARGUMENT;
+    } else if(cfg.capacity == 0 ||
+    (cfg.path && strlen(cfg.path) >= SENSOR_HISTORY_PATH_MAX - strlen(SENSOR_HISTORY_TMP_SUFFIX))) {
+        return SENSOR_HISTORY_ERR_INVALID_ARGUMENT;
+    }
+
+    // Zero-out the SensorHistory_t struct on init
+    memset(ctx, 0, sizeof(SensorHistory_t));
+    ctx->fd = -1;
+
+    // All columns are allocated at once: the timestamps first, the value columns right after them
+    ctx->ts_ms = (int64_t*)calloc(cfg.capacity, sizeof(int64_t) + SENSOR_HISTORY_QTY_COUNT * sizeof(int32_t));
+    if(!ctx->ts_ms) {
+        log_error("calloc() returned NULL when allocating the history (capacity: %u)", cfg.capacity);
+        return SENSOR_HISTORY_ERR_MALLOC_FAILURE;
+    }
+    for(int i = 0; i < SENSOR_HISTORY_QTY_COUNT; ++i) {
+        ctx->values[i] = (int32_t*)(ctx->ts_ms + cfg.capacity) + (size_t)i * cfg.capacity;
+    }
+
+    int ret = pthread_mutex_init(&ctx->lock, NULL);
+    if(ret != 0) {
+        log_error("pthread_mutex_init() returned %d", ret);
+        free(ctx->ts_ms);
+        memset(ctx, 0, sizeof(SensorHistory_t));
+        return SENSOR_HISTORY_ERR_PTHREAD_FAILURE;
+    }
+
+    ctx->cfg = cfg;
+    if(cfg.path) {
+        snprintf(ctx->path, SENSOR_HISTORY_PATH_MAX, "%s", cfg.path);
+        ctx->cfg.path = ctx->path;
+
+        SensorHistoryError_t err = sensor_history_load(ctx);
+        if(err != SENSOR_HISTORY_ERR_OK) {
+            pthread_mutex_destroy(&ctx->lock);
+            free(ctx->ts_ms);
+            memset(ctx, 0, sizeof(SensorHistory_t));
+            return err;
+        }
+    }
+
+    log_debug("history initialized (capacity: %u, loaded: %u, file: %s)", cfg.capacity, ctx->count,
+    cfg.path ? ctx->path : "none");
+    return SENSOR_HISTORY_ERR_OK;
+}
+
+SensorHistoryError_t sensor_history_append(SensorHistory_t* ctx, const int64_t ts_ms, const SensorReading_t* reading) {
+    if(!ctx || !reading) {
+        return SENSOR_HISTORY_ERR_NULL_ARGUMENT;
+    }
+
+    int32_t values[SENSOR_HISTORY_QTY_COUNT];
+    values[SENSOR_HISTORY_TEMP] = (reading->fields & SENSOR_FIELD_TEMP) ? reading->temp_cC : SENSOR_HISTORY_NO_VALUE;
+    values[SENSOR_HISTORY_HUM] = (reading->fields & SENSOR_FIELD_HUM) ? (int32_t)reading->hum_q10 : SENSOR_HISTORY_NO_VALUE;
+    values[SENSOR_HISTORY_PRESS] =
+    (reading->fields & SENSOR_FIELD_PRESS) ? (int32_t)reading->press_q8 : SENSOR_HISTORY_NO_VALUE;
+
+    SensorHistoryError_t err = SENSOR_HISTORY_ERR_OK;
+
+    // Critical section (shared with the queries)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_HISTORY_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("history lock taken");
+
+    if(!sensor_history_push(ctx, ts_ms, values)) {
+        err = SENSOR_HISTORY_ERR_DROPPED;
+    } else if(ctx->fd >= 0) {
+        SensorHistoryRecord_t rec = { .ts_ms = ts_ms };
+        memcpy(rec.values, values, sizeof(values));
+        if(write(ctx->fd, &rec, sizeof(rec)) != sizeof(rec)) {
+            log_error("failed to append to %s (err: %s)", ctx->path, strerror(errno));
+            // Cut off a partially written record, so that the next appends start at a record boundary
+            if(ftruncate(ctx->fd, sizeof(SensorHistoryFileHeader_t) + (off_t)ctx->file_records * sizeof(rec)) < 0) {
+                log_error("ftruncate() failed (err: %s)", strerror(errno));
+            }
+            err = SENSOR_HISTORY_ERR_FILE_FAILURE;
+        } else if(++ctx->file_records >= 2 * ctx->cfg.capacity && ctx->file_records % ctx->cfg.capacity == 0) {
+            // Compaction retried after another cfg.capacity records if it fails
+            err = sensor_history_compact(ctx);
+        }
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_HISTORY_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("history lock released");
+
+    return err;
+}
+
+SensorHistoryError_t sensor_history_query(SensorHistory_t* ctx,
+const SensorHistoryQty_t qty,
+const int64_t from_ms,
+const int64_t to_ms,
+const uint32_t bucket_ms,
+SensorHistoryBucket_t* buckets,
+const size_t max_buckets,
+size_t* count) {
+    if(!ctx || !buckets || !count) {
+        return SENSOR_HISTORY_ERR_NULL_ARGUMENT;
+    } else if((unsigned)qty >= SENSOR_HISTORY_QTY_COUNT || bucket_ms == 0 || to_ms <= from_ms) {
+        return SENSOR_HISTORY_ERR_INVALID_ARGUMENT;
+    }
+
+    uint64_t bucket_count = ((uint64_t)(to_ms - from_ms) + bucket_ms - 1) / bucket_ms;
+    if(bucket_count > max_buckets) {
+        return SENSOR_HISTORY_ERR_INVALID_ARGUMENT;
+    }
+    for(size_t i = 0; i < bucket_count; ++i) {
+        buckets[i] = (SensorHistoryBucket_t){ .start_ms = from_ms + (int64_t)i * bucket_ms };
+    }
+
+    // Critical section (shared with the sampler)
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return SENSOR_HISTORY_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("history lock taken");
+
+    // Only the timestamps and the column of the requested quantity are scanned
+    const int32_t* column = ctx->values[qty];
+    for(uint32_t i = sensor_history_lower_bound(ctx, from_ms); i < ctx->count; ++i) {
+        uint32_t idx = (ctx->head + i) % ctx->cfg.capacity;
+        if(ctx->ts_ms[idx] >= to_ms) {
+            break;
+        }
+        int32_t value = column[idx];
+        if(value == SENSOR_HISTORY_NO_VALUE) {
+            continue;
+        }
+
+        SensorHistoryBucket_t* b = &buckets[(ctx->ts_ms[idx] - from_ms) / bucket_ms];
+        if(b->count == 0 || value < b->min) {
+            b->min = value;
+        }
+        if(b->count == 0 || value > b->max) {
+            b->max = value;
+        }
+        b->sum += value;
+        b->count++;
+    }
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+        return SENSOR_HISTORY_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("history lock released");
+
+    for(size_t i = 0; i < bucket_count; ++i) {
+        buckets[i].avg = (buckets[i].count > 0) ? (int32_t)(buckets[i].sum / buckets[i].count) : 0;
+    }
+    *count = (size_t)bucket_count;
+
+    return SENSOR_HISTORY_ERR_OK;
+}
+
+uint32_t sensor_history_count(SensorHistory_t* ctx) {
+    if(!ctx) {
+        return 0;
+    }
+
+    int ret = pthread_mutex_lock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_lock() returned %d", ret);
+        return 0;
+    }
+    log_debug("history lock taken");
+
+    uint32_t count = ctx->count;
+
+    ret = pthread_mutex_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_mutex_unlock() returned %d", ret);
+    }
+    log_debug("history lock released");
+
+    return count;
+}
+
+SensorHistoryError_t sensor_history_deinit(SensorHistory_t* ctx) {
+    if(!ctx) {
+        return SENSOR_HISTORY_ERR_NULL_ARGUMENT;
+    } else if(!ctx->ts_ms) {
+        return SENSOR_HISTORY_ERR_OK; // Not initialized
+    }
+
+    SensorHistoryError_t err = SENSOR_HISTORY_ERR_OK;
+    if(ctx->fd >= 0 && close(ctx->fd) < 0) {
+        log_error("close() failed (err: %s)", strerror(errno));
+        err = SENSOR_HISTORY_ERR_FILE_FAILURE;
+    }
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx->ts_ms);
+
+    // Zero-out the SensorHistory_t struct on deinit
+    memset(ctx, 0, sizeof(SensorHistory_t));
+
+    return err;
+}
+
+STATIC bool sensor_history_push(SensorHistory_t* ctx, const int64_t ts_ms, const int32_t* values) {
+    if(ctx->count > 0) {
+        int64_t last_ms = ctx->ts_ms[(ctx->head + ctx->count - 1) % ctx->cfg.capacity];
+        if(ts_ms < last_ms || ts_ms - last_ms < (int64_t)ctx->cfg.interval_ms) {
+            return false;
+        }
+    }
+
+    uint32_t idx = (ctx->head + ctx->count) % ctx->cfg.capacity;
+    ctx->ts_ms[idx] = ts_ms;
+    for(int i = 0; i < SENSOR_HISTORY_QTY_COUNT; ++i) {
+        ctx->values[i][idx] = values[i];
+    }
+
+    if(ctx->count < ctx->cfg.capacity) {
+        ctx->count++;
+    } else {
+        ctx->head = (ctx->head + 1) % ctx->cfg.capacity; // The oldest sample has been overwritten
+    }
+
+    return true;
+}
+
+STATIC uint32_t sensor_history_lower_bound(const SensorHistory_t* ctx, const int64_t ts_ms) {
+    uint32_t lo = 0, hi = ctx->count;
+    while(lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(ctx->ts_ms[(ctx->head + mid) % ctx->cfg.capacity] < ts_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+STATIC SensorHistoryError_t sensor_history_load(SensorHistory_t* ctx) {
+    int fd = open(ctx->path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        log_error("failed to open %s (err: %s)", ctx->path, strerror(errno));
+        return SENSOR_HISTORY_ERR_FILE_FAILURE;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        log_error("fstat() failed (file: %s, err: %s)", ctx->path, strerror(errno));
+        close(fd);
+        return SENSOR_HISTORY_ERR_FILE_FAILURE;
+    }
+
+    // Load the newest records without reading the whole file into a buffer (the mapping is dropped right away)
+    bool valid = false;
+    size_t records = 0;
+    if((size_t)st.st_size >= sizeof(SensorHistoryFileHeader_t)) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED) {
+            log_error("mmap() failed (file: %s, err: %s)", ctx->path, strerror(errno));
+            close(fd);
+            return SENSOR_HISTORY_ERR_FILE_FAILURE;
+        }
+
+        const SensorHistoryFileHeader_t* hdr = (const SensorHistoryFileHeader_t*)map;
+        valid = hdr->magic == SENSOR_HISTORY_FILE_MAGIC && hdr->version == SENSOR_HISTORY_FILE_VERSION &&
+        hdr->record_size == sizeof(SensorHistoryRecord_t);
+        if(valid) {
+            records = ((size_t)st.st_size - sizeof(SensorHistoryFileHeader_t)) / sizeof(SensorHistoryRecord_t);
+            const SensorHistoryRecord_t* recs = (const SensorHistoryRecord_t*)(hdr + 1);
+            for(size_t i = (records > ctx->cfg.capacity) ? records - ctx->cfg.capacity : 0; i < records; ++i) {
+                sensor_history_push(ctx, recs[i].ts_ms, recs[i].values);
+            }
+        } else {
+            log_error("unsupported history file %s (recreated)", ctx->path);
+        }
+        munmap(map, (size_t)st.st_size);
+    }
+
+    // New appends have to start at a record boundary (a torn record or an unsupported content is dropped)
+    off_t expected = valid ? (off_t)(sizeof(SensorHistoryFileHeader_t) + records * sizeof(SensorHistoryRecord_t)) : 0;
+    if(st.st_size != expected && ftruncate(fd, expected) < 0) {
+        log_error("ftruncate() failed (file: %s, err: %s)", ctx->path, strerror(errno));
+        close(fd);
+        return SENSOR_HISTORY_ERR_FILE_FAILURE;
+    }
+    if(!valid) {
+        SensorHistoryFileHeader_t hdr = { .magic = SENSOR_HISTORY_FILE_MAGIC,
+            .version = SENSOR_HISTORY_FILE_VERSION,
+            .record_size = sizeof(SensorHistoryRecord_t) };
+        if(write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+            log_error("failed to write the header of %s (err: %s)", ctx->path, strerror(errno));
+            close(fd);
+            return SENSOR_HISTORY_ERR_FILE_FAILURE;
+        }
+    }
+
+    ctx->fd = fd;
+    ctx->file_records = (uint32_t)records;
+    return SENSOR_HISTORY_ERR_OK;
+}
+
+STATIC SensorHistoryError_t sensor_history_compact(SensorHistory_t* ctx) {
+    char tmp_path[SENSOR_HISTORY_PATH_MAX + sizeof(SENSOR_HISTORY_TMP_SUFFIX)];
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", ctx->path, SENSOR_HISTORY_TMP_SUFFIX);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        log_error("failed to open %s (err: %s)", tmp_path, strerror(errno));
+        return SENSOR_HISTORY_ERR_FILE_FAILURE;
+    }
+
+    // Header followed by the ring content (oldest first), written in chunks
+    SensorHistoryFileHeader_t hdr = { .magic = SENSOR_HISTORY_FILE_MAGIC,
+        .version = SENSOR_HISTORY_FILE_VERSION,
+        .record_size = sizeof(SensorHistoryRecord_t) };
+    bool ok = (write(fd, &hdr, sizeof(hdr)) == sizeof(hdr));
+    SensorHistoryRecord_t chunk[SENSOR_HISTORY_COMPACT_CHUNK];
+    for(uint32_t i = 0; ok && i < ctx->count; i += SENSOR_HISTORY_COMPACT_CHUNK) {
+        uint32_t n = (ctx->count - i < SENSOR_HISTORY_COMPACT_CHUNK) ? ctx->count - i : SENSOR_HISTORY_COMPACT_CHUNK;
+        for(uint32_t j = 0; j < n; ++j) {
+            uint32_t idx = (ctx->head + i + j) % ctx->cfg.capacity;
+            chunk[j] = (SensorHistoryRecord_t){ .ts_ms = ctx->ts_ms[idx] };
+            for(int q = 0; q < SENSOR_HISTORY_QTY_COUNT; ++q) {
+                chunk[j].values[q] = ctx->values[q][idx];
+            }
+        }
+        ok = (write(fd, chunk, n * sizeof(chunk[0])) == (ssize_t)(n * sizeof(chunk[0])));
+    }
+
+    // The new file replaces the old one only once it is complete on disk
+    if(!ok || fdatasync(fd) < 0 || rename(tmp_path, ctx->path) < 0) {
+        log_error("failed to compact %s (err: %s)", ctx->path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return SENSOR_HISTORY_ERR_FILE_FAILURE;
+    }
+
+    close(ctx->fd);
+    ctx->fd = fd;
+    ctx->file_records = ctx->count;
+    log_debug("history file %s compacted (records: %u)", ctx->path, ctx->count);
+
+    return SENSOR_HISTORY_ERR_OK;
+}
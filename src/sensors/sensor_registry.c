@@ -0,0 +1,271 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
+
+#include "sensors/sensor_registry.h"
+
+#include <string.h> // For: memset
+#include <unistd.h> // For: usleep
+
+#include "utils/common.h"
+#include "utils/log.h"
+
+/**
+ * @brief Check whether a sensor with the given address is already registered on the bus
+ *
+ * @param[in] ctx Pointer to the SensorRegistry_t instance
+ * @param[in] hw_ctx Bus of the sensor
+ * @param[in] addr Address of the sensor
+ * @return true if the sensor is registered, false otherwise
+ */
+STATIC bool sensor_registry_contains(const SensorRegistry_t* ctx, const HwInterface_t* hw_ctx, const uint8_t addr);
+
+SensorError_t sensor_registry_init(SensorRegistry_t* ctx) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    // Zero-out the registry on init
+    memset(ctx, 0, sizeof(SensorRegistry_t));
+
+    return SENSOR_ERR_OK;
+}
+
+SensorError_t sensor_registry_add(SensorRegistry_t* ctx,
+const SensorDriver_t* driver,
+const SensorInfo_t info,
+HwInterface_t* hw_ctx,
+size_t* id) {
+    if(!ctx || !driver || !hw_ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(sensor_registry_contains(ctx, hw_ctx, info.addr)) {
+        return SENSOR_ERR_ALREADY_REGISTERED;
+    } else if(ctx->count >= SENSOR_REGISTRY_MAX_SENSORS) {
+        return SENSOR_ERR_REGISTRY_FULL;
+    }
+
+    Sensor_t* sensor = &ctx->sensors[ctx->count];
+    memset(sensor, 0, sizeof(Sensor_t));
+    sensor->driver = driver;
+    sensor->info = info;
+    sensor->hw_ctx = hw_ctx;
+    if(id) {
+        *id = ctx->count;
+    }
+    ctx->count++;
+
+    log_debug("%s sensor registered (id: %zu, addr: 0x%02X)", driver->name, ctx->count - 1, info.addr);
+    return SENSOR_ERR_OK;
+}
+
+SensorError_t
+sensor_registry_discover(SensorRegistry_t* ctx, const SensorDriver_t* driver, HwInterface_t* hw_ctx, size_t* found) {
+    if(!ctx || !driver || !hw_ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    size_t added = 0;
+    SensorError_t err = SENSOR_ERR_OK;
+    for(size_t i = 0; i < driver->i2c_addr_count; ++i) {
+        uint8_t addr = driver->i2c_addrs[i];
+        if(sensor_registry_contains(ctx, hw_ctx, addr) || driver->probe(hw_ctx, addr) != SENSOR_ERR_OK) {
+            continue;
+        }
+
+        size_t id;
+        SensorInfo_t info = { .addr = addr, .if_type = HW_INTERFACE_I2C };
+        err = sensor_registry_add(ctx, driver, info, hw_ctx, &id);
+        if(err != SENSOR_ERR_OK) {
+            log_error("failed to register the discovered %s sensor (addr: 0x%02X, err: %d)", driver->name, addr, err);
+            break;
+        }
+        ctx->sensors[id].discovered = true;
+        added++;
+        log_info("discovered %s sensor (id: %zu, addr: 0x%02X)", driver->name, id, addr);
+    }
+
+    if(found) {
+        *found = added;
+    }
+    return err;
+}
+
+SensorError_t sensor_registry_init_all(SensorRegistry_t* ctx, size_t* initialized) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    SensorError_t first_err = SENSOR_ERR_OK;
+    bool started[SENSOR_REGISTRY_MAX_SENSORS] = { false };
+    uint32_t reset_delay_ms = 0;
+
+    // First phase: trigger the resets of all sensors (without waiting for any of them)
+    for(size_t i = 0; i < ctx->count; ++i) {
+        Sensor_t* sensor = &ctx->sensors[i];
+        if(sensor->is_initialized) {
+            continue;
+        }
+
+        SensorError_t err = sensor->driver->init_start(&sensor->dev, sensor->info.addr, sensor->hw_ctx);
+        if(err != SENSOR_ERR_OK) {
+            log_error("failed to reset %s sensor #%zu (addr: 0x%02X, err: %d)", sensor->driver->name, i, sensor->info.addr, err);
+            first_err = (first_err == SENSOR_ERR_OK) ? err : first_err;
+            continue;
+        }
+        started[i] = true;
+        if(sensor->driver->reset_delay_ms > reset_delay_ms) {
+            reset_delay_ms = sensor->driver->reset_delay_ms;
+        }
+    }
+
+    // Wait once for all resets to complete (the longest delay required by any of the drivers)
+    usleep((useconds_t)reset_delay_ms * 1000);
+
+    // Second phase: complete the init of all sensors which have been reset
+    size_t count = 0;
+    for(size_t i = 0; i < ctx->count; ++i) {
+        Sensor_t* sensor = &ctx->sensors[i];
+        if(!started[i]) {
+            count += sensor->is_initialized ? 1 : 0;
+            continue;
+        }
+
+        SensorError_t err = sensor->driver->init_complete(&sensor->dev);
+        if(err != SENSOR_ERR_OK) {
+            log_error("failed to initialize %s sensor #%zu (addr: 0x%02X, err: %d)", sensor->driver->name, i,
+            sensor->info.addr, err);
+            first_err = (first_err == SENSOR_ERR_OK) ? err : first_err;
+            continue;
+        }
+        sensor->is_initialized = true;
+        count++;
+
+        // The drivers start with their default profile (high-precision)
+        if(sensor->info.profile != SENSOR_PROFILE_HIGH_PRECISION) {
+            err = sensor_registry_set_profile(ctx, i, sensor->info.profile);
+            if(err != SENSOR_ERR_OK) {
+                log_error("failed to apply the %s profile to sensor #%zu (err: %d)", sensor_profile_name(sensor->info.profile),
+                i, err);
+                first_err = (first_err == SENSOR_ERR_OK) ? err : first_err;
+            }
+        }
+    }
+
+    log_debug("%zu of %zu sensors initialized (reset delay: %u ms)", count, ctx->count, reset_delay_ms);
+    if(initialized) {
+        *initialized = count;
+    }
+    return first_err;
+}
+
+SensorError_t
+sensor_registry_set_sample_cb(SensorRegistry_t* ctx, const size_t id, SensorSampleCb_t on_sample, void* arg) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(id >= ctx->count) {
+        return SENSOR_ERR_NOT_FOUND;
+    }
+
+    ctx->sensors[id].on_sample = on_sample;
+    ctx->sensors[id].on_sample_arg = arg;
+    return SENSOR_ERR_OK;
+}
+
+SensorError_t sensor_registry_start_samplers(SensorRegistry_t* ctx, const uint32_t max_age_ms) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    SensorError_t first_err = SENSOR_ERR_OK;
+    for(size_t i = 0; i < ctx->count; ++i) {
+        Sensor_t* sensor = &ctx->sensors[i];
+        if(!sensor->is_initialized || !sensor->driver->sampler_start) {
+            continue;
+        }
+
+        // Sensors without a running sampler are read on demand
+        SensorError_t err = sensor->driver->sampler_start(&sensor->dev, max_age_ms, sensor->on_sample, sensor->on_sample_arg);
+        if(err != SENSOR_ERR_OK) {
+            log_error("failed to start the sampler of sensor #%zu (err: %d); it will be read on demand", i, err);
+            first_err = (first_err == SENSOR_ERR_OK) ? err : first_err;
+        }
+    }
+
+    return first_err;
+}
+
+const Sensor_t* sensor_registry_get(const SensorRegistry_t* ctx, const size_t id) {
+    if(!ctx || id >= ctx->count) {
+        return NULL;
+    }
+
+    return &ctx->sensors[id];
+}
+
+SensorError_t sensor_registry_read(SensorRegistry_t* ctx, const size_t id, SensorReading_t* reading) {
+    if(!ctx || !reading) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if(id >= ctx->count) {
+        return SENSOR_ERR_NOT_FOUND;
+    } else if(!ctx->sensors[id].is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    }
+
+    Sensor_t* sensor = &ctx->sensors[id];
+    return sensor->driver->read(&sensor->dev, reading);
+}
+
+SensorError_t sensor_registry_set_profile(SensorRegistry_t* ctx, const size_t id, const SensorProfile_t profile) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    } else if((unsigned)profile >= SENSOR_PROFILE_COUNT) {
+        return SENSOR_ERR_INVALID_ARGUMENT;
+    } else if(id >= ctx->count) {
+        return SENSOR_ERR_NOT_FOUND;
+    } else if(!ctx->sensors[id].is_initialized) {
+        return SENSOR_ERR_NOT_INITIALIZED;
+    } else if(!ctx->sensors[id].driver->set_profile) {
+        return SENSOR_ERR_NOT_SUPPORTED;
+    }
+
+    Sensor_t* sensor = &ctx->sensors[id];
+    SensorError_t err = sensor->driver->set_profile(&sensor->dev, profile);
+    if(err == SENSOR_ERR_OK) {
+        atomic_store(&sensor->profile, (int)profile);
+    }
+
+    return err;
+}
+
+SensorError_t sensor_registry_deinit(SensorRegistry_t* ctx) {
+    if(!ctx) {
+        return SENSOR_ERR_NULL_ARGUMENT;
+    }
+
+    SensorError_t first_err = SENSOR_ERR_OK;
+    for(size_t i = 0; i < ctx->count; ++i) {
+        Sensor_t* sensor = &ctx->sensors[i];
+        if(!sensor->is_initialized) {
+            continue;
+        }
+
+        SensorError_t err = sensor->driver->deinit(&sensor->dev);
+        if(err != SENSOR_ERR_OK) {
+            log_error("failed to deinitialize sensor #%zu (err: %d)", i, err);
+            first_err = (first_err == SENSOR_ERR_OK) ? err : first_err;
+        }
+    }
+
+    // Zero-out the registry on deinit
+    memset(ctx, 0, sizeof(SensorRegistry_t));
+
+    return first_err;
+}
+
+STATIC bool sensor_registry_contains(const SensorRegistry_t* ctx, const HwInterface_t* hw_ctx, const uint8_t addr) {
+    for(size_t i = 0; i < ctx->count; ++i) {
+        if(ctx->sensors[i].hw_ctx == hw_ctx && ctx->sensors[i].info.addr == addr) {
+            return true;
+        }
+    }
+
+    return false;
+}
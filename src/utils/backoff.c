@@ -0,0 +1,37 @@
+#include "utils/backoff.h"
+
+#include <string.h> // For: memset
+
+
+BackoffError_t backoff_init(Backoff_t* ctx, const uint32_t min_ms, const uint32_t max_ms, const uint32_t stable_ms) {
+    if(!ctx) {
+        return BACKOFF_ERR_NULL_ARGUMENT;
+    } else if(min_ms == 0 || max_ms < min_ms) {
+        return BACKOFF_ERR_INVALID_ARG;
+    }
+
+    memset(ctx, 0, sizeof(Backoff_t));
+    ctx->min_ms = min_ms;
+    ctx->max_ms = max_ms;
+    ctx->stable_ms = stable_ms;
+    ctx->next_ms = min_ms;
+
+    return BACKOFF_ERR_OK;
+}
+
+uint32_t backoff_next(Backoff_t* ctx, const int64_t now_ms) {
+    if(!ctx) {
+        return 0;
+    }
+
+    // Start from scratch if the operation has been running long enough since the last failure
+    if(ctx->failed && now_ms - ctx->last_failure_ms >= (int64_t)ctx->stable_ms) {
+        ctx->next_ms = ctx->min_ms;
+    }
+    ctx->failed = true;
+    ctx->last_failure_ms = now_ms;
+
+    uint32_t delay = ctx->next_ms;
+    ctx->next_ms = (delay > ctx->max_ms / 2) ? ctx->max_ms : delay * 2; // Double without overflowing
+    return delay;
+}
@@ -1,16 +1,54 @@
+#define LOG_MODULE LOG_MODULE_LIST
+
 #include "utils/list.h"
 
-#include <string.h> // For: memmove
+#include <stdalign.h> // For: alignof
+#include <stddef.h>   // For: max_align_t
+#include <string.h>   // For: memmove
 
 #include "utils/common.h"
 #include "utils/log.h"
 
+/**
+ * @brief Default node allocator (heap)
+ * @param[in]  arg  Unused
+ * @param[in]  size  Number of bytes to allocate
+ * @return Pointer to the allocated memory, NULL on failure
+ */
+STATIC void* llist_heap_alloc(void* arg, size_t size);
+
+/**
+ * @brief Default node deallocator (heap)
+ * @param[in]  arg  Unused
+ * @param[in]  ptr  Memory returned by llist_heap_alloc
+ */
+STATIC void llist_heap_free(void* arg, void* ptr);
+
+/**
+ * @brief Allocate a node with a copy of the data (from the pool if the list has one, the allocator otherwise)
+ * @param[in, out]  ctx  Pointer to the List instance (write lock held if the list has a pool)
+ * @param[in]  data  Pointer to the data to be copied into the node
+ * @param[in]  length  Size in bytes of the data
+ * @return Pointer to the new node, NULL on failure
+ */
+STATIC ListNode_t* llist_new_node(List_t* ctx, const void* data, const size_t length);
+
+/**
+ * @brief Release the memory of a node (node + data) to the pool or to the list allocator
+ * @param[in, out]  ctx  Pointer to the List instance (write lock held)
+ * @param[in]  node  Node to release
+ */
+STATIC void llist_free_node(List_t* ctx, ListNode_t* node);
+
 STATIC ListError_t llist_push(List_t* ctx, void* data, size_t length);
 STATIC ListNode_t* llist_get_head(List_t* ctx);
 STATIC ListNode_t* llist_get_tail(List_t* ctx);
 STATIC int32_t llist_get_length(List_t* ctx);
 STATIC ListError_t llist_remove(List_t* ctx, const void* data);
 STATIC ListError_t llist_traverse(List_t* ctx, ListError_t (*func)(void* data));
+STATIC ListError_t llist_foreach_begin(List_t* ctx, ListIter_t* it);
+STATIC const void* llist_foreach_next(List_t* ctx, ListIter_t* it);
+STATIC ListError_t llist_foreach_end(List_t* ctx, ListIter_t* it);
 STATIC ListError_t llist_deinit(List_t* ctx);
 
 
@@ -22,31 +60,36 @@ STATIC ListError_t llist_push(List_t* ctx, void* data, size_t length) {
         return LIST_ERR_INCORRECT_ARGUMENT;
     }
 
-    // Allocate and initialize memory for a new node and for its data
-    ListNode_t* new_node = (ListNode_t*)calloc(1, sizeof(ListNode_t));
-    if(!new_node) {
-        free(new_node);
-        log_error("malloc() returned NULL on new node creation");
-        return LIST_ERR_MALLOC_FAILURE;
-    }
-    new_node->data = calloc(1, length);
-    if(!(new_node->data)) {
-        free(new_node->data);
-        free(new_node);
-        log_error("malloc() returned NULL when allocating memory for new_node->data");
-        return LIST_ERR_MALLOC_FAILURE;
+    // Allocate the new node before taking the lock, unless it comes from the pool (protected by the write lock)
+    ListNode_t* new_node = NULL;
+    if(!ctx->pool.slab) {
+        new_node = llist_new_node(ctx, data, length);
+        if(!new_node) {
+            log_error("Allocator returned NULL on new node creation");
+            return LIST_ERR_MALLOC_FAILURE;
+        }
     }
-    memmove(new_node->data, data, length);
-    new_node->next = NULL;
 
     // Add the new node to the end of the list (Critical section!)
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_wrlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_wrlock() returned %d", ret);
+        if(new_node) {
+            ctx->allocator.free(ctx->allocator.arg, new_node);
+        }
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock taken");
 
+    if(!new_node) {
+        new_node = llist_new_node(ctx, data, length);
+        if(!new_node) {
+            pthread_rwlock_unlock(&ctx->lock);
+            log_error("Allocator returned NULL on new node creation");
+            return LIST_ERR_MALLOC_FAILURE;
+        }
+    }
+
     for(ListNode_t** node = &ctx->head;; node = &((*node)->next)) {
         if(*node == NULL) {
             *node = new_node;
@@ -54,9 +97,9 @@ STATIC ListError_t llist_push(List_t* ctx, void* data, size_t length) {
         }
     }
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock released");
@@ -71,17 +114,17 @@ STATIC ListNode_t* llist_get_head(List_t* ctx) {
     }
 
     // Retrieve the head node (or NULL if the list is empty) (Critical section!)
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_rdlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_rdlock() returned %d", ret);
         return NULL;
     }
 
     ListNode_t* head = ctx->head;
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return NULL;
     }
 
@@ -96,9 +139,9 @@ STATIC ListNode_t* llist_get_tail(List_t* ctx) {
 
     // Retrieve data from the tail node (or NULL if the list is empty) (Critical section!)
     ListNode_t* tail;
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_rdlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_rdlock() returned %d", ret);
         return NULL;
     }
 
@@ -113,9 +156,9 @@ STATIC ListNode_t* llist_get_tail(List_t* ctx) {
         }
     }
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return NULL;
     }
 
@@ -130,9 +173,9 @@ STATIC int32_t llist_get_length(List_t* ctx) {
 
     // Count the number of nodes in the Linked List (Critical section!)
     int32_t node_count = 0;
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_rdlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_rdlock() returned %d", ret);
         return -1;
     }
 
@@ -140,9 +183,9 @@ STATIC int32_t llist_get_length(List_t* ctx) {
         ++node_count;
     }
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return -1;
     }
 
@@ -156,9 +199,9 @@ STATIC ListError_t llist_remove(List_t* ctx, const void* data) {
     }
 
     // Find and remove the first node whose data is equal to the one provided in args (Critical section!)
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_wrlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_wrlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock taken");
@@ -185,13 +228,12 @@ STATIC ListError_t llist_remove(List_t* ctx, const void* data) {
 
     // Clean the resources used by the removed node
     if(to_remove) {
-        free(to_remove->data);
-        free(to_remove);
+        llist_free_node(ctx, to_remove);
     }
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock released");
@@ -207,9 +249,9 @@ STATIC ListError_t llist_traverse(List_t* ctx, ListError_t (*func)(void* data))
 
     // Apply func to the data of each node (Critical section!)
     ListError_t err = LIST_ERR_OK;
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_wrlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_wrlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock taken");
@@ -221,9 +263,9 @@ STATIC ListError_t llist_traverse(List_t* ctx, ListError_t (*func)(void* data))
         }
     }
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock released");
@@ -231,15 +273,68 @@ STATIC ListError_t llist_traverse(List_t* ctx, ListError_t (*func)(void* data))
     return err;
 }
 
+STATIC ListError_t llist_foreach_begin(List_t* ctx, ListIter_t* it) {
+    if(!ctx || !it) {
+        log_error("NULL ptr provided to llist_foreach_begin");
+        return LIST_ERR_NULL_ARGUMENT;
+    }
+
+    // Take the lock for reading, it is held until llist_foreach_end (Critical section!)
+    int ret = pthread_rwlock_rdlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_rwlock_rdlock() returned %d", ret);
+        it->next = NULL;
+        it->locked = false;
+        return LIST_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("llist read lock taken");
+
+    it->next = ctx->head;
+    it->locked = true;
+
+    return LIST_ERR_OK;
+}
+
+STATIC const void* llist_foreach_next(List_t* ctx, ListIter_t* it) {
+    if(!ctx || !it || !it->locked || !it->next) {
+        return NULL;
+    }
+
+    ListNode_t* node = it->next;
+    it->next = node->next;
+
+    return node->data;
+}
+
+STATIC ListError_t llist_foreach_end(List_t* ctx, ListIter_t* it) {
+    if(!ctx || !it) {
+        log_error("NULL ptr provided to llist_foreach_end");
+        return LIST_ERR_NULL_ARGUMENT;
+    } else if(!it->locked) {
+        return LIST_ERR_OK;
+    }
+
+    it->next = NULL;
+    it->locked = false;
+    int ret = pthread_rwlock_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_rwlock_unlock() returned %d", ret);
+        return LIST_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("llist read lock released");
+
+    return LIST_ERR_OK;
+}
+
 STATIC ListError_t llist_deinit(List_t* ctx) {
     if(!ctx) {
         log_error("NULL ptr provided to llist_destroy");
         return LIST_ERR_NULL_ARGUMENT;
     }
 
-    int ret = pthread_mutex_lock(&ctx->lock);
+    int ret = pthread_rwlock_wrlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_lock() returned %d", ret);
+        log_error("pthread_rwlock_wrlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
 
@@ -247,23 +342,23 @@ STATIC ListError_t llist_deinit(List_t* ctx) {
     if(ctx->head != NULL) {
         for(ListNode_t* node = ctx->head; node != NULL;) {
             ListNode_t* next_node = node->next;
-            free(node->data);
-            free(node);
+            llist_free_node(ctx, node);
             node = next_node;
         }
     }
+    free(ctx->pool.slab); // No-op if the list has no pool
 
-    ret = pthread_mutex_unlock(&ctx->lock);
+    ret = pthread_rwlock_unlock(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_unlock() returned %d", ret);
+        log_error("pthread_rwlock_unlock() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
     log_debug("llist lock released");
 
-    // Destroy the lock (@TODO: Improve mutex destroy mechanism, e.g. add a global protection variable)
-    ret = pthread_mutex_destroy(&ctx->lock);
+    // Destroy the lock (@TODO: Improve rwlock destroy mechanism, e.g. add a global protection variable)
+    ret = pthread_rwlock_destroy(&ctx->lock);
     if(ret != 0) {
-        log_error("pthread_mutex_destroy() returned %d", ret);
+        log_error("pthread_rwlock_destroy() returned %d", ret);
         return LIST_ERR_PTHREAD_FAILURE;
     }
 
@@ -273,28 +368,143 @@ STATIC ListError_t llist_deinit(List_t* ctx) {
     return LIST_ERR_OK;
 }
 
+STATIC void* llist_heap_alloc(void* arg, size_t size) {
+    (void)arg;
+    return malloc(size);
+}
+
+STATIC void llist_heap_free(void* arg, void* ptr) {
+    (void)arg;
+    free(ptr);
+}
+
+STATIC ListNode_t* llist_new_node(List_t* ctx, const void* data, const size_t length) {
+    // The data is stored right after the node (single allocation)
+    const size_t size = sizeof(ListNode_t) + length;
+    ListNode_t* node = NULL;
+    ListPool_t* pool = &ctx->pool;
+    if(pool->slab && size <= pool->entry_size && pool->free_list) {
+        node = (ListNode_t*)pool->free_list;
+        pool->free_list = *(void**)node;
+        pool->free_count--;
+    } else {
+        if(pool->slab) {
+            pool->heap_count++; // Pool exhausted or the entry is too small, use the allocator instead
+        }
+        node = (ListNode_t*)ctx->allocator.alloc(ctx->allocator.arg, size);
+        if(!node) {
+            return NULL;
+        }
+    }
+
+    node->data = (uint8_t*)node + sizeof(ListNode_t);
+    memmove(node->data, data, length);
+    node->next = NULL;
+    return node;
+}
+
+STATIC void llist_free_node(List_t* ctx, ListNode_t* node) {
+    ListPool_t* pool = &ctx->pool;
+    if(!pool->slab || (uint8_t*)node < pool->slab || (uint8_t*)node >= pool->slab + pool->entry_size * pool->capacity) {
+        ctx->allocator.free(ctx->allocator.arg, node); // Not taken from the pool
+        return;
+    }
+
+    // Put the entry back to the free list
+    *(void**)node = pool->free_list;
+    pool->free_list = node;
+    pool->free_count++;
+}
+
 ListError_t llist_init(List_t* ctx, int (*cmp)(const void* a, const void* b)) {
+    return llist_init_with_allocator(ctx, cmp, NULL);
+}
+
+ListError_t llist_init_with_allocator(List_t* ctx, int (*cmp)(const void* a, const void* b), const ListAllocator_t* allocator) {
     if(!cmp || !ctx) {
         return LIST_ERR_NULL_ARGUMENT;
+    } else if(allocator && (!allocator->alloc || !allocator->free)) {
+        return LIST_ERR_NULL_ARGUMENT;
     }
 
     /* Populate data in the struct (cfg) and assign function pointers */
     ctx->head = NULL;
     ctx->compare_data = cmp;
+    memset(&ctx->pool, 0, sizeof(ListPool_t));
+    if(allocator) {
+        ctx->allocator = *allocator;
+    } else {
+        ctx->allocator = (ListAllocator_t){ .alloc = llist_heap_alloc, .free = llist_heap_free, .arg = NULL };
+    }
     ctx->push = llist_push;
     ctx->get_head = llist_get_head;
     ctx->get_tail = llist_get_tail;
     ctx->get_length = llist_get_length;
     ctx->remove = llist_remove;
     ctx->traverse = llist_traverse;
+    ctx->foreach_begin = llist_foreach_begin;
+    ctx->foreach_next = llist_foreach_next;
+    ctx->foreach_end = llist_foreach_end;
     ctx->deinit = llist_deinit;
 
-    // Initialize mutex for protecting ll-related critical sections
-    int err = pthread_mutex_init(&ctx->lock, NULL);
+    // Initialize rwlock for protecting ll-related critical sections
+    int err = pthread_rwlock_init(&ctx->lock, NULL);
     if(err != 0) {
-        log_error("pthread_mutex_init() returned %d", err);
+        log_error("pthread_rwlock_init() returned %d", err);
         return LIST_ERR_PTHREAD_FAILURE;
     }
 
     return LIST_ERR_OK;
 }
+
+ListError_t llist_pool_init(List_t* ctx, const size_t data_size, const size_t capacity) {
+    if(!ctx) {
+        return LIST_ERR_NULL_ARGUMENT;
+    } else if(data_size == 0 || capacity == 0) {
+        return LIST_ERR_INCORRECT_ARGUMENT;
+    }
+
+    // Round the entries up so that each of them is suitably aligned
+    const size_t align = alignof(max_align_t);
+    const size_t entry_size = (sizeof(ListNode_t) + data_size + align - 1) / align * align;
+    uint8_t* slab = (uint8_t*)malloc(entry_size * capacity);
+    if(!slab) {
+        log_error("malloc() returned NULL when allocating the pool slab");
+        return LIST_ERR_MALLOC_FAILURE;
+    }
+
+    // Link all entries into the free list
+    void* free_list = NULL;
+    for(size_t i = capacity; i > 0; i--) {
+        void* entry = slab + (i - 1) * entry_size;
+        *(void**)entry = free_list;
+        free_list = entry;
+    }
+
+    // Attach the pool to the list (Critical section!)
+    int ret = pthread_rwlock_wrlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_rwlock_wrlock() returned %d", ret);
+        free(slab);
+        return LIST_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("llist lock taken");
+
+    ListError_t err = LIST_ERR_OK;
+    if(ctx->pool.slab) {
+        err = LIST_ERR_INCORRECT_ARGUMENT; // The nodes already taken from the pool would be lost
+        free(slab);
+    } else {
+        ctx->pool = (ListPool_t){ .slab = slab, .entry_size = entry_size, .capacity = capacity, .free_count = capacity,
+            .free_list = free_list, .heap_count = 0 };
+    }
+
+    ret = pthread_rwlock_unlock(&ctx->lock);
+    if(ret != 0) {
+        log_error("pthread_rwlock_unlock() returned %d", ret);
+        return LIST_ERR_PTHREAD_FAILURE;
+    }
+    log_debug("llist lock released");
+
+    return err;
+}
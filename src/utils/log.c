@@ -2,41 +2,466 @@
 
 #include <pthread.h>
 #include <stdarg.h>      // For: variadic function utils
-#include <stdio.h>       // For: sprintf, vsprintf etc.
-#include <string.h>      // For: strrchr()
+#include <stdatomic.h>   // For: atomic types and operations
+#include <stdbool.h>     // For: bool
+#include <stdint.h>      // For: intptr_t
+#include <stdio.h>       // For: snprintf, vsnprintf etc.
+#include <string.h>      // For: strrchr(), memcpy(), strtok_r() etc.
 #include <sys/syscall.h> // For: syscall()
 #include <sys/types.h>   // For: struct tm
-#include <time.h>        // For: strftime, time(), localtime(), time_t etc.
-#include <unistd.h>
+#include <time.h>        // For: strftime, time(), localtime_r(), time_t etc.
+#include <unistd.h>      // For: write()
+
+#include "utils/common.h"
 
 #define GET_THREAD_ID() ((long)syscall(SYS_gettid))
 
-// Set default logging level if not defined
+// Set default runtime logging level (of all the modules) if not defined
 #ifndef LOG_LEVEL
 #define LOG_LEVEL LOG_LEVEL_DEBUG
 #endif
 
 // Set the format in which time is printed in logs
 #define LOG_TIME_FORMAT "[%H:%M:%S]"
+#define LOG_TIME_MAX_SIZE 20
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_BATCH_SIZE (16 * LOG_MSG_MAX_SIZE) // Max number of bytes written by the writer thread with a single write()
+#define LOG_FILTER_MAX_SIZE 256                // Max length of a filter string passed to log_configure()
+#define LOG_FILTER_DELIM ","                   // Delimiter of entries in a filter string
+#define LOG_FILTER_ASSIGN '='                  // Separator of the module and the level in a filter entry
+
+/**
+ * @struct LogSlot_t
+ * @brief Single line buffered in the ring
+ */
+typedef struct {
+    atomic_size_t seq;           // Slot sequence number (== position: free, == position + 1: holds a line)
+    size_t len;                  // Length of the line
+    char data[LOG_MSG_MAX_SIZE]; // Formatted line (ending with a newline)
+} LogSlot_t;
+
+/**
+ * @struct LogRing_t
+ * @brief Bounded lock-free multi-producer single-consumer ring of formatted lines
+ */
+typedef struct {
+    LogSlot_t slots[LOG_RING_SIZE];
+    atomic_size_t head;   // Next position to be taken by the producers
+    size_t tail;          // Next position to be read by the consumer (writer thread or log_deinit)
+    atomic_uint dropped;  // Number of lines dropped since the last report (ring full)
+} LogRing_t;
+
+atomic_int log_module_levels[LOG_MODULE_COUNT] = {
+    [LOG_MODULE_GENERIC] = LOG_LEVEL,
+    [LOG_MODULE_APP] = LOG_LEVEL,
+    [LOG_MODULE_DISPATCHER] = LOG_LEVEL,
+    [LOG_MODULE_SUBSCRIPTION] = LOG_LEVEL,
+    [LOG_MODULE_SYSSTAT] = LOG_LEVEL,
+    [LOG_MODULE_NETWORK] = LOG_LEVEL,
+    [LOG_MODULE_GPIO] = LOG_LEVEL,
+    [LOG_MODULE_HW] = LOG_LEVEL,
+    [LOG_MODULE_SENSORS] = LOG_LEVEL,
+    [LOG_MODULE_LIST] = LOG_LEVEL,
+};
+
+// Names accepted by log_module_from_name() (indexed by LogModule_t)
+static const char* LOG_MODULE_NAMES[LOG_MODULE_COUNT] = {
+    [LOG_MODULE_GENERIC] = "generic",
+    [LOG_MODULE_APP] = "app",
+    [LOG_MODULE_DISPATCHER] = "dispatcher",
+    [LOG_MODULE_SUBSCRIPTION] = "subscription",
+    [LOG_MODULE_SYSSTAT] = "sysstat",
+    [LOG_MODULE_NETWORK] = "network",
+    [LOG_MODULE_GPIO] = "gpio",
+    [LOG_MODULE_HW] = "hw",
+    [LOG_MODULE_SENSORS] = "sensors",
+    [LOG_MODULE_LIST] = "list",
+};
+
+// Names accepted by log_level_from_name() (indexed by level)
+static const char* LOG_LEVEL_NAMES[] = {
+    [LOG_LEVEL_DEBUG] = "debug",
+    [LOG_LEVEL_INFO] = "info",
+    [LOG_LEVEL_ERROR] = "error",
+    [LOG_LEVEL_NONE] = "none",
+};
+
+static LogRing_t log_ring;
+static atomic_bool log_async = false; // Lines are pushed to the ring instead of being written right away
+static atomic_bool log_writer_running = false;
+static pthread_t log_writer_thread;
+
+// The writer thread sleeps on the condition while the ring is empty (woken by the first line pushed afterwards)
+static atomic_bool log_writer_idle = false;
+static pthread_mutex_t log_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_writer_cond = PTHREAD_COND_INITIALIZER;
+
+// Cached per thread to avoid the gettid syscall and the time formatting on every line
+static _Thread_local long log_tls_tid = 0;
+static _Thread_local time_t log_tls_sec = (time_t)-1;
+static _Thread_local char log_tls_time[LOG_TIME_MAX_SIZE];
+
+/**
+ * @brief Reset the ring (mark all the slots as free) [not thread-safe]
+ */
+STATIC void log_ring_reset(void);
+
+/**
+ * @brief Push a single line to the ring (never blocks)
+ * @param[in]  line  Line to be pushed
+ * @param[in]  len  Line length (truncated to LOG_MSG_MAX_SIZE)
+ * @return true on success, false if the ring is full (the line is dropped and counted)
+ */
+STATIC bool log_ring_push(const char* line, size_t len);
+
+/**
+ * @brief Pop lines from the ring as long as they fit in the buffer [single consumer only]
+ * @param[out]  buf  Buffer for the lines
+ * @param[in]  buf_len  Buffer size
+ * @return Number of bytes written to the buffer (0 if the ring is empty)
+ */
+STATIC size_t log_ring_pop(char* buf, const size_t buf_len);
+
+/**
+ * @brief Check if there is a line to be read from the ring [single consumer only]
+ * @return true if the ring is empty, false otherwise
+ */
+STATIC bool log_ring_empty(void);
+
+/**
+ * @brief Wake up the writer thread if it is waiting for lines (called after a line was pushed)
+ */
+STATIC void log_writer_wake(void);
+
+/**
+ * @brief Format a complete log line (prefix, message and a newline)
+ * @param[out]  buf  Buffer of LOG_MSG_MAX_SIZE bytes (the line is truncated if longer)
+ * @param[in]  level  Level name
+ * @param[in]  file  Source file path
+ * @param[in]  line  Source file line
+ * @param[in]  msg  Message format
+ * @param[in]  args  Message arguments
+ * @return Length of the line
+ */
+STATIC size_t log_format(char* buf, const char* level, const char* file, const int line, const char* msg, va_list args);
+
+/**
+ * @brief Write the buffer to LOG_OUTPUT (retry on partial writes)
+ * @param[in]  buf  Data to be written
+ * @param[in]  len  Data length
+ */
+STATIC void log_write(const char* buf, size_t len);
+
+/**
+ * @brief Write everything buffered in the ring and report the dropped lines [single consumer only]
+ * @return Number of bytes written
+ */
+STATIC size_t log_flush(void);
+
+/**
+ * @brief Writer thread routine (flushes the ring until log_deinit)
+ * @param[in]  arg  Unused
+ * @return NULL
+ */
+STATIC void* log_writer(void* arg);
+
+LogError_t log_init(const LogMode_t mode) {
+    if(atomic_load(&log_async) || atomic_load(&log_writer_running)) {
+        return LOG_ERR_GENERIC;
+    } else if(mode == LOG_MODE_SYNC) {
+        return LOG_ERR_OK;
+    }
+
+    log_ring_reset();
+    atomic_store(&log_writer_running, true);
+    int ret = pthread_create(&log_writer_thread, NULL, log_writer, NULL);
+    if(ret != 0) {
+        atomic_store(&log_writer_running, false);
+        return LOG_ERR_PTHREAD_FAILURE;
+    }
+    atomic_store(&log_async, true);
+
+    return LOG_ERR_OK;
+}
 
-void log_print(const char* level, const int level_num, const char* file, const int line, const char* msg, ...) {
+LogError_t log_deinit(void) {
+    if(!atomic_load(&log_writer_running)) {
+        return LOG_ERR_OK;
+    }
+
+    // Switch back to synchronous writes and let the writer thread flush what has been buffered
+    atomic_store(&log_async, false);
+    pthread_mutex_lock(&log_writer_lock);
+    atomic_store(&log_writer_running, false);
+    pthread_cond_signal(&log_writer_cond);
+    pthread_mutex_unlock(&log_writer_lock);
+    int ret = pthread_join(log_writer_thread, NULL);
+    if(ret != 0) {
+        return LOG_ERR_PTHREAD_FAILURE;
+    }
+
+    // Write lines pushed by threads which were in the middle of log_print() when the mode changed
+    log_flush();
+
+    return LOG_ERR_OK;
+}
+
+LogError_t log_set_level(const LogModule_t module, const int level) {
+    if(module >= LOG_MODULE_COUNT || level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_NONE) {
+        return LOG_ERR_INVALID_ARGUMENT;
+    }
+
+    atomic_store_explicit(&log_module_levels[module], level, memory_order_relaxed);
+    return LOG_ERR_OK;
+}
+
+LogError_t log_configure(const char* filter) {
+    if(!filter || strnlen(filter, LOG_FILTER_MAX_SIZE) >= LOG_FILTER_MAX_SIZE) {
+        return LOG_ERR_INVALID_ARGUMENT;
+    }
+
+    // Apply the entries to a copy of the levels first (so that nothing changes on invalid entries)
+    int levels[LOG_MODULE_COUNT];
+    for(int i = 0; i < LOG_MODULE_COUNT; i++) {
+        levels[i] = atomic_load_explicit(&log_module_levels[i], memory_order_relaxed);
+    }
+
+    char buf[LOG_FILTER_MAX_SIZE];
+    strcpy(buf, filter);
+
+    char* saveptr;
+    for(char* entry = strtok_r(buf, LOG_FILTER_DELIM, &saveptr); entry; entry = strtok_r(NULL, LOG_FILTER_DELIM, &saveptr)) {
+        int level;
+        char* level_str = strchr(entry, LOG_FILTER_ASSIGN);
+        if(!level_str) {
+            // Bare level applies to all the modules
+            if(!log_level_from_name(entry, &level)) {
+                return LOG_ERR_INVALID_ARGUMENT;
+            }
+            for(int i = 0; i < LOG_MODULE_COUNT; i++) {
+                levels[i] = level;
+            }
+            continue;
+        }
+
+        *level_str++ = '\0';
+        LogModule_t module;
+        if(!log_module_from_name(entry, &module) || !log_level_from_name(level_str, &level)) {
+            return LOG_ERR_INVALID_ARGUMENT;
+        }
+        levels[module] = level;
+    }
+
+    for(int i = 0; i < LOG_MODULE_COUNT; i++) {
+        atomic_store_explicit(&log_module_levels[i], levels[i], memory_order_relaxed);
+    }
+    return LOG_ERR_OK;
+}
+
+bool log_module_from_name(const char* name, LogModule_t* module) {
+    if(!name || !module) {
+        return false;
+    }
+
+    for(int i = 0; i < LOG_MODULE_COUNT; i++) {
+        if(strcmp(name, LOG_MODULE_NAMES[i]) == 0) {
+            *module = (LogModule_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool log_level_from_name(const char* name, int* level) {
+    if(!name || !level) {
+        return false;
+    }
+
+    for(int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_NONE; i++) {
+        if(strcmp(name, LOG_LEVEL_NAMES[i]) == 0) {
+            *level = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void log_print(const char* level, const char* file, const int line, const char* msg, ...) {
+    // The level is already checked by the log_* macros (see log_enabled)
     va_list args;
+    char buf[LOG_MSG_MAX_SIZE];
 
-    if(LOG_LEVEL <= level_num) {
-        time_t now = time(NULL);
-        struct tm* tm_info = localtime(&now);
-        char time_str[20];
-        strftime(time_str, sizeof(time_str), LOG_TIME_FORMAT, tm_info);
+    va_start(args, msg);
+    size_t len = log_format(buf, level, file, line, msg, args);
+    va_end(args);
 
-        const char* filename = strrchr(file, '/');
-        filename = filename ? filename + 1 : file;
+    if(atomic_load_explicit(&log_async, memory_order_relaxed)) {
+        log_ring_push(buf, len);
+        log_writer_wake();
+    } else {
+        log_write(buf, len);
+    }
+}
+
+STATIC void log_ring_reset(void) {
+    for(size_t i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_store_explicit(&log_ring.slots[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store(&log_ring.head, 0);
+    log_ring.tail = 0;
+    atomic_store(&log_ring.dropped, 0);
+}
 
-        long tid = GET_THREAD_ID();
+STATIC bool log_ring_push(const char* line, size_t len) {
+    LogSlot_t* slot;
+    size_t pos = atomic_load_explicit(&log_ring.head, memory_order_relaxed);
 
-        va_start(args, msg);
-        fprintf(LOG_OUTPUT, "%s [TID:%ld] %s %s:%d: ", time_str, tid, level, filename, line);
-        vfprintf(LOG_OUTPUT, msg, args);
-        fprintf(LOG_OUTPUT, "\n");
-        va_end(args);
+    // Claim a free slot (the slot is free if its sequence number matches the position)
+    while(1) {
+        slot = &log_ring.slots[pos & LOG_RING_MASK];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if(diff == 0) {
+            if(atomic_compare_exchange_weak_explicit(&log_ring.head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            // Slot not consumed yet - the ring is full
+            atomic_fetch_add_explicit(&log_ring.dropped, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&log_ring.head, memory_order_relaxed);
+        }
     }
+
+    len = len > LOG_MSG_MAX_SIZE ? LOG_MSG_MAX_SIZE : len;
+    memcpy(slot->data, line, len);
+    slot->len = len;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    return true;
+}
+
+STATIC size_t log_ring_pop(char* buf, const size_t buf_len) {
+    size_t offset = 0;
+
+    while(1) {
+        LogSlot_t* slot = &log_ring.slots[log_ring.tail & LOG_RING_MASK];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if(seq != log_ring.tail + 1 || offset + slot->len > buf_len) {
+            // Nothing more to read (or no space left in the buffer)
+            break;
+        }
+
+        memcpy(buf + offset, slot->data, slot->len);
+        offset += slot->len;
+
+        // Give the slot back to the producers (one lap later)
+        atomic_store_explicit(&slot->seq, log_ring.tail + LOG_RING_SIZE, memory_order_release);
+        log_ring.tail++;
+    }
+
+    return offset;
+}
+
+STATIC bool log_ring_empty(void) {
+    const LogSlot_t* slot = &log_ring.slots[log_ring.tail & LOG_RING_MASK];
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) != log_ring.tail + 1;
+}
+
+STATIC void log_writer_wake(void) {
+    // Pairs with the fence in log_writer: either the writer sees the line or the producer sees the writer idle
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&log_writer_idle, memory_order_relaxed) && atomic_exchange(&log_writer_idle, false)) {
+        // Only the first line pushed to the empty ring signals (the writer drains all of them once woken up)
+        pthread_mutex_lock(&log_writer_lock);
+        pthread_cond_signal(&log_writer_cond);
+        pthread_mutex_unlock(&log_writer_lock);
+    }
+}
+
+STATIC size_t log_format(char* buf, const char* level, const char* file, const int line, const char* msg, va_list args) {
+    // Refresh the cached thread ID and time string only when needed
+    if(log_tls_tid == 0) {
+        log_tls_tid = GET_THREAD_ID();
+    }
+    time_t now = time(NULL);
+    if(now != log_tls_sec) {
+        struct tm tm_info;
+        localtime_r(&now, &tm_info);
+        strftime(log_tls_time, sizeof(log_tls_time), LOG_TIME_FORMAT, &tm_info);
+        log_tls_sec = now;
+    }
+
+    const char* filename = strrchr(file, '/');
+    filename = filename ? filename + 1 : file;
+
+    // Keep the last byte for the newline
+    const size_t max_len = LOG_MSG_MAX_SIZE - 1;
+    int ret = snprintf(buf, max_len, "%s [TID:%ld] %s %s:%d: ", log_tls_time, log_tls_tid, level, filename, line);
+    size_t len = ret < 0 ? 0 : ((size_t)ret >= max_len ? max_len - 1 : (size_t)ret);
+    ret = vsnprintf(buf + len, max_len - len, msg, args);
+    len = ret < 0 ? len : ((size_t)ret >= max_len - len ? max_len - 1 : len + (size_t)ret);
+
+    buf[len++] = '\n';
+    return len;
+}
+
+STATIC void log_write(const char* buf, size_t len) {
+    const int fd = fileno(LOG_OUTPUT);
+    while(len > 0) {
+        ssize_t ret = write(fd, buf, len);
+        if(ret <= 0) {
+            return;
+        }
+        buf += ret;
+        len -= (size_t)ret;
+    }
+}
+
+STATIC size_t log_flush(void) {
+    static char batch[LOG_BATCH_SIZE]; // Used by a single consumer at a time
+    size_t total = 0;
+
+    size_t len;
+    while((len = log_ring_pop(batch, sizeof(batch))) > 0) {
+        log_write(batch, len);
+        total += len;
+    }
+
+    unsigned dropped = atomic_exchange_explicit(&log_ring.dropped, 0, memory_order_relaxed);
+    if(dropped > 0) {
+        len = (size_t)snprintf(batch, sizeof(batch), "[log] %u lines dropped (ring full)\n", dropped);
+        log_write(batch, len);
+        total += len;
+    }
+
+    return total;
+}
+
+STATIC void* log_writer(void* arg) {
+    (void)arg;
+
+    while(atomic_load(&log_writer_running)) {
+        if(log_flush() > 0) {
+            continue;
+        }
+
+        // Sleep until a producer pushes a line (re-check the ring after announcing it, see log_writer_wake)
+        pthread_mutex_lock(&log_writer_lock);
+        atomic_store(&log_writer_idle, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if(!log_ring_empty()) {
+            atomic_store(&log_writer_idle, false);
+        }
+        while(atomic_load(&log_writer_idle) && atomic_load(&log_writer_running)) {
+            pthread_cond_wait(&log_writer_cond, &log_writer_lock);
+        }
+        atomic_store(&log_writer_idle, false);
+        pthread_mutex_unlock(&log_writer_lock);
+    }
+    log_flush();
+
+    return NULL;
 }
@@ -0,0 +1,518 @@
+#include "utils/metrics.h"
+
+#include <errno.h>  // For: EBUSY
+#include <stdio.h>  // For: snprintf()
+#include <stdlib.h> // For: posix_memalign(), free()
+#include <string.h> // For: memset(), strnlen(), memcpy()
+#include <time.h>   // For: clock_gettime()
+
+#include "utils/common.h"
+
+#define METRICS_CACHE_LINE_SIZE 64 // Alignment of the shards (no false sharing between the recording threads)
+
+/**
+ * @struct MetricsShardHist_t
+ * @brief Histogram updated by the owner of the shard
+ */
+typedef struct {
+    _Atomic uint64_t buckets[METRICS_HIST_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+} MetricsShardHist_t;
+
+/**
+ * @struct MetricsShardCmd_t
+ * @brief Metrics of a single command updated by the owner of the shard
+ */
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t errors;
+    MetricsShardHist_t latency;
+} MetricsShardCmd_t;
+
+/**
+ * @struct MetricsShard_t
+ * @brief All metrics recorded by a single thread (relaxed atomics, so the readers never see torn values)
+ */
+typedef struct {
+    _Atomic uint64_t counters[METRICS_COUNTER_COUNT];
+    MetricsShardHist_t hists[METRICS_HIST_COUNT];
+    MetricsShardCmd_t cmds[METRICS_MAX_CMDS];
+} MetricsShard_t;
+
+/**
+ * @struct MetricsRegistry_t
+ * @brief Shards of all the threads and the totals of the exited ones
+ */
+typedef struct {
+    pthread_mutex_t lock;                                    // Protects the shard table and the retired totals
+    pthread_key_t key;                                       // Releases the shard of an exiting thread
+    MetricsShard_t* shards[METRICS_MAX_SHARDS];              // Allocated shards (kept until metrics_deinit())
+    bool in_use[METRICS_MAX_SHARDS];                         // The shard is owned by a running thread
+    MetricsShard_t overflow;                                 // Shared by the threads with no shard of their own
+    MetricsSnapshot_t retired;                               // Metrics of the exited threads
+    char cmd_names[METRICS_MAX_CMDS][METRICS_CMD_NAME_SIZE]; // Names of the commands (empty: not rendered)
+} MetricsRegistry_t;
+
+static MetricsRegistry_t metrics_registry;
+static atomic_bool metrics_active;        // Set between metrics_init() and metrics_deinit()
+static atomic_uint metrics_generation;    // Incremented by metrics_init() (invalidates the cached shards)
+static _Thread_local MetricsShard_t* metrics_shard;   // Shard of the calling thread (NULL: not acquired yet)
+static _Thread_local unsigned metrics_shard_generation; // Generation the shard was acquired in
+static _Thread_local bool metrics_cmd_failed;          // The command run by the calling thread failed
+
+// Names of the counters in the Prometheus format (indexed by MetricsCounter_t)
+static const char* METRICS_COUNTER_NAMES[METRICS_COUNTER_COUNT] = {
+    [METRICS_SERVER_RX_BYTES] = "pihub_server_rx_bytes_total",
+    [METRICS_SERVER_RX_SYSCALLS] = "pihub_server_rx_syscalls_total",
+    [METRICS_SERVER_RX_EAGAIN] = "pihub_server_rx_eagain_total",
+    [METRICS_SERVER_TX_BYTES] = "pihub_server_tx_bytes_total",
+    [METRICS_SERVER_TX_SYSCALLS] = "pihub_server_tx_syscalls_total",
+    [METRICS_SERVER_TX_EAGAIN] = "pihub_server_tx_eagain_total",
+    [METRICS_I2C_TRANSACTIONS] = "pihub_i2c_transactions_total",
+    [METRICS_I2C_FAILURES] = "pihub_i2c_failures_total",
+    [METRICS_DISPATCHER_REJECTED] = "pihub_dispatcher_rejected_total",
+};
+
+// Help lines of the counters (indexed by MetricsCounter_t)
+static const char* METRICS_COUNTER_HELP[METRICS_COUNTER_COUNT] = {
+    [METRICS_SERVER_RX_BYTES] = "Bytes received from the clients",
+    [METRICS_SERVER_RX_SYSCALLS] = "Receive syscalls on the client sockets",
+    [METRICS_SERVER_RX_EAGAIN] = "Receive syscalls that found no data",
+    [METRICS_SERVER_TX_BYTES] = "Bytes sent to the clients",
+    [METRICS_SERVER_TX_SYSCALLS] = "Send syscalls on the client sockets",
+    [METRICS_SERVER_TX_EAGAIN] = "Send syscalls that found the socket full",
+    [METRICS_I2C_TRANSACTIONS] = "I2C transactions",
+    [METRICS_I2C_FAILURES] = "Failed I2C transactions",
+    [METRICS_DISPATCHER_REJECTED] = "Command lines rejected by the dispatcher",
+};
+
+// Lock names (label values of pihub_lock_wait_seconds, indexed by MetricsHist_t)
+static const char* METRICS_LOCK_NAMES[METRICS_HIST_COUNT] = {
+    [METRICS_HIST_LOCK_CLIENT] = "client",
+    [METRICS_HIST_LOCK_I2C] = "i2c",
+    [METRICS_HIST_LOCK_SPI] = "spi",
+    [METRICS_HIST_LOCK_DISPATCHER] = "dispatcher",
+};
+
+/**
+ * @brief Get the shard of the calling thread (acquired on the first call) [call only while recording]
+ * @return Pointer to the shard (the overflow shard if no shard is available)
+ */
+STATIC MetricsShard_t* metrics_get_shard(void);
+
+/**
+ * @brief Thread-specific data destructor folding the shard of an exiting thread into the retired totals
+ * @param[in]  arg  Pointer to the shard
+ */
+STATIC void metrics_release_shard(void* arg);
+
+/**
+ * @brief Find the bucket of a value
+ * @param[in]  ns  Value in ns
+ * @return Index of the bucket
+ */
+STATIC uint32_t metrics_bucket(const uint64_t ns);
+
+/**
+ * @brief Get the upper bound of a bucket
+ * @param[in]  bucket  Index of the bucket
+ * @return Upper bound in ns (UINT64_MAX for the last bucket)
+ */
+STATIC uint64_t metrics_bucket_bound_ns(const uint32_t bucket);
+
+/**
+ * @brief Add the values of a shard to a snapshot
+ * @param[in, out]  snap  Pointer to the snapshot
+ * @param[in]  shard  Pointer to the shard
+ */
+STATIC void metrics_merge_shard(MetricsSnapshot_t* snap, const MetricsShard_t* shard);
+
+static void metrics_hist_add(MetricsShardHist_t* hist, const uint64_t ns) {
+    atomic_fetch_add_explicit(&hist->buckets[metrics_bucket(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_ns, ns, memory_order_relaxed);
+}
+
+static void metrics_hist_merge(MetricsHistogram_t* to, const MetricsShardHist_t* from) {
+    for(uint32_t b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        to->buckets[b] += atomic_load_explicit(&from->buckets[b], memory_order_relaxed);
+    }
+    to->count += atomic_load_explicit(&from->count, memory_order_relaxed);
+    to->sum_ns += atomic_load_explicit(&from->sum_ns, memory_order_relaxed);
+}
+
+MetricsError_t metrics_init(void) {
+    if(atomic_load(&metrics_active)) {
+        return METRICS_ERR_GENERIC;
+    }
+
+    memset(&metrics_registry, 0, sizeof(MetricsRegistry_t));
+    int ret = pthread_mutex_init(&metrics_registry.lock, NULL);
+    if(ret != 0) {
+        return METRICS_ERR_PTHREAD_FAILURE;
+    }
+    ret = pthread_key_create(&metrics_registry.key, metrics_release_shard);
+    if(ret != 0) {
+        pthread_mutex_destroy(&metrics_registry.lock);
+        return METRICS_ERR_PTHREAD_FAILURE;
+    }
+
+    atomic_fetch_add(&metrics_generation, 1);
+    atomic_store(&metrics_active, true);
+    return METRICS_ERR_OK;
+}
+
+MetricsError_t metrics_deinit(void) {
+    if(!atomic_load(&metrics_active)) {
+        return METRICS_ERR_NOT_INITIALIZED;
+    }
+    atomic_store(&metrics_active, false);
+
+    // The destructors are not called for the threads still running (their shards are freed here)
+    pthread_key_delete(metrics_registry.key);
+    for(uint32_t i = 0; i < METRICS_MAX_SHARDS; i++) {
+        free(metrics_registry.shards[i]);
+    }
+    pthread_mutex_destroy(&metrics_registry.lock);
+    memset(&metrics_registry, 0, sizeof(MetricsRegistry_t));
+    metrics_shard = NULL;
+
+    return METRICS_ERR_OK;
+}
+
+MetricsError_t metrics_set_cmd_name(const uint32_t id, const char* name) {
+    if(!name) {
+        return METRICS_ERR_NULL_ARGUMENT;
+    } else if(id >= METRICS_MAX_CMDS) {
+        return METRICS_ERR_INVALID_ARGUMENT;
+    } else if(!atomic_load(&metrics_active)) {
+        return METRICS_ERR_NOT_INITIALIZED;
+    }
+
+    int ret = pthread_mutex_lock(&metrics_registry.lock);
+    if(ret != 0) {
+        return METRICS_ERR_PTHREAD_FAILURE;
+    }
+    size_t len = strnlen(name, METRICS_CMD_NAME_SIZE - 1);
+    memcpy(metrics_registry.cmd_names[id], name, len);
+    metrics_registry.cmd_names[id][len] = '\0';
+    pthread_mutex_unlock(&metrics_registry.lock);
+
+    return METRICS_ERR_OK;
+}
+
+uint64_t metrics_now_ns(void) {
+    if(!atomic_load_explicit(&metrics_active, memory_order_relaxed)) {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_add(const MetricsCounter_t counter, const uint64_t value) {
+    if(!atomic_load_explicit(&metrics_active, memory_order_relaxed) || counter >= METRICS_COUNTER_COUNT) {
+        return;
+    }
+    atomic_fetch_add_explicit(&metrics_get_shard()->counters[counter], value, memory_order_relaxed);
+}
+
+void metrics_observe(const MetricsHist_t hist, const uint64_t start_ns) {
+    if(start_ns == 0 || hist >= METRICS_HIST_COUNT) {
+        return;
+    }
+    uint64_t now_ns = metrics_now_ns();
+    if(now_ns == 0) {
+        return; // Stopped meanwhile
+    }
+    metrics_hist_add(&metrics_get_shard()->hists[hist], (now_ns > start_ns) ? now_ns - start_ns : 0);
+}
+
+int metrics_mutex_lock(pthread_mutex_t* lock, const MetricsHist_t hist) {
+    int ret = pthread_mutex_trylock(lock);
+    if(ret != EBUSY) {
+        return ret;
+    }
+
+    // Contended - measure the wait
+    uint64_t start_ns = metrics_now_ns();
+    ret = pthread_mutex_lock(lock);
+    if(ret == 0) {
+        metrics_observe(hist, start_ns);
+    }
+    return ret;
+}
+
+void metrics_cmd_begin(void) {
+    metrics_cmd_failed = false;
+}
+
+void metrics_cmd_fail(void) {
+    metrics_cmd_failed = true;
+}
+
+void metrics_cmd_end(const uint32_t id, const uint64_t start_ns, const bool failed) {
+    bool cmd_failed = failed || metrics_cmd_failed;
+    metrics_cmd_failed = false;
+    if(id >= METRICS_MAX_CMDS || !atomic_load_explicit(&metrics_active, memory_order_relaxed)) {
+        return;
+    }
+
+    MetricsShardCmd_t* cmd = &metrics_get_shard()->cmds[id];
+    atomic_fetch_add_explicit(&cmd->count, 1, memory_order_relaxed);
+    if(cmd_failed) {
+        atomic_fetch_add_explicit(&cmd->errors, 1, memory_order_relaxed);
+    }
+    uint64_t now_ns = metrics_now_ns();
+    if(start_ns != 0 && now_ns != 0) {
+        metrics_hist_add(&cmd->latency, (now_ns > start_ns) ? now_ns - start_ns : 0);
+    }
+}
+
+MetricsError_t metrics_snapshot(MetricsSnapshot_t* snap) {
+    if(!snap) {
+        return METRICS_ERR_NULL_ARGUMENT;
+    } else if(!atomic_load(&metrics_active)) {
+        return METRICS_ERR_NOT_INITIALIZED;
+    }
+
+    // Merge the retired totals with all the shards (critical section - no shard is released meanwhile)
+    int ret = pthread_mutex_lock(&metrics_registry.lock);
+    if(ret != 0) {
+        return METRICS_ERR_PTHREAD_FAILURE;
+    }
+    memcpy(snap, &metrics_registry.retired, sizeof(MetricsSnapshot_t));
+    for(uint32_t i = 0; i < METRICS_MAX_SHARDS; i++) {
+        if(metrics_registry.shards[i]) {
+            metrics_merge_shard(snap, metrics_registry.shards[i]); // Released shards are zeroed (add nothing)
+        }
+    }
+    metrics_merge_shard(snap, &metrics_registry.overflow);
+    pthread_mutex_unlock(&metrics_registry.lock);
+
+    return METRICS_ERR_OK;
+}
+
+uint64_t metrics_hist_percentile(const MetricsHistogram_t* hist, const uint32_t permille) {
+    if(!hist || hist->count == 0) {
+        return 0;
+    }
+
+    // Rank of the percentile value (rounded up, at least the first value)
+    uint64_t rank = (hist->count * (permille > 1000 ? 1000 : permille) + 999) / 1000;
+    rank = (rank == 0) ? 1 : rank;
+    uint64_t seen = 0;
+    for(uint32_t b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if(seen >= rank) {
+            return metrics_bucket_bound_ns(b);
+        }
+    }
+    return UINT64_MAX;
+}
+
+// Append the average and the p50/p99 of a histogram in us (percentiles are upper bounds of the buckets)
+static void metrics_append_latency(StrBuf_t* sb, const MetricsHistogram_t* hist) {
+    if(hist->count == 0) {
+        strbuf_append_str(sb, "avg - us");
+        return;
+    }
+    strbuf_appendf(sb, "avg %lu us", (unsigned long)(hist->sum_ns / hist->count / 1000));
+    const uint32_t permilles[] = { 500, 990 };
+    const char* labels[] = { "p50", "p99" };
+    for(size_t i = 0; i < sizeof(permilles) / sizeof(permilles[0]); i++) {
+        uint64_t bound_ns = metrics_hist_percentile(hist, permilles[i]);
+        if(bound_ns == UINT64_MAX) {
+            strbuf_appendf(sb, ", %s > %lu us", labels[i],
+            (unsigned long)(metrics_bucket_bound_ns(METRICS_HIST_BUCKETS - 2) / 1000));
+        } else {
+            strbuf_appendf(sb, ", %s <= %lu us", labels[i], (unsigned long)(bound_ns / 1000));
+        }
+    }
+}
+
+void metrics_render_text(const MetricsSnapshot_t* snap, StrBuf_t* sb) {
+    if(!snap || !sb) {
+        return;
+    }
+
+    const uint64_t* c = snap->counters;
+    strbuf_appendf(sb, "server rx: %lu B in %lu syscalls (%lu EAGAIN) | tx: %lu B in %lu syscalls (%lu EAGAIN)",
+    (unsigned long)c[METRICS_SERVER_RX_BYTES], (unsigned long)c[METRICS_SERVER_RX_SYSCALLS],
+    (unsigned long)c[METRICS_SERVER_RX_EAGAIN], (unsigned long)c[METRICS_SERVER_TX_BYTES],
+    (unsigned long)c[METRICS_SERVER_TX_SYSCALLS], (unsigned long)c[METRICS_SERVER_TX_EAGAIN]);
+    strbuf_appendf(sb, "\ni2c: %lu transactions, %lu failures, ", (unsigned long)c[METRICS_I2C_TRANSACTIONS],
+    (unsigned long)c[METRICS_I2C_FAILURES]);
+    metrics_append_latency(sb, &snap->hists[METRICS_HIST_I2C_LATENCY]);
+    for(uint32_t h = 0; h < METRICS_HIST_COUNT; h++) {
+        if(METRICS_LOCK_NAMES[h]) {
+            strbuf_appendf(sb, "\nlock %s: %lu contended waits, ", METRICS_LOCK_NAMES[h],
+            (unsigned long)snap->hists[h].count);
+            metrics_append_latency(sb, &snap->hists[h]);
+        }
+    }
+    strbuf_appendf(sb, "\ndispatcher: %lu lines rejected", (unsigned long)c[METRICS_DISPATCHER_REJECTED]);
+
+    // Names are read without the registry lock (set once on init, before any command is executed)
+    for(uint32_t id = 0; id < METRICS_MAX_CMDS; id++) {
+        const MetricsCmd_t* cmd = &snap->cmds[id];
+        if(metrics_registry.cmd_names[id][0] != '\0' && cmd->count > 0) {
+            strbuf_appendf(sb, "\ncmd '%s': %lu calls, %lu errors, ", metrics_registry.cmd_names[id],
+            (unsigned long)cmd->count, (unsigned long)cmd->errors);
+            metrics_append_latency(sb, &cmd->latency);
+        }
+    }
+}
+
+// Append the samples of a histogram (labels: "" or e.g. cmd="gpio set")
+static void metrics_render_prometheus_hist(StrBuf_t* sb, const char* name, const char* labels, const MetricsHistogram_t* hist) {
+    const char* sep = (labels[0] != '\0') ? "," : "";
+    uint64_t cumulative = 0;
+    for(uint32_t b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+        cumulative += hist->buckets[b];
+        strbuf_appendf(sb, "%s_bucket{%s%sle=\"%.6g\"} %lu\n", name, labels, sep, metrics_bucket_bound_ns(b) / 1e9,
+        (unsigned long)cumulative);
+    }
+    strbuf_appendf(sb, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, (unsigned long)hist->count);
+    const char* open = (labels[0] != '\0') ? "{" : "";
+    const char* close = (labels[0] != '\0') ? "}" : "";
+    strbuf_appendf(sb, "%s_sum%s%s%s %.9f\n", name, open, labels, close, hist->sum_ns / 1e9);
+    strbuf_appendf(sb, "%s_count%s%s%s %lu\n", name, open, labels, close, (unsigned long)hist->count);
+}
+
+void metrics_render_prometheus(const MetricsSnapshot_t* snap, StrBuf_t* sb) {
+    if(!snap || !sb) {
+        return;
+    }
+
+    for(uint32_t c = 0; c < METRICS_COUNTER_COUNT; c++) {
+        strbuf_appendf(sb, "# HELP %s %s\n# TYPE %s counter\n%s %lu\n", METRICS_COUNTER_NAMES[c],
+        METRICS_COUNTER_HELP[c], METRICS_COUNTER_NAMES[c], METRICS_COUNTER_NAMES[c], (unsigned long)snap->counters[c]);
+    }
+
+    strbuf_append_str(sb, "# HELP pihub_i2c_transaction_duration_seconds Duration of the I2C transactions\n"
+                          "# TYPE pihub_i2c_transaction_duration_seconds histogram\n");
+    metrics_render_prometheus_hist(sb, "pihub_i2c_transaction_duration_seconds", "", &snap->hists[METRICS_HIST_I2C_LATENCY]);
+
+    strbuf_append_str(sb, "# HELP pihub_lock_wait_seconds Wait time of the contended locks\n"
+                          "# TYPE pihub_lock_wait_seconds histogram\n");
+    for(uint32_t h = 0; h < METRICS_HIST_COUNT; h++) {
+        if(METRICS_LOCK_NAMES[h]) {
+            char labels[METRICS_CMD_NAME_SIZE + 16];
+            snprintf(labels, sizeof(labels), "lock=\"%s\"", METRICS_LOCK_NAMES[h]);
+            metrics_render_prometheus_hist(sb, "pihub_lock_wait_seconds", labels, &snap->hists[h]);
+        }
+    }
+
+    // Every family is rendered as a whole (the samples of a family must not be interleaved with other families)
+    const char* cmd_families[][2] = {
+        { "pihub_command_executions_total", "# HELP pihub_command_executions_total Executed commands\n"
+                                            "# TYPE pihub_command_executions_total counter\n" },
+        { "pihub_command_errors_total", "# HELP pihub_command_errors_total Failed commands\n"
+                                        "# TYPE pihub_command_errors_total counter\n" },
+        { "pihub_command_duration_seconds", "# HELP pihub_command_duration_seconds Time from dispatching a command "
+                                            "to the return of its handler\n"
+                                            "# TYPE pihub_command_duration_seconds histogram\n" },
+    };
+    for(size_t f = 0; f < sizeof(cmd_families) / sizeof(cmd_families[0]); f++) {
+        strbuf_append_str(sb, cmd_families[f][1]);
+        for(uint32_t id = 0; id < METRICS_MAX_CMDS; id++) {
+            if(metrics_registry.cmd_names[id][0] == '\0') {
+                continue;
+            }
+            const MetricsCmd_t* cmd = &snap->cmds[id];
+            char labels[METRICS_CMD_NAME_SIZE + 16];
+            snprintf(labels, sizeof(labels), "cmd=\"%s\"", metrics_registry.cmd_names[id]);
+            if(f == 0) {
+                strbuf_appendf(sb, "%s{%s} %lu\n", cmd_families[f][0], labels, (unsigned long)cmd->count);
+            } else if(f == 1) {
+                strbuf_appendf(sb, "%s{%s} %lu\n", cmd_families[f][0], labels, (unsigned long)cmd->errors);
+            } else {
+                metrics_render_prometheus_hist(sb, cmd_families[f][0], labels, &cmd->latency);
+            }
+        }
+    }
+}
+
+STATIC MetricsShard_t* metrics_get_shard(void) {
+    unsigned generation = atomic_load_explicit(&metrics_generation, memory_order_relaxed);
+    if(metrics_shard && metrics_shard_generation == generation) {
+        return metrics_shard;
+    }
+
+    // Take a free shard or allocate a new one (critical section)
+    MetricsShard_t* shard = NULL;
+    if(pthread_mutex_lock(&metrics_registry.lock) != 0) {
+        return &metrics_registry.overflow; // Not cached (acquired again with the next update)
+    }
+    for(uint32_t i = 0; i < METRICS_MAX_SHARDS && !shard; i++) {
+        if(metrics_registry.in_use[i]) {
+            continue;
+        } else if(!metrics_registry.shards[i]) {
+            void* mem = NULL;
+            if(posix_memalign(&mem, METRICS_CACHE_LINE_SIZE, sizeof(MetricsShard_t)) != 0) {
+                break;
+            }
+            memset(mem, 0, sizeof(MetricsShard_t));
+            metrics_registry.shards[i] = (MetricsShard_t*)mem;
+        }
+        metrics_registry.in_use[i] = true;
+        shard = metrics_registry.shards[i];
+    }
+    pthread_mutex_unlock(&metrics_registry.lock);
+
+    if(!shard || pthread_setspecific(metrics_registry.key, shard) != 0) {
+        shard = &metrics_registry.overflow; // Never released (shared by all the threads without a shard)
+    }
+    metrics_shard = shard;
+    metrics_shard_generation = generation;
+    return shard;
+}
+
+STATIC void metrics_release_shard(void* arg) {
+    MetricsShard_t* shard = (MetricsShard_t*)arg;
+    metrics_shard = NULL; // Acquired again if the thread records anything later on
+
+    if(pthread_mutex_lock(&metrics_registry.lock) != 0) {
+        return; // The shard stays taken (and its metrics stay visible)
+    }
+    for(uint32_t i = 0; i < METRICS_MAX_SHARDS; i++) {
+        if(metrics_registry.shards[i] == shard) {
+            metrics_merge_shard(&metrics_registry.retired, shard);
+            memset(shard, 0, sizeof(MetricsShard_t));
+            metrics_registry.in_use[i] = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&metrics_registry.lock);
+}
+
+STATIC uint32_t metrics_bucket(const uint64_t ns) {
+    if(ns <= (1ull << METRICS_HIST_FIRST_SHIFT)) {
+        return 0;
+    }
+    uint32_t bucket = (uint32_t)(64 - __builtin_clzll(ns - 1)) - METRICS_HIST_FIRST_SHIFT; // Smallest 2^n >= ns
+    return (bucket < METRICS_HIST_BUCKETS) ? bucket : METRICS_HIST_BUCKETS - 1;
+}
+
+STATIC uint64_t metrics_bucket_bound_ns(const uint32_t bucket) {
+    if(bucket >= METRICS_HIST_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    return 1ull << (bucket + METRICS_HIST_FIRST_SHIFT);
+}
+
+STATIC void metrics_merge_shard(MetricsSnapshot_t* snap, const MetricsShard_t* shard) {
+    for(uint32_t c = 0; c < METRICS_COUNTER_COUNT; c++) {
+        snap->counters[c] += atomic_load_explicit(&shard->counters[c], memory_order_relaxed);
+    }
+    for(uint32_t h = 0; h < METRICS_HIST_COUNT; h++) {
+        metrics_hist_merge(&snap->hists[h], &shard->hists[h]);
+    }
+    for(uint32_t id = 0; id < METRICS_MAX_CMDS; id++) {
+        snap->cmds[id].count += atomic_load_explicit(&shard->cmds[id].count, memory_order_relaxed);
+        snap->cmds[id].errors += atomic_load_explicit(&shard->cmds[id].errors, memory_order_relaxed);
+        metrics_hist_merge(&snap->cmds[id].latency, &shard->cmds[id].latency);
+    }
+}
@@ -0,0 +1,81 @@
+#include "utils/strbuf.h"
+
+#include <stdarg.h> // For: variadic function utils
+#include <stdio.h>  // For: vsnprintf
+#include <string.h> // For: memcpy
+
+/**
+ * @brief Mark the builder as truncated
+ * @param[in, out]  sb  Pointer to the builder
+ * @return STRBUF_ERR_TRUNCATED
+ */
+static StrBufError_t strbuf_truncate(StrBuf_t* sb);
+
+
+StrBufError_t strbuf_init(StrBuf_t* sb, char* buf, const size_t size) {
+    if(!sb || !buf || size == 0) {
+        return STRBUF_ERR_NULL_ARGUMENT;
+    }
+
+    sb->data = buf;
+    sb->size = size;
+    sb->len = 0;
+    sb->truncated = false;
+    sb->data[0] = '\0';
+
+    return STRBUF_ERR_OK;
+}
+
+StrBufError_t strbuf_append(StrBuf_t* sb, const char* data, const size_t len) {
+    if(!sb || !data) {
+        return STRBUF_ERR_NULL_ARGUMENT;
+    } else if(sb->truncated) {
+        return STRBUF_ERR_TRUNCATED;
+    }
+
+    // Copy what fits (leaving room for the terminating char)
+    size_t room = sb->size - 1 - sb->len;
+    size_t copied = len <= room ? len : room;
+    memcpy(sb->data + sb->len, data, copied);
+    sb->len += copied;
+    sb->data[sb->len] = '\0';
+
+    return copied == len ? STRBUF_ERR_OK : strbuf_truncate(sb);
+}
+
+StrBufError_t strbuf_append_str(StrBuf_t* sb, const char* str) {
+    if(!str) {
+        return STRBUF_ERR_NULL_ARGUMENT;
+    }
+    return strbuf_append(sb, str, strlen(str));
+}
+
+StrBufError_t strbuf_appendf(StrBuf_t* sb, const char* fmt, ...) {
+    if(!sb || !fmt) {
+        return STRBUF_ERR_NULL_ARGUMENT;
+    } else if(sb->truncated) {
+        return STRBUF_ERR_TRUNCATED;
+    }
+
+    // Render straight behind the current content
+    size_t room = sb->size - sb->len;
+    va_list args;
+    va_start(args, fmt);
+    int ret = vsnprintf(sb->data + sb->len, room, fmt, args);
+    va_end(args);
+    if(ret < 0) {
+        sb->data[sb->len] = '\0';
+        return strbuf_truncate(sb);
+    } else if((size_t)ret >= room) {
+        sb->len = sb->size - 1; // vsnprintf filled the buffer up (incl. the terminating char)
+        return strbuf_truncate(sb);
+    }
+    sb->len += (size_t)ret;
+
+    return STRBUF_ERR_OK;
+}
+
+static StrBufError_t strbuf_truncate(StrBuf_t* sb) {
+    sb->truncated = true;
+    return STRBUF_ERR_TRUNCATED;
+}
@@ -3,18 +3,26 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 // Cmocka must be included last (!)
 #include <cmocka.h>
 
 #include "app/dispatcher.h"
 
 #define FUNC_TEST_CMD_COUNT 5 // number of commands to be tested in a functional test
+#define WAIT_TIMEOUT_MS 2000  // max time to wait for an offloaded callback
 
 extern DispatcherError_t dispatcher_init(Dispatcher_t* ctx, const DispatcherConfig_t cfg);
 extern DispatcherError_t dispatcher_register(Dispatcher_t* ctx, const uint32_t id, const DispatcherCommandDef_t cmd);
 extern DispatcherError_t dispatcher_deregister(Dispatcher_t* ctx, const uint32_t id);
 extern DispatcherError_t dispatcher_execute(Dispatcher_t* ctx, const char* buf, const void* cmd_ctx);
+extern DispatcherError_t dispatcher_execute_inplace(Dispatcher_t* ctx, char* buf, const size_t len, const void* cmd_ctx);
+extern DispatcherError_t dispatcher_offload(Dispatcher_t* ctx, void (*fn)(void* arg), void (*drop)(void* arg),
+const void* arg, const size_t arg_size);
 extern DispatcherError_t dispatcher_deinit(Dispatcher_t* ctx);
 
 /********************* Auxiliary functions *********************/
@@ -25,8 +33,114 @@ extern DispatcherError_t dispatcher_deinit(Dispatcher_t* ctx);
 void generic_callback(char** argv, uint32_t argc, const void* cmd_ctx) {
 }
 
+/**
+ * @brief A callback that stores the value passed via cmd_ctx in the integer it points to.
+ */
+void tag_callback(char** argv, uint32_t argc, const void* cmd_ctx) {
+    *(int*)cmd_ctx = (argc > 0) ? atoi(argv[0]) : -1;
+}
+
 static Dispatcher_t test_dispatcher;
 
+/**
+ * @brief A callback that saves pointers to its arguments (to check they point into the input buffer).
+ */
+void argv_callback(char** argv, uint32_t argc, const void* cmd_ctx) {
+    char** out = (char**)cmd_ctx;
+    for(uint32_t i = 0; i < argc; i++) {
+        out[i] = argv[i];
+    }
+}
+
+/**
+ * @brief A callback that registers another command (must not deadlock on the dispatcher lock).
+ */
+void register_callback(char** argv, uint32_t argc, const void* cmd_ctx) {
+    DispatcherCommandDef_t cmd = { .target = "late", .action = "cmd", .callback_ptr = generic_callback };
+    *(DispatcherError_t*)cmd_ctx = dispatcher_register(&test_dispatcher, 1, cmd);
+}
+
+/**
+ * @brief Thread repeatedly executing a command while the table is being updated.
+ */
+static void* execute_thread(void* arg) {
+    int* failures = (int*)arg;
+    for(int i = 0; i < 10000; i++) {
+        int tag = 0;
+        if(dispatcher_execute(&test_dispatcher, "gpio get 1", &tag) != DISPATCHER_ERR_OK || tag != 1) {
+            (*failures)++;
+        }
+    }
+    return NULL;
+}
+
+static atomic_int offload_started; // number of offloaded callbacks started
+static atomic_int offload_done;    // number of offloaded callbacks finished
+static atomic_bool offload_hold;   // offloaded callbacks wait while set
+static atomic_bool offload_valid;  // last offloaded callback ran on a worker with a copy of its arguments
+static atomic_int offload_dropped; // sum of the integers copied into the dropped jobs
+
+/**
+ * @brief An offloaded callback: checks the thread it runs on and its arguments (cmd_ctx holds the caller's thread ID)
+ */
+void offload_callback(char** argv, uint32_t argc, const void* cmd_ctx) {
+    atomic_fetch_add(&offload_started, 1);
+    const pthread_t* caller = (const pthread_t*)cmd_ctx;
+    atomic_store(&offload_valid, caller && !pthread_equal(*caller, pthread_self()) && argc == 2 &&
+    !strcmp(argv[0], "p1") && !strcmp(argv[1], "p2"));
+    while(atomic_load(&offload_hold)) {
+        usleep(1000);
+    }
+    atomic_fetch_add(&offload_done, 1);
+}
+
+/**
+ * @brief A job queued with dispatcher_offload() that increments the integer copied into it
+ */
+void increment_job(void* arg) {
+    atomic_fetch_add(&offload_done, *(int*)arg);
+}
+
+/**
+ * @brief Drop function of a job queued with dispatcher_offload() (adds the integer copied into it)
+ */
+void drop_job(void* arg) {
+    atomic_fetch_add(&offload_dropped, *(int*)arg);
+}
+
+/**
+ * @brief Thread releasing the held offloaded callbacks after a while (while the dispatcher is being deinitialized)
+ */
+static void* release_thread(void* arg) {
+    usleep(50000);
+    atomic_store(&offload_hold, false);
+    return NULL;
+}
+
+/**
+ * @brief Wait until the counter reaches the expected value (or the timeout elapses)
+ */
+static int wait_for_count(atomic_int* counter, int expected) {
+    for(int i = 0; i < WAIT_TIMEOUT_MS && atomic_load(counter) < expected; i++) {
+        usleep(1000);
+    }
+    return atomic_load(counter);
+}
+
+// Initialize dispatcher with a single worker and a single-entry job queue
+static int dispatcher_pool_setup(void** state) {
+    atomic_store(&offload_started, 0);
+    atomic_store(&offload_done, 0);
+    atomic_store(&offload_hold, false);
+    atomic_store(&offload_valid, false);
+    atomic_store(&offload_dropped, 0);
+    DispatcherConfig_t cfg = { .delim = " ", .worker_count = 1, .queue_len = 1, .cmd_ctx_size = sizeof(pthread_t) };
+    if(dispatcher_init(&test_dispatcher, cfg) != DISPATCHER_ERR_OK) {
+        return -1;
+    }
+    return 0;
+}
+
 // Initialize dispatcher at the beginning of the test
 static int dispatcher_test_setup(void** state) {
     DispatcherConfig_t cfg = { .delim = " " };
@@ -127,6 +241,192 @@ static void test_dispatcher_execute_long_buf(void** state) {
     assert_int_equal(dispatcher_execute(&test_dispatcher, long_buf, NULL), DISPATCHER_ERR_BUF_TOO_LONG);
 }
 
+/* Command list should grow past its initial capacity */
+static void test_dispatcher_register_grow(void** state) {
+    DispatcherCommandDef_t cmd = { .target = "gpio", .action = "set", .callback_ptr = generic_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, DISPATCHER_INIT_CMD_COUNT * 4, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "gpio set 13 1", NULL), DISPATCHER_ERR_OK);
+}
+
+/* Many commands should be registered and each one should be dispatched to its own callback */
+static void test_dispatcher_execute_many_cmds(void** state) {
+    char buf[DISPATCHER_MAX_BUF_SIZE];
+    for(uint32_t i = 0; i < DISPATCHER_MAX_CMD_COUNT; i++) {
+        DispatcherCommandDef_t cmd = { .action = "get", .callback_ptr = tag_callback };
+        snprintf(cmd.target, sizeof(cmd.target), "gpio%u", i);
+        assert_int_equal(dispatcher_register(&test_dispatcher, i, cmd), DISPATCHER_ERR_OK);
+    }
+    for(uint32_t i = 0; i < DISPATCHER_MAX_CMD_COUNT; i += 37) {
+        int tag = 0;
+        snprintf(buf, sizeof(buf), "GPIO%u Get %u", i, i);
+        assert_int_equal(dispatcher_execute(&test_dispatcher, buf, &tag), DISPATCHER_ERR_OK);
+        assert_int_equal(tag, i);
+    }
+}
+
+/* Command with the lowest ID should be executed when target & action are duplicated */
+static void test_dispatcher_execute_duplicate(void** state) {
+    int tag = 0;
+    DispatcherCommandDef_t cmd = { .target = "gpio", .action = "set", .callback_ptr = generic_callback };
+    DispatcherCommandDef_t cmd_tag = { .target = "gpio", .action = "set", .callback_ptr = tag_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 5, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_register(&test_dispatcher, 2, cmd_tag), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "gpio set 7", &tag), DISPATCHER_ERR_OK);
+    assert_int_equal(tag, 7);
+}
+
+/* Deregistered command should not be found anymore */
+static void test_dispatcher_execute_deregistered(void** state) {
+    DispatcherCommandDef_t cmd = { .target = "gpio", .action = "set", .callback_ptr = generic_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 3, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_deregister(&test_dispatcher, 3), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "gpio set 13 1", NULL), DISPATCHER_ERR_CMD_NOT_FOUND);
+}
+
+/* In-place execution should pass arguments as NULL-terminated slices of the input buffer */
+static void test_dispatcher_execute_inplace_success(void** state) {
+    char buf[] = "gpio   set 13 1";
+    char* argv[2] = { NULL, NULL };
+    DispatcherCommandDef_t cmd = { .target = "gpio", .action = "set", .callback_ptr = argv_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute_inplace(&test_dispatcher, buf, strlen(buf), argv), DISPATCHER_ERR_OK);
+    assert_ptr_equal(argv[0], &buf[11]);
+    assert_string_equal(argv[0], "13");
+    assert_ptr_equal(argv[1], &buf[14]);
+    assert_string_equal(argv[1], "1");
+}
+
+/* In-place execution should keep validating the command */
+static void test_dispatcher_execute_inplace_invalid(void** state) {
+    char incomplete[] = "gpio  ";
+    char too_many[] = "gpio set 1 2 3 4 5 6 7 8 9 10 11";
+    char long_token[DISPATCHER_TARGET_MAX_SIZE + 8];
+    memset(long_token, 'A', sizeof(long_token) - 1);
+    long_token[sizeof(long_token) - 1] = '\0';
+    assert_int_equal(dispatcher_execute_inplace(&test_dispatcher, incomplete, strlen(incomplete), NULL),
+    DISPATCHER_ERR_CMD_INCOMPLETE);
+    assert_int_equal(dispatcher_execute_inplace(&test_dispatcher, too_many, strlen(too_many), NULL),
+    DISPATCHER_ERR_TOO_MANY_ARGS);
+    assert_int_equal(dispatcher_execute_inplace(&test_dispatcher, long_token, strlen(long_token), NULL),
+    DISPATCHER_ERR_TOKEN_TOO_LONG);
+    assert_int_equal(dispatcher_execute_inplace(&test_dispatcher, long_token, DISPATCHER_MAX_BUF_SIZE, NULL),
+    DISPATCHER_ERR_BUF_TOO_LONG);
+}
+
+/* Callback should run outside the dispatcher lock, so it can (de)register commands */
+static void test_dispatcher_execute_reentrant(void** state) {
+    DispatcherError_t cb_err = DISPATCHER_ERR_GENERIC;
+    DispatcherCommandDef_t cmd = { .target = "cmd", .action = "register", .callback_ptr = register_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "cmd register", &cb_err), DISPATCHER_ERR_OK);
+    assert_int_equal(cb_err, DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "late cmd", NULL), DISPATCHER_ERR_OK);
+}
+
+/* Lookups should keep working while other commands are registered and removed concurrently */
+static void test_dispatcher_execute_concurrent_update(void** state) {
+    int failures = 0;
+    pthread_t thread;
+    DispatcherCommandDef_t cmd = { .target = "gpio", .action = "get", .callback_ptr = tag_callback };
+    DispatcherCommandDef_t other = { .target = "gpio", .action = "set", .callback_ptr = generic_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(pthread_create(&thread, NULL, execute_thread, &failures), 0);
+    for(uint32_t i = 0; i < 200; i++) {
+        assert_int_equal(dispatcher_register(&test_dispatcher, 1 + i % 64, other), DISPATCHER_ERR_OK);
+        assert_int_equal(dispatcher_deregister(&test_dispatcher, 1 + i % 64), DISPATCHER_ERR_OK);
+    }
+    assert_int_equal(pthread_join(thread, NULL), 0);
+    assert_int_equal(failures, 0);
+}
+
+/* Offloaded callback should run on a worker with a copy of the arguments and of the cmd_ctx */
+static void test_dispatcher_offload_success(void** state) {
+    DispatcherCommandDef_t cmd = { .target = "sensor", .action = "get", .callback_ptr = offload_callback, .offload = true };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+
+    char buf[] = "sensor get p1 p2";
+    pthread_t self = pthread_self();
+    assert_int_equal(dispatcher_execute_inplace(&test_dispatcher, buf, strlen(buf), &self), DISPATCHER_ERR_OK);
+    memset(buf, 'x', strlen(buf)); // The buffer may be reused as soon as the command is queued
+    assert_int_equal(wait_for_count(&offload_done, 1), 1);
+    assert_true(atomic_load(&offload_valid));
+}
+
+/* Commands without the offload flag should still run inline */
+static void test_dispatcher_offload_inline_cmd(void** state) {
+    int tag = 0;
+    DispatcherCommandDef_t cmd = { .target = "server", .action = "uptime", .callback_ptr = tag_callback };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "server uptime 7", &tag), DISPATCHER_ERR_OK);
+    assert_int_equal(tag, 7);
+}
+
+/* Offloaded commands should be rejected once the worker is busy and the queue is full */
+static void test_dispatcher_offload_queue_full(void** state) {
+    DispatcherCommandDef_t cmd = { .target = "sensor", .action = "get", .callback_ptr = offload_callback, .offload = true };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    pthread_t self = pthread_self();
+
+    atomic_store(&offload_hold, true);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "sensor get p1 p2", &self), DISPATCHER_ERR_OK);
+    assert_int_equal(wait_for_count(&offload_started, 1), 1); // The worker is busy with the first one...
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "sensor get p1 p2", &self), DISPATCHER_ERR_OK); // ...queued
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "sensor get p1 p2", &self), DISPATCHER_ERR_QUEUE_FULL);
+    int one = 1;
+    assert_int_equal(dispatcher_offload(&test_dispatcher, increment_job, NULL, &one, sizeof(one)), DISPATCHER_ERR_QUEUE_FULL);
+
+    atomic_store(&offload_hold, false);
+    assert_int_equal(wait_for_count(&offload_done, 2), 2);
+    assert_int_equal(dispatcher_offload(&test_dispatcher, increment_job, NULL, &one, sizeof(one)), DISPATCHER_ERR_OK);
+    assert_int_equal(wait_for_count(&offload_done, 3), 3);
+}
+
+/* Jobs still queued on deinit should be dropped with their drop function (the running one is finished first) */
+static void test_dispatcher_offload_drop_on_deinit(void** state) {
+    DispatcherCommandDef_t cmd = { .target = "sensor", .action = "get", .callback_ptr = offload_callback, .offload = true };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    pthread_t self = pthread_self();
+
+    atomic_store(&offload_hold, true);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "sensor get p1 p2", &self), DISPATCHER_ERR_OK);
+    assert_int_equal(wait_for_count(&offload_started, 1), 1); // The worker is busy...
+    int arg = 3;
+    assert_int_equal(dispatcher_offload(&test_dispatcher, increment_job, drop_job, &arg, sizeof(arg)), DISPATCHER_ERR_OK);
+
+    pthread_t releaser;
+    assert_int_equal(pthread_create(&releaser, NULL, release_thread, NULL), 0);
+    assert_int_equal(dispatcher_deinit(&test_dispatcher), DISPATCHER_ERR_OK); // ...until the job is queued
+    pthread_join(releaser, NULL);
+    assert_int_equal(atomic_load(&offload_done), 1);
+    assert_int_equal(atomic_load(&offload_dropped), 3);
+}
+
+/* Without workers offloaded commands and jobs should run inline */
+static void test_dispatcher_offload_no_workers(void** state) {
+    int tag = 0;
+    DispatcherCommandDef_t cmd = { .target = "sensor", .action = "get", .callback_ptr = tag_callback, .offload = true };
+    assert_int_equal(dispatcher_register(&test_dispatcher, 0, cmd), DISPATCHER_ERR_OK);
+    assert_int_equal(dispatcher_execute(&test_dispatcher, "sensor get 3", &tag), DISPATCHER_ERR_OK);
+    assert_int_equal(tag, 3);
+
+    int arg = 5;
+    atomic_store(&offload_done, 0);
+    assert_int_equal(dispatcher_offload(&test_dispatcher, increment_job, NULL, &arg, sizeof(arg)), DISPATCHER_ERR_OK);
+    assert_int_equal(atomic_load(&offload_done), 5);
+    assert_int_equal(dispatcher_offload(&test_dispatcher, increment_job, NULL, &arg, DISPATCHER_JOB_ARG_MAX_SIZE + 1),
+    DISPATCHER_ERR_INVALID_ARG);
+    assert_int_equal(dispatcher_offload(&test_dispatcher, NULL, NULL, &arg, sizeof(arg)), DISPATCHER_ERR_NULL_ARG);
+}
+
+/* Dispatcher init should fail with too many workers or too large cmd_ctx */
+static void test_dispatcher_init_invalid_pool(void** state) {
+    Dispatcher_t dispatcher;
+    DispatcherConfig_t cfg = { .delim = " ", .worker_count = DISPATCHER_MAX_WORKERS + 1 };
+    assert_int_equal(dispatcher_init(&dispatcher, cfg), DISPATCHER_ERR_INVALID_ARG);
+    cfg = (DispatcherConfig_t){ .delim = " ", .worker_count = 1, .cmd_ctx_size = DISPATCHER_CMD_CTX_MAX_SIZE + 1 };
+    assert_int_equal(dispatcher_init(&dispatcher, cfg), DISPATCHER_ERR_INVALID_ARG);
+}
+
 /* Removing a command should succeed */
 static void test_dispatcher_deregister_success(void** state) {
     assert_int_equal(dispatcher_deregister(&test_dispatcher, 0), DISPATCHER_ERR_OK);
@@ -185,6 +485,20 @@ int run_dispatcher_tests(void) {
         cmocka_unit_test_setup_teardown(test_dispatcher_execute_null_buf, dispatcher_test_setup, dispatcher_test_teardown),
         cmocka_unit_test_setup_teardown(test_dispatcher_execute_empty_buf, dispatcher_test_setup, dispatcher_test_teardown),
         cmocka_unit_test_setup_teardown(test_dispatcher_execute_long_buf, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_register_grow, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_many_cmds, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_duplicate, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_deregistered, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_inplace_success, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_inplace_invalid, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_reentrant, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_execute_concurrent_update, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_offload_success, dispatcher_pool_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_offload_inline_cmd, dispatcher_pool_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup_teardown(test_dispatcher_offload_queue_full, dispatcher_pool_setup, dispatcher_test_teardown),
+        cmocka_unit_test_setup(test_dispatcher_offload_drop_on_deinit, dispatcher_pool_setup),
+        cmocka_unit_test_setup_teardown(test_dispatcher_offload_no_workers, dispatcher_test_setup, dispatcher_test_teardown),
+        cmocka_unit_test(test_dispatcher_init_invalid_pool),
         cmocka_unit_test_setup_teardown(test_dispatcher_deregister_success, dispatcher_test_setup, dispatcher_test_teardown),
         cmocka_unit_test_setup_teardown(test_dispatcher_deregister_null_ctx, dispatcher_test_setup, dispatcher_test_teardown),
         cmocka_unit_test_setup_teardown(test_dispatcher_deregister_nonexistent, dispatcher_test_setup, dispatcher_test_teardown),
@@ -0,0 +1,90 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "app/proto.h"
+
+
+/************************ Unit tests ************************/
+
+static void test_proto_decode_request(void** state) {
+    const uint8_t body[] = { PROTO_OP_GPIO_SET, 0x00, 0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x00, 0x00, 0x15, 0x00, 0x00,
+        0x00, 0x01 };
+    ProtoRequest_t req;
+    assert_int_equal(proto_decode_request(body, sizeof(body), &req), PROTO_ERR_OK);
+    assert_int_equal(req.opcode, PROTO_OP_GPIO_SET);
+    assert_int_equal(req.req_id, 0xDEADBEEF);
+    assert_int_equal(req.argc, 2);
+    assert_int_equal(req.argv[0], 21);
+    assert_int_equal(req.argv[1], 1);
+
+    // No arguments
+    assert_int_equal(proto_decode_request(body, PROTO_HEADER_SIZE, &req), PROTO_ERR_OK);
+    assert_int_equal(req.argc, 0);
+}
+
+static void test_proto_decode_malformed(void** state) {
+    const uint8_t body[] = { PROTO_OP_PING, 0x00, 0x00, 0x00, 0x00, 0x07, 0x01, 0x02 };
+    ProtoRequest_t req;
+
+    // Header decoded even if the arguments are not a list of uint32 values
+    assert_int_equal(proto_decode_request(body, sizeof(body), &req), PROTO_ERR_MALFORMED_FRAME);
+    assert_int_equal(req.opcode, PROTO_OP_PING);
+    assert_int_equal(req.req_id, 7);
+    assert_int_equal(req.argc, 0);
+
+    // Too short for the header
+    assert_int_equal(proto_decode_request(body, PROTO_HEADER_SIZE - 1, &req), PROTO_ERR_MALFORMED_FRAME);
+    assert_int_equal(req.req_id, 0);
+
+    // Too many arguments
+    uint8_t long_body[PROTO_HEADER_SIZE + (PROTO_MAX_ARGS + 1) * sizeof(uint32_t)] = { PROTO_OP_PING };
+    assert_int_equal(proto_decode_request(long_body, sizeof(long_body), &req), PROTO_ERR_MALFORMED_FRAME);
+
+    assert_int_equal(proto_decode_request(NULL, sizeof(body), &req), PROTO_ERR_NULL_ARGUMENT);
+    assert_int_equal(proto_decode_request(body, sizeof(body), NULL), PROTO_ERR_NULL_ARGUMENT);
+}
+
+static void test_proto_encode_header(void** state) {
+    uint8_t hdr[PROTO_FRAME_HEADER_SIZE];
+    assert_int_equal(proto_encode_header(hdr, PROTO_OP_SENSOR_GET, PROTO_STATUS_FAILURE, 0x01020304, 258), PROTO_ERR_OK);
+    const uint8_t expected[] = { 0x01, 0x08, PROTO_OP_SENSOR_GET, PROTO_STATUS_FAILURE, 0x01, 0x02, 0x03, 0x04 };
+    assert_memory_equal(hdr, expected, sizeof(expected));
+
+    // The length prefix has to fit into SERVER_FRAME_PREFIX_SIZE bytes
+    assert_int_equal(proto_encode_header(hdr, PROTO_OP_NOTICE, PROTO_STATUS_OK, 0, PROTO_MAX_PAYLOAD), PROTO_ERR_OK);
+    assert_int_equal(hdr[0], 0xFF);
+    assert_int_equal(hdr[1], 0xFF);
+    assert_int_equal(proto_encode_header(hdr, PROTO_OP_NOTICE, PROTO_STATUS_OK, 0, PROTO_MAX_PAYLOAD + 1),
+    PROTO_ERR_INVALID_ARGUMENT);
+    assert_int_equal(proto_encode_header(NULL, PROTO_OP_NOTICE, PROTO_STATUS_OK, 0, 0), PROTO_ERR_NULL_ARGUMENT);
+}
+
+static void test_proto_pack_reading(void** state) {
+    const SensorReading_t r = { .fields = SENSOR_FIELD_TEMP | SENSOR_FIELD_HUM | SENSOR_FIELD_PRESS,
+        .temp_cC = -1234,
+        .hum_q10 = 47445,
+        .press_q8 = 24674867 };
+    uint8_t buf[PROTO_READING_SIZE];
+    proto_pack_reading(buf, &r);
+
+    assert_int_equal(buf[0], r.fields);
+    assert_int_equal((int32_t)proto_get_u32(buf + 1), -1234);
+    assert_int_equal(proto_get_u32(buf + 5), 47445);
+    assert_int_equal(proto_get_u32(buf + 9), 24674867);
+    const uint8_t press_be[] = { 0x01, 0x78, 0x82, 0x33 }; // 24674867 in network byte order
+    assert_memory_equal(buf + 9, press_be, sizeof(press_be));
+}
+
+int run_proto_tests(void) {
+    const struct CMUnitTest proto_tests[] = {
+        cmocka_unit_test(test_proto_decode_request),
+        cmocka_unit_test(test_proto_decode_malformed),
+        cmocka_unit_test(test_proto_encode_header),
+        cmocka_unit_test(test_proto_pack_reading),
+    };
+    return cmocka_run_group_tests(proto_tests, NULL, NULL);
+}
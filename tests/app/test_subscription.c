@@ -0,0 +1,223 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>  // For: snprintf
+#include <string.h> // For: strncmp
+#include <unistd.h> // For: usleep
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "app/subscription.h"
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_MAX_SUBSCRIPTIONS 4
+#define TEST_MIN_PERIOD_MS 10
+#define TEST_MAX_PERIOD_MS 1000
+#define TEST_WAIT_ROUNDS 200 // Max number of 1 ms waits for the scheduler
+
+SubscriptionTable_t test_table;
+
+// Counters updated by the scheduler thread (read by the test thread once the scheduler is stopped)
+volatile int sample_count;
+volatile int deliver_count;
+volatile int deliver_fd_sum;
+volatile int failing_fd; // Delivery to this fd fails (-1: none)
+
+static bool fake_sample(const uint8_t sensor_id, char* buf, const size_t buf_len) {
+    sample_count++;
+    snprintf(buf, buf_len, "sample %hu", sensor_id);
+    return true;
+}
+
+static bool fake_deliver(const ServerClient_t* client, const char* msg, const bool sample_ok) {
+    assert_true(sample_ok);
+    assert_int_equal(strncmp(msg, "sample ", 7), 0);
+    deliver_count++;
+    deliver_fd_sum += client->fd;
+    return client->fd != failing_fd;
+}
+
+static int subscription_test_setup(void** state) {
+    sample_count = 0;
+    deliver_count = 0;
+    deliver_fd_sum = 0;
+    failing_fd = -1;
+    const SubscriptionConfig_t cfg = { .max_count = TEST_MAX_SUBSCRIPTIONS,
+        .min_period_ms = TEST_MIN_PERIOD_MS,
+        .max_period_ms = TEST_MAX_PERIOD_MS,
+        .sample = fake_sample,
+        .deliver = fake_deliver };
+    return subscription_init(&test_table, cfg) == SUBSCRIPTION_ERR_OK ? 0 : -1;
+}
+
+static int subscription_test_teardown(void** state) {
+    return subscription_deinit(&test_table) == SUBSCRIPTION_ERR_OK ? 0 : -1;
+}
+
+
+/********************* Auxiliary functions *********************/
+
+// Count active subscriptions
+static int active_count(void) {
+    int count = 0;
+    for(uint32_t i = 0; i < test_table.cfg.max_count; i++) {
+        count += test_table.list[i].active ? 1 : 0;
+    }
+    return count;
+}
+
+// Run the scheduler until the expected number of deliveries (the first ones are sent right away)
+static void run_scheduler_until(const int deliveries) {
+    assert_int_equal(subscription_start(&test_table), SUBSCRIPTION_ERR_OK);
+    for(int i = 0; i < TEST_WAIT_ROUNDS && deliver_count < deliveries; i++) {
+        usleep(1000);
+    }
+    assert_int_equal(subscription_stop(&test_table), SUBSCRIPTION_ERR_OK);
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_subscription_init_invalid_cfg(void** state) {
+    SubscriptionTable_t table;
+    SubscriptionConfig_t cfg = { .max_count = 1, .min_period_ms = 1, .max_period_ms = 1, .sample = fake_sample };
+    assert_int_equal(subscription_init(NULL, cfg), SUBSCRIPTION_ERR_NULL_ARG);
+    assert_int_equal(subscription_init(&table, cfg), SUBSCRIPTION_ERR_NULL_ARG);
+    cfg.deliver = fake_deliver;
+    cfg.max_count = 0;
+    assert_int_equal(subscription_init(&table, cfg), SUBSCRIPTION_ERR_INVALID_ARG);
+    cfg.max_count = 1;
+    cfg.min_period_ms = 2;
+    assert_int_equal(subscription_init(&table, cfg), SUBSCRIPTION_ERR_INVALID_ARG);
+}
+
+static void test_subscription_add_remove(void** state) {
+    ServerClient_t client = { .fd = 5 };
+    assert_int_equal(subscription_add(&test_table, client, 0, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client, 1, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(active_count(), 2);
+
+    assert_int_equal(subscription_remove(&test_table, client, 0), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_remove(&test_table, client, 0), SUBSCRIPTION_ERR_NOT_FOUND);
+    assert_int_equal(active_count(), 1);
+}
+
+static void test_subscription_update_period(void** state) {
+    ServerClient_t client = { .fd = 5 };
+    assert_int_equal(subscription_add(&test_table, client, 0, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client, 0, 200), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(active_count(), 1);
+    for(uint32_t i = 0; i < test_table.cfg.max_count; i++) {
+        if(test_table.list[i].active) {
+            assert_int_equal(test_table.list[i].period_ms, 200);
+        }
+    }
+}
+
+static void test_subscription_invalid_period(void** state) {
+    ServerClient_t client = { .fd = 5 };
+    assert_int_equal(subscription_add(&test_table, client, 0, TEST_MIN_PERIOD_MS - 1), SUBSCRIPTION_ERR_INVALID_ARG);
+    assert_int_equal(subscription_add(&test_table, client, 0, TEST_MAX_PERIOD_MS + 1), SUBSCRIPTION_ERR_INVALID_ARG);
+    assert_int_equal(active_count(), 0);
+}
+
+static void test_subscription_table_full(void** state) {
+    for(int i = 0; i < TEST_MAX_SUBSCRIPTIONS; i++) {
+        ServerClient_t client = { .fd = 10 + i };
+        assert_int_equal(subscription_add(&test_table, client, 0, 100), SUBSCRIPTION_ERR_OK);
+    }
+    ServerClient_t client = { .fd = 99 };
+    assert_int_equal(subscription_add(&test_table, client, 0, 100), SUBSCRIPTION_ERR_TABLE_FULL);
+
+    // Freed slots can be reused
+    client.fd = 10;
+    assert_int_equal(subscription_remove_client(&test_table, client), SUBSCRIPTION_ERR_OK);
+    client.fd = 99;
+    assert_int_equal(subscription_add(&test_table, client, 0, 100), SUBSCRIPTION_ERR_OK);
+}
+
+static void test_subscription_remove_client(void** state) {
+    ServerClient_t client_a = { .fd = 5 }, client_b = { .fd = 6 };
+    assert_int_equal(subscription_add(&test_table, client_a, 0, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client_a, 1, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client_b, 0, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_remove_client(&test_table, client_a), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(active_count(), 1);
+}
+
+static void test_subscription_stale_client(void** state) {
+    // A new client reusing the fd of a disconnected one does not share its subscriptions
+    ServerClient_t stale = { .fd = 5, .generation = 1 }, reused = { .fd = 5, .generation = 2 };
+    assert_int_equal(subscription_add(&test_table, stale, 0, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, reused, 0, 100), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(active_count(), 2);
+
+    assert_int_equal(subscription_remove_client(&test_table, stale), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(active_count(), 1);
+    assert_int_equal(subscription_remove(&test_table, stale, 0), SUBSCRIPTION_ERR_NOT_FOUND);
+    assert_int_equal(subscription_remove(&test_table, reused, 0), SUBSCRIPTION_ERR_OK);
+}
+
+static void test_subscription_shared_sample(void** state) {
+    // Two subscribers of the same sensor with the same period are served with a single readout
+    ServerClient_t client_a = { .fd = 5 }, client_b = { .fd = 6 };
+    assert_int_equal(subscription_add(&test_table, client_a, 0, TEST_MAX_PERIOD_MS), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client_b, 0, TEST_MAX_PERIOD_MS), SUBSCRIPTION_ERR_OK);
+
+    run_scheduler_until(2);
+
+    assert_int_equal(deliver_count, 2);
+    assert_int_equal(deliver_fd_sum, 5 + 6);
+    assert_int_equal(sample_count, 1);
+}
+
+static void test_subscription_periodic(void** state) {
+    ServerClient_t client = { .fd = 5 };
+    assert_int_equal(subscription_add(&test_table, client, 0, TEST_MIN_PERIOD_MS), SUBSCRIPTION_ERR_OK);
+
+    run_scheduler_until(3);
+
+    assert_true(deliver_count >= 3);
+    assert_int_equal(sample_count, deliver_count);
+}
+
+static void test_subscription_failed_delivery(void** state) {
+    ServerClient_t client_a = { .fd = 5 }, client_b = { .fd = 6 };
+    failing_fd = 5;
+    assert_int_equal(subscription_add(&test_table, client_a, 0, TEST_MAX_PERIOD_MS), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client_a, 1, TEST_MAX_PERIOD_MS), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_add(&test_table, client_b, 0, TEST_MAX_PERIOD_MS), SUBSCRIPTION_ERR_OK);
+
+    run_scheduler_until(2);
+
+    // All subscriptions of the failing client are dropped
+    assert_int_equal(active_count(), 1);
+    assert_int_equal(subscription_remove(&test_table, client_b, 0), SUBSCRIPTION_ERR_OK);
+}
+
+static void test_subscription_start_twice(void** state) {
+    assert_int_equal(subscription_start(&test_table), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_start(&test_table), SUBSCRIPTION_ERR_GENERIC);
+    assert_int_equal(subscription_stop(&test_table), SUBSCRIPTION_ERR_OK);
+    assert_int_equal(subscription_stop(&test_table), SUBSCRIPTION_ERR_OK);
+}
+
+int run_subscription_tests(void) {
+    const struct CMUnitTest subscription_tests[] = {
+        cmocka_unit_test(test_subscription_init_invalid_cfg),
+        cmocka_unit_test_setup_teardown(test_subscription_add_remove, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_update_period, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_invalid_period, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_table_full, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_remove_client, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_stale_client, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_shared_sample, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_periodic, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_failed_delivery, subscription_test_setup, subscription_test_teardown),
+        cmocka_unit_test_setup_teardown(test_subscription_start_twice, subscription_test_setup, subscription_test_teardown),
+    };
+    return cmocka_run_group_tests(subscription_tests, NULL, NULL);
+}
@@ -0,0 +1,229 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // For: memcpy
+#include <unistd.h> // For: usleep
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "app/sysstat.h"
+#include "app/sysstat_collector.h"
+
+extern SysstatError_t sysstat_parse_uptime_info(const char* buf, SysstatUptimeInfo_t* uptime);
+extern SysstatError_t sysstat_parse_mem_info(const char* buf, SysstatMemInfo_t* mem_info);
+extern SysstatError_t sysstat_parse_net_info(const char* buf, const char* interface_name, SysstatNetInfo_t* net_info);
+extern SysstatError_t sysstat_parse_cpu_info(const char* buf, SysstatCpuInfo_t* cpu_info);
+extern SysstatError_t sysstat_parse_temp(const char* buf, int32_t* temp_mC);
+extern bool sysstat_scan_u64(const char** pos, uint64_t* value);
+extern void sysstat_collector_compute_rates(const SysstatSample_t* from, const SysstatSample_t* to, SysstatRates_t* rates);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_SYSSTAT_TTL_MS 60000     // Long enough for the cache not to expire during a test
+#define TEST_COLLECTOR_INTERVAL_MS 10 // Short sampling interval of the collector under test
+
+Sysstat_t test_sysstat; // Sysstat instance holding the /proc files open
+
+static int sysstat_test_setup(void** state) {
+    return sysstat_init(&test_sysstat, TEST_SYSSTAT_TTL_MS) == SYSSTAT_ERR_OK ? 0 : -1;
+}
+
+static int sysstat_test_teardown(void** state) {
+    return sysstat_deinit(&test_sysstat) == SYSSTAT_ERR_OK ? 0 : -1;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_sysstat_scan_u64(void** state) {
+    const char* pos = "  123 18446744073709551615 18446744073709551616";
+    uint64_t value;
+    assert_true(sysstat_scan_u64(&pos, &value));
+    assert_int_equal(value, 123);
+    assert_true(sysstat_scan_u64(&pos, &value));
+    assert_true(value == UINT64_MAX);
+
+    // The position is not moved on overflow or when there is no number
+    const char* overflow = pos;
+    assert_false(sysstat_scan_u64(&pos, &value));
+    assert_ptr_equal(pos, overflow);
+    pos = " kB";
+    assert_false(sysstat_scan_u64(&pos, &value));
+}
+
+static void test_sysstat_parse_uptime(void** state) {
+    SysstatUptimeInfo_t uptime;
+    assert_int_equal(sysstat_parse_uptime_info("350735.47 234388.05\n", &uptime), SYSSTAT_ERR_OK);
+    assert_int_equal(uptime.up.s, 350735);
+    assert_int_equal(uptime.up.ms, 470);
+    assert_int_equal(uptime.idle.s, 234388);
+    assert_int_equal(uptime.idle.ms, 50);
+
+    assert_int_equal(sysstat_parse_uptime_info("350735.47\n", &uptime), SYSSTAT_ERR_GENERIC);
+    assert_int_equal(sysstat_parse_uptime_info("", &uptime), SYSSTAT_ERR_GENERIC);
+}
+
+static void test_sysstat_parse_mem_info(void** state) {
+    const char* meminfo = "MemTotal:        3884136 kB\n"
+                          "MemFree:          178280 kB\n"
+                          "MemAvailable:    2889412 kB\n"
+                          "Buffers:          180432 kB\n";
+    SysstatMemInfo_t mem_info;
+    assert_int_equal(sysstat_parse_mem_info(meminfo, &mem_info), SYSSTAT_ERR_OK);
+    assert_int_equal(mem_info.total_kB, 3884136);
+    assert_int_equal(mem_info.free_kB, 178280);
+    assert_int_equal(mem_info.available_kB, 2889412);
+
+    assert_int_equal(sysstat_parse_mem_info("MemTotal: 3884136 kB\nMemFree: 178280 kB\n", &mem_info), SYSSTAT_ERR_GENERIC);
+}
+
+static void test_sysstat_parse_net_info(void** state) {
+    const char* net_dev = "Inter-|   Receive                            |  Transmit\n"
+                          " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets\n"
+                          "wlan01: 1 2 3 4 5 6 7 8 9 10 0 0 0 0 0 0\n"
+                          "    lo: 800 8 0 0 0 0 0 0 800 8 0 0 0 0 0 0\n"
+                          " wlan0: 123456 789 0 1 0 0 0 12 654321 987 0 0 0 0 0 0\n";
+    SysstatNetInfo_t net_info;
+    assert_int_equal(sysstat_parse_net_info(net_dev, "wlan0", &net_info), SYSSTAT_ERR_OK);
+    assert_int_equal(net_info.rx_bytes, 123456);
+    assert_int_equal(net_info.rx_packets, 789);
+    assert_int_equal(net_info.tx_bytes, 654321);
+    assert_int_equal(net_info.tx_packets, 987);
+
+    assert_int_equal(sysstat_parse_net_info(net_dev, "eth0", &net_info), SYSSTAT_ERR_GENERIC);
+    assert_int_equal(sysstat_parse_net_info("lo: 800 8 0\n", "lo", &net_info), SYSSTAT_ERR_GENERIC);
+}
+
+static void test_sysstat_cached(void** state) {
+    SysstatUptimeInfo_t first, second;
+    assert_int_equal(sysstat_get_uptime_info_cached(&test_sysstat, &first), SYSSTAT_ERR_OK);
+    assert_int_not_equal(test_sysstat.sources[SYSSTAT_SOURCE_UPTIME].fd, -1);
+
+    // Within the TTL the same contents are served, even when the file itself has changed
+    uint64_t timestamp_ms = test_sysstat.sources[SYSSTAT_SOURCE_UPTIME].timestamp_ms;
+    assert_int_equal(sysstat_get_uptime_info_cached(&test_sysstat, &second), SYSSTAT_ERR_OK);
+    assert_memory_equal(&first, &second, sizeof(first));
+    assert_true(test_sysstat.sources[SYSSTAT_SOURCE_UPTIME].timestamp_ms == timestamp_ms);
+
+    // The held-open file is read again once the TTL is disabled
+    test_sysstat.ttl_ms = 0;
+    memcpy(test_sysstat.sources[SYSSTAT_SOURCE_UPTIME].buf, "x", 2);
+    assert_int_equal(sysstat_get_uptime_info_cached(&test_sysstat, &second), SYSSTAT_ERR_OK);
+    assert_true(second.up.s >= first.up.s);
+
+    SysstatMemInfo_t mem_info;
+    assert_int_equal(sysstat_get_mem_info_cached(&test_sysstat, &mem_info), SYSSTAT_ERR_OK);
+    assert_true(mem_info.total_kB > 0);
+    assert_int_equal(sysstat_get_mem_info_cached(&test_sysstat, &mem_info), SYSSTAT_ERR_OK);
+}
+
+static void test_sysstat_null_args(void** state) {
+    SysstatUptimeInfo_t uptime;
+    SysstatNetInfo_t net_info;
+    assert_int_equal(sysstat_get_uptime_info_cached(NULL, &uptime), SYSSTAT_ERR_NULL_ARGUMENT);
+    assert_int_equal(sysstat_get_mem_info_cached(&test_sysstat, NULL), SYSSTAT_ERR_NULL_ARGUMENT);
+    assert_int_equal(sysstat_get_net_info_cached(&test_sysstat, NULL, &net_info), SYSSTAT_ERR_NULL_ARGUMENT);
+
+    Sysstat_t not_initialized = { 0 };
+    assert_int_equal(sysstat_get_uptime_info_cached(&not_initialized, &uptime), SYSSTAT_ERR_NOT_INITIALIZED);
+    assert_int_equal(sysstat_deinit(&not_initialized), SYSSTAT_ERR_NOT_INITIALIZED);
+}
+
+static void test_sysstat_parse_cpu_info(void** state) {
+    const char* stat = "cpu  100 20 30 800 50 0 0 0 0 0\n"
+                       "cpu0 50 10 15 400 25 0 0 0 0 0\n"
+                       "intr 12345 0 0 0\n";
+    SysstatCpuInfo_t cpu_info;
+    assert_int_equal(sysstat_parse_cpu_info(stat, &cpu_info), SYSSTAT_ERR_OK);
+    assert_int_equal(cpu_info.total_jiffies, 1000);
+    assert_int_equal(cpu_info.idle_jiffies, 850);
+
+    assert_int_equal(sysstat_parse_cpu_info("cpu0 50 10 15 400 25 0 0 0\n", &cpu_info), SYSSTAT_ERR_GENERIC);
+    assert_int_equal(sysstat_parse_cpu_info("cpu  100 20 30\n", &cpu_info), SYSSTAT_ERR_GENERIC);
+}
+
+static void test_sysstat_parse_temp(void** state) {
+    int32_t temp_mC;
+    assert_int_equal(sysstat_parse_temp("48312\n", &temp_mC), SYSSTAT_ERR_OK);
+    assert_int_equal(temp_mC, 48312);
+    assert_int_equal(sysstat_parse_temp("-5000\n", &temp_mC), SYSSTAT_ERR_OK);
+    assert_int_equal(temp_mC, -5000);
+    assert_int_equal(sysstat_parse_temp("n/a\n", &temp_mC), SYSSTAT_ERR_GENERIC);
+}
+
+static void test_sysstat_collector_rates(void** state) {
+    SysstatSample_t from = { .timestamp_ms = 1000,
+        .has_net = true,
+        .net = { .tx_bytes = 1000, .rx_bytes = 5000 },
+        .cpu = { .total_jiffies = 1000, .idle_jiffies = 900 } };
+    SysstatSample_t to = { .timestamp_ms = 3000,
+        .has_net = true,
+        .net = { .tx_bytes = 3000, .rx_bytes = 4000 },
+        .cpu = { .total_jiffies = 1200, .idle_jiffies = 950 } };
+
+    SysstatRates_t rates;
+    sysstat_collector_compute_rates(&from, &to, &rates);
+    assert_int_equal(rates.window_ms, 2000);
+    assert_int_equal(rates.tx_Bps, 1000);
+    assert_int_equal(rates.rx_Bps, 0); // Counter went backwards
+    assert_int_equal(rates.cpu_load_permille, 750);
+
+    // No rates for samples taken at the same time or without the interface
+    to.has_net = false;
+    sysstat_collector_compute_rates(&from, &to, &rates);
+    assert_int_equal(rates.tx_Bps, 0);
+    sysstat_collector_compute_rates(&from, &from, &rates);
+    assert_int_equal(rates.window_ms, 0);
+    assert_int_equal(rates.cpu_load_permille, 0);
+}
+
+static void test_sysstat_collector_run(void** state) {
+    SysstatCollector_t collector;
+    assert_int_equal(sysstat_collector_start(&collector, "lo", TEST_COLLECTOR_INTERVAL_MS), SYSSTAT_ERR_OK);
+
+    // The first sample is available right away, the rates once the second one is taken
+    SysstatSample_t sample;
+    SysstatRates_t rates;
+    assert_int_equal(sysstat_collector_get_latest(&collector, &sample), SYSSTAT_ERR_OK);
+    assert_true(sample.mem.total_kB > 0);
+    assert_true(sample.cpu.total_jiffies > 0);
+    while(atomic_load(&collector.count) < 3) {
+        usleep(TEST_COLLECTOR_INTERVAL_MS * 1000);
+    }
+    assert_int_equal(sysstat_collector_get_rates(&collector, 1000, &rates), SYSSTAT_ERR_OK);
+    assert_true(rates.window_ms >= TEST_COLLECTOR_INTERVAL_MS);
+    assert_true(rates.cpu_load_permille <= 1000);
+
+    assert_int_equal(sysstat_collector_stop(&collector), SYSSTAT_ERR_OK);
+    assert_int_equal(sysstat_collector_stop(&collector), SYSSTAT_ERR_NOT_INITIALIZED);
+}
+
+static void test_sysstat_collector_no_data(void** state) {
+    SysstatCollector_t collector = { 0 };
+    SysstatSample_t sample;
+    SysstatRates_t rates;
+    assert_int_equal(sysstat_collector_get_latest(&collector, &sample), SYSSTAT_ERR_NO_DATA);
+    assert_int_equal(sysstat_collector_get_rates(&collector, 1000, &rates), SYSSTAT_ERR_NO_DATA);
+    assert_int_equal(sysstat_collector_get_latest(NULL, &sample), SYSSTAT_ERR_NULL_ARGUMENT);
+    assert_int_equal(sysstat_collector_start(&collector, "lo", 0), SYSSTAT_ERR_GENERIC);
+    assert_int_equal(sysstat_collector_start(&collector, "an-interface-name-too-long", 1000), SYSSTAT_ERR_BUF_TOO_SHORT);
+}
+
+int run_sysstat_tests(void) {
+    const struct CMUnitTest sysstat_tests[] = {
+        cmocka_unit_test(test_sysstat_scan_u64),
+        cmocka_unit_test(test_sysstat_parse_uptime),
+        cmocka_unit_test(test_sysstat_parse_mem_info),
+        cmocka_unit_test(test_sysstat_parse_net_info),
+        cmocka_unit_test_setup_teardown(test_sysstat_cached, sysstat_test_setup, sysstat_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sysstat_null_args, sysstat_test_setup, sysstat_test_teardown),
+        cmocka_unit_test(test_sysstat_parse_cpu_info),
+        cmocka_unit_test(test_sysstat_parse_temp),
+        cmocka_unit_test(test_sysstat_collector_rates),
+        cmocka_unit_test(test_sysstat_collector_run),
+        cmocka_unit_test(test_sysstat_collector_no_data),
+    };
+    return cmocka_run_group_tests(sysstat_tests, NULL, NULL);
+}
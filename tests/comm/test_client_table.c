@@ -0,0 +1,160 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>     // For: memset
+#include <sys/socket.h> // For: socketpair
+#include <unistd.h>     // For: read, close
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "comm/network.h"
+
+extern ServerError_t server_client_table_init(ServerClientTable_t* table);
+extern ServerError_t server_client_table_deinit(ServerClientTable_t* table);
+extern ServerError_t server_client_table_insert(ServerClientTable_t* table, ServerClient_t* client);
+extern ServerError_t server_client_table_remove(ServerClientTable_t* table, const ServerClient_t* client);
+
+
+/************************ Test fixtures ************************/
+
+Server_t test_table_server; // Server handle with only the client table initialized
+
+static int client_table_test_setup(void** state) {
+    memset(&test_table_server, 0, sizeof(Server_t));
+    return server_client_table_init(&test_table_server.clients) == SERVER_ERR_OK ? 0 : -1;
+}
+
+static int client_table_test_teardown(void** state) {
+    return server_client_table_deinit(&test_table_server.clients) == SERVER_ERR_OK ? 0 : -1;
+}
+
+
+/********************* Auxiliary functions *********************/
+
+// Insert a client with the given fd into the table
+static ServerClient_t insert_client(const int fd) {
+    ServerClient_t client = { .fd = fd };
+    assert_int_equal(server_client_table_insert(&test_table_server.clients, &client), SERVER_ERR_OK);
+    return client;
+}
+
+// Get the number of clients in the table
+static uint32_t client_count(void) {
+    uint32_t count;
+    assert_int_equal(server_get_client_count(&test_table_server, &count), SERVER_ERR_OK);
+    return count;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_client_table_insert_remove(void** state) {
+    ServerClient_t a = insert_client(5);
+    ServerClient_t b = insert_client(7);
+    ServerClient_t c = insert_client(9);
+    assert_int_equal(client_count(), 3);
+
+    // Removing from the middle keeps the rest of the clients reachable
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &a), SERVER_ERR_OK);
+    assert_int_equal(client_count(), 2);
+
+    ServerClient_t clients[4];
+    uint32_t count;
+    assert_int_equal(server_get_clients(&test_table_server, clients, 4, &count), SERVER_ERR_OK);
+    assert_int_equal(count, 2);
+    assert_int_equal(clients[0].fd + clients[1].fd, b.fd + c.fd);
+
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &b), SERVER_ERR_OK);
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &c), SERVER_ERR_OK);
+    assert_int_equal(client_count(), 0);
+}
+
+static void test_client_table_stale_handle(void** state) {
+    ServerClient_t old = insert_client(5);
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &old), SERVER_ERR_OK);
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &old), SERVER_ERR_CLIENT_DISCONNECTED);
+
+    // A new client reusing the fd gets a new generation, so the old handle stays stale
+    ServerClient_t reused = insert_client(5);
+    assert_int_not_equal(reused.generation, old.generation);
+    assert_false(server_client_equal(reused, old));
+    assert_true(server_client_equal(reused, reused));
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &old), SERVER_ERR_CLIENT_DISCONNECTED);
+    assert_int_equal(client_count(), 1);
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &reused), SERVER_ERR_OK);
+}
+
+static void test_client_table_fd_out_of_range(void** state) {
+    ServerClient_t client = { .fd = SERVER_CLIENT_TABLE_SIZE };
+    assert_int_equal(server_client_table_insert(&test_table_server.clients, &client), SERVER_ERR_TABLE_FULL);
+    client.fd = -1;
+    assert_int_equal(server_client_table_insert(&test_table_server.clients, &client), SERVER_ERR_TABLE_FULL);
+    assert_int_equal(client_count(), 0);
+}
+
+static void test_client_table_slot_taken(void** state) {
+    insert_client(5);
+    ServerClient_t client = { .fd = 5 };
+    assert_int_equal(server_client_table_insert(&test_table_server.clients, &client), SERVER_ERR_TABLE_FULL);
+    assert_int_equal(client_count(), 1);
+}
+
+static void test_client_table_snapshot_limit(void** state) {
+    insert_client(5);
+    insert_client(6);
+    insert_client(7);
+
+    ServerClient_t clients[2];
+    uint32_t count;
+    assert_int_equal(server_get_clients(&test_table_server, clients, 2, &count), SERVER_ERR_OK);
+    assert_int_equal(count, 2);
+    assert_int_equal(server_get_clients(&test_table_server, NULL, 2, &count), SERVER_ERR_NULL_ARGUMENT);
+}
+
+static void test_client_table_write_stale(void** state) {
+    int fds[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    ServerClient_t client = insert_client(fds[0]);
+    assert_int_equal(server_write(&test_table_server, client, (const uint8_t*)"ok", 2), SERVER_ERR_OK);
+    char buf[2];
+    assert_int_equal(read(fds[1], buf, sizeof(buf)), 2);
+
+    // Nothing is written through a handle of a removed client
+    assert_int_equal(server_client_table_remove(&test_table_server.clients, &client), SERVER_ERR_OK);
+    assert_int_equal(server_write(&test_table_server, client, (const uint8_t*)"no", 2), SERVER_ERR_CLIENT_DISCONNECTED);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void test_client_table_cached_ip(void** state) {
+    ServerClient_t client = { .fd = 5, .ip_addr = "192.168.1.20" };
+    assert_int_equal(server_client_table_insert(&test_table_server.clients, &client), SERVER_ERR_OK);
+
+    // Handles taken from the table carry the address captured on accept
+    ServerClient_t clients[1];
+    uint32_t count;
+    assert_int_equal(server_get_clients(&test_table_server, clients, 1, &count), SERVER_ERR_OK);
+    char ip_str[IP_ADDRSTR_LENGTH];
+    assert_int_equal(server_get_client_ip(clients[0], ip_str), SERVER_ERR_OK);
+    assert_string_equal(ip_str, "192.168.1.20");
+
+    ServerClient_t unknown = insert_client(6);
+    assert_int_equal(server_get_client_ip(unknown, ip_str), SERVER_ERR_NET_FAILURE);
+    assert_int_equal(server_get_client_ip(unknown, NULL), SERVER_ERR_NULL_ARGUMENT);
+}
+
+int run_client_table_tests(void) {
+    const struct CMUnitTest client_table_tests[] = {
+        cmocka_unit_test_setup_teardown(test_client_table_insert_remove, client_table_test_setup, client_table_test_teardown),
+        cmocka_unit_test_setup_teardown(test_client_table_stale_handle, client_table_test_setup, client_table_test_teardown),
+        cmocka_unit_test_setup_teardown(test_client_table_fd_out_of_range, client_table_test_setup, client_table_test_teardown),
+        cmocka_unit_test_setup_teardown(test_client_table_slot_taken, client_table_test_setup, client_table_test_teardown),
+        cmocka_unit_test_setup_teardown(test_client_table_snapshot_limit, client_table_test_setup, client_table_test_teardown),
+        cmocka_unit_test_setup_teardown(test_client_table_write_stale, client_table_test_setup, client_table_test_teardown),
+        cmocka_unit_test_setup_teardown(test_client_table_cached_ip, client_table_test_setup, client_table_test_teardown),
+    };
+    return cmocka_run_group_tests(client_table_tests, NULL, NULL);
+}
@@ -0,0 +1,136 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>      // For: snprintf
+#include <stdlib.h>     // For: setenv, unsetenv
+#include <string.h>     // For: memset
+#include <sys/socket.h> // For: socket, connect, getsockname
+#include <unistd.h>     // For: close, getpid
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "comm/network.h"
+
+extern ServerError_t server_open_socket(const char* port, const int backlog, const bool reuse_port, int* fd);
+extern int server_activated_socket(void);
+extern bool server_format_addr(const struct sockaddr_storage* addr, char* buf);
+
+
+/************************ Test helpers ************************/
+
+// Get the port the socket is bound to (as a string)
+static void listener_test_get_port(const int fd, char* port, const size_t len) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    assert_int_equal(getsockname(fd, (struct sockaddr*)&addr, &addr_len), 0);
+    uint16_t port_n = (addr.ss_family == AF_INET6) ? ((struct sockaddr_in6*)&addr)->sin6_port :
+                                                     ((struct sockaddr_in*)&addr)->sin_port;
+    snprintf(port, len, "%u", ntohs(port_n));
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_listener_format_addr(void** state) {
+    struct sockaddr_storage addr;
+    char buf[IP_ADDRSTR_LENGTH];
+
+    memset(&addr, 0, sizeof(addr));
+    struct sockaddr_in* addr4 = (struct sockaddr_in*)&addr;
+    addr4->sin_family = AF_INET;
+    inet_pton(AF_INET, "192.168.1.20", &addr4->sin_addr);
+    assert_true(server_format_addr(&addr, buf));
+    assert_string_equal(buf, "192.168.1.20");
+
+    // IPv4 clients of the dual-stack socket are shown in the dotted form
+    memset(&addr, 0, sizeof(addr));
+    struct sockaddr_in6* addr6 = (struct sockaddr_in6*)&addr;
+    addr6->sin6_family = AF_INET6;
+    inet_pton(AF_INET6, "::ffff:10.0.0.7", &addr6->sin6_addr);
+    assert_true(server_format_addr(&addr, buf));
+    assert_string_equal(buf, "10.0.0.7");
+
+    inet_pton(AF_INET6, "2001:db8::1", &addr6->sin6_addr);
+    assert_true(server_format_addr(&addr, buf));
+    assert_string_equal(buf, "2001:db8::1");
+
+    addr.ss_family = AF_UNIX;
+    assert_false(server_format_addr(&addr, buf));
+    assert_string_equal(buf, "");
+}
+
+static void test_listener_activation_env(void** state) {
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    assert_int_equal(server_activated_socket(), -1);
+
+    // Sockets passed to another process (e.g. variables inherited from the parent)
+    char pid[16];
+    snprintf(pid, sizeof(pid), "%d", (int)getpid() + 1);
+    setenv("LISTEN_PID", pid, 1);
+    setenv("LISTEN_FDS", "1", 1);
+    assert_int_equal(server_activated_socket(), -1);
+
+    // No sockets passed
+    snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    setenv("LISTEN_PID", pid, 1);
+    setenv("LISTEN_FDS", "0", 1);
+    assert_int_equal(server_activated_socket(), -1);
+
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+}
+
+static void test_listener_ipv4_client(void** state) {
+    int fd;
+    assert_int_equal(server_open_socket("0", 4, false, &fd), SERVER_ERR_OK);
+    char port[MAX_PORTSTR_LENGTH];
+    listener_test_get_port(fd, port, sizeof(port));
+
+    // An IPv4 client is accepted by the (dual-stack) socket
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(atoi(port)) };
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    assert_int_equal(connect(client, (struct sockaddr*)&addr, sizeof(addr)), 0);
+
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    int accepted = accept(fd, (struct sockaddr*)&peer, &peer_len);
+    assert_true(accepted >= 0);
+    char ip[IP_ADDRSTR_LENGTH];
+    assert_true(server_format_addr(&peer, ip));
+    assert_string_equal(ip, "127.0.0.1");
+
+    // The socket is non-blocking (the backlog is drained until EAGAIN)
+    assert_int_equal(accept(fd, NULL, NULL), -1);
+
+    close(accepted);
+    close(client);
+    close(fd);
+}
+
+static void test_listener_reuse_port(void** state) {
+    int fd1, fd2;
+    assert_int_equal(server_open_socket("0", 4, true, &fd1), SERVER_ERR_OK);
+    char port[MAX_PORTSTR_LENGTH];
+    listener_test_get_port(fd1, port, sizeof(port));
+
+    // Another socket can be bound to the same port only with SO_REUSEPORT
+    assert_int_equal(server_open_socket(port, 4, false, &fd2), SERVER_ERR_NET_FAILURE);
+    assert_int_equal(fd2, -1);
+    assert_int_equal(server_open_socket(port, 4, true, &fd2), SERVER_ERR_OK);
+
+    close(fd2);
+    close(fd1);
+}
+
+int run_listener_tests(void) {
+    const struct CMUnitTest listener_tests[] = {
+        cmocka_unit_test(test_listener_format_addr),
+        cmocka_unit_test(test_listener_activation_env),
+        cmocka_unit_test(test_listener_ipv4_client),
+        cmocka_unit_test(test_listener_reuse_port),
+    };
+    return cmocka_run_group_tests(listener_tests, NULL, NULL);
+}
@@ -0,0 +1,213 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>     // For: free
+#include <string.h>     // For: strlen
+#include <sys/socket.h> // For: socketpair
+#include <unistd.h>     // For: write, close
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "comm/network.h"
+
+extern ServerRxBuffer_t* server_rx_buffer_create(const size_t size);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_RX_BUF_SIZE 16
+
+Server_t test_server;       // Dummy server handle (not used by the receive path)
+ServerClient_t test_client; // Client handle serving the "server" end of the socket pair
+int test_peer_fd;           // "Client" end of the socket pair
+
+static int server_rx_test_setup(void** state) {
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return -1;
+    }
+    test_client = (ServerClient_t){ .fd = fds[0], .rx_buf = server_rx_buffer_create(TEST_RX_BUF_SIZE) };
+    test_peer_fd = fds[1];
+    return test_client.rx_buf ? 0 : -1;
+}
+
+static int server_rx_test_teardown(void** state) {
+    close(test_client.fd);
+    close(test_peer_fd);
+    free(test_client.rx_buf);
+    return 0;
+}
+
+
+/********************* Auxiliary functions *********************/
+
+// Send binary data from the peer and receive it into the client's buffer
+static void send_bytes_and_receive(const uint8_t* data, const size_t data_len) {
+    ssize_t len;
+    assert_int_equal(write(test_peer_fd, data, data_len), data_len);
+    assert_int_equal(server_receive(&test_server, test_client, &len), SERVER_ERR_OK);
+    assert_int_equal(len, data_len);
+}
+
+// Send data from the peer and receive it into the client's buffer
+static void send_and_receive(const char* data) {
+    send_bytes_and_receive((const uint8_t*)data, strlen(data));
+}
+
+// Get the next line and compare it with the expected one (NULL if no complete line is expected)
+static void expect_line(const char* expected) {
+    char* line;
+    size_t len;
+    assert_int_equal(server_get_line(&test_server, test_client, &line, &len), SERVER_ERR_OK);
+    if(!expected) {
+        assert_null(line);
+        return;
+    }
+    assert_non_null(line);
+    assert_int_equal(len, strlen(expected));
+    assert_string_equal(line, expected);
+}
+
+// Get the next frame and compare it with the expected body (NULL if no complete frame is expected)
+static void expect_frame(const uint8_t* expected, const size_t expected_len) {
+    uint8_t* frame;
+    size_t len;
+    assert_int_equal(server_get_frame(&test_server, test_client, &frame, &len), SERVER_ERR_OK);
+    if(!expected) {
+        assert_null(frame);
+        return;
+    }
+    assert_non_null(frame);
+    assert_int_equal(len, expected_len);
+    assert_memory_equal(frame, expected, expected_len);
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_server_get_line_pipelined(void** state) {
+    send_and_receive("gpio 1\ngpio 2\n");
+    expect_line("gpio 1");
+    expect_line("gpio 2");
+    expect_line(NULL);
+}
+
+static void test_server_get_line_split(void** state) {
+    send_and_receive("sensor");
+    expect_line(NULL);
+    send_and_receive(" get\n");
+    expect_line("sensor get");
+    expect_line(NULL);
+}
+
+static void test_server_get_line_crlf(void** state) {
+    send_and_receive("help\r\n\r\n");
+    expect_line("help");
+    expect_line("");
+    expect_line(NULL);
+}
+
+static void test_server_get_line_wrapped(void** state) {
+    send_and_receive("0123456789\nabc");
+    expect_line("0123456789");
+    expect_line(NULL);
+    send_and_receive("de\nxyz"); // Wraps around the end of the ring
+    expect_line("abcde");
+    send_and_receive("0123\n");
+    expect_line("xyz0123");
+    expect_line(NULL);
+}
+
+static void test_server_get_line_overlong(void** state) {
+    send_and_receive("0123456789abcdef");
+    expect_line("0123456789abcdef");
+    send_and_receive("ghij\nok\n"); // Remainder of the overlong line is dropped
+    expect_line("ok");
+    expect_line(NULL);
+}
+
+static void test_server_get_line_null_arg(void** state) {
+    char* line;
+    size_t len;
+    assert_int_equal(server_get_line(NULL, test_client, &line, &len), SERVER_ERR_NULL_ARGUMENT);
+    assert_int_equal(server_get_line(&test_server, test_client, NULL, &len), SERVER_ERR_NULL_ARGUMENT);
+    assert_int_equal(server_get_line(&test_server, test_client, &line, NULL), SERVER_ERR_NULL_ARGUMENT);
+}
+
+static void test_server_get_frame_pipelined(void** state) {
+    const uint8_t data[] = { 0x00, 0x03, 'a', 'b', 'c', 0x00, 0x00, 0x00, 0x01, 'x' };
+    send_bytes_and_receive(data, sizeof(data));
+    expect_frame((const uint8_t*)"abc", 3);
+    expect_frame((const uint8_t*)"", 0);
+    expect_frame((const uint8_t*)"x", 1);
+    expect_frame(NULL, 0);
+}
+
+static void test_server_get_frame_split(void** state) {
+    const uint8_t prefix[] = { 0x00 };
+    const uint8_t rest[] = { 0x04, 0x0A, 0x00 };
+    const uint8_t tail[] = { 0xFF, 0x0A };
+    send_bytes_and_receive(prefix, sizeof(prefix));
+    expect_frame(NULL, 0); // Incomplete prefix
+    send_bytes_and_receive(rest, sizeof(rest));
+    expect_frame(NULL, 0); // Incomplete body
+    send_bytes_and_receive(tail, sizeof(tail));
+    expect_frame((const uint8_t[]){ 0x0A, 0x00, 0xFF, 0x0A }, 4); // Delimiter bytes are data in frames
+    expect_frame(NULL, 0);
+}
+
+static void test_server_get_frame_wrapped(void** state) {
+    const uint8_t first[] = { 0x00, 0x08, '0', '1', '2', '3', '4', '5', '6', '7', 0x00, 0x06, 'a', 'b' };
+    const uint8_t second[] = { 'c', 'd', 'e', 'f' }; // Wraps around the end of the ring
+    send_bytes_and_receive(first, sizeof(first));
+    expect_frame((const uint8_t*)"01234567", 8);
+    expect_frame(NULL, 0);
+    send_bytes_and_receive(second, sizeof(second));
+    expect_frame((const uint8_t*)"abcdef", 6);
+    expect_frame(NULL, 0);
+}
+
+static void test_server_get_frame_too_long(void** state) {
+    const uint8_t data[] = { 0x00, TEST_RX_BUF_SIZE - 1, 'a' };
+    send_bytes_and_receive(data, sizeof(data));
+    uint8_t* frame;
+    size_t len;
+    assert_int_equal(server_get_frame(&test_server, test_client, &frame, &len), SERVER_ERR_FRAME_TOO_LONG);
+    assert_null(frame);
+    assert_int_equal(test_client.rx_buf->len, sizeof(data)); // Nothing consumed
+}
+
+static void test_server_get_frame_after_line(void** state) {
+    // The line framing is switched to frames in the middle of the received data (e.g. by `server proto bin`)
+    const uint8_t data[] = { 'b', 'i', 'n', '\n', 0x00, 0x02, '\n', 'z' };
+    send_bytes_and_receive(data, sizeof(data));
+    expect_line("bin");
+    expect_frame((const uint8_t*)"\nz", 2);
+    expect_frame(NULL, 0);
+}
+
+static void test_server_receive_disconnected(void** state) {
+    ssize_t len;
+    close(test_peer_fd);
+    test_peer_fd = -1;
+    assert_int_equal(server_receive(&test_server, test_client, &len), SERVER_ERR_CLIENT_DISCONNECTED);
+}
+
+int run_server_rx_tests(void) {
+    const struct CMUnitTest server_rx_tests[] = {
+        cmocka_unit_test_setup_teardown(test_server_get_line_pipelined, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_line_split, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_line_crlf, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_line_wrapped, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_line_overlong, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_line_null_arg, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_frame_pipelined, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_frame_split, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_frame_wrapped, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_frame_too_long, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_get_frame_after_line, server_rx_test_setup, server_rx_test_teardown),
+        cmocka_unit_test_setup_teardown(test_server_receive_disconnected, server_rx_test_setup, server_rx_test_teardown),
+    };
+    return cmocka_run_group_tests(server_rx_tests, NULL, NULL);
+}
@@ -0,0 +1,282 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>       // For: errno
+#include <string.h>      // For: memset, memcmp
+#include <sys/eventfd.h> // For: eventfd
+#include <sys/socket.h>  // For: socketpair, send, recv
+#include <sys/uio.h>     // For: struct iovec
+#include <unistd.h>      // For: close
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "comm/network.h"
+
+extern ServerError_t server_client_table_init(ServerClientTable_t* table);
+extern ServerError_t server_client_table_deinit(ServerClientTable_t* table);
+extern ServerError_t server_client_table_insert(ServerClientTable_t* table, ServerClient_t* client);
+extern ServerError_t server_client_table_remove(ServerClientTable_t* table, const ServerClient_t* client);
+extern ServerError_t server_client_flush(Server_t* ctx, const ServerClient_t client);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_TX_CLIENTS 2
+
+Server_t test_tx_server;                         // Server handle with only the client table initialized
+int test_tx_fds[TEST_TX_CLIENTS][2];             // Socket pairs ([0]: client fd used by the server, [1]: peer)
+ServerClient_t test_tx_clients[TEST_TX_CLIENTS]; // Handles of the clients in the table
+
+static int tx_queue_test_setup(void** state) {
+    memset(&test_tx_server, 0, sizeof(Server_t));
+    if(server_client_table_init(&test_tx_server.clients) != SERVER_ERR_OK) {
+        return -1;
+    }
+    for(int i = 0; i < TEST_TX_CLIENTS; i++) {
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, test_tx_fds[i]) != 0) {
+            return -1;
+        }
+        test_tx_clients[i] = (ServerClient_t){ .fd = test_tx_fds[i][0], .disconnect_eventfd = eventfd(0, EFD_NONBLOCK) };
+        if(server_client_table_insert(&test_tx_server.clients, &test_tx_clients[i]) != SERVER_ERR_OK) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int tx_queue_test_teardown(void** state) {
+    for(int i = 0; i < TEST_TX_CLIENTS; i++) {
+        server_client_table_remove(&test_tx_server.clients, &test_tx_clients[i]); // Drops the queued messages
+        close(test_tx_fds[i][0]);
+        close(test_tx_fds[i][1]);
+        close(test_tx_clients[i].disconnect_eventfd);
+    }
+    return server_client_table_deinit(&test_tx_server.clients) == SERVER_ERR_OK ? 0 : -1;
+}
+
+
+/********************* Auxiliary functions *********************/
+
+// Fill the socket buffer of the client, so that nothing more can be sent to it without blocking
+static void stall_client(const int idx) {
+    char chunk[1024] = { 0 };
+    while(send(test_tx_fds[idx][0], chunk, sizeof(chunk), MSG_DONTWAIT) > 0) {
+    }
+    while(send(test_tx_fds[idx][0], chunk, 1, MSG_DONTWAIT) > 0) {
+    }
+    assert_true(errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Read everything the peer of the client has received so far (returns the number of bytes, keeps the tail)
+static size_t drain_peer(const int idx, char* tail, const size_t tail_len) {
+    char buf[4096];
+    size_t total = 0;
+    ssize_t len;
+    while((len = recv(test_tx_fds[idx][1], buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        total += (size_t)len;
+        if(tail && (size_t)len >= tail_len) {
+            memcpy(tail, buf + len - tail_len, tail_len);
+        }
+    }
+    return total;
+}
+
+// Get the slot of the client
+static ServerClientSlot_t* client_slot(const int idx) {
+    return &test_tx_server.clients.slots[test_tx_clients[idx].fd];
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_tx_broadcast_all(void** state) {
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"hello\n", 6), SERVER_ERR_OK);
+
+    for(int i = 0; i < TEST_TX_CLIENTS; i++) {
+        char buf[6];
+        assert_int_equal(drain_peer(i, buf, sizeof(buf)), 6);
+        assert_memory_equal(buf, "hello\n", 6);
+        assert_int_equal(client_slot(i)->tx.count, 0);
+    }
+}
+
+static void test_tx_broadcast_slow_client(void** state) {
+    stall_client(0);
+
+    // The broadcast does not block on the stalled client and the other one gets the message right away
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"hello\n", 6), SERVER_ERR_OK);
+    char buf[6];
+    assert_int_equal(drain_peer(1, buf, sizeof(buf)), 6);
+    assert_int_equal(client_slot(0)->tx.count, 1);
+    assert_int_equal(client_slot(0)->tx.bytes, 6);
+
+    // Once the stalled client reads its data the queued message is sent (as it happens on EPOLLOUT)
+    drain_peer(0, NULL, 0);
+    assert_int_equal(server_client_flush(&test_tx_server, test_tx_clients[0]), SERVER_ERR_OK);
+    assert_int_equal(client_slot(0)->tx.count, 0);
+    assert_int_equal(drain_peer(0, buf, sizeof(buf)), 6);
+    assert_memory_equal(buf, "hello\n", 6);
+}
+
+static void test_tx_write_keeps_order(void** state) {
+    stall_client(0);
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"first\n", 6), SERVER_ERR_OK);
+
+    // A direct write does not overtake the queued broadcast
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"second\n", 7), SERVER_ERR_OK);
+    assert_int_equal(client_slot(0)->tx.count, 2);
+
+    drain_peer(0, NULL, 0);
+    assert_int_equal(server_client_flush(&test_tx_server, test_tx_clients[0]), SERVER_ERR_OK);
+    char buf[13];
+    assert_int_equal(drain_peer(0, buf, sizeof(buf)), 13);
+    assert_memory_equal(buf, "first\nsecond\n", 13);
+}
+
+static void test_tx_queue_full(void** state) {
+    stall_client(0);
+    for(int i = 0; i < SERVER_TX_QUEUE_LEN; i++) {
+        assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"x", 1), SERVER_ERR_OK);
+    }
+
+    // The message is dropped only for the stalled client
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"y", 1), SERVER_ERR_QUEUE_FULL);
+    assert_int_equal(client_slot(0)->tx.count, SERVER_TX_QUEUE_LEN);
+    char last;
+    assert_int_equal(drain_peer(1, &last, 1), SERVER_TX_QUEUE_LEN + 1);
+    assert_int_equal(last, 'y');
+}
+
+static void test_tx_flush_stale_client(void** state) {
+    stall_client(0);
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"hello\n", 6), SERVER_ERR_OK);
+
+    // Queued messages are dropped when the client is removed
+    ServerClient_t client = test_tx_clients[0];
+    assert_int_equal(server_client_table_remove(&test_tx_server.clients, &client), SERVER_ERR_OK);
+    assert_int_equal(client_slot(0)->tx.count, 0);
+    assert_null(client_slot(0)->tx.entries);
+    assert_int_equal(server_client_flush(&test_tx_server, client), SERVER_ERR_CLIENT_DISCONNECTED);
+}
+
+static void test_tx_write_nonblocking(void** state) {
+    stall_client(0);
+
+    // The data is queued instead of waiting for the client
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"hello\n", 6), SERVER_ERR_OK);
+    assert_int_equal(client_slot(0)->tx.count, 1);
+    assert_int_equal(client_slot(0)->tx.bytes, 6);
+}
+
+static void test_tx_writev(void** state) {
+    const struct iovec iov[3] = { { .iov_base = "> ", .iov_len = 2 }, { .iov_base = "abc", .iov_len = 3 },
+        { .iov_base = "\n", .iov_len = 1 } };
+
+    // The parts are sent as one message
+    assert_int_equal(server_writev(&test_tx_server, test_tx_clients[0], iov, 3), SERVER_ERR_OK);
+    char buf[6];
+    assert_int_equal(drain_peer(0, buf, sizeof(buf)), 6);
+    assert_memory_equal(buf, "> abc\n", 6);
+
+    // The parts are gathered into a single queued buffer if the client is stalled
+    stall_client(0);
+    assert_int_equal(server_writev(&test_tx_server, test_tx_clients[0], iov, 3), SERVER_ERR_OK);
+    ServerTxQueue_t* tx = &client_slot(0)->tx;
+    assert_int_equal(tx->count, 1);
+    assert_int_equal(tx->bytes, 6);
+    assert_memory_equal(tx->entries[tx->head].buf->data, "> abc\n", 6);
+
+    assert_int_equal(server_writev(&test_tx_server, test_tx_clients[0], iov, 0), SERVER_ERR_INVALID_ARGUMENT);
+    assert_int_equal(server_writev(&test_tx_server, test_tx_clients[0], iov, SERVER_TX_IOV_MAX + 1),
+    SERVER_ERR_INVALID_ARGUMENT);
+    assert_int_equal(server_writev(&test_tx_server, test_tx_clients[0], NULL, 1), SERVER_ERR_NULL_ARGUMENT);
+}
+
+static void test_tx_broadcastv(void** state) {
+    const struct iovec iov[2] = { { .iov_base = "> ", .iov_len = 2 }, { .iov_base = "hi\n", .iov_len = 3 } };
+    assert_int_equal(server_broadcastv(&test_tx_server, iov, 2), SERVER_ERR_OK);
+
+    for(int i = 0; i < TEST_TX_CLIENTS; i++) {
+        char buf[5];
+        assert_int_equal(drain_peer(i, buf, sizeof(buf)), 5);
+        assert_memory_equal(buf, "> hi\n", 5);
+    }
+    assert_int_equal(server_broadcastv(&test_tx_server, iov, 0), SERVER_ERR_INVALID_ARGUMENT);
+}
+
+static void test_tx_policy_drop(void** state) {
+    test_tx_server.cfg.tx_high_water = 8;
+    stall_client(0);
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"msg1\n", 5), SERVER_ERR_OK);
+
+    // The new message would exceed the high-water mark
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"msg2\n", 5), SERVER_ERR_QUEUE_FULL);
+    assert_int_equal(client_slot(0)->tx.count, 1);
+    assert_int_equal(client_slot(0)->tx.dropped, 1);
+
+    drain_peer(0, NULL, 0);
+    assert_int_equal(server_client_flush(&test_tx_server, test_tx_clients[0]), SERVER_ERR_OK);
+    char buf[5];
+    assert_int_equal(drain_peer(0, buf, sizeof(buf)), 5);
+    assert_memory_equal(buf, "msg1\n", 5);
+}
+
+static void test_tx_policy_coalesce(void** state) {
+    test_tx_server.cfg.tx_high_water = 10;
+    test_tx_server.cfg.tx_policy = SERVER_TX_POLICY_COALESCE;
+    stall_client(0);
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"msg1\n", 5), SERVER_ERR_OK);
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"msg2\n", 5), SERVER_ERR_OK);
+
+    // The oldest message makes room for the newest one
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"msg3\n", 5), SERVER_ERR_OK);
+    assert_int_equal(client_slot(0)->tx.count, 2);
+    assert_int_equal(client_slot(0)->tx.bytes, 10);
+    assert_int_equal(client_slot(0)->tx.dropped, 1);
+
+    drain_peer(0, NULL, 0);
+    assert_int_equal(server_client_flush(&test_tx_server, test_tx_clients[0]), SERVER_ERR_OK);
+    char buf[10];
+    assert_int_equal(drain_peer(0, buf, sizeof(buf)), 10);
+    assert_memory_equal(buf, "msg2\nmsg3\n", 10);
+
+    // The well-behaved client got all messages
+    assert_int_equal(drain_peer(1, NULL, 0), 15);
+}
+
+static void test_tx_policy_disconnect(void** state) {
+    test_tx_server.cfg.tx_high_water = 8;
+    test_tx_server.cfg.tx_policy = SERVER_TX_POLICY_DISCONNECT;
+    stall_client(0);
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"msg1\n", 5), SERVER_ERR_OK);
+
+    // The slow client is asked to disconnect and nothing is queued for it anymore
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"msg2\n", 5), SERVER_ERR_CLIENT_DISCONNECTED);
+    uint64_t signal_value = 0;
+    assert_int_equal(read(test_tx_clients[0].disconnect_eventfd, &signal_value, sizeof(signal_value)), sizeof(signal_value));
+    assert_int_equal(signal_value, 1);
+    assert_int_equal(client_slot(0)->tx.count, 0);
+    assert_int_equal(server_write(&test_tx_server, test_tx_clients[0], (const uint8_t*)"msg3\n", 5), SERVER_ERR_CLIENT_DISCONNECTED);
+
+    // The broadcast skips the client without an error
+    assert_int_equal(server_broadcast(&test_tx_server, (const uint8_t*)"all\n", 4), SERVER_ERR_OK);
+    assert_int_equal(drain_peer(1, NULL, 0), 4);
+}
+
+int run_tx_queue_tests(void) {
+    const struct CMUnitTest tx_queue_tests[] = {
+        cmocka_unit_test_setup_teardown(test_tx_broadcast_all, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_broadcast_slow_client, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_write_keeps_order, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_queue_full, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_flush_stale_client, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_write_nonblocking, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_writev, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_broadcastv, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_policy_drop, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_policy_coalesce, tx_queue_test_setup, tx_queue_test_teardown),
+        cmocka_unit_test_setup_teardown(test_tx_policy_disconnect, tx_queue_test_setup, tx_queue_test_teardown),
+    };
+    return cmocka_run_group_tests(tx_queue_tests, NULL, NULL);
+}
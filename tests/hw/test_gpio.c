@@ -0,0 +1,365 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "hw/gpio.h"
+
+
+/************************ Mock and stub functions ************************/
+
+#define MOCK_LINE_COUNT GPIO_LINE_COUNT
+
+// Fake chip and line objects (only their addresses are used by the driver)
+static int mock_chip;
+static int mock_lines[MOCK_LINE_COUNT];
+
+static int mock_line_values[MOCK_LINE_COUNT]; // Values "seen" on the lines
+static int request_output_count = 0;          // Number of gpiod_line_request_output() calls
+static int request_input_count = 0;           // Number of gpiod_line_request_input() calls
+static int release_count = 0;                 // Number of gpiod_line_release() calls
+static int set_value_count = 0;               // Number of gpiod_line_set_value() calls
+static int fail_set_value = 0;                // Make gpiod_line_set_value() fail
+static int request_bulk_count = 0;            // Number of gpiod_line_request_bulk_*() calls
+static int release_bulk_count = 0;            // Number of gpiod_line_release_bulk() calls
+static int set_value_bulk_count = 0;          // Number of gpiod_line_set_value_bulk() calls
+static int get_value_bulk_count = 0;          // Number of gpiod_line_get_value_bulk() calls
+static int request_events_count = 0;          // Number of gpiod_line_request_both_edges_events() calls
+static int pending_events = 0;                // Number of edge events waiting to be read (rising edges only)
+
+static int mock_line_offset(struct gpiod_line* line) {
+    return (int)((int*)line - mock_lines);
+}
+
+struct gpiod_chip* __wrap_gpiod_chip_open(const char* path) {
+    return (struct gpiod_chip*)&mock_chip;
+}
+
+void __wrap_gpiod_chip_close(struct gpiod_chip* chip) {
+}
+
+struct gpiod_line* __wrap_gpiod_chip_get_line(struct gpiod_chip* chip, unsigned int offset) {
+    return (struct gpiod_line*)&mock_lines[offset];
+}
+
+int __wrap_gpiod_line_request_output(struct gpiod_line* line, const char* consumer, int default_val) {
+    request_output_count++;
+    mock_line_values[mock_line_offset(line)] = default_val;
+    return 0;
+}
+
+int __wrap_gpiod_line_request_input(struct gpiod_line* line, const char* consumer) {
+    request_input_count++;
+    return 0;
+}
+
+void __wrap_gpiod_line_release(struct gpiod_line* line) {
+    release_count++;
+}
+
+int __wrap_gpiod_line_set_value(struct gpiod_line* line, int value) {
+    set_value_count++;
+    if(fail_set_value) {
+        return -1;
+    }
+    mock_line_values[mock_line_offset(line)] = value;
+    return 0;
+}
+
+int __wrap_gpiod_line_get_value(struct gpiod_line* line) {
+    return mock_line_values[mock_line_offset(line)];
+}
+
+int __wrap_gpiod_chip_get_lines(struct gpiod_chip* chip, unsigned int* offsets, unsigned int num, struct gpiod_line_bulk* bulk) {
+    gpiod_line_bulk_init(bulk);
+    for(unsigned int i = 0; i < num; i++) {
+        gpiod_line_bulk_add(bulk, (struct gpiod_line*)&mock_lines[offsets[i]]);
+    }
+    return 0;
+}
+
+int __wrap_gpiod_line_request_bulk_output(struct gpiod_line_bulk* bulk, const char* consumer, const int* default_vals) {
+    request_bulk_count++;
+    for(unsigned int i = 0; i < gpiod_line_bulk_num_lines(bulk); i++) {
+        mock_line_values[mock_line_offset(gpiod_line_bulk_get_line(bulk, i))] = default_vals[i];
+    }
+    return 0;
+}
+
+int __wrap_gpiod_line_request_bulk_input(struct gpiod_line_bulk* bulk, const char* consumer) {
+    request_bulk_count++;
+    return 0;
+}
+
+void __wrap_gpiod_line_release_bulk(struct gpiod_line_bulk* bulk) {
+    release_bulk_count++;
+}
+
+int __wrap_gpiod_line_set_value_bulk(struct gpiod_line_bulk* bulk, const int* values) {
+    set_value_bulk_count++;
+    for(unsigned int i = 0; i < gpiod_line_bulk_num_lines(bulk); i++) {
+        mock_line_values[mock_line_offset(gpiod_line_bulk_get_line(bulk, i))] = values[i];
+    }
+    return 0;
+}
+
+int __wrap_gpiod_line_get_value_bulk(struct gpiod_line_bulk* bulk, int* values) {
+    get_value_bulk_count++;
+    for(unsigned int i = 0; i < gpiod_line_bulk_num_lines(bulk); i++) {
+        values[i] = mock_line_values[mock_line_offset(gpiod_line_bulk_get_line(bulk, i))];
+    }
+    return 0;
+}
+
+int __wrap_gpiod_line_request_both_edges_events(struct gpiod_line* line, const char* consumer) {
+    request_events_count++;
+    return 0;
+}
+
+int __wrap_gpiod_line_event_get_fd(struct gpiod_line* line) {
+    return 100 + mock_line_offset(line);
+}
+
+int __wrap_gpiod_line_event_wait(struct gpiod_line* line, const struct timespec* timeout) {
+    return pending_events > 0 ? 1 : 0;
+}
+
+int __wrap_gpiod_line_event_read(struct gpiod_line* line, struct gpiod_line_event* event) {
+    pending_events--;
+    event->event_type = GPIOD_LINE_EVENT_RISING_EDGE;
+    event->ts = (struct timespec){ .tv_sec = 12, .tv_nsec = 345 };
+    return 0;
+}
+
+
+/************************ Test fixtures ************************/
+
+Gpio_t test_gpio;
+
+static int gpio_test_setup(void** state) {
+    request_output_count = 0;
+    request_input_count = 0;
+    release_count = 0;
+    set_value_count = 0;
+    fail_set_value = 0;
+    request_bulk_count = 0;
+    release_bulk_count = 0;
+    set_value_bulk_count = 0;
+    get_value_bulk_count = 0;
+    request_events_count = 0;
+    pending_events = 0;
+    for(int i = 0; i < MOCK_LINE_COUNT; i++) {
+        mock_line_values[i] = 0;
+    }
+    return gpio_init(&test_gpio) == GPIO_ERR_OK ? 0 : -1;
+}
+
+static int gpio_test_teardown(void** state) {
+    return gpio_deinit(&test_gpio) == GPIO_ERR_OK ? 0 : -1;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_gpio_set_requests_once(void** state) {
+    for(int i = 0; i < 10; i++) {
+        assert_int_equal(gpio_set(&test_gpio, 17, i % 2), GPIO_ERR_OK);
+        assert_int_equal(mock_line_values[17], i % 2);
+    }
+    assert_int_equal(request_output_count, 1);
+    assert_int_equal(release_count, 0);
+    assert_int_equal(set_value_count, 9); // The first value is set by the request itself
+}
+
+static void test_gpio_get_requests_once(void** state) {
+    uint8_t value;
+    mock_line_values[4] = 1;
+    for(int i = 0; i < 10; i++) {
+        assert_int_equal(gpio_get(&test_gpio, 4, &value), GPIO_ERR_OK);
+        assert_int_equal(value, 1);
+    }
+    assert_int_equal(request_input_count, 1);
+    assert_int_equal(release_count, 0);
+}
+
+static void test_gpio_direction_change(void** state) {
+    uint8_t value;
+    assert_int_equal(gpio_set(&test_gpio, 5, 1), GPIO_ERR_OK);
+    assert_int_equal(gpio_get(&test_gpio, 5, &value), GPIO_ERR_OK);
+    assert_int_equal(gpio_set(&test_gpio, 5, 0), GPIO_ERR_OK);
+    assert_int_equal(request_output_count, 2);
+    assert_int_equal(request_input_count, 1);
+    assert_int_equal(release_count, 2);
+}
+
+static void test_gpio_lines_released_on_deinit(void** state) {
+    uint8_t value;
+    assert_int_equal(gpio_set(&test_gpio, 1, 1), GPIO_ERR_OK);
+    assert_int_equal(gpio_get(&test_gpio, 2, &value), GPIO_ERR_OK);
+    assert_int_equal(gpio_deinit(&test_gpio), GPIO_ERR_OK);
+    assert_int_equal(release_count, 2);
+    assert_int_equal(gpio_init(&test_gpio), GPIO_ERR_OK); // For the teardown
+}
+
+static void test_gpio_set_failure_rerequests(void** state) {
+    assert_int_equal(gpio_set(&test_gpio, 3, 1), GPIO_ERR_OK);
+    fail_set_value = 1;
+    assert_int_equal(gpio_set(&test_gpio, 3, 0), GPIO_ERR_LIBGPIOD_FAILURE);
+    fail_set_value = 0;
+    assert_int_equal(gpio_set(&test_gpio, 3, 0), GPIO_ERR_OK);
+    assert_int_equal(request_output_count, 2);
+    assert_int_equal(release_count, 1);
+}
+
+static void test_gpio_invalid_line(void** state) {
+    uint8_t value;
+    assert_int_equal(gpio_set(&test_gpio, GPIO_LINE_COUNT, 1), GPIO_ERR_INVALID_LINE);
+    assert_int_equal(gpio_get(&test_gpio, GPIO_LINE_COUNT, &value), GPIO_ERR_INVALID_LINE);
+}
+
+static void test_gpio_null_arg(void** state) {
+    assert_int_equal(gpio_set(NULL, 1, 1), GPIO_ERR_NULL_ARGUMENT);
+    assert_int_equal(gpio_get(&test_gpio, 1, NULL), GPIO_ERR_NULL_ARGUMENT);
+}
+
+static void test_gpio_set_bulk_requests_once(void** state) {
+    const uint8_t lines[] = { 5, 6, 7, 8 };
+    const uint8_t values_a[] = { 1, 0, 1, 0 }, values_b[] = { 0, 1, 0, 1 };
+    assert_int_equal(gpio_set_bulk(&test_gpio, lines, values_a, 4), GPIO_ERR_OK);
+    assert_int_equal(gpio_set_bulk(&test_gpio, lines, values_b, 4), GPIO_ERR_OK);
+    assert_int_equal(request_bulk_count, 1);
+    assert_int_equal(set_value_bulk_count, 1); // The first values are set by the request itself
+    for(int i = 0; i < 4; i++) {
+        assert_int_equal(mock_line_values[lines[i]], values_b[i]);
+    }
+}
+
+static void test_gpio_get_bulk_requests_once(void** state) {
+    const uint8_t lines[] = { 21, 22, 23, 24 };
+    uint8_t values[4];
+    mock_line_values[22] = 1;
+    mock_line_values[24] = 1;
+    for(int i = 0; i < 3; i++) {
+        assert_int_equal(gpio_get_bulk(&test_gpio, lines, values, 4), GPIO_ERR_OK);
+        assert_int_equal(values[0], 0);
+        assert_int_equal(values[1], 1);
+        assert_int_equal(values[2], 0);
+        assert_int_equal(values[3], 1);
+    }
+    assert_int_equal(request_bulk_count, 1);
+    assert_int_equal(get_value_bulk_count, 3);
+}
+
+static void test_gpio_bulk_and_single_line(void** state) {
+    const uint8_t lines[] = { 5, 6 };
+    const uint8_t values[] = { 1, 1 };
+    assert_int_equal(gpio_set_bulk(&test_gpio, lines, values, 2), GPIO_ERR_OK);
+
+    // A single line of the group is requested on its own (the whole group is released)
+    assert_int_equal(gpio_set(&test_gpio, 6, 0), GPIO_ERR_OK);
+    assert_int_equal(release_bulk_count, 1);
+    assert_int_equal(request_output_count, 1);
+
+    // ...and the group is requested again afterwards
+    assert_int_equal(gpio_set_bulk(&test_gpio, lines, values, 2), GPIO_ERR_OK);
+    assert_int_equal(release_count, 1);
+    assert_int_equal(request_bulk_count, 2);
+}
+
+static void test_gpio_bulk_groups_reused(void** state) {
+    // Many disjoint groups can stay requested at once; the oldest one is reused when all of them are taken
+    uint8_t lines[GPIO_BULK_GROUP_COUNT + 1][2];
+    uint8_t values[2] = { 1, 0 };
+    for(int i = 0; i <= GPIO_BULK_GROUP_COUNT; i++) {
+        lines[i][0] = 2 * i;
+        lines[i][1] = 2 * i + 1;
+        assert_int_equal(gpio_set_bulk(&test_gpio, lines[i], values, 2), GPIO_ERR_OK);
+    }
+    assert_int_equal(request_bulk_count, GPIO_BULK_GROUP_COUNT + 1);
+    assert_int_equal(release_bulk_count, 1);
+
+    // The most recent group is still requested
+    assert_int_equal(gpio_set_bulk(&test_gpio, lines[GPIO_BULK_GROUP_COUNT], values, 2), GPIO_ERR_OK);
+    assert_int_equal(request_bulk_count, GPIO_BULK_GROUP_COUNT + 1);
+}
+
+static void test_gpio_bulk_invalid_args(void** state) {
+    const uint8_t duplicated[] = { 5, 5 };
+    const uint8_t out_of_range[] = { 5, GPIO_LINE_COUNT };
+    uint8_t values[2] = { 0, 0 };
+    assert_int_equal(gpio_set_bulk(&test_gpio, duplicated, values, 2), GPIO_ERR_INVALID_ARGUMENT);
+    assert_int_equal(gpio_get_bulk(&test_gpio, out_of_range, values, 2), GPIO_ERR_INVALID_LINE);
+    assert_int_equal(gpio_get_bulk(&test_gpio, duplicated, values, 0), GPIO_ERR_INVALID_ARGUMENT);
+    assert_int_equal(gpio_set_bulk(&test_gpio, NULL, values, 2), GPIO_ERR_NULL_ARGUMENT);
+    assert_int_equal(gpio_get_bulk(&test_gpio, duplicated, NULL, 2), GPIO_ERR_NULL_ARGUMENT);
+    assert_int_equal(request_bulk_count, 0);
+}
+
+static void test_gpio_watch_read_events(void** state) {
+    int fd, fd_again;
+    GpioEvent_t event;
+    assert_int_equal(gpio_watch(&test_gpio, 21, &fd), GPIO_ERR_OK);
+    assert_int_equal(fd, 121);
+    assert_int_equal(gpio_watch(&test_gpio, 21, &fd_again), GPIO_ERR_OK);
+    assert_int_equal(fd_again, fd);
+    assert_int_equal(request_events_count, 1);
+
+    pending_events = 1;
+    assert_int_equal(gpio_read_event(&test_gpio, 21, &event), GPIO_ERR_OK);
+    assert_int_equal(event.line, 21);
+    assert_true(event.rising);
+    assert_int_equal(event.ts.tv_sec, 12);
+    assert_int_equal(event.ts.tv_nsec, 345);
+    assert_int_equal(gpio_read_event(&test_gpio, 21, &event), GPIO_ERR_NO_EVENT);
+}
+
+static void test_gpio_watched_line_busy(void** state) {
+    int fd;
+    uint8_t value;
+    const uint8_t lines[] = { 20, 21 };
+    uint8_t values[2] = { 0, 0 };
+    assert_int_equal(gpio_watch(&test_gpio, 21, &fd), GPIO_ERR_OK);
+
+    // The line can still be read, but not driven or requested in bulk
+    mock_line_values[21] = 1;
+    assert_int_equal(gpio_get(&test_gpio, 21, &value), GPIO_ERR_OK);
+    assert_int_equal(value, 1);
+    assert_int_equal(gpio_set(&test_gpio, 21, 0), GPIO_ERR_LINE_BUSY);
+    assert_int_equal(gpio_get_bulk(&test_gpio, lines, values, 2), GPIO_ERR_LINE_BUSY);
+    assert_int_equal(request_input_count, 0);
+    assert_int_equal(release_count, 0);
+}
+
+static void test_gpio_unwatch(void** state) {
+    int fd;
+    GpioEvent_t event;
+    assert_int_equal(gpio_unwatch(&test_gpio, 21), GPIO_ERR_NOT_WATCHED);
+    assert_int_equal(gpio_read_event(&test_gpio, 21, &event), GPIO_ERR_NOT_WATCHED);
+    assert_int_equal(gpio_watch(&test_gpio, 21, &fd), GPIO_ERR_OK);
+    assert_int_equal(gpio_unwatch(&test_gpio, 21), GPIO_ERR_OK);
+    assert_int_equal(release_count, 1);
+    assert_int_equal(gpio_set(&test_gpio, 21, 1), GPIO_ERR_OK); // Free for other uses again
+}
+
+int run_gpio_tests(void) {
+    const struct CMUnitTest gpio_tests[] = {
+        cmocka_unit_test_setup_teardown(test_gpio_set_requests_once, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_get_requests_once, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_direction_change, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_lines_released_on_deinit, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_set_failure_rerequests, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_invalid_line, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_null_arg, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_set_bulk_requests_once, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_get_bulk_requests_once, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_bulk_and_single_line, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_bulk_groups_reused, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_bulk_invalid_args, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_watch_read_events, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_watched_line_busy, gpio_test_setup, gpio_test_teardown),
+        cmocka_unit_test_setup_teardown(test_gpio_unwatch, gpio_test_setup, gpio_test_teardown),
+    };
+    return cmocka_run_group_tests(gpio_tests, NULL, NULL);
+}
@@ -0,0 +1,111 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/i2c.h> // For: struct i2c_msg, I2C_M_RD
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "hw/i2c_bus.h"
+
+extern I2CBusError_t i2c_bus_set_slave(I2CBus_t* ctx, const uint8_t slave_addr);
+extern size_t
+i2c_bus_pack_transfer(const uint8_t slave_addr, const I2CBusOp_t* ops, const size_t count, struct i2c_msg* msgs, uint8_t* scratch);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_SLAVE_ADDR 0x76 // Address of the slave device used in the tests
+#define TEST_MAX_MSGS (2 * I2C_BUS_TRANSFER_MAX_OPS)
+#define TEST_SCRATCH_SIZE (I2C_BUS_TRANSFER_MAX_OPS + I2C_BUS_TRANSFER_MAX_WRITE_LEN)
+
+
+/************************ Unit tests ************************/
+
+static void test_i2c_bus_pack_transfer(void** state) {
+    uint8_t config = 0xA0, ctrl_meas = 0xB7, calib[26];
+    I2CBusOp_t ops[] = {
+        { .type = I2C_BUS_OP_WRITE, .reg_addr = 0xF5, .buf = &config, .len = sizeof(config) },
+        { .type = I2C_BUS_OP_READ, .reg_addr = 0x88, .buf = calib, .len = sizeof(calib) },
+        { .type = I2C_BUS_OP_WRITE, .reg_addr = 0xF4, .buf = &ctrl_meas, .len = sizeof(ctrl_meas) },
+    };
+    struct i2c_msg msgs[TEST_MAX_MSGS];
+    uint8_t scratch[TEST_SCRATCH_SIZE];
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, ops, 3, msgs, scratch), 4);
+
+    // Writes: register address followed by the data in a single message
+    assert_int_equal(msgs[0].addr, TEST_SLAVE_ADDR);
+    assert_int_equal(msgs[0].flags, 0);
+    assert_int_equal(msgs[0].len, 2);
+    assert_int_equal(msgs[0].buf[0], 0xF5);
+    assert_int_equal(msgs[0].buf[1], 0xA0);
+    assert_int_equal(msgs[3].len, 2);
+    assert_int_equal(msgs[3].buf[0], 0xF4);
+    assert_int_equal(msgs[3].buf[1], 0xB7);
+
+    // Reads: register address message followed by the read into the caller's buffer
+    assert_int_equal(msgs[1].len, 1);
+    assert_int_equal(msgs[1].buf[0], 0x88);
+    assert_int_equal(msgs[2].flags, I2C_M_RD);
+    assert_int_equal(msgs[2].len, sizeof(calib));
+    assert_ptr_equal(msgs[2].buf, calib);
+}
+
+static void test_i2c_bus_pack_transfer_limits(void** state) {
+    uint8_t data[I2C_BUS_TRANSFER_MAX_WRITE_LEN + 1] = { 0 };
+    struct i2c_msg msgs[TEST_MAX_MSGS];
+    uint8_t scratch[TEST_SCRATCH_SIZE];
+
+    // Max number of reads (two messages each) and the max total length of the written data fit
+    I2CBusOp_t ops[I2C_BUS_TRANSFER_MAX_OPS + 1];
+    for(int i = 0; i <= I2C_BUS_TRANSFER_MAX_OPS; i++) {
+        ops[i] = (I2CBusOp_t){ .type = I2C_BUS_OP_READ, .reg_addr = i, .buf = data, .len = 1 };
+    }
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, ops, I2C_BUS_TRANSFER_MAX_OPS, msgs, scratch), TEST_MAX_MSGS);
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, ops, I2C_BUS_TRANSFER_MAX_OPS + 1, msgs, scratch), 0);
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, ops, 0, msgs, scratch), 0);
+
+    I2CBusOp_t writes[] = {
+        { .type = I2C_BUS_OP_WRITE, .reg_addr = 0x00, .buf = data, .len = I2C_BUS_TRANSFER_MAX_WRITE_LEN - 1 },
+        { .type = I2C_BUS_OP_WRITE, .reg_addr = 0x01, .buf = data, .len = 1 },
+        { .type = I2C_BUS_OP_WRITE, .reg_addr = 0x02, .buf = data, .len = 1 },
+    };
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, writes, 2, msgs, scratch), 2);
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, writes, 3, msgs, scratch), 0);
+
+    // Operations without data are rejected
+    I2CBusOp_t empty = { .type = I2C_BUS_OP_WRITE, .reg_addr = 0x00, .buf = data, .len = 0 };
+    assert_int_equal(i2c_bus_pack_transfer(TEST_SLAVE_ADDR, &empty, 1, msgs, scratch), 0);
+}
+
+static void test_i2c_bus_slave_addr_cached(void** state) {
+    // No device behind the bus: every I2C_SLAVE ioctl fails
+    I2CBus_t bus = { .fd = -1, .slave_addr = TEST_SLAVE_ADDR };
+
+    // The ioctl is skipped while the address does not change
+    assert_int_equal(i2c_bus_set_slave(&bus, TEST_SLAVE_ADDR), I2C_BUS_ERR_OK);
+
+    // The cache is invalidated on failure
+    assert_int_equal(i2c_bus_set_slave(&bus, TEST_SLAVE_ADDR + 1), I2C_BUS_ERR_I2CDEV_FAILURE);
+    assert_int_equal(bus.slave_addr, I2C_BUS_NO_SLAVE_ADDR);
+    assert_int_equal(i2c_bus_set_slave(&bus, TEST_SLAVE_ADDR), I2C_BUS_ERR_I2CDEV_FAILURE);
+}
+
+static void test_i2c_bus_transfer_invalid_args(void** state) {
+    I2CBus_t bus = { .fd = -1, .slave_addr = I2C_BUS_NO_SLAVE_ADDR };
+    uint8_t data = 0;
+    I2CBusOp_t op = { .type = I2C_BUS_OP_READ, .reg_addr = 0xD0, .buf = &data, .len = 1 };
+    assert_int_equal(i2c_bus_transfer(NULL, TEST_SLAVE_ADDR, &op, 1), I2C_BUS_ERR_NULL_ARGUMENT);
+    assert_int_equal(i2c_bus_transfer(&bus, TEST_SLAVE_ADDR, NULL, 1), I2C_BUS_ERR_NULL_ARGUMENT);
+    assert_int_equal(i2c_bus_transfer(&bus, TEST_SLAVE_ADDR, &op, 0), I2C_BUS_ERR_INVALID_ARGUMENT);
+}
+
+int run_i2c_bus_tests(void) {
+    const struct CMUnitTest i2c_bus_tests[] = {
+        cmocka_unit_test(test_i2c_bus_pack_transfer),
+        cmocka_unit_test(test_i2c_bus_pack_transfer_limits),
+        cmocka_unit_test(test_i2c_bus_slave_addr_cached),
+        cmocka_unit_test(test_i2c_bus_transfer_invalid_args),
+    };
+    return cmocka_run_group_tests(i2c_bus_tests, NULL, NULL);
+}
@@ -0,0 +1,140 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/spi/spidev.h> // For: struct spi_ioc_transfer
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "hw/spi_bus.h"
+
+extern size_t spi_bus_pack_transfer(const uint32_t speed_hz,
+const SPIBusOp_t* ops,
+const size_t count,
+struct spi_ioc_transfer* xfers,
+uint8_t* scratch);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_SPEED_HZ 10000000 // Clock frequency used in the tests
+#define TEST_CS_LINE 8         // GPIO chip-select line used in the tests
+#define TEST_MAX_XFERS (2 * SPI_BUS_TRANSFER_MAX_OPS)
+#define TEST_SCRATCH_SIZE (SPI_BUS_TRANSFER_MAX_OPS + SPI_BUS_TRANSFER_MAX_WRITE_LEN)
+
+
+/************************ Unit tests ************************/
+
+static void test_spi_bus_pack_transfer(void** state) {
+    uint8_t config = 0xA0, ctrl_meas = 0xB7, calib[26];
+    SPIBusOp_t ops[] = {
+        { .type = SPI_BUS_OP_WRITE, .reg_addr = 0xF5, .buf = &config, .len = sizeof(config) },
+        { .type = SPI_BUS_OP_READ, .reg_addr = 0x88, .buf = calib, .len = sizeof(calib) },
+        { .type = SPI_BUS_OP_WRITE, .reg_addr = 0xF4, .buf = &ctrl_meas, .len = sizeof(ctrl_meas) },
+    };
+    struct spi_ioc_transfer xfers[TEST_MAX_XFERS];
+    uint8_t scratch[TEST_SCRATCH_SIZE];
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, ops, 3, xfers, scratch), 4);
+
+    // Writes: register address (MSB cleared) followed by the data in a single transfer
+    uint8_t* tx = (uint8_t*)(uintptr_t)xfers[0].tx_buf;
+    assert_int_equal(xfers[0].len, 2);
+    assert_int_equal(xfers[0].rx_buf, 0);
+    assert_int_equal(tx[0], 0x75);
+    assert_int_equal(tx[1], 0xA0);
+    tx = (uint8_t*)(uintptr_t)xfers[3].tx_buf;
+    assert_int_equal(xfers[3].len, 2);
+    assert_int_equal(tx[0], 0x74);
+    assert_int_equal(tx[1], 0xB7);
+
+    // Reads: register address (MSB set) followed by the data clocked into the caller's buffer
+    tx = (uint8_t*)(uintptr_t)xfers[1].tx_buf;
+    assert_int_equal(xfers[1].len, 1);
+    assert_int_equal(tx[0], 0x88);
+    assert_int_equal(xfers[2].tx_buf, 0);
+    assert_int_equal(xfers[2].len, sizeof(calib));
+    assert_ptr_equal((uint8_t*)(uintptr_t)xfers[2].rx_buf, calib);
+
+    // The chip-select is released after every operation but the last one (not within a read)
+    assert_int_equal(xfers[0].cs_change, 1);
+    assert_int_equal(xfers[1].cs_change, 0);
+    assert_int_equal(xfers[2].cs_change, 1);
+    assert_int_equal(xfers[3].cs_change, 0);
+
+    for(int i = 0; i < 4; i++) {
+        assert_int_equal(xfers[i].speed_hz, TEST_SPEED_HZ);
+        assert_int_equal(xfers[i].bits_per_word, 8);
+    }
+}
+
+static void test_spi_bus_pack_transfer_read_flag(void** state) {
+    // Address bit 7 is the R/W flag: it is forced for reads and cleared for writes regardless of the register address
+    uint8_t data = 0x5A;
+    SPIBusOp_t ops[] = {
+        { .type = SPI_BUS_OP_READ, .reg_addr = 0x50, .buf = &data, .len = 1 },
+        { .type = SPI_BUS_OP_WRITE, .reg_addr = 0xE0, .buf = &data, .len = 1 },
+    };
+    struct spi_ioc_transfer xfers[TEST_MAX_XFERS];
+    uint8_t scratch[TEST_SCRATCH_SIZE];
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, ops, 2, xfers, scratch), 3);
+    assert_int_equal(((uint8_t*)(uintptr_t)xfers[0].tx_buf)[0], 0xD0);
+    assert_int_equal(((uint8_t*)(uintptr_t)xfers[2].tx_buf)[0], 0x60);
+}
+
+static void test_spi_bus_pack_transfer_limits(void** state) {
+    uint8_t data[SPI_BUS_TRANSFER_MAX_WRITE_LEN + 1] = { 0 };
+    struct spi_ioc_transfer xfers[TEST_MAX_XFERS];
+    uint8_t scratch[TEST_SCRATCH_SIZE];
+
+    // Max number of reads (two transfers each) and the max total length of the written data fit
+    SPIBusOp_t ops[SPI_BUS_TRANSFER_MAX_OPS + 1];
+    for(int i = 0; i <= SPI_BUS_TRANSFER_MAX_OPS; i++) {
+        ops[i] = (SPIBusOp_t){ .type = SPI_BUS_OP_READ, .reg_addr = i, .buf = data, .len = 1 };
+    }
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, ops, SPI_BUS_TRANSFER_MAX_OPS, xfers, scratch), TEST_MAX_XFERS);
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, ops, SPI_BUS_TRANSFER_MAX_OPS + 1, xfers, scratch), 0);
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, ops, 0, xfers, scratch), 0);
+
+    SPIBusOp_t writes[] = {
+        { .type = SPI_BUS_OP_WRITE, .reg_addr = 0x00, .buf = data, .len = SPI_BUS_TRANSFER_MAX_WRITE_LEN - 1 },
+        { .type = SPI_BUS_OP_WRITE, .reg_addr = 0x01, .buf = data, .len = 1 },
+        { .type = SPI_BUS_OP_WRITE, .reg_addr = 0x02, .buf = data, .len = 1 },
+    };
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, writes, 2, xfers, scratch), 2);
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, writes, 3, xfers, scratch), 0);
+
+    // Operations without data are rejected
+    SPIBusOp_t empty = { .type = SPI_BUS_OP_READ, .reg_addr = 0x00, .buf = data, .len = 0 };
+    assert_int_equal(spi_bus_pack_transfer(TEST_SPEED_HZ, &empty, 1, xfers, scratch), 0);
+}
+
+static void test_spi_bus_invalid_args(void** state) {
+    // Only the clock polarity and phase bits may be set in the mode, the clock must be set
+    SPIBus_t bus;
+    SPIBusConfig_t cfg = { .spi_bus = 0, .spi_cs = 0, .speed_hz = TEST_SPEED_HZ, .mode = SPI_MODE_0 | SPI_NO_CS };
+    assert_int_equal(spi_bus_init(NULL, cfg), SPI_BUS_ERR_NULL_ARGUMENT);
+    assert_int_equal(spi_bus_init(&bus, cfg), SPI_BUS_ERR_INVALID_ARGUMENT);
+    cfg.mode = SPI_MODE_3;
+    cfg.speed_hz = 0;
+    assert_int_equal(spi_bus_init(&bus, cfg), SPI_BUS_ERR_INVALID_ARGUMENT);
+
+    // Nothing is sent if the operations do not fit into one message
+    bus = (SPIBus_t){ .cfg = { .speed_hz = TEST_SPEED_HZ }, .fd = -1 };
+    uint8_t data = 0;
+    SPIBusOp_t op = { .type = SPI_BUS_OP_READ, .reg_addr = 0xD0, .buf = &data, .len = 1 };
+    assert_int_equal(spi_bus_transfer(NULL, TEST_CS_LINE, &op, 1), SPI_BUS_ERR_NULL_ARGUMENT);
+    assert_int_equal(spi_bus_transfer(&bus, TEST_CS_LINE, NULL, 1), SPI_BUS_ERR_NULL_ARGUMENT);
+    assert_int_equal(spi_bus_transfer(&bus, TEST_CS_LINE, &op, 0), SPI_BUS_ERR_INVALID_ARGUMENT);
+    assert_int_equal(spi_bus_read(&bus, TEST_CS_LINE, 0xD0, NULL, 1), SPI_BUS_ERR_NULL_ARGUMENT);
+    assert_int_equal(spi_bus_write(&bus, TEST_CS_LINE, 0xE0, &data, 0), SPI_BUS_ERR_INVALID_ARGUMENT);
+}
+
+int run_spi_bus_tests(void) {
+    const struct CMUnitTest spi_bus_tests[] = {
+        cmocka_unit_test(test_spi_bus_pack_transfer),
+        cmocka_unit_test(test_spi_bus_pack_transfer_read_flag),
+        cmocka_unit_test(test_spi_bus_pack_transfer_limits),
+        cmocka_unit_test(test_spi_bus_invalid_args),
+    };
+    return cmocka_run_group_tests(spi_bus_tests, NULL, NULL);
+}
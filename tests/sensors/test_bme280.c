@@ -2,11 +2,25 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <unistd.h> // For: usleep
 // Cmocka must be included last (!)
 #include <cmocka.h>
 
 #include "hw/hw_interface.h"
 #include "sensors/bme280.h"
+#include "sensors/bme280_regs.h"
+
+extern SensorError_t bme280_sampler_store(Bme280_t* ctx, const Bme280_output_t* out);
+extern Bme280_u32_t
+BME280_compensate_P_int64(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+extern Bme280_u32_t
+BME280_compensate_P_int32(const Trim_t* trim, const Bme280Comp_t* comp, Bme280_s32_t adc_P, Bme280_s32_t t_fine);
+
+static volatile int data_readout_count = 0; // Number of measurement data burst reads performed via the mock
+static int transfer_count = 0;              // Number of transfers performed via the mock
+static uint8_t ctrl_meas_written = 0;       // Value last written to the ctrl_meas register via the mock
+static int forced_trigger_count = 0;        // Number of forced measurements triggered via the mock
+static int status_busy_reads = 0;           // Number of status reg reads reporting a running measurement
 
 static const uint8_t bme280_mock_memory[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -44,12 +58,38 @@ __wrap_hw_interface_read(HwInterface_t* ctx, const uint8_t slave_addr, const uin
     for(int i = 0; i < len; i++) {
         *(buf + i) = bme280_mock_memory[reg_addr + i];
     }
+    if(reg_addr == BME280_REG_STATUS && status_busy_reads > 0) {
+        StatusReg_t status = { .b.measuring = 1 };
+        *buf = status.w;
+        status_busy_reads--;
+    }
+    if(reg_addr == BME280_REG_PRESS_MSB) {
+        data_readout_count++;
+    }
 
     return HW_INTERFACE_ERR_OK;
 }
 
 HwInterfaceError_t
 __wrap_hw_interface_write(HwInterface_t* ctx, const uint8_t slave_addr, const uint8_t reg_addr, const uint8_t* data, const size_t len) {
+    CtrlMeasReg_t ctrl_meas = { .w = data[0] };
+    if(reg_addr == BME280_REG_CTRL_MEAS && ctrl_meas.b.mode == BME280_FORCED_MODE) {
+        forced_trigger_count++;
+    }
+    return HW_INTERFACE_ERR_OK;
+}
+
+HwInterfaceError_t
+__wrap_hw_interface_transfer(HwInterface_t* ctx, const uint8_t slave_addr, const HwInterfaceOp_t* ops, const size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if(ops[i].type == HW_INTERFACE_OP_READ) {
+            __wrap_hw_interface_read(ctx, slave_addr, ops[i].reg_addr, ops[i].buf, ops[i].len);
+        } else if(ops[i].reg_addr == BME280_REG_CTRL_MEAS) {
+            ctrl_meas_written = ops[i].buf[0];
+        }
+    }
+    transfer_count++;
+
     return HW_INTERFACE_ERR_OK;
 }
 
@@ -65,13 +105,30 @@ static void test_bme280_init_success(void** state) {
     (void)state;
     Bme280_t ctx;
     HwInterface_t hw_ctx;
-    assert_int_equal(bme280_init(&ctx, 0x00, hw_ctx), SENSOR_ERR_OK);
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
 }
 
 static void test_bme280_init_null_context(void** state) {
     (void)state;
+    Bme280_t ctx;
     HwInterface_t hw_ctx;
-    assert_int_equal(bme280_init(NULL, 0x00, hw_ctx), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(bme280_init(NULL, 0x00, &hw_ctx), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(bme280_init(&ctx, 0x00, NULL), SENSOR_ERR_NULL_ARGUMENT);
+}
+
+static void test_bme280_init_batched(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    ctrl_meas_written = 0;
+    int transfers = transfer_count;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+
+    // One transfer for all config registers and one for both parts of the calibration data
+    assert_int_equal(transfer_count, transfers + 2);
+    assert_int_not_equal(ctrl_meas_written, 0);
+    assert_ptr_equal(ctx.hw_ctx, &hw_ctx);
+    assert_int_equal(ctx.calib.dig_T1, 0x6e91); // Calibration data is read from the mocked memory
 }
 
 static void test_bme280_get_temp_null_context(void** state) {
@@ -97,7 +154,7 @@ static void test_bme280_get_temp_valid_read(void** state) {
     (void)state;
     Bme280_t ctx;
     HwInterface_t hw_ctx;
-    assert_int_equal(bme280_init(&ctx, 0x00, hw_ctx), SENSOR_ERR_OK);
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
 
     float temp = 0;
     assert_int_equal(bme280_get_temp(&ctx, &temp), SENSOR_ERR_OK);
@@ -108,7 +165,7 @@ static void test_bme280_get_hum_valid_read(void** state) {
     (void)state;
     Bme280_t ctx;
     HwInterface_t hw_ctx;
-    bme280_init(&ctx, 0x00, hw_ctx);
+    bme280_init(&ctx, 0x00, &hw_ctx);
 
     float hum = 0;
     assert_int_equal(bme280_get_hum(&ctx, &hum), SENSOR_ERR_OK);
@@ -119,25 +176,209 @@ static void test_bme280_get_press_valid_read(void** state) {
     (void)state;
     Bme280_t ctx;
     HwInterface_t hw_ctx;
-    bme280_init(&ctx, 0x00, hw_ctx);
+    bme280_init(&ctx, 0x00, &hw_ctx);
 
     float press = 0;
     assert_int_equal(bme280_get_press(&ctx, &press), SENSOR_ERR_OK);
     assert_in_range(press, 101300, 101400); // The pressure when the memory snapshot has been taken was 1013.3667 hPa
 }
 
+static void test_bme280_get_all_valid_read(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+
+    // All three values should come from a single burst read
+    float temp = 0, hum = 0, press = 0;
+    int readouts = data_readout_count;
+    assert_int_equal(bme280_get_all(&ctx, &temp, &hum, &press), SENSOR_ERR_OK);
+    assert_int_equal(data_readout_count, readouts + 1);
+    assert_in_range(temp, 19.0, 20.0);
+    assert_in_range(hum, 31.0, 33.0);
+    assert_in_range(press, 101300, 101400);
+}
+
+static void test_bme280_get_fixed_valid_read(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+    assert_int_equal(ctx.comp.t1_x2, ctx.calib.dig_T1 << 1); // Constant terms are computed along with the trim
+
+    // Scaled integers: centi-*C, %RH in Q22.10 and Pa in Q24.8
+    Bme280_output_t out;
+    assert_int_equal(bme280_get_fixed(&ctx, &out), SENSOR_ERR_OK);
+    assert_in_range(out.t, 1900, 2000);
+    assert_in_range(out.h, 31 * 1024, 33 * 1024);
+    assert_in_range(out.p, 101300 * 256, 101400 * 256);
+    assert_int_equal(bme280_get_fixed(&ctx, NULL), SENSOR_ERR_NULL_ARGUMENT);
+}
+
+static void test_bme280_press_comp_int32(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+
+    // The 32-bit compensation should stay within a few Pa of the 64-bit one (raw pressure from the mocked memory)
+    const uint8_t* d = &bme280_mock_memory[BME280_REG_PRESS_MSB];
+    Bme280_s32_t adc_P = (Bme280_s32_t)(((uint32_t)d[0] << 12) | ((uint32_t)d[1] << 4) | (d[2] >> 4));
+    for(Bme280_s32_t t_fine = 0; t_fine <= 40 * 5120; t_fine += 5120) { // 0 - 40 *C (t_fine = 5120 per *C)
+        Bme280_u32_t p64 = BME280_compensate_P_int64(&ctx.calib, &ctx.comp, adc_P, t_fine);
+        Bme280_u32_t p32 = BME280_compensate_P_int32(&ctx.calib, &ctx.comp, adc_P, t_fine);
+        assert_in_range(p32, p64 - 8 * 256, p64 + 8 * 256);
+        assert_int_equal(p32 & 0xFF, 0); // Integer Pa resolution
+    }
+}
+
+static void test_bme280_set_profile(void** state) {
+    (void)state;
+    Bme280_t ctx = { .is_initialized = false };
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_set_profile(&ctx, SENSOR_PROFILE_LOW_LATENCY), SENSOR_ERR_NOT_INITIALIZED);
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+
+    // High-precision after init: x16 oversampling in normal mode
+    CtrlMeasReg_t ctrl_meas = { .w = ctrl_meas_written };
+    assert_int_equal(atomic_load(&ctx.profile), SENSOR_PROFILE_HIGH_PRECISION);
+    assert_int_equal(ctrl_meas.b.osrs_t, BME280_OSRS_MAX_OVERSAMPLING);
+    assert_int_equal(ctrl_meas.b.mode, BME280_NORMAL_MODE);
+
+    // Low-latency: x1 oversampling in normal mode (all registers written in one transfer)
+    int transfers = transfer_count;
+    assert_int_equal(bme280_set_profile(&ctx, SENSOR_PROFILE_LOW_LATENCY), SENSOR_ERR_OK);
+    assert_int_equal(transfer_count, transfers + 1);
+    ctrl_meas.w = ctrl_meas_written;
+    assert_int_equal(ctrl_meas.b.osrs_p, BME280_OSRS_NO_OVERSAMPLING);
+    assert_int_equal(ctrl_meas.b.mode, BME280_NORMAL_MODE);
+
+    // Weather-station: the sensor sleeps until a readout
+    assert_int_equal(bme280_set_profile(&ctx, SENSOR_PROFILE_WEATHER_STATION), SENSOR_ERR_OK);
+    ctrl_meas.w = ctrl_meas_written;
+    assert_int_equal(ctrl_meas.b.mode, BME280_SLEEP_MODE);
+    assert_int_equal(atomic_load(&ctx.profile), SENSOR_PROFILE_WEATHER_STATION);
+
+    assert_int_equal(bme280_set_profile(&ctx, SENSOR_PROFILE_COUNT), SENSOR_ERR_INVALID_ARGUMENT);
+    assert_int_equal(atomic_load(&ctx.profile), SENSOR_PROFILE_WEATHER_STATION);
+    assert_int_equal(bme280_deinit(&ctx), SENSOR_ERR_OK);
+}
+
+static void test_bme280_forced_readout(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+    assert_int_equal(bme280_set_profile(&ctx, SENSOR_PROFILE_WEATHER_STATION), SENSOR_ERR_OK);
+
+    // Each readout triggers a measurement and waits for the status reg to report it as completed
+    int triggers = forced_trigger_count, readouts = data_readout_count;
+    status_busy_reads = 3;
+    Bme280_output_t out;
+    assert_int_equal(bme280_get_fixed(&ctx, &out), SENSOR_ERR_OK);
+    assert_int_equal(forced_trigger_count, triggers + 1);
+    assert_int_equal(data_readout_count, readouts + 1);
+    assert_int_equal(status_busy_reads, 0);
+    assert_in_range(out.t, 1900, 2000);
+
+    // A measurement that never completes times out
+    status_busy_reads = 1000;
+    assert_int_equal(bme280_get_fixed(&ctx, &out), SENSOR_ERR_TIMEOUT);
+    assert_int_equal(data_readout_count, readouts + 1);
+    status_busy_reads = 0;
+    assert_int_equal(bme280_deinit(&ctx), SENSOR_ERR_OK);
+}
+
+static void test_bme280_get_all_null_output(void** state) {
+    (void)state;
+    Bme280_t ctx = { .is_initialized = true };
+    float temp, hum;
+    assert_int_equal(bme280_get_all(&ctx, &temp, &hum, NULL), SENSOR_ERR_NULL_ARGUMENT);
+}
+
+static void test_bme280_get_cached_sample(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+
+    // Enable the cache without the sampling thread and store a sample
+    Bme280_output_t sample = { .t = 2500, .p = 100000 * 256, .h = 50 * 1024 };
+    ctx.sampler.max_age_ms = 10000;
+    assert_int_equal(bme280_sampler_store(&ctx, &sample), SENSOR_ERR_OK);
+
+    // All getters should be served from the cache (no bus transactions)
+    float temp = 0, hum = 0, press = 0;
+    int readouts = data_readout_count;
+    assert_int_equal(bme280_get_temp(&ctx, &temp), SENSOR_ERR_OK);
+    assert_int_equal(bme280_get_hum(&ctx, &hum), SENSOR_ERR_OK);
+    assert_int_equal(bme280_get_press(&ctx, &press), SENSOR_ERR_OK);
+    assert_int_equal(data_readout_count, readouts);
+    assert_in_range(temp, 24.99, 25.01);
+    assert_in_range(hum, 49.99, 50.01);
+    assert_in_range(press, 99999.0, 100001.0);
+}
+
+static void test_bme280_get_stale_sample(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+
+    // Store a sample and let it age past the max age
+    Bme280_output_t sample = { .t = 2500 };
+    ctx.sampler.max_age_ms = 1;
+    assert_int_equal(bme280_sampler_store(&ctx, &sample), SENSOR_ERR_OK);
+    usleep(5000);
+
+    // Getter should fall back to a direct readout
+    float temp = 0;
+    int readouts = data_readout_count;
+    assert_int_equal(bme280_get_temp(&ctx, &temp), SENSOR_ERR_OK);
+    assert_int_equal(data_readout_count, readouts + 1);
+    assert_in_range(temp, 19.0, 20.0);
+}
+
+static void test_bme280_sampler_start_stop(void** state) {
+    (void)state;
+    Bme280_t ctx;
+    HwInterface_t hw_ctx;
+    assert_int_equal(bme280_init(&ctx, 0x00, &hw_ctx), SENSOR_ERR_OK);
+    assert_int_equal(bme280_sampler_start(&ctx, 0, NULL, NULL), SENSOR_ERR_GENERIC);
+
+    int readouts = data_readout_count;
+    assert_int_equal(bme280_sampler_start(&ctx, 1000, NULL, NULL), SENSOR_ERR_OK);
+    usleep(100000);
+    assert_true(data_readout_count > readouts); // Sampled in the background
+
+    float temp = 0;
+    assert_int_equal(bme280_get_temp(&ctx, &temp), SENSOR_ERR_OK);
+    assert_in_range(temp, 19.0, 20.0);
+    assert_int_equal(bme280_deinit(&ctx), SENSOR_ERR_OK); // Stops the sampler as well
+}
+
 /*********************** Runner ************************/
 
 int run_bme280_tests(void) {
     const struct CMUnitTest bme280_tests[] = {
         cmocka_unit_test(test_bme280_init_success),
         cmocka_unit_test(test_bme280_init_null_context),
+        cmocka_unit_test(test_bme280_init_batched),
         cmocka_unit_test(test_bme280_get_temp_null_context),
         cmocka_unit_test(test_bme280_get_temp_null_output),
         cmocka_unit_test(test_bme280_get_temp_uninitialized_context),
         cmocka_unit_test(test_bme280_get_temp_valid_read),
         cmocka_unit_test(test_bme280_get_hum_valid_read),
         cmocka_unit_test(test_bme280_get_press_valid_read),
+        cmocka_unit_test(test_bme280_get_all_valid_read),
+        cmocka_unit_test(test_bme280_get_fixed_valid_read),
+        cmocka_unit_test(test_bme280_press_comp_int32),
+        cmocka_unit_test(test_bme280_set_profile),
+        cmocka_unit_test(test_bme280_forced_readout),
+        cmocka_unit_test(test_bme280_get_all_null_output),
+        cmocka_unit_test(test_bme280_get_cached_sample),
+        cmocka_unit_test(test_bme280_get_stale_sample),
+        cmocka_unit_test(test_bme280_sampler_start_stop),
     };
 
     return cmocka_run_group_tests(bme280_tests, NULL, NULL);
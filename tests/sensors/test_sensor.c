@@ -0,0 +1,87 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "sensors/sensor.h"
+
+
+/************************ Unit tests ************************/
+
+static void test_sensor_q_to_centi(void** state) {
+    assert_int_equal(sensor_q_to_centi(47445, SENSOR_HUM_FRAC_BITS), 4633);        // 46.333 %RH
+    assert_int_equal(sensor_q_to_centi(24674867, SENSOR_PRESS_FRAC_BITS), 9638620); // 96386.199 Pa
+    assert_int_equal(sensor_q_to_centi(100 * 1024, SENSOR_HUM_FRAC_BITS), 10000);
+    assert_int_equal(sensor_q_to_centi(0, SENSOR_HUM_FRAC_BITS), 0);
+
+    // Rounded to the nearest hundredth (1/256 = 0.0039, 2/256 = 0.0078)
+    assert_int_equal(sensor_q_to_centi(1, SENSOR_PRESS_FRAC_BITS), 0);
+    assert_int_equal(sensor_q_to_centi(2, SENSOR_PRESS_FRAC_BITS), 1);
+
+    // The largest Q24.8 value does not overflow
+    assert_int_equal(sensor_q_to_centi(UINT32_MAX, SENSOR_PRESS_FRAC_BITS), 16777215U * 100 + 100);
+}
+
+static void test_sensor_format_centi(void** state) {
+    char buf[SENSOR_CENTI_STR_SIZE];
+    assert_int_equal(sensor_format_centi(buf, sizeof(buf), 1988), 5);
+    assert_string_equal(buf, "19.88");
+    assert_int_equal(sensor_format_centi(buf, sizeof(buf), 10133667), 9);
+    assert_string_equal(buf, "101336.67");
+
+    // Values below one keep the leading zero
+    sensor_format_centi(buf, sizeof(buf), 0);
+    assert_string_equal(buf, "0.00");
+    sensor_format_centi(buf, sizeof(buf), 5);
+    assert_string_equal(buf, "0.05");
+    sensor_format_centi(buf, sizeof(buf), 40);
+    assert_string_equal(buf, "0.40");
+}
+
+static void test_sensor_format_centi_negative(void** state) {
+    char buf[SENSOR_CENTI_STR_SIZE];
+    sensor_format_centi(buf, sizeof(buf), -512);
+    assert_string_equal(buf, "-5.12");
+    sensor_format_centi(buf, sizeof(buf), -7);
+    assert_string_equal(buf, "-0.07");
+    assert_int_equal(sensor_format_centi(buf, sizeof(buf), INT32_MIN), 12);
+    assert_string_equal(buf, "-21474836.48");
+}
+
+static void test_sensor_format_centi_small_buf(void** state) {
+    char buf[SENSOR_CENTI_STR_SIZE] = "";
+    assert_int_equal(sensor_format_centi(buf, 5, 1988), 0); // "19.88" requires 6 bytes
+    assert_int_equal(sensor_format_centi(buf, 6, 1988), 5);
+    assert_string_equal(buf, "19.88");
+    assert_int_equal(sensor_format_centi(NULL, sizeof(buf), 1988), 0);
+}
+
+static void test_sensor_profile_names(void** state) {
+    SensorProfile_t profile = SENSOR_PROFILE_COUNT;
+    assert_int_equal(sensor_profile_from_name("weather-station", &profile), SENSOR_ERR_OK);
+    assert_int_equal(profile, SENSOR_PROFILE_WEATHER_STATION);
+    assert_int_equal(sensor_profile_from_name("Low-Latency", &profile), SENSOR_ERR_OK);
+    assert_int_equal(profile, SENSOR_PROFILE_LOW_LATENCY);
+    assert_int_equal(sensor_profile_from_name("fast", &profile), SENSOR_ERR_INVALID_ARGUMENT);
+    assert_int_equal(sensor_profile_from_name(NULL, &profile), SENSOR_ERR_NULL_ARGUMENT);
+
+    // Names round-trip
+    for(int i = 0; i < SENSOR_PROFILE_COUNT; i++) {
+        assert_int_equal(sensor_profile_from_name(sensor_profile_name((SensorProfile_t)i), &profile), SENSOR_ERR_OK);
+        assert_int_equal(profile, i);
+    }
+    assert_string_equal(sensor_profile_name(SENSOR_PROFILE_COUNT), "unknown");
+}
+
+int run_sensor_tests(void) {
+    const struct CMUnitTest sensor_tests[] = {
+        cmocka_unit_test(test_sensor_q_to_centi),
+        cmocka_unit_test(test_sensor_format_centi),
+        cmocka_unit_test(test_sensor_format_centi_negative),
+        cmocka_unit_test(test_sensor_format_centi_small_buf),
+        cmocka_unit_test(test_sensor_profile_names),
+    };
+    return cmocka_run_group_tests(sensor_tests, NULL, NULL);
+}
@@ -0,0 +1,244 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>    // For: snprintf(), remove()
+#include <sys/stat.h> // For: stat()
+#include <unistd.h>   // For: getpid(), truncate()
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "sensors/sensor_history.h"
+
+extern uint32_t sensor_history_lower_bound(const SensorHistory_t* ctx, const int64_t ts_ms);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_T0_MS 1700000000000LL // Timestamp of the first sample in the tests
+#define TEST_HEADER_SIZE 8         // Size of the backing file header
+#define TEST_RECORD_SIZE 24        // Size of a single record in the backing file
+
+static SensorReading_t test_reading(const int32_t temp_cC) {
+    return (SensorReading_t){ .fields = SENSOR_FIELD_TEMP | SENSOR_FIELD_HUM | SENSOR_FIELD_PRESS,
+        .temp_cC = temp_cC,
+        .hum_q10 = 40 * 1024,
+        .press_q8 = 101325 * 256 };
+}
+
+static void test_path(char* buf, const size_t size) {
+    snprintf(buf, size, "/tmp/pihub_test_history_%d.bin", (int)getpid());
+    remove(buf);
+}
+
+static long test_file_size(const char* path) {
+    struct stat st;
+    return (stat(path, &st) == 0) ? (long)st.st_size : -1;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_sensor_history_ring(void** state) {
+    SensorHistory_t h;
+    SensorHistoryConfig_t cfg = { .capacity = 4, .interval_ms = 0, .path = NULL };
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+
+    // The oldest samples are overwritten once the ring is full
+    for(int i = 0; i < 6; i++) {
+        SensorReading_t r = test_reading(i);
+        assert_int_equal(sensor_history_append(&h, TEST_T0_MS + i * 1000, &r), SENSOR_HISTORY_ERR_OK);
+    }
+    assert_int_equal(sensor_history_count(&h), 4);
+    assert_int_equal(h.ts_ms[h.head], TEST_T0_MS + 2000);
+    assert_int_equal(h.values[SENSOR_HISTORY_TEMP][h.head], 2);
+
+    // Binary search over the wrapped ring
+    assert_int_equal(sensor_history_lower_bound(&h, 0), 0);
+    assert_int_equal(sensor_history_lower_bound(&h, TEST_T0_MS + 2000), 0);
+    assert_int_equal(sensor_history_lower_bound(&h, TEST_T0_MS + 2001), 1);
+    assert_int_equal(sensor_history_lower_bound(&h, TEST_T0_MS + 5000), 3);
+    assert_int_equal(sensor_history_lower_bound(&h, TEST_T0_MS + 5001), 4);
+
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+}
+
+static void test_sensor_history_dropped(void** state) {
+    SensorHistory_t h;
+    SensorHistoryConfig_t cfg = { .capacity = 8, .interval_ms = 1000, .path = NULL };
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+
+    // Samples sooner than the interval after the last stored one or older than it are dropped
+    SensorReading_t r = test_reading(2000);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS, &r), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS + 999, &r), SENSOR_HISTORY_ERR_DROPPED);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS - 5000, &r), SENSOR_HISTORY_ERR_DROPPED);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS + 1000, &r), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_count(&h), 2);
+
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+}
+
+static void test_sensor_history_query(void** state) {
+    SensorHistory_t h;
+    SensorHistoryConfig_t cfg = { .capacity = 64, .interval_ms = 0, .path = NULL };
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+
+    // One sample per second: -5, -4, ..., 4 *C (in hundredths)
+    for(int i = 0; i < 10; i++) {
+        SensorReading_t r = test_reading((i - 5) * 100);
+        assert_int_equal(sensor_history_append(&h, TEST_T0_MS + i * 1000, &r), SENSOR_HISTORY_ERR_OK);
+    }
+    // A sample without the temperature is skipped by the temperature queries only
+    SensorReading_t no_temp = test_reading(0);
+    no_temp.fields = SENSOR_FIELD_HUM;
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS + 10000, &no_temp), SENSOR_HISTORY_ERR_OK);
+
+    // Four buckets of four seconds (the last one starts after the last sample)
+    SensorHistoryBucket_t b[8];
+    size_t count = 0;
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_TEMP, TEST_T0_MS, TEST_T0_MS + 16000, 4000, b, 8, &count),
+    SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(count, 4);
+    assert_int_equal(b[0].start_ms, TEST_T0_MS);
+    assert_int_equal(b[0].count, 4);
+    assert_int_equal(b[0].min, -500);
+    assert_int_equal(b[0].max, -200);
+    assert_int_equal(b[0].avg, -350);
+    assert_int_equal(b[1].start_ms, TEST_T0_MS + 4000);
+    assert_int_equal(b[1].count, 4);
+    assert_int_equal(b[1].min, -100);
+    assert_int_equal(b[1].max, 200);
+    assert_int_equal(b[1].avg, 50);
+    assert_int_equal(b[2].count, 2);
+    assert_int_equal(b[2].avg, 350);
+    assert_int_equal(b[3].count, 0);
+
+    // The end of the window is exclusive; the window may start before the oldest sample
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_TEMP, TEST_T0_MS - 1000, TEST_T0_MS + 2000, 1000, b, 8, &count),
+    SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(count, 3);
+    assert_int_equal(b[0].count, 0);
+    assert_int_equal(b[1].count, 1);
+    assert_int_equal(b[2].count, 1);
+    assert_int_equal(b[2].max, -400);
+
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_HUM, TEST_T0_MS, TEST_T0_MS + 11000, 11000, b, 8, &count),
+    SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(count, 1);
+    assert_int_equal(b[0].count, 11);
+    assert_int_equal(b[0].avg, 40 * 1024);
+
+    // Invalid windows and too many buckets
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_TEMP, TEST_T0_MS, TEST_T0_MS, 1000, b, 8, &count),
+    SENSOR_HISTORY_ERR_INVALID_ARGUMENT);
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_TEMP, TEST_T0_MS, TEST_T0_MS + 1000, 0, b, 8, &count),
+    SENSOR_HISTORY_ERR_INVALID_ARGUMENT);
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_TEMP, TEST_T0_MS, TEST_T0_MS + 9000, 1000, b, 8, &count),
+    SENSOR_HISTORY_ERR_INVALID_ARGUMENT);
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_QTY_COUNT, TEST_T0_MS, TEST_T0_MS + 1000, 1000, b, 8, &count),
+    SENSOR_HISTORY_ERR_INVALID_ARGUMENT);
+    assert_int_equal(sensor_history_query(&h, SENSOR_HISTORY_TEMP, TEST_T0_MS, TEST_T0_MS + 1000, 1000, NULL, 8, &count),
+    SENSOR_HISTORY_ERR_NULL_ARGUMENT);
+
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+}
+
+static void test_sensor_history_file_reload(void** state) {
+    char path[64];
+    test_path(path, sizeof(path));
+    SensorHistory_t h;
+    SensorHistoryConfig_t cfg = { .capacity = 16, .interval_ms = 0, .path = path };
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+    for(int i = 0; i < 5; i++) {
+        SensorReading_t r = test_reading(2100 + i);
+        assert_int_equal(sensor_history_append(&h, TEST_T0_MS + i * 1000, &r), SENSOR_HISTORY_ERR_OK);
+    }
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(test_file_size(path), TEST_HEADER_SIZE + 5 * TEST_RECORD_SIZE);
+
+    // A torn record at the end is dropped on reload, the rest of the samples are loaded back
+    assert_int_equal(truncate(path, TEST_HEADER_SIZE + 5 * TEST_RECORD_SIZE - 3), 0);
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_count(&h), 4);
+    assert_int_equal(test_file_size(path), TEST_HEADER_SIZE + 4 * TEST_RECORD_SIZE);
+    assert_int_equal(h.values[SENSOR_HISTORY_TEMP][3], 2103);
+    assert_int_equal(h.values[SENSOR_HISTORY_PRESS][3], 101325 * 256);
+
+    // Appends continue at the end of the file
+    SensorReading_t r = test_reading(2200);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS + 10000, &r), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_count(&h), 5);
+    assert_int_equal(h.ts_ms[4], TEST_T0_MS + 10000);
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+
+    // Only the last cfg.capacity records are loaded into a smaller ring
+    cfg.capacity = 2;
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_count(&h), 2);
+    assert_int_equal(h.values[SENSOR_HISTORY_TEMP][h.head], 2103);
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+
+    remove(path);
+}
+
+static void test_sensor_history_file_compaction(void** state) {
+    char path[64];
+    test_path(path, sizeof(path));
+    SensorHistory_t h;
+    SensorHistoryConfig_t cfg = { .capacity = 4, .interval_ms = 0, .path = path };
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+
+    // The file is rewritten with the ring content once it holds 2 * capacity records
+    for(int i = 0; i < 7; i++) {
+        SensorReading_t r = test_reading(i);
+        assert_int_equal(sensor_history_append(&h, TEST_T0_MS + i * 1000, &r), SENSOR_HISTORY_ERR_OK);
+    }
+    assert_int_equal(test_file_size(path), TEST_HEADER_SIZE + 7 * TEST_RECORD_SIZE);
+    SensorReading_t r = test_reading(7);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS + 7000, &r), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(test_file_size(path), TEST_HEADER_SIZE + 4 * TEST_RECORD_SIZE);
+    r = test_reading(8);
+    assert_int_equal(sensor_history_append(&h, TEST_T0_MS + 8000, &r), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(test_file_size(path), TEST_HEADER_SIZE + 5 * TEST_RECORD_SIZE);
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+
+    // The compacted file holds the newest samples
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_OK);
+    assert_int_equal(sensor_history_count(&h), 4);
+    assert_int_equal(h.values[SENSOR_HISTORY_TEMP][h.head], 5);
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+
+    remove(path);
+}
+
+static void test_sensor_history_invalid_args(void** state) {
+    SensorHistory_t h;
+    SensorHistoryConfig_t cfg = { .capacity = 0, .interval_ms = 0, .path = NULL };
+    assert_int_equal(sensor_history_init(NULL, cfg), SENSOR_HISTORY_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_INVALID_ARGUMENT);
+
+    // A backing file that cannot be created fails the init
+    cfg = (SensorHistoryConfig_t){ .capacity = 4, .interval_ms = 0, .path = "/nonexistent/dir/history.bin" };
+    assert_int_equal(sensor_history_init(&h, cfg), SENSOR_HISTORY_ERR_FILE_FAILURE);
+    assert_null(h.ts_ms);
+    assert_int_equal(sensor_history_deinit(&h), SENSOR_HISTORY_ERR_OK);
+
+    SensorReading_t r = test_reading(0);
+    assert_int_equal(sensor_history_append(NULL, TEST_T0_MS, &r), SENSOR_HISTORY_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_history_count(NULL), 0);
+}
+
+int run_sensor_history_tests(void) {
+    const struct CMUnitTest sensor_history_tests[] = {
+        cmocka_unit_test(test_sensor_history_ring),
+        cmocka_unit_test(test_sensor_history_dropped),
+        cmocka_unit_test(test_sensor_history_query),
+        cmocka_unit_test(test_sensor_history_file_reload),
+        cmocka_unit_test(test_sensor_history_file_compaction),
+        cmocka_unit_test(test_sensor_history_invalid_args),
+    };
+    return cmocka_run_group_tests(sensor_history_tests, NULL, NULL);
+}
@@ -0,0 +1,269 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // For: memset
+#include <time.h>   // For: clock_gettime
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "sensors/sensor_registry.h"
+
+
+/************************ Mock and stub functions ************************/
+
+#define FAKE_RESET_DELAY_MS 30 // Reset delay of the fake driver
+#define FAKE_MAX_CALLS 32      // Max number of recorded driver calls
+
+static const uint8_t fake_addrs[] = { 0x40, 0x41, 0x42 }; // Addresses probed by the fake driver
+
+static uint8_t fake_present[] = { 0x41, 0x42 }; // Addresses of the devices "connected" to the bus
+static uint8_t fake_failing_addr = 0;           // Address of the device failing in init_complete (0: none)
+static char fake_calls[FAKE_MAX_CALLS];         // Order of the driver calls ('s': init_start, 'c': init_complete)
+static int fake_call_count = 0;                 // Number of recorded driver calls
+static int fake_deinit_count = 0;               // Number of deinit calls
+static int fake_profile = -1;                   // Profile last applied via set_profile (-1: none)
+
+static SensorError_t fake_probe(HwInterface_t* hw_ctx, const uint8_t addr) {
+    for(size_t i = 0; i < sizeof(fake_present); i++) {
+        if(fake_present[i] == addr) {
+            return SENSOR_ERR_OK;
+        }
+    }
+    return SENSOR_ERR_HW_INTERFACE_FAILURE;
+}
+
+static SensorError_t fake_init_start(void* ctx, const uint8_t addr, HwInterface_t* hw_ctx) {
+    // The context is stored in the driver-specific union, so any layout fits
+    *(uint8_t*)ctx = addr;
+    fake_calls[fake_call_count++] = 's';
+    return fake_probe(hw_ctx, addr);
+}
+
+static SensorError_t fake_init_complete(void* ctx) {
+    fake_calls[fake_call_count++] = 'c';
+    return (*(uint8_t*)ctx == fake_failing_addr) ? SENSOR_ERR_HW_INTERFACE_FAILURE : SENSOR_ERR_OK;
+}
+
+static SensorError_t fake_read(void* ctx, SensorReading_t* reading) {
+    reading->fields = SENSOR_FIELD_TEMP;
+    reading->temp_cC = *(uint8_t*)ctx;
+    return SENSOR_ERR_OK;
+}
+
+static SensorError_t fake_deinit(void* ctx) {
+    fake_deinit_count++;
+    return SENSOR_ERR_OK;
+}
+
+static const SensorDriver_t FAKE_DRIVER = {
+    .name = "fake",
+    .i2c_addrs = fake_addrs,
+    .i2c_addr_count = sizeof(fake_addrs) / sizeof(fake_addrs[0]),
+    .reset_delay_ms = FAKE_RESET_DELAY_MS,
+    .probe = fake_probe,
+    .init_start = fake_init_start,
+    .init_complete = fake_init_complete,
+    .read = fake_read,
+    .sampler_start = NULL,
+    .deinit = fake_deinit,
+};
+
+static SensorError_t fake_set_profile(void* ctx, const SensorProfile_t profile) {
+    fake_profile = (int)profile;
+    return SENSOR_ERR_OK;
+}
+
+static const SensorDriver_t FAKE_PROFILE_DRIVER = {
+    .name = "fake-profile",
+    .i2c_addrs = fake_addrs,
+    .i2c_addr_count = sizeof(fake_addrs) / sizeof(fake_addrs[0]),
+    .reset_delay_ms = FAKE_RESET_DELAY_MS,
+    .probe = fake_probe,
+    .init_start = fake_init_start,
+    .init_complete = fake_init_complete,
+    .read = fake_read,
+    .sampler_start = NULL,
+    .set_profile = fake_set_profile,
+    .deinit = fake_deinit,
+};
+
+
+/************************ Test fixtures ************************/
+
+static SensorRegistry_t test_registry; // Registry under test
+static HwInterface_t test_bus_a;       // Fake buses (only their addresses are used by the registry)
+static HwInterface_t test_bus_b;
+
+static int sensor_registry_test_setup(void** state) {
+    fake_failing_addr = 0;
+    fake_call_count = 0;
+    fake_deinit_count = 0;
+    fake_profile = -1;
+    return sensor_registry_init(&test_registry) == SENSOR_ERR_OK ? 0 : -1;
+}
+
+static int sensor_registry_test_teardown(void** state) {
+    return sensor_registry_deinit(&test_registry) == SENSOR_ERR_OK ? 0 : -1;
+}
+
+static uint64_t test_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_sensor_registry_add(void** state) {
+    size_t id;
+    SensorInfo_t info = { .addr = 0x41, .if_type = HW_INTERFACE_I2C };
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, &test_bus_a, &id), SENSOR_ERR_OK);
+    assert_int_equal(id, 0);
+
+    // The same address may be used once per bus
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, &test_bus_a, &id), SENSOR_ERR_ALREADY_REGISTERED);
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, &test_bus_b, &id), SENSOR_ERR_OK);
+    assert_int_equal(id, 1);
+
+    const Sensor_t* sensor = sensor_registry_get(&test_registry, 1);
+    assert_non_null(sensor);
+    assert_ptr_equal(sensor->hw_ctx, &test_bus_b);
+    assert_false(sensor->is_initialized);
+    assert_null(sensor_registry_get(&test_registry, 2));
+}
+
+static void test_sensor_registry_full(void** state) {
+    for(int i = 0; i < SENSOR_REGISTRY_MAX_SENSORS; i++) {
+        SensorInfo_t info = { .addr = (uint8_t)i, .if_type = HW_INTERFACE_I2C };
+        assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, &test_bus_a, NULL), SENSOR_ERR_OK);
+    }
+    SensorInfo_t info = { .addr = 0x7F, .if_type = HW_INTERFACE_I2C };
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, &test_bus_a, NULL), SENSOR_ERR_REGISTRY_FULL);
+}
+
+static void test_sensor_registry_discover(void** state) {
+    // A configured sensor is not probed (nor added) again
+    SensorInfo_t info = { .addr = 0x42, .if_type = HW_INTERFACE_I2C };
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, &test_bus_a, NULL), SENSOR_ERR_OK);
+
+    size_t found = 0;
+    assert_int_equal(sensor_registry_discover(&test_registry, &FAKE_DRIVER, &test_bus_a, &found), SENSOR_ERR_OK);
+    assert_int_equal(found, 1);
+    assert_int_equal(test_registry.count, 2);
+    assert_int_equal(sensor_registry_get(&test_registry, 1)->info.addr, 0x41);
+    assert_true(sensor_registry_get(&test_registry, 1)->discovered);
+    assert_false(sensor_registry_get(&test_registry, 0)->discovered);
+
+    // Both devices are found on the other bus
+    assert_int_equal(sensor_registry_discover(&test_registry, &FAKE_DRIVER, &test_bus_b, &found), SENSOR_ERR_OK);
+    assert_int_equal(found, 2);
+    assert_int_equal(test_registry.count, 4);
+}
+
+static void test_sensor_registry_init_all(void** state) {
+    size_t found = 0;
+    assert_int_equal(sensor_registry_discover(&test_registry, &FAKE_DRIVER, &test_bus_a, &found), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_discover(&test_registry, &FAKE_DRIVER, &test_bus_b, &found), SENSOR_ERR_OK);
+    assert_int_equal(test_registry.count, 4);
+
+    // All resets are triggered before any init is completed and the reset delay is waited for only once
+    size_t initialized = 0;
+    uint64_t start_ms = test_time_ms();
+    assert_int_equal(sensor_registry_init_all(&test_registry, &initialized), SENSOR_ERR_OK);
+    uint64_t elapsed_ms = test_time_ms() - start_ms;
+    assert_int_equal(initialized, 4);
+    assert_int_equal(fake_call_count, 8);
+    assert_memory_equal(fake_calls, "sssscccc", 8);
+    assert_true(elapsed_ms >= FAKE_RESET_DELAY_MS);
+    assert_true(elapsed_ms < 2 * FAKE_RESET_DELAY_MS);
+
+    SensorReading_t reading;
+    assert_int_equal(sensor_registry_read(&test_registry, 3, &reading), SENSOR_ERR_OK);
+    assert_true(reading.fields & SENSOR_FIELD_TEMP);
+    assert_int_equal(reading.temp_cC, 0x42);
+}
+
+static void test_sensor_registry_init_failure(void** state) {
+    // A sensor absent from the bus fails in the first phase, another one in the second phase
+    SensorInfo_t absent = { .addr = 0x40, .if_type = HW_INTERFACE_I2C };
+    SensorInfo_t failing = { .addr = 0x41, .if_type = HW_INTERFACE_I2C };
+    SensorInfo_t working = { .addr = 0x42, .if_type = HW_INTERFACE_I2C };
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, absent, &test_bus_a, NULL), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, failing, &test_bus_a, NULL), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, working, &test_bus_a, NULL), SENSOR_ERR_OK);
+    fake_failing_addr = 0x41;
+
+    size_t initialized = 0;
+    assert_int_equal(sensor_registry_init_all(&test_registry, &initialized), SENSOR_ERR_HW_INTERFACE_FAILURE);
+    assert_int_equal(initialized, 1);
+    assert_memory_equal(fake_calls, "ssscc", 5);
+
+    // The IDs stay stable, failed sensors report they are not initialized
+    SensorReading_t reading;
+    assert_int_equal(sensor_registry_read(&test_registry, 0, &reading), SENSOR_ERR_NOT_INITIALIZED);
+    assert_int_equal(sensor_registry_read(&test_registry, 1, &reading), SENSOR_ERR_NOT_INITIALIZED);
+    assert_int_equal(sensor_registry_read(&test_registry, 2, &reading), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_read(&test_registry, 3, &reading), SENSOR_ERR_NOT_FOUND);
+
+    // Only the initialized sensor is deinitialized, samplers are skipped for drivers without one
+    assert_int_equal(sensor_registry_start_samplers(&test_registry, 1000), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_deinit(&test_registry), SENSOR_ERR_OK);
+    assert_int_equal(fake_deinit_count, 1);
+    assert_int_equal(test_registry.count, 0);
+}
+
+static void test_sensor_registry_profiles(void** state) {
+    // The configured profile is applied on init (the default one is not applied again)
+    SensorInfo_t plain = { .addr = 0x41, .if_type = HW_INTERFACE_I2C, .profile = SENSOR_PROFILE_LOW_LATENCY };
+    SensorInfo_t weather = { .addr = 0x42, .if_type = HW_INTERFACE_I2C, .profile = SENSOR_PROFILE_WEATHER_STATION };
+    SensorInfo_t absent = { .addr = 0x40, .if_type = HW_INTERFACE_I2C };
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, plain, &test_bus_a, NULL), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_PROFILE_DRIVER, weather, &test_bus_a, NULL), SENSOR_ERR_OK);
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_PROFILE_DRIVER, absent, &test_bus_a, NULL), SENSOR_ERR_OK);
+
+    // Drivers without profiles fail to apply one, but stay initialized (the absent sensor's error is reported first)
+    size_t initialized = 0;
+    assert_int_equal(sensor_registry_init_all(&test_registry, &initialized), SENSOR_ERR_HW_INTERFACE_FAILURE);
+    assert_int_equal(initialized, 2);
+    assert_int_equal(fake_profile, SENSOR_PROFILE_WEATHER_STATION);
+    assert_int_equal(atomic_load(&sensor_registry_get(&test_registry, 1)->profile), SENSOR_PROFILE_WEATHER_STATION);
+    assert_int_equal(atomic_load(&sensor_registry_get(&test_registry, 0)->profile), SENSOR_PROFILE_HIGH_PRECISION);
+
+    // Switching at runtime
+    assert_int_equal(sensor_registry_set_profile(&test_registry, 1, SENSOR_PROFILE_LOW_LATENCY), SENSOR_ERR_OK);
+    assert_int_equal(fake_profile, SENSOR_PROFILE_LOW_LATENCY);
+    assert_int_equal(atomic_load(&sensor_registry_get(&test_registry, 1)->profile), SENSOR_PROFILE_LOW_LATENCY);
+    assert_int_equal(sensor_registry_set_profile(&test_registry, 1, SENSOR_PROFILE_COUNT), SENSOR_ERR_INVALID_ARGUMENT);
+    assert_int_equal(sensor_registry_set_profile(&test_registry, 0, SENSOR_PROFILE_LOW_LATENCY), SENSOR_ERR_NOT_SUPPORTED);
+    assert_int_equal(sensor_registry_set_profile(&test_registry, 2, SENSOR_PROFILE_LOW_LATENCY), SENSOR_ERR_NOT_INITIALIZED);
+    assert_int_equal(sensor_registry_set_profile(&test_registry, 3, SENSOR_PROFILE_LOW_LATENCY), SENSOR_ERR_NOT_FOUND);
+    assert_int_equal(fake_profile, SENSOR_PROFILE_LOW_LATENCY);
+}
+
+static void test_sensor_registry_null_args(void** state) {
+    SensorInfo_t info = { .addr = 0x41, .if_type = HW_INTERFACE_I2C };
+    SensorReading_t reading;
+    assert_int_equal(sensor_registry_init(NULL), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_registry_add(&test_registry, NULL, info, &test_bus_a, NULL), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_registry_add(&test_registry, &FAKE_DRIVER, info, NULL, NULL), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_registry_discover(&test_registry, &FAKE_DRIVER, NULL, NULL), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_registry_init_all(NULL, NULL), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_registry_read(&test_registry, 0, NULL), SENSOR_ERR_NULL_ARGUMENT);
+    assert_int_equal(sensor_registry_read(&test_registry, 0, &reading), SENSOR_ERR_NOT_FOUND);
+    assert_null(sensor_registry_get(NULL, 0));
+}
+
+int run_sensor_registry_tests(void) {
+    const struct CMUnitTest sensor_registry_tests[] = {
+        cmocka_unit_test_setup_teardown(test_sensor_registry_add, sensor_registry_test_setup, sensor_registry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sensor_registry_full, sensor_registry_test_setup, sensor_registry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sensor_registry_discover, sensor_registry_test_setup, sensor_registry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sensor_registry_init_all, sensor_registry_test_setup, sensor_registry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sensor_registry_init_failure, sensor_registry_test_setup, sensor_registry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sensor_registry_profiles, sensor_registry_test_setup, sensor_registry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sensor_registry_null_args, sensor_registry_test_setup, sensor_registry_test_teardown),
+    };
+    return cmocka_run_group_tests(sensor_registry_tests, NULL, NULL);
+}
@@ -9,6 +9,23 @@ extern int run_network_tests(void);
 extern int run_llist_tests(void);
 extern int run_dispatcher_tests(void);
 extern int run_bme280_tests(void);
+extern int run_server_rx_tests(void);
+extern int run_subscription_tests(void);
+extern int run_gpio_tests(void);
+extern int run_log_tests(void);
+extern int run_client_table_tests(void);
+extern int run_tx_queue_tests(void);
+extern int run_strbuf_tests(void);
+extern int run_sysstat_tests(void);
+extern int run_i2c_bus_tests(void);
+extern int run_spi_bus_tests(void);
+extern int run_sensor_registry_tests(void);
+extern int run_sensor_tests(void);
+extern int run_sensor_history_tests(void);
+extern int run_proto_tests(void);
+extern int run_metrics_tests(void);
+extern int run_backoff_tests(void);
+extern int run_listener_tests(void);
 
 int main() {
     // Configure the CMocka results generation
@@ -19,5 +36,22 @@ int main() {
     result += run_llist_tests();
     result += run_dispatcher_tests();
     result += run_bme280_tests();
+    result += run_server_rx_tests();
+    result += run_subscription_tests();
+    result += run_gpio_tests();
+    result += run_log_tests();
+    result += run_client_table_tests();
+    result += run_tx_queue_tests();
+    result += run_strbuf_tests();
+    result += run_sysstat_tests();
+    result += run_i2c_bus_tests();
+    result += run_spi_bus_tests();
+    result += run_sensor_registry_tests();
+    result += run_sensor_tests();
+    result += run_sensor_history_tests();
+    result += run_proto_tests();
+    result += run_metrics_tests();
+    result += run_backoff_tests();
+    result += run_listener_tests();
     return result;
 }
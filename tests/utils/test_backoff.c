@@ -0,0 +1,66 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "utils/backoff.h"
+
+
+/************************ Unit tests ************************/
+
+static void test_backoff_doubles_up_to_max(void** state) {
+    Backoff_t b;
+    assert_int_equal(backoff_init(&b, 100, 1000, 60000), BACKOFF_ERR_OK);
+
+    // Failures in a row (each one right after the previous attempt)
+    assert_int_equal(backoff_next(&b, 0), 100);
+    assert_int_equal(backoff_next(&b, 100), 200);
+    assert_int_equal(backoff_next(&b, 300), 400);
+    assert_int_equal(backoff_next(&b, 700), 800);
+    assert_int_equal(backoff_next(&b, 1500), 1000);
+    assert_int_equal(backoff_next(&b, 2500), 1000);
+}
+
+static void test_backoff_reset_when_stable(void** state) {
+    Backoff_t b;
+    assert_int_equal(backoff_init(&b, 100, 1000, 5000), BACKOFF_ERR_OK);
+
+    assert_int_equal(backoff_next(&b, 0), 100);
+    assert_int_equal(backoff_next(&b, 100), 200);
+
+    // Not stable for long enough yet
+    assert_int_equal(backoff_next(&b, 4000), 400);
+
+    // Running without failures for stable_ms
+    assert_int_equal(backoff_next(&b, 9000), 100);
+    assert_int_equal(backoff_next(&b, 9100), 200);
+}
+
+static void test_backoff_no_overflow(void** state) {
+    Backoff_t b;
+    assert_int_equal(backoff_init(&b, 0x80000000u, UINT32_MAX, 1000), BACKOFF_ERR_OK);
+
+    assert_int_equal(backoff_next(&b, 0), 0x80000000u);
+    assert_int_equal(backoff_next(&b, 1), UINT32_MAX);
+    assert_int_equal(backoff_next(&b, 2), UINT32_MAX);
+}
+
+static void test_backoff_invalid_args(void** state) {
+    Backoff_t b;
+    assert_int_equal(backoff_init(NULL, 100, 1000, 1000), BACKOFF_ERR_NULL_ARGUMENT);
+    assert_int_equal(backoff_init(&b, 0, 1000, 1000), BACKOFF_ERR_INVALID_ARG);
+    assert_int_equal(backoff_init(&b, 1000, 100, 1000), BACKOFF_ERR_INVALID_ARG);
+    assert_int_equal(backoff_next(NULL, 0), 0);
+}
+
+int run_backoff_tests(void) {
+    const struct CMUnitTest backoff_tests[] = {
+        cmocka_unit_test(test_backoff_doubles_up_to_max),
+        cmocka_unit_test(test_backoff_reset_when_stable),
+        cmocka_unit_test(test_backoff_no_overflow),
+        cmocka_unit_test(test_backoff_invalid_args),
+    };
+    return cmocka_run_group_tests(backoff_tests, NULL, NULL);
+}
@@ -2,6 +2,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <pthread.h> // For: pthread_create, pthread_join
 // Cmocka must be included last (!)
 #include <cmocka.h>
 
@@ -15,6 +16,9 @@ extern int32_t llist_get_length(List_t* ctx);
 extern ListError_t llist_remove(List_t* ctx, const void* data);
 extern ListError_t llist_traverse(List_t* ctx, ListError_t (*func)(void* data));
 extern ListError_t llist_deinit(List_t* ctx);
+extern ListError_t llist_foreach_begin(List_t* ctx, ListIter_t* it);
+extern const void* llist_foreach_next(List_t* ctx, ListIter_t* it);
+extern ListError_t llist_foreach_end(List_t* ctx, ListIter_t* it);
 
 
 /********************* Auxiliary functions *********************/
@@ -28,8 +32,21 @@ static ListError_t add_one(void* data) {
     return LIST_ERR_OK;
 }
 
+// Counting allocator (arg points to the number of live allocations)
+static void* counting_alloc(void* arg, size_t size) {
+    (*(int*)arg)++;
+    return malloc(size);
+}
+
+static void counting_free(void* arg, void* ptr) {
+    (*(int*)arg)--;
+    free(ptr);
+}
+
 /************************ Test fixtures ************************/
 
+#define TEST_POOL_CAPACITY 4
+
 List_t test_ll; // Test Linked List
 
 // Init Linked List and push two integers (15 and -10)
@@ -48,6 +65,17 @@ static int llist_test_teardown(void** state) {
     return 0;
 }
 
+// Iterate over test_ll in another thread (returns the sum of all nodes)
+static void* foreach_reader(void* arg) {
+    ListIter_t it;
+    assert_int_equal(llist_foreach_begin(&test_ll, &it), LIST_ERR_OK);
+    for(const void* data = llist_foreach_next(&test_ll, &it); data; data = llist_foreach_next(&test_ll, &it)) {
+        *(int*)arg += *(const int*)data;
+    }
+    assert_int_equal(llist_foreach_end(&test_ll, &it), LIST_ERR_OK);
+    return NULL;
+}
+
 /************************ Unit tests ************************/
 
 /* Parameters as expected; llist_init should succeed */
@@ -253,6 +281,139 @@ static void test_llist_repeated_removes(void** state) {
     assert_true(result);
 }
 
+/* Nodes are taken from the pool and returned to it on remove */
+static void test_llist_pool_reuse(void** state) {
+    List_t list;
+    assert_int_equal(llist_init(&list, cmp), LIST_ERR_OK);
+    assert_int_equal(llist_pool_init(&list, sizeof(int), TEST_POOL_CAPACITY), LIST_ERR_OK);
+
+    for(int round = 0; round < 10; round++) {
+        for(int value = 0; value < TEST_POOL_CAPACITY; value++) {
+            assert_int_equal(llist_push(&list, &value, sizeof(value)), LIST_ERR_OK);
+        }
+        assert_int_equal(list.pool.free_count, 0);
+        assert_int_equal(*(int*)llist_get_tail(&list)->data, TEST_POOL_CAPACITY - 1);
+        for(int value = 0; value < TEST_POOL_CAPACITY; value++) {
+            assert_int_equal(llist_remove(&list, &value), LIST_ERR_OK);
+        }
+        assert_int_equal(list.pool.free_count, TEST_POOL_CAPACITY);
+    }
+
+    assert_int_equal(list.pool.heap_count, 0);
+    assert_int_equal(llist_deinit(&list), LIST_ERR_OK);
+}
+
+/* Exhausted pool or too big data; nodes are taken from the list allocator instead */
+static void test_llist_pool_fallback(void** state) {
+    int live = 0;
+    ListAllocator_t allocator = { .alloc = counting_alloc, .free = counting_free, .arg = &live };
+    List_t list;
+    assert_int_equal(llist_init_with_allocator(&list, cmp, &allocator), LIST_ERR_OK);
+    assert_int_equal(llist_pool_init(&list, sizeof(int), TEST_POOL_CAPACITY), LIST_ERR_OK);
+
+    for(int value = 0; value < TEST_POOL_CAPACITY + 2; value++) {
+        assert_int_equal(llist_push(&list, &value, sizeof(value)), LIST_ERR_OK);
+    }
+    char big[256] = { 0 };
+    assert_int_equal(llist_push(&list, big, sizeof(big)), LIST_ERR_OK);
+    assert_int_equal(list.pool.heap_count, 3);
+    assert_int_equal(live, 3);
+    assert_int_equal(llist_get_length(&list), TEST_POOL_CAPACITY + 3);
+
+    // Nodes go back where they came from
+    int value = TEST_POOL_CAPACITY + 1;
+    assert_int_equal(llist_remove(&list, &value), LIST_ERR_OK);
+    assert_int_equal(live, 2);
+    value = 0;
+    assert_int_equal(llist_remove(&list, &value), LIST_ERR_OK);
+    assert_int_equal(list.pool.free_count, 1);
+    assert_int_equal(llist_deinit(&list), LIST_ERR_OK);
+    assert_int_equal(live, 0);
+}
+
+/* Incorrect pool parameters or a second pool; llist_pool_init should fail */
+static void test_llist_pool_init_incorrect(void** state) {
+    List_t list;
+    assert_int_equal(llist_init(&list, cmp), LIST_ERR_OK);
+    assert_int_equal(llist_pool_init(NULL, sizeof(int), TEST_POOL_CAPACITY), LIST_ERR_NULL_ARGUMENT);
+    assert_int_equal(llist_pool_init(&list, 0, TEST_POOL_CAPACITY), LIST_ERR_INCORRECT_ARGUMENT);
+    assert_int_equal(llist_pool_init(&list, sizeof(int), 0), LIST_ERR_INCORRECT_ARGUMENT);
+    assert_int_equal(llist_pool_init(&list, sizeof(int), TEST_POOL_CAPACITY), LIST_ERR_OK);
+    assert_int_equal(llist_pool_init(&list, sizeof(int), TEST_POOL_CAPACITY), LIST_ERR_INCORRECT_ARGUMENT);
+    assert_int_equal(llist_deinit(&list), LIST_ERR_OK);
+}
+
+/* Custom allocator; each node is a single allocation released on remove and deinit */
+static void test_llist_custom_allocator(void** state) {
+    int live = 0;
+    ListAllocator_t allocator = { .alloc = counting_alloc, .free = counting_free, .arg = &live };
+    List_t list;
+    assert_int_equal(llist_init_with_allocator(&list, cmp, &allocator), LIST_ERR_OK);
+
+    int data[3] = { 1, 2, 3 };
+    for(int i = 0; i < 3; i++) {
+        assert_int_equal(llist_push(&list, &data[i], sizeof(data[i])), LIST_ERR_OK);
+    }
+    assert_int_equal(live, 3);
+    assert_int_equal(llist_remove(&list, &data[1]), LIST_ERR_OK);
+    assert_int_equal(live, 2);
+    assert_int_equal(llist_deinit(&list), LIST_ERR_OK);
+    assert_int_equal(live, 0);
+
+    ListAllocator_t incomplete = { .alloc = counting_alloc };
+    assert_int_equal(llist_init_with_allocator(&list, cmp, &incomplete), LIST_ERR_NULL_ARGUMENT);
+}
+
+/* Iterator visits all nodes in order */
+static void test_llist_foreach_success(void** state) {
+    int data[3] = { 4, 8, 15 };
+    for(int i = 0; i < 3; i++) {
+        assert_int_equal(llist_push(&test_ll, &data[i], sizeof(data[i])), LIST_ERR_OK);
+    }
+
+    ListIter_t it;
+    int visited = 0;
+    assert_int_equal(llist_foreach_begin(&test_ll, &it), LIST_ERR_OK);
+    for(const void* value = llist_foreach_next(&test_ll, &it); value; value = llist_foreach_next(&test_ll, &it)) {
+        assert_int_equal(*(const int*)value, data[visited++]);
+    }
+    assert_int_equal(llist_foreach_end(&test_ll, &it), LIST_ERR_OK);
+    assert_int_equal(visited, 3);
+
+    // The lock is released, so writers can proceed (and a second foreach_end is a no-op)
+    assert_int_equal(llist_foreach_end(&test_ll, &it), LIST_ERR_OK);
+    assert_int_equal(llist_remove(&test_ll, &data[0]), LIST_ERR_OK);
+    assert_null(llist_foreach_next(&test_ll, &it));
+}
+
+/* NULL arguments; llist_foreach_begin and llist_foreach_end should fail */
+static void test_llist_foreach_null_args(void** state) {
+    ListIter_t it;
+    assert_int_equal(llist_foreach_begin(NULL, &it), LIST_ERR_NULL_ARGUMENT);
+    assert_int_equal(llist_foreach_begin(&test_ll, NULL), LIST_ERR_NULL_ARGUMENT);
+    assert_int_equal(llist_foreach_end(&test_ll, NULL), LIST_ERR_NULL_ARGUMENT);
+}
+
+/* Readers do not block each other while one of them is iterating */
+static void test_llist_foreach_parallel_readers(void** state) {
+    int data[2] = { 1, 2 };
+    for(int i = 0; i < 2; i++) {
+        assert_int_equal(llist_push(&test_ll, &data[i], sizeof(data[i])), LIST_ERR_OK);
+    }
+
+    ListIter_t it;
+    assert_int_equal(llist_foreach_begin(&test_ll, &it), LIST_ERR_OK);
+    assert_int_equal(llist_get_length(&test_ll), 2);
+
+    pthread_t reader;
+    int sum = 0;
+    assert_int_equal(pthread_create(&reader, NULL, foreach_reader, &sum), 0);
+    assert_int_equal(pthread_join(reader, NULL), 0);
+    assert_int_equal(sum, 3);
+
+    assert_int_equal(llist_foreach_end(&test_ll, &it), LIST_ERR_OK);
+}
+
 int run_llist_tests(void) {
     const struct CMUnitTest llist_tests[] = {
         cmocka_unit_test(test_llist_init_success),
@@ -280,6 +441,13 @@ int run_llist_tests(void) {
         cmocka_unit_test_setup_teardown(test_llist_traverse_null_func, llist_test_setup, llist_test_teardown),
         cmocka_unit_test_setup_teardown(test_llist_repeated_pushes, llist_test_setup, llist_test_teardown),
         cmocka_unit_test_setup_teardown(test_llist_repeated_removes, llist_test_setup, llist_test_teardown),
+        cmocka_unit_test_setup_teardown(test_llist_foreach_success, llist_test_setup, llist_test_teardown),
+        cmocka_unit_test_setup_teardown(test_llist_foreach_null_args, llist_test_setup, llist_test_teardown),
+        cmocka_unit_test_setup_teardown(test_llist_foreach_parallel_readers, llist_test_setup, llist_test_teardown),
+        cmocka_unit_test(test_llist_pool_reuse),
+        cmocka_unit_test(test_llist_pool_fallback),
+        cmocka_unit_test(test_llist_pool_init_incorrect),
+        cmocka_unit_test(test_llist_custom_allocator),
     };
     return cmocka_run_group_tests(llist_tests, NULL, NULL);
 }
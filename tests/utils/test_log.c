@@ -0,0 +1,206 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h> // For: pthread_create, pthread_join
+#include <stdio.h>   // For: snprintf, sscanf
+#include <string.h>  // For: strlen, strstr, memset
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "utils/log.h"
+
+extern void log_ring_reset(void);
+extern bool log_ring_push(const char* line, size_t len);
+extern size_t log_ring_pop(char* buf, const size_t buf_len);
+extern bool log_ring_empty(void);
+extern size_t log_format(char* buf, const char* level, const char* file, const int line, const char* msg, va_list args);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_PRODUCERS 4
+#define TEST_LINES_PER_PRODUCER 200 // TEST_PRODUCERS * TEST_LINES_PER_PRODUCER must fit in the ring
+
+static char pop_buf[LOG_RING_SIZE * LOG_MSG_MAX_SIZE];
+
+static int log_test_setup(void** state) {
+    log_ring_reset();
+    return 0;
+}
+
+static int log_filter_teardown(void** state) {
+    return log_configure("debug") == LOG_ERR_OK ? 0 : -1;
+}
+
+// Call log_format with variadic arguments
+static size_t format_line(char* buf, const char* msg, ...) {
+    va_list args;
+    va_start(args, msg);
+    size_t len = log_format(buf, "INFO", "src/dir/file.c", 42, msg, args);
+    va_end(args);
+    return len;
+}
+
+static void* producer(void* arg) {
+    const int id = *(int*)arg;
+    char line[32];
+    for(int i = 0; i < TEST_LINES_PER_PRODUCER; i++) {
+        int len = snprintf(line, sizeof(line), "%d %d\n", id, i);
+        assert_true(log_ring_push(line, (size_t)len));
+    }
+    return NULL;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_log_format(void** state) {
+    char buf[LOG_MSG_MAX_SIZE];
+    size_t len = format_line(buf, "value: %d", 7);
+
+    assert_int_equal(buf[len - 1], '\n');
+    buf[len] = '\0';
+    assert_non_null(strstr(buf, " INFO file.c:42: value: 7\n"));
+    assert_non_null(strstr(buf, "[TID:"));
+}
+
+static void test_log_format_truncated(void** state) {
+    char buf[LOG_MSG_MAX_SIZE];
+    char long_msg[2 * LOG_MSG_MAX_SIZE];
+    memset(long_msg, 'x', sizeof(long_msg) - 1);
+    long_msg[sizeof(long_msg) - 1] = '\0';
+
+    size_t len = format_line(buf, "%s", long_msg);
+    assert_true(len <= LOG_MSG_MAX_SIZE);
+    assert_int_equal(buf[len - 1], '\n');
+    assert_int_equal(buf[len - 2], 'x');
+}
+
+static void test_log_ring_fifo(void** state) {
+    assert_true(log_ring_push("first\n", 6));
+    assert_true(log_ring_push("second\n", 7));
+
+    size_t len = log_ring_pop(pop_buf, sizeof(pop_buf));
+    assert_int_equal(len, 13);
+    assert_memory_equal(pop_buf, "first\nsecond\n", 13);
+    assert_int_equal(log_ring_pop(pop_buf, sizeof(pop_buf)), 0);
+}
+
+static void test_log_ring_partial_pop(void** state) {
+    assert_true(log_ring_push("first\n", 6));
+    assert_true(log_ring_push("second\n", 7));
+
+    // Only the lines fitting in the buffer are popped
+    assert_int_equal(log_ring_pop(pop_buf, 10), 6);
+    assert_int_equal(log_ring_pop(pop_buf, 10), 7);
+    assert_memory_equal(pop_buf, "second\n", 7);
+}
+
+static void test_log_ring_full(void** state) {
+    for(int i = 0; i < LOG_RING_SIZE; i++) {
+        assert_true(log_ring_push("x\n", 2));
+    }
+    // Lines are dropped instead of blocking
+    assert_false(log_ring_push("x\n", 2));
+
+    // Slots are reused once consumed
+    assert_int_equal(log_ring_pop(pop_buf, 2), 2);
+    assert_true(log_ring_push("y\n", 2));
+    assert_int_equal(log_ring_pop(pop_buf, sizeof(pop_buf)), 2 * LOG_RING_SIZE);
+    assert_memory_equal(pop_buf + 2 * (LOG_RING_SIZE - 1), "y\n", 2);
+}
+
+static void test_log_ring_empty(void** state) {
+    assert_true(log_ring_empty());
+    assert_true(log_ring_push("first\n", 6));
+    assert_false(log_ring_empty());
+
+    // The writer thread sleeps only once everything was popped
+    assert_int_equal(log_ring_pop(pop_buf, sizeof(pop_buf)), 6);
+    assert_true(log_ring_empty());
+}
+
+static void test_log_ring_multi_producer(void** state) {
+    pthread_t threads[TEST_PRODUCERS];
+    int ids[TEST_PRODUCERS];
+    for(int i = 0; i < TEST_PRODUCERS; i++) {
+        ids[i] = i;
+        assert_int_equal(pthread_create(&threads[i], NULL, producer, &ids[i]), 0);
+    }
+    for(int i = 0; i < TEST_PRODUCERS; i++) {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+    }
+
+    size_t len = log_ring_pop(pop_buf, sizeof(pop_buf) - 1);
+    pop_buf[len] = '\0';
+
+    // All lines are there and the lines of each producer are kept in order
+    int next[TEST_PRODUCERS] = { 0 };
+    int count = 0;
+    for(char* line = strtok(pop_buf, "\n"); line; line = strtok(NULL, "\n")) {
+        int id, seq;
+        assert_int_equal(sscanf(line, "%d %d", &id, &seq), 2);
+        assert_int_equal(seq, next[id]++);
+        count++;
+    }
+    assert_int_equal(count, TEST_PRODUCERS * TEST_LINES_PER_PRODUCER);
+}
+
+static void test_log_init_twice(void** state) {
+    assert_int_equal(log_init(LOG_MODE_ASYNC), LOG_ERR_OK);
+    assert_int_equal(log_init(LOG_MODE_ASYNC), LOG_ERR_GENERIC);
+    assert_int_equal(log_deinit(), LOG_ERR_OK);
+    assert_int_equal(log_deinit(), LOG_ERR_OK);
+}
+
+static void test_log_set_level(void** state) {
+    assert_int_equal(log_set_level(LOG_MODULE_NETWORK, LOG_LEVEL_ERROR), LOG_ERR_OK);
+    assert_false(log_enabled(LOG_MODULE_NETWORK, LOG_LEVEL_INFO));
+    assert_true(log_enabled(LOG_MODULE_NETWORK, LOG_LEVEL_ERROR));
+    assert_true(log_enabled(LOG_MODULE_APP, LOG_LEVEL_DEBUG));
+
+    assert_int_equal(log_set_level(LOG_MODULE_COUNT, LOG_LEVEL_ERROR), LOG_ERR_INVALID_ARGUMENT);
+    assert_int_equal(log_set_level(LOG_MODULE_APP, LOG_LEVEL_NONE + 1), LOG_ERR_INVALID_ARGUMENT);
+}
+
+static void test_log_configure(void** state) {
+    assert_int_equal(log_configure("info,network=debug,gpio=none"), LOG_ERR_OK);
+    assert_true(log_enabled(LOG_MODULE_NETWORK, LOG_LEVEL_DEBUG));
+    assert_false(log_enabled(LOG_MODULE_APP, LOG_LEVEL_DEBUG));
+    assert_true(log_enabled(LOG_MODULE_APP, LOG_LEVEL_INFO));
+    assert_false(log_enabled(LOG_MODULE_GPIO, LOG_LEVEL_ERROR));
+
+    // A bare level overrides the previous entries
+    assert_int_equal(log_configure("network=error,debug"), LOG_ERR_OK);
+    assert_true(log_enabled(LOG_MODULE_NETWORK, LOG_LEVEL_DEBUG));
+}
+
+static void test_log_configure_invalid(void** state) {
+    assert_int_equal(log_configure("error"), LOG_ERR_OK);
+
+    // Nothing changes if any of the entries is invalid
+    assert_int_equal(log_configure("network=debug,unknown=info"), LOG_ERR_INVALID_ARGUMENT);
+    assert_int_equal(log_configure("network=verbose"), LOG_ERR_INVALID_ARGUMENT);
+    assert_int_equal(log_configure("=debug"), LOG_ERR_INVALID_ARGUMENT);
+    assert_int_equal(log_configure(NULL), LOG_ERR_INVALID_ARGUMENT);
+    assert_false(log_enabled(LOG_MODULE_NETWORK, LOG_LEVEL_DEBUG));
+}
+
+int run_log_tests(void) {
+    const struct CMUnitTest log_tests[] = {
+        cmocka_unit_test(test_log_format),
+        cmocka_unit_test(test_log_format_truncated),
+        cmocka_unit_test_setup(test_log_ring_fifo, log_test_setup),
+        cmocka_unit_test_setup(test_log_ring_partial_pop, log_test_setup),
+        cmocka_unit_test_setup(test_log_ring_full, log_test_setup),
+        cmocka_unit_test_setup(test_log_ring_empty, log_test_setup),
+        cmocka_unit_test_setup(test_log_ring_multi_producer, log_test_setup),
+        cmocka_unit_test(test_log_init_twice),
+        cmocka_unit_test_teardown(test_log_set_level, log_filter_teardown),
+        cmocka_unit_test_teardown(test_log_configure, log_filter_teardown),
+        cmocka_unit_test_teardown(test_log_configure_invalid, log_filter_teardown),
+    };
+    return cmocka_run_group_tests(log_tests, NULL, NULL);
+}
@@ -0,0 +1,189 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h> // For: pthread_create, pthread_join
+#include <string.h>  // For: strstr
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "utils/metrics.h"
+
+extern uint32_t metrics_bucket(const uint64_t ns);
+extern uint64_t metrics_bucket_bound_ns(const uint32_t bucket);
+
+
+/************************ Test fixtures ************************/
+
+#define TEST_THREADS 4
+#define TEST_ADDS_PER_THREAD 1000
+
+static char render_buf[65536];
+
+static int metrics_test_setup(void** state) {
+    return metrics_init() == METRICS_ERR_OK ? 0 : -1;
+}
+
+static int metrics_test_teardown(void** state) {
+    return metrics_deinit() == METRICS_ERR_OK ? 0 : -1;
+}
+
+// Every thread records into its own shard (released and folded into the totals on exit)
+static void* recorder(void* arg) {
+    for(int i = 0; i < TEST_ADDS_PER_THREAD; i++) {
+        metrics_add(METRICS_SERVER_RX_BYTES, 2);
+        metrics_cmd_end(1, metrics_now_ns(), i % 2 == 0);
+    }
+    return NULL;
+}
+
+
+/************************ Unit tests ************************/
+
+static void test_metrics_not_initialized(void** state) {
+    MetricsSnapshot_t snap;
+    assert_int_equal(metrics_now_ns(), 0);
+    metrics_add(METRICS_SERVER_RX_BYTES, 1); // Dropped silently
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_NOT_INITIALIZED);
+    assert_int_equal(metrics_set_cmd_name(0, "gpio set"), METRICS_ERR_NOT_INITIALIZED);
+    assert_int_equal(metrics_deinit(), METRICS_ERR_NOT_INITIALIZED);
+}
+
+static void test_metrics_bucket(void** state) {
+    assert_int_equal(metrics_bucket(0), 0);
+    assert_int_equal(metrics_bucket(1024), 0);
+    assert_int_equal(metrics_bucket(1025), 1);
+    assert_int_equal(metrics_bucket(2048), 1);
+    assert_int_equal(metrics_bucket(2049), 2);
+    assert_int_equal(metrics_bucket(UINT64_MAX), METRICS_HIST_BUCKETS - 1);
+
+    assert_int_equal(metrics_bucket_bound_ns(0), 1024);
+    assert_int_equal(metrics_bucket_bound_ns(3), 8192);
+    assert_true(metrics_bucket_bound_ns(METRICS_HIST_BUCKETS - 1) == UINT64_MAX);
+}
+
+static void test_metrics_percentile(void** state) {
+    MetricsHistogram_t hist = { 0 };
+    assert_int_equal(metrics_hist_percentile(&hist, 500), 0);
+
+    hist.buckets[0] = 90;
+    hist.buckets[4] = 9;
+    hist.buckets[METRICS_HIST_BUCKETS - 1] = 1;
+    hist.count = 100;
+    assert_int_equal(metrics_hist_percentile(&hist, 500), 1024);
+    assert_int_equal(metrics_hist_percentile(&hist, 900), 1024);
+    assert_int_equal(metrics_hist_percentile(&hist, 990), 16384);
+    assert_true(metrics_hist_percentile(&hist, 1000) == UINT64_MAX);
+}
+
+static void test_metrics_counters(void** state) {
+    MetricsSnapshot_t snap;
+    metrics_add(METRICS_I2C_TRANSACTIONS, 3);
+    metrics_add(METRICS_I2C_TRANSACTIONS, 4);
+    metrics_add(METRICS_COUNTER_COUNT, 1); // Invalid counter (ignored)
+
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_OK);
+    assert_int_equal(snap.counters[METRICS_I2C_TRANSACTIONS], 7);
+    assert_int_equal(snap.counters[METRICS_I2C_FAILURES], 0);
+    assert_int_equal(metrics_snapshot(NULL), METRICS_ERR_NULL_ARGUMENT);
+}
+
+static void test_metrics_shards_merged(void** state) {
+    pthread_t threads[TEST_THREADS];
+    for(int i = 0; i < TEST_THREADS; i++) {
+        assert_int_equal(pthread_create(&threads[i], NULL, recorder, NULL), 0);
+    }
+    metrics_add(METRICS_SERVER_RX_BYTES, 1); // Shard of the main thread (not released)
+    for(int i = 0; i < TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    MetricsSnapshot_t snap;
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_OK);
+    assert_int_equal(snap.counters[METRICS_SERVER_RX_BYTES], TEST_THREADS * TEST_ADDS_PER_THREAD * 2 + 1);
+    assert_int_equal(snap.cmds[1].count, TEST_THREADS * TEST_ADDS_PER_THREAD);
+    assert_int_equal(snap.cmds[1].errors, TEST_THREADS * TEST_ADDS_PER_THREAD / 2);
+    assert_int_equal(snap.cmds[1].latency.count, TEST_THREADS * TEST_ADDS_PER_THREAD);
+}
+
+static void test_metrics_cmd_fail(void** state) {
+    metrics_cmd_begin();
+    metrics_cmd_fail();
+    metrics_cmd_end(2, metrics_now_ns(), false);
+    metrics_cmd_begin();
+    metrics_cmd_end(2, metrics_now_ns(), false); // Flag cleared by the previous end
+    metrics_cmd_end(METRICS_MAX_CMDS, metrics_now_ns(), true); // Invalid ID (ignored)
+
+    MetricsSnapshot_t snap;
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_OK);
+    assert_int_equal(snap.cmds[2].count, 2);
+    assert_int_equal(snap.cmds[2].errors, 1);
+}
+
+static void test_metrics_mutex_lock(void** state) {
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    assert_int_equal(metrics_mutex_lock(&lock, METRICS_HIST_LOCK_I2C), 0);
+    pthread_mutex_unlock(&lock);
+
+    // Uncontended waits are not recorded
+    MetricsSnapshot_t snap;
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_OK);
+    assert_int_equal(snap.hists[METRICS_HIST_LOCK_I2C].count, 0);
+    pthread_mutex_destroy(&lock);
+}
+
+static void test_metrics_render_text(void** state) {
+    assert_int_equal(metrics_set_cmd_name(0, "gpio set"), METRICS_ERR_OK);
+    assert_int_equal(metrics_set_cmd_name(1, "gpio get"), METRICS_ERR_OK);
+    assert_int_equal(metrics_set_cmd_name(METRICS_MAX_CMDS, "x"), METRICS_ERR_INVALID_ARGUMENT);
+    metrics_add(METRICS_SERVER_RX_BYTES, 12);
+    metrics_cmd_end(0, metrics_now_ns(), true);
+
+    MetricsSnapshot_t snap;
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_OK);
+    StrBuf_t sb;
+    strbuf_init(&sb, render_buf, sizeof(render_buf));
+    metrics_render_text(&snap, &sb);
+
+    assert_false(sb.truncated);
+    assert_non_null(strstr(sb.data, "server rx: 12 B"));
+    assert_non_null(strstr(sb.data, "cmd 'gpio set': 1 calls, 1 errors, avg "));
+    assert_null(strstr(sb.data, "gpio get")); // Never executed
+    assert_non_null(strstr(sb.data, "lock dispatcher: 0 contended waits, avg - us"));
+}
+
+static void test_metrics_render_prometheus(void** state) {
+    assert_int_equal(metrics_set_cmd_name(3, "server uptime"), METRICS_ERR_OK);
+    metrics_add(METRICS_DISPATCHER_REJECTED, 5);
+    metrics_cmd_end(3, metrics_now_ns(), false);
+
+    MetricsSnapshot_t snap;
+    assert_int_equal(metrics_snapshot(&snap), METRICS_ERR_OK);
+    StrBuf_t sb;
+    strbuf_init(&sb, render_buf, sizeof(render_buf));
+    metrics_render_prometheus(&snap, &sb);
+
+    assert_false(sb.truncated);
+    assert_non_null(strstr(sb.data, "# TYPE pihub_dispatcher_rejected_total counter\npihub_dispatcher_rejected_total 5\n"));
+    assert_non_null(strstr(sb.data, "pihub_command_executions_total{cmd=\"server uptime\"} 1\n"));
+    assert_non_null(strstr(sb.data, "pihub_command_errors_total{cmd=\"server uptime\"} 0\n"));
+    assert_non_null(strstr(sb.data, "pihub_command_duration_seconds_bucket{cmd=\"server uptime\",le=\"+Inf\"} 1\n"));
+    assert_non_null(strstr(sb.data, "pihub_lock_wait_seconds_count{lock=\"client\"} 0\n"));
+    assert_non_null(strstr(sb.data, "pihub_i2c_transaction_duration_seconds_bucket{le=\"1.024e-06\"} 0\n"));
+}
+
+int run_metrics_tests(void) {
+    const struct CMUnitTest metrics_tests[] = {
+        cmocka_unit_test(test_metrics_not_initialized),
+        cmocka_unit_test(test_metrics_bucket),
+        cmocka_unit_test(test_metrics_percentile),
+        cmocka_unit_test_setup_teardown(test_metrics_counters, metrics_test_setup, metrics_test_teardown),
+        cmocka_unit_test_setup_teardown(test_metrics_shards_merged, metrics_test_setup, metrics_test_teardown),
+        cmocka_unit_test_setup_teardown(test_metrics_cmd_fail, metrics_test_setup, metrics_test_teardown),
+        cmocka_unit_test_setup_teardown(test_metrics_mutex_lock, metrics_test_setup, metrics_test_teardown),
+        cmocka_unit_test_setup_teardown(test_metrics_render_text, metrics_test_setup, metrics_test_teardown),
+        cmocka_unit_test_setup_teardown(test_metrics_render_prometheus, metrics_test_setup, metrics_test_teardown),
+    };
+    return cmocka_run_group_tests(metrics_tests, NULL, NULL);
+}
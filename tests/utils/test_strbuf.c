@@ -0,0 +1,76 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // For: strlen
+// Cmocka must be included last (!)
+#include <cmocka.h>
+
+#include "utils/strbuf.h"
+
+
+/************************ Unit tests ************************/
+
+static void test_strbuf_append(void** state) {
+    char buf[32];
+    StrBuf_t sb;
+    assert_int_equal(strbuf_init(&sb, buf, sizeof(buf)), STRBUF_ERR_OK);
+    assert_string_equal(buf, "");
+
+    assert_int_equal(strbuf_append_str(&sb, "> "), STRBUF_ERR_OK);
+    assert_int_equal(strbuf_append(&sb, "abcdef", 3), STRBUF_ERR_OK);
+    assert_int_equal(strbuf_appendf(&sb, " %d-%s", 42, "x"), STRBUF_ERR_OK);
+    assert_string_equal(buf, "> abc 42-x");
+    assert_int_equal(sb.len, strlen(buf));
+    assert_false(sb.truncated);
+}
+
+static void test_strbuf_truncated(void** state) {
+    char buf[8];
+    StrBuf_t sb;
+    assert_int_equal(strbuf_init(&sb, buf, sizeof(buf)), STRBUF_ERR_OK);
+
+    assert_int_equal(strbuf_append_str(&sb, "12345"), STRBUF_ERR_OK);
+    assert_int_equal(strbuf_append_str(&sb, "6789"), STRBUF_ERR_TRUNCATED);
+    assert_string_equal(buf, "1234567");
+    assert_int_equal(sb.len, 7);
+
+    // Nothing is appended after a gap
+    assert_int_equal(strbuf_append_str(&sb, ""), STRBUF_ERR_TRUNCATED);
+    assert_true(sb.truncated);
+}
+
+static void test_strbuf_appendf_truncated(void** state) {
+    char buf[8];
+    StrBuf_t sb;
+    assert_int_equal(strbuf_init(&sb, buf, sizeof(buf)), STRBUF_ERR_OK);
+
+    assert_int_equal(strbuf_appendf(&sb, "%s", "abc"), STRBUF_ERR_OK);
+    assert_int_equal(strbuf_appendf(&sb, "%d", 123456), STRBUF_ERR_TRUNCATED);
+    assert_string_equal(buf, "abc1234");
+    assert_int_equal(sb.len, 7);
+    assert_int_equal(strbuf_appendf(&sb, "x"), STRBUF_ERR_TRUNCATED);
+}
+
+static void test_strbuf_null_args(void** state) {
+    char buf[8];
+    StrBuf_t sb;
+    assert_int_equal(strbuf_init(NULL, buf, sizeof(buf)), STRBUF_ERR_NULL_ARGUMENT);
+    assert_int_equal(strbuf_init(&sb, NULL, sizeof(buf)), STRBUF_ERR_NULL_ARGUMENT);
+    assert_int_equal(strbuf_init(&sb, buf, 0), STRBUF_ERR_NULL_ARGUMENT);
+
+    assert_int_equal(strbuf_init(&sb, buf, sizeof(buf)), STRBUF_ERR_OK);
+    assert_int_equal(strbuf_append(&sb, NULL, 1), STRBUF_ERR_NULL_ARGUMENT);
+    assert_int_equal(strbuf_append_str(&sb, NULL), STRBUF_ERR_NULL_ARGUMENT);
+    assert_int_equal(strbuf_appendf(NULL, "x"), STRBUF_ERR_NULL_ARGUMENT);
+}
+
+int run_strbuf_tests(void) {
+    const struct CMUnitTest strbuf_tests[] = {
+        cmocka_unit_test(test_strbuf_append),
+        cmocka_unit_test(test_strbuf_truncated),
+        cmocka_unit_test(test_strbuf_appendf_truncated),
+        cmocka_unit_test(test_strbuf_null_args),
+    };
+    return cmocka_run_group_tests(strbuf_tests, NULL, NULL);
+}
@@ -0,0 +1,602 @@
+/**
+ * @file pihub_bench.c
+ * @brief Load generator and latency benchmark for the PiHub server (text commands)
+ *
+ * @note Each benchmark thread drives its share of the client connections with a single epoll instance. Every
+ * connection keeps up to <depth> commands in flight (pipelining): a new command is sent as soon as a response
+ * arrives. Commands are drawn at random from the weighted command mix (the read-only commands of the `server help`
+ * man page by default, see BENCH_DEFAULT_MIX).
+ *
+ * @note Responses are matched to the commands in FIFO order. A response is a line starting with APP_PIHUB_INFO_MSG
+ * (or APP_PIHUB_ERROR_MSG for the failed ones); the following lines of multi-line responses, the welcome message and
+ * the connect/disconnect broadcasts are skipped. Avoid commands with asynchronous messages (e.g. `sensor subscribe`
+ * or `gpio watch`) in the mix, they would be counted as responses. Offloaded commands (e.g. `sensor get`) may be
+ * answered after the inline commands sent later, which skews their latencies towards each other.
+ *
+ * @note Latencies are recorded in HDR-style log-linear histograms (BENCH_HIST_SUB_BUCKETS buckets per power of 2,
+ * i.e. the percentiles are reported with a relative error below 1 / BENCH_HIST_SUB_BUCKETS).
+ *
+ * Usage: pihub_bench [-H host] [-p port] [-c clients] [-t threads] [-P depth] [-d seconds] [-m "cmd[:weight]"]...
+ */
+
+#include <errno.h>       // For: errno
+#include <fcntl.h>       // For: fcntl(), O_NONBLOCK
+#include <netdb.h>       // For: getaddrinfo(), freeaddrinfo()
+#include <netinet/in.h>  // For: IPPROTO_TCP
+#include <netinet/tcp.h> // For: TCP_NODELAY
+#include <pthread.h>     // For: pthread_create(), pthread_join()
+#include <stdbool.h>     // For: bool
+#include <stdint.h>      // For: std types
+#include <stdio.h>       // For: printf(), fprintf()
+#include <stdlib.h>      // For: calloc(), free(), strtoul()
+#include <string.h>      // For: strncmp(), strerror()
+#include <sys/epoll.h>   // For: epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/socket.h>  // For: socket(), connect(), send(), recv()
+#include <time.h>        // For: clock_gettime()
+#include <unistd.h>      // For: getopt(), close()
+
+#include "utils/config.h"
+
+#define BENCH_MAX_CMDS 32            // Max number of commands in the mix
+#define BENCH_MAX_CMD_LEN 128        // Max length of a single command (incl. the terminating char)
+#define BENCH_MAX_CLIENTS 4096       // Max number of client connections
+#define BENCH_MAX_THREADS 64         // Max number of benchmark threads
+#define BENCH_MAX_DEPTH 64           // Max number of commands in flight per connection
+#define BENCH_RX_BUF_SIZE 4096       // Size of the per-connection receive buffer (max length of a response line)
+#define BENCH_EPOLL_EVENTS 64        // Max number of events handled per epoll_wait() call
+#define BENCH_EPOLL_TIMEOUT_MS 10    // Timeout of epoll_wait() (the end of the run is checked at least this often)
+#define BENCH_HIST_SUB_BITS 6        // Number of bits of the sub-bucket index (value precision of the histograms)
+#define BENCH_HIST_SUB_BUCKETS (1 << BENCH_HIST_SUB_BITS) // Number of buckets per power of 2
+#define BENCH_HIST_SIZE ((65 - BENCH_HIST_SUB_BITS) << BENCH_HIST_SUB_BITS) // Buckets covering all uint64 values
+
+#define BENCH_DEFAULT_HOST "127.0.0.1" // Server address used if not set with -H
+#define BENCH_DEFAULT_CLIENTS 16       // Number of connections used if not set with -c
+#define BENCH_DEFAULT_THREADS 1        // Number of threads used if not set with -t
+#define BENCH_DEFAULT_DEPTH 1          // Number of commands in flight per connection if not set with -P
+#define BENCH_DEFAULT_DURATION_S 10    // Duration of the run if not set with -d
+
+// Command mix used if none is set with -m (read-only commands of the man page, weighted by the expected usage)
+static const char* BENCH_DEFAULT_MIX[] = { "server uptime:4", "server stats:2", "server status:1", "sensor list:2",
+    "sensor get 0 all:1", "gpio get 1:1" };
+
+/**
+ * @struct BenchHist_t
+ * @brief HDR-style latency histogram (in ns)
+ */
+typedef struct {
+    uint64_t counts[BENCH_HIST_SIZE]; // Number of values per bucket (see bench_hist_index())
+    uint64_t total;                   // Number of recorded values
+    uint64_t min;                     // Min recorded value
+    uint64_t max;                     // Max recorded value
+} BenchHist_t;
+
+/**
+ * @struct BenchCmd_t
+ * @brief Command of the mix
+ */
+typedef struct {
+    char line[BENCH_MAX_CMD_LEN + 1]; // Command with the new line character
+    size_t len;                       // Length of the line
+    uint32_t weight;                  // Relative frequency of the command in the mix
+} BenchCmd_t;
+
+/**
+ * @struct BenchConn_t
+ * @brief Client connection driven by a benchmark thread
+ */
+typedef struct {
+    int fd;                                             // Socket file descriptor (-1 once closed)
+    bool welcomed;                                      // Welcome message received (commands are sent afterwards)
+    bool epollout;                                      // EPOLLOUT enabled (only while tx is not flushed)
+    bool discard_line;                                  // Drop the received bytes until the next new line
+    uint64_t sent_ns[BENCH_MAX_DEPTH];                  // Send times of the commands in flight (ring)
+    uint8_t sent_cmd[BENCH_MAX_DEPTH];                  // Indexes of the commands in flight (same ring)
+    uint32_t head;                                      // Index of the oldest command in flight
+    uint32_t inflight;                                  // Number of commands in flight
+    char tx[BENCH_MAX_DEPTH * (BENCH_MAX_CMD_LEN + 1)]; // Commands not accepted by the socket yet
+    size_t tx_len;                                      // Number of bytes in tx
+    size_t tx_off;                                      // Number of bytes of tx already sent
+    char rx[BENCH_RX_BUF_SIZE];                         // Received bytes not forming a complete line yet
+    size_t rx_len;                                      // Number of bytes in rx
+} BenchConn_t;
+
+/**
+ * @struct BenchThread_t
+ * @brief Benchmark thread with its connections and results
+ */
+typedef struct {
+    pthread_t thread;                // Thread ID
+    uint32_t index;                  // Index of the thread (drives the connections with index % threads == index)
+    uint64_t rng;                    // State of the xorshift64 generator picking the commands
+    BenchHist_t* hist;               // Histograms (one per command of the mix)
+    uint64_t errors[BENCH_MAX_CMDS]; // Number of error responses per command
+    uint64_t connect_failures;       // Number of connections that could not be established
+    uint64_t closed;                 // Number of connections closed by the server during the run
+    uint64_t notices;                // Number of skipped messages (broadcasts)
+} BenchThread_t;
+
+/**
+ * @struct Bench_t
+ * @brief Benchmark configuration and the shared state
+ */
+typedef struct {
+    const char* host;                // Server address
+    const char* port;                // Server port
+    uint32_t clients;                // Number of connections
+    uint32_t threads;                // Number of threads
+    uint32_t depth;                  // Number of commands in flight per connection
+    uint32_t duration_s;             // Duration of the run
+    BenchCmd_t cmds[BENCH_MAX_CMDS]; // Command mix
+    uint32_t cmd_count;              // Number of commands in the mix
+    uint32_t weight_sum;             // Sum of the weights of the commands
+    struct addrinfo* addr;           // Resolved server address
+    uint64_t end_ns;                 // End of the run (CLOCK_MONOTONIC)
+} Bench_t;
+
+static Bench_t bench;
+
+// Current CLOCK_MONOTONIC time in ns
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Bucket of a value: the values below 2 * BENCH_HIST_SUB_BUCKETS have their own buckets, the bigger ones share
+// BENCH_HIST_SUB_BUCKETS buckets per power of 2 (the top BENCH_HIST_SUB_BITS + 1 bits of the value are kept)
+static uint32_t bench_hist_index(const uint64_t value) {
+    if(value < 2 * BENCH_HIST_SUB_BUCKETS) {
+        return (uint32_t)value;
+    }
+    uint32_t shift = (uint32_t)(63 - __builtin_clzll(value)) - BENCH_HIST_SUB_BITS;
+    return (shift << BENCH_HIST_SUB_BITS) + (uint32_t)(value >> shift);
+}
+
+// Highest value falling into the bucket
+static uint64_t bench_hist_upper(const uint32_t index) {
+    if(index < 2 * BENCH_HIST_SUB_BUCKETS) {
+        return index;
+    }
+    uint32_t shift = (index >> BENCH_HIST_SUB_BITS) - 1;
+    uint64_t sub = index - (shift << BENCH_HIST_SUB_BITS);
+    return ((sub + 1) << shift) - 1;
+}
+
+static void bench_hist_record(BenchHist_t* hist, const uint64_t value) {
+    hist->counts[bench_hist_index(value)]++;
+    hist->min = (hist->total == 0 || value < hist->min) ? value : hist->min;
+    hist->max = (value > hist->max) ? value : hist->max;
+    hist->total++;
+}
+
+static void bench_hist_merge(BenchHist_t* dst, const BenchHist_t* src) {
+    if(src->total == 0) {
+        return;
+    }
+    for(uint32_t i = 0; i < BENCH_HIST_SIZE; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->min = (dst->total == 0 || src->min < dst->min) ? src->min : dst->min;
+    dst->max = (src->max > dst->max) ? src->max : dst->max;
+    dst->total += src->total;
+}
+
+// Value below which the given fraction of the recorded values falls (upper bound of its bucket, capped at max)
+static uint64_t bench_hist_percentile(const BenchHist_t* hist, const double fraction) {
+    if(hist->total == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(fraction * (double)hist->total + 0.5);
+    target = (target == 0) ? 1 : target;
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < BENCH_HIST_SIZE; i++) {
+        seen += hist->counts[i];
+        if(seen >= target) {
+            uint64_t upper = bench_hist_upper(i);
+            return (upper > hist->max) ? hist->max : upper;
+        }
+    }
+    return hist->max;
+}
+
+// Pick a command of the mix (xorshift64, weighted)
+static uint32_t bench_pick_cmd(BenchThread_t* t) {
+    t->rng ^= t->rng << 13;
+    t->rng ^= t->rng >> 7;
+    t->rng ^= t->rng << 17;
+    uint32_t r = (uint32_t)(t->rng % bench.weight_sum);
+    for(uint32_t i = 0; i < bench.cmd_count; i++) {
+        if(r < bench.cmds[i].weight) {
+            return i;
+        }
+        r -= bench.cmds[i].weight;
+    }
+    return 0;
+}
+
+// Parse a "cmd[:weight]" mix entry
+static int bench_add_cmd(const char* arg) {
+    if(bench.cmd_count == BENCH_MAX_CMDS) {
+        fprintf(stderr, "too many commands in the mix (max: %d)\n", BENCH_MAX_CMDS);
+        return -1;
+    }
+    BenchCmd_t* cmd = &bench.cmds[bench.cmd_count];
+    const char* colon = strrchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+    unsigned long weight = 1;
+    if(colon) {
+        char* end;
+        errno = 0;
+        weight = strtoul(colon + 1, &end, 10);
+        if(errno != 0 || end == colon + 1 || *end != '\0' || weight == 0 || weight > UINT16_MAX) {
+            fprintf(stderr, "invalid weight of the command '%s'\n", arg);
+            return -1;
+        }
+    }
+    if(len == 0 || len >= BENCH_MAX_CMD_LEN) {
+        fprintf(stderr, "invalid length of the command '%s'\n", arg);
+        return -1;
+    }
+    memcpy(cmd->line, arg, len);
+    cmd->line[len] = '\n';
+    cmd->len = len + 1;
+    cmd->weight = (uint32_t)weight;
+    bench.weight_sum += cmd->weight;
+    bench.cmd_count++;
+    return 0;
+}
+
+// Connect to the server (blocking) and switch the socket to non-blocking mode
+static int bench_connect(void) {
+    for(struct addrinfo* ai = bench.addr; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(fd < 0) {
+            continue;
+        }
+        if(connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            return fd;
+        }
+        close(fd);
+    }
+    return -1;
+}
+
+static void bench_close(BenchThread_t* t, BenchConn_t* conn) {
+    close(conn->fd); // Removes the fd from the epoll instance as well
+    conn->fd = -1;
+    t->closed++;
+}
+
+// Send the buffered commands (EPOLLOUT is enabled while the socket does not accept all of them)
+static int bench_flush(int epfd, BenchConn_t* conn) {
+    while(conn->tx_off < conn->tx_len) {
+        ssize_t n = send(conn->fd, conn->tx + conn->tx_off, conn->tx_len - conn->tx_off, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        } else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if(n < 0) {
+            return -1;
+        }
+        conn->tx_off += (size_t)n;
+    }
+    if(conn->tx_off == conn->tx_len) {
+        conn->tx_off = conn->tx_len = 0;
+    }
+
+    bool want_out = (conn->tx_len > 0);
+    if(want_out != conn->epollout) {
+        struct epoll_event ev = { .events = EPOLLIN | (want_out ? EPOLLOUT : 0), .data.ptr = conn };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->epollout = want_out;
+    }
+    return 0;
+}
+
+// Top up the commands in flight (not after the end of the run) and send them
+static int bench_fill(BenchThread_t* t, int epfd, BenchConn_t* conn, const uint64_t now) {
+    if(!conn->welcomed || now >= bench.end_ns) {
+        return 0;
+    }
+    while(conn->inflight < bench.depth) {
+        uint32_t idx = bench_pick_cmd(t);
+        const BenchCmd_t* cmd = &bench.cmds[idx];
+        if(conn->tx_len + cmd->len > sizeof(conn->tx)) {
+            break; // The socket does not keep up, retried once the buffered commands are sent
+        }
+        memcpy(conn->tx + conn->tx_len, cmd->line, cmd->len);
+        conn->tx_len += cmd->len;
+        uint32_t slot = (conn->head + conn->inflight) % BENCH_MAX_DEPTH;
+        conn->sent_ns[slot] = now;
+        conn->sent_cmd[slot] = (uint8_t)idx;
+        conn->inflight++;
+    }
+    return bench_flush(epfd, conn);
+}
+
+// Handle a single received line (a response, a continuation of a multi-line response or a broadcast)
+static void bench_handle_line(BenchThread_t* t, BenchConn_t* conn, const char* line, const size_t len, const uint64_t now) {
+    static const char welcome[] = APP_PIHUB_INFO_MSG APP_WELCOME_MSG;
+    static const char disconnect[] = APP_PIHUB_INFO_MSG APP_DISCONNECT_MSG;
+    static const char connect_suffix[] = APP_CONNECT_MSG;
+    const size_t prefix_len = strlen(APP_PIHUB_INFO_MSG);
+
+    if(len < prefix_len || strncmp(line, APP_PIHUB_INFO_MSG, prefix_len) != 0) {
+        return; // Continuation of a multi-line response
+    } else if(len == sizeof(welcome) - 1 && memcmp(line, welcome, len) == 0) {
+        conn->welcomed = true;
+        return;
+    } else if((len == sizeof(disconnect) - 1 && memcmp(line, disconnect, len) == 0) ||
+    (len >= sizeof(connect_suffix) - 1 &&
+    memcmp(line + len - (sizeof(connect_suffix) - 1), connect_suffix, sizeof(connect_suffix) - 1) == 0)) {
+        t->notices++;
+        return;
+    } else if(conn->inflight == 0) {
+        t->notices++; // Not an answer to any of the commands (e.g. an asynchronous message)
+        return;
+    }
+
+    uint32_t idx = conn->sent_cmd[conn->head];
+    bench_hist_record(&t->hist[idx], now - conn->sent_ns[conn->head]);
+    if(len >= strlen(APP_PIHUB_ERROR_MSG) && strncmp(line, APP_PIHUB_ERROR_MSG, strlen(APP_PIHUB_ERROR_MSG)) == 0) {
+        t->errors[idx]++;
+    }
+    conn->head = (conn->head + 1) % BENCH_MAX_DEPTH;
+    conn->inflight--;
+}
+
+// Read everything the socket has and split it into lines
+static int bench_receive(BenchThread_t* t, BenchConn_t* conn) {
+    while(true) {
+        ssize_t n = recv(conn->fd, conn->rx + conn->rx_len, sizeof(conn->rx) - conn->rx_len, 0);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        } else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else if(n <= 0) {
+            return -1; // Closed by the server or failed
+        }
+        uint64_t now = bench_now_ns();
+        size_t len = conn->rx_len + (size_t)n;
+        size_t start = 0;
+        for(size_t i = conn->rx_len; i < len; i++) {
+            if(conn->rx[i] != '\n') {
+                continue;
+            }
+            if(!conn->discard_line) {
+                bench_handle_line(t, conn, conn->rx + start, i - start, now);
+            }
+            conn->discard_line = false;
+            start = i + 1;
+        }
+        if(start == 0 && len == sizeof(conn->rx)) {
+            conn->discard_line = true; // Line longer than the buffer (the rest of it is dropped as well)
+            len = 0;
+        }
+        memmove(conn->rx, conn->rx + start, len - start);
+        conn->rx_len = len - start;
+    }
+}
+
+static void* bench_thread(void* arg) {
+    BenchThread_t* t = (BenchThread_t*)arg;
+    uint32_t count = 0;
+    BenchConn_t* conns = calloc(bench.clients / bench.threads + 1, sizeof(BenchConn_t));
+    int epfd = epoll_create1(0);
+    if(!conns || epfd < 0) {
+        fprintf(stderr, "thread #%u: failed to allocate the connections (%s)\n", t->index, strerror(errno));
+        free(conns);
+        return NULL;
+    }
+
+    for(uint32_t i = t->index; i < bench.clients; i += bench.threads) {
+        BenchConn_t* conn = &conns[count];
+        conn->fd = bench_connect();
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+        if(conn->fd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, conn->fd, &ev) != 0) {
+            if(conn->fd >= 0) {
+                close(conn->fd);
+            }
+            t->connect_failures++;
+            continue;
+        }
+        count++;
+    }
+
+    struct epoll_event events[BENCH_EPOLL_EVENTS];
+    while(bench_now_ns() < bench.end_ns) {
+        int n = epoll_wait(epfd, events, BENCH_EPOLL_EVENTS, BENCH_EPOLL_TIMEOUT_MS);
+        for(int i = 0; i < n; i++) {
+            BenchConn_t* conn = (BenchConn_t*)events[i].data.ptr;
+            if(conn->fd < 0) {
+                continue;
+            }
+            int ret = 0;
+            if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                ret = bench_receive(t, conn);
+            }
+            if(ret == 0) {
+                ret = bench_fill(t, epfd, conn, bench_now_ns()); // Also sends the commands buffered on EPOLLOUT
+            }
+            if(ret != 0) {
+                bench_close(t, conn);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+        if(conns[i].fd >= 0) {
+            close(conns[i].fd);
+        }
+    }
+    close(epfd);
+    free(conns);
+    return NULL;
+}
+
+static void bench_print_row(const char* name, const BenchHist_t* hist, const uint64_t errors) {
+    printf("%-28.28s %10lu %8lu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, (unsigned long)hist->total,
+    (unsigned long)errors, bench_hist_percentile(hist, 0.5) / 1000.0, bench_hist_percentile(hist, 0.9) / 1000.0,
+    bench_hist_percentile(hist, 0.99) / 1000.0, bench_hist_percentile(hist, 0.999) / 1000.0, hist->max / 1000.0);
+}
+
+static void bench_usage(const char* name) {
+    fprintf(stderr,
+    "Usage: %s [-H host] [-p port] [-c clients] [-t threads] [-P depth] [-d seconds] [-m \"cmd[:weight]\"]...\n"
+    "  -H  server address (default: %s)\n"
+    "  -p  server port (default: %s)\n"
+    "  -c  number of connections (default: %d, max: %d)\n"
+    "  -t  number of threads (default: %d, max: %d)\n"
+    "  -P  commands in flight per connection (default: %d, max: %d)\n"
+    "  -d  duration of the run in seconds (default: %d)\n"
+    "  -m  command of the mix with its weight, repeatable (default: read-only commands of `server help`)\n",
+    name, BENCH_DEFAULT_HOST, APP_SERVER_PORT, BENCH_DEFAULT_CLIENTS, BENCH_MAX_CLIENTS, BENCH_DEFAULT_THREADS,
+    BENCH_MAX_THREADS, BENCH_DEFAULT_DEPTH, BENCH_MAX_DEPTH, BENCH_DEFAULT_DURATION_S);
+}
+
+// Parse a numeric option within [1, max]
+static int bench_parse_count(const char* arg, const uint32_t max, uint32_t* value) {
+    char* end;
+    errno = 0;
+    unsigned long v = strtoul(arg, &end, 10);
+    if(errno != 0 || end == arg || *end != '\0' || v == 0 || v > max) {
+        return -1;
+    }
+    *value = (uint32_t)v;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    bench = (Bench_t){ .host = BENCH_DEFAULT_HOST,
+        .port = APP_SERVER_PORT,
+        .clients = BENCH_DEFAULT_CLIENTS,
+        .threads = BENCH_DEFAULT_THREADS,
+        .depth = BENCH_DEFAULT_DEPTH,
+        .duration_s = BENCH_DEFAULT_DURATION_S };
+
+    int opt;
+    int ret = 0;
+    while(ret == 0 && (opt = getopt(argc, argv, "H:p:c:t:P:d:m:h")) != -1) {
+        switch(opt) {
+        case 'H': {
+            bench.host = optarg;
+            break;
+        }
+        case 'p': {
+            bench.port = optarg;
+            break;
+        }
+        case 'c': {
+            ret = bench_parse_count(optarg, BENCH_MAX_CLIENTS, &bench.clients);
+            break;
+        }
+        case 't': {
+            ret = bench_parse_count(optarg, BENCH_MAX_THREADS, &bench.threads);
+            break;
+        }
+        case 'P': {
+            ret = bench_parse_count(optarg, BENCH_MAX_DEPTH, &bench.depth);
+            break;
+        }
+        case 'd': {
+            ret = bench_parse_count(optarg, UINT16_MAX, &bench.duration_s);
+            break;
+        }
+        case 'm': {
+            ret = bench_add_cmd(optarg);
+            break;
+        }
+        default: {
+            ret = -1;
+            break;
+        }
+        }
+    }
+    if(ret != 0 || optind != argc) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if(bench.cmd_count == 0) {
+        for(size_t i = 0; i < sizeof(BENCH_DEFAULT_MIX) / sizeof(BENCH_DEFAULT_MIX[0]); i++) {
+            bench_add_cmd(BENCH_DEFAULT_MIX[i]);
+        }
+    }
+    bench.threads = (bench.threads > bench.clients) ? bench.clients : bench.threads;
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    int gai = getaddrinfo(bench.host, bench.port, &hints, &bench.addr);
+    if(gai != 0) {
+        fprintf(stderr, "getaddrinfo() failed for %s:%s (%s)\n", bench.host, bench.port, gai_strerror(gai));
+        return EXIT_FAILURE;
+    }
+
+    BenchThread_t* threads = calloc(bench.threads, sizeof(BenchThread_t));
+    BenchHist_t* hist = calloc((size_t)(bench.threads + 1) * bench.cmd_count, sizeof(BenchHist_t));
+    if(!threads || !hist) {
+        fprintf(stderr, "failed to allocate the results\n");
+        freeaddrinfo(bench.addr);
+        return EXIT_FAILURE;
+    }
+
+    printf("pihub_bench: %s:%s, %u connections, %u threads, depth %u, %u s, %u commands in the mix\n", bench.host,
+    bench.port, bench.clients, bench.threads, bench.depth, bench.duration_s, bench.cmd_count);
+    uint64_t start_ns = bench_now_ns();
+    bench.end_ns = start_ns + (uint64_t)bench.duration_s * 1000000000ull;
+    uint32_t started = 0;
+    for(uint32_t i = 0; i < bench.threads; i++) {
+        threads[i].index = i;
+        threads[i].rng = 0x9E3779B97F4A7C15ull * (i + 1);
+        threads[i].hist = &hist[(size_t)(i + 1) * bench.cmd_count]; // hist[0 .. cmd_count) hold the merged ones
+        int err = pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]);
+        if(err != 0) {
+            fprintf(stderr, "pthread_create() returned %d\n", err);
+            break;
+        }
+        started++;
+    }
+
+    // Merge the results of all threads
+    uint64_t errors[BENCH_MAX_CMDS] = { 0 };
+    uint64_t connect_failures = 0, closed = 0, notices = 0;
+    for(uint32_t i = 0; i < started; i++) {
+        pthread_join(threads[i].thread, NULL);
+        for(uint32_t c = 0; c < bench.cmd_count; c++) {
+            bench_hist_merge(&hist[c], &threads[i].hist[c]);
+            errors[c] += threads[i].errors[c];
+        }
+        connect_failures += threads[i].connect_failures;
+        closed += threads[i].closed;
+        notices += threads[i].notices;
+    }
+    double elapsed_s = (bench_now_ns() - start_ns) / 1e9;
+
+    BenchHist_t* total = calloc(1, sizeof(BenchHist_t));
+    uint64_t total_errors = 0;
+    printf("\n%-28s %10s %8s %9s %9s %9s %9s %9s\n", "command", "requests", "errors", "p50 [us]", "p90 [us]",
+    "p99 [us]", "p999 [us]", "max [us]");
+    for(uint32_t c = 0; c < bench.cmd_count; c++) {
+        char name[BENCH_MAX_CMD_LEN];
+        snprintf(name, sizeof(name), "%.*s", (int)(bench.cmds[c].len - 1), bench.cmds[c].line);
+        bench_print_row(name, &hist[c], errors[c]);
+        if(total) {
+            bench_hist_merge(total, &hist[c]);
+        }
+        total_errors += errors[c];
+    }
+    if(total) {
+        bench_print_row("total", total, total_errors);
+        printf("\nthroughput: %.1f req/s (%lu responses in %.2f s)\n", total->total / elapsed_s,
+        (unsigned long)total->total, elapsed_s);
+    }
+    printf("connections: %lu failed to connect, %lu closed by the server; %lu broadcasts skipped\n",
+    (unsigned long)connect_failures, (unsigned long)closed, (unsigned long)notices);
+
+    free(total);
+    free(hist);
+    free(threads);
+    freeaddrinfo(bench.addr);
+    return (started == bench.threads && connect_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}